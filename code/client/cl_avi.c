@@ -66,7 +66,7 @@ typedef struct aviFileData_s
   int           chunkStack[ MAX_RIFF_CHUNKS ];
   int           chunkStackTop;
 
-  byte          *cBuffer, *eBuffer;
+  byte          *cBuffer;
 } aviFileData_t;
 
 static aviFileData_t afd;
@@ -76,6 +76,55 @@ static aviFileData_t afd;
 static byte buffer[ MAX_AVI_BUFFER ];
 static int  bufIndex;
 
+/*
+Video frames and audio chunks are queued in the order the main thread produces
+them and a single encoder thread converts or JPEG-compresses the frames. The
+main thread writes finished jobs in queue order, so the chunk order in the file
+stays the same and all file system calls and error reports stay on the main
+thread. Opening, segment rotation and closing drain the queue first.
+*/
+
+#define AVI_QUEUE_SIZE 8
+
+typedef enum {
+	AVIJOB_VIDEO,
+	AVIJOB_AUDIO
+} aviJobType_t;
+
+typedef struct {
+	aviJobType_t type;
+	int			size;
+	int			width, height;
+	int			padding;			// bytes at the end of each pixel line
+	int			quality;
+	qboolean	gamma;
+	byte		gammaTable[ 256 ];
+	byte		*data;
+	int			dataSize;
+	byte		*out;				// encoded video frame
+	int			outSize;
+	int			encodedSize;		// 0 if encoding failed
+} aviJob_t;
+
+static struct {
+	aviJob_t	jobs[ AVI_QUEUE_SIZE ];
+	void		*thread;
+	void		*wake;				// posted when a job is queued
+	void		*encoded;			// posted when a job is encoded
+	volatile int queued;			// advanced by the main thread only
+	volatile int done;				// advanced by the encoder thread only
+	int			written;
+	volatile int shutdown;
+	volatile int threadWaiting;
+	volatile int mainWaiting;
+	unsigned int reservedSize;		// worst case file size when the queue is written
+	int			reservedIndices;
+} aviQueue;
+
+static void CL_StartAVIThread( void );
+static void CL_StopAVIThread( void );
+static void CL_AbortAVIThread( void );
+
 
 /*
 ===============
@@ -85,7 +134,11 @@ SafeFS_Write
 static ID_INLINE void SafeFS_Write( const void *buf, int len, fileHandle_t f )
 {
   if ( FS_Write( buf, len, f ) < len )
+  {
+		// frames still queued can't be written either
+		CL_AbortAVIThread();
 		Com_Error( ERR_DROP, "Failed to write avi file" );
+  }
 }
 
 
@@ -362,10 +415,8 @@ qboolean CL_OpenAVIForWriting( const char *fileName, qboolean pipe, qboolean reo
 	{
 		// keep currently allocated buffers
 		byte *cBuffer = afd.cBuffer;
-		byte *eBuffer = afd.eBuffer;
 		Com_Memset( &afd, 0, sizeof( aviFileData_t ) );
 		afd.cBuffer = cBuffer;
-		afd.eBuffer = eBuffer;
 	}
 	else
 	{
@@ -421,8 +472,6 @@ qboolean CL_OpenAVIForWriting( const char *fileName, qboolean pipe, qboolean reo
 		#define MAX_PACK_LEN 16
 		//afd.cBuffer = Z_Malloc((afd.width * 3 + MAX_PACK_LEN - 1) * afd.height + MAX_PACK_LEN - 1);
 		afd.cBuffer = Z_Malloc( (afd.width * afd.height * 4) + MAX_PACK_LEN - 1 ); // allocate for RGBA storage
-		// raw avi files have pixel lines start on 4-byte boundaries
-		afd.eBuffer = Z_Malloc( PAD( afd.width * 3, AVI_LINE_PADDING ) * afd.height );
 	}
 
 	afd.a.rate = dma.speed;
@@ -478,6 +527,8 @@ qboolean CL_OpenAVIForWriting( const char *fileName, qboolean pipe, qboolean reo
 
 	afd.fileOpen = qtrue;
 
+	CL_StartAVIThread();
+
 	return qtrue;
 }
 
@@ -527,7 +578,7 @@ static qboolean CL_CheckFileSize( int bytesToAdd )
 CL_WriteAVIVideoFrame
 ===============
 */
-void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size )
+static void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size )
 {
 	unsigned int chunkOffset;
 	int		chunkSize = 8 + size;
@@ -538,7 +589,8 @@ void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size )
 		return;
 
 	// Chunk header + contents + padding
-	CL_CheckFileSize( chunkSize + paddingSize );
+	if ( !aviQueue.thread )
+		CL_CheckFileSize( chunkSize + paddingSize );
 
 	chunkOffset = afd.fileSize - afd.moviOffset - 8;
 
@@ -580,25 +632,22 @@ static int  bytesInBuffer = 0;
 
 /*
 ===============
-CL_FlushAudioBuffer
+CL_WriteAVIAudioChunk
 ===============
 */
-static void CL_FlushCaptureBuffer( void ) 
+static void CL_WriteAVIAudioChunk( const byte *pcm, int size )
 {
 	unsigned int chunkOffset = afd.fileSize - afd.moviOffset - 8;
-	int   chunkSize = 8 + bytesInBuffer;
-	int   paddingSize = PADLEN( bytesInBuffer, 2 );
+	int   chunkSize = 8 + size;
+	int   paddingSize = PADLEN( size, 2 );
 	byte  padding[ 4 ] = { 0 };
 
-	if ( !bytesInBuffer )
-		return;
-
 	bufIndex = 0;
 	WRITE_STRING( "01wb" );
-	WRITE_4BYTES( bytesInBuffer );
+	WRITE_4BYTES( size );
 
 	SafeFS_Write( buffer, 8, afd.f );
-	SafeFS_Write( pcmCaptureBuffer, bytesInBuffer, afd.f );
+	SafeFS_Write( pcm, size, afd.f );
 	SafeFS_Write( padding, paddingSize, afd.f );
 
 	afd.numAudioFrames++;
@@ -607,16 +656,384 @@ static void CL_FlushCaptureBuffer( void )
 	{
 		afd.fileSize += ( chunkSize + paddingSize );
 		afd.moviSize += ( chunkSize + paddingSize );
-		afd.a.totalBytes += bytesInBuffer;
+		afd.a.totalBytes += size;
 		// Index
 		bufIndex = 0;
 		WRITE_STRING( "01wb" );           //dwIdentifier
 		WRITE_4BYTES( 0 );                //dwFlags
 		WRITE_4BYTES( chunkOffset );      //dwOffset
-		WRITE_4BYTES( bytesInBuffer );    //dwLength
+		WRITE_4BYTES( size );             //dwLength
 		SafeFS_Write( buffer, 16, afd.idxF );
 		afd.numIndices++;
 	}
+}
+
+
+/*
+===============
+CL_EncodeAVIVideoFrame
+
+Returns size of the encoded frame in job->out or 0 on failure,
+runs on the encoder thread so it must not print or raise errors
+===============
+*/
+static int CL_EncodeAVIVideoFrame( aviJob_t *job )
+{
+	byte *lineend, *memend;
+	byte *srcptr, *destptr;
+	int linelen, avipadwidth, avipadlen;
+	int i;
+
+	linelen = job->width * 3;
+	avipadwidth = PAD( linelen, AVI_LINE_PADDING );
+	avipadlen = avipadwidth - linelen;
+
+	// gamma correction
+	if ( job->gamma )
+	{
+		for ( i = 0; i < job->size; i++ )
+			job->data[i] = job->gammaTable[ job->data[i] ];
+	}
+
+	if ( afd.motionJpeg )
+	{
+		return CL_EncodeJPG( job->out, linelen * job->height,
+			job->quality, job->width, job->height, job->data, job->padding );
+	}
+
+	srcptr = job->data;
+	destptr = job->out;
+	memend = srcptr + job->size;
+
+	// swap R and B and remove line paddings
+	while ( srcptr < memend )
+	{
+		lineend = srcptr + linelen;
+		while ( srcptr < lineend )
+		{
+			*destptr++ = srcptr[2];
+			*destptr++ = srcptr[1];
+			*destptr++ = srcptr[0];
+			srcptr += 3;
+		}
+
+		Com_Memset( destptr, '\0', avipadlen );
+		destptr += avipadlen;
+
+		srcptr += job->padding;
+	}
+
+	return avipadwidth * job->height;
+}
+
+
+/*
+===============
+CL_WriteAVIJob
+===============
+*/
+static void CL_WriteAVIJob( const aviJob_t *job )
+{
+	if ( job->type == AVIJOB_AUDIO )
+	{
+		CL_WriteAVIAudioChunk( job->data, job->size );
+		return;
+	}
+
+	if ( !job->encodedSize )
+	{
+		CL_AbortAVIThread();
+		Com_Error( ERR_DROP, "Failed to encode avi frame" );
+	}
+
+	CL_WriteAVIVideoFrame( job->out, job->encodedSize );
+}
+
+
+/*
+===============
+CL_AVIThread
+
+Encodes queued video frames, audio chunks are passed through
+===============
+*/
+static void CL_AVIThread( void *arg )
+{
+	aviJob_t *job;
+
+	while ( !Q_AtomicLoad( &aviQueue.shutdown ) )
+	{
+		if ( aviQueue.done == Q_AtomicLoad( &aviQueue.queued ) )
+		{
+			Q_AtomicExchange( &aviQueue.threadWaiting, 1 );
+			if ( aviQueue.done == Q_AtomicLoad( &aviQueue.queued ) && !Q_AtomicLoad( &aviQueue.shutdown ) )
+				Sys_WaitSemaphore( aviQueue.wake );
+			continue;
+		}
+
+		job = &aviQueue.jobs[ aviQueue.done % AVI_QUEUE_SIZE ];
+		if ( job->type == AVIJOB_VIDEO )
+			job->encodedSize = CL_EncodeAVIVideoFrame( job );
+
+		Q_AtomicAdd( &aviQueue.done, 1 );
+
+		if ( Q_AtomicExchange( &aviQueue.mainWaiting, 0 ) )
+			Sys_PostSemaphore( aviQueue.encoded, 1 );
+	}
+}
+
+
+/*
+===============
+CL_AVIWriteJobs
+
+Writes the jobs the encoder thread has finished, with wait set it
+first sleeps until at least one more job is finished
+===============
+*/
+static void CL_AVIWriteJobs( qboolean wait )
+{
+	aviJob_t *job;
+
+	while ( wait && aviQueue.written == Q_AtomicLoad( &aviQueue.done ) )
+	{
+		Q_AtomicExchange( &aviQueue.mainWaiting, 1 );
+		if ( aviQueue.written != Q_AtomicLoad( &aviQueue.done ) )
+			break;
+		Sys_WaitSemaphore( aviQueue.encoded );
+	}
+
+	while ( aviQueue.written != Q_AtomicLoad( &aviQueue.done ) )
+	{
+		job = &aviQueue.jobs[ aviQueue.written % AVI_QUEUE_SIZE ];
+		aviQueue.written++;
+		CL_WriteAVIJob( job );
+	}
+}
+
+
+/*
+===============
+CL_AVIWait
+
+Writes everything queued so far
+===============
+*/
+static void CL_AVIWait( void )
+{
+	while ( aviQueue.thread && aviQueue.written != aviQueue.queued )
+		CL_AVIWriteJobs( qtrue );
+}
+
+
+/*
+===============
+CL_StartAVIThread
+===============
+*/
+static void CL_StartAVIThread( void )
+{
+	aviQueue.queued = 0;
+	aviQueue.done = 0;
+	aviQueue.written = 0;
+	aviQueue.shutdown = 0;
+	aviQueue.threadWaiting = 0;
+	aviQueue.mainWaiting = 0;
+	aviQueue.reservedSize = afd.fileSize;
+	aviQueue.reservedIndices = afd.numIndices;
+
+	if ( !cl_aviThread->integer )
+		return;
+
+	aviQueue.wake = Sys_CreateSemaphore();
+	aviQueue.encoded = Sys_CreateSemaphore();
+	if ( aviQueue.wake && aviQueue.encoded )
+		aviQueue.thread = Sys_CreateThread( CL_AVIThread, NULL );
+
+	if ( !aviQueue.thread )
+	{
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't create video encoder thread\n" );
+		if ( aviQueue.wake )
+			Sys_DestroySemaphore( aviQueue.wake );
+		if ( aviQueue.encoded )
+			Sys_DestroySemaphore( aviQueue.encoded );
+		aviQueue.wake = aviQueue.encoded = NULL;
+	}
+}
+
+
+/*
+===============
+CL_AbortAVIThread
+
+Stops the encoder thread, jobs that have not been written are dropped
+===============
+*/
+static void CL_AbortAVIThread( void )
+{
+	if ( !aviQueue.thread )
+		return;
+
+	Q_AtomicExchange( &aviQueue.shutdown, 1 );
+	Sys_PostSemaphore( aviQueue.wake, 1 );
+	Sys_JoinThread( aviQueue.thread );
+	aviQueue.thread = NULL;
+
+	Sys_DestroySemaphore( aviQueue.wake );
+	Sys_DestroySemaphore( aviQueue.encoded );
+	aviQueue.wake = aviQueue.encoded = NULL;
+
+	aviQueue.written = aviQueue.queued;
+}
+
+
+/*
+===============
+CL_StopAVIThread
+
+Writes everything queued so far and stops the encoder thread
+===============
+*/
+static void CL_StopAVIThread( void )
+{
+	CL_AVIWait();
+	CL_AbortAVIThread();
+}
+
+
+/*
+===============
+CL_FreeAVIJobs
+===============
+*/
+static void CL_FreeAVIJobs( void )
+{
+	int i;
+
+	for ( i = 0; i < AVI_QUEUE_SIZE; i++ )
+	{
+		if ( aviQueue.jobs[ i ].data )
+			Z_Free( aviQueue.jobs[ i ].data );
+		if ( aviQueue.jobs[ i ].out )
+			Z_Free( aviQueue.jobs[ i ].out );
+		aviQueue.jobs[ i ].data = NULL;
+		aviQueue.jobs[ i ].dataSize = 0;
+		aviQueue.jobs[ i ].out = NULL;
+		aviQueue.jobs[ i ].outSize = 0;
+	}
+}
+
+
+/*
+===============
+CL_AVIAllocJob
+
+Returns the next free queue slot with room for size bytes
+===============
+*/
+static aviJob_t *CL_AVIAllocJob( int size )
+{
+	aviJob_t *job;
+
+	// the encoder is falling behind
+	while ( aviQueue.thread && aviQueue.queued - aviQueue.written >= AVI_QUEUE_SIZE )
+		CL_AVIWriteJobs( qtrue );
+
+	job = &aviQueue.jobs[ aviQueue.queued % AVI_QUEUE_SIZE ];
+	if ( job->dataSize < size )
+	{
+		if ( job->data )
+			Z_Free( job->data );
+		job->data = Z_Malloc( size );
+		job->dataSize = size;
+	}
+
+	return job;
+}
+
+
+/*
+===============
+CL_AVISubmitJob
+===============
+*/
+static void CL_AVISubmitJob( aviJob_t *job )
+{
+	if ( aviQueue.thread )
+	{
+		Q_AtomicAdd( &aviQueue.queued, 1 );
+		if ( Q_AtomicExchange( &aviQueue.threadWaiting, 0 ) )
+			Sys_PostSemaphore( aviQueue.wake, 1 );
+		CL_AVIWriteJobs( qfalse );
+		return;
+	}
+
+	if ( job->type == AVIJOB_VIDEO )
+		job->encodedSize = CL_EncodeAVIVideoFrame( job );
+
+	CL_WriteAVIJob( job );
+}
+
+
+/*
+===============
+CL_ReserveFileSize
+
+CL_CheckFileSize for queued chunks, which can't be checked against the
+real file size until they are written
+===============
+*/
+static void CL_ReserveFileSize( int bytesToAdd )
+{
+	unsigned int newFileSize;
+
+	if ( afd.pipe )
+		return;
+
+	newFileSize =
+		aviQueue.reservedSize +
+		bytesToAdd +
+		( ( aviQueue.reservedIndices + 1 ) * 16 ) +
+		4;
+
+	if ( newFileSize >= AVI_SEGMENT_SIZE || newFileSize < aviQueue.reservedSize )
+	{
+		// reservations are worst case, check again with the real size
+		CL_AVIWait();
+		aviQueue.reservedSize = afd.fileSize;
+		aviQueue.reservedIndices = afd.numIndices;
+		CL_CheckFileSize( bytesToAdd );
+	}
+
+	aviQueue.reservedSize += bytesToAdd;
+	aviQueue.reservedIndices++;
+}
+
+
+/*
+===============
+CL_FlushCaptureBuffer
+===============
+*/
+static void CL_FlushCaptureBuffer( void ) 
+{
+	aviJob_t *job;
+
+	if ( !bytesInBuffer )
+		return;
+
+	if ( aviQueue.thread )
+	{
+		job = CL_AVIAllocJob( bytesInBuffer );
+		job->type = AVIJOB_AUDIO;
+		job->size = bytesInBuffer;
+		Com_Memcpy( job->data, pcmCaptureBuffer, bytesInBuffer );
+		CL_AVISubmitJob( job );
+	}
+	else
+	{
+		CL_WriteAVIAudioChunk( pcmCaptureBuffer, bytesInBuffer );
+	}
 
 	bytesInBuffer = 0;
 }
@@ -636,7 +1053,10 @@ void CL_WriteAVIAudioFrame( const byte *pcmBuffer, int size )
 		return;
 
 	// Chunk header + contents + padding
-	CL_CheckFileSize( 8 + bytesInBuffer + size + 2 );
+	if ( !aviQueue.thread )
+		CL_CheckFileSize( 8 + bytesInBuffer + size + 2 );
+	else if ( bytesInBuffer >= afd.audioFrameSize )
+		CL_ReserveFileSize( 8 + bytesInBuffer + 1 );
 
 	if ( bytesInBuffer + size > PCM_BUFFER_SIZE )
 	{
@@ -658,6 +1078,64 @@ void CL_WriteAVIAudioFrame( const byte *pcmBuffer, int size )
 }
 
 
+/*
+===============
+CL_QueueAVIVideoFrame
+
+Called by the renderer with a captured frame, which is bottom-up RGB with
+padding bytes at the end of each line
+===============
+*/
+void CL_QueueAVIVideoFrame( const byte *pixels, int width, int height, int padding, const byte *gammaTable, int jpegQuality )
+{
+	aviJob_t *job;
+	int size, outSize;
+
+	if ( !afd.fileOpen )
+		return;
+
+	if ( aviQueue.thread )
+	{
+		// Chunk header + worst case contents + padding
+		CL_ReserveFileSize( 8 + PAD( width * 3, AVI_LINE_PADDING ) * height + 1 );
+		if ( !afd.fileOpen )
+			return;
+	}
+
+	size = ( width * 3 + padding ) * height;
+
+	job = CL_AVIAllocJob( size );
+	job->type = AVIJOB_VIDEO;
+	job->size = size;
+	job->width = width;
+	job->height = height;
+	job->padding = padding;
+	job->quality = jpegQuality;
+	if ( gammaTable )
+	{
+		job->gamma = qtrue;
+		Com_Memcpy( job->gammaTable, gammaTable, sizeof( job->gammaTable ) );
+	}
+	else
+	{
+		job->gamma = qfalse;
+	}
+	Com_Memcpy( job->data, pixels, size );
+
+	// raw avi files have pixel lines start on 4-byte boundaries
+	outSize = PAD( width * 3, AVI_LINE_PADDING ) * height;
+	if ( job->outSize < outSize )
+	{
+		if ( job->out )
+			Z_Free( job->out );
+		job->out = Z_Malloc( outSize );
+		job->outSize = outSize;
+	}
+
+	CL_AVISubmitJob( job );
+}
+
+
 /*
 ===============
 CL_TakeVideoFrame
@@ -669,8 +1147,7 @@ void CL_TakeVideoFrame( void )
 	if( !afd.fileOpen )
 		return;
 
-	re.TakeVideoFrame( afd.width, afd.height,
-		afd.cBuffer, afd.eBuffer, afd.motionJpeg );
+	re.TakeVideoFrame( afd.width, afd.height, afd.cBuffer );
 }
 
 
@@ -693,12 +1170,19 @@ qboolean CL_CloseAVI( qboolean reopen )
 		return qfalse;
 	}
 
+	if ( !reopen && re.FlushVideoFrames )
+	{
+		// frames the renderer is still reading back
+		re.FlushVideoFrames();
+	}
+
+	CL_StopAVIThread();
 	CL_FlushCaptureBuffer();
 
 	if ( !reopen )
 	{
 		Z_Free( afd.cBuffer );
-		Z_Free( afd.eBuffer );
+		CL_FreeAVIJobs();
 	}
 
 	if ( afd.pipe )
@@ -0,0 +1,515 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cl_browser.c -- server browser query engine
+
+// Every address received from a master server (and every server the ui
+// wants pinged) is queued here and queried with "getinfo" at an adaptive
+// rate, with up to cl_browserMaxPings requests in flight.  Results are
+// pushed into the server lists as they arrive, so the ui sees them
+// incrementally, and are kept for a while so that the legacy ping slots
+// used by the ui "ping" command can be answered without another round trip.
+
+#include "client.h"
+
+#define MAX_BROWSER_SERVERS		( MAX_GLOBAL_SERVERS + MAX_GLOBAL_SERVER_ADDRESSES + MAX_OTHER_SERVERS * 2 )
+#define BROWSER_HASH_SIZE		32768
+#define BROWSER_INFO_POOL		( 2 * 1024 * 1024 )
+
+#define BROWSER_CACHE_TIME		15000	// msec a result stays valid
+#define BROWSER_WINDOW			200		// msec between pacing decisions
+#define BROWSER_MIN_RATE		50.0f	// requests per second
+
+typedef enum {
+	BS_FREE,
+	BS_QUEUED,		// waiting to be sent
+	BS_SENT,		// waiting for infoResponse
+	BS_ANSWERED,
+	BS_TIMEDOUT
+} browserState_t;
+
+typedef struct {
+	netadr_t		adr;
+	browserState_t	state;
+	int				start;		// time the request was sent
+	int				time;		// round trip time once answered
+	int				info;		// offset into infoPool or -1
+	int				hashNext;
+	int				prev, next;	// queue or in-flight list
+} browserServer_t;
+
+typedef struct {
+	int				head, tail;
+	int				count;
+} browserList_t;
+
+typedef struct {
+	browserServer_t	servers[ MAX_BROWSER_SERVERS ];
+	int				numServers;
+	int				hashTable[ BROWSER_HASH_SIZE ];
+
+	browserList_t	queue;		// BS_QUEUED, in order of arrival
+	browserList_t	inFlight;	// BS_SENT, in order of sending
+
+	char			infoPool[ BROWSER_INFO_POOL ];
+	int				infoUsed;
+
+	// pacing
+	float			rate;		// current requests per second
+	float			credit;		// requests we may send right now
+	int				lastFrame;
+	int				windowStart;
+	int				windowReplies;
+	int				windowRtt;
+	int				baseRtt;	// lowest average round trip seen
+
+	// statistics of the current refresh
+	qboolean		active;
+	int				refreshStart;
+	int				numSent;
+	int				numAnswered;
+	int				numTimedOut;
+} browser_t;
+
+static browser_t browser;
+
+static cvar_t *cl_browserRate;
+static cvar_t *cl_browserMaxPings;
+
+
+/*
+==================
+CL_BrowserHash
+==================
+*/
+static unsigned int CL_BrowserHash( const netadr_t *adr ) {
+	const byte *ip;
+	unsigned int size, i;
+	unsigned int hash = 2166136261u;
+
+	switch ( adr->type ) {
+		case NA_IP:  ip = adr->ipv._4; size = 4;  break;
+#ifdef USE_IPV6
+		case NA_IP6: ip = adr->ipv._6; size = 16; break;
+#endif
+		default: ip = NULL; size = 0; break;
+	}
+
+	for ( i = 0; i < size; i++ )
+		hash = ( hash ^ ip[i] ) * 16777619u;
+
+	hash = ( hash ^ ( adr->port & 255 ) ) * 16777619u;
+	hash = ( hash ^ ( adr->port >> 8 ) ) * 16777619u;
+
+	return hash & ( BROWSER_HASH_SIZE - 1 );
+}
+
+
+/*
+==================
+CL_BrowserFind
+==================
+*/
+static browserServer_t *CL_BrowserFind( const netadr_t *adr ) {
+	browserServer_t *server;
+	int index;
+
+	index = browser.hashTable[ CL_BrowserHash( adr ) ];
+	while ( index ) {
+		server = &browser.servers[ index - 1 ];
+		if ( NET_CompareAdr( adr, &server->adr ) )
+			return server;
+		index = server->hashNext;
+	}
+
+	return NULL;
+}
+
+
+/*
+==================
+CL_BrowserLink / CL_BrowserUnlink
+==================
+*/
+static void CL_BrowserLink( browserList_t *list, browserServer_t *server ) {
+	int index = ( server - browser.servers ) + 1;
+
+	server->prev = list->tail;
+	server->next = 0;
+	if ( list->tail )
+		browser.servers[ list->tail - 1 ].next = index;
+	else
+		list->head = index;
+	list->tail = index;
+	list->count++;
+}
+
+
+static void CL_BrowserUnlink( browserList_t *list, browserServer_t *server ) {
+	if ( server->prev )
+		browser.servers[ server->prev - 1 ].next = server->next;
+	else
+		list->head = server->next;
+	if ( server->next )
+		browser.servers[ server->next - 1 ].prev = server->prev;
+	else
+		list->tail = server->prev;
+	server->prev = server->next = 0;
+	list->count--;
+}
+
+
+/*
+==================
+CL_BrowserReset
+
+Forgets all queued, pending and cached requests
+==================
+*/
+void CL_BrowserReset( void ) {
+	browser.numServers = 0;
+	browser.infoUsed = 0;
+	Com_Memset( browser.hashTable, 0, sizeof( browser.hashTable ) );
+	Com_Memset( &browser.queue, 0, sizeof( browser.queue ) );
+	Com_Memset( &browser.inFlight, 0, sizeof( browser.inFlight ) );
+
+	browser.active = qfalse;
+	browser.rate = 0.0f;
+	browser.baseRtt = 0;
+}
+
+
+/*
+==================
+CL_BrowserActivate
+==================
+*/
+static void CL_BrowserActivate( int msec ) {
+	if ( !browser.active ) {
+		browser.active = qtrue;
+		browser.refreshStart = msec;
+		browser.numSent = browser.numAnswered = browser.numTimedOut = 0;
+	}
+}
+
+
+/*
+==================
+CL_BrowserSend
+==================
+*/
+static void CL_BrowserSend( browserServer_t *server ) {
+
+	if ( server->state == BS_QUEUED )
+		CL_BrowserUnlink( &browser.queue, server );
+
+	server->state = BS_SENT;
+	server->start = Sys_Milliseconds();
+	server->time = 0;
+	CL_BrowserLink( &browser.inFlight, server );
+	CL_BrowserActivate( server->start );
+
+	browser.numSent++;
+
+	NET_OutOfBandPrint( NS_CLIENT, &server->adr, "getinfo xxx" );
+}
+
+
+/*
+==================
+CL_BrowserExpired
+==================
+*/
+static qboolean CL_BrowserExpired( const browserServer_t *server, int msec ) {
+	if ( server->state == BS_ANSWERED || server->state == BS_TIMEDOUT )
+		return msec - server->start >= BROWSER_CACHE_TIME;
+	return qfalse;
+}
+
+
+/*
+==================
+CL_BrowserQueue
+
+Schedules a getinfo request for adr unless one is already pending.
+A recent answer is applied to the server lists right away.
+Returns qfalse if the engine is disabled or full and the caller has to
+ping the server itself.
+==================
+*/
+qboolean CL_BrowserQueue( const netadr_t *adr ) {
+	browserServer_t *server;
+	unsigned int hash;
+	int msec;
+
+	if ( cl_browserRate->integer <= 0 )
+		return qfalse;
+
+	if ( adr->type != NA_IP && adr->type != NA_IP6 )
+		return qfalse;
+
+	msec = Sys_Milliseconds();
+
+	server = CL_BrowserFind( adr );
+	if ( server ) {
+		if ( server->state == BS_QUEUED || server->state == BS_SENT )
+			return qtrue;
+
+		if ( !CL_BrowserExpired( server, msec ) ) {
+			if ( server->state == BS_ANSWERED && server->info >= 0 )
+				CL_SetServerInfoByAddress( adr, browser.infoPool + server->info, server->time );
+			else if ( server->state == BS_TIMEDOUT )
+				CL_SetServerInfoByAddress( adr, NULL, 0 );
+			else
+				CL_BrowserSend( server );
+			return qtrue;
+		}
+	} else {
+		if ( browser.numServers >= MAX_BROWSER_SERVERS )
+			return qfalse;
+
+		server = &browser.servers[ browser.numServers++ ];
+		Com_Memset( server, 0, sizeof( *server ) );
+		server->adr = *adr;
+		server->info = -1;
+
+		hash = CL_BrowserHash( adr );
+		server->hashNext = browser.hashTable[ hash ];
+		browser.hashTable[ hash ] = browser.numServers;
+	}
+
+	server->state = BS_QUEUED;
+	CL_BrowserLink( &browser.queue, server );
+	CL_BrowserActivate( msec );
+
+	return qtrue;
+}
+
+
+/*
+==================
+CL_BrowserLookup
+
+Fills a legacy ping slot from the engine, sending the request right away
+if it is still queued. Returns qfalse if the server is not known or its
+result is too old, in which case the caller sends its own request.
+==================
+*/
+qboolean CL_BrowserLookup( const netadr_t *adr, ping_t *ping ) {
+	browserServer_t *server;
+
+	server = CL_BrowserFind( adr );
+	if ( !server || CL_BrowserExpired( server, Sys_Milliseconds() ) )
+		return qfalse;
+
+	switch ( server->state ) {
+		case BS_QUEUED:
+			CL_BrowserSend( server );
+			// fall through
+		case BS_SENT:
+		case BS_TIMEDOUT:
+			// timed out requests are reported by CL_GetPing as soon as it is asked
+			ping->start = server->start;
+			ping->time = 0;
+			ping->info[0] = '\0';
+			return qtrue;
+
+		case BS_ANSWERED:
+			if ( server->info < 0 )
+				return qfalse;
+			ping->start = server->start;
+			ping->time = server->time;
+			Q_strncpyz( ping->info, browser.infoPool + server->info, sizeof( ping->info ) );
+			return qtrue;
+
+		default:
+			return qfalse;
+	}
+}
+
+
+/*
+==================
+CL_BrowserResponse
+
+Called for every infoResponse, returns round trip time in msec
+or 0 if we did not ask this server
+==================
+*/
+int CL_BrowserResponse( const netadr_t *from, const char *info ) {
+	browserServer_t *server;
+	int len;
+
+	server = CL_BrowserFind( from );
+	if ( !server || server->state != BS_SENT )
+		return 0;
+
+	CL_BrowserUnlink( &browser.inFlight, server );
+
+	server->state = BS_ANSWERED;
+	server->time = Sys_Milliseconds() - server->start;
+	if ( server->time < 1 )
+		server->time = 1;
+
+	len = (int)strlen( info ) + 1;
+	if ( browser.infoUsed + len <= BROWSER_INFO_POOL ) {
+		server->info = browser.infoUsed;
+		Com_Memcpy( browser.infoPool + browser.infoUsed, info, len );
+		browser.infoUsed += len;
+	} else {
+		server->info = -1;
+	}
+
+	browser.numAnswered++;
+	browser.windowReplies++;
+	browser.windowRtt += server->time;
+
+	return server->time;
+}
+
+
+/*
+==================
+CL_BrowserPace
+
+Additive increase, multiplicative decrease of the request rate,
+driven by the average round trip time of the last window: when
+our own bursts start queueing up in some router the answers of
+all servers get slower at once
+==================
+*/
+static void CL_BrowserPace( int msec ) {
+	float maxRate;
+	int avg;
+
+	maxRate = (float)cl_browserRate->integer;
+
+	if ( browser.rate <= 0.0f ) {
+		// slow start
+		browser.rate = MAX( maxRate * 0.25f, BROWSER_MIN_RATE );
+		browser.windowStart = msec;
+		browser.windowReplies = browser.windowRtt = 0;
+		return;
+	}
+
+	if ( msec - browser.windowStart < BROWSER_WINDOW )
+		return;
+
+	if ( browser.windowReplies >= 8 ) {
+		avg = browser.windowRtt / browser.windowReplies;
+		if ( browser.baseRtt == 0 || avg < browser.baseRtt )
+			browser.baseRtt = avg;
+		if ( avg > browser.baseRtt * 2 + 50 )
+			browser.rate *= 0.7f;
+		else
+			browser.rate += maxRate * 0.1f;
+	} else {
+		browser.rate += maxRate * 0.1f;
+	}
+
+	browser.rate = Com_Clamp( BROWSER_MIN_RATE, MAX( maxRate, BROWSER_MIN_RATE ), browser.rate );
+
+	browser.windowStart = msec;
+	browser.windowReplies = browser.windowRtt = 0;
+}
+
+
+/*
+==================
+CL_BrowserFrame
+==================
+*/
+void CL_BrowserFrame( void ) {
+	browserServer_t *server;
+	int msec, maxPing, maxPings;
+
+	if ( !browser.active )
+		return;
+
+	if ( cl_browserRate->integer <= 0 ) {
+		CL_BrowserReset();
+		return;
+	}
+
+	msec = Sys_Milliseconds();
+	maxPing = Cvar_VariableIntegerValue( "cl_maxPing" );
+
+	// expire requests in order of sending
+	while ( browser.inFlight.head ) {
+		server = &browser.servers[ browser.inFlight.head - 1 ];
+		if ( msec - server->start < maxPing )
+			break;
+		CL_BrowserUnlink( &browser.inFlight, server );
+		server->state = BS_TIMEDOUT;
+		browser.numTimedOut++;
+		CL_SetServerInfoByAddress( &server->adr, NULL, 0 );
+	}
+
+	CL_BrowserPace( msec );
+
+	// accumulate sending credit, but don't allow big bursts after a hitch
+	browser.credit += browser.rate * ( msec - browser.lastFrame ) * 0.001f;
+	browser.credit = MIN( browser.credit, browser.rate * 0.05f + 1.0f );
+	browser.lastFrame = msec;
+
+	maxPings = cl_browserMaxPings->integer;
+	while ( browser.queue.head && browser.credit >= 1.0f && browser.inFlight.count < maxPings ) {
+		CL_BrowserSend( &browser.servers[ browser.queue.head - 1 ] );
+		browser.credit -= 1.0f;
+	}
+
+	if ( !browser.queue.count && !browser.inFlight.count ) {
+		browser.active = qfalse;
+		browser.credit = 0.0f;
+		Com_Printf( "Server browser: %d queries in %d msec, %d answered, %d timed out.\n",
+			browser.numSent, msec - browser.refreshStart, browser.numAnswered, browser.numTimedOut );
+	}
+}
+
+
+/*
+==================
+CL_BrowserBusy
+==================
+*/
+qboolean CL_BrowserBusy( void ) {
+	return browser.active;
+}
+
+
+/*
+==================
+CL_BrowserInit
+==================
+*/
+void CL_BrowserInit( void ) {
+
+	cl_browserRate = Cvar_Get( "cl_browserRate", "1000", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( cl_browserRate, "0", "10000", CV_INTEGER );
+	Cvar_SetDescription( cl_browserRate, "Maximum number of server info queries the server browser sends per second, the actual rate adapts to network conditions.\n"
+		" 0: Query servers only through the ui ping slots" );
+
+	cl_browserMaxPings = Cvar_Get( "cl_browserMaxPings", "1024", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( cl_browserMaxPings, "32", "4096", CV_INTEGER );
+	Cvar_SetDescription( cl_browserMaxPings, "Maximum number of server info queries the server browser keeps in flight." );
+
+	CL_BrowserReset();
+}
@@ -174,23 +174,16 @@ static void CL_AddCgameCommand( const char *cmdName ) {
 
 /*
 =====================
-CL_ConfigstringModified
+CL_SetConfigstring
 =====================
 */
-static void CL_ConfigstringModified( void ) {
-	const char	*old, *s;
-	int			i, index;
+void CL_SetConfigstring( int index, const char *s ) {
+	const char	*old;
+	int			i;
 	const char	*dup;
 	gameState_t	oldGs;
 	int			len;
 
-	index = atoi( Cmd_Argv(1) );
-	if ( (unsigned) index >= MAX_CONFIGSTRINGS ) {
-		Com_Error( ERR_DROP, "%s: bad configstring index %i", __func__, index );
-	}
-	// get everything after "cs <num>"
-	s = Cmd_ArgsFrom(2);
-
 	old = cl.gameState.stringData + cl.gameState.stringOffsets[ index ];
 	if ( !strcmp( old, s ) ) {
 		return;		// unchanged
@@ -233,6 +226,24 @@ static void CL_ConfigstringModified( void ) {
 }
 
 
+/*
+=====================
+CL_ConfigstringModified
+=====================
+*/
+static void CL_ConfigstringModified( void ) {
+	int			index;
+
+	index = atoi( Cmd_Argv(1) );
+	if ( (unsigned) index >= MAX_CONFIGSTRINGS ) {
+		Com_Error( ERR_DROP, "%s: bad configstring index %i", __func__, index );
+	}
+
+	// get everything after "cs <num>"
+	CL_SetConfigstring( index, Cmd_ArgsFrom(2) );
+}
+
+
 /*
 ===================
 CL_GetServerCommand
@@ -357,6 +368,28 @@ rescan:
 }
 
 
+/*
+===================
+CL_SkipServerCommands
+
+Applies configstring changes of the pending server commands without
+passing them to the cgame, used when seeking a demo
+===================
+*/
+void CL_SkipServerCommands( void ) {
+	int i;
+
+	i = clc.lastExecutedServerCommand + 1;
+	if ( clc.serverCommandSequence - i >= MAX_RELIABLE_COMMANDS ) {
+		i = clc.serverCommandSequence - MAX_RELIABLE_COMMANDS + 1;
+	}
+
+	for ( ; clc.serverCommandSequence - i >= 0; i++ ) {
+		CL_GetServerCommand( i );
+	}
+}
+
+
 /*
 ====================
 CL_CM_LoadMap
@@ -0,0 +1,803 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cl_demo.c -- demo keyframe index and seeking
+
+// A keyframe is a demo message holding an uncompressed snapshot.  The index
+// stores for each keyframe its file offset, the gamestate message it depends
+// on, the server command sequence and the configstrings changed since the
+// previous keyframe.  It is built by a light scan of the demo the first time
+// demo_seek is used and saved next to the demo as <demo>.idx.
+//
+// Seeking restores the gamestate, applies the configstring changes, parses
+// the messages from the keyframe up to the target time without running the
+// cgame, then restarts the cgame as after a new gamestate.
+
+#include "client.h"
+
+#define DEMO_INDEX_IDENT	(('X'<<24)+('D'<<16)+('I'<<8)+'D')	// "DIDX"
+#define DEMO_INDEX_VERSION	1
+
+typedef struct {
+	int		offset;				// file offset of the keyframe message
+	int		gamestate;			// file offset of the gamestate message it depends on
+	int		serverTime;
+	int		demoTime;			// msec of play since the first snapshot
+	int		commandSequence;	// server commands received up to the snapshot
+	int		strings;			// offset of the changed configstrings in the string pool
+	int		numStrings;
+} demoKeyframe_t;
+
+typedef struct {
+	int		ident;
+	int		version;
+	int		demoLength;
+	int		duration;
+	int		numKeyframes;
+	int		stringsSize;
+} demoIndexHeader_t;
+
+typedef struct {
+	char			name[MAX_OSPATH];
+	int				length;
+	qboolean		loaded;
+	int				duration;
+
+	demoKeyframe_t	*keyframes;
+	int				numKeyframes;
+	int				maxKeyframes;
+
+	char			*strings;	// "<index> <configstring>" entries
+	int				stringsSize;
+	int				maxStrings;
+
+	char			*changed[ MAX_CONFIGSTRINGS ];	// while scanning
+} demoIndex_t;
+
+static demoIndex_t demoIndex;
+
+
+/*
+====================
+CL_DemoReadMessage
+====================
+*/
+static qboolean CL_DemoReadMessage( fileHandle_t f, msg_t *msg, byte *data, int *sequence ) {
+	int s;
+
+	if ( FS_Read( &s, 4, f ) != 4 ) {
+		return qfalse;
+	}
+	*sequence = LittleLong( s );
+
+	MSG_Init( msg, data, MAX_MSGLEN );
+
+	if ( FS_Read( &msg->cursize, 4, f ) != 4 ) {
+		return qfalse;
+	}
+	msg->cursize = LittleLong( msg->cursize );
+	if ( msg->cursize < 0 || msg->cursize > msg->maxsize ) {
+		return qfalse;
+	}
+
+	if ( FS_Read( msg->data, msg->cursize, f ) != msg->cursize ) {
+		return qfalse;
+	}
+
+	msg->readcount = 0;
+
+	return qtrue;
+}
+
+
+/*
+====================
+CL_DemoIndexGrow
+====================
+*/
+static void *CL_DemoIndexGrow( void *data, int size, int newSize ) {
+	void *p;
+
+	p = Z_Malloc( newSize );
+	if ( data ) {
+		Com_Memcpy( p, data, size );
+		Z_Free( data );
+	}
+
+	return p;
+}
+
+
+/*
+====================
+CL_DemoIndexClearChanged
+====================
+*/
+static void CL_DemoIndexClearChanged( void ) {
+	int i;
+
+	for ( i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		if ( demoIndex.changed[ i ] ) {
+			Z_Free( demoIndex.changed[ i ] );
+			demoIndex.changed[ i ] = NULL;
+		}
+	}
+}
+
+
+/*
+====================
+CL_DemoIndexClose
+====================
+*/
+void CL_DemoIndexClose( void ) {
+
+	CL_DemoIndexClearChanged();
+
+	if ( demoIndex.keyframes ) {
+		Z_Free( demoIndex.keyframes );
+	}
+
+	if ( demoIndex.strings ) {
+		Z_Free( demoIndex.strings );
+	}
+
+	Com_Memset( &demoIndex, 0, sizeof( demoIndex ) );
+}
+
+
+/*
+====================
+CL_DemoIndexOpen
+
+Called when demo playback starts, the index is loaded on the first seek
+====================
+*/
+void CL_DemoIndexOpen( const char *name, int length ) {
+
+	CL_DemoIndexClose();
+
+	Q_strncpyz( demoIndex.name, name, sizeof( demoIndex.name ) );
+	demoIndex.length = length;
+}
+
+
+/*
+====================
+CL_DemoIndexCommand
+
+Tracks configstring changes made by server commands
+====================
+*/
+static void CL_DemoIndexCommand( const char *s ) {
+	static char bigConfigString[ BIG_INFO_STRING ];
+	const char *cmd;
+	int index;
+
+rescan:
+	Cmd_TokenizeString( s );
+	cmd = Cmd_Argv( 0 );
+
+	if ( !strcmp( cmd, "bcs0" ) ) {
+		Com_sprintf( bigConfigString, sizeof( bigConfigString ), "cs %s \"%s", Cmd_Argv( 1 ), Cmd_Argv( 2 ) );
+		return;
+	}
+
+	if ( !strcmp( cmd, "bcs1" ) || !strcmp( cmd, "bcs2" ) ) {
+		s = Cmd_Argv( 2 );
+		if ( strlen( bigConfigString ) + strlen( s ) + 1 >= sizeof( bigConfigString ) ) {
+			return;
+		}
+		strcat( bigConfigString, s );
+		if ( cmd[3] == '2' ) {
+			strcat( bigConfigString, "\"" );
+			s = bigConfigString;
+			goto rescan;
+		}
+		return;
+	}
+
+	if ( !strcmp( cmd, "cs" ) ) {
+		index = atoi( Cmd_Argv( 1 ) );
+		if ( (unsigned) index >= MAX_CONFIGSTRINGS ) {
+			return;
+		}
+		if ( demoIndex.changed[ index ] ) {
+			Z_Free( demoIndex.changed[ index ] );
+		}
+		demoIndex.changed[ index ] = CopyString( Cmd_ArgsFrom( 2 ) );
+	}
+}
+
+
+/*
+====================
+CL_DemoIndexGamestate
+
+Skips over the configstrings and baselines of a gamestate
+====================
+*/
+static qboolean CL_DemoIndexGamestate( msg_t *msg ) {
+	entityState_t nullstate, es;
+	int cmd, newnum;
+
+	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+
+	while ( 1 ) {
+		cmd = MSG_ReadByte( msg );
+
+		if ( cmd == svc_EOF ) {
+			break;
+		}
+
+		if ( cmd == svc_configstring ) {
+			MSG_ReadShort( msg );
+			MSG_ReadBigString( msg );
+		} else if ( cmd == svc_baseline ) {
+			newnum = MSG_ReadEntitynum( msg );
+			if ( newnum < 0 || newnum >= MAX_GENTITIES ) {
+				return qfalse;
+			}
+			MSG_ReadDeltaEntity( msg, &nullstate, &es, newnum );
+		} else {
+			return qfalse;
+		}
+	}
+
+	// client number and checksum feed
+	MSG_ReadLong( msg );
+	MSG_ReadLong( msg );
+
+	// all configstrings are in the gamestate
+	CL_DemoIndexClearChanged();
+
+	return qtrue;
+}
+
+
+/*
+====================
+CL_DemoIndexAddKeyframe
+====================
+*/
+static void CL_DemoIndexAddKeyframe( int offset, int gamestate, int serverTime, int demoTime, int commandSequence ) {
+	demoKeyframe_t *kf;
+	const char *s;
+	int i, len;
+
+	if ( demoIndex.numKeyframes == demoIndex.maxKeyframes ) {
+		i = demoIndex.maxKeyframes ? demoIndex.maxKeyframes * 2 : 64;
+		demoIndex.keyframes = CL_DemoIndexGrow( demoIndex.keyframes,
+			demoIndex.numKeyframes * sizeof( demoKeyframe_t ), i * sizeof( demoKeyframe_t ) );
+		demoIndex.maxKeyframes = i;
+	}
+
+	kf = &demoIndex.keyframes[ demoIndex.numKeyframes++ ];
+	kf->offset = offset;
+	kf->gamestate = gamestate;
+	kf->serverTime = serverTime;
+	kf->demoTime = demoTime;
+	kf->commandSequence = commandSequence;
+	kf->strings = demoIndex.stringsSize;
+	kf->numStrings = 0;
+
+	for ( i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		if ( !demoIndex.changed[ i ] ) {
+			continue;
+		}
+
+		s = va( "%i %s", i, demoIndex.changed[ i ] );
+		len = strlen( s ) + 1;
+
+		if ( demoIndex.stringsSize + len > demoIndex.maxStrings ) {
+			int size = demoIndex.maxStrings ? demoIndex.maxStrings * 2 : 16384;
+			while ( demoIndex.stringsSize + len > size ) {
+				size *= 2;
+			}
+			demoIndex.strings = CL_DemoIndexGrow( demoIndex.strings, demoIndex.stringsSize, size );
+			demoIndex.maxStrings = size;
+		}
+
+		Com_Memcpy( demoIndex.strings + demoIndex.stringsSize, s, len );
+		demoIndex.stringsSize += len;
+		kf->numStrings++;
+
+		Z_Free( demoIndex.changed[ i ] );
+		demoIndex.changed[ i ] = NULL;
+	}
+}
+
+
+/*
+====================
+CL_DemoIndexBuild
+
+Scans the demo, only server commands, gamestates and snapshot headers are decoded
+====================
+*/
+static qboolean CL_DemoIndexBuild( void ) {
+	byte			data[ MAX_MSGLEN_BUF ];
+	msg_t			msg;
+	fileHandle_t	f;
+	const char		*s;
+	int				offset, sequence, cmd, seq;
+	int				serverTime, deltaNum;
+	int				gamestate, commandSequence;
+	int				lastServerTime, demoTime;
+	qboolean		timeValid, hasGamestate;
+	int				start;
+
+	FS_BypassPure();
+	FS_FOpenFileRead( demoIndex.name, &f, qtrue );
+	FS_RestorePure();
+
+	if ( f == FS_INVALID_HANDLE ) {
+		Com_Printf( S_COLOR_YELLOW "couldn't open %s\n", demoIndex.name );
+		return qfalse;
+	}
+
+	start = Sys_Milliseconds();
+
+	gamestate = -1;
+	commandSequence = 0;
+	lastServerTime = 0;
+	demoTime = 0;
+	timeValid = qfalse;
+
+	while ( 1 ) {
+		offset = FS_FTell( f );
+		if ( !CL_DemoReadMessage( f, &msg, data, &sequence ) ) {
+			break;
+		}
+
+		MSG_Bitstream( &msg );
+
+		// reliable sequence acknowledge
+		MSG_ReadLong( &msg );
+
+		hasGamestate = qfalse;
+
+		while ( 1 ) {
+			cmd = MSG_ReadByte( &msg );
+
+			if ( cmd == svc_nop ) {
+				continue;
+			}
+
+			if ( cmd == svc_serverCommand ) {
+				seq = MSG_ReadLong( &msg );
+				s = MSG_ReadString( &msg );
+				if ( seq - commandSequence > 0 ) {
+					commandSequence = seq;
+					CL_DemoIndexCommand( s );
+				}
+				continue;
+			}
+
+			if ( cmd == svc_gamestate ) {
+				commandSequence = MSG_ReadLong( &msg );
+				if ( !CL_DemoIndexGamestate( &msg ) ) {
+					break;
+				}
+				gamestate = offset;
+				hasGamestate = qtrue;
+				timeValid = qfalse;
+				continue;
+			}
+
+			if ( cmd == svc_snapshot && gamestate >= 0 && !hasGamestate ) {
+				serverTime = MSG_ReadLong( &msg );
+				deltaNum = MSG_ReadByte( &msg );
+
+				// resent keyframe frames are older than the current one
+				if ( !timeValid ) {
+					timeValid = qtrue;
+					lastServerTime = serverTime;
+				} else if ( serverTime - lastServerTime > 0 ) {
+					demoTime += serverTime - lastServerTime;
+					lastServerTime = serverTime;
+				}
+
+				if ( deltaNum == 0 ) {
+					CL_DemoIndexAddKeyframe( offset, gamestate, serverTime,
+						demoTime - ( lastServerTime - serverTime ), commandSequence );
+				}
+			}
+
+			// the rest of the message is not needed
+			break;
+		}
+	}
+
+	FS_FCloseFile( f );
+
+	CL_DemoIndexClearChanged();
+
+	demoIndex.duration = demoTime;
+
+	Com_Printf( "Indexed %i keyframes of %s in %i msec\n", demoIndex.numKeyframes,
+		demoIndex.name, Sys_Milliseconds() - start );
+
+	return qtrue;
+}
+
+
+/*
+====================
+CL_DemoIndexWrite
+====================
+*/
+static void CL_DemoIndexWrite( void ) {
+	demoIndexHeader_t header;
+	fileHandle_t f;
+	int *p;
+	int i, n;
+
+	f = FS_FOpenFileWrite( va( "%s.idx", demoIndex.name ) );
+	if ( f == FS_INVALID_HANDLE ) {
+		return;
+	}
+
+	header.ident = LittleLong( DEMO_INDEX_IDENT );
+	header.version = LittleLong( DEMO_INDEX_VERSION );
+	header.demoLength = LittleLong( demoIndex.length );
+	header.duration = LittleLong( demoIndex.duration );
+	header.numKeyframes = LittleLong( demoIndex.numKeyframes );
+	header.stringsSize = LittleLong( demoIndex.stringsSize );
+	FS_Write( &header, sizeof( header ), f );
+
+	p = (int *)demoIndex.keyframes;
+	n = demoIndex.numKeyframes * sizeof( demoKeyframe_t ) / sizeof( int );
+	for ( i = 0; i < n; i++ ) {
+		p[i] = LittleLong( p[i] );
+	}
+	FS_Write( demoIndex.keyframes, n * sizeof( int ), f );
+	for ( i = 0; i < n; i++ ) {
+		p[i] = LittleLong( p[i] );
+	}
+
+	FS_Write( demoIndex.strings, demoIndex.stringsSize, f );
+
+	FS_FCloseFile( f );
+}
+
+
+/*
+====================
+CL_DemoIndexRead
+
+Loads the saved index if it was made for the same demo file
+====================
+*/
+static qboolean CL_DemoIndexRead( void ) {
+	demoIndexHeader_t header;
+	fileHandle_t f;
+	int length;
+	int *p;
+	int i, n;
+
+	FS_BypassPure();
+	length = FS_FOpenFileRead( va( "%s.idx", demoIndex.name ), &f, qtrue );
+	FS_RestorePure();
+
+	if ( f == FS_INVALID_HANDLE ) {
+		return qfalse;
+	}
+
+	if ( FS_Read( &header, sizeof( header ), f ) != sizeof( header ) ) {
+		FS_FCloseFile( f );
+		return qfalse;
+	}
+
+	header.ident = LittleLong( header.ident );
+	header.version = LittleLong( header.version );
+	header.demoLength = LittleLong( header.demoLength );
+	header.duration = LittleLong( header.duration );
+	header.numKeyframes = LittleLong( header.numKeyframes );
+	header.stringsSize = LittleLong( header.stringsSize );
+
+	if ( header.ident != DEMO_INDEX_IDENT || header.version != DEMO_INDEX_VERSION
+		|| header.demoLength != demoIndex.length || header.numKeyframes <= 0 || header.stringsSize < 0
+		|| header.numKeyframes > length / sizeof( demoKeyframe_t ) || header.stringsSize > length
+		|| length != sizeof( header ) + header.numKeyframes * sizeof( demoKeyframe_t ) + header.stringsSize ) {
+		FS_FCloseFile( f );
+		return qfalse;
+	}
+
+	demoIndex.keyframes = Z_Malloc( header.numKeyframes * sizeof( demoKeyframe_t ) );
+	demoIndex.numKeyframes = demoIndex.maxKeyframes = header.numKeyframes;
+	FS_Read( demoIndex.keyframes, header.numKeyframes * sizeof( demoKeyframe_t ), f );
+
+	p = (int *)demoIndex.keyframes;
+	n = header.numKeyframes * sizeof( demoKeyframe_t ) / sizeof( int );
+	for ( i = 0; i < n; i++ ) {
+		p[i] = LittleLong( p[i] );
+	}
+
+	if ( header.stringsSize ) {
+		demoIndex.strings = Z_Malloc( header.stringsSize + 1 );
+		demoIndex.stringsSize = demoIndex.maxStrings = header.stringsSize;
+		FS_Read( demoIndex.strings, header.stringsSize, f );
+	}
+
+	demoIndex.duration = header.duration;
+
+	FS_FCloseFile( f );
+
+	// string pool entries must be terminated
+	if ( demoIndex.stringsSize && demoIndex.strings[ demoIndex.stringsSize - 1 ] != '\0' ) {
+		CL_DemoIndexOpen( demoIndex.name, demoIndex.length );
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+
+/*
+====================
+CL_DemoIndexLoad
+====================
+*/
+static qboolean CL_DemoIndexLoad( void ) {
+
+	if ( demoIndex.loaded ) {
+		return qtrue;
+	}
+
+	if ( !demoIndex.name[0] ) {
+		return qfalse;
+	}
+
+	if ( !CL_DemoIndexRead() ) {
+		if ( !CL_DemoIndexBuild() ) {
+			return qfalse;
+		}
+		if ( demoIndex.numKeyframes ) {
+			CL_DemoIndexWrite();
+		}
+	}
+
+	if ( !demoIndex.numKeyframes ) {
+		Com_Printf( "No keyframes in %s\n", demoIndex.name );
+		return qfalse;
+	}
+
+	demoIndex.loaded = qtrue;
+
+	return qtrue;
+}
+
+
+/*
+====================
+CL_DemoIndexApply
+
+Applies the configstring changes stored with a keyframe
+====================
+*/
+static void CL_DemoIndexApply( const demoKeyframe_t *kf ) {
+	const char *s, *value;
+	int i, index;
+
+	if ( kf->numStrings < 0 || kf->strings < 0 ) {
+		Com_Error( ERR_DROP, "%s: bad demo index", __func__ );
+	}
+
+	s = demoIndex.strings + kf->strings;
+
+	for ( i = 0; i < kf->numStrings; i++ ) {
+		if ( s - demoIndex.strings >= demoIndex.stringsSize ) {
+			Com_Error( ERR_DROP, "%s: bad demo index", __func__ );
+		}
+		index = atoi( s );
+		value = strchr( s, ' ' );
+		if ( (unsigned) index >= MAX_CONFIGSTRINGS || !value ) {
+			Com_Error( ERR_DROP, "%s: bad demo index", __func__ );
+		}
+		CL_SetConfigstring( index, value + 1 );
+		s += strlen( s ) + 1;
+	}
+}
+
+
+/*
+====================
+CL_DemoTime
+
+Time since the first snapshot of the demo
+====================
+*/
+static int CL_DemoTime( void ) {
+	const demoKeyframe_t *kf;
+	int offset, i;
+
+	offset = FS_FTell( clc.demofile );
+
+	kf = demoIndex.keyframes;
+	for ( i = 1; i < demoIndex.numKeyframes; i++ ) {
+		if ( demoIndex.keyframes[ i ].offset >= offset ) {
+			break;
+		}
+		kf = &demoIndex.keyframes[ i ];
+	}
+
+	if ( !cl.snap.valid || cl.snap.serverTime - kf->serverTime < 0 ) {
+		return kf->demoTime;
+	}
+
+	return kf->demoTime + cl.snap.serverTime - kf->serverTime;
+}
+
+
+/*
+====================
+CL_DemoParseTime
+
+Accepts seconds or minutes:seconds
+====================
+*/
+static qboolean CL_DemoParseTime( const char *s, int *msec ) {
+	const char *p;
+	float sec;
+	int min;
+
+	if ( *s == '+' || *s == '-' ) {
+		s++;
+	}
+
+	for ( p = s; *p; p++ ) {
+		if ( !( *p >= '0' && *p <= '9' ) && *p != '.' && *p != ':' ) {
+			return qfalse;
+		}
+	}
+
+	p = strchr( s, ':' );
+	if ( p ) {
+		min = atoi( s );
+		sec = Q_atof( p + 1 );
+	} else {
+		min = 0;
+		sec = Q_atof( s );
+	}
+
+	*msec = min * 60000 + (int)( sec * 1000.0f );
+
+	return qtrue;
+}
+
+
+/*
+====================
+CL_DemoSeek_f
+
+demo_seek <[+|-]seconds|[+|-]mm:ss>
+====================
+*/
+void CL_DemoSeek_f( void ) {
+	char			arg[ MAX_TOKEN_CHARS ];
+	byte			data[ MAX_MSGLEN_BUF ];
+	msg_t			msg;
+	const demoKeyframe_t *kf, *k;
+	int				target, limit, sequence, i;
+
+	if ( Cmd_Argc() != 2 ) {
+		Com_Printf( "demo_seek <[+|-]seconds|[+|-]mm:ss>\n" );
+		return;
+	}
+
+	if ( !clc.demoplaying || clc.demofile == FS_INVALID_HANDLE || cls.state != CA_ACTIVE ) {
+		Com_Printf( "Not playing a demo.\n" );
+		return;
+	}
+
+	Q_strncpyz( arg, Cmd_Argv( 1 ), sizeof( arg ) );
+
+	if ( !CL_DemoParseTime( arg, &target ) ) {
+		Com_Printf( "Bad demo time: %s\n", arg );
+		return;
+	}
+
+	if ( !CL_DemoIndexLoad() ) {
+		return;
+	}
+
+	if ( arg[0] == '+' ) {
+		target = CL_DemoTime() + target;
+	} else if ( arg[0] == '-' ) {
+		target = CL_DemoTime() - target;
+	}
+
+	if ( target < 0 ) {
+		target = 0;
+	} else if ( target > demoIndex.duration ) {
+		target = demoIndex.duration;
+	}
+
+	// last keyframe before the target
+	kf = demoIndex.keyframes;
+	for ( i = 1; i < demoIndex.numKeyframes; i++ ) {
+		if ( demoIndex.keyframes[ i ].demoTime > target ) {
+			break;
+		}
+		kf = &demoIndex.keyframes[ i ];
+	}
+
+	// messages are parsed up to the next gamestate at most
+	limit = demoIndex.length;
+	for ( k = kf + 1; k < demoIndex.keyframes + demoIndex.numKeyframes; k++ ) {
+		if ( k->gamestate != kf->gamestate ) {
+			limit = k->gamestate;
+			break;
+		}
+	}
+
+	// a re-recorded demo can't continue from another point
+	if ( clc.demorecording ) {
+		CL_StopRecord_f();
+	}
+
+	Com_Printf( "Seeking to %i:%02i\n", target / 60000, ( target / 1000 ) % 60 );
+
+	// restore the gamestate
+	if ( FS_Seek( clc.demofile, kf->gamestate, FS_SEEK_SET ) != 0 || !CL_DemoReadMessage( clc.demofile, &msg, data, &sequence ) ) {
+		Com_Error( ERR_DROP, "%s: couldn't read gamestate", __func__ );
+	}
+
+	cls.state = CA_CONNECTED;
+
+	clc.serverMessageSequence = sequence;
+	CL_ParseDemoGamestate( &msg );
+
+	// and the configstrings changed up to the keyframe
+	for ( k = kf; k > demoIndex.keyframes && k[-1].gamestate == kf->gamestate; k-- )
+		;
+	for ( ; k <= kf; k++ ) {
+		CL_DemoIndexApply( k );
+	}
+
+	clc.serverCommandSequence = kf->commandSequence;
+	clc.lastExecutedServerCommand = kf->commandSequence;
+
+	if ( FS_Seek( clc.demofile, kf->offset, FS_SEEK_SET ) != 0 ) {
+		Com_Error( ERR_DROP, "%s: couldn't seek to keyframe", __func__ );
+	}
+
+	// parse the following messages without the cgame
+	while ( FS_FTell( clc.demofile ) < limit ) {
+		CL_ReadDemoMessage();
+		if ( clc.demofile == FS_INVALID_HANDLE ) {
+			return; // end of demo
+		}
+		CL_SkipServerCommands();
+		if ( cl.snap.valid && kf->demoTime + cl.snap.serverTime - kf->serverTime >= target ) {
+			break;
+		}
+	}
+
+	if ( !cl.snap.valid ) {
+		Com_Error( ERR_DROP, "%s: no valid snapshot at keyframe", __func__ );
+	}
+
+	// the cgame can't step back in time, restart it as for a new gamestate
+	clc.firstDemoFrameSkipped = qfalse;
+	CL_InitDownloads();
+}
@@ -47,6 +47,7 @@ typedef struct q_jpeg_error_mgr_s
 {
   struct jpeg_error_mgr pub;  /* "public" fields */
   jmp_buf setjmp_buffer;  /* for return to caller */
+  qboolean quiet;  /* don't print anything, may be running on a worker thread */
 }
 q_jpeg_error_mgr_t;
 
@@ -57,10 +58,11 @@ static void CL_JPGErrorExit(j_common_ptr cinfo)
   
 	/* cinfo->err really points to a q_jpeg_error_mgr_s struct, so coerce pointer */
 	q_jpeg_error_mgr_t *jerr = (q_jpeg_error_mgr_t *)cinfo->err;
-  
-	(*cinfo->err->format_message)( cinfo, buffer );
-  
-	Com_Printf( "Error: %s", buffer );
+
+	if ( !jerr->quiet ) {
+		(*cinfo->err->format_message)( cinfo, buffer );
+		Com_Printf( "Error: %s", buffer );
+	}
   
 	/* Return control to the setjmp point */
 	Q_longjmp( jerr->setjmp_buffer, 1 );
@@ -70,7 +72,10 @@ static void CL_JPGErrorExit(j_common_ptr cinfo)
 static void CL_JPGOutputMessage(j_common_ptr cinfo)
 {
   char buffer[JMSG_LENGTH_MAX];
-  
+
+  if ( ((q_jpeg_error_mgr_t *)cinfo->err)->quiet )
+    return;
+
   /* Create the message */
   (*cinfo->err->format_message) (cinfo, buffer);
   
@@ -79,7 +84,17 @@ static void CL_JPGOutputMessage(j_common_ptr cinfo)
 }
 
 
-void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *height )
+/*
+=================
+CL_DecodeJPGBuffer
+
+Returns qfalse if the image could not be decoded, error is set
+for malformed images that must abort the load. In quiet mode
+nothing is printed and warnings are treated as failures too.
+=================
+*/
+static qboolean CL_DecodeJPGBuffer( const char *filename, const byte *data, int len, unsigned char **pic, int *width, int *height,
+	char *error, int errorSize, qboolean quiet )
 {
 	/* This struct contains the JPEG decompression parameters and pointers to
 	* working space (which is allocated as needed by the JPEG library).
@@ -89,14 +104,6 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
 	* Note that this struct must live as long as the main JPEG parameter
 	* struct, to avoid dangling-pointer problems.
 	*/
-	/* This struct represents a JPEG error handler.  It is declared separately
-	 * because applications often want to supply a specialized error handler
-	 * (see the second half of this file for an example).  But here we just
-	 * take the easy way out and use the standard error handler, which will
-	 * print a message on stderr and call exit() if compression fails.
-	* Note that this struct must live as long as the main JPEG parameter
-	* struct, to avoid dangling-pointer problems.
-	*/
 	q_jpeg_error_mgr_t jerr;
 	/* More stuff */
 	JSAMPARRAY buffer;		/* Output row buffer */
@@ -104,23 +111,9 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
 	unsigned int pixelcount, memcount;
 	unsigned int sindex, dindex;
 	byte *out;
-	int len;
-	union {
-		byte *b;
-		void *v;
-	} fbuffer;
 	byte  *buf;
 
-	/* In this example we want to open the input file before doing anything else,
-	 * so that the setjmp() error recovery below can assume the file is open.
-	 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-	 * requires it in order to read binary files.
-	*/
-
-	len = FS_ReadFile( ( char * ) filename, &fbuffer.v );
-	if ( !fbuffer.b || len < 0 ) {
-		return;
-	}
+	error[0] = '\0';
 
 	/* Step 1: allocate and initialize JPEG decompression object */
 
@@ -132,19 +125,20 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
 	cinfo.err = jpeg_std_error(&jerr.pub);
 	cinfo.err->error_exit = CL_JPGErrorExit;
 	cinfo.err->output_message = CL_JPGOutputMessage;
+	jerr.quiet = quiet;
 
 	/* Establish the setjmp return context for R_JPGErrorExit to use. */
 	if ( Q_setjmp( jerr.setjmp_buffer ) )
 	{
 		/* If we get here, the JPEG code has signaled an error.
-		* We need to clean up the JPEG object, close the input file, and return.
+		* We need to clean up the JPEG object and return.
 		*/
 		jpeg_destroy_decompress( &cinfo );
-		FS_FreeFile( fbuffer.v );
 
 		/* Append the filename to the error for easier debugging */
-		Com_Printf( ", loading file %s\n", filename );
-		return;
+		if ( !quiet )
+			Com_Printf( ", loading file %s\n", filename );
+		return qfalse;
 	}
 
   /* Now we can initialize the JPEG decompression object. */
@@ -152,7 +146,7 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
 
   /* Step 2: specify data source (eg, a file) */
 
-  jpeg_mem_src(&cinfo, fbuffer.b, len);
+  jpeg_mem_src(&cinfo, (byte *)data, len);
 
   /* Step 3: read file parameters with jpeg_read_header() */
 
@@ -193,12 +187,12 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
       || pixelcount > 0x1FFFFFFF || cinfo.output_components != 3
     )
   {
+    Com_sprintf( error, errorSize, "LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", filename,
+		    cinfo.output_width, cinfo.output_height, pixelcount * 4, cinfo.output_components);
+
     // Free the memory to make sure we don't leak memory
-    FS_FreeFile( fbuffer.v );
     jpeg_destroy_decompress(&cinfo);
-  
-    Com_Error( ERR_DROP, "LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", filename,
-		    cinfo.output_width, cinfo.output_height, pixelcount * 4, cinfo.output_components);
+    return qfalse;
   }
 
   memcount = pixelcount * 4;
@@ -253,18 +247,75 @@ void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *hei
   /* This is an important step since it will release a good deal of memory. */
   jpeg_destroy_decompress(&cinfo);
 
-  /* After finish_decompress, we can close the input file.
-   * Here we postpone it until after no more JPEG errors are possible,
-   * so as to simplify the setjmp error logic above.  (Actually, I don't
-   * think that jpeg_destroy can do an error exit, but why assume anything...)
-   */
-  FS_FreeFile( fbuffer.v );
-
-  /* At this point you may want to check to see whether any corrupt-data
-   * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
+  /* Warnings have not been printed in quiet mode, let the caller
+   * load the image again with CL_LoadJPG so that they are shown.
    */
+  if ( quiet && jerr.pub.num_warnings ) {
+    Z_Free( out );
+    *pic = NULL;
+    return qfalse;
+  }
 
   /* And we're done! */
+  return qtrue;
+}
+
+
+/*
+=================
+CL_LoadJPG
+=================
+*/
+void CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *height )
+{
+	char error[MAX_STRING_CHARS];
+	int len;
+	union {
+		byte *b;
+		void *v;
+	} fbuffer;
+
+	/* In this example we want to open the input file before doing anything else,
+	 * so that the setjmp() error recovery below can assume the file is open.
+	 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
+	 * requires it in order to read binary files.
+	*/
+
+	len = FS_ReadFile( ( char * ) filename, &fbuffer.v );
+	if ( !fbuffer.b || len < 0 ) {
+		return;
+	}
+
+	if ( !CL_DecodeJPGBuffer( filename, fbuffer.b, len, pic, width, height, error, sizeof( error ), qfalse ) ) {
+		FS_FreeFile( fbuffer.v );
+		if ( error[0] ) {
+			Com_Error( ERR_DROP, "%s", error );
+		}
+		return;
+	}
+
+	FS_FreeFile( fbuffer.v );
+}
+
+
+/*
+=================
+CL_DecodeJPG
+
+Decodes a JPEG file that has already been read into memory,
+does not print anything so it may be called from worker threads
+=================
+*/
+void CL_DecodeJPG( const char *filename, const byte *data, int len, unsigned char **pic, int *width, int *height )
+{
+	char error[MAX_STRING_CHARS];
+
+	*pic = NULL;
+
+	if ( !CL_DecodeJPGBuffer( filename, data, len, pic, width, height, error, sizeof( error ), qtrue ) && *pic ) {
+		Z_Free( *pic );
+		*pic = NULL;
+	}
 }
 
 
@@ -321,7 +372,11 @@ init_destination (j_compress_ptr cinfo)
 static boolean empty_output_buffer( j_compress_ptr cinfo )
 {
   my_dest_ptr dest = (my_dest_ptr) cinfo->dest;
-  
+
+  // quiet callers get a failed encode instead
+  if ( ((q_jpeg_error_mgr_t *)cinfo->err)->quiet )
+    (*cinfo->err->error_exit)( (j_common_ptr) cinfo );
+
   jpeg_destroy_compress(cinfo);
   
   // Make crash fatal or we would probably leak memory.
@@ -377,14 +432,15 @@ static void jpegDest (j_compress_ptr cinfo, byte* outfile, int size)
 
 /*
 =================
-SaveJPGToBuffer
+CL_EncodeJPGBuffer
 
 Encodes JPEG from image in image_buffer and writes to buffer.
-Expects RGB input data
+Expects RGB input data. In quiet mode nothing is printed and
+a buffer overflow returns 0 instead of a fatal error.
 =================
 */
-size_t CL_SaveJPGToBuffer(byte *buffer, size_t bufSize, int quality,
-    int image_width, int image_height, byte *image_buffer, int padding)
+static size_t CL_EncodeJPGBuffer( byte *buffer, size_t bufSize, int quality,
+    int image_width, int image_height, byte *image_buffer, int padding, qboolean quiet )
 {
   struct jpeg_compress_struct cinfo;
   q_jpeg_error_mgr_t jerr;
@@ -397,6 +453,7 @@ size_t CL_SaveJPGToBuffer(byte *buffer, size_t bufSize, int quality,
   cinfo.err = jpeg_std_error(&jerr.pub);
   cinfo.err->error_exit = CL_JPGErrorExit;
   cinfo.err->output_message = CL_JPGOutputMessage;
+  jerr.quiet = quiet;
 
   /* Establish the setjmp return context for R_JPGErrorExit to use. */
   if ( Q_setjmp( jerr.setjmp_buffer ) )
@@ -406,7 +463,8 @@ size_t CL_SaveJPGToBuffer(byte *buffer, size_t bufSize, int quality,
      */
     jpeg_destroy_compress( &cinfo );
 
-    Com_Printf( "\n" );
+    if ( !quiet )
+      Com_Printf( "\n" );
     return 0;
   }
 
@@ -462,6 +520,33 @@ size_t CL_SaveJPGToBuffer(byte *buffer, size_t bufSize, int quality,
 }
 
 
+/*
+=================
+CL_SaveJPGToBuffer
+=================
+*/
+size_t CL_SaveJPGToBuffer( byte *buffer, size_t bufSize, int quality,
+    int image_width, int image_height, byte *image_buffer, int padding )
+{
+	return CL_EncodeJPGBuffer( buffer, bufSize, quality, image_width, image_height, image_buffer, padding, qfalse );
+}
+
+
+/*
+=================
+CL_EncodeJPG
+
+Same as CL_SaveJPGToBuffer but returns 0 on failure and
+does not print anything so it may be called from worker threads
+=================
+*/
+size_t CL_EncodeJPG( byte *buffer, size_t bufSize, int quality,
+    int image_width, int image_height, byte *image_buffer, int padding )
+{
+	return CL_EncodeJPGBuffer( buffer, bufSize, quality, image_width, image_height, image_buffer, padding, qtrue );
+}
+
+
 void CL_SaveJPG( const char *filename, int quality, int image_width, int image_height, byte *image_buffer, int padding )
 {
 	byte *out;
@@ -42,12 +42,14 @@ cvar_t	*cl_showTimeDelta;
 
 cvar_t	*cl_shownet;
 cvar_t	*cl_autoRecordDemo;
+cvar_t	*cl_demoKeyframe;
 cvar_t	*cl_drawRecording;
 
 cvar_t	*cl_aviFrameRate;
 cvar_t	*cl_aviMotionJpeg;
 cvar_t	*cl_forceavidemo;
 cvar_t	*cl_aviPipeFormat;
+cvar_t	*cl_aviThread;
 
 cvar_t	*cl_activeAction;
 
@@ -154,6 +156,7 @@ static void CL_ShutdownRef( refShutdownCode_t code );
 static void CL_InitGLimp_Cvars( void );
 
 static void CL_NextDemo( void );
+static void CL_WriteKeyframe( void );
 
 /*
 ===============
@@ -217,6 +220,24 @@ CLIENT SIDE DEMO RECORDING
 =======================================================================
 */
 
+/*
+====================
+CL_DemoKeyframeDue
+====================
+*/
+static qboolean CL_DemoKeyframeDue( int serverTime ) {
+	int delta;
+
+	if ( cl_demoKeyframe->integer <= 0 ) {
+		return qfalse;
+	}
+
+	delta = serverTime - clc.demoKeyframeTime;
+
+	return ( delta < 0 || delta >= cl_demoKeyframe->integer * 1000 );
+}
+
+
 /*
 ====================
 CL_WriteDemoMessage
@@ -227,6 +248,14 @@ Dumps the current net message, prefixed by the length
 static void CL_WriteDemoMessage( msg_t *msg, int headerBytes ) {
 	int		len, swlen;
 
+	if ( clc.eventMask & EM_SNAPSHOT ) {
+		if ( cl.snap.deltaNum <= 0 ) {
+			clc.demoKeyframeTime = cl.snap.serverTime;
+		} else if ( CL_DemoKeyframeDue( cl.snap.serverTime ) ) {
+			CL_WriteKeyframe();
+		}
+	}
+
 	// write the packet sequence
 	len = clc.serverMessageSequence;
 	swlen = LittleLong( len );
@@ -478,6 +507,69 @@ static void CL_EmitPacketEntities( clSnapshot_t *from, clSnapshot_t *to, msg_t *
 }
 
 
+/*
+====================
+CL_WriteKeyframe
+
+Net messages are delta compressed against frames that may be a few
+messages old, so a seek point in a live recording resends every frame
+the next messages can refer to, the first one uncompressed.  Playback
+keeps them only for delta decoding
+====================
+*/
+static void CL_WriteKeyframe( void ) {
+	static entityState_t oldents[ MAX_SNAPSHOT_ENTITIES ];
+
+	clSnapshot_t *snap, *oldSnap;
+	byte	bufData[ MAX_MSGLEN_BUF ];
+	msg_t	msg;
+	int		n, i, len;
+
+	oldSnap = NULL;
+
+	for ( n = cl.snap.deltaNum; n != cl.snap.messageNum; n++ ) {
+		snap = &cl.snapshots[ n & PACKET_MASK ];
+		if ( !snap->valid || snap->messageNum != n ) {
+			continue; // dropped, the server can't delta from it
+		}
+
+		MSG_Init( &msg, bufData, MAX_MSGLEN );
+		MSG_Bitstream( &msg );
+
+		MSG_WriteLong( &msg, clc.reliableSequence );
+
+		MSG_WriteByte( &msg, svc_snapshot );
+		MSG_WriteLong( &msg, snap->serverTime );
+		MSG_WriteByte( &msg, oldSnap ? n - oldSnap->messageNum : 0 );
+		MSG_WriteByte( &msg, snap->snapFlags );
+		MSG_WriteByte( &msg, snap->areabytes );
+		MSG_WriteData( &msg, snap->areamask, snap->areabytes );
+		if ( oldSnap )
+			MSG_WriteDeltaPlayerstate( &msg, &oldSnap->ps, &snap->ps );
+		else
+			MSG_WriteDeltaPlayerstate( &msg, NULL, &snap->ps );
+
+		CL_EmitPacketEntities( oldSnap, snap, &msg, oldents );
+
+		MSG_WriteByte( &msg, svc_EOF );
+
+		len = LittleLong( n );
+		FS_Write( &len, 4, clc.recordfile );
+
+		len = LittleLong( msg.cursize );
+		FS_Write( &len, 4, clc.recordfile );
+		FS_Write( msg.data, msg.cursize, clc.recordfile );
+
+		for ( i = 0; i < snap->numEntities; i++ )
+			oldents[ i ] = cl.parseEntities[ (snap->parseEntitiesNum + i) % MAX_PARSE_ENTITIES ];
+
+		oldSnap = snap;
+	}
+
+	clc.demoKeyframeTime = cl.snap.serverTime;
+}
+
+
 /*
 ====================
 CL_WriteSnapshot
@@ -497,8 +589,14 @@ static void CL_WriteSnapshot( void ) {
 	//if ( !snap->valid ) // should never happen?
 	//	return;
 
+	// periodic uncompressed snapshots are seek points for demo_seek
+	if ( clc.demoDeltaNum && CL_DemoKeyframeDue( snap->serverTime ) ) {
+		clc.demoDeltaNum = 0;
+	}
+
 	if ( clc.demoDeltaNum == 0 ) {
 		oldSnap = NULL;
+		clc.demoKeyframeTime = snap->serverTime;
 	} else {
 		oldSnap = &saved_snap;
 	}
@@ -858,6 +956,7 @@ static void CL_PlayDemo_f( void ) {
 	char		retry[MAX_OSPATH];
 	const char	*shortname, *slash;
 	fileHandle_t hFile;
+	int			length;
 
 	if ( Cmd_Argc() != 2 ) {
 		Com_Printf( "demo <demoname>\n" );
@@ -920,7 +1019,8 @@ static void CL_PlayDemo_f( void ) {
 	CL_Disconnect( qtrue );
 
 	// clc.demofile will be closed during CL_Disconnect so reopen it
-	if ( FS_FOpenFileRead( name, &clc.demofile, qtrue ) == -1 )
+	length = FS_FOpenFileRead( name, &clc.demofile, qtrue );
+	if ( length == -1 )
 	{
 		// drop this time
 		Com_Error( ERR_DROP, "couldn't open %s\n", name );
@@ -934,6 +1034,8 @@ static void CL_PlayDemo_f( void ) {
 
 	Q_strncpyz( clc.demoName, shortname, sizeof( clc.demoName ) );
 
+	CL_DemoIndexOpen( name, length );
+
 	Con_Close();
 
 	cls.state = CA_CONNECTED;
@@ -1225,6 +1327,7 @@ qboolean CL_Disconnect( qboolean showMainMenu ) {
 		FS_FCloseFile( clc.demofile );
 		clc.demofile = FS_INVALID_HANDLE;
 	}
+	CL_DemoIndexClose();
 
 	// Finish downloads
 	if ( clc.download != FS_INVALID_HANDLE ) {
@@ -2438,8 +2541,8 @@ typedef struct hash_chain_s {
 	struct hash_chain_s *next;
 } hash_chain_t;
 
-static hash_chain_t *hash_table[1024];
-static hash_chain_t hash_list[MAX_GLOBAL_SERVERS];
+static hash_chain_t *hash_table[4096];
+static hash_chain_t hash_list[MAX_GLOBAL_SERVERS + MAX_GLOBAL_SERVER_ADDRESSES];
 static unsigned int hash_count = 0;
 
 static unsigned int hash_func( const netadr_t *addr ) {
@@ -2462,14 +2565,14 @@ static unsigned int hash_func( const netadr_t *addr ) {
 
 	hash = hash ^ ( hash >> 16 );
 
-	return (hash & 1023);
+	return (hash & 4095);
 }
 
 static void hash_insert( const netadr_t *addr )
 {
 	hash_chain_t **tab, *cur;
 	unsigned int hash;
-	if ( hash_count >= MAX_GLOBAL_SERVERS )
+	if ( hash_count >= ARRAY_LEN( hash_list ) )
 		return;
 	hash = hash_func( addr );
 	tab = &hash_table[ hash ];
@@ -2522,6 +2625,7 @@ static void CL_ServersResponsePacket( const netadr_t* from, msg_t *msg, qboolean
 		cls.numglobalservers = 0;
 		cls.numGlobalServerAddresses = 0;
 		hash_reset();
+		CL_BrowserReset();
 	}
 
 	// parse through server response string
@@ -2589,7 +2693,7 @@ static void CL_ServersResponsePacket( const netadr_t* from, msg_t *msg, qboolean
 
 	count = cls.numglobalservers;
 
-	for (i = 0; i < numservers && count < MAX_GLOBAL_SERVERS; i++) {
+	for (i = 0; i < numservers; i++) {
 
 		// Tequila: It's possible to have sent many master server requests. Then
 		// we may receive many times the same addresses from the master server.
@@ -2597,25 +2701,25 @@ static void CL_ServersResponsePacket( const netadr_t* from, msg_t *msg, qboolean
 		if ( hash_find( &addresses[i] ) )
 			continue;
 
-		hash_insert( &addresses[i] );
-
-		// build net address
-		server = &cls.globalServers[count];
-
-		CL_InitServerInfo( server, &addresses[i] );
-		// advance to next slot
-		count++;
-	}
+		if ( count < MAX_GLOBAL_SERVERS ) {
+			// build net address
+			server = &cls.globalServers[count];
 
-	// if getting the global list
-	if ( count >= MAX_GLOBAL_SERVERS && cls.numGlobalServerAddresses < MAX_GLOBAL_SERVERS )
-	{
-		// if we couldn't store the servers in the main list anymore
-		for (; i < numservers && cls.numGlobalServerAddresses < MAX_GLOBAL_SERVERS; i++)
-		{
+			CL_InitServerInfo( server, &addresses[i] );
+			// advance to next slot
+			count++;
+		} else if ( cls.numGlobalServerAddresses < MAX_GLOBAL_SERVER_ADDRESSES ) {
+			// if we couldn't store the servers in the main list anymore
 			// just store the addresses in an additional list
 			cls.globalServerAddresses[cls.numGlobalServerAddresses++] = addresses[i];
+		} else {
+			break;
 		}
+
+		hash_insert( &addresses[i] );
+
+		// start querying it right away, results reach the lists as they arrive
+		CL_BrowserQueue( &addresses[i] );
 	}
 
 	cls.numglobalservers = count;
@@ -3133,6 +3237,9 @@ void CL_Frame( int msec, int realMsec ) {
 	// resend a connection request if necessary
 	CL_CheckForResend();
 
+	// send and time out server browser queries
+	CL_BrowserFrame();
+
 	// decide on the serverTime to render
 	CL_SetCGameTime();
 
@@ -3454,6 +3561,10 @@ static void CL_InitRef( void ) {
 	rimp.FS_ListFiles = FS_ListFiles;
 	//rimp.FS_FileIsInPAK = FS_FileIsInPAK;
 	rimp.FS_FileExists = FS_FileExists;
+	rimp.FS_FileStamp = FS_FileStamp;
+	rimp.FS_LocateFile = FS_LocateFile;
+	rimp.FS_ReadLocatedFile = FS_ReadLocatedFile;
+	rimp.FS_FreeLocation = FS_FreeLocation;
 
 	rimp.Cvar_Get = Cvar_Get;
 	rimp.Cvar_Set = Cvar_Set;
@@ -3474,10 +3585,11 @@ static void CL_InitRef( void ) {
 	rimp.CIN_PlayCinematic = CIN_PlayCinematic;
 	rimp.CIN_RunCinematic = CIN_RunCinematic;
 
-	rimp.CL_WriteAVIVideoFrame = CL_WriteAVIVideoFrame;
+	rimp.CL_QueueAVIVideoFrame = CL_QueueAVIVideoFrame;
 	rimp.CL_SaveJPGToBuffer = CL_SaveJPGToBuffer;
 	rimp.CL_SaveJPG = CL_SaveJPG;
 	rimp.CL_LoadJPG = CL_LoadJPG;
+	rimp.CL_DecodeJPG = CL_DecodeJPG;
 
 	rimp.CL_IsMinimized = CL_IsMininized;
 	rimp.CL_SetScaling = CL_SetScaling;
@@ -3486,6 +3598,17 @@ static void CL_InitRef( void ) {
 	rimp.Sys_LowPhysicalMemory = Sys_LowPhysicalMemory;
 	rimp.Com_RealTime = Com_RealTime;
 
+	rimp.Sys_CreateThread = Sys_CreateThread;
+	rimp.Sys_JoinThread = Sys_JoinThread;
+	rimp.Sys_NumCPUs = Sys_NumCPUs;
+	rimp.Sys_Sleep = Sys_Sleep;
+	rimp.Sys_CreateSemaphore = Sys_CreateSemaphore;
+	rimp.Sys_DestroySemaphore = Sys_DestroySemaphore;
+	rimp.Sys_PostSemaphore = Sys_PostSemaphore;
+	rimp.Sys_WaitSemaphore = Sys_WaitSemaphore;
+
+	rimp.Com_CPUFlags = Com_CPUFlags;
+
 	rimp.GLimp_InitGamma = GLimp_InitGamma;
 	rimp.GLimp_SetGamma = GLimp_SetGamma;
 
@@ -3495,6 +3618,7 @@ static void CL_InitRef( void ) {
 	rimp.GLimp_Shutdown = GLimp_Shutdown;
 	rimp.GL_GetProcAddress = GL_GetProcAddress;
 	rimp.GLimp_EndFrame = GLimp_EndFrame;
+	rimp.GLimp_MakeCurrent = GLimp_MakeCurrent;
 #endif
 
 	// Vulkan API
@@ -3927,6 +4051,9 @@ void CL_Init( void ) {
 	Cvar_SetDescription( cl_autoRecordDemo, "Auto-record demos when starting or joining a game." );
 	cl_drawRecording = Cvar_Get("cl_drawRecording", "1", CVAR_ARCHIVE);
 	Cvar_SetDescription( cl_drawRecording, "Hide (0) or shorten (1) \"RECORDING\" HUD message when recording demo." );
+	cl_demoKeyframe = Cvar_Get( "cl_demoKeyframe", "10", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( cl_demoKeyframe, "0", "600", CV_INTEGER );
+	Cvar_SetDescription( cl_demoKeyframe, "Seconds between seek points written into recorded demos, used by \\demo_seek.\n 0: Only at level start" );
 
 	cl_aviFrameRate = Cvar_Get ("cl_aviFrameRate", "25", CVAR_ARCHIVE);
 	Cvar_CheckRange( cl_aviFrameRate, "1", "1000", CV_INTEGER );
@@ -3941,6 +4068,9 @@ void CL_Init( void ) {
 		"-bf 2 -c:a aac -strict -2 -b:a 160k -movflags faststart",
 		CVAR_ARCHIVE );
 	Cvar_SetDescription( cl_aviPipeFormat, "Encoder parameters used for \\video-pipe." );
+	cl_aviThread = Cvar_Get( "cl_aviThread", "1", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( cl_aviThread, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( cl_aviThread, "Encode captured video frames on a background thread. Takes effect when the next \\video is started." );
 
 	rconAddress = Cvar_Get ("rconAddress", "", 0);
 	Cvar_SetDescription( rconAddress, "The IP address of the remote console you wish to connect to." );
@@ -3983,6 +4113,8 @@ void CL_Init( void ) {
 	Cvar_CheckRange( cv, "100", "999", CV_INTEGER );
 	Cvar_SetDescription( cv, "Specify the maximum allowed ping to a server." );
 
+	CL_BrowserInit();
+
 	cl_lanForcePackets = Cvar_Get( "cl_lanForcePackets", "1", CVAR_ARCHIVE_ND );
 	Cvar_SetDescription( cl_lanForcePackets, "Bypass \\cl_maxpackets for LAN games, send packets every frame." );
 
@@ -4052,6 +4184,7 @@ void CL_Init( void ) {
 	Cmd_SetCommandCompletionFunc( "record", CL_CompleteRecordName );
 	Cmd_AddCommand ("demo", CL_PlayDemo_f);
 	Cmd_SetCommandCompletionFunc( "demo", CL_CompleteDemoName );
+	Cmd_AddCommand ("demo_seek", CL_DemoSeek_f);
 	Cmd_AddCommand ("cinematic", CL_PlayCinematic_f);
 	Cmd_AddCommand ("stoprecord", CL_StopRecord_f);
 	Cmd_AddCommand ("connect", CL_Connect_f);
@@ -4136,6 +4269,7 @@ void CL_Shutdown( const char *finalmsg, qboolean quit ) {
 	Cmd_RemoveCommand ("disconnect");
 	Cmd_RemoveCommand ("record");
 	Cmd_RemoveCommand ("demo");
+	Cmd_RemoveCommand ("demo_seek");
 	Cmd_RemoveCommand ("cinematic");
 	Cmd_RemoveCommand ("stoprecord");
 	Cmd_RemoveCommand ("connect");
@@ -4171,6 +4305,7 @@ void CL_Shutdown( const char *finalmsg, qboolean quit ) {
 	recursive = qfalse;
 
 	Com_Memset( &cls, 0, sizeof( cls ) );
+	CL_BrowserReset();
 	Key_SetCatcher( 0 );
 	Com_Printf( "-----------------------\n" );
 }
@@ -4197,7 +4332,7 @@ static void CL_SetServerInfo(serverInfo_t *server, const char *info, int ping) {
 }
 
 
-static void CL_SetServerInfoByAddress(const netadr_t *from, const char *info, int ping) {
+void CL_SetServerInfoByAddress(const netadr_t *from, const char *info, int ping) {
 	int i;
 
 	for (i = 0; i < MAX_OTHER_SERVERS; i++) {
@@ -4206,7 +4341,7 @@ static void CL_SetServerInfoByAddress(const netadr_t *from, const char *info, in
 		}
 	}
 
-	for (i = 0; i < MAX_GLOBAL_SERVERS; i++) {
+	for (i = 0; i < cls.numglobalservers && i < MAX_GLOBAL_SERVERS; i++) {
 		if (NET_CompareAdr(from, &cls.globalServers[i].adr)) {
 			CL_SetServerInfo(&cls.globalServers[i], info, ping);
 		}
@@ -4220,16 +4355,48 @@ static void CL_SetServerInfoByAddress(const netadr_t *from, const char *info, in
 }
 
 
+/*
+===================
+CL_SetPingNetType
+
+Tacks the net type on the info string of a ping slot
+===================
+*/
+static void CL_SetPingNetType( ping_t *ping ) {
+	int		type;
+
+	// NOTE: make sure these types are in sync with the netnames strings in the UI
+	switch (ping->adr.type)
+	{
+		case NA_BROADCAST:
+		case NA_IP:
+			type = 1;
+			break;
+#ifdef USE_IPV6
+		case NA_IP6:
+			type = 2;
+			break;
+#endif
+		default:
+			type = 0;
+			break;
+	}
+
+	Info_SetValueForKey( ping->info, "nettype", va( "%d", type ) );
+}
+
+
 /*
 ===================
 CL_ServerInfoPacket
 ===================
 */
 static void CL_ServerInfoPacket( const netadr_t *from, msg_t *msg ) {
-	int		i, type, len;
+	int		i, len;
 	char	info[MAX_INFO_STRING];
 	const char *infoString;
 	int		prot;
+	int		pingTime;
 
 	infoString = MSG_ReadString( msg );
 
@@ -4240,6 +4407,9 @@ static void CL_ServerInfoPacket( const netadr_t *from, msg_t *msg ) {
 		return;
 	}
 
+	// the server browser and the ping slots may be waiting for the same answer
+	pingTime = CL_BrowserResponse( from, infoString );
+
 	// iterate servers waiting for ping response
 	for (i=0; i<MAX_PINGREQUESTS; i++)
 	{
@@ -4260,30 +4430,19 @@ static void CL_ServerInfoPacket( const netadr_t *from, msg_t *msg ) {
 			Q_strncpyz( cl_pinglist[i].info, infoString, sizeof( cl_pinglist[i].info ) );
 
 			// tack on the net type
-			// NOTE: make sure these types are in sync with the netnames strings in the UI
-			switch (from->type)
-			{
-				case NA_BROADCAST:
-				case NA_IP:
-					type = 1;
-					break;
-#ifdef USE_IPV6
-				case NA_IP6:
-					type = 2;
-					break;
-#endif
-				default:
-					type = 0;
-					break;
-			}
-
-			Info_SetValueForKey( cl_pinglist[i].info, "nettype", va( "%d", type ) );
-			CL_SetServerInfoByAddress( from, infoString, cl_pinglist[i].time );
+			CL_SetPingNetType( &cl_pinglist[i] );
 
-			return;
+			if ( !pingTime )
+				pingTime = cl_pinglist[i].time;
+			break;
 		}
 	}
 
+	if ( pingTime ) {
+		CL_SetServerInfoByAddress( from, infoString, pingTime );
+		return;
+	}
+
 	// if not just sent a local broadcast or pinging local servers
 	if (cls.pingUpdateSource != AS_LOCAL) {
 		return;
@@ -4868,6 +5027,15 @@ static void CL_Ping_f( void ) {
 	pingptr = CL_GetFreePing();
 
 	memcpy( &pingptr->adr, &to, sizeof (netadr_t) );
+
+	// the server browser may have queried it already
+	if ( CL_BrowserLookup( &to, pingptr ) ) {
+		if ( pingptr->time ) {
+			CL_SetPingNetType( pingptr );
+		}
+		return;
+	}
+
 	pingptr->start = Sys_Milliseconds();
 	pingptr->time  = 0;
 
@@ -4920,6 +5088,12 @@ qboolean CL_UpdateVisiblePings_f(int source) {
 				if (server[i].ping == -1) {
 					int j;
 
+					// leave it to the server browser if it has room
+					if ( CL_BrowserQueue( &server[i].adr ) ) {
+						status = qtrue;
+						continue;
+					}
+
 					if (slots >= MAX_PINGREQUESTS) {
 						break;
 					}
@@ -4964,7 +5138,7 @@ qboolean CL_UpdateVisiblePings_f(int source) {
 		}
 	}
 
-	if (slots) {
+	if (slots || CL_BrowserBusy()) {
 		status = qtrue;
 	}
 	for (i = 0; i < MAX_PINGREQUESTS; i++) {
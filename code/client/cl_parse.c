@@ -287,6 +287,13 @@ static void CL_ParseSnapshot( msg_t *msg ) {
 		return;
 	}
 
+	// demo keyframes resend frames that were already parsed, keep
+	// them for delta decoding but don't step back the current frame
+	if ( cl.snap.valid && newSnap.messageNum - cl.snap.messageNum <= 0 ) {
+		cl.snapshots[ newSnap.messageNum & PACKET_MASK ] = newSnap;
+		return;
+	}
+
 	// clear the valid flags of any snapshots between the last
 	// received and this one, so if there was a dropped packet
 	// it won't look like something valid to delta from next
@@ -495,44 +502,22 @@ static void CL_ParseServerInfo( void )
 
 /*
 ==================
-CL_ParseGamestate
+CL_ParseGamestateData
+
+Reads the configstrings and baselines of a gamestate into the cleared
+client state, followed by the client number and checksum feed
 ==================
 */
-static void CL_ParseGamestate( msg_t *msg ) {
+static void CL_ParseGamestateData( msg_t *msg ) {
 	int				i;
 	entityState_t	*es;
 	int				newnum;
 	entityState_t	nullstate;
 	int				cmd;
 	const char		*s;
-	char			oldGame[ MAX_QPATH ];
-	char			reconnectArgs[ MAX_CVAR_VALUE_STRING ];
-	char			allowDownload[ MAX_CVAR_VALUE_STRING ];
-	qboolean		gamedirModified;
-
-	Con_Close();
-
-	clc.connectPacketCount = 0;
 
 	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
 
-	// clear old error message
-	Cvar_Set( "com_errorMessage", "" );
-
-	// wipe local client state
-	CL_ClearState();
-
-	// all configstring updates received before new gamestate must be discarded
-	for ( i = 0; i < MAX_RELIABLE_COMMANDS; i++ ) {
-		s = clc.serverCommands[ i ];
-		if ( !strncmp( s, "cs ", 3 ) || !strncmp( s, "bcs0 ", 5 ) || !strncmp( s, "bcs1 ", 5 ) || !strncmp( s, "bcs2 ", 5 ) ) {
-			clc.serverCommandsIgnore[ i ] = qtrue;
-		}
-	}
-
-	// a gamestate always marks a server command sequence
-	clc.serverCommandSequence = MSG_ReadLong( msg );
-
 	// parse all the configstrings and baselines
 	cl.gameState.dataCount = 1;	// leave a 0 at the beginning for uninitialized configstrings
 	while ( 1 ) {
@@ -581,11 +566,49 @@ static void CL_ParseGamestate( msg_t *msg ) {
 		}
 	}
 
-	clc.eventMask |= EM_GAMESTATE;
-
 	clc.clientNum = MSG_ReadLong(msg);
 	// read the checksum feed
 	clc.checksumFeed = MSG_ReadLong( msg );
+}
+
+
+/*
+==================
+CL_ParseGamestate
+==================
+*/
+static void CL_ParseGamestate( msg_t *msg ) {
+	int				i;
+	const char		*s;
+	char			oldGame[ MAX_QPATH ];
+	char			reconnectArgs[ MAX_CVAR_VALUE_STRING ];
+	char			allowDownload[ MAX_CVAR_VALUE_STRING ];
+	qboolean		gamedirModified;
+
+	Con_Close();
+
+	clc.connectPacketCount = 0;
+
+	// clear old error message
+	Cvar_Set( "com_errorMessage", "" );
+
+	// wipe local client state
+	CL_ClearState();
+
+	// all configstring updates received before new gamestate must be discarded
+	for ( i = 0; i < MAX_RELIABLE_COMMANDS; i++ ) {
+		s = clc.serverCommands[ i ];
+		if ( !strncmp( s, "cs ", 3 ) || !strncmp( s, "bcs0 ", 5 ) || !strncmp( s, "bcs1 ", 5 ) || !strncmp( s, "bcs2 ", 5 ) ) {
+			clc.serverCommandsIgnore[ i ] = qtrue;
+		}
+	}
+
+	// a gamestate always marks a server command sequence
+	clc.serverCommandSequence = MSG_ReadLong( msg );
+
+	CL_ParseGamestateData( msg );
+
+	clc.eventMask |= EM_GAMESTATE;
 
 	// save old gamedir
 	Cvar_VariableStringBuffer( "fs_game", oldGame, sizeof( oldGame ) );
@@ -639,6 +662,48 @@ static void CL_ParseGamestate( msg_t *msg ) {
 }
 
 
+/*
+==================
+CL_ParseDemoGamestate
+
+Restores the gamestate from a demo message without loading anything,
+server commands in front of it are skipped
+==================
+*/
+void CL_ParseDemoGamestate( msg_t *msg ) {
+	int cmd;
+
+	MSG_Bitstream( msg );
+
+	// reliable sequence acknowledge
+	MSG_ReadLong( msg );
+
+	while ( 1 ) {
+		cmd = MSG_ReadByte( msg );
+
+		if ( cmd == svc_gamestate ) {
+			break;
+		}
+
+		if ( cmd == svc_serverCommand ) {
+			MSG_ReadLong( msg );
+			MSG_ReadString( msg );
+		} else if ( cmd != svc_nop ) {
+			Com_Error( ERR_DROP, "%s: gamestate expected", __func__ );
+		}
+	}
+
+	CL_ClearState();
+
+	clc.serverCommandSequence = MSG_ReadLong( msg );
+
+	CL_ParseGamestateData( msg );
+
+	// parse serverId
+	CL_SystemInfoChanged( qtrue );
+}
+
+
 /*
 =====================
 CL_ValidPakSignature
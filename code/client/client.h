@@ -256,6 +256,7 @@ typedef struct {
 	int		demoCommandSequence;
 	int		demoDeltaNum;
 	int		demoMessageSequence;
+	int		demoKeyframeTime;	// server time of the last uncompressed snapshot written
 
 } clientConnection_t;
 
@@ -295,6 +296,9 @@ typedef struct {
 	int			g_needpass;
 } serverInfo_t;
 
+// master server addresses that don't fit into globalServers
+#define MAX_GLOBAL_SERVER_ADDRESSES	( MAX_GLOBAL_SERVERS * 4 )
+
 typedef struct {
 	connstate_t	state;				// connection status
 	qboolean	gameSwitch;
@@ -323,7 +327,7 @@ typedef struct {
 	serverInfo_t  globalServers[MAX_GLOBAL_SERVERS];
 	// additional global servers
 	int			numGlobalServerAddresses;
-	netadr_t		globalServerAddresses[MAX_GLOBAL_SERVERS];
+	netadr_t		globalServerAddresses[MAX_GLOBAL_SERVER_ADDRESSES];
 
 	int			numfavoriteservers;
 	serverInfo_t	favoriteServers[MAX_OTHER_SERVERS];
@@ -406,6 +410,7 @@ extern	cvar_t	*cl_showTimeDelta;
 extern	cvar_t	*com_timedemo;
 extern	cvar_t	*cl_aviFrameRate;
 extern	cvar_t	*cl_aviMotionJpeg;
+extern	cvar_t	*cl_aviThread;
 extern	cvar_t	*cl_aviPipeFormat;
 
 extern	cvar_t	*cl_activeAction;
@@ -422,6 +427,7 @@ extern	cvar_t	*cl_inGameVideo;
 extern	cvar_t	*cl_lanForcePackets;
 extern	cvar_t	*cl_autoRecordDemo;
 extern	cvar_t	*cl_drawRecording;
+extern	cvar_t	*cl_demoKeyframe;
 
 extern	cvar_t	*com_maxfps;
 
@@ -470,6 +476,7 @@ void CL_GetPing( int n, char *buf, int buflen, int *pingtime );
 void CL_GetPingInfo( int n, char *buf, int buflen );
 void CL_ClearPing( int n );
 int CL_GetPingQueueCount( void );
+void CL_SetServerInfoByAddress( const netadr_t *from, const char *info, int ping );
 
 void CL_ClearState( void );
 
@@ -481,6 +488,24 @@ qboolean CL_NoDelay( void );
 qboolean CL_GetModeInfo( int *width, int *height, float *windowAspect, int mode, const char *modeFS, int dw, int dh, qboolean fullscreen );
 
 
+//
+// cl_browser.c
+//
+void CL_BrowserInit( void );
+void CL_BrowserReset( void );
+void CL_BrowserFrame( void );
+qboolean CL_BrowserBusy( void );
+qboolean CL_BrowserQueue( const netadr_t *adr );
+qboolean CL_BrowserLookup( const netadr_t *adr, ping_t *ping );
+int CL_BrowserResponse( const netadr_t *from, const char *info );
+
+//
+// cl_demo.c
+//
+void CL_DemoIndexOpen( const char *name, int length );
+void CL_DemoIndexClose( void );
+void CL_DemoSeek_f( void );
+
 //
 // cl_input
 //
@@ -506,6 +531,7 @@ extern int cl_connectedToPureServer;
 extern int cl_connectedToCheatServer;
 
 void CL_ParseServerMessage( msg_t *msg );
+void CL_ParseDemoGamestate( msg_t *msg );
 
 //====================================================================
 
@@ -588,6 +614,8 @@ void CL_ShutdownCGame( void );
 qboolean CL_GameCommand( void );
 void CL_CGameRendering( stereoFrame_t stereo );
 void CL_SetCGameTime( void );
+void CL_SetConfigstring( int index, const char *s );
+void CL_SkipServerCommands( void );
 
 //
 // cl_ui.c
@@ -610,7 +638,7 @@ qboolean CL_Netchan_Process( netchan_t *chan, msg_t *msg );
 //
 qboolean CL_OpenAVIForWriting( const char *filename, qboolean pipe, qboolean reopen );
 void CL_TakeVideoFrame( void );
-void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size );
+void CL_QueueAVIVideoFrame( const byte *pixels, int width, int height, int padding, const byte *gammaTable, int jpegQuality );
 void CL_WriteAVIAudioFrame( const byte *pcmBuffer, int size );
 qboolean CL_CloseAVI( qboolean reopen );
 qboolean CL_VideoRecording( void );
@@ -619,8 +647,10 @@ qboolean CL_VideoRecording( void );
 // cl_jpeg.c
 //
 size_t	CL_SaveJPGToBuffer( byte *buffer, size_t bufSize, int quality, int image_width, int image_height, byte *image_buffer, int padding );
+size_t	CL_EncodeJPG( byte *buffer, size_t bufSize, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 void	CL_SaveJPG( const char *filename, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 void	CL_LoadJPG( const char *filename, unsigned char **pic, int *width, int *height );
+void	CL_DecodeJPG( const char *filename, const byte *data, int len, unsigned char **pic, int *width, int *height );
 
 
 // base backend functions
@@ -635,6 +665,7 @@ void	GLimp_SetGamma(unsigned char red[256], unsigned char green[256], unsigned c
 void	GLimp_Init( glconfig_t *config );
 void	GLimp_Shutdown( qboolean unloadDLL );
 void	GLimp_EndFrame( void );
+void	GLimp_MakeCurrent( qboolean current );
 void	*GL_GetProcAddress( const char *name );
 #endif
 
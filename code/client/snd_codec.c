@@ -247,7 +247,119 @@ S_CodecUtilClose
 */
 void S_CodecUtilClose( snd_stream_t **stream )
 {
-	FS_FCloseFile( ( *stream )->file );
+	if ( ( *stream )->data )
+		free( ( *stream )->data );
+	else
+		FS_FCloseFile( ( *stream )->file );
 	Z_Free( *stream );
 	*stream = NULL;
 }
+
+
+/*
+=================
+S_CodecUtilRead
+=================
+*/
+int S_CodecUtilRead( snd_stream_t *stream, void *buffer, int len )
+{
+	if ( !stream->data )
+		return FS_Read( buffer, len, stream->file );
+
+	if ( len > stream->length - stream->dataPos )
+		len = stream->length - stream->dataPos;
+	if ( len <= 0 )
+		return 0;
+
+	Com_Memcpy( buffer, stream->data + stream->dataPos, len );
+	stream->dataPos += len;
+	return len;
+}
+
+
+/*
+=================
+S_CodecUtilSeek
+=================
+*/
+int S_CodecUtilSeek( snd_stream_t *stream, long offset, fsOrigin_t origin )
+{
+	if ( !stream->data )
+		return FS_Seek( stream->file, offset, origin );
+
+	switch ( origin )
+	{
+		case FS_SEEK_CUR:
+			offset += stream->dataPos;
+			break;
+		case FS_SEEK_END:
+			offset += stream->length;
+			break;
+		case FS_SEEK_SET:
+			break;
+		default:
+			return -1;
+	}
+
+	if ( offset < 0 || offset > stream->length )
+		return -1;
+
+	stream->dataPos = offset;
+	return 0;
+}
+
+
+/*
+=================
+S_CodecUtilTell
+=================
+*/
+int S_CodecUtilTell( snd_stream_t *stream )
+{
+	if ( !stream->data )
+		return FS_FTell( stream->file );
+
+	return stream->dataPos;
+}
+
+
+/*
+=================
+S_CodecUtilLoadData
+
+Reads the whole file into memory and releases its handle, keeping the
+current position, so the stream can be decoded without touching
+filesystem state (i.e. from a thread other than the main one)
+=================
+*/
+#define MAX_STREAM_DATA (32*1024*1024)
+
+qboolean S_CodecUtilLoadData( snd_stream_t *stream )
+{
+	byte *data;
+	int pos;
+
+	if ( stream->data )
+		return qtrue;
+
+	if ( stream->length <= 0 || stream->length > MAX_STREAM_DATA )
+		return qfalse;
+
+	data = malloc( stream->length );
+	if ( !data )
+		return qfalse;
+
+	pos = FS_FTell( stream->file );
+	if ( FS_Seek( stream->file, 0, FS_SEEK_SET ) != 0 || FS_Read( data, stream->length, stream->file ) != stream->length )
+	{
+		FS_Seek( stream->file, pos, FS_SEEK_SET );
+		free( data );
+		return qfalse;
+	}
+
+	FS_FCloseFile( stream->file );
+	stream->file = FS_INVALID_HANDLE;
+	stream->data = data;
+	stream->dataPos = pos;
+	return qtrue;
+}
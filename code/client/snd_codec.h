@@ -47,6 +47,8 @@ typedef struct snd_stream_s
 	int length;
 	int pos;
 	void *ptr;
+	byte *data;		// whole file, once loaded by S_CodecUtilLoadData
+	int dataPos;
 } snd_stream_t;
 
 // Codec functions
@@ -77,6 +79,10 @@ int S_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer);
 // Util functions (used by codecs)
 snd_stream_t *S_CodecUtilOpen(const char *filename, snd_codec_t *codec);
 void S_CodecUtilClose(snd_stream_t **stream);
+int S_CodecUtilRead(snd_stream_t *stream, void *buffer, int len);
+int S_CodecUtilSeek(snd_stream_t *stream, long offset, fsOrigin_t origin);
+int S_CodecUtilTell(snd_stream_t *stream);
+qboolean S_CodecUtilLoadData(snd_stream_t *stream);
 
 // WAV Codec
 extern snd_codec_t wav_codec;
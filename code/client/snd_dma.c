@@ -37,10 +37,81 @@ static void S_Update_( void );
 static void S_UpdateBackgroundTrack( void );
 static void S_Base_StopAllSounds( void );
 static void S_Base_StopBackgroundTrack( void );
+static void S_StopStreamDecoder( void );
 static void S_memoryLoad( sfx_t *sfx );
 
 static snd_stream_t *s_backgroundStream = NULL;
 static char s_backgroundLoop[MAX_QPATH];
+
+// decoded music ring, filled by the decoder thread and drained by S_UpdateBackgroundTrack
+#define STREAM_RING_SIZE	0x40000		// ~3 seconds of 22kHz 16-bit stereo, power of two
+#define STREAM_RING_MASK	(STREAM_RING_SIZE-1)
+#define STREAM_DECODE_CHUNK	0x2000
+
+typedef struct {
+	void			*thread;
+	snd_stream_t	*stream;		// owned by the decoder while the thread runs
+	int				frameSize;
+	volatile int	written;		// bytes, advanced by the decoder only
+	volatile int	read;			// bytes, advanced by the main thread only
+	volatile int	eof;			// set by the decoder at the end of the stream
+	volatile int	shutdown;
+	qboolean		primed;			// raw buffer has been fed since the stream was opened
+	int				underruns;		// times the music ran dry in the mixer
+	int				stalls;			// updates that found the ring empty before the end of the stream
+	byte			ring[STREAM_RING_SIZE];
+} streamDecoder_t;
+
+static streamDecoder_t s_streamDecoder;
+
+// game-side sound calls posted for the mixer thread
+#define MIX_QUEUE_SIZE		4096		// power of two
+#define MIX_THREAD_PERIOD	4			// msec between mixes
+#define MIX_THREAD_AHEAD	0.05f		// s_mixAhead cap while the thread mixes
+
+typedef enum {
+	SCMD_START_SOUND,
+	SCMD_ADD_LOOP,
+	SCMD_ADD_REAL_LOOP,
+	SCMD_STOP_LOOP,
+	SCMD_CLEAR_LOOPS,
+	SCMD_ENTITY_POSITION,
+	SCMD_RESPATIALIZE
+} soundCmdType_t;
+
+typedef struct {
+	soundCmdType_t	type;
+	int				entityNum;
+	int				arg;			// entchannel, killall or frame number
+	sfx_t			*sfx;
+	qboolean		fixedOrigin;
+	vec3_t			vec[4];			// origin and velocity, or listener origin and axis
+} soundCmd_t;
+
+typedef struct {
+	void			*thread;
+	volatile int	lock;			// held by whoever mixes or executes commands
+	volatile int	shutdown;
+	volatile int	wrapped;		// sample counter was chopped, main thread restarts sounds
+	volatile int	published;		// commands visible to the mixer, advanced once per frame
+	volatile int	executed;		// advanced by the lock holder only
+	int				posted;			// main thread only
+	int				dropped;		// commands lost to a full queue
+	soundCmd_t		cmds[MIX_QUEUE_SIZE];
+} soundMixer_t;
+
+static soundMixer_t s_mixer;
+static Q_THREADLOCAL qboolean s_onMixThread;	// console output is main thread only
+
+static void S_LockMixer( void );
+static void S_UnlockMixer( void );
+static soundCmd_t *S_AllocSoundCommand( soundCmdType_t type );
+static void S_StartSoundOnChannel( const vec3_t origin, int entityNum, int entchannel, sfx_t *sfx );
+static void S_SetLoop( int entityNum, const vec3_t origin, const vec3_t velocity, sfx_t *sfx, int framecount );
+static void S_SetRealLoop( int entityNum, const vec3_t origin, const vec3_t velocity, sfx_t *sfx );
+static void S_SpatializeChannels( int entityNum, const vec3_t head, const vec3_t axis[3] );
+static void S_StartMixThread( void );
+static void S_StopMixThread( void );
 //static char		s_backgroundMusic[MAX_QPATH]; //TTimo: unused
 
 static byte		buffer2[ 0x10000 ]; // for muted painting
@@ -85,9 +156,12 @@ static int s_numSfx = 0;
 static sfx_t *sfxHash[LOOP_HASH];
 
 cvar_t		*s_testsound;
+cvar_t		*s_mixSIMD;
 cvar_t		*s_khz;
 cvar_t		*s_show;
 static cvar_t *s_mixahead;
+static cvar_t *s_streamThread;
+static cvar_t *s_mixThread;
 static cvar_t *s_mixOffset;
 #if defined(__linux__) && !defined(USE_SDL)
 cvar_t		*s_device;
@@ -121,9 +195,17 @@ static void S_Base_SoundInfo( void ) {
 		}
 		if ( s_backgroundStream ) {
 			Com_Printf("Background file: %s\n", s_backgroundLoop );
+			if ( s_streamDecoder.thread ) {
+				Com_Printf("Decoded on thread, %i%% buffered\n",
+					( s_streamDecoder.written - s_streamDecoder.read ) * 100 / STREAM_RING_SIZE );
+			}
+			Com_Printf("%5d underruns, %d decoder stalls\n", s_streamDecoder.underruns, s_streamDecoder.stalls );
 		} else {
 			Com_Printf("No background file.\n" );
 		}
+		if ( s_mixer.thread ) {
+			Com_Printf("Mixing on thread, %d commands dropped\n", s_mixer.dropped );
+		}
 
 	}
 	Com_Printf("----------------------\n" );
@@ -362,17 +444,24 @@ static void S_Base_BeginRegistration( void ) {
 	if ( s_numSfx )
 		return;
 
+	S_LockMixer();
+
 	SND_setup();
 
 	Com_Memset( s_knownSfx, 0, sizeof( s_knownSfx ) );
 	Com_Memset( sfxHash, 0, sizeof( sfxHash ) );
 
+	S_UnlockMixer();
+
 	S_Base_RegisterSound( "sound/misc/silence.wav", qfalse ); // changed to a sound in baseq3
 }
 
 
 static void S_memoryLoad( sfx_t *sfx ) {
 
+	// loading may free the oldest sounds, which the mixer could be playing
+	S_LockMixer();
+
 	// load the sound file
 	if ( !S_LoadSound ( sfx ) ) {
 		Com_DPrintf( S_COLOR_YELLOW "WARNING: couldn't load sound: %s\n", sfx->soundName );
@@ -380,6 +469,8 @@ static void S_memoryLoad( sfx_t *sfx ) {
 	}
 
 	sfx->inMemory = qtrue;
+
+	S_UnlockMixer();
 }
 
 //=============================================================================
@@ -458,10 +549,8 @@ Entchannel 0 will never override a playing sound
 ====================
 */
 static void S_Base_StartSound( const vec3_t origin, int entityNum, int entchannel, sfxHandle_t sfxHandle ) {
-	channel_t	*ch;
+	soundCmd_t	*cmd;
 	sfx_t		*sfx;
-	int i, oldest, chosen, startTime;
-	int	inplay, allowed;
 
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
@@ -486,6 +575,36 @@ static void S_Base_StartSound( const vec3_t origin, int entityNum, int entchanne
 		Com_Printf( "%i : %s\n", s_paintedtime, sfx->soundName );
 	}
 
+	if ( s_mixer.thread ) {
+		cmd = S_AllocSoundCommand( SCMD_START_SOUND );
+		if ( cmd ) {
+			cmd->entityNum = entityNum;
+			cmd->arg = entchannel;
+			cmd->sfx = sfx;
+			cmd->fixedOrigin = ( origin != NULL );
+			if ( origin ) {
+				VectorCopy( origin, cmd->vec[0] );
+			}
+		}
+		return;
+	}
+
+	S_StartSoundOnChannel( origin, entityNum, entchannel, sfx );
+}
+
+
+/*
+====================
+S_StartSoundOnChannel
+
+Picks a channel for the sound, runs wherever the mixer runs
+====================
+*/
+static void S_StartSoundOnChannel( const vec3_t origin, int entityNum, int entchannel, sfx_t *sfx ) {
+	channel_t	*ch;
+	int i, oldest, chosen, startTime;
+	int	inplay, allowed;
+
 	startTime = s_soundtime; // Com_Milliseconds();
 
 	// borrowed from cnq3
@@ -524,7 +643,8 @@ static void S_Base_StartSound( const vec3_t origin, int entityNum, int entchanne
 	for ( i = 0; i < MAX_CHANNELS; i++, ch++ ) {
 		if ( ch->entnum == entityNum && ch->thesfx == sfx ) {
 			if ( startTime - ch->allocTime < 20 ) {
-				Com_DPrintf(S_COLOR_YELLOW "S_StartSound: Double start (%d ms < 20 ms) for %s\n", startTime - ch->allocTime, sfx->soundName);
+				if ( !s_onMixThread )
+					Com_DPrintf(S_COLOR_YELLOW "S_StartSound: Double start (%d ms < 20 ms) for %s\n", startTime - ch->allocTime, sfx->soundName);
 				return;
 			}
 			inplay++;
@@ -533,7 +653,8 @@ static void S_Base_StartSound( const vec3_t origin, int entityNum, int entchanne
 
 	// too much duplicated sounds, ignore
 	if ( inplay > allowed ) {
-		Com_DPrintf(S_COLOR_YELLOW "S_StartSound: %s hit the concurrent channels limit (%d)\n", sfx->soundName, allowed);
+		if ( !s_onMixThread )
+			Com_DPrintf(S_COLOR_YELLOW "S_StartSound: %s hit the concurrent channels limit (%d)\n", sfx->soundName, allowed);
 		return;
 	}
 
@@ -570,14 +691,16 @@ static void S_Base_StartSound( const vec3_t origin, int entityNum, int entchanne
 					}
 				}
 				if (chosen == -1) {
-					Com_DPrintf(S_COLOR_YELLOW "S_StartSound: No more channels free for %s\n", sfx->soundName);
+					if ( !s_onMixThread )
+						Com_DPrintf(S_COLOR_YELLOW "S_StartSound: No more channels free for %s\n", sfx->soundName);
 					return;
 				}
 			}
 		}
 		ch = &s_channels[chosen];
 		ch->allocTime = sfx->lastTimeUsed;
-		Com_DPrintf(S_COLOR_YELLOW "S_StartSound: No more channels free for %s, dropping earliest sound: %s\n", sfx->soundName, ch->thesfx->soundName);
+		if ( !s_onMixThread )
+			Com_DPrintf(S_COLOR_YELLOW "S_StartSound: No more channels free for %s, dropping earliest sound: %s\n", sfx->soundName, ch->thesfx->soundName);
 	}
 
 	if ( origin ) {
@@ -631,6 +754,8 @@ static void S_Base_ClearSoundBuffer( void ) {
 	if (!s_soundStarted)
 		return;
 
+	S_LockMixer();
+
 	// stop looping sounds
 	Com_Memset(loopSounds, 0, sizeof(loopSounds));
 	Com_Memset(loop_channels, 0, sizeof(loop_channels));
@@ -651,6 +776,8 @@ static void S_Base_ClearSoundBuffer( void ) {
 		Com_Memset(dma.buffer, clear, dma.samples * dma.samplebits/8);
 
 	SNDDMA_Submit();
+
+	S_UnlockMixer();
 }
 
 
@@ -679,29 +806,59 @@ continuous looping sounds are added each frame
 ==============================================================
 */
 
-void S_Base_StopLoopingSound(int entityNum) {
+static void S_StopLoop( int entityNum ) {
 	loopSounds[entityNum].active = qfalse;
 //	loopSounds[entityNum].sfx = 0;
 	loopSounds[entityNum].kill = qfalse;
 }
 
 
+void S_Base_StopLoopingSound(int entityNum) {
+	soundCmd_t *cmd;
+
+	if ( s_mixer.thread ) {
+		cmd = S_AllocSoundCommand( SCMD_STOP_LOOP );
+		if ( cmd ) {
+			cmd->entityNum = entityNum;
+		}
+		return;
+	}
+
+	S_StopLoop( entityNum );
+}
+
+
 /*
 ==================
 S_ClearLoopingSounds
 ==================
 */
-void S_Base_ClearLoopingSounds( qboolean killall ) {
+static void S_ClearLoops( qboolean killall ) {
 	int i;
 	for ( i = 0 ; i < MAX_GENTITIES ; i++) {
 		if (killall || loopSounds[i].kill == qtrue || (loopSounds[i].sfx && loopSounds[i].sfx->soundLength == 0)) {
-			S_Base_StopLoopingSound(i);
+			S_StopLoop(i);
 		}
 	}
 	numLoopChannels = 0;
 }
 
 
+void S_Base_ClearLoopingSounds( qboolean killall ) {
+	soundCmd_t *cmd;
+
+	if ( s_mixer.thread ) {
+		cmd = S_AllocSoundCommand( SCMD_CLEAR_LOOPS );
+		if ( cmd ) {
+			cmd->arg = killall;
+		}
+		return;
+	}
+
+	S_ClearLoops( killall );
+}
+
+
 /*
 ==================
 S_AddLoopingSound
@@ -711,6 +868,7 @@ Include velocity in case I get around to doing doppler...
 ==================
 */
 void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
+	soundCmd_t *cmd;
 	sfx_t *sfx;
 
 	if ( !s_soundStarted || s_soundMuted ) {
@@ -732,6 +890,28 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 		Com_Error( ERR_DROP, "%s has length 0", sfx->soundName );
 	}
 
+	if ( s_mixer.thread ) {
+		cmd = S_AllocSoundCommand( SCMD_ADD_LOOP );
+		if ( cmd ) {
+			cmd->entityNum = entityNum;
+			cmd->arg = cls.framecount;
+			cmd->sfx = sfx;
+			VectorCopy( origin, cmd->vec[0] );
+			VectorCopy( velocity, cmd->vec[1] );
+		}
+		return;
+	}
+
+	S_SetLoop( entityNum, origin, velocity, sfx, cls.framecount );
+}
+
+
+/*
+==================
+S_SetLoop
+==================
+*/
+static void S_SetLoop( int entityNum, const vec3_t origin, const vec3_t velocity, sfx_t *sfx, int framecount ) {
 	VectorCopy( origin, loopSounds[entityNum].origin );
 	VectorCopy( velocity, loopSounds[entityNum].velocity );
 	loopSounds[entityNum].active = qtrue;
@@ -749,7 +929,7 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 		lena = DistanceSquared(loopSounds[listener_number].origin, loopSounds[entityNum].origin);
 		VectorAdd(loopSounds[entityNum].origin, loopSounds[entityNum].velocity, out);
 		lenb = DistanceSquared(loopSounds[listener_number].origin, out);
-		if ((loopSounds[entityNum].framenum+1) != cls.framecount) {
+		if ((loopSounds[entityNum].framenum+1) != framecount) {
 			loopSounds[entityNum].oldDopplerScale = 1.0;
 		} else {
 			loopSounds[entityNum].oldDopplerScale = loopSounds[entityNum].dopplerScale;
@@ -762,7 +942,7 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 		}
 	}
 
-	loopSounds[entityNum].framenum = cls.framecount;
+	loopSounds[entityNum].framenum = framecount;
 }
 
 
@@ -775,6 +955,7 @@ Include velocity in case I get around to doing doppler...
 ==================
 */
 void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
+	soundCmd_t *cmd;
 	sfx_t *sfx;
 
 	if ( !s_soundStarted || s_soundMuted ) {
@@ -795,6 +976,28 @@ void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_
 	if ( !sfx->soundLength ) {
 		Com_Error( ERR_DROP, "%s has length 0", sfx->soundName );
 	}
+
+	if ( s_mixer.thread ) {
+		cmd = S_AllocSoundCommand( SCMD_ADD_REAL_LOOP );
+		if ( cmd ) {
+			cmd->entityNum = entityNum;
+			cmd->sfx = sfx;
+			VectorCopy( origin, cmd->vec[0] );
+			VectorCopy( velocity, cmd->vec[1] );
+		}
+		return;
+	}
+
+	S_SetRealLoop( entityNum, origin, velocity, sfx );
+}
+
+
+/*
+==================
+S_SetRealLoop
+==================
+*/
+static void S_SetRealLoop( int entityNum, const vec3_t origin, const vec3_t velocity, sfx_t *sfx ) {
 	VectorCopy( origin, loopSounds[entityNum].origin );
 	VectorCopy( velocity, loopSounds[entityNum].velocity );
 	loopSounds[entityNum].sfx = sfx;
@@ -930,6 +1133,9 @@ static void S_Base_RawSamples( int stream, int samples, int rate, int width, int
 		intVolume = 256 * volume;
 	}
 
+	// mixer thread reads raw samples while painting
+	S_LockMixer();
+
 	if ( s_rawend[stream] - s_soundtime < 0 ) {
 		Com_DPrintf( "S_RawSamples: resetting minimum: %i < %i\n", s_rawend[stream], s_soundtime );
 		s_rawend[stream] = s_soundtime;
@@ -1011,6 +1217,8 @@ static void S_Base_RawSamples( int stream, int samples, int rate, int width, int
 	if ( s_rawend[stream] - s_soundtime > MAX_RAW_SAMPLES ) {
 		Com_DPrintf( "S_RawSamples: overflowed %i > %i\n", s_rawend[stream], s_soundtime );
 	}
+
+	S_UnlockMixer();
 }
 
 //=============================================================================
@@ -1023,9 +1231,21 @@ let the sound system know where an entity currently is
 ======================
 */
 void S_Base_UpdateEntityPosition( int entityNum, const vec3_t origin ) {
+	soundCmd_t *cmd;
+
 	if ( entityNum < 0 || entityNum >= MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "S_UpdateEntityPosition: bad entitynum %i", entityNum );
 	}
+
+	if ( s_mixer.thread ) {
+		cmd = S_AllocSoundCommand( SCMD_ENTITY_POSITION );
+		if ( cmd ) {
+			cmd->entityNum = entityNum;
+			VectorCopy( origin, cmd->vec[0] );
+		}
+		return;
+	}
+
 	VectorCopy( origin, loopSounds[entityNum].origin );
 }
 
@@ -1038,14 +1258,38 @@ Change the volumes of all the playing sounds for changes in their positions
 ============
 */
 void S_Base_Respatialize( int entityNum, const vec3_t head, vec3_t axis[3], int inwater ) {
-	int			i;
-	channel_t	*ch;
-	vec3_t		origin;
+	soundCmd_t *cmd;
 
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
 	}
 
+	if ( s_mixer.thread ) {
+		cmd = S_AllocSoundCommand( SCMD_RESPATIALIZE );
+		if ( cmd ) {
+			cmd->entityNum = entityNum;
+			VectorCopy( head, cmd->vec[0] );
+			VectorCopy( axis[0], cmd->vec[1] );
+			VectorCopy( axis[1], cmd->vec[2] );
+			VectorCopy( axis[2], cmd->vec[3] );
+		}
+		return;
+	}
+
+	S_SpatializeChannels( entityNum, head, axis );
+}
+
+
+/*
+============
+S_SpatializeChannels
+============
+*/
+static void S_SpatializeChannels( int entityNum, const vec3_t head, const vec3_t axis[3] ) {
+	int			i;
+	channel_t	*ch;
+	vec3_t		origin;
+
 	listener_number = entityNum;
 	VectorCopy(head, listener_origin);
 	VectorCopy(axis[0], listener_axis[0]);
@@ -1133,10 +1377,24 @@ static void S_Base_Update( void ) {
 		return;
 	}
 
+	// the sample counter was chopped on the mixer thread
+	if ( s_mixer.wrapped ) {
+		Q_AtomicExchange( &s_mixer.wrapped, 0 );
+		S_Base_StopAllSounds();
+	}
+
+	// video recording mixes exactly one frame of audio per frame
+	if ( s_mixThread->integer && !CL_VideoRecording() ) {
+		S_StartMixThread();
+	} else {
+		S_StopMixThread();
+	}
+
 	//
 	// debugging output
 	//
 	if ( s_show->integer == 2 ) {
+		S_LockMixer();
 		total = 0;
 		ch = s_channels;
 		for (i=0 ; i<MAX_CHANNELS; i++, ch++) {
@@ -1147,6 +1405,16 @@ static void S_Base_Update( void ) {
 		}
 
 		Com_Printf ("----(%i)---- painted: %i\n", total, s_paintedtime);
+		S_UnlockMixer();
+	}
+
+	if ( s_mixer.thread ) {
+		// hand this frame's commands over to the mixer
+		Q_AtomicExchange( &s_mixer.published, s_mixer.posted );
+
+		// streams are read here, the mixer picks them up from s_rawsamples
+		S_UpdateBackgroundTrack();
+		return;
 	}
 
 	// mix some sound
@@ -1188,7 +1456,10 @@ static void S_GetSoundtime( void )
 		{	// time to chop things off to avoid 32 bit limits
 			buffers = 0;
 			s_paintedtime = dma.fullsamples;
-			S_Base_StopAllSounds ();
+			if ( s_onMixThread )
+				Q_AtomicExchange( &s_mixer.wrapped, 1 );
+			else
+				S_Base_StopAllSounds ();
 		}
 	}
 	oldsamplepos = samplepos;
@@ -1237,6 +1508,11 @@ static void S_Update_( void ) {
 	mixAhead[0] = s_mixahead->value * (float)dma.speed;
 	mixAhead[1] = sane * 0.0015f * (float)dma.speed;
 
+	// the mixer thread comes back every few msec, no need to mix far ahead
+	if ( s_onMixThread && mixAhead[0] > MIX_THREAD_AHEAD * dma.speed ) {
+		mixAhead[0] = MIX_THREAD_AHEAD * dma.speed;
+	}
+
 	if ( mixAhead[0] < mixAhead[1] ) {
 		mixAhead[0] = mixAhead[1];
 	}
@@ -1254,7 +1530,9 @@ static void S_Update_( void ) {
 	}
 
 	// add raw data from streamed samples
-	S_UpdateBackgroundTrack();
+	if ( !s_onMixThread ) {
+		S_UpdateBackgroundTrack();
+	}
 
 	SNDDMA_BeginPainting();
 
@@ -1266,6 +1544,186 @@ static void S_Update_( void ) {
 }
 
 
+/*
+===============================================================================
+
+mixer thread
+
+With s_mixThread enabled the game only posts start/loop/position/listener
+commands into a single-producer/single-consumer queue, and the mixer thread
+executes them, spatializes and mixes every few msec. Commands are published
+once per frame, so the mixer never sees looping sounds half way through
+being cleared and re-added. Rare calls that need the mixer state directly,
+such as loading sounds or clearing the buffer, take the mixer lock and run
+the pending commands themselves.
+
+===============================================================================
+*/
+
+/*
+======================
+S_AllocSoundCommand
+
+Never waits, a full queue drops the command
+======================
+*/
+static soundCmd_t *S_AllocSoundCommand( soundCmdType_t type ) {
+	soundCmd_t *cmd;
+
+	if ( s_mixer.posted - Q_AtomicLoad( &s_mixer.executed ) >= MIX_QUEUE_SIZE ) {
+		s_mixer.dropped++;
+		return NULL;
+	}
+
+	cmd = &s_mixer.cmds[ s_mixer.posted & ( MIX_QUEUE_SIZE - 1 ) ];
+	cmd->type = type;
+	s_mixer.posted++;
+
+	return cmd;
+}
+
+
+/*
+======================
+S_ExecuteSoundCommands
+
+Runs commands up to end, only by the holder of the mixer lock
+======================
+*/
+static void S_ExecuteSoundCommands( int end ) {
+	const soundCmd_t *cmd;
+	int executed;
+
+	for ( executed = s_mixer.executed; executed - end < 0; executed++ ) {
+		cmd = &s_mixer.cmds[ executed & ( MIX_QUEUE_SIZE - 1 ) ];
+		switch ( cmd->type ) {
+			case SCMD_START_SOUND:
+				S_StartSoundOnChannel( cmd->fixedOrigin ? cmd->vec[0] : NULL, cmd->entityNum, cmd->arg, cmd->sfx );
+				break;
+			case SCMD_ADD_LOOP:
+				S_SetLoop( cmd->entityNum, cmd->vec[0], cmd->vec[1], cmd->sfx, cmd->arg );
+				break;
+			case SCMD_ADD_REAL_LOOP:
+				S_SetRealLoop( cmd->entityNum, cmd->vec[0], cmd->vec[1], cmd->sfx );
+				break;
+			case SCMD_STOP_LOOP:
+				S_StopLoop( cmd->entityNum );
+				break;
+			case SCMD_CLEAR_LOOPS:
+				S_ClearLoops( cmd->arg );
+				break;
+			case SCMD_ENTITY_POSITION:
+				VectorCopy( cmd->vec[0], loopSounds[ cmd->entityNum ].origin );
+				break;
+			case SCMD_RESPATIALIZE:
+				S_SpatializeChannels( cmd->entityNum, cmd->vec[0], (const vec3_t *)( cmd->vec + 1 ) );
+				break;
+		}
+	}
+
+	// release the slots to the producer
+	Q_AtomicExchange( &s_mixer.executed, executed );
+}
+
+
+/*
+======================
+S_LockMixer
+
+Gives the main thread the mixer state, with every posted command applied
+======================
+*/
+static void S_LockMixer( void ) {
+	if ( !s_mixer.thread ) {
+		return;
+	}
+
+	Com_SpinLock( &s_mixer.lock );
+
+	Q_AtomicExchange( &s_mixer.published, s_mixer.posted );
+	S_ExecuteSoundCommands( s_mixer.posted );
+}
+
+
+/*
+======================
+S_UnlockMixer
+======================
+*/
+static void S_UnlockMixer( void ) {
+	if ( !s_mixer.thread ) {
+		return;
+	}
+
+	Com_SpinUnlock( &s_mixer.lock );
+}
+
+
+/*
+======================
+S_MixThread
+======================
+*/
+static void S_MixThread( void *arg ) {
+	s_onMixThread = qtrue;
+
+	while ( !Q_AtomicLoad( &s_mixer.shutdown ) ) {
+		// don't spin while the main thread loads sounds
+		if ( Q_AtomicTestAndSet( &s_mixer.lock ) ) {
+			Sys_Sleep( 1 );
+			continue;
+		}
+
+		S_ExecuteSoundCommands( Q_AtomicLoad( &s_mixer.published ) );
+
+		S_Update_();
+
+		Com_SpinUnlock( &s_mixer.lock );
+
+		Sys_Sleep( MIX_THREAD_PERIOD );
+	}
+}
+
+
+/*
+======================
+S_StartMixThread
+======================
+*/
+static void S_StartMixThread( void ) {
+	if ( s_mixer.thread ) {
+		return;
+	}
+
+	s_mixer.shutdown = 0;
+	s_mixer.thread = Sys_CreateThread( S_MixThread, NULL );
+	if ( !s_mixer.thread ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't create sound mixer thread\n" );
+		Cvar_Set( "s_mixThread", "0" );
+	}
+}
+
+
+/*
+======================
+S_StopMixThread
+======================
+*/
+static void S_StopMixThread( void ) {
+	if ( !s_mixer.thread ) {
+		return;
+	}
+
+	Q_AtomicExchange( &s_mixer.shutdown, 1 );
+	Sys_JoinThread( s_mixer.thread );
+	s_mixer.thread = NULL;
+
+	// apply whatever the mixer didn't get to
+	s_mixer.published = s_mixer.posted;
+	S_ExecuteSoundCommands( s_mixer.posted );
+}
+
+
 /*
 ===============================================================================
 
@@ -1274,6 +1732,101 @@ background music functions
 ===============================================================================
 */
 
+/*
+======================
+S_StreamDecoderThread
+======================
+*/
+static void S_StreamDecoderThread( void *arg ) {
+	streamDecoder_t *dec = (streamDecoder_t *)arg;
+	int	space, offset, len, r;
+
+	while ( !Q_AtomicLoad( &dec->shutdown ) ) {
+		space = STREAM_RING_SIZE - ( dec->written - Q_AtomicLoad( &dec->read ) );
+		if ( dec->eof || space < STREAM_DECODE_CHUNK ) {
+			Sys_Sleep( 2 );
+			continue;
+		}
+
+		// decode up to the end of the ring, the next pass wraps around
+		offset = dec->written & STREAM_RING_MASK;
+		len = STREAM_RING_SIZE - offset;
+		if ( len > STREAM_DECODE_CHUNK )
+			len = STREAM_DECODE_CHUNK;
+
+		r = S_CodecReadStream( dec->stream, len, dec->ring + offset );
+		if ( r <= 0 ) {
+			Q_AtomicExchange( &dec->eof, 1 );
+			continue;
+		}
+
+		// publish decoded data
+		Q_AtomicAdd( &dec->written, r );
+	}
+}
+
+
+/*
+======================
+S_StartStreamDecoder
+
+Decoding on a thread requires the whole compressed file in memory
+and a sample frame size that evenly divides the ring
+======================
+*/
+static void S_StartStreamDecoder( const char *filename ) {
+	snd_stream_t *stream = s_backgroundStream;
+	int frameSize;
+
+	s_streamDecoder.primed = qfalse;
+
+	if ( !stream || !s_streamThread->integer ) {
+		return;
+	}
+
+	frameSize = stream->info.width * stream->info.channels;
+	if ( frameSize <= 0 || ( frameSize & ( frameSize - 1 ) ) ) {
+		return;
+	}
+
+	if ( !S_CodecUtilLoadData( stream ) ) {
+		Com_DPrintf( "S_StartStreamDecoder: can't load %s into memory\n", filename );
+		return;
+	}
+
+	s_streamDecoder.stream = stream;
+	s_streamDecoder.frameSize = frameSize;
+	s_streamDecoder.written = 0;
+	s_streamDecoder.read = 0;
+	s_streamDecoder.eof = 0;
+	s_streamDecoder.shutdown = 0;
+
+	s_streamDecoder.thread = Sys_CreateThread( S_StreamDecoderThread, &s_streamDecoder );
+	if ( !s_streamDecoder.thread ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't create music decoder thread\n" );
+		s_streamDecoder.stream = NULL;
+	}
+}
+
+
+/*
+======================
+S_StopStreamDecoder
+======================
+*/
+static void S_StopStreamDecoder( void ) {
+	if ( !s_streamDecoder.thread ) {
+		return;
+	}
+
+	Q_AtomicExchange( &s_streamDecoder.shutdown, 1 );
+	Sys_JoinThread( s_streamDecoder.thread );
+
+	s_streamDecoder.thread = NULL;
+	s_streamDecoder.stream = NULL;
+}
+
+
 /*
 ======================
 S_StopBackgroundTrack
@@ -1282,9 +1835,12 @@ S_StopBackgroundTrack
 static void S_Base_StopBackgroundTrack( void ) {
 	if(!s_backgroundStream)
 		return;
+	S_StopStreamDecoder();
 	S_CodecCloseStream(s_backgroundStream);
 	s_backgroundStream = NULL;
+	S_LockMixer();
 	s_rawend[0] = 0;
+	S_UnlockMixer();
 }
 
 
@@ -1298,6 +1854,7 @@ static void S_OpenBackgroundStream( const char *filename ) {
 	// if restarting the same background track
 	if( s_backgroundStream )
 	{
+		S_StopStreamDecoder();
 		S_CodecCloseStream( s_backgroundStream );
 		s_backgroundStream = NULL;
 	}
@@ -1312,6 +1869,8 @@ static void S_OpenBackgroundStream( const char *filename ) {
 	if( s_backgroundStream->info.channels != 2 || s_backgroundStream->info.rate != 22050 ) {
 		Com_Printf(S_COLOR_YELLOW "WARNING: music file %s is not 22k stereo\n", filename );
 	}
+
+	S_StartStreamDecoder( filename );
 }
 
 
@@ -1350,7 +1909,11 @@ static void S_UpdateBackgroundTrack( void ) {
 	int		bufferSamples;
 	int		fileSamples;
 	byte	raw[30000];		// just enough to fit in a mac stack frame
+	const byte *data;
 	int		fileBytes;
+	int		frameSize;
+	int		offset;
+	int		eof;
 	int		r;
 
 	if ( !s_backgroundStream ) {
@@ -1359,13 +1922,19 @@ static void S_UpdateBackgroundTrack( void ) {
 
 	// don't bother playing anything if musicvolume is 0
 	if ( s_musicVolume->value == 0.0f ) {
+		s_streamDecoder.primed = qfalse;
 		return;
 	}
 
 	// see how many samples should be copied into the raw buffer
+	S_LockMixer();
 	if ( s_rawend[0] - s_soundtime < 0 ) {
+		if ( s_streamDecoder.primed ) {
+			s_streamDecoder.underruns++;
+		}
 		s_rawend[0] = s_soundtime;
 	}
+	S_UnlockMixer();
 
 	while ( s_rawend[0] - s_soundtime < MAX_RAW_SAMPLES ) {
 		bufferSamples = MAX_RAW_SAMPLES - (s_rawend[0] - s_soundtime);
@@ -1377,25 +1946,52 @@ static void S_UpdateBackgroundTrack( void ) {
 			return;
 		}
 
-		// our max buffer size
-		fileBytes = fileSamples * (s_backgroundStream->info.width * s_backgroundStream->info.channels);
-		if ( fileBytes > sizeof(raw) ) {
-			fileBytes = sizeof(raw);
-			fileSamples = fileBytes / (s_backgroundStream->info.width * s_backgroundStream->info.channels);
-		}
+		frameSize = s_backgroundStream->info.width * s_backgroundStream->info.channels;
+		fileBytes = fileSamples * frameSize;
 
-		// Read
-		r = S_CodecReadStream( s_backgroundStream, fileBytes, raw );
-		if( r < fileBytes )
+		if ( s_streamDecoder.thread )
 		{
-			fileSamples = r / (s_backgroundStream->info.width * s_backgroundStream->info.channels);
+			// take what the decoder has ready, up to the end of the ring;
+			// read eof first so that data written before it is not missed
+			eof = Q_AtomicLoad( &s_streamDecoder.eof );
+			r = Q_AtomicLoad( &s_streamDecoder.written ) - s_streamDecoder.read;
+			offset = s_streamDecoder.read & STREAM_RING_MASK;
+			if ( r > STREAM_RING_SIZE - offset )
+				r = STREAM_RING_SIZE - offset;
+			if ( r > fileBytes )
+				r = fileBytes;
+
+			if ( r <= 0 && !eof )
+			{
+				if ( s_streamDecoder.primed )
+					s_streamDecoder.stalls++;
+				return;
+			}
+			data = s_streamDecoder.ring + offset;
+		}
+		else
+		{
+			// our max buffer size
+			if ( fileBytes > sizeof(raw) )
+				fileBytes = sizeof(raw) - sizeof(raw) % frameSize;
+
+			// Read
+			r = S_CodecReadStream( s_backgroundStream, fileBytes, raw );
+			data = raw;
 		}
 
 		if ( r > 0 )
 		{
+			fileSamples = r / frameSize;
+
 			// add to raw buffer
 			S_Base_RawSamples( 0, fileSamples, s_backgroundStream->info.rate,
-				s_backgroundStream->info.width, s_backgroundStream->info.channels, raw, s_musicVolume->value, -1 );
+				s_backgroundStream->info.width, s_backgroundStream->info.channels, data, s_musicVolume->value, -1 );
+
+			if ( s_streamDecoder.thread )
+				Q_AtomicAdd( &s_streamDecoder.read, r );
+
+			s_streamDecoder.primed = qtrue;
 		}
 		else
 		{
@@ -1466,6 +2062,8 @@ static void S_Base_Shutdown( void ) {
 		return;
 	}
 
+	S_StopMixThread();
+
 	SNDDMA_Shutdown();
 
 	// release sound buffers only when switching to dedicated 
@@ -1482,6 +2080,7 @@ static void S_Base_Shutdown( void ) {
 	dma_buffer2 = NULL;
 
 	Cmd_RemoveCommand( "s_info" );
+	Cmd_RemoveCommand( "s_mixBenchmark" );
 
 	cls.soundRegistered = qfalse;
 }
@@ -1522,6 +2121,18 @@ qboolean S_Base_Init( soundInterface_t *si ) {
 	Cvar_CheckRange( s_mixahead, "0.001", "0.5", CV_FLOAT );
 	Cvar_SetDescription( s_mixahead, "Amount of time to pre-mix sound data to avoid potential skips/stuttering in case of unstable framerate. Higher values add more CPU usage." );
 
+	s_streamThread = Cvar_Get( "s_streamThread", "1", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( s_streamThread, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( s_streamThread, "Decode background music on a separate thread, takes effect with the next track." );
+
+	s_mixThread = Cvar_Get( "s_mixThread", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( s_mixThread, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( s_mixThread, "Spatialize and mix sound effects on a separate thread in short periods, s_mixAhead is capped to 50 msec while it runs. Not used during video recording." );
+
+	s_mixSIMD = Cvar_Get( "s_mixSIMD", "1", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( s_mixSIMD, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( s_mixSIMD, "Mix 16-bit sound channels and resample loaded sounds with the SSE4.1/AVX2 kernels when the CPU supports them, see s_mixBenchmark." );
+
 	s_mixOffset = Cvar_Get( "s_mixOffset", "0", CVAR_ARCHIVE_ND | CVAR_DEVELOPER );
 	Cvar_CheckRange( s_mixOffset, "0", "0.5", CV_FLOAT );
 
@@ -1562,6 +2173,8 @@ qboolean S_Base_Init( soundInterface_t *si ) {
 		return qfalse;
 	}
 
+	Cmd_AddCommand( "s_mixBenchmark", S_MixBenchmark_f );
+
 	si->Shutdown = S_Base_Shutdown;
 	si->StartSound = S_Base_StartSound;
 	si->StartLocalSound = S_Base_StartLocalSound;
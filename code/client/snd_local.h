@@ -201,6 +201,7 @@ extern cvar_t *s_muteWhenMinimized;
 extern cvar_t * s_worldVolume;
 
 extern cvar_t *s_testsound;
+extern cvar_t *s_mixSIMD;
 
 qboolean S_LoadSound( sfx_t *sfx );
 
@@ -210,6 +211,8 @@ void		SND_setup( void );
 void		SND_shutdown( void );
 
 void S_PaintChannels(int endtime);
+void S_MixBenchmark_f( void );
+void S_ResampleLinear( short *out, int outcount, const short *in, int incount, int channels, float stepscale );
 
 // spatializes a channel
 void S_Spatialize(channel_t *ch);
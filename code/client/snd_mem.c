@@ -168,48 +168,55 @@ resample / decimate to the current source rate
 */
 static int ResampleSfx( sfx_t *sfx, int channels, int inrate, int inwidth, int samples, byte *data, qboolean compressed ) {
 	int		outcount;
-	int		srcsample;
 	float	stepscale;
-	int		i, j;
-	int		sample, samplefrac, fracstep;
-	int			part;
-	sndBuffer	*chunk;
-	
+	int		i, total, part;
+	short	*in, *out;
+	sndBuffer	*chunk, *newchunk;
+
 	stepscale = (float)inrate / dma.speed;	// this is usually 0.5, 1, or 2
 
 	outcount = samples / stepscale;
+	if ( outcount <= 0 || samples <= 0 ) {
+		return 0;
+	}
 
-	srcsample = 0;
-	samplefrac = 0;
-	fracstep = stepscale * 256 * channels;
-	chunk = sfx->soundData;
+	// widen 8-bit data first
+	if ( inwidth == 2 ) {
+		in = (short *)data;
+	} else {
+		in = Hunk_AllocateTempMemory( samples * channels * sizeof( short ) );
+		for ( i = 0; i < samples * channels; i++ ) {
+			in[i] = ( data[i] - 128 ) * 256;
+		}
+	}
 
-	for (i=0 ; i<outcount ; i++)
-	{
-		srcsample += samplefrac >> 8;
-		samplefrac &= 255;
-		samplefrac += fracstep;
-		for (j=0 ; j<channels ; j++)
-		{
-			if( inwidth == 2 ) {
-				sample = ( ((short *)data)[srcsample+j] );
-			} else {
-				sample = (unsigned int)( (unsigned char)(data[srcsample+j]) - 128) << 8;
-			}
-			part = (i*channels+j)&(SND_CHUNK_SIZE-1);
-			if (part == 0) {
-				sndBuffer	*newchunk;
-				newchunk = SND_malloc();
-				if (chunk == NULL) {
-					sfx->soundData = newchunk;
-				} else {
-					chunk->next = newchunk;
-				}
-				chunk = newchunk;
-			}
+	// interpolate into one contiguous block, then split it into chunks
+	total = outcount * channels;
+	if ( inrate == dma.speed ) {
+		out = in;
+	} else {
+		out = Hunk_AllocateTempMemory( total * sizeof( short ) );
+		S_ResampleLinear( out, outcount, in, samples, channels, stepscale );
+	}
 
-			chunk->sndChunk[part] = sample;
+	chunk = NULL;
+	for ( i = 0; i < total; i += part ) {
+		part = MIN( total - i, SND_CHUNK_SIZE );
+		newchunk = SND_malloc();
+		if ( chunk == NULL ) {
+			sfx->soundData = newchunk;
+		} else {
+			chunk->next = newchunk;
 		}
+		chunk = newchunk;
+		Com_Memcpy( chunk->sndChunk, out + i, part * sizeof( short ) );
+	}
+
+	if ( out != in ) {
+		Hunk_FreeTempMemory( out );
+	}
+	if ( in != (short *)data ) {
+		Hunk_FreeTempMemory( in );
 	}
 
 	return outcount;
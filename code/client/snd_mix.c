@@ -24,9 +24,43 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "client.h"
 #include "snd_local.h"
 
+#if idx64 || defined(__SSE2__)
+#define MIX_SIMD_SSE41
+#include <smmintrin.h>
+#ifdef _MSC_VER
+#define SSE41_FUNC
+#else
+#define SSE41_FUNC __attribute__((target("sse4.1")))
+#endif
+#if idx64 && ( defined(__clang__) || ( defined(__GNUC__) && __GNUC__ >= 5 ) || ( defined(_MSC_VER) && _MSC_VER >= 1800 ) )
+#define MIX_SIMD_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+#endif
+#endif
+
 static portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
 static int snd_vol;
 
+// adds count 16-bit frames scaled by the 8.8 volumes, (data * vol) >> 8 as the scalar code
+typedef void (*mixKernel_t)( portable_samplepair_t *samp, const short *samples, int count, int leftvol, int rightvol );
+
+// interpolates frames from the 16.16 input position in *index/*frac as long as the next
+// input frame stays inside the sound, returns the number of frames written
+typedef int (*resampleKernel_t)( short *out, int outcount, const short *in, int incount, int step, int *index, int *frac );
+
+typedef struct {
+	const char	*name;
+	mixKernel_t	mono;
+	mixKernel_t	stereo;
+	resampleKernel_t resampleMono;
+	resampleKernel_t resampleStereo;
+} mixKernels_t;
+
 // bk001119 - these not static, required by unix/snd_mixa.s
 int		*snd_p;
 int		snd_linear_count;
@@ -419,11 +453,10 @@ CHANNEL MIXING
 
 ===============================================================================
 */
-static void S_PaintChannelFrom16_scalar( channel_t *ch, const sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
+static void S_PaintChannelFrom16_scalar( const channel_t *ch, const sfx_t *sc, int count, int sampleOffset, portable_samplepair_t *samp, int vol ) {
 	int						data, aoff, boff;
 	int						leftvol, rightvol;
 	int						i, j;
-	portable_samplepair_t	*samp;
 	sndBuffer				*chunk;
 	short					*samples;
 	float					ooff, fdata[2], fdiv, fleftvol, frightvol;
@@ -432,8 +465,6 @@ static void S_PaintChannelFrom16_scalar( channel_t *ch, const sfx_t *sc, int cou
 		return;
 	}
 
-	samp = &paintbuffer[ bufferOffset ];
-
 	if (ch->doppler) {
 		sampleOffset = sampleOffset*ch->oldDopplerScale;
 	}
@@ -456,8 +487,8 @@ static void S_PaintChannelFrom16_scalar( channel_t *ch, const sfx_t *sc, int cou
 	}
 
 	if (!ch->doppler || ch->dopplerScale==1.0f) {
-		leftvol = ch->leftvol*snd_vol;
-		rightvol = ch->rightvol*snd_vol;
+		leftvol = ch->leftvol*vol;
+		rightvol = ch->rightvol*vol;
 		samples = chunk->sndChunk;
 		for ( i=0 ; i<count ; i++ ) {
 			data  = samples[sampleOffset++];
@@ -478,8 +509,8 @@ static void S_PaintChannelFrom16_scalar( channel_t *ch, const sfx_t *sc, int cou
 			}
 		}
 	} else {
-		fleftvol = ch->leftvol*snd_vol;
-		frightvol = ch->rightvol*snd_vol;
+		fleftvol = ch->leftvol*vol;
+		frightvol = ch->rightvol*vol;
 
 		ooff = sampleOffset;
 		samples = chunk->sndChunk;
@@ -515,9 +546,567 @@ static void S_PaintChannelFrom16_scalar( channel_t *ch, const sfx_t *sc, int cou
 }
 
 
+
+
+/*
+===============================================================================
+
+16-bit mixing kernels
+
+Non-doppler 16-bit channels are mixed in runs that end at chunk
+boundaries, by kernels that produce exactly the scalar results.
+
+===============================================================================
+*/
+
+static void S_Mix16Mono_scalar( portable_samplepair_t *samp, const short *samples, int count, int leftvol, int rightvol ) {
+	int		i, data;
+
+	for ( i = 0; i < count; i++ ) {
+		data = samples[i];
+		samp[i].left += (data * leftvol)>>8;
+		samp[i].right += (data * rightvol)>>8;
+	}
+}
+
+
+static void S_Mix16Stereo_scalar( portable_samplepair_t *samp, const short *samples, int count, int leftvol, int rightvol ) {
+	int		i;
+
+	for ( i = 0; i < count; i++ ) {
+		samp[i].left += (samples[i*2+0] * leftvol)>>8;
+		samp[i].right += (samples[i*2+1] * rightvol)>>8;
+	}
+}
+
+
+#ifdef MIX_SIMD_SSE41
+SSE41_FUNC static void S_Mix16Mono_SSE41( portable_samplepair_t *samp, const short *samples, int count, int leftvol, int rightvol ) {
+	const __m128i lv = _mm_set1_epi32( leftvol );
+	const __m128i rv = _mm_set1_epi32( rightvol );
+	__m128i	*dst, s, l, r;
+	int		i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		s = _mm_cvtepi16_epi32( _mm_loadl_epi64( (const __m128i *)( samples + i ) ) );
+		l = _mm_srai_epi32( _mm_mullo_epi32( s, lv ), 8 );
+		r = _mm_srai_epi32( _mm_mullo_epi32( s, rv ), 8 );
+		dst = (__m128i *)( samp + i );
+		_mm_storeu_si128( dst + 0, _mm_add_epi32( _mm_loadu_si128( dst + 0 ), _mm_unpacklo_epi32( l, r ) ) );
+		_mm_storeu_si128( dst + 1, _mm_add_epi32( _mm_loadu_si128( dst + 1 ), _mm_unpackhi_epi32( l, r ) ) );
+	}
+
+	S_Mix16Mono_scalar( samp + i, samples + i, count - i, leftvol, rightvol );
+}
+
+
+SSE41_FUNC static void S_Mix16Stereo_SSE41( portable_samplepair_t *samp, const short *samples, int count, int leftvol, int rightvol ) {
+	const __m128i vol = _mm_setr_epi32( leftvol, rightvol, leftvol, rightvol );
+	__m128i	*dst, s, a, b;
+	int		i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		s = _mm_loadu_si128( (const __m128i *)( samples + i*2 ) );
+		a = _mm_srai_epi32( _mm_mullo_epi32( _mm_cvtepi16_epi32( s ), vol ), 8 );
+		b = _mm_srai_epi32( _mm_mullo_epi32( _mm_cvtepi16_epi32( _mm_srli_si128( s, 8 ) ), vol ), 8 );
+		dst = (__m128i *)( samp + i );
+		_mm_storeu_si128( dst + 0, _mm_add_epi32( _mm_loadu_si128( dst + 0 ), a ) );
+		_mm_storeu_si128( dst + 1, _mm_add_epi32( _mm_loadu_si128( dst + 1 ), b ) );
+	}
+
+	S_Mix16Stereo_scalar( samp + i, samples + i*2, count - i, leftvol, rightvol );
+}
+#endif // MIX_SIMD_SSE41
+
+
+#ifdef MIX_SIMD_AVX2
+AVX2_FUNC static void S_Mix16Mono_AVX2( portable_samplepair_t *samp, const short *samples, int count, int leftvol, int rightvol ) {
+	const __m256i lv = _mm256_set1_epi32( leftvol );
+	const __m256i rv = _mm256_set1_epi32( rightvol );
+	__m256i	*dst, s, l, r, lo, hi;
+	int		i;
+
+	for ( i = 0; i + 8 <= count; i += 8 ) {
+		s = _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i *)( samples + i ) ) );
+		l = _mm256_srai_epi32( _mm256_mullo_epi32( s, lv ), 8 );
+		r = _mm256_srai_epi32( _mm256_mullo_epi32( s, rv ), 8 );
+		// unpacks work within 128-bit lanes, put the frames back in order
+		lo = _mm256_unpacklo_epi32( l, r );
+		hi = _mm256_unpackhi_epi32( l, r );
+		dst = (__m256i *)( samp + i );
+		_mm256_storeu_si256( dst + 0, _mm256_add_epi32( _mm256_loadu_si256( dst + 0 ), _mm256_permute2x128_si256( lo, hi, 0x20 ) ) );
+		_mm256_storeu_si256( dst + 1, _mm256_add_epi32( _mm256_loadu_si256( dst + 1 ), _mm256_permute2x128_si256( lo, hi, 0x31 ) ) );
+	}
+
+	S_Mix16Mono_scalar( samp + i, samples + i, count - i, leftvol, rightvol );
+}
+
+
+AVX2_FUNC static void S_Mix16Stereo_AVX2( portable_samplepair_t *samp, const short *samples, int count, int leftvol, int rightvol ) {
+	const __m256i vol = _mm256_setr_epi32( leftvol, rightvol, leftvol, rightvol, leftvol, rightvol, leftvol, rightvol );
+	__m256i	*dst, a, b;
+	int		i;
+
+	for ( i = 0; i + 8 <= count; i += 8 ) {
+		a = _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i *)( samples + i*2 ) ) );
+		b = _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i *)( samples + i*2 + 8 ) ) );
+		a = _mm256_srai_epi32( _mm256_mullo_epi32( a, vol ), 8 );
+		b = _mm256_srai_epi32( _mm256_mullo_epi32( b, vol ), 8 );
+		dst = (__m256i *)( samp + i );
+		_mm256_storeu_si256( dst + 0, _mm256_add_epi32( _mm256_loadu_si256( dst + 0 ), a ) );
+		_mm256_storeu_si256( dst + 1, _mm256_add_epi32( _mm256_loadu_si256( dst + 1 ), b ) );
+	}
+
+	S_Mix16Stereo_scalar( samp + i, samples + i*2, count - i, leftvol, rightvol );
+}
+#endif // MIX_SIMD_AVX2
+
+
+/*
+===============================================================================
+
+Linear resampling kernels
+
+Sounds are resampled once at load time with the same 16.16 fixed point
+stepping as the scalar code. The kernels stop before the last input frame,
+which the scalar code repeats.
+
+===============================================================================
+*/
+
+#ifdef MIX_SIMD_SSE41
+SSE41_FUNC static int S_ResampleMono_SSE41( short *out, int outcount, const short *in, int incount, int step, int *index, int *frac ) {
+	const __m128i steps = _mm_setr_epi32( 0, step, step*2, step*3 );
+	const __m128i mask = _mm_set1_epi32( 0xFFFF );
+	__m128i	p, f, a, b;
+	int		i, idx, fr, i1, i2, i3;
+
+	idx = *index;
+	fr = *frac;
+
+	for ( i = 0; i + 4 <= outcount; i += 4 ) {
+		i3 = idx + ( ( fr + step*3 ) >> 16 );
+		if ( i3 + 1 >= incount ) {
+			break;
+		}
+		i1 = idx + ( ( fr + step ) >> 16 );
+		i2 = idx + ( ( fr + step*2 ) >> 16 );
+
+		p = _mm_add_epi32( _mm_set1_epi32( fr ), steps );
+		f = _mm_srli_epi32( _mm_and_si128( p, mask ), 1 );
+		a = _mm_setr_epi32( in[idx], in[i1], in[i2], in[i3] );
+		b = _mm_setr_epi32( in[idx+1], in[i1+1], in[i2+1], in[i3+1] );
+		a = _mm_add_epi32( a, _mm_srai_epi32( _mm_mullo_epi32( _mm_sub_epi32( b, a ), f ), 15 ) );
+		_mm_storel_epi64( (__m128i *)( out + i ), _mm_packs_epi32( a, a ) );
+
+		fr += step * 4;
+		idx += fr >> 16;
+		fr &= 0xFFFF;
+	}
+
+	*index = idx;
+	*frac = fr;
+	return i;
+}
+
+
+SSE41_FUNC static int S_ResampleStereo_SSE41( short *out, int outcount, const short *in, int incount, int step, int *index, int *frac ) {
+	const __m128i mask = _mm_set1_epi32( 0xFFFF );
+	__m128i	p01, p23, a01, b01, a23, b23;
+	int		i, idx, fr, i1, i2, i3;
+
+	idx = *index;
+	fr = *frac;
+
+	for ( i = 0; i + 4 <= outcount; i += 4 ) {
+		i3 = idx + ( ( fr + step*3 ) >> 16 );
+		if ( i3 + 1 >= incount ) {
+			break;
+		}
+		i1 = idx + ( ( fr + step ) >> 16 );
+		i2 = idx + ( ( fr + step*2 ) >> 16 );
+
+		// left and right of two frames per vector
+		p01 = _mm_setr_epi32( fr, fr, fr + step, fr + step );
+		p23 = _mm_add_epi32( p01, _mm_set1_epi32( step*2 ) );
+		p01 = _mm_srli_epi32( _mm_and_si128( p01, mask ), 1 );
+		p23 = _mm_srli_epi32( _mm_and_si128( p23, mask ), 1 );
+		a01 = _mm_setr_epi32( in[idx*2], in[idx*2+1], in[i1*2], in[i1*2+1] );
+		b01 = _mm_setr_epi32( in[idx*2+2], in[idx*2+3], in[i1*2+2], in[i1*2+3] );
+		a23 = _mm_setr_epi32( in[i2*2], in[i2*2+1], in[i3*2], in[i3*2+1] );
+		b23 = _mm_setr_epi32( in[i2*2+2], in[i2*2+3], in[i3*2+2], in[i3*2+3] );
+		a01 = _mm_add_epi32( a01, _mm_srai_epi32( _mm_mullo_epi32( _mm_sub_epi32( b01, a01 ), p01 ), 15 ) );
+		a23 = _mm_add_epi32( a23, _mm_srai_epi32( _mm_mullo_epi32( _mm_sub_epi32( b23, a23 ), p23 ), 15 ) );
+		_mm_storeu_si128( (__m128i *)( out + i*2 ), _mm_packs_epi32( a01, a23 ) );
+
+		fr += step * 4;
+		idx += fr >> 16;
+		fr &= 0xFFFF;
+	}
+
+	*index = idx;
+	*frac = fr;
+	return i;
+}
+#endif // MIX_SIMD_SSE41
+
+
+#ifdef MIX_SIMD_AVX2
+AVX2_FUNC static int S_ResampleMono_AVX2( short *out, int outcount, const short *in, int incount, int step, int *index, int *frac ) {
+	const __m256i steps = _mm256_setr_epi32( 0, step, step*2, step*3, step*4, step*5, step*6, step*7 );
+	const __m256i mask = _mm256_set1_epi32( 0xFFFF );
+	__m256i	p, f, g, a, b;
+	int		i, idx, fr;
+
+	idx = *index;
+	fr = *frac;
+
+	for ( i = 0; i + 8 <= outcount; i += 8 ) {
+		if ( idx + ( ( fr + step*7 ) >> 16 ) + 1 >= incount ) {
+			break;
+		}
+
+		p = _mm256_add_epi32( _mm256_set1_epi32( fr ), steps );
+		f = _mm256_srli_epi32( _mm256_and_si256( p, mask ), 1 );
+		// each dword holds a frame and the one after it
+		g = _mm256_i32gather_epi32( (const int *)( in + idx ), _mm256_srli_epi32( p, 16 ), 2 );
+		a = _mm256_srai_epi32( _mm256_slli_epi32( g, 16 ), 16 );
+		b = _mm256_srai_epi32( g, 16 );
+		a = _mm256_add_epi32( a, _mm256_srai_epi32( _mm256_mullo_epi32( _mm256_sub_epi32( b, a ), f ), 15 ) );
+		// packs work within 128-bit lanes
+		a = _mm256_permute4x64_epi64( _mm256_packs_epi32( a, a ), 0x08 );
+		_mm_storeu_si128( (__m128i *)( out + i ), _mm256_castsi256_si128( a ) );
+
+		fr += step * 8;
+		idx += fr >> 16;
+		fr &= 0xFFFF;
+	}
+
+	*index = idx;
+	*frac = fr;
+	return i;
+}
+
+
+AVX2_FUNC static int S_ResampleStereo_AVX2( short *out, int outcount, const short *in, int incount, int step, int *index, int *frac ) {
+	const __m256i steps = _mm256_setr_epi32( 0, step, step*2, step*3, step*4, step*5, step*6, step*7 );
+	const __m256i mask = _mm256_set1_epi32( 0xFFFF );
+	__m256i	p, f, o, ga, gb, al, ar, bl, br;
+	int		i, idx, fr;
+
+	idx = *index;
+	fr = *frac;
+
+	for ( i = 0; i + 8 <= outcount; i += 8 ) {
+		if ( idx + ( ( fr + step*7 ) >> 16 ) + 1 >= incount ) {
+			break;
+		}
+
+		p = _mm256_add_epi32( _mm256_set1_epi32( fr ), steps );
+		f = _mm256_srli_epi32( _mm256_and_si256( p, mask ), 1 );
+		o = _mm256_srli_epi32( p, 16 );
+		// each dword holds the left and right sample of a frame
+		ga = _mm256_i32gather_epi32( (const int *)( in + idx*2 ), o, 4 );
+		gb = _mm256_i32gather_epi32( (const int *)( in + idx*2 + 2 ), o, 4 );
+		al = _mm256_srai_epi32( _mm256_slli_epi32( ga, 16 ), 16 );
+		ar = _mm256_srai_epi32( ga, 16 );
+		bl = _mm256_srai_epi32( _mm256_slli_epi32( gb, 16 ), 16 );
+		br = _mm256_srai_epi32( gb, 16 );
+		al = _mm256_add_epi32( al, _mm256_srai_epi32( _mm256_mullo_epi32( _mm256_sub_epi32( bl, al ), f ), 15 ) );
+		ar = _mm256_add_epi32( ar, _mm256_srai_epi32( _mm256_mullo_epi32( _mm256_sub_epi32( br, ar ), f ), 15 ) );
+		o = _mm256_or_si256( _mm256_and_si256( al, mask ), _mm256_slli_epi32( ar, 16 ) );
+		_mm256_storeu_si256( (__m256i *)( out + i*2 ), o );
+
+		fr += step * 8;
+		idx += fr >> 16;
+		fr &= 0xFFFF;
+	}
+
+	*index = idx;
+	*frac = fr;
+	return i;
+}
+#endif // MIX_SIMD_AVX2
+
+
+static const mixKernels_t mixKernelsScalar = { "scalar", S_Mix16Mono_scalar, S_Mix16Stereo_scalar, NULL, NULL };
+#ifdef MIX_SIMD_SSE41
+static const mixKernels_t mixKernelsSSE41 = { "SSE4.1", S_Mix16Mono_SSE41, S_Mix16Stereo_SSE41, S_ResampleMono_SSE41, S_ResampleStereo_SSE41 };
+#endif
+#ifdef MIX_SIMD_AVX2
+static const mixKernels_t mixKernelsAVX2 = { "AVX2", S_Mix16Mono_AVX2, S_Mix16Stereo_AVX2, S_ResampleMono_AVX2, S_ResampleStereo_AVX2 };
+#endif
+
+static const mixKernels_t *mixKernels = &mixKernelsScalar;
+
+
+/*
+===================
+S_BestMixKernels
+===================
+*/
+static const mixKernels_t *S_BestMixKernels( void ) {
+#ifdef MIX_SIMD_AVX2
+	if ( CPU_Flags & CPU_AVX2 )
+		return &mixKernelsAVX2;
+#endif
+#ifdef MIX_SIMD_SSE41
+	if ( CPU_Flags & CPU_SSE41 )
+		return &mixKernelsSSE41;
+#endif
+	return &mixKernelsScalar;
+}
+
+
+/*
+================
+S_ResampleWith
+
+Linear interpolation in 16.16 fixed point, frames past the end repeat the last one
+================
+*/
+static void S_ResampleWith( const mixKernels_t *k, short *out, int outcount, const short *in, int incount, int channels, float stepscale ) {
+	resampleKernel_t resample;
+	int		i, j, a, b;
+	int		index, next, frac, step;
+
+	step = stepscale * 65536.0f;
+	index = 0;
+	frac = 0;
+
+	resample = ( channels == 1 ) ? k->resampleMono : ( channels == 2 ) ? k->resampleStereo : NULL;
+	if ( resample ) {
+		i = resample( out, outcount, in, incount, step, &index, &frac );
+	} else {
+		i = 0;
+	}
+
+	for ( ; i < outcount; i++ ) {
+		next = ( index + 1 < incount ) ? index + 1 : index;
+		for ( j = 0; j < channels; j++ ) {
+			a = in[index*channels+j];
+			b = in[next*channels+j];
+			out[i*channels+j] = a + ( ( ( b - a ) * ( frac >> 1 ) ) >> 15 );
+		}
+		frac += step;
+		index += frac >> 16;
+		frac &= 0xFFFF;
+		if ( index >= incount ) {
+			index = incount - 1;
+		}
+	}
+}
+
+
+/*
+================
+S_ResampleLinear
+================
+*/
+void S_ResampleLinear( short *out, int outcount, const short *in, int incount, int channels, float stepscale ) {
+	S_ResampleWith( s_mixSIMD->integer ? S_BestMixKernels() : &mixKernelsScalar, out, outcount, in, incount, channels, stepscale );
+}
+
+
+/*
+===================
+S_MixChannelFrom16
+===================
+*/
+static void S_MixChannelFrom16( const mixKernels_t *k, const channel_t *ch, const sfx_t *sc, int count, int sampleOffset, portable_samplepair_t *samp, int vol ) {
+	const sndBuffer *chunk;
+	mixKernel_t	mix;
+	int			run;
+
+	if ( sc->soundChannels <= 0 ) {
+		return;
+	}
+
+	// resampling for doppler stays scalar
+	if ( ch->doppler && ch->dopplerScale != 1.0f ) {
+		S_PaintChannelFrom16_scalar( ch, sc, count, sampleOffset, samp, vol );
+		return;
+	}
+
+	if ( ch->doppler ) {
+		sampleOffset = sampleOffset*ch->oldDopplerScale;
+	}
+
+	sampleOffset *= sc->soundChannels;
+	mix = ( sc->soundChannels == 2 ) ? k->stereo : k->mono;
+
+	chunk = sc->soundData;
+	while ( sampleOffset >= SND_CHUNK_SIZE ) {
+		chunk = chunk->next;
+		sampleOffset -= SND_CHUNK_SIZE;
+		if ( !chunk ) {
+			chunk = sc->soundData;
+		}
+	}
+
+	while ( count > 0 ) {
+		run = ( SND_CHUNK_SIZE - sampleOffset ) / sc->soundChannels;
+		if ( run > count ) {
+			run = count;
+		}
+
+		mix( samp, chunk->sndChunk + sampleOffset, run, ch->leftvol*vol, ch->rightvol*vol );
+
+		samp += run;
+		count -= run;
+		sampleOffset = 0;
+		chunk = chunk->next;
+		if ( !chunk ) {
+			chunk = sc->soundData;
+		}
+	}
+}
+
+
 static void S_PaintChannelFrom16( channel_t *ch, const sfx_t *sc, int count, int sampleOffset, int bufferOffset ) 
 {
-	S_PaintChannelFrom16_scalar( ch, sc, count, sampleOffset, bufferOffset );
+	S_MixChannelFrom16( mixKernels, ch, sc, count, sampleOffset, &paintbuffer[ bufferOffset ], snd_vol );
+}
+
+
+/*
+===================
+S_MixBenchmark_f
+
+Mixes a full paint buffer from a set of synthetic channels and resamples
+a synthetic sound with every kernel set available, and checks that they
+match the scalar code
+===================
+*/
+#define MIX_BENCH_CHANNELS	32
+#define MIX_BENCH_CHUNKS	16
+#define MIX_BENCH_SAMPLES	( MIX_BENCH_CHUNKS * SND_CHUNK_SIZE )
+#define MIX_BENCH_STEP		( 22050.0f / 48000.0f )
+
+void S_MixBenchmark_f( void ) {
+	static portable_samplepair_t reference[PAINTBUFFER_SIZE], result[PAINTBUFFER_SIZE];
+	const mixKernels_t *sets[3];
+	sndBuffer	*chunks;
+	short		*noise, *resampled[2];
+	channel_t	ch[MIX_BENCH_CHANNELS];
+	sfx_t		sfx[2];
+	int			numSets, iterations, vol;
+	int			c, i, n, count, set, pass;
+	int			total, outcount;
+	int64_t		start, elapsed, scalarTime;
+	unsigned	seed;
+
+	iterations = atoi( Cmd_Argv( 1 ) );
+	if ( iterations <= 0 ) {
+		iterations = 100;
+	}
+
+	chunks = malloc( MIX_BENCH_CHUNKS * sizeof( *chunks ) );
+	if ( !chunks ) {
+		return;
+	}
+
+	// one looping chain of noise for both layouts
+	seed = 0x1234;
+	for ( c = 0; c < MIX_BENCH_CHUNKS; c++ ) {
+		for ( i = 0; i < SND_CHUNK_SIZE; i++ ) {
+			seed = seed * 1103515245 + 12345;
+			chunks[c].sndChunk[i] = (short)( seed >> 16 );
+		}
+		chunks[c].next = ( c < MIX_BENCH_CHUNKS - 1 ) ? &chunks[c+1] : NULL;
+	}
+
+	Com_Memset( sfx, 0, sizeof( sfx ) );
+	for ( i = 0; i < 2; i++ ) {
+		sfx[i].soundData = chunks;
+		sfx[i].soundChannels = i + 1;
+		sfx[i].soundLength = MIX_BENCH_CHUNKS * SND_CHUNK_SIZE / ( i + 1 );
+	}
+
+	Com_Memset( ch, 0, sizeof( ch ) );
+	for ( c = 0; c < MIX_BENCH_CHANNELS; c++ ) {
+		ch[c].leftvol = 255 - c * 5;
+		ch[c].rightvol = 64 + c * 5;
+		ch[c].thesfx = &sfx[ c & 1 ];
+		ch[c].startSample = c * 331;
+	}
+
+	numSets = 0;
+	sets[numSets++] = &mixKernelsScalar;
+#ifdef MIX_SIMD_SSE41
+	if ( CPU_Flags & CPU_SSE41 )
+		sets[numSets++] = &mixKernelsSSE41;
+#endif
+#ifdef MIX_SIMD_AVX2
+	if ( CPU_Flags & CPU_AVX2 )
+		sets[numSets++] = &mixKernelsAVX2;
+#endif
+
+	vol = 255;
+	scalarTime = 1;
+	Com_Printf( "%i channels x %i samples, %i passes:\n", MIX_BENCH_CHANNELS, PAINTBUFFER_SIZE, iterations );
+
+	for ( set = 0; set < numSets; set++ ) {
+		start = Sys_Microseconds();
+		for ( pass = 0; pass < iterations; pass++ ) {
+			Com_Memset( result, 0, sizeof( result ) );
+			for ( c = 0; c < MIX_BENCH_CHANNELS; c++ ) {
+				// wrap around the sound like a looping channel
+				i = ( pass * PAINTBUFFER_SIZE + ch[c].startSample ) % ch[c].thesfx->soundLength;
+				for ( n = 0; n < PAINTBUFFER_SIZE; n += count ) {
+					count = MIN( PAINTBUFFER_SIZE - n, ch[c].thesfx->soundLength - i );
+					S_MixChannelFrom16( sets[set], &ch[c], ch[c].thesfx, count, i, result + n, vol );
+					i = 0;
+				}
+			}
+		}
+		elapsed = Sys_Microseconds() - start;
+
+		if ( set == 0 ) {
+			scalarTime = MAX( elapsed, 1 );
+			Com_Memcpy( reference, result, sizeof( reference ) );
+			Com_Printf( "%8s: %7.2f msec\n", sets[set]->name, elapsed / 1000.0 );
+		} else {
+			Com_Printf( "%8s: %7.2f msec, %.2fx, %s\n", sets[set]->name, elapsed / 1000.0, (double)scalarTime / MAX( elapsed, 1 ),
+				memcmp( reference, result, sizeof( result ) ) ? S_COLOR_RED "MISMATCH" : "matches scalar" );
+		}
+	}
+
+	// resample the noise as a 22050 Hz sound to 48000 Hz, both layouts
+	total = MIX_BENCH_SAMPLES / MIX_BENCH_STEP + 2;
+	noise = malloc( ( MIX_BENCH_SAMPLES + total * 2 ) * sizeof( short ) );
+	if ( !noise ) {
+		free( chunks );
+		return;
+	}
+	resampled[0] = noise + MIX_BENCH_SAMPLES;
+	resampled[1] = resampled[0] + total;
+	for ( c = 0; c < MIX_BENCH_CHUNKS; c++ ) {
+		Com_Memcpy( noise + c * SND_CHUNK_SIZE, chunks[c].sndChunk, SND_CHUNK_SIZE * sizeof( short ) );
+	}
+
+	for ( c = 1; c <= 2; c++ ) {
+		outcount = ( MIX_BENCH_SAMPLES / c ) / MIX_BENCH_STEP;
+		Com_Printf( "resampling %i %s frames to %i, %i passes:\n", MIX_BENCH_SAMPLES / c, c == 1 ? "mono" : "stereo", outcount, iterations );
+		for ( set = 0; set < numSets; set++ ) {
+			start = Sys_Microseconds();
+			for ( pass = 0; pass < iterations; pass++ ) {
+				S_ResampleWith( sets[set], resampled[ set != 0 ], outcount, noise, MIX_BENCH_SAMPLES / c, c, MIX_BENCH_STEP );
+			}
+			elapsed = Sys_Microseconds() - start;
+
+			if ( set == 0 ) {
+				scalarTime = MAX( elapsed, 1 );
+				Com_Printf( "%8s: %7.2f msec\n", sets[set]->name, elapsed / 1000.0 );
+			} else {
+				Com_Printf( "%8s: %7.2f msec, %.2fx, %s\n", sets[set]->name, elapsed / 1000.0, (double)scalarTime / MAX( elapsed, 1 ),
+					memcmp( resampled[0], resampled[1], outcount * c * sizeof( short ) ) ? S_COLOR_RED "MISMATCH" : "matches scalar" );
+			}
+		}
+	}
+
+	free( noise );
+	free( chunks );
 }
 
 
@@ -684,6 +1273,7 @@ void S_PaintChannels( int endtime ) {
 	byte	*buffer;
 
 	snd_vol = s_volume->value * 255;
+	mixKernels = s_mixSIMD->integer ? S_BestMixKernels() : &mixKernelsScalar;
 
 	if ( (!gw_active && !gw_minimized && s_muteWhenUnfocused->integer) || (gw_minimized && s_muteWhenMinimized->integer) ) {
 		buffer = dma_buffer2;
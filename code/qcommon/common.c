@@ -40,6 +40,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 const int demo_protocols[] = { 66, 67, OLD_PROTOCOL_VERSION, NEW_PROTOCOL_VERSION, 0 };
 
 #define USE_MULTI_SEGMENT // allocate additional zone segments on demand
+#define USE_ZONE_SLABS // serve small zone allocations from size-class slabs
 
 #ifdef DEDICATED
 #define MIN_COMHUNKMEGS		48
@@ -228,6 +229,12 @@ void FORMAT_PRINTF(1, 2) QDECL Com_Printf( const char *fmt, ... ) {
 				time_t aclock;
 				char timestr[32];
 
+				// keep disk writes of buffered logs off the frame, unbuffered
+				// ones stay synchronous since nothing drains the async queue
+				// when we are killed by a signal
+				if ( !( mode & 1 ) )
+					FS_SetAsync( logfile );
+
 				time( &aclock );
 				newtime = localtime( &aclock );
 				strftime( timestr, sizeof( timestr ), "%a %b %d %X %Y", newtime );
@@ -900,6 +907,16 @@ int Com_FilterPath( const char *filter, const char *name )
 }
 
 
+/*
+================
+Com_CPUFlags
+================
+*/
+int Com_CPUFlags( void ) {
+	return CPU_Flags;
+}
+
+
 /*
 ================
 Com_RealTime
@@ -1015,6 +1032,7 @@ typedef struct memblock_s {
 	int			size;	// including the header and possibly tiny fragments
 	memtag_t	tag;	// a tag of 0 is a free block
 	int			id;		// should be ZONEID
+	int			sampled;	// registered with the allocation profiler
 #ifdef ZONE_DEBUG
 	zonedebug_t d;
 #endif
@@ -1052,6 +1070,9 @@ static memzone_t *mainzone;
 // fragment the main zone (think of cvar and cmd strings)
 static memzone_t *smallzone;
 
+// protects zone lists and slab pages, thread caches are lock-free
+static volatile int zoneLock;
+
 
 #ifdef USE_MULTI_SEGMENT
 
@@ -1070,6 +1091,7 @@ static void RemoveFree( memblock_t *block )
 
 #ifdef ZONE_DEBUG
 	if ( fb->next == NULL || fb->prev == NULL || fb->next == fb || fb->prev == fb ) {
+		Com_SpinUnlock( &zoneLock ); // called with zone lock held
 		Com_Error( ERR_FATAL, "RemoveFree: bad pointers fb->next: %p, fb->prev: %p\n", fb->next, fb->prev );
 	}
 #endif
@@ -1107,6 +1129,7 @@ static void InsertFree( memzone_t *zone, memblock_t *block )
 
 #ifdef ZONE_DEBUG
 	if ( block->size < sizeof( *fb ) + sizeof( *block ) ) {
+		Com_SpinUnlock( &zoneLock ); // called with zone lock held
 		Com_Error( ERR_FATAL, "InsertFree: bad block size: %i\n", block->size );
 	}
 #endif
@@ -1145,6 +1168,7 @@ static freeblock_t *NewBlock( memzone_t *zone, int size )
 
 	sep = (memblock_t *) calloc( alloc_size, 1 );
 	if ( sep == NULL ) {
+		Com_SpinUnlock( &zoneLock ); // called with zone lock held
 		Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
 			size, zone == smallzone ? "small" : "main" );
 		return NULL;
@@ -1238,6 +1262,354 @@ static memblock_t *SearchFree( memzone_t *zone, int size )
 #endif // USE_MULTI_SEGMENT
 
 
+#ifdef USE_ZONE_SLABS
+/*
+==============================================================================
+
+SIZE-CLASS SLABS
+
+Small blocks are carved from fixed-size pages holding a single size class,
+so neither allocation nor release has to search or coalesce anything.
+
+Every thread keeps a magazine of free blocks per size class, magazines are
+refilled from and drained to the pages in batches under the zone lock, so
+most Z_Malloc/Z_Free calls do not touch any shared state at all.
+
+Slab blocks keep the regular memblock_t header, block->prev points to the
+owning page and block->next links free blocks within that page.
+
+==============================================================================
+*/
+
+#define SLABID			0x1d4a12
+#define SLAB_PAGE_SIZE	(64*1024)
+#define SLAB_MAX_SIZE	1024	// largest block, including header, served from slabs
+#define SLAB_MAGAZINE	32		// free blocks cached per thread and size class
+#define SLAB_BATCH		(SLAB_MAGAZINE/2)
+
+static const int slabSizes[] = {
+	48, 64, 80, 96, 112, 128, 160, 192, 224,
+	256, 320, 384, 448, 512, 640, 768, 896, 1024
+};
+
+#define SLAB_CLASSES ARRAY_LEN( slabSizes )
+
+typedef struct slabpage_s {
+	struct slabpage_s *next, *prev;			// pages with free blocks
+	struct slabpage_s *nextPage, *prevPage;	// all pages of the size class
+	memblock_t	*freelist;
+	int			cls;
+	int			numFree;	// blocks in page freelist, thread caches are not counted
+	int			tagMask;	// tags allocated from this page since it was empty
+	qboolean	partial;	// linked into partial list
+} slabpage_t;
+
+typedef struct slabclass_s {
+	int			size;
+	int			numBlocks;	// per page
+	slabpage_t	partial;	// list head for pages with free blocks
+	slabpage_t	*pages;
+	int			numPages;
+	int			peakPages;
+} slabclass_t;
+
+typedef struct slabcache_s {
+	memblock_t	*blocks[ SLAB_CLASSES ][ SLAB_MAGAZINE ];
+	int			count[ SLAB_CLASSES ];
+	struct slabcache_s *next;
+} slabcache_t;
+
+static slabclass_t slabClasses[ SLAB_CLASSES ];
+static byte slabIndex[ SLAB_MAX_SIZE / 16 + 1 ];
+
+static slabcache_t *slabCaches; // all thread caches, for statistics
+static Q_THREADLOCAL slabcache_t *slabCache;
+
+
+static void Z_InitSlabs( void )
+{
+	slabclass_t *sc;
+	int i, cls;
+
+	for ( i = 0, cls = 0; i < ARRAY_LEN( slabIndex ); i++ ) {
+		while ( slabSizes[ cls ] < i * 16 )
+			cls++;
+		slabIndex[ i ] = cls;
+	}
+
+	for ( cls = 0; cls < SLAB_CLASSES; cls++ ) {
+		sc = &slabClasses[ cls ];
+		sc->size = slabSizes[ cls ];
+		sc->numBlocks = ( SLAB_PAGE_SIZE - PAD( sizeof( slabpage_t ), 16 ) ) / sc->size;
+		sc->partial.next = sc->partial.prev = &sc->partial;
+	}
+}
+
+
+static void LinkPartial( slabclass_t *sc, slabpage_t *page )
+{
+	page->next = sc->partial.next;
+	page->prev = &sc->partial;
+	page->next->prev = page;
+	sc->partial.next = page;
+	page->partial = qtrue;
+}
+
+
+static void UnlinkPartial( slabpage_t *page )
+{
+	page->prev->next = page->next;
+	page->next->prev = page->prev;
+	page->partial = qfalse;
+}
+
+
+static slabpage_t *NewSlabPage( slabclass_t *sc, int cls )
+{
+	slabpage_t *page;
+	memblock_t *block;
+	byte *base;
+	int i;
+
+	page = (slabpage_t *) malloc( SLAB_PAGE_SIZE );
+	if ( page == NULL ) {
+		return NULL;
+	}
+
+	page->cls = cls;
+	page->tagMask = 0;
+	page->freelist = NULL;
+	page->numFree = sc->numBlocks;
+
+	base = (byte *)page + PAD( sizeof( *page ), 16 );
+	for ( i = sc->numBlocks - 1; i >= 0; i-- ) {
+		block = (memblock_t *)( base + i * sc->size );
+		block->prev = (memblock_t *)page;
+		block->next = page->freelist;
+		block->size = sc->size;
+		block->tag = TAG_FREE;
+		block->id = SLABID;
+		page->freelist = block;
+	}
+
+	page->prevPage = NULL;
+	page->nextPage = sc->pages;
+	if ( sc->pages ) {
+		sc->pages->prevPage = page;
+	}
+	sc->pages = page;
+
+	LinkPartial( sc, page );
+
+	sc->numPages++;
+	if ( sc->numPages > sc->peakPages ) {
+		sc->peakPages = sc->numPages;
+	}
+
+	return page;
+}
+
+
+static void FreeSlabPage( slabclass_t *sc, slabpage_t *page )
+{
+	if ( page->partial ) {
+		UnlinkPartial( page );
+	}
+
+	if ( page->prevPage ) {
+		page->prevPage->nextPage = page->nextPage;
+	} else {
+		sc->pages = page->nextPage;
+	}
+	if ( page->nextPage ) {
+		page->nextPage->prevPage = page->prevPage;
+	}
+
+	sc->numPages--;
+
+	free( page );
+}
+
+
+/*
+================
+ReleaseSlabBlock
+
+Returns block to its page, must be called with zone lock held.
+Returns qtrue if the page became empty and was released to the system.
+================
+*/
+static qboolean ReleaseSlabBlock( memblock_t *block )
+{
+	slabpage_t *page = (slabpage_t *)block->prev;
+	slabclass_t *sc = &slabClasses[ page->cls ];
+
+	block->next = page->freelist;
+	page->freelist = block;
+	page->numFree++;
+
+	if ( page->numFree == sc->numBlocks ) {
+		page->tagMask = 0;
+		// keep the last page around to avoid thrashing
+		if ( sc->numPages > 1 ) {
+			FreeSlabPage( sc, page );
+			return qtrue;
+		}
+	}
+
+	if ( !page->partial ) {
+		LinkPartial( sc, page );
+	}
+
+	return qfalse;
+}
+
+
+static void RefillSlabCache( slabcache_t *cache, int cls )
+{
+	slabclass_t *sc = &slabClasses[ cls ];
+	slabpage_t *page;
+	memblock_t *block;
+	int n;
+
+	n = cache->count[ cls ];
+	while ( n < SLAB_BATCH ) {
+		page = sc->partial.next;
+		if ( page == &sc->partial ) {
+			page = NewSlabPage( sc, cls );
+			if ( page == NULL ) {
+				break;
+			}
+		}
+		block = page->freelist;
+		page->freelist = block->next;
+		if ( --page->numFree == 0 ) {
+			UnlinkPartial( page );
+		}
+		cache->blocks[ cls ][ n++ ] = block;
+	}
+	cache->count[ cls ] = n;
+}
+
+
+static void DrainSlabCache( slabcache_t *cache, int cls, int keep )
+{
+	while ( cache->count[ cls ] > keep ) {
+		ReleaseSlabBlock( cache->blocks[ cls ][ --cache->count[ cls ] ] );
+	}
+}
+
+
+static slabcache_t *Z_SlabCache( void )
+{
+	slabcache_t *cache = slabCache;
+
+	if ( cache == NULL ) {
+		cache = (slabcache_t *) calloc( 1, sizeof( *cache ) );
+		if ( cache == NULL ) {
+			Com_Error( ERR_FATAL, "Z_Malloc: failed to allocate thread cache" );
+		}
+		Com_SpinLock( &zoneLock );
+		cache->next = slabCaches;
+		slabCaches = cache;
+		Com_SpinUnlock( &zoneLock );
+		slabCache = cache;
+	}
+
+	return cache;
+}
+
+
+static memblock_t *Z_SlabAlloc( int size, memtag_t tag )
+{
+	slabcache_t *cache = Z_SlabCache();
+	const int cls = slabIndex[ ( size + 15 ) >> 4 ];
+	slabpage_t *page;
+	memblock_t *block;
+
+	if ( cache->count[ cls ] == 0 ) {
+		Com_SpinLock( &zoneLock );
+		RefillSlabCache( cache, cls );
+		Com_SpinUnlock( &zoneLock );
+		if ( cache->count[ cls ] == 0 ) {
+			Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes slab page", SLAB_PAGE_SIZE );
+		}
+	}
+
+	block = cache->blocks[ cls ][ --cache->count[ cls ] ];
+	block->tag = tag;
+
+	page = (slabpage_t *)block->prev;
+	if ( ( page->tagMask & ( 1 << tag ) ) == 0 ) {
+		Q_AtomicOr( &page->tagMask, 1 << tag );
+	}
+
+	return block;
+}
+
+
+static void Z_SlabFree( memblock_t *block )
+{
+	slabcache_t *cache = Z_SlabCache();
+	const int cls = ((slabpage_t *)block->prev)->cls;
+
+	block->tag = TAG_FREE;
+
+	if ( cache->count[ cls ] == SLAB_MAGAZINE ) {
+		Com_SpinLock( &zoneLock );
+		DrainSlabCache( cache, cls, SLAB_BATCH );
+		Com_SpinUnlock( &zoneLock );
+	}
+
+	cache->blocks[ cls ][ cache->count[ cls ]++ ] = block;
+}
+
+
+/*
+================
+Z_SlabFreeTags
+
+Releases all slab blocks with specified tag, must be called with zone lock held
+================
+*/
+static int Z_SlabFreeTags( memtag_t tag )
+{
+	slabclass_t *sc;
+	slabpage_t *page, *next;
+	memblock_t *block;
+	byte *base;
+	int cls, i, count;
+
+	count = 0;
+	for ( cls = 0; cls < SLAB_CLASSES; cls++ ) {
+		sc = &slabClasses[ cls ];
+		for ( page = sc->pages; page; page = next ) {
+			next = page->nextPage;
+			if ( ( page->tagMask & ( 1 << tag ) ) == 0 ) {
+				continue;
+			}
+			base = (byte *)page + PAD( sizeof( *page ), 16 );
+			for ( i = 0; i < sc->numBlocks; i++ ) {
+				block = (memblock_t *)( base + i * sc->size );
+				if ( block->tag == tag ) {
+					if ( block->sampled ) {
+						Com_MemProfFree( block + 1 );
+					}
+					block->tag = TAG_FREE;
+					count++;
+					if ( ReleaseSlabBlock( block ) ) {
+						break; // page is gone
+					}
+				}
+			}
+		}
+	}
+
+	return count;
+}
+#endif // USE_ZONE_SLABS
+
+
 /*
 ========================
 Z_ClearZone
@@ -1318,6 +1690,42 @@ int Z_AvailableMemory( void ) {
 }
 
 
+/*
+========================
+Z_ReleaseThreadCache
+
+Returns blocks cached by the calling thread, must be called by any
+worker thread that used zone memory before it exits
+========================
+*/
+void Z_ReleaseThreadCache( void ) {
+#ifdef USE_ZONE_SLABS
+	slabcache_t *cache, **prev;
+	int cls;
+
+	cache = slabCache;
+	if ( cache == NULL ) {
+		return;
+	}
+
+	Com_SpinLock( &zoneLock );
+	for ( cls = 0; cls < SLAB_CLASSES; cls++ ) {
+		DrainSlabCache( cache, cls, 0 );
+	}
+	for ( prev = &slabCaches; *prev; prev = &(*prev)->next ) {
+		if ( *prev == cache ) {
+			*prev = cache->next;
+			break;
+		}
+	}
+	Com_SpinUnlock( &zoneLock );
+
+	slabCache = NULL;
+	free( cache );
+#endif
+}
+
+
 static void MergeBlock( memblock_t *curr_free, const memblock_t *next )
 {
 	curr_free->size += next->size;
@@ -1328,40 +1736,15 @@ static void MergeBlock( memblock_t *curr_free, const memblock_t *next )
 
 /*
 ========================
-Z_Free
+Z_FreeBlock
+
+Returns zone block to its zone, must be called with zone lock held
 ========================
 */
-void Z_Free( void *ptr ) {
-	memblock_t	*block, *other;
+static void Z_FreeBlock( memblock_t *block ) {
+	memblock_t	*other;
 	memzone_t *zone;
 
-	if (!ptr) {
-		Com_Error( ERR_DROP, "Z_Free: NULL pointer" );
-	}
-
-	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-	if (block->id != ZONEID) {
-		Com_Error( ERR_FATAL, "Z_Free: freed a pointer without ZONEID" );
-	}
-
-	if (block->tag == TAG_FREE) {
-		Com_Error( ERR_FATAL, "Z_Free: freed a freed pointer" );
-	}
-
-	// if static memory
-#ifdef USE_STATIC_TAGS
-	if (block->tag == TAG_STATIC) {
-		return;
-	}
-#endif
-
-	// check the memory trash tester
-#ifdef USE_TRASH_TEST
-	if ( *(int *)((byte *)block + block->size - 4 ) != ZONEID ) {
-		Com_Error( ERR_FATAL, "Z_Free: memory block wrote past end" );
-	}
-#endif
-
 	if ( block->tag == TAG_SMALL ) {
 		zone = smallzone;
 	} else {
@@ -1370,9 +1753,13 @@ void Z_Free( void *ptr ) {
 
 	zone->used -= block->size;
 
+	if ( block->sampled ) {
+		Com_MemProfFree( block + 1 );
+	}
+
 	// set the block to something that should cause problems
 	// if it is referenced...
-	Com_Memset( ptr, 0xaa, block->size - sizeof( *block ) );
+	Com_Memset( block + 1, 0xaa, block->size - sizeof( *block ) );
 
 	block->tag = TAG_FREE; // mark as free
 	block->id = ZONEID;
@@ -1411,6 +1798,64 @@ void Z_Free( void *ptr ) {
 }
 
 
+/*
+========================
+Z_Free
+========================
+*/
+void Z_Free( void *ptr ) {
+	memblock_t	*block;
+
+	if (!ptr) {
+		Com_Error( ERR_DROP, "Z_Free: NULL pointer" );
+	}
+
+	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
+#ifdef USE_ZONE_SLABS
+	if (block->id != ZONEID && block->id != SLABID) {
+#else
+	if (block->id != ZONEID) {
+#endif
+		Com_Error( ERR_FATAL, "Z_Free: freed a pointer without ZONEID" );
+	}
+
+	if (block->tag == TAG_FREE) {
+		Com_Error( ERR_FATAL, "Z_Free: freed a freed pointer" );
+	}
+
+	// if static memory
+#ifdef USE_STATIC_TAGS
+	if (block->tag == TAG_STATIC) {
+		return;
+	}
+#endif
+
+	// check the memory trash tester
+#ifdef USE_TRASH_TEST
+	if ( *(int *)((byte *)block + block->size - 4 ) != ZONEID ) {
+		Com_Error( ERR_FATAL, "Z_Free: memory block wrote past end" );
+	}
+#endif
+
+#ifdef USE_ZONE_SLABS
+	if ( block->id == SLABID ) {
+		if ( block->sampled ) {
+			Com_MemProfFree( ptr );
+		}
+#ifdef ZONE_DEBUG
+		Com_Memset( ptr, 0xaa, block->size - sizeof( *block ) );
+#endif
+		Z_SlabFree( block );
+		return;
+	}
+#endif
+
+	Com_SpinLock( &zoneLock );
+	Z_FreeBlock( block );
+	Com_SpinUnlock( &zoneLock );
+}
+
+
 /*
 ================
 Z_FreeTags
@@ -1431,13 +1876,26 @@ int Z_FreeTags( memtag_t tag ) {
 	}
 
 	count = 0;
+
+	Com_SpinLock( &zoneLock );
+
+#ifdef USE_ZONE_SLABS
+	count += Z_SlabFreeTags( tag );
+#endif
+
 	for ( block = zone->blocklist.next ; ; ) {
 		if ( block->tag == tag && block->id == ZONEID ) {
 			if ( block->prev->tag == TAG_FREE )
 				freed = block->prev;  // current block will be merged with previous
 			else
 				freed = block; // will leave in place
-			Z_Free( (void*)( block + 1 ) );
+#ifdef USE_TRASH_TEST
+			if ( *(int *)((byte *)block + block->size - 4 ) != ZONEID ) {
+				Com_SpinUnlock( &zoneLock );
+				Com_Error( ERR_FATAL, "Z_FreeTags: memory block wrote past end" );
+			}
+#endif
+			Z_FreeBlock( block );
 			block = freed;
 			count++;
 		}
@@ -1447,6 +1905,8 @@ int Z_FreeTags( memtag_t tag ) {
 		block = block->next;
 	}
 
+	Com_SpinUnlock( &zoneLock );
+
 	return count;
 }
 
@@ -1500,6 +1960,15 @@ void *Z_TagMalloc( int size, memtag_t tag ) {
 
 	size = PAD(size, sizeof(intptr_t));		// align to 32/64 bit boundary
 
+#ifdef USE_ZONE_SLABS
+	if ( size <= SLAB_MAX_SIZE ) {
+		base = Z_SlabAlloc( size, tag );
+		goto done;
+	}
+#endif
+
+	Com_SpinLock( &zoneLock );
+
 #ifdef USE_MULTI_SEGMENT
 	base = SearchFree( zone, size );
 
@@ -1512,6 +1981,7 @@ void *Z_TagMalloc( int size, memtag_t tag ) {
 	do {
 		if ( rover == start ) {
 			// scanned all the way around the list
+			Com_SpinUnlock( &zoneLock );
 #ifdef ZONE_DEBUG
 			Z_LogHeap();
 			Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone: %s, line: %d (%s)",
@@ -1559,6 +2029,12 @@ void *Z_TagMalloc( int size, memtag_t tag ) {
 	base->tag = tag;			// no longer a free block
 	base->id = ZONEID;
 
+	Com_SpinUnlock( &zoneLock );
+
+#ifdef USE_ZONE_SLABS
+done:
+#endif
+
 #ifdef ZONE_DEBUG
 	base->d.label = label;
 	base->d.file = file;
@@ -1571,6 +2047,9 @@ void *Z_TagMalloc( int size, memtag_t tag ) {
 	*(int *)((byte *)base + base->size - 4) = ZONEID;
 #endif
 
+	// only sampled blocks have to be looked up by the profiler on free
+	base->sampled = com_memprofInterval ? Com_MemProfAlloc( base + 1, base->size, tag ) : qfalse;
+
 	return (void *) ( base + 1 );
 }
 
@@ -1714,6 +2193,52 @@ static void Z_LogZoneHeap( memzone_t *zone, const char *name ) {
 }
 
 
+#ifdef USE_ZONE_SLABS
+/*
+========================
+Z_LogSlabHeap
+========================
+*/
+static void Z_LogSlabHeap( void ) {
+	const slabclass_t *sc;
+	const slabpage_t *page;
+	const memblock_t *block;
+	const byte *base;
+	char	buf[4096];
+	int		cls, i, size, numBlocks;
+	int		len;
+
+	if ( logfile == FS_INVALID_HANDLE || !FS_Initialized() )
+		return;
+
+	len = Com_sprintf( buf, sizeof(buf), "\r\n================\r\nSLAB log\r\n================\r\n" );
+	FS_Write( buf, len, logfile );
+
+	for ( cls = 0; cls < SLAB_CLASSES; cls++ ) {
+		sc = &slabClasses[ cls ];
+		size = numBlocks = 0;
+		for ( page = sc->pages; page; page = page->nextPage ) {
+			base = (const byte *)page + PAD( sizeof( *page ), 16 );
+			for ( i = 0; i < sc->numBlocks; i++ ) {
+				block = (const memblock_t *)( base + i * sc->size );
+				if ( block->tag == TAG_FREE )
+					continue;
+#ifdef ZONE_DEBUG
+				len = Com_sprintf( buf, sizeof(buf), "size = %8d: %s, line: %d (%s)\r\n", block->d.allocSize, block->d.file, block->d.line, block->d.label );
+				FS_Write( buf, len, logfile );
+#endif
+				size += block->size;
+				numBlocks++;
+			}
+		}
+		len = Com_sprintf( buf, sizeof( buf ), "%d bytes in %d blocks of class %d in %d pages\r\n", size, numBlocks, sc->size, sc->numPages );
+		FS_Write( buf, len, logfile );
+	}
+	FS_Flush( logfile );
+}
+#endif
+
+
 /*
 ========================
 Z_LogHeap
@@ -1722,6 +2247,9 @@ Z_LogHeap
 void Z_LogHeap( void ) {
 	Z_LogZoneHeap( mainzone, "MAIN" );
 	Z_LogZoneHeap( smallzone, "SMALL" );
+#ifdef USE_ZONE_SLABS
+	Z_LogSlabHeap();
+#endif
 }
 
 #ifdef USE_STATIC_TAGS
@@ -1812,6 +2340,7 @@ Goals:
 
 #define	HUNK_MAGIC	0x89537892
 #define	HUNK_FREE_MAGIC	0x89537893
+#define	HUNK_SAMPLED_MAGIC	0x89537894	// temp block registered with the allocation profiler
 
 typedef struct {
 	unsigned int magic;
@@ -1842,7 +2371,7 @@ static	hunkUsed_t	*hunk_permanent, *hunk_temp;
 static	byte	*s_hunkData = NULL;
 static	int		s_hunkTotal;
 
-static const char *tagName[ TAG_COUNT ] = {
+static const char *tagName[ MEMPROF_TAG_COUNT ] = {
 	"FREE",
 	"GENERAL",
 	"PACK",
@@ -1853,9 +2382,25 @@ static const char *tagName[ TAG_COUNT ] = {
 	"RENDERER",
 	"CLIENTS",
 	"SMALL",
-	"STATIC"
+	"STATIC",
+	"HUNK",
+	"HUNK-TEMP"
 };
 
+
+/*
+=================
+Z_TagName
+=================
+*/
+const char *Z_TagName( int tag ) {
+	if ( (unsigned)tag < ARRAY_LEN( tagName ) ) {
+		return tagName[ tag ];
+	} else {
+		return va( "%i", tag );
+	}
+}
+
 typedef struct zone_stats_s {
 	int	zoneSegments;
 	int zoneBlocks;
@@ -1887,8 +2432,7 @@ static void Zone_Stats( const char *name, const memzone_t *z, qboolean printDeta
 	for ( block = zone->blocklist.next ; ; ) {
 		if ( printDetails ) {
 			int tag = block->tag;
-			Com_Printf( "block:%p  size:%8i  tag: %s\n", (void *)block, block->size,
-				(unsigned)tag < TAG_COUNT ? tagName[ tag ] : va( "%i", tag ) );
+			Com_Printf( "block:%p  size:%8i  tag: %s\n", (void *)block, block->size, Z_TagName( tag ) );
 		}
 		if ( block->tag != TAG_FREE ) {
 			st.zoneBytes += block->size;
@@ -1939,6 +2483,70 @@ static void Zone_Stats( const char *name, const memzone_t *z, qboolean printDeta
 }
 
 
+#ifdef USE_ZONE_SLABS
+typedef struct slab_stats_s {
+	int size;
+	int pages;
+	int peakPages;
+	int blocks;
+	int freeBlocks;
+	int cachedBlocks;
+} slab_stats_t;
+
+
+static void Slab_Stats( qboolean printDetails )
+{
+	slab_stats_t st[ SLAB_CLASSES ];
+	const slabcache_t *cache;
+	const slabclass_t *sc;
+	const slabpage_t *page;
+	int cls, used, pages, usedBlocks, usedBytes, cachedBlocks, freeBlocks;
+
+	// take a snapshot first to not print with the lock held
+	Com_SpinLock( &zoneLock );
+	for ( cls = 0; cls < SLAB_CLASSES; cls++ ) {
+		sc = &slabClasses[ cls ];
+		st[ cls ].size = sc->size;
+		st[ cls ].pages = sc->numPages;
+		st[ cls ].peakPages = sc->peakPages;
+		st[ cls ].blocks = sc->numPages * sc->numBlocks;
+		st[ cls ].freeBlocks = 0;
+		for ( page = sc->pages; page; page = page->nextPage ) {
+			st[ cls ].freeBlocks += page->numFree;
+		}
+		st[ cls ].cachedBlocks = 0;
+		for ( cache = slabCaches; cache; cache = cache->next ) {
+			st[ cls ].cachedBlocks += cache->count[ cls ];
+		}
+	}
+	Com_SpinUnlock( &zoneLock );
+
+	if ( printDetails ) {
+		Com_Printf( "  size pages  peak  blocks    used  cached    free\n" );
+	}
+
+	pages = usedBlocks = usedBytes = cachedBlocks = freeBlocks = 0;
+	for ( cls = 0; cls < SLAB_CLASSES; cls++ ) {
+		used = st[ cls ].blocks - st[ cls ].freeBlocks - st[ cls ].cachedBlocks;
+		if ( printDetails ) {
+			Com_Printf( "%6i %5i %5i %7i %7i %7i %7i\n", st[ cls ].size, st[ cls ].pages, st[ cls ].peakPages,
+				st[ cls ].blocks, used, st[ cls ].cachedBlocks, st[ cls ].freeBlocks );
+		}
+		pages += st[ cls ].pages;
+		usedBlocks += used;
+		usedBytes += used * st[ cls ].size;
+		cachedBlocks += st[ cls ].cachedBlocks;
+		freeBlocks += st[ cls ].freeBlocks;
+	}
+
+	Com_Printf( "%8i bytes total slab pages\n\n", pages * SLAB_PAGE_SIZE );
+	Com_Printf( "%8i bytes in %i slab blocks in %i size classes\n", usedBytes, usedBlocks, (int)SLAB_CLASSES );
+	Com_Printf( "        %8i blocks in thread caches\n", cachedBlocks );
+	Com_Printf( "        %8i free blocks in %i pages\n", freeBlocks, pages );
+}
+#endif
+
+
 /*
 =================
 Com_Meminfo_f
@@ -1995,6 +2603,10 @@ static void Com_Meminfo_f( void ) {
 	if ( st.freeBlocks > 1 ) {
 		Com_Printf( "        (largest: %i bytes, smallest: %i bytes)\n\n", st.freeLargest, st.freeSmallest );
 	}
+#ifdef USE_ZONE_SLABS
+	Com_Printf( "\n" );
+	Slab_Stats( !Q_stricmp( Cmd_Argv(1), "slab" ) || !Q_stricmp( Cmd_Argv(1), "all" ) );
+#endif
 }
 
 
@@ -2042,6 +2654,17 @@ unsigned int Com_TouchMemory( void ) {
 		}
 	}
 
+#ifdef USE_ZONE_SLABS
+	for ( i = 0; i < SLAB_CLASSES; i++ ) {
+		const slabpage_t *page;
+		for ( page = slabClasses[ i ].pages; page; page = page->nextPage ) {
+			for ( j = 0; j < SLAB_PAGE_SIZE >> 2; j += 64 ) {
+				sum += ((const unsigned int *)page)[j];
+			}
+		}
+	}
+#endif
+
 	end = Sys_Milliseconds();
 
 	Com_Printf( "Com_TouchMemory: %i msec\n", end - start );
@@ -2063,6 +2686,9 @@ static void Com_InitSmallZoneMemory( void ) {
 	Com_Memset( s_buf, 0, smallZoneSize );
 	smallzone = (memzone_t *)s_buf;
 	Z_ClearZone( smallzone, smallzone, smallZoneSize, 1 );
+#ifdef USE_ZONE_SLABS
+	Z_InitSlabs();
+#endif
 }
 
 
@@ -2264,6 +2890,11 @@ The client calls this before starting a vid_restart or snd_restart
 void Hunk_ClearToMark( void ) {
 	hunk_low.permanent = hunk_low.temp = hunk_low.mark;
 	hunk_high.permanent = hunk_high.temp = hunk_high.mark;
+
+	if ( com_memprofInterval ) {
+		Com_MemProfFreeRange( s_hunkData + hunk_low.mark, s_hunkData + s_hunkTotal - hunk_high.mark, MEMPROF_TAG_HUNK );
+		Com_MemProfFreeRange( s_hunkData, s_hunkData + s_hunkTotal, MEMPROF_TAG_HUNK_TEMP );
+	}
 }
 
 
@@ -2313,6 +2944,11 @@ void Hunk_Clear( void ) {
 	hunk_permanent = &hunk_low;
 	hunk_temp = &hunk_high;
 
+	if ( com_memprofInterval ) {
+		Com_MemProfFreeRange( s_hunkData, s_hunkData + s_hunkTotal, MEMPROF_TAG_HUNK );
+		Com_MemProfFreeRange( s_hunkData, s_hunkData + s_hunkTotal, MEMPROF_TAG_HUNK_TEMP );
+	}
+
 	Com_Printf( "Hunk_Clear: reset the hunk ok\n" );
 	VM_Clear();
 #ifdef HUNK_DEBUG
@@ -2414,6 +3050,11 @@ void *Hunk_Alloc( int size, ha_pref preference ) {
 		buf = ((byte *) buf) + sizeof(hunkblock_t);
 	}
 #endif
+
+	if ( com_memprofInterval ) {
+		Com_MemProfAlloc( buf, size, MEMPROF_TAG_HUNK );
+	}
+
 	return buf;
 }
 
@@ -2466,6 +3107,10 @@ void *Hunk_AllocateTempMemory( int size ) {
 	hdr->magic = HUNK_MAGIC;
 	hdr->size = size;
 
+	if ( com_memprofInterval && Com_MemProfAlloc( buf, size, MEMPROF_TAG_HUNK_TEMP ) ) {
+		hdr->magic = HUNK_SAMPLED_MAGIC;
+	}
+
 	// don't bother clearing, because we are going to load a file over it
 	return buf;
 }
@@ -2490,7 +3135,9 @@ void Hunk_FreeTempMemory( void *buf ) {
 	}
 
 	hdr = ( (hunkHeader_t *)buf ) - 1;
-	if ( hdr->magic != HUNK_MAGIC ) {
+	if ( hdr->magic == HUNK_SAMPLED_MAGIC ) {
+		Com_MemProfFree( buf );
+	} else if ( hdr->magic != HUNK_MAGIC ) {
 		Com_Error( ERR_FATAL, "Hunk_FreeTempMemory: bad magic" );
 	}
 
@@ -2526,6 +3173,9 @@ permanent allocs use this side.
 void Hunk_ClearTempMemory( void ) {
 	if ( s_hunkData != NULL ) {
 		hunk_temp->temp = hunk_temp->permanent;
+		if ( com_memprofInterval ) {
+			Com_MemProfFreeRange( s_hunkData, s_hunkData + s_hunkTotal, MEMPROF_TAG_HUNK_TEMP );
+		}
 	}
 }
 
@@ -3311,6 +3961,15 @@ static void CPUID( int func, unsigned int *regs )
 	__cpuid( (int*)regs, func );
 }
 
+static uint64_t XGETBV( unsigned int index )
+{
+#if _MSC_VER >= 1600
+	return _xgetbv( index );
+#else
+	return 0; // no AVX-enabled OS support in old compilers
+#endif
+}
+
 #ifdef USE_AFFINITY_MASK
 #if idx64
 extern void CPUID_EX( int func, int param, unsigned int *regs );
@@ -3342,7 +4001,18 @@ static void CPUID( int func, unsigned int *regs )
 		"=b"(regs[1]),
 		"=c"(regs[2]),
 		"=d"(regs[3]) :
-		"a"(func) );
+		"a"(func),
+		"c"(0) );
+}
+
+static uint64_t XGETBV( unsigned int index )
+{
+	uint32_t eax, edx;
+	__asm__ __volatile__( ".byte 0x0f, 0x01, 0xd0" : // xgetbv
+		"=a"(eax),
+		"=d"(edx) :
+		"c"(index) );
+	return ( (uint64_t)edx << 32 ) | eax;
 }
 
 #ifdef USE_AFFINITY_MASK
@@ -3363,7 +4033,7 @@ static void CPUID_EX( int func, int param, unsigned int *regs )
 static void Sys_GetProcessorId( char *vendor )
 {
 	uint32_t regs[4]; // EAX, EBX, ECX, EDX
-	uint32_t cpuid_level_ex;
+	uint32_t cpuid_level, cpuid_level_ex;
 	char vendor_str[12 + 1]; // short CPU vendor string
 
 	// setup initial features
@@ -3379,6 +4049,7 @@ static void Sys_GetProcessorId( char *vendor )
 
 	// get CPUID level & short CPU vendor string
 	CPUID( 0x0, regs );
+	cpuid_level = regs[0];
 	memcpy(vendor_str + 0, (char*)&regs[1], 4);
 	memcpy(vendor_str + 4, (char*)&regs[3], 4);
 	memcpy(vendor_str + 8, (char*)&regs[2], 4);
@@ -3411,6 +4082,15 @@ static void Sys_GetProcessorId( char *vendor )
 	if ( regs[ 2 ] & ( 1 << 19 ) )
 		CPU_Flags |= CPU_SSE41;
 
+	// bit 27 of ECX denotes OSXSAVE and bit 28 AVX existence,
+	// XCR0 tells whether the OS saves XMM and YMM registers
+	if ( ( regs[ 2 ] & ( 3 << 27 ) ) == ( 3 << 27 ) && ( XGETBV( 0 ) & 6 ) == 6 && cpuid_level >= 7 ) {
+		CPUID( 0x7, regs );
+		// bit 5 of EBX denotes AVX2 existence
+		if ( regs[ 1 ] & ( 1 << 5 ) )
+			CPU_Flags |= CPU_AVX2;
+	}
+
 	if ( vendor ) {
 		if ( cpuid_level_ex >= 0x80000004 ) {
 			// read CPU Brand string
@@ -3442,6 +4122,8 @@ static void Sys_GetProcessorId( char *vendor )
 				//	strcat( vendor, " SSE3" );
 				if (print_flags & CPU_SSE41)
 					strcat(vendor, " SSE4.1");
+				if (print_flags & CPU_AVX2)
+					strcat(vendor, " AVX2");
 			}
 		}
 	}
@@ -3885,6 +4567,8 @@ void Com_Init( char *commandLine ) {
 	// allocate the stack based hunk allocator
 	Com_InitHunkMemory();
 
+	Com_MemProfInit();
+
 	// if any archived cvars are modified after this, we will trigger a writing
 	// of the config file
 	cvar_modifiedFlags &= ~CVAR_ARCHIVE;
@@ -4288,6 +4972,8 @@ void Com_Frame( qboolean noDelay ) {
 	}
 #endif
 
+	Com_MemProfFrame();
+
 	//
 	// main event loop
 	//
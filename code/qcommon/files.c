@@ -299,6 +299,9 @@ static	cvar_t		*fs_gamedirvar;
 static	cvar_t		*fs_locked;
 #endif
 static	cvar_t		*fs_excludeReference;
+static	cvar_t		*fs_asyncWrite;
+static	cvar_t		*fs_asyncFlush;
+static	cvar_t		*fs_asyncSync;
 
 static	searchpath_t	*fs_searchpaths;
 static	int			fs_readCount;			// total bytes read
@@ -333,6 +336,10 @@ typedef struct {
 	handleOwner_t	owner;
 	int			pakIndex;
 	pack_t		*pak;
+	byte		*memData;	// preloaded file contents
+	int			memPos;
+	int			memLen;
+	struct asyncFile_s	*async;	// written by the background writer
 } fileHandleData_t;
 
 static fileHandleData_t	fsh[MAX_FILE_HANDLES];
@@ -447,6 +454,9 @@ static FILE	*FS_FileForHandle( fileHandle_t f ) {
 	if ( fsh[f].zipFile ) {
 		Com_Error( ERR_DROP, "FS_FileForHandle: can't get FILE on zip file" );
 	}
+	if ( fsh[f].memData ) {
+		Com_Error( ERR_DROP, "FS_FileForHandle: can't get FILE on preloaded file" );
+	}
 	if ( ! fsh[f].handleFiles.file.o ) {
 		Com_Error( ERR_DROP, "FS_FileForHandle: NULL" );
 	}
@@ -455,9 +465,338 @@ static FILE	*FS_FileForHandle( fileHandle_t f ) {
 }
 
 
+/*
+=================================================================================
+
+ASYNCHRONOUS FILE WRITING
+
+Log files are written by a background thread so that a slow disk never stalls
+the frame.  FS_Write() on such a handle only copies data into a per-handle
+ring which the caller fills and the writer thread drains without locking.
+The lock is held by the writer while it drains and by the main thread while
+it detaches, flushes or seeks the file, so the FILE is never used by both.
+When a ring is full the caller drains it itself and the stall is counted.
+
+=================================================================================
+*/
+
+#define MAX_ASYNC_FILES		8
+#define ASYNC_RING_SIZE		(256*1024)	// must be a power of two
+#define ASYNC_POLL_MSEC		2
+
+typedef struct asyncFile_s {
+	FILE			*file;		// NULL if slot is not used
+	byte			*ring;
+	volatile unsigned int head;	// advanced by whoever holds the write lock
+	volatile unsigned int tail;	// advanced by whoever holds the lock
+	volatile int	lock;
+	volatile int	writeLock;	// serializes producers, Com_Printf() may log from any thread
+	volatile int	sync;		// flush after every drain
+	int				dirty;		// written but not flushed yet
+	int				lastFlush;
+	int				stalls;		// times the ring was full
+	int				errors;		// failed writes
+	int				written;	// total bytes
+} asyncFile_t;
+
+static struct {
+	asyncFile_t		files[MAX_ASYNC_FILES];
+	int				count;
+	void			*thread;
+	volatile int	quit;
+} fs_async;
+
+
+/*
+=================
+FS_AsyncDrain
+
+Writes out everything queued so far, lock must be held
+=================
+*/
+static int FS_AsyncDrain( asyncFile_t *af ) {
+	unsigned int head, tail, pos, n;
+	int total;
+
+	head = Q_AtomicLoad( &af->head );
+	tail = af->tail;
+	total = 0;
+
+	while ( tail != head ) {
+		pos = tail & ( ASYNC_RING_SIZE - 1 );
+		n = MIN( head - tail, ASYNC_RING_SIZE - pos );
+		if ( fwrite( af->ring + pos, 1, n, af->file ) != n ) {
+			// don't retry forever on a full disk, the data is lost anyway
+			af->errors++;
+		}
+		tail += n;
+		total += n;
+	}
+
+	if ( total ) {
+		Q_AtomicAdd( &af->tail, total );
+		af->dirty = 1;
+		af->written += total;
+	}
+
+	return total;
+}
+
+
+/*
+=================
+FS_AsyncFlush
+
+Flushes stdio and, depending on fs_asyncSync, OS buffers, lock must be held
+=================
+*/
+static void FS_AsyncFlush( asyncFile_t *af, int syncLevel ) {
+	if ( !af->dirty ) {
+		return;
+	}
+
+	if ( fs_asyncSync->integer >= syncLevel ) {
+		Sys_SyncFile( af->file );
+	} else {
+		fflush( af->file );
+	}
+
+	af->dirty = 0;
+	af->lastFlush = Sys_Milliseconds();
+}
+
+
+/*
+=================
+FS_AsyncThread
+
+Runs on a worker thread, must not touch filesystem state
+=================
+*/
+static void FS_AsyncThread( void *arg ) {
+	asyncFile_t *af;
+	qboolean idle;
+	int i;
+
+	while ( !fs_async.quit ) {
+		idle = qtrue;
+
+		for ( i = 0; i < MAX_ASYNC_FILES; i++ ) {
+			af = &fs_async.files[ i ];
+
+			// don't wait for the main thread, we will be back soon
+			if ( Q_AtomicTestAndSet( &af->lock ) ) {
+				continue;
+			}
+
+			if ( af->file ) {
+				if ( FS_AsyncDrain( af ) ) {
+					idle = qfalse;
+				}
+				if ( af->sync || Sys_Milliseconds() - af->lastFlush >= fs_asyncFlush->integer ) {
+					FS_AsyncFlush( af, 2 );
+				}
+			}
+
+			Com_SpinUnlock( &af->lock );
+		}
+
+		if ( idle ) {
+			Sys_Sleep( ASYNC_POLL_MSEC );
+		}
+	}
+}
+
+
+/*
+=================
+FS_SetAsync
+
+Hands writing of a file opened for writing to the background thread,
+returns qfalse if the file stays synchronous
+=================
+*/
+qboolean FS_SetAsync( fileHandle_t f ) {
+	fileHandleData_t *fd;
+	asyncFile_t *af;
+	int i;
+
+	if ( f <= 0 || f >= MAX_FILE_HANDLES ) {
+		return qfalse;
+	}
+
+	fd = &fsh[ f ];
+
+	if ( !fs_asyncWrite || !fs_asyncWrite->integer || fd->async || fd->zipFile || fd->memData || !fd->handleFiles.file.o ) {
+		return qfalse;
+	}
+
+	for ( i = 0; i < MAX_ASYNC_FILES; i++ ) {
+		if ( !fs_async.files[ i ].file ) {
+			break;
+		}
+	}
+
+	if ( i == MAX_ASYNC_FILES ) {
+		return qfalse;
+	}
+
+	if ( !fs_async.thread ) {
+		fs_async.quit = 0;
+		fs_async.thread = Sys_CreateThread( FS_AsyncThread, NULL );
+		if ( !fs_async.thread ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: couldn't create async writer thread\n" );
+			return qfalse;
+		}
+	}
+
+	af = &fs_async.files[ i ];
+	Com_SpinLock( &af->lock );
+
+	af->ring = malloc( ASYNC_RING_SIZE );
+	if ( af->ring ) {
+		af->head = af->tail = 0;
+		af->sync = fd->handleSync;
+		af->dirty = 0;
+		af->lastFlush = Sys_Milliseconds();
+		af->stalls = 0;
+		af->errors = 0;
+		af->written = 0;
+		af->file = fd->handleFiles.file.o;
+		fd->async = af;
+		fs_async.count++;
+	}
+
+	Com_SpinUnlock( &af->lock );
+
+	return fd->async != NULL;
+}
+
+
+/*
+=================
+FS_AsyncWrite
+=================
+*/
+static void FS_AsyncWrite( asyncFile_t *af, const byte *buf, int len ) {
+	unsigned int head, pos, n;
+
+	Com_SpinLock( &af->writeLock );
+
+	// detached while we were waiting
+	if ( !af->ring ) {
+		Com_SpinUnlock( &af->writeLock );
+		return;
+	}
+
+	while ( len > 0 ) {
+		head = af->head;
+		n = ASYNC_RING_SIZE - ( head - Q_AtomicLoad( &af->tail ) );
+		if ( n == 0 ) {
+			// writer can't keep up, do its work instead of dropping data
+			af->stalls++;
+			Com_SpinLock( &af->lock );
+			FS_AsyncDrain( af );
+			Com_SpinUnlock( &af->lock );
+			continue;
+		}
+
+		pos = head & ( ASYNC_RING_SIZE - 1 );
+		n = MIN( n, (unsigned int)len );
+		n = MIN( n, ASYNC_RING_SIZE - pos );
+		Com_Memcpy( af->ring + pos, buf, n );
+
+		// publish after the data is in place
+		Q_AtomicAdd( &af->head, n );
+
+		buf += n;
+		len -= n;
+	}
+
+	Com_SpinUnlock( &af->writeLock );
+}
+
+
+/*
+=================
+FS_AsyncSettle
+
+Makes the FILE of an async handle safe to use on the calling thread
+=================
+*/
+static void FS_AsyncSettle( fileHandleData_t *fd ) {
+	asyncFile_t *af = fd->async;
+
+	Com_SpinLock( &af->lock );
+	FS_AsyncDrain( af );
+	FS_AsyncFlush( af, 2 );
+	Com_SpinUnlock( &af->lock );
+}
+
+
+/*
+=================
+FS_AsyncDetach
+=================
+*/
+static void FS_AsyncDetach( fileHandleData_t *fd ) {
+	asyncFile_t *af = fd->async;
+
+	// wait for producers on other threads
+	Com_SpinLock( &af->writeLock );
+	Com_SpinLock( &af->lock );
+	FS_AsyncDrain( af );
+	FS_AsyncFlush( af, 1 );
+	if ( af->stalls ) {
+		Com_DPrintf( "%s: async writer stalled %i times\n", fd->name, af->stalls );
+	}
+	free( af->ring );
+	af->ring = NULL;
+	af->file = NULL;
+	Com_SpinUnlock( &af->lock );
+
+	fd->async = NULL;
+	Com_SpinUnlock( &af->writeLock );
+
+	if ( --fs_async.count == 0 && fs_async.thread ) {
+		fs_async.quit = 1;
+		Sys_JoinThread( fs_async.thread );
+		fs_async.thread = NULL;
+	}
+}
+
+
+/*
+=================
+FS_AsyncInfo_f
+=================
+*/
+static void FS_AsyncInfo_f( void ) {
+	const asyncFile_t *af;
+	int i;
+
+	Com_Printf( "async writer: %s, %i file(s)\n", fs_async.thread ? "running" : "stopped", fs_async.count );
+
+	for ( i = 1; i < MAX_FILE_HANDLES; i++ ) {
+		af = fsh[ i ].async;
+		if ( !af ) {
+			continue;
+		}
+		Com_Printf( "%2i: %s%s - %i bytes written, %i queued, %i stalls, %i errors\n", i, fsh[ i ].name,
+			af->sync ? " (synced)" : "", af->written, (int)( af->head - af->tail ), af->stalls, af->errors );
+	}
+}
+
+
 void FS_ForceFlush( fileHandle_t f ) {
 	FILE *file;
 
+	if ( f > 0 && f < MAX_FILE_HANDLES && fsh[f].async ) {
+		// let the writer flush every line instead of making stdio unbuffered
+		fsh[f].async->sync = 1;
+		return;
+	}
+
 	file = FS_FileForHandle(f);
 	setvbuf( file, NULL, _IONBF, 0 );
 }
@@ -1165,8 +1504,16 @@ void FS_FCloseFile( fileHandle_t f ) {
 
 	fd = &fsh[ f ];
 
-	if ( fd->zipFile && fd->pak ) {
-		unzCloseCurrentFile( fd->handleFiles.file.z );
+	if ( fd->async ) {
+		FS_AsyncDetach( fd );
+	}
+
+	if ( fd->memData ) {
+		free( fd->memData );
+	} else if ( fd->zipFile && fd->pak ) {
+		if ( unzCloseCurrentFile( fd->handleFiles.file.z ) == UNZ_CRCERROR ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: CRC mismatch for %s in %s\n", fd->name, fd->pak->pakFilename );
+		}
 		if ( fd->handleFiles.unique ) {
 			unzClose( fd->handleFiles.file.z );
 		}
@@ -1460,10 +1807,464 @@ void FS_RestorePure( void )
 }
 
 
+/*
+=================================================================================
+
+BACKGROUND FILE PRELOADING
+
+Files are located on the main thread while reading and decompression are done
+by a worker thread which uses only its own unzip handles and malloc'ed buffers.
+Preloaded data is handed out by FS_FOpenFileRead() only if the file still
+resolves to the same pk3 entry or directory file, so it survives FS_Restart().
+
+FS_LocateFile() and FS_ReadLocatedFile() expose the same split to subsystems
+that run their own reader threads.
+
+=================================================================================
+*/
+
+#define MAX_PRELOAD_FILES	4
+#define PRELOAD_CHUNK		(1024*1024)
+#define PRELOAD_DIR_FILE	((unsigned long)-1)
+
+typedef struct {
+	char			name[MAX_ZPATH];
+	char			path[MAX_OSPATH];	// pk3 file or directory file
+	unsigned long	pos;				// position in pk3 or PRELOAD_DIR_FILE
+	int				size;
+	byte			*data;				// NULL if reading failed or already consumed
+} preloadFile_t;
+
+static struct {
+	preloadFile_t	files[MAX_PRELOAD_FILES];
+	int				count;
+	void			*thread;
+	volatile int	abort;
+	volatile int	done;
+} fs_preload;
+
+
+/*
+=================
+FS_PreloadFromPak
+=================
+*/
+static qboolean FS_PreloadFromPak( const preloadFile_t *pf, byte *data, const volatile int *cancel ) {
+	unzFile	z;
+	int		n, r;
+
+	z = unzOpen( pf->path );
+	if ( !z ) {
+		return qfalse;
+	}
+
+	n = 0;
+	if ( unzSetCurrentFileInfoPosition( z, pf->pos ) == UNZ_OK && unzOpenCurrentFile( z ) == UNZ_OK ) {
+		// whole-file reads are inflated in a single pass
+		while ( n < pf->size && !*cancel ) {
+			r = unzReadCurrentFile( z, data + n, pf->size - n );
+			if ( r <= 0 ) {
+				break;
+			}
+			n += r;
+		}
+		// drop corrupted data, regular read path will report the mismatch
+		if ( unzCloseCurrentFile( z ) == UNZ_CRCERROR ) {
+			n = -1;
+		}
+	}
+
+	unzClose( z );
+
+	return ( n == pf->size );
+}
+
+
+/*
+=================
+FS_PreloadFromDir
+=================
+*/
+static qboolean FS_PreloadFromDir( const preloadFile_t *pf, byte *data, const volatile int *cancel ) {
+	FILE	*fp;
+	int		n, r;
+
+	fp = Sys_FOpen( pf->path, "rb" );
+	if ( !fp ) {
+		return qfalse;
+	}
+
+	n = 0;
+	while ( n < pf->size && !*cancel ) {
+		r = fread( data + n, 1, MIN( pf->size - n, PRELOAD_CHUNK ), fp );
+		if ( r <= 0 ) {
+			break;
+		}
+		n += r;
+	}
+
+	fclose( fp );
+
+	return ( n == pf->size );
+}
+
+
+/*
+=================
+FS_PreloadThread
+
+Runs on a worker thread, must not touch filesystem state
+=================
+*/
+static void FS_PreloadThread( void *arg ) {
+	preloadFile_t *pf;
+	qboolean ok;
+	int i;
+
+	for ( i = 0; i < fs_preload.count && !fs_preload.abort; i++ ) {
+		pf = &fs_preload.files[ i ];
+		pf->data = malloc( pf->size + 1 );
+		if ( !pf->data ) {
+			continue;
+		}
+		if ( pf->pos == PRELOAD_DIR_FILE ) {
+			ok = FS_PreloadFromDir( pf, pf->data, &fs_preload.abort );
+		} else {
+			ok = FS_PreloadFromPak( pf, pf->data, &fs_preload.abort );
+		}
+		if ( !ok ) {
+			free( pf->data );
+			pf->data = NULL;
+		}
+	}
+
+	Z_ReleaseThreadCache();
+
+	fs_preload.done = 1;
+}
+
+
+/*
+=================
+FS_PreloadWait
+=================
+*/
+static void FS_PreloadWait( void ) {
+	if ( fs_preload.thread ) {
+		Sys_JoinThread( fs_preload.thread );
+		fs_preload.thread = NULL;
+	}
+}
+
+
+/*
+=================
+FS_PreloadLocate
+
+Resolves file location the same way as FS_FOpenFileRead(),
+pak receives the pk3 the file was found in or NULL
+=================
+*/
+static qboolean FS_PreloadLocate( const char *filename, preloadFile_t *pf, pack_t **pak ) {
+	const searchpath_t	*search;
+	const fileInPack_t	*pakFile;
+	const char		*netpath;
+	long			hash;
+	long			fullHash;
+	FILE			*temp;
+
+	fullHash = FS_HashFileName( filename, 0U );
+
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack && search->pack->hashTable[ (hash = fullHash & (search->pack->hashSize-1)) ] ) {
+			if ( !FS_PakIsPure( search->pack ) ) {
+				continue;
+			}
+			for ( pakFile = search->pack->hashTable[ hash ]; pakFile; pakFile = pakFile->next ) {
+				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
+					Q_strncpyz( pf->path, search->pack->pakFilename, sizeof( pf->path ) );
+					pf->pos = pakFile->pos;
+					pf->size = pakFile->size;
+					if ( pak ) {
+						*pak = search->pack;
+					}
+					return qtrue;
+				}
+			}
+		} else if ( search->dir && search->policy != DIR_DENY ) {
+			netpath = FS_BuildOSPath( search->dir->path, search->dir->gamedir, filename );
+			temp = Sys_FOpen( netpath, "rb" );
+			if ( temp ) {
+				Q_strncpyz( pf->path, netpath, sizeof( pf->path ) );
+				pf->pos = PRELOAD_DIR_FILE;
+				pf->size = FS_FileLength( temp );
+				fclose( temp );
+				if ( pak ) {
+					*pak = NULL;
+				}
+				return qtrue;
+			}
+		}
+	}
+
+	return qfalse;
+}
+
+
+/*
+=================
+FS_FileStamp
+
+Describes the file FS_FOpenFileRead() would open without reading it,
+the description changes whenever the file or its pk3 does
+=================
+*/
+qboolean FS_FileStamp( const char *filename, char *stamp, int stampSize ) {
+	preloadFile_t pf;
+	fileOffset_t size;
+	fileTime_t mtime, ctime;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( FS_CheckDirTraversal( filename ) || !FS_PreloadLocate( filename, &pf, NULL ) ) {
+		return qfalse;
+	}
+
+	if ( !Sys_GetFileStats( pf.path, &size, &mtime, &ctime ) ) {
+		return qfalse;
+	}
+
+	Com_sprintf( stamp, stampSize, "%s %lu %i %lld %lld", pf.path, pf.pos, pf.size,
+		(long long)size, (long long)mtime );
+
+	return qtrue;
+}
+
+
+/*
+=================
+FS_LocateFile
+
+Resolves a file the same way as FS_FOpenFileRead() so that it can be read
+by FS_ReadLocatedFile() later, returns NULL if there is no such file
+=================
+*/
+void *FS_LocateFile( const char *qpath, int *size ) {
+	preloadFile_t *pf;
+	pack_t *pak;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( FS_CheckDirTraversal( qpath ) ) {
+		return NULL;
+	}
+
+	pf = malloc( sizeof( *pf ) );
+	if ( !pf ) {
+		return NULL;
+	}
+
+	if ( !FS_PreloadLocate( qpath, pf, &pak ) || pf->size < 0 ) {
+		free( pf );
+		return NULL;
+	}
+
+	// reading the file counts as a reference, as in FS_OpenFileInPak()
+	if ( pak ) {
+		if ( !( pak->referenced & FS_GENERAL_REF ) && FS_GeneralRef( qpath ) ) {
+			pak->referenced |= FS_GENERAL_REF;
+		}
+		if ( !( pak->referenced & FS_CGAME_REF ) && !strcmp( qpath, "vm/cgame.qvm" ) ) {
+			pak->referenced |= FS_CGAME_REF;
+		}
+		if ( !( pak->referenced & FS_UI_REF ) && !strcmp( qpath, "vm/ui.qvm" ) ) {
+			pak->referenced |= FS_UI_REF;
+		}
+	}
+
+	Q_strncpyz( pf->name, qpath, sizeof( pf->name ) );
+	pf->data = NULL;
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_LocateFile: %s (found in '%s')\n", qpath, pf->path );
+	}
+
+	*size = pf->size;
+
+	return pf;
+}
+
+
+/*
+=================
+FS_ReadLocatedFile
+
+Reads the whole file into buffer which must hold the size returned by
+FS_LocateFile, safe to call from any thread
+=================
+*/
+qboolean FS_ReadLocatedFile( const void *location, void *buffer ) {
+	const preloadFile_t *pf = location;
+	const int cancel = 0;
+
+	if ( pf->pos == PRELOAD_DIR_FILE ) {
+		return FS_PreloadFromDir( pf, buffer, &cancel );
+	} else {
+		return FS_PreloadFromPak( pf, buffer, &cancel );
+	}
+}
+
+
+/*
+=================
+FS_FreeLocation
+=================
+*/
+void FS_FreeLocation( void *location ) {
+	free( location );
+}
+
+
+/*
+=================
+FS_PreloadFiles
+
+Starts reading of listed files in background, previous preload is discarded
+=================
+*/
+void FS_PreloadFiles( const char **qpaths, int count ) {
+	preloadFile_t *pf;
+	int i;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	FS_PreloadCancel();
+
+	for ( i = 0; i < count && fs_preload.count < MAX_PRELOAD_FILES; i++ ) {
+		if ( FS_CheckDirTraversal( qpaths[i] ) ) {
+			continue;
+		}
+		pf = &fs_preload.files[ fs_preload.count ];
+		if ( !FS_PreloadLocate( qpaths[i], pf, NULL ) || pf->size <= 0 ) {
+			continue;
+		}
+		Q_strncpyz( pf->name, qpaths[i], sizeof( pf->name ) );
+		pf->data = NULL;
+		fs_preload.count++;
+	}
+
+	if ( !fs_preload.count ) {
+		return;
+	}
+
+	fs_preload.done = 0;
+	fs_preload.thread = Sys_CreateThread( FS_PreloadThread, NULL );
+	if ( !fs_preload.thread ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't create preload thread\n" );
+		fs_preload.count = 0;
+		return;
+	}
+
+	if ( fs_debug->integer ) {
+		for ( i = 0; i < fs_preload.count; i++ ) {
+			Com_Printf( "FS_PreloadFiles: %s (found in '%s')\n", fs_preload.files[i].name, fs_preload.files[i].path );
+		}
+	}
+}
+
+
+/*
+=================
+FS_PreloadCancel
+
+Stops worker thread and releases all preloaded data which was not used
+=================
+*/
+void FS_PreloadCancel( void ) {
+	int i;
+
+	fs_preload.abort = 1;
+	FS_PreloadWait();
+	fs_preload.abort = 0;
+
+	for ( i = 0; i < fs_preload.count; i++ ) {
+		if ( fs_preload.files[i].data ) {
+			free( fs_preload.files[i].data );
+			fs_preload.files[i].data = NULL;
+		}
+	}
+
+	fs_preload.count = 0;
+}
+
+
+/*
+=================
+FS_OpenPreloaded
+
+Returns memory-backed handle if file at given location was preloaded,
+waits for the worker thread if it is still reading
+=================
+*/
+static int FS_OpenPreloaded( fileHandle_t *file, const char *filename, const char *path, unsigned long pos, int size ) {
+	fileHandleData_t *f;
+	preloadFile_t *pf;
+	int i;
+
+	for ( i = 0; i < fs_preload.count; i++ ) {
+		pf = &fs_preload.files[ i ];
+		if ( pf->pos != pos || pf->size != size || !pf->name[0] ) {
+			continue;
+		}
+		if ( FS_FilenameCompare( pf->name, filename ) || strcmp( pf->path, path ) ) {
+			continue;
+		}
+
+		if ( !fs_preload.done ) {
+			Com_DPrintf( "FS_OpenPreloaded: waiting for %s\n", filename );
+		}
+		FS_PreloadWait();
+
+		pf->name[0] = '\0';
+		if ( !pf->data ) {
+			return -1;
+		}
+
+		*file = FS_HandleForFile();
+		f = &fsh[ *file ];
+		FS_InitHandle( f );
+
+		// ownership of buffer is passed to file handle
+		f->memData = pf->data;
+		f->memLen = pf->size;
+		f->memPos = 0;
+		f->handleFiles.file.v = f->memData;
+		f->zipFile = qfalse;
+		Q_strncpyz( f->name, filename, sizeof( f->name ) );
+		pf->data = NULL;
+
+		if ( fs_debug->integer ) {
+			Com_Printf( "FS_FOpenFileRead: %s (preloaded from '%s')\n", filename, path );
+		}
+
+		return size;
+	}
+
+	return -1;
+}
+
+
 static int FS_OpenFileInPak( fileHandle_t *file, pack_t *pak, fileInPack_t *pakFile, qboolean uniqueFILE ) {
 	fileHandleData_t *f;
 	unz_s *zfi;
 	FILE *temp;
+	int len;
 
 	// mark the pak as having been referenced and mark specifics on cgame and ui
 	// these are loaded from all pk3s
@@ -1479,6 +2280,15 @@ static int FS_OpenFileInPak( fileHandle_t *file, pack_t *pak, fileInPack_t *pakF
 		pak->referenced |= FS_UI_REF;
 	}
 
+	if ( fs_preload.count ) {
+		len = FS_OpenPreloaded( file, pakFile->name, pak->pakFilename, pakFile->pos, pakFile->size );
+		if ( len >= 0 ) {
+			fsh[ *file ].pakIndex = pak->index;
+			fs_lastPakIndex = pak->index;
+			return len;
+		}
+	}
+
 	if ( !pak->handle ) {
 		pak->handle = unzOpen( pak->pakFilename );
 		if ( !pak->handle ) {
@@ -1664,6 +2474,14 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean uniqueF
 				continue;
 			}
 
+			if ( fs_preload.count ) {
+				length = FS_OpenPreloaded( file, filename, netpath, PRELOAD_DIR_FILE, FS_FileLength( temp ) );
+				if ( length >= 0 ) {
+					fclose( temp );
+					return length;
+				}
+			}
+
 			*file = FS_HandleForFile();
 			f = &fsh[ *file ];
 			FS_InitHandle( f );
@@ -1809,7 +2627,14 @@ int FS_Read( void *buffer, int len, fileHandle_t f ) {
 	buf = (byte *)buffer;
 	fs_readCount += len;
 
-	if ( !fsh[f].zipFile ) {
+	if ( fsh[f].memData ) {
+		if ( len > fsh[f].memLen - fsh[f].memPos ) {
+			len = fsh[f].memLen - fsh[f].memPos;
+		}
+		Com_Memcpy( buf, fsh[f].memData + fsh[f].memPos, len );
+		fsh[f].memPos += len;
+		return len;
+	} else if ( !fsh[f].zipFile ) {
 		remaining = len;
 		tries = 0;
 		while (remaining) {
@@ -1861,6 +2686,11 @@ int FS_Write( const void *buffer, int len, fileHandle_t h ) {
 	//	return 0;
 	//}
 
+	if ( h > 0 && h < MAX_FILE_HANDLES && fsh[h].async ) {
+		FS_AsyncWrite( fsh[h].async, (const byte *)buffer, len );
+		return len;
+	}
+
 	f = FS_FileForHandle(h);
 	buf = (byte *)buffer;
 
@@ -1919,6 +2749,31 @@ int FS_Seek( fileHandle_t f, long offset, fsOrigin_t origin ) {
 		return -1;
 	}
 
+	if ( fsh[f].async ) {
+		FS_AsyncSettle( &fsh[f] );
+	}
+
+	if ( fsh[f].memData ) {
+		switch( origin ) {
+			case FS_SEEK_CUR:
+				offset += fsh[f].memPos;
+				break;
+			case FS_SEEK_END:
+				offset += fsh[f].memLen;
+				break;
+			case FS_SEEK_SET:
+				break;
+			default:
+				Com_Error( ERR_FATAL, "Bad origin in FS_Seek" );
+				return -1;
+		}
+		if ( offset < 0 || offset > fsh[f].memLen ) {
+			return -1;
+		}
+		fsh[f].memPos = offset;
+		return 0;
+	}
+
 	if ( fsh[f].zipFile == qtrue ) {
 		//FIXME: this is really, really crappy
 		//(but better than what was here before)
@@ -4009,6 +4864,112 @@ static void FS_TouchFile_f( void ) {
 }
 
 
+/*
+============
+FS_Benchmark_f
+
+Times decompression of every file in the loaded pk3s,
+optionally reading in chunks of the given size.
+============
+*/
+static void FS_Benchmark_f( void ) {
+	const searchpath_t *search;
+	const pack_t	*pak;
+	const fileInPack_t *pakFile;
+	unzFile			z;
+	byte			*buf;
+	int				bufSize;
+	int				chunk, n, r, i;
+	int				numFiles, numErrors, totalFiles, totalErrors;
+	int64_t			bytes, totalBytes;
+	int64_t			start, usec, totalUsec;
+
+	chunk = atoi( Cmd_Argv( 1 ) );
+	if ( chunk < 0 ) {
+		Com_Printf( "Usage: fs_benchmark [chunk size]\n" );
+		return;
+	}
+
+	buf = NULL;
+	bufSize = 0;
+	totalFiles = totalErrors = 0;
+	totalBytes = totalUsec = 0;
+
+	for ( search = fs_searchpaths; search; search = search->next ) {
+		if ( !search->pack ) {
+			continue;
+		}
+		pak = search->pack;
+		// private handle so file reads in progress are not disturbed
+		z = unzOpen( pak->pakFilename );
+		if ( !z ) {
+			Com_Printf( S_COLOR_YELLOW "%s: couldn't open\n", pak->pakFilename );
+			continue;
+		}
+
+		numFiles = numErrors = 0;
+		bytes = 0;
+		usec = 0;
+
+		for ( i = 0; i < pak->numfiles; i++ ) {
+			pakFile = &pak->buildBuffer[ i ];
+			if ( pakFile->size == 0 ) {
+				continue;
+			}
+			if ( pakFile->size > bufSize ) {
+				free( buf );
+				bufSize = pakFile->size;
+				buf = malloc( bufSize );
+				if ( !buf ) {
+					Com_Printf( S_COLOR_YELLOW "couldn't allocate %i bytes\n", bufSize );
+					unzClose( z );
+					return;
+				}
+			}
+
+			start = Sys_Microseconds();
+			n = 0;
+			if ( unzSetCurrentFileInfoPosition( z, pakFile->pos ) == UNZ_OK && unzOpenCurrentFile( z ) == UNZ_OK ) {
+				while ( n < pakFile->size ) {
+					r = unzReadCurrentFile( z, buf + n, chunk ? MIN( pakFile->size - n, chunk ) : pakFile->size - n );
+					if ( r <= 0 ) {
+						break;
+					}
+					n += r;
+				}
+				if ( unzCloseCurrentFile( z ) != UNZ_OK ) {
+					n = -1;
+				}
+			}
+			usec += Sys_Microseconds() - start;
+
+			if ( n != pakFile->size ) {
+				Com_Printf( S_COLOR_YELLOW "%s: error reading %s\n", pak->pakBasename, pakFile->name );
+				numErrors++;
+			}
+			numFiles++;
+			bytes += pakFile->size;
+		}
+
+		unzClose( z );
+
+		Com_Printf( "%s: %i files, %.2f MB in %.1f ms, %.1f MB/s%s\n", pak->pakBasename, numFiles,
+			bytes / ( 1024.0 * 1024.0 ), usec / 1000.0, usec ? bytes * ( 1000000.0 / ( 1024.0 * 1024.0 ) ) / usec : 0.0,
+			numErrors ? va( ", " S_COLOR_YELLOW "%i errors", numErrors ) : "" );
+
+		totalFiles += numFiles;
+		totalErrors += numErrors;
+		totalBytes += bytes;
+		totalUsec += usec;
+	}
+
+	free( buf );
+
+	Com_Printf( "total: %i files, %.2f MB in %.1f ms, %.1f MB/s, %i errors\n", totalFiles,
+		totalBytes / ( 1024.0 * 1024.0 ), totalUsec / 1000.0, totalUsec ? totalBytes * ( 1000000.0 / ( 1024.0 * 1024.0 ) ) / totalUsec : 0.0, totalErrors );
+}
+
+
 /*
 ============
 FS_CompleteFileName
@@ -4448,6 +5409,9 @@ void FS_Shutdown( qboolean closemfp )
 	// close opened files
 	if ( closemfp ) 
 	{
+		FS_PreloadCancel();
+
+
 		for ( i = 1; i < MAX_FILE_HANDLES; i++ )
 		{
 			if ( !fsh[i].handleFiles.file.v  )
@@ -4504,6 +5468,8 @@ void FS_Shutdown( qboolean closemfp )
 	Cmd_RemoveCommand( "which" );
 	Cmd_RemoveCommand( "lsof" );
 	Cmd_RemoveCommand( "fs_restart" );
+	Cmd_RemoveCommand( "fs_benchmark" );
+	Cmd_RemoveCommand( "fs_asyncInfo" );
 }
 
 
@@ -4732,6 +5698,19 @@ static void FS_Startup( void ) {
 		Cvar_Set( "fs_game", "" );
 	}
 
+	fs_asyncWrite = Cvar_Get( "fs_asyncWrite", "1", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( fs_asyncWrite, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( fs_asyncWrite, "Write buffered console log, game log and server demo files on a background thread, takes effect when a file is opened. Synced console logs (logfile 2 and 4) and synced game logs are always written directly." );
+	fs_asyncFlush = Cvar_Get( "fs_asyncFlush", "1000", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( fs_asyncFlush, "0", "60000", CV_INTEGER );
+	Cvar_SetDescription( fs_asyncFlush, "Interval in milliseconds at which background written files are flushed." );
+	fs_asyncSync = Cvar_Get( "fs_asyncSync", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( fs_asyncSync, "0", "2", CV_INTEGER );
+	Cvar_SetDescription( fs_asyncSync, "Force background written files to disk:\n"
+		" 0: Never, leave it to the OS\n"
+		" 1: When the file is closed\n"
+		" 2: On every flush" );
+
 	fs_excludeReference = Cvar_Get( "fs_excludeReference", "", CVAR_ARCHIVE_ND | CVAR_LATCH );
 	Cvar_SetDescription( fs_excludeReference,
 		"Exclude specified pak files from download list on client side.\n"
@@ -4820,6 +5799,8 @@ static void FS_Startup( void ) {
  	Cmd_AddCommand( "which", FS_Which_f );
 	Cmd_SetCommandCompletionFunc( "which", FS_CompleteFileName );
 	Cmd_AddCommand( "fs_restart", FS_Reload );
+	Cmd_AddCommand( "fs_benchmark", FS_Benchmark_f );
+	Cmd_AddCommand( "fs_asyncInfo", FS_AsyncInfo_f );
 
 	// print the current search paths
 	FS_Path_f();
@@ -5442,7 +6423,12 @@ int	FS_FOpenFileByMode( const char *qpath, fileHandle_t *f, fsMode_t mode ) {
 
 int FS_FTell( fileHandle_t f ) {
 	int pos;
-	if ( fsh[f].zipFile ) {
+	if ( fsh[f].async ) {
+		FS_AsyncSettle( &fsh[f] );
+	}
+	if ( fsh[f].memData ) {
+		pos = fsh[f].memPos;
+	} else if ( fsh[f].zipFile ) {
 		pos = unztell( fsh[f].handleFiles.file.z );
 	} else {
 		pos = ftell( fsh[f].handleFiles.file.o );
@@ -5453,6 +6439,10 @@ int FS_FTell( fileHandle_t f ) {
 
 void FS_Flush( fileHandle_t f ) 
 {
+	if ( fsh[f].async ) {
+		FS_AsyncSettle( &fsh[f] );
+		return;
+	}
 	fflush( fsh[f].handleFiles.file.o );
 }
 
@@ -5492,8 +6482,13 @@ int FS_VM_OpenFile( const char *qpath, fileHandle_t *f, fsMode_t mode, handleOwn
 
 	r = FS_FOpenFileByMode( qpath, f, mode );
 
-	if ( f && *f != FS_INVALID_HANDLE )
+	if ( f && *f != FS_INVALID_HANDLE ) {
 		fsh[ *f ].owner = owner;
+		// game logs, nobody reads them back while they are open,
+		// FS_APPEND_SYNC asks for every write to reach the disk
+		if ( mode == FS_APPEND )
+			FS_SetAsync( *f );
+	}
 
 	return r;
 }
@@ -0,0 +1,537 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// inflate.c -- single-pass table-driven raw deflate decoder
+
+#include "inflate.h"
+
+/*
+==============================================================================
+
+The whole stream is decoded in one call straight into the caller's buffer,
+so the output size has to be known (or bounded) in advance.
+
+Huffman codes are resolved with a single lookup in a root table indexed by
+the next LITLEN_BITS/DIST_BITS input bits, longer codes continue in second
+level subtables sized to fit exactly the codes sharing the prefix. Each
+entry already holds the literal or the length/distance base with its extra
+bit count, so no per-symbol base tables are touched in the decode loop.
+Root entries of two short literal codes that fit in LITLEN_BITS together
+are merged, so runs of frequent literals are emitted two at a time.
+
+The bit buffer is 64 bits wide and is refilled with one unaligned 8-byte
+load, after a refill it always holds at least 56 bits which is enough for a
+complete length/distance pair (15+5+15+13 bits).
+
+Tables live on the stack, so it is safe to decode from several threads.
+
+==============================================================================
+*/
+
+#define LITLEN_BITS		10
+#define DIST_BITS		8
+#define CODELEN_BITS	7
+
+#define MAX_CODE_BITS	15
+#define NUM_LITLEN		288
+#define NUM_DIST		32
+#define NUM_CODELEN		19
+
+#define MAX_LITLEN		286
+#define MAX_DIST		30
+
+#define LITLEN_ENOUGH	2048	// 1332 is the worst case for 286 symbols, root 10
+#define DIST_ENOUGH		512		// 402 is the worst case for 30 symbols, root 8
+
+// table entry layout:
+//  bits 0..3   - code bits to consume
+//  bits 4..7   - extra bits following the code, or subtable index bits
+//  bits 8..15  - flags
+//  bits 16..31 - literal(s), length/distance base or subtable offset
+#define E_LITERAL		0x0100
+#define E_LITERAL2		0x0200	// two literals, first one in the low byte
+#define E_SUBTABLE		0x0400
+#define E_EOB			0x0800
+#define E_INVALID		0x1000
+
+#define ENTRY( value, extra, flags, len ) ( ( (uint32_t)(value) << 16 ) | ( (extra) << 4 ) | (flags) | (len) )
+#define E_LEN( e )		( (e) & 0xF )
+#define E_EXTRA( e )	( ( (e) >> 4 ) & 0xF )
+#define E_VALUE( e )	( (e) >> 16 )
+
+typedef enum {
+	TABLE_CODELEN,
+	TABLE_LITLEN,
+	TABLE_DIST
+} tableType_t;
+
+static const uint16_t lengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const byte lengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const uint16_t distBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const byte distExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const byte codelenOrder[NUM_CODELEN] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+/*
+=================
+SymbolEntry
+=================
+*/
+static uint32_t SymbolEntry( tableType_t type, int sym, int len )
+{
+	switch ( type ) {
+	case TABLE_CODELEN:
+		return ENTRY( sym, 0, E_LITERAL, len );
+	case TABLE_LITLEN:
+		if ( sym < 256 )
+			return ENTRY( sym, 0, E_LITERAL, len );
+		if ( sym == 256 )
+			return ENTRY( 0, 0, E_EOB, len );
+		if ( sym < MAX_LITLEN )
+			return ENTRY( lengthBase[ sym - 257 ], lengthExtra[ sym - 257 ], 0, len );
+		break;
+	case TABLE_DIST:
+		if ( sym < MAX_DIST )
+			return ENTRY( distBase[ sym ], distExtra[ sym ], 0, len );
+		break;
+	}
+
+	return ENTRY( 0, 0, E_INVALID, len );
+}
+
+
+/*
+=================
+BuildTable
+
+Builds a two-level decode table for canonical code lengths.
+Incomplete codes are accepted, unused entries decode as E_INVALID.
+=================
+*/
+static qboolean BuildTable( uint32_t *table, int tableSize, int rootBits, const byte *lens, int numSyms, tableType_t type )
+{
+	uint16_t count[ MAX_CODE_BITS + 1 ];
+	uint16_t offs[ MAX_CODE_BITS + 1 ];
+	uint16_t sorted[ NUM_LITLEN ];
+	int rootSize, used, maxLen;
+	int sym, len, left, i, n;
+	int sub, subBits, subPrefix;
+	uint32_t code, rev, entry;
+
+	memset( count, 0, sizeof( count ) );
+	for ( sym = 0; sym < numSyms; sym++ )
+		count[ lens[ sym ] ]++;
+
+	// reject over-subscribed codes
+	left = 1;
+	maxLen = 0;
+	for ( len = 1; len <= MAX_CODE_BITS; len++ ) {
+		left <<= 1;
+		left -= count[ len ];
+		if ( left < 0 )
+			return qfalse;
+		if ( count[ len ] )
+			maxLen = len;
+	}
+
+	// sort symbols by code length, then by value
+	offs[ 1 ] = 0;
+	for ( len = 1; len < MAX_CODE_BITS; len++ )
+		offs[ len + 1 ] = offs[ len ] + count[ len ];
+	for ( sym = 0; sym < numSyms; sym++ ) {
+		if ( lens[ sym ] )
+			sorted[ offs[ lens[ sym ] ]++ ] = sym;
+	}
+
+	rootSize = 1 << rootBits;
+	for ( i = 0; i < rootSize; i++ )
+		table[ i ] = ENTRY( 0, 0, E_INVALID, 0 );
+
+	used = rootSize;
+	sub = 0;
+	subBits = 0;
+	subPrefix = -1;
+	code = 0;
+	n = 0;
+
+	for ( len = 1; len <= maxLen; len++ ) {
+		while ( count[ len ] ) {
+			sym = sorted[ n++ ];
+
+			// deflate sends codes MSB first, tables are indexed LSB first
+			rev = 0;
+			for ( i = 0; i < len; i++ )
+				rev |= ( ( code >> i ) & 1 ) << ( len - 1 - i );
+
+			if ( len <= rootBits ) {
+				entry = SymbolEntry( type, sym, len );
+				for ( i = rev; i < rootSize; i += 1 << len )
+					table[ i ] = entry;
+			} else {
+				if ( (int)( rev & ( rootSize - 1 ) ) != subPrefix ) {
+					// size the subtable to hold all remaining codes with this prefix
+					subPrefix = rev & ( rootSize - 1 );
+					subBits = len - rootBits;
+					left = 1 << subBits;
+					while ( subBits + rootBits < maxLen ) {
+						left -= count[ subBits + rootBits ];
+						if ( left <= 0 )
+							break;
+						subBits++;
+						left <<= 1;
+					}
+					if ( used + ( 1 << subBits ) > tableSize )
+						return qfalse;
+					sub = used;
+					used += 1 << subBits;
+					table[ subPrefix ] = ENTRY( sub, subBits, E_SUBTABLE, rootBits );
+					for ( i = 0; i < ( 1 << subBits ); i++ )
+						table[ sub + i ] = ENTRY( 0, 0, E_INVALID, 0 );
+				}
+				entry = SymbolEntry( type, sym, len - rootBits );
+				for ( i = rev >> rootBits; i < ( 1 << subBits ); i += 1 << ( len - rootBits ) )
+					table[ sub + i ] = entry;
+			}
+
+			count[ len ]--;
+			code++;
+		}
+		code <<= 1;
+	}
+
+	return qtrue;
+}
+
+
+/*
+=================
+PairLiterals
+
+Merges root entries whose bits start with two complete literal codes.
+Walking down keeps the entries looked up for the second code unmodified,
+since ( i >> len ) < i for every i > 0.
+=================
+*/
+static void PairLiterals( uint32_t *table, int rootBits )
+{
+	uint32_t e1, e2;
+	int i, len;
+
+	for ( i = ( 1 << rootBits ) - 1; i >= 0; i-- ) {
+		e1 = table[ i ];
+		if ( !( e1 & E_LITERAL ) )
+			continue;
+		len = E_LEN( e1 );
+		e2 = table[ i >> len ];
+		if ( !( e2 & E_LITERAL ) || len + E_LEN( e2 ) > rootBits )
+			continue;
+		table[ i ] = ENTRY( E_VALUE( e1 ) | ( E_VALUE( e2 ) << 8 ), 0, E_LITERAL2, len + E_LEN( e2 ) );
+	}
+}
+
+
+/*
+=================
+LoadLE64
+=================
+*/
+static ID_INLINE uint64_t LoadLE64( const byte *p )
+{
+#ifdef Q3_LITTLE_ENDIAN
+	uint64_t v;
+	memcpy( &v, p, sizeof( v ) );
+	return v;
+#else
+	return (uint64_t)p[0] | ( (uint64_t)p[1] << 8 ) | ( (uint64_t)p[2] << 16 ) | ( (uint64_t)p[3] << 24 ) |
+		( (uint64_t)p[4] << 32 ) | ( (uint64_t)p[5] << 40 ) | ( (uint64_t)p[6] << 48 ) | ( (uint64_t)p[7] << 56 );
+#endif
+}
+
+
+// tops the bit buffer up to at least 56 bits, past the end of input
+// zero bytes are fed and counted so over-consumption can be detected
+#define REFILL() \
+	if ( inEnd - in >= 8 ) { \
+		bitbuf |= LoadLE64( in ) << bitcount; \
+		in += ( 63 - bitcount ) >> 3; \
+		bitcount |= 56; \
+	} else { \
+		bitbuf &= ( (uint64_t)1 << bitcount ) - 1; \
+		while ( bitcount <= 56 ) { \
+			if ( in < inEnd ) \
+				bitbuf |= (uint64_t)*in++ << bitcount; \
+			else if ( ++overrun > 8 ) \
+				goto shortinput; \
+			bitcount += 8; \
+		} \
+	}
+
+#define BITS( n )		( (uint32_t)bitbuf & ( ( 1U << (n) ) - 1 ) )
+#define CONSUME( n )	{ bitbuf >>= (n); bitcount -= (n); }
+
+
+/*
+=================
+Inflate_Raw
+=================
+*/
+int Inflate_Raw( byte *dest, uint32_t *destLen, const byte *source, uint32_t *sourceLen )
+{
+	uint32_t litlenTable[ LITLEN_ENOUGH ];
+	uint32_t distTable[ DIST_ENOUGH ];
+	uint32_t codelenTable[ 1 << CODELEN_BITS ];
+	byte lens[ MAX_LITLEN + MAX_DIST ];
+	const byte *in, *inEnd;
+	byte *out, *outEnd;
+	const byte *src;
+	uint64_t bitbuf;
+	uint32_t bitcount, overrun;
+	uint32_t e, length, distance;
+	int final, type, nlen, ndist, ncode, i, rep;
+	int result;
+
+	in = source;
+	inEnd = source + *sourceLen;
+	out = dest;
+	outEnd = dest + *destLen;
+
+	bitbuf = 0;
+	bitcount = 0;
+	overrun = 0;
+
+	do {
+		REFILL();
+		final = BITS( 1 );
+		type = ( bitbuf >> 1 ) & 3;
+		CONSUME( 3 );
+
+		if ( type == 0 ) {
+			// stored block: return unread whole bytes to the input
+			CONSUME( bitcount & 7 );
+			if ( ( bitcount >> 3 ) < overrun )
+				goto shortinput;
+			in -= ( bitcount >> 3 ) - overrun;
+			bitbuf = 0;
+			bitcount = 0;
+			overrun = 0;
+
+			if ( inEnd - in < 4 )
+				goto shortinput;
+			length = in[0] | ( in[1] << 8 );
+			if ( ( in[2] | ( in[3] << 8 ) ) != ( ~length & 0xFFFF ) )
+				goto baddata;
+			in += 4;
+
+			if ( (uint32_t)( inEnd - in ) < length )
+				goto shortinput;
+			if ( (uint32_t)( outEnd - out ) < length )
+				goto shortoutput;
+			memcpy( out, in, length );
+			in += length;
+			out += length;
+			continue;
+		}
+
+		if ( type == 1 ) {
+			for ( i = 0; i < 144; i++ )
+				lens[ i ] = 8;
+			for ( ; i < 256; i++ )
+				lens[ i ] = 9;
+			for ( ; i < 280; i++ )
+				lens[ i ] = 7;
+			for ( ; i < NUM_LITLEN; i++ )
+				lens[ i ] = 8;
+			BuildTable( litlenTable, LITLEN_ENOUGH, LITLEN_BITS, lens, NUM_LITLEN, TABLE_LITLEN );
+			for ( i = 0; i < MAX_DIST; i++ )
+				lens[ i ] = 5;
+			BuildTable( distTable, DIST_ENOUGH, DIST_BITS, lens, MAX_DIST, TABLE_DIST );
+		} else if ( type == 2 ) {
+			REFILL();
+			nlen = BITS( 5 ) + 257; CONSUME( 5 );
+			ndist = BITS( 5 ) + 1; CONSUME( 5 );
+			ncode = BITS( 4 ) + 4; CONSUME( 4 );
+			if ( nlen > MAX_LITLEN || ndist > MAX_DIST )
+				goto baddata;
+
+			memset( lens, 0, NUM_CODELEN );
+			for ( i = 0; i < ncode; i++ ) {
+				if ( bitcount < 3 ) {
+					REFILL();
+				}
+				lens[ codelenOrder[ i ] ] = BITS( 3 );
+				CONSUME( 3 );
+			}
+			if ( !BuildTable( codelenTable, ARRAY_LEN( codelenTable ), CODELEN_BITS, lens, NUM_CODELEN, TABLE_CODELEN ) )
+				goto baddata;
+
+			for ( i = 0; i < nlen + ndist; ) {
+				REFILL();
+				e = codelenTable[ BITS( CODELEN_BITS ) ];
+				if ( e & E_INVALID )
+					goto baddata;
+				CONSUME( E_LEN( e ) );
+				if ( E_VALUE( e ) < 16 ) {
+					lens[ i++ ] = E_VALUE( e );
+					continue;
+				}
+				if ( E_VALUE( e ) == 16 ) {
+					if ( i == 0 )
+						goto baddata;
+					e = lens[ i - 1 ];
+					rep = 3 + BITS( 2 ); CONSUME( 2 );
+				} else if ( E_VALUE( e ) == 17 ) {
+					e = 0;
+					rep = 3 + BITS( 3 ); CONSUME( 3 );
+				} else {
+					e = 0;
+					rep = 11 + BITS( 7 ); CONSUME( 7 );
+				}
+				if ( i + rep > nlen + ndist )
+					goto baddata;
+				while ( rep-- )
+					lens[ i++ ] = e;
+			}
+
+			if ( lens[ 256 ] == 0 )
+				goto baddata; // no end-of-block code
+			if ( !BuildTable( litlenTable, LITLEN_ENOUGH, LITLEN_BITS, lens, nlen, TABLE_LITLEN ) )
+				goto baddata;
+			PairLiterals( litlenTable, LITLEN_BITS );
+			if ( !BuildTable( distTable, DIST_ENOUGH, DIST_BITS, lens + nlen, ndist, TABLE_DIST ) )
+				goto baddata;
+		} else {
+			goto baddata;
+		}
+
+		for ( ;; ) {
+			REFILL();
+
+			e = litlenTable[ BITS( LITLEN_BITS ) ];
+			if ( e & E_SUBTABLE ) {
+				CONSUME( LITLEN_BITS );
+				e = litlenTable[ E_VALUE( e ) + BITS( E_EXTRA( e ) ) ];
+			}
+			CONSUME( E_LEN( e ) );
+
+			if ( e & E_LITERAL ) {
+				if ( out >= outEnd )
+					goto shortoutput;
+				*out++ = E_VALUE( e );
+				continue;
+			}
+
+			if ( e & E_LITERAL2 ) {
+				if ( outEnd - out < 2 )
+					goto shortoutput;
+				out[0] = E_VALUE( e ) & 0xFF;
+				out[1] = E_VALUE( e ) >> 8;
+				out += 2;
+				continue;
+			}
+
+			if ( e & ( E_EOB | E_INVALID ) ) {
+				if ( e & E_INVALID )
+					goto baddata;
+				break;
+			}
+
+			length = E_VALUE( e ) + BITS( E_EXTRA( e ) );
+			CONSUME( E_EXTRA( e ) );
+
+			e = distTable[ BITS( DIST_BITS ) ];
+			if ( e & E_SUBTABLE ) {
+				CONSUME( DIST_BITS );
+				e = distTable[ E_VALUE( e ) + BITS( E_EXTRA( e ) ) ];
+			}
+			if ( e & E_INVALID )
+				goto baddata;
+			CONSUME( E_LEN( e ) );
+
+			distance = E_VALUE( e ) + BITS( E_EXTRA( e ) );
+			CONSUME( E_EXTRA( e ) );
+
+			if ( distance > (uint32_t)( out - dest ) )
+				goto baddata;
+			if ( length > (uint32_t)( outEnd - out ) )
+				goto shortoutput;
+
+			src = out - distance;
+			if ( distance >= 8 && (uint32_t)( outEnd - out ) >= length + 8 ) {
+				// word copies may run up to 7 bytes past the match
+				byte *end = out + length;
+				do {
+					memcpy( out, src, 8 );
+					out += 8;
+					src += 8;
+				} while ( out < end );
+				out = end;
+			} else if ( distance == 1 ) {
+				memset( out, *src, length );
+				out += length;
+			} else {
+				while ( length-- )
+					*out++ = *src++;
+			}
+		}
+	} while ( !final );
+
+	// padding bytes must not have been consumed
+	if ( bitcount < overrun * 8 )
+		goto shortinput;
+
+	in -= ( bitcount >> 3 ) - overrun;
+	result = INFLATE_OK;
+	goto done;
+
+shortinput:
+	result = INFLATE_SHORT_INPUT;
+	goto done;
+
+shortoutput:
+	result = INFLATE_SHORT_OUTPUT;
+	goto done;
+
+baddata:
+	result = INFLATE_BAD_DATA;
+
+done:
+	*destLen = out - dest;
+	*sourceLen = in - source;
+	return result;
+}
@@ -0,0 +1,39 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// inflate.h -- single-pass table-driven raw deflate decoder
+
+#ifndef __INFLATE_H
+#define __INFLATE_H
+
+#include "q_shared.h"
+
+#define INFLATE_OK				0
+#define INFLATE_SHORT_OUTPUT	1	// destination buffer too small
+#define INFLATE_SHORT_INPUT		2	// source ended before the last block
+#define INFLATE_BAD_DATA		-1	// invalid block type, code or distance
+
+// decompresses a raw deflate stream (no zlib/gzip header) in one call,
+// *destLen and *sourceLen are buffer sizes on input and are set to the
+// number of bytes produced and consumed on return
+int Inflate_Raw( byte *dest, uint32_t *destLen, const byte *source, uint32_t *sourceLen );
+
+#endif // __INFLATE_H
@@ -0,0 +1,542 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// memprof.c -- sampling allocation profiler for zone and hunk memory
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+/*
+==============================================================================
+
+A call stack is recorded for every com_memprof bytes allocated through the
+zone and hunk allocators, samples stay in the table until the memory is
+released so the table always describes live memory only.
+
+"memprof_dump" writes live samples aggregated by tag and call site, each
+sample stands for max( size, interval ) bytes so totals are estimates.
+Call sites are printed as module+offset, so dumps from the same binary can
+be diffed directly even with address space randomization.
+
+==============================================================================
+*/
+
+#define MAX_PROF_FRAMES		16
+#define MAX_PROF_SAMPLES	65536
+#define MAX_PROF_STACKS		8192
+#define PROF_HASH_SIZE		16384 // must be power of two
+#define SKIP_FRAMES			2 // Com_MemProfAlloc and allocator itself
+
+typedef struct profstack_s {
+	void		*frames[ MAX_PROF_FRAMES ];
+	int			numFrames;
+	unsigned	hash;
+	int			next;		// hash chain
+} profstack_t;
+
+typedef struct profsample_s {
+	const void	*ptr;
+	int			size;
+	int			tag;
+	int			stack;
+	int			next;		// hash chain or free list
+} profsample_t;
+
+typedef struct profsite_s {
+	int			tag;
+	int			stack;
+	int			count;
+	int			bytes;		// sampled bytes
+	int			estimate;	// estimated live bytes
+} profsite_t;
+
+int com_memprofInterval; // sampling interval in bytes, 0 when disabled
+
+static cvar_t *com_memprof;
+
+static volatile int profLock;
+static Q_THREADLOCAL int bytesUntilSample;
+
+static profsample_t *samples;
+static profstack_t *stacks;
+static int *sampleHash;
+static int *stackHash;
+static int freeSample;
+static int numSamples;
+static int numStacks;
+static int droppedSamples;
+
+
+static unsigned HashPtr( const void *ptr )
+{
+	const uintptr_t v = (uintptr_t)ptr;
+	return (unsigned)( ( v >> 4 ) ^ ( v >> 18 ) ) & ( PROF_HASH_SIZE - 1 );
+}
+
+
+static unsigned HashFrames( void **frames, int numFrames )
+{
+	unsigned hash;
+	int i;
+
+	hash = numFrames;
+	for ( i = 0; i < numFrames; i++ ) {
+		hash = hash * 31 + (unsigned)( (uintptr_t)frames[i] >> 2 );
+	}
+
+	return hash;
+}
+
+
+/*
+================
+MemProf_Start
+================
+*/
+static void MemProf_Start( void )
+{
+	int i;
+
+	samples = calloc( MAX_PROF_SAMPLES, sizeof( samples[0] ) );
+	stacks = calloc( MAX_PROF_STACKS, sizeof( stacks[0] ) );
+	sampleHash = malloc( PROF_HASH_SIZE * sizeof( sampleHash[0] ) );
+	stackHash = malloc( PROF_HASH_SIZE * sizeof( stackHash[0] ) );
+
+	if ( !samples || !stacks || !sampleHash || !stackHash ) {
+		free( samples ); samples = NULL;
+		free( stacks ); stacks = NULL;
+		free( sampleHash ); sampleHash = NULL;
+		free( stackHash ); stackHash = NULL;
+		Com_Printf( S_COLOR_YELLOW "memprof: failed to allocate sample tables\n" );
+		return;
+	}
+
+	for ( i = 0; i < PROF_HASH_SIZE; i++ ) {
+		sampleHash[i] = stackHash[i] = -1;
+	}
+
+	for ( i = 0; i < MAX_PROF_SAMPLES - 1; i++ ) {
+		samples[i].next = i + 1;
+	}
+	samples[i].next = -1;
+
+	freeSample = 0;
+	numSamples = 0;
+	numStacks = 1; // reserved for unknown call sites
+	droppedSamples = 0;
+}
+
+
+/*
+================
+MemProf_Stop
+================
+*/
+static void MemProf_Stop( void )
+{
+	free( samples ); samples = NULL;
+	free( stacks ); stacks = NULL;
+	free( sampleHash ); sampleHash = NULL;
+	free( stackHash ); stackHash = NULL;
+	numSamples = 0;
+	numStacks = 0;
+}
+
+
+/*
+================
+FindStack
+
+Returns index of the stack, adding it if needed, must be called with lock held
+================
+*/
+static int FindStack( void **frames, int numFrames )
+{
+	const unsigned hash = HashFrames( frames, numFrames );
+	const int bucket = hash & ( PROF_HASH_SIZE - 1 );
+	profstack_t *st;
+	int i;
+
+	for ( i = stackHash[ bucket ]; i >= 0; i = st->next ) {
+		st = &stacks[ i ];
+		if ( st->hash == hash && st->numFrames == numFrames && memcmp( st->frames, frames, numFrames * sizeof( frames[0] ) ) == 0 ) {
+			return i;
+		}
+	}
+
+	if ( numFrames == 0 || numStacks >= MAX_PROF_STACKS ) {
+		return 0; // unknown call site
+	}
+
+	st = &stacks[ numStacks ];
+	memcpy( st->frames, frames, numFrames * sizeof( frames[0] ) );
+	st->numFrames = numFrames;
+	st->hash = hash;
+	st->next = stackHash[ bucket ];
+	stackHash[ bucket ] = numStacks;
+
+	return numStacks++;
+}
+
+
+/*
+================
+Com_MemProfAlloc
+
+Returns qtrue if allocation was sampled and must be reported to Com_MemProfFree
+================
+*/
+qboolean Com_MemProfAlloc( const void *ptr, int size, int tag )
+{
+	void *frames[ MAX_PROF_FRAMES + SKIP_FRAMES ];
+	profsample_t *s;
+	int numFrames, bucket, interval;
+
+	interval = com_memprofInterval;
+	if ( interval <= 0 ) {
+		return qfalse;
+	}
+
+	bytesUntilSample -= size;
+	if ( bytesUntilSample > 0 ) {
+		return qfalse;
+	}
+
+	do {
+		bytesUntilSample += interval;
+	} while ( bytesUntilSample <= 0 );
+
+	// capture stack before taking the lock
+	numFrames = Sys_BackTrace( frames, ARRAY_LEN( frames ) );
+	if ( numFrames > SKIP_FRAMES ) {
+		numFrames -= SKIP_FRAMES;
+	} else {
+		numFrames = 0;
+	}
+
+	Com_SpinLock( &profLock );
+
+	if ( samples == NULL ) {
+		Com_SpinUnlock( &profLock );
+		return qfalse;
+	}
+
+	if ( freeSample < 0 ) {
+		droppedSamples++;
+		Com_SpinUnlock( &profLock );
+		return qfalse;
+	}
+
+	s = &samples[ freeSample ];
+	freeSample = s->next;
+
+	s->ptr = ptr;
+	s->size = size;
+	s->tag = tag;
+	s->stack = FindStack( frames + ( numFrames ? SKIP_FRAMES : 0 ), numFrames );
+
+	bucket = HashPtr( ptr );
+	s->next = sampleHash[ bucket ];
+	sampleHash[ bucket ] = s - samples;
+	numSamples++;
+
+	Com_SpinUnlock( &profLock );
+
+	return qtrue;
+}
+
+
+/*
+================
+Com_MemProfFree
+================
+*/
+void Com_MemProfFree( const void *ptr )
+{
+	profsample_t *s;
+	int *link;
+
+	if ( numSamples == 0 ) {
+		return;
+	}
+
+	Com_SpinLock( &profLock );
+
+	if ( samples != NULL ) {
+		for ( link = &sampleHash[ HashPtr( ptr ) ]; *link >= 0; link = &s->next ) {
+			s = &samples[ *link ];
+			if ( s->ptr == ptr ) {
+				*link = s->next;
+				s->ptr = NULL;
+				s->next = freeSample;
+				freeSample = s - samples;
+				numSamples--;
+				break;
+			}
+		}
+	}
+
+	Com_SpinUnlock( &profLock );
+}
+
+
+/*
+================
+Com_MemProfFreeRange
+
+Drops all samples with specified tag in [start, end) range, used on hunk resets
+================
+*/
+void Com_MemProfFreeRange( const void *start, const void *end, int tag )
+{
+	profsample_t *s;
+	int *link;
+	int i;
+
+	if ( numSamples == 0 ) {
+		return;
+	}
+
+	Com_SpinLock( &profLock );
+
+	if ( samples != NULL ) {
+		for ( i = 0; i < PROF_HASH_SIZE; i++ ) {
+			for ( link = &sampleHash[ i ]; *link >= 0; ) {
+				s = &samples[ *link ];
+				if ( s->tag == tag && (const byte *)s->ptr >= (const byte *)start && (const byte *)s->ptr < (const byte *)end ) {
+					*link = s->next;
+					s->ptr = NULL;
+					s->next = freeSample;
+					freeSample = s - samples;
+					numSamples--;
+				} else {
+					link = &s->next;
+				}
+			}
+		}
+	}
+
+	Com_SpinUnlock( &profLock );
+}
+
+
+static int QDECL SortSitesByKey( const void *a, const void *b )
+{
+	const profsite_t *sa = (const profsite_t *)a;
+	const profsite_t *sb = (const profsite_t *)b;
+
+	if ( sa->tag != sb->tag )
+		return sa->tag - sb->tag;
+
+	return sa->stack - sb->stack;
+}
+
+
+static int QDECL SortSitesByEstimate( const void *a, const void *b )
+{
+	const profsite_t *sa = (const profsite_t *)a;
+	const profsite_t *sb = (const profsite_t *)b;
+
+	if ( sa->estimate != sb->estimate )
+		return sb->estimate > sa->estimate ? 1 : -1;
+
+	return SortSitesByKey( a, b );
+}
+
+
+static void WriteString( fileHandle_t f, const char *fmt, ... ) FORMAT_PRINTF(2, 3);
+
+static void WriteString( fileHandle_t f, const char *fmt, ... )
+{
+	char buf[ MAXPRINTMSG ];
+	va_list argptr;
+	int len;
+
+	va_start( argptr, fmt );
+	len = Q_vsnprintf( buf, sizeof( buf ), fmt, argptr );
+	va_end( argptr );
+
+	FS_Write( buf, len, f );
+}
+
+
+/*
+================
+MemProf_Dump_f
+================
+*/
+static void MemProf_Dump_f( void )
+{
+	char filename[ MAX_QPATH ], name[ 256 ];
+	profsite_t *sites, *site;
+	int tagCount[ MEMPROF_TAG_COUNT ], tagEstimate[ MEMPROF_TAG_COUNT ];
+	int i, j, n, numSites, interval;
+	const profsample_t *s;
+	const profstack_t *st;
+	fileHandle_t f;
+	qtime_t t;
+
+	if ( samples == NULL ) {
+		Com_Printf( "memprof is not active, set com_memprof to sampling interval in bytes\n" );
+		return;
+	}
+
+	if ( Cmd_Argc() > 1 ) {
+		Q_strncpyz( filename, Cmd_Argv( 1 ), sizeof( filename ) );
+	} else {
+		Com_RealTime( &t );
+		Com_sprintf( filename, sizeof( filename ), "memprof/memprof-%04d%02d%02d-%02d%02d%02d.txt",
+			1900 + t.tm_year, 1 + t.tm_mon, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec );
+	}
+
+	if ( !FS_AllowedExtension( filename, qfalse, NULL ) ) {
+		Com_Printf( "%s: Invalid filename extension '%s'.\n", __func__, COM_GetExtension( filename ) );
+		return;
+	}
+
+	sites = malloc( MAX_PROF_SAMPLES * sizeof( sites[0] ) );
+	if ( sites == NULL ) {
+		Com_Printf( S_COLOR_YELLOW "memprof: failed to allocate dump buffer\n" );
+		return;
+	}
+
+	// snapshot live samples
+	Com_SpinLock( &profLock );
+	interval = com_memprofInterval;
+	for ( i = 0, n = 0; i < MAX_PROF_SAMPLES; i++ ) {
+		s = &samples[ i ];
+		if ( s->ptr == NULL )
+			continue;
+		sites[ n ].tag = s->tag;
+		sites[ n ].stack = s->stack;
+		sites[ n ].count = 1;
+		sites[ n ].bytes = s->size;
+		sites[ n ].estimate = MAX( s->size, interval );
+		n++;
+	}
+	Com_SpinUnlock( &profLock );
+
+	// aggregate by tag and call site
+	qsort( sites, n, sizeof( sites[0] ), SortSitesByKey );
+	for ( i = 0, numSites = 0; i < n; i++ ) {
+		if ( numSites && sites[ numSites-1 ].tag == sites[ i ].tag && sites[ numSites-1 ].stack == sites[ i ].stack ) {
+			site = &sites[ numSites-1 ];
+			site->count++;
+			site->bytes += sites[ i ].bytes;
+			site->estimate += sites[ i ].estimate;
+		} else {
+			sites[ numSites++ ] = sites[ i ];
+		}
+	}
+	qsort( sites, numSites, sizeof( sites[0] ), SortSitesByEstimate );
+
+	f = FS_FOpenFileWrite( filename );
+	if ( f == FS_INVALID_HANDLE ) {
+		Com_Printf( "memprof: couldn't create %s\n", filename );
+		free( sites );
+		return;
+	}
+
+	memset( tagCount, 0, sizeof( tagCount ) );
+	memset( tagEstimate, 0, sizeof( tagEstimate ) );
+	for ( i = 0; i < numSites; i++ ) {
+		tagCount[ sites[i].tag ] += sites[i].count;
+		tagEstimate[ sites[i].tag ] += sites[i].estimate;
+	}
+
+	WriteString( f, "# memprof interval %i bytes, %i live samples, %i call sites, %i dropped samples\n",
+		interval, n, numSites, droppedSamples );
+	WriteString( f, "# tag summary: estimated_bytes samples tag\n" );
+	for ( i = 0; i < MEMPROF_TAG_COUNT; i++ ) {
+		if ( tagCount[ i ] ) {
+			WriteString( f, "%10i %7i %s\n", tagEstimate[ i ], tagCount[ i ], Z_TagName( i ) );
+		}
+	}
+	WriteString( f, "# call sites: estimated_bytes sampled_bytes samples tag stack\n" );
+	for ( i = 0; i < numSites; i++ ) {
+		site = &sites[ i ];
+		st = &stacks[ site->stack ];
+		WriteString( f, "%10i %10i %7i %s", site->estimate, site->bytes, site->count, Z_TagName( site->tag ) );
+		for ( j = 0; j < st->numFrames; j++ ) {
+			Sys_AddressName( st->frames[ j ], name, sizeof( name ) );
+			WriteString( f, " %s", name );
+		}
+		WriteString( f, st->numFrames ? "\n" : " <unknown>\n" );
+	}
+
+	FS_FCloseFile( f );
+	free( sites );
+
+	Com_Printf( "memprof: wrote %i call sites to %s\n", numSites, filename );
+}
+
+
+/*
+================
+Com_MemProfFrame
+
+Applies com_memprof changes
+================
+*/
+void Com_MemProfFrame( void )
+{
+	if ( !com_memprof->modified ) {
+		return;
+	}
+
+	com_memprof->modified = qfalse;
+
+	if ( com_memprof->integer > 0 ) {
+		if ( samples == NULL ) {
+			MemProf_Start();
+		}
+		if ( samples != NULL ) {
+			com_memprofInterval = com_memprof->integer;
+			bytesUntilSample = com_memprofInterval;
+		}
+	} else if ( samples != NULL ) {
+		com_memprofInterval = 0;
+		Com_SpinLock( &profLock );
+		MemProf_Stop();
+		Com_SpinUnlock( &profLock );
+	}
+}
+
+
+/*
+================
+Com_MemProfInit
+================
+*/
+void Com_MemProfInit( void )
+{
+	com_memprof = Cvar_Get( "com_memprof", "0", 0 );
+	Cvar_CheckRange( com_memprof, "0", NULL, CV_INTEGER );
+	Cvar_SetDescription( com_memprof, "Sampling allocation profiler, records call stack for every N bytes allocated from zone and hunk.\n"
+		" 0 - disabled\n"
+		" N - sampling interval in bytes, 524288 is a good start\n"
+		"Use \\memprof_dump to write live allocations by tag and call site." );
+	com_memprof->modified = qtrue;
+
+	Cmd_AddCommand( "memprof_dump", MemProf_Dump_f );
+
+	Com_MemProfFrame();
+}
@@ -215,6 +215,15 @@ static int numIP;
 
 static void	NET_Restart_f( void );
 
+typedef struct {
+	SOCKET		s;
+	qboolean	active;
+	qboolean	wantRead;
+	qboolean	wantWrite;
+} tcpSocket_t;
+
+static tcpSocket_t tcpSockets[ MAX_TCP_SOCKETS ];
+
 //=============================================================================
 
 
@@ -1802,6 +1811,8 @@ void NET_Shutdown( void ) {
 
 	NET_Config( qfalse );
 
+	NET_TCPCloseAll();
+
 #ifdef _WIN32
 	WSACleanup();
 	winsockInitialized = qfalse;
@@ -1809,6 +1820,297 @@ void NET_Shutdown( void ) {
 }
 
 
+/*
+=============================================================================
+
+TCP STREAMS
+
+Non-blocking sockets for the built-in HTTP server, watched by NET_Sleep()
+together with game sockets and serviced by SV_HTTPEvent()
+
+=============================================================================
+*/
+
+#ifdef MSG_NOSIGNAL
+#define TCP_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define TCP_SEND_FLAGS 0
+#endif
+
+/*
+====================
+NET_TCPAlloc
+====================
+*/
+static int NET_TCPAlloc( SOCKET s ) {
+	ioctlarg_t	_true = 1;
+#ifdef SO_NOSIGPIPE
+	int			i = 1;
+#endif
+	int			index;
+
+	for ( index = 0; index < MAX_TCP_SOCKETS; index++ ) {
+		if ( !tcpSockets[ index ].active ) {
+			break;
+		}
+	}
+
+	if ( index == MAX_TCP_SOCKETS ) {
+		closesocket( s );
+		return -1;
+	}
+
+	if ( ioctlsocket( s, FIONBIO, &_true ) == SOCKET_ERROR ) {
+		Com_Printf( "WARNING: NET_TCPAlloc: ioctl FIONBIO: %s\n", NET_ErrorString() );
+		closesocket( s );
+		return -1;
+	}
+
+#ifdef SO_NOSIGPIPE
+	setsockopt( s, SOL_SOCKET, SO_NOSIGPIPE, (char *) &i, sizeof( i ) );
+#endif
+
+	tcpSockets[ index ].s = s;
+	tcpSockets[ index ].active = qtrue;
+	tcpSockets[ index ].wantRead = qtrue;
+	tcpSockets[ index ].wantWrite = qfalse;
+
+	return index;
+}
+
+
+/*
+====================
+NET_TCPListen
+
+Returns socket index or -1 on error
+====================
+*/
+int NET_TCPListen( int port ) {
+	struct sockaddr_in	address;
+	SOCKET				s;
+	int					i = 1;
+
+	Com_Printf( "Opening TCP socket: %s:%i\n", net_ip && net_ip->string[0] ? net_ip->string : "0.0.0.0", port );
+
+	memset( &address, 0, sizeof( address ) );
+
+	if ( !net_ip || !net_ip->string[0] ) {
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = INADDR_ANY;
+	} else if ( !Sys_StringToSockaddr( net_ip->string, (sockaddr_t *)&address, sizeof( address ), AF_INET, SOCK_STREAM ) ) {
+		return -1;
+	}
+
+	address.sin_port = htons( (unsigned short)port );
+
+	if ( ( s = socket( PF_INET, SOCK_STREAM, IPPROTO_TCP ) ) == INVALID_SOCKET ) {
+		Com_Printf( "WARNING: NET_TCPListen: socket: %s\n", NET_ErrorString() );
+		return -1;
+	}
+
+	setsockopt( s, SOL_SOCKET, SO_REUSEADDR, (char *) &i, sizeof( i ) );
+
+	if ( bind( s, (void *)&address, sizeof( address ) ) == SOCKET_ERROR ) {
+		Com_Printf( "WARNING: NET_TCPListen: bind: %s\n", NET_ErrorString() );
+		closesocket( s );
+		return -1;
+	}
+
+	if ( listen( s, 16 ) == SOCKET_ERROR ) {
+		Com_Printf( "WARNING: NET_TCPListen: listen: %s\n", NET_ErrorString() );
+		closesocket( s );
+		return -1;
+	}
+
+	return NET_TCPAlloc( s );
+}
+
+
+/*
+====================
+NET_TCPAccept
+
+Returns socket index of accepted connection or -1 if there is none
+====================
+*/
+int NET_TCPAccept( int listener, netadr_t *from ) {
+	sockaddr_t	addr;
+	socklen_t	addrlen;
+	SOCKET		s;
+
+	if ( listener < 0 || !tcpSockets[ listener ].active ) {
+		return -1;
+	}
+
+	addrlen = sizeof( addr );
+	s = accept( tcpSockets[ listener ].s, (struct sockaddr *) &addr, &addrlen );
+	if ( s == INVALID_SOCKET ) {
+		return -1;
+	}
+
+	SockadrToNetadr( &addr, from );
+
+	return NET_TCPAlloc( s );
+}
+
+
+/*
+====================
+NET_TCPRecv
+
+Returns number of bytes received, 0 if there is no data or -1 if connection is closed
+====================
+*/
+int NET_TCPRecv( int sock, void *data, int len ) {
+	int ret;
+
+	if ( sock < 0 || !tcpSockets[ sock ].active ) {
+		return -1;
+	}
+
+	ret = recv( tcpSockets[ sock ].s, data, len, 0 );
+	if ( ret > 0 ) {
+		return ret;
+	}
+
+	if ( ret == SOCKET_ERROR && socketError == EAGAIN ) {
+		return 0;
+	}
+
+	return -1;
+}
+
+
+/*
+====================
+NET_TCPSend
+
+Returns number of bytes sent, 0 if socket buffer is full or -1 on error
+====================
+*/
+int NET_TCPSend( int sock, const void *data, int len ) {
+	int ret;
+
+	if ( sock < 0 || !tcpSockets[ sock ].active ) {
+		return -1;
+	}
+
+	ret = send( tcpSockets[ sock ].s, data, len, TCP_SEND_FLAGS );
+	if ( ret >= 0 ) {
+		return ret;
+	}
+
+	if ( socketError == EAGAIN ) {
+		return 0;
+	}
+
+	return -1;
+}
+
+
+/*
+====================
+NET_TCPWantRead
+
+Whether NET_Sleep() should wake up when socket has data to read,
+must be disabled while the owner is not going to consume it
+====================
+*/
+void NET_TCPWantRead( int sock, qboolean wantRead ) {
+	if ( sock >= 0 && tcpSockets[ sock ].active ) {
+		tcpSockets[ sock ].wantRead = wantRead;
+	}
+}
+
+
+/*
+====================
+NET_TCPWantWrite
+
+Whether NET_Sleep() should wake up when socket becomes writable
+====================
+*/
+void NET_TCPWantWrite( int sock, qboolean wantWrite ) {
+	if ( sock >= 0 && tcpSockets[ sock ].active ) {
+		tcpSockets[ sock ].wantWrite = wantWrite;
+	}
+}
+
+
+/*
+====================
+NET_TCPClose
+====================
+*/
+void NET_TCPClose( int sock ) {
+	if ( sock >= 0 && tcpSockets[ sock ].active ) {
+		closesocket( tcpSockets[ sock ].s );
+		tcpSockets[ sock ].active = qfalse;
+	}
+}
+
+
+/*
+====================
+NET_TCPCloseAll
+====================
+*/
+void NET_TCPCloseAll( void ) {
+	int i;
+
+	for ( i = 0; i < MAX_TCP_SOCKETS; i++ ) {
+		NET_TCPClose( i );
+	}
+}
+
+
+/*
+====================
+NET_TCPSetFDs
+====================
+*/
+static void NET_TCPSetFDs( fd_set *fdr, fd_set *fdw, SOCKET *highestfd ) {
+	int i;
+
+	for ( i = 0; i < MAX_TCP_SOCKETS; i++ ) {
+		if ( !tcpSockets[ i ].active ) {
+			continue;
+		}
+		if ( !tcpSockets[ i ].wantRead && !tcpSockets[ i ].wantWrite ) {
+			continue;
+		}
+		if ( tcpSockets[ i ].wantRead ) {
+			FD_SET( tcpSockets[ i ].s, fdr );
+		}
+		if ( tcpSockets[ i ].wantWrite ) {
+			FD_SET( tcpSockets[ i ].s, fdw );
+		}
+		if ( *highestfd == INVALID_SOCKET || tcpSockets[ i ].s > *highestfd ) {
+			*highestfd = tcpSockets[ i ].s;
+		}
+	}
+}
+
+
+/*
+====================
+NET_TCPIsSet
+====================
+*/
+static qboolean NET_TCPIsSet( const fd_set *fdr, const fd_set *fdw ) {
+	int i;
+
+	for ( i = 0; i < MAX_TCP_SOCKETS; i++ ) {
+		if ( tcpSockets[ i ].active && ( FD_ISSET( tcpSockets[ i ].s, fdr ) || FD_ISSET( tcpSockets[ i ].s, fdw ) ) ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
 /*
 ====================
 NET_Event
@@ -1862,7 +2164,7 @@ Returns qfalse on network event or qtrue in all other cases
 qboolean NET_Sleep( int timeout )
 {
 	struct timeval tv;
-	fd_set fdr;
+	fd_set fdr, fdw;
 	int retval;
 	SOCKET highestfd = INVALID_SOCKET;
 
@@ -1870,6 +2172,7 @@ qboolean NET_Sleep( int timeout )
 		timeout = 0;
 
 	FD_ZERO( &fdr );
+	FD_ZERO( &fdw );
 
 	if ( ip_socket != INVALID_SOCKET )
 	{
@@ -1888,6 +2191,8 @@ qboolean NET_Sleep( int timeout )
 	}
 #endif
 
+	NET_TCPSetFDs( &fdr, &fdw, &highestfd );
+
 	if ( highestfd == INVALID_SOCKET )
 	{
 #ifdef _WIN32
@@ -1906,9 +2211,12 @@ qboolean NET_Sleep( int timeout )
 	tv.tv_sec = timeout / 1000000;
 	tv.tv_usec = timeout - tv.tv_sec * 1000000;
 
-	retval = select( highestfd + 1, &fdr, NULL, NULL, &tv );
+	retval = select( highestfd + 1, &fdr, &fdw, NULL, &tv );
 
 	if ( retval > 0 ) {
+		if ( NET_TCPIsSet( &fdr, &fdw ) ) {
+			SV_HTTPEvent();
+		}
 		NET_Event( &fdr );
 		return qfalse;
 	}
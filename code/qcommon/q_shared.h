@@ -229,6 +229,71 @@ int Q_longjmp_c(void *, int);
 #define Q_longjmp longjmp
 #endif
 
+/*
+==============================================================
+
+ATOMICS
+
+Minimal set of primitives for subsystems that may be used from
+worker threads, all operations are full memory barriers
+
+==============================================================
+*/
+
+#ifndef Q3_VM
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define Q_THREADLOCAL				__declspec(thread)
+#define Q_AtomicTestAndSet(ptr)		_InterlockedExchange( (volatile long *)(ptr), 1 )
+#define Q_AtomicRelease(ptr)		_InterlockedExchange( (volatile long *)(ptr), 0 )
+#define Q_AtomicExchange(ptr, val)	_InterlockedExchange( (volatile long *)(ptr), (val) )
+#define Q_AtomicAdd(ptr, val)		( _InterlockedExchangeAdd( (volatile long *)(ptr), (val) ) + (val) )
+#define Q_AtomicOr(ptr, val)		_InterlockedOr( (volatile long *)(ptr), (val) )
+#define Q_AtomicLoad(ptr)			_InterlockedOr( (volatile long *)(ptr), 0 )
+#else
+#define Q_THREADLOCAL				__thread
+#define Q_AtomicTestAndSet(ptr)		__sync_lock_test_and_set( (ptr), 1 )
+#define Q_AtomicRelease(ptr)		__sync_lock_release( (ptr) )
+#define Q_AtomicExchange(ptr, val)	__sync_lock_test_and_set( (ptr), (val) )
+#define Q_AtomicAdd(ptr, val)		__sync_add_and_fetch( (ptr), (val) )
+#define Q_AtomicOr(ptr, val)		__sync_fetch_and_or( (ptr), (val) )
+#define Q_AtomicLoad(ptr)			__sync_fetch_and_or( (ptr), 0 )
+#endif
+
+// spin-wait hint, lets the sibling hyperthread run and saves power
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#define Q_SpinPause()				_mm_pause()
+#elif ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#define Q_SpinPause()				__builtin_ia32_pause()
+#elif ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __aarch64__ ) || defined( __arm__ ) )
+#define Q_SpinPause()				__asm__ __volatile__( "yield" )
+#else
+#define Q_SpinPause()				do { } while ( 0 )
+#endif
+
+// busy-wait lock for short critical sections, not recursive
+#define Com_SpinLock(ptr)			do { while ( Q_AtomicTestAndSet( ptr ) ) { while ( *(ptr) ) { Q_SpinPause(); } } } while ( 0 )
+#define Com_SpinUnlock(ptr)			Q_AtomicRelease( ptr )
+
+#endif // !Q3_VM
+
+// CPU_Flags, also passed to the renderer
+
+// x86 flags
+#define CPU_FCOM   0x01
+#define CPU_MMX    0x02
+#define CPU_SSE    0x04
+#define CPU_SSE2   0x08
+#define CPU_SSE3   0x10
+#define CPU_SSE41  0x20
+#define CPU_AVX2   0x40
+
+// ARM flags
+#define CPU_ARMv7  0x01
+#define CPU_IDIVA  0x02
+#define CPU_VFPv3  0x04
+
 typedef unsigned char byte;
 
 typedef enum { qfalse = 0, qtrue } qboolean;
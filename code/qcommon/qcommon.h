@@ -217,6 +217,18 @@ void		NET_LeaveMulticast6( void );
 #endif
 qboolean	NET_Sleep( int timeout );
 
+// non-blocking TCP streams, used by the built-in HTTP server
+#define	MAX_TCP_SOCKETS	64
+
+int			NET_TCPListen( int port );
+int			NET_TCPAccept( int listener, netadr_t *from );
+int			NET_TCPRecv( int sock, void *data, int len );
+int			NET_TCPSend( int sock, const void *data, int len );
+void		NET_TCPWantRead( int sock, qboolean wantRead );
+void		NET_TCPWantWrite( int sock, qboolean wantWrite );
+void		NET_TCPClose( int sock );
+void		NET_TCPCloseAll( void );
+
 #define	MAX_PACKETLEN	1400	// max size of a network packet
 
 #define	MAX_MSGLEN		16384	// max length of a message, which may
@@ -801,9 +813,30 @@ int		FS_ReadFile( const char *qpath, void **buffer );
 void	FS_ForceFlush( fileHandle_t f );
 // forces flush on files we're writing to.
 
+qboolean FS_SetAsync( fileHandle_t f );
+// hands writing of a file to the background writer thread
+
 void	FS_FreeFile( void *buffer );
 // frees the memory returned by FS_ReadFile
 
+void	FS_PreloadFiles( const char **qpaths, int count );
+// starts reading files on a background thread, next FS_FOpenFileRead
+// of the same file will return its contents from memory
+
+void	FS_PreloadCancel( void );
+// releases all preloaded data which was not used yet
+
+qboolean FS_FileStamp( const char *filename, char *stamp, int stampSize );
+// describes where a file would be read from, changes when the file does
+
+void	*FS_LocateFile( const char *qpath, int *size );
+// finds a file on the main thread so that it can be read on another one
+
+qboolean FS_ReadLocatedFile( const void *location, void *buffer );
+// reads a located file into a buffer of its size, safe from any thread
+
+void	FS_FreeLocation( void *location );
+
 void	FS_WriteFile( const char *qpath, const void *buffer, int size );
 // writes a complete file, creating any subdirectories needed
 
@@ -938,20 +971,7 @@ extern char cl_cdkey[34];
 // customizable client window title
 extern char cl_title[ MAX_CVAR_VALUE_STRING ];
 
-extern	int	CPU_Flags;
-
-// x86 flags
-#define CPU_FCOM   0x01
-#define CPU_MMX    0x02
-#define CPU_SSE    0x04
-#define CPU_SSE2   0x08
-#define CPU_SSE3   0x10
-#define CPU_SSE41  0x20
-
-// ARM flags
-#define CPU_ARMv7  0x01
-#define CPU_IDIVA  0x02
-#define CPU_VFPv3  0x04
+extern	int	CPU_Flags; // CPU_* flags from q_shared.h
 
 // TTimo
 // centralized and cleaned, that's the max string you can send to a Com_Printf / Com_DPrintf (above gets truncated)
@@ -993,6 +1013,7 @@ qboolean	Com_FilterExt( const char *filter, const char *name );
 qboolean	Com_HasPatterns( const char *str );
 int			Com_FilterPath( const char *filter, const char *name );
 int			Com_RealTime(qtime_t *qtime);
+int			Com_CPUFlags( void );
 qboolean	Com_SafeMode( void );
 void		Com_RunAndTimeServerPacket( const netadr_t *evFrom, msg_t *buf );
 
@@ -1123,6 +1144,19 @@ void Z_Free( void *ptr );
 int Z_FreeTags( memtag_t tag );
 int Z_AvailableMemory( void );
 void Z_LogHeap( void );
+void Z_ReleaseThreadCache( void );	// done automatically when a Sys_CreateThread function returns
+const char *Z_TagName( int tag );
+
+// sampling allocation profiler, see memprof.c
+#define MEMPROF_TAG_HUNK		(TAG_COUNT+0)
+#define MEMPROF_TAG_HUNK_TEMP	(TAG_COUNT+1)
+#define MEMPROF_TAG_COUNT		(TAG_COUNT+2)
+extern int com_memprofInterval;
+void Com_MemProfInit( void );
+void Com_MemProfFrame( void );
+qboolean Com_MemProfAlloc( const void *ptr, int size, int tag );
+void Com_MemProfFree( const void *ptr );
+void Com_MemProfFreeRange( const void *start, const void *end, int tag );
 
 void Hunk_Clear( void );
 void Hunk_ClearToMark( void );
@@ -1226,6 +1260,7 @@ void SV_PacketEvent( const netadr_t *from, msg_t *msg );
 int SV_FrameMsec( void );
 qboolean SV_GameCommand( void );
 int SV_SendQueuedPackets( void );
+void SV_HTTPEvent( void );
 
 void SV_AddDedicatedCommands( void );
 void SV_RemoveDedicatedCommands( void );
@@ -1349,6 +1384,23 @@ void *Sys_LoadFunction( void *handle, const char *name );
 int   Sys_LoadFunctionErrors( void );
 void  Sys_UnloadLibrary( void *handle );
 
+int   Sys_BackTrace( void **frames, int maxFrames );
+void  Sys_AddressName( const void *addr, char *buf, int size );
+
+typedef void (*threadFunc_t)( void *arg );
+
+void *Sys_CreateThread( threadFunc_t func, void *arg );	// returns NULL on failure
+void  Sys_JoinThread( void *thread );
+void *Sys_CreateSemaphore( void );	// returns NULL on failure
+void  Sys_DestroySemaphore( void *sem );
+void  Sys_PostSemaphore( void *sem, int count );
+void  Sys_WaitSemaphore( void *sem );
+int   Sys_NumCPUs( void );
+
+void  Sys_SyncFile( FILE *f );	// flushes stdio and OS buffers to disk
+void *Sys_MapSharedFile( const char *ospath, int size );	// read-write, visible to other processes
+void  Sys_UnmapSharedFile( void *data, int size );
+
 // adaptive huffman functions
 void Huff_Compress( msg_t *buf, int offset );
 void Huff_Decompress( msg_t *buf, int offset );
@@ -10,6 +10,7 @@
 #include "../qcommon/q_shared.h"
 #include "../qcommon/qcommon.h"
 #include "unzip.h"
+#include "inflate.h"
 
 /* unzip.h -- IO for uncompress .zip files using zlib 
    Version 0.15 beta, Mar 19th, 1998,
@@ -1064,6 +1065,11 @@ static void   zcfree  OF((voidp opaque, voidp ptr));
 #define UNZ_MAXFILENAMEINZIP (256)
 #endif
 
+/* partial reads of files up to this size inflate the whole file at once */
+#ifndef UNZ_INFLATE_BUFSIZE
+#define UNZ_INFLATE_BUFSIZE (1024*1024)
+#endif
+
 #ifndef ALLOC
 # define ALLOC(size) (Z_Malloc(size))
 #endif
@@ -1076,6 +1082,67 @@ static void   zcfree  OF((voidp opaque, voidp ptr));
 
 
 
+/* ===========================================================================
+   Slicing-by-8 CRC-32 of uncompressed data, the table is built by the first
+   unzOpen() which happens on the main thread before any reader threads exist.
+*/
+static uint32_t unz_crc_table[8][256];
+static int unz_crc_table_ready = 0;
+
+static void unzlocal_InitCRCTable (void)
+{
+	uint32_t c;
+	int i, j;
+
+	for (i=0;i<256;i++)
+	{
+		c = i;
+		for (j=0;j<8;j++)
+			c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+		unz_crc_table[0][i] = c;
+	}
+	for (i=0;i<256;i++)
+	{
+		c = unz_crc_table[0][i];
+		for (j=1;j<8;j++)
+		{
+			c = unz_crc_table[0][c & 0xFF] ^ (c >> 8);
+			unz_crc_table[j][i] = c;
+		}
+	}
+	unz_crc_table_ready = 1;
+}
+
+static uLong unzlocal_crc32 (uLong crc, const Byte *buf, uInt len)
+{
+	uint32_t c = (uint32_t)crc ^ 0xFFFFFFFF;
+	uint32_t lo, hi;
+
+	while (len && ((intptr_t)buf & 7))
+	{
+		c = unz_crc_table[0][(c ^ *buf++) & 0xFF] ^ (c >> 8);
+		len--;
+	}
+
+	while (len >= 8)
+	{
+		lo = c ^ ( buf[0] | ( buf[1] << 8 ) | ( buf[2] << 16 ) | ( (uint32_t)buf[3] << 24 ) );
+		hi = buf[4] | ( buf[5] << 8 ) | ( buf[6] << 16 ) | ( (uint32_t)buf[7] << 24 );
+		c = unz_crc_table[7][lo & 0xFF] ^ unz_crc_table[6][(lo >> 8) & 0xFF] ^
+			unz_crc_table[5][(lo >> 16) & 0xFF] ^ unz_crc_table[4][lo >> 24] ^
+			unz_crc_table[3][hi & 0xFF] ^ unz_crc_table[2][(hi >> 8) & 0xFF] ^
+			unz_crc_table[1][(hi >> 16) & 0xFF] ^ unz_crc_table[0][hi >> 24];
+		buf += 8;
+		len -= 8;
+	}
+
+	while (len--)
+		c = unz_crc_table[0][(c ^ *buf++) & 0xFF] ^ (c >> 8);
+
+	return c ^ 0xFFFFFFFF;
+}
+
+
 /* ===========================================================================
      Read a byte from a gz_stream; update next_in and avail_in. Return EOF
    for end of file.
@@ -1345,6 +1412,9 @@ extern unzFile unzOpen (const char* path)
 
 	int err=UNZ_OK;
 
+	if (!unz_crc_table_ready)
+		unzlocal_InitCRCTable();
+
     fin=F_OPEN(path,"rb");
 	if (fin==NULL)
 		return NULL;
@@ -1905,7 +1975,6 @@ static int unzlocal_CheckCurrentFileCoherencyHeader (unz_s* s, uInt* piSizeVar,
 */
 extern int unzOpenCurrentFile (unzFile file)
 {
-	int err/*=UNZ_OK*/;
 	int Store;
 	uInt iSizeVar;
 	unz_s* s;
@@ -1932,6 +2001,7 @@ extern int unzOpenCurrentFile (unzFile file)
 		return UNZ_INTERNALERROR;
 
 	pfile_in_zip_read_info->read_buffer=(char*)ALLOC(UNZ_BUFSIZE);
+	pfile_in_zip_read_info->inflate_buffer=NULL;
 	pfile_in_zip_read_info->offset_local_extrafield = offset_local_extrafield;
 	pfile_in_zip_read_info->size_local_extrafield = size_local_extrafield;
 	pfile_in_zip_read_info->pos_local_extrafield=0;
@@ -1966,9 +2036,8 @@ extern int unzOpenCurrentFile (unzFile file)
 	  pfile_in_zip_read_info->stream.zfree = (free_func)0;
 	  pfile_in_zip_read_info->stream.opaque = (voidp)0; 
       
-	  err=inflateInit2(&pfile_in_zip_read_info->stream, -MAX_WBITS);
-	  if (err == Z_OK)
-	    pfile_in_zip_read_info->stream_initialised=1;
+	  /* the stream is initialised by the first read that needs it,
+	     most files are inflated in one pass by unzlocal_InflateCurrentFile */
         /* windowBits is passed < 0 to tell that there is no zlib header.
          * Note that in this case inflate *requires* an extra "dummy" byte
          * after the compressed stream in order to complete decompression and
@@ -1995,6 +2064,58 @@ extern int unzOpenCurrentFile (unzFile file)
 }
 
 
+/*
+  Inflate the whole current file into dest in one call, dest must hold
+  uncompressed_size bytes. Return UNZ_OK, or an error code to fall back
+  to the streaming inflate (nothing is consumed in that case).
+*/
+static int unzlocal_InflateCurrentFile (unz_s* s, Byte* dest)
+{
+	file_in_zip_read_info_s* pfile_in_zip_read_info = s->pfile_in_zip_read;
+	uLong compressed_size = s->cur_file_info.compressed_size;
+	uLong uncompressed_size = s->cur_file_info.uncompressed_size;
+	uint32_t destLen, sourceLen;
+	Byte *source;
+	int err;
+
+	/* small files fit in the read buffer, larger ones are not worth a zone allocation */
+	if (compressed_size <= UNZ_BUFSIZE)
+		source = (Byte*)pfile_in_zip_read_info->read_buffer;
+	else
+		source = (Byte*)malloc(compressed_size);
+	if (source==NULL)
+		return UNZ_INTERNALERROR;
+
+	err = UNZ_OK;
+	if (fseek(pfile_in_zip_read_info->file,
+			  pfile_in_zip_read_info->pos_in_zipfile +
+				 pfile_in_zip_read_info->byte_before_the_zipfile,SEEK_SET)!=0)
+		err = UNZ_ERRNO;
+	else if (compressed_size && fread(source,compressed_size,1,pfile_in_zip_read_info->file)!=1)
+		err = UNZ_ERRNO;
+
+	if (err==UNZ_OK)
+	{
+		destLen = uncompressed_size;
+		sourceLen = compressed_size;
+		if (Inflate_Raw(dest,&destLen,source,&sourceLen)!=INFLATE_OK || destLen!=uncompressed_size)
+			err = Z_DATA_ERROR;
+	}
+
+	if (source != (Byte*)pfile_in_zip_read_info->read_buffer)
+		free(source);
+
+	if (err!=UNZ_OK)
+		return err;
+
+	pfile_in_zip_read_info->crc32 = unzlocal_crc32(0,dest,uncompressed_size);
+	pfile_in_zip_read_info->pos_in_zipfile += compressed_size;
+	pfile_in_zip_read_info->rest_read_compressed = 0;
+
+	return UNZ_OK;
+}
+
+
 /*
   Read bytes from the current file.
   buf contain buffer where data must be copied
@@ -2025,6 +2146,56 @@ extern int unzReadCurrentFile  (unzFile file, void *buf, unsigned len)
 	if (len==0)
 		return 0;
 
+	/*
+	   Compressed files are inflated in one pass when read as a whole,
+	   or through an intermediate buffer when small enough.
+	*/
+	if ((pfile_in_zip_read_info->compression_method!=0) &&
+		(pfile_in_zip_read_info->inflate_buffer==NULL) &&
+		(pfile_in_zip_read_info->rest_read_compressed==s->cur_file_info.compressed_size) &&
+		(pfile_in_zip_read_info->stream.total_out==0))
+	{
+		uLong uSize = pfile_in_zip_read_info->rest_read_uncompressed;
+
+		if (len>=uSize)
+		{
+			if (unzlocal_InflateCurrentFile(s,(Byte*)buf)==UNZ_OK)
+			{
+				pfile_in_zip_read_info->rest_read_uncompressed = 0;
+				pfile_in_zip_read_info->stream.total_out = uSize;
+				return (int)uSize;
+			}
+		}
+		else if (uSize<=UNZ_INFLATE_BUFSIZE)
+		{
+			pfile_in_zip_read_info->inflate_buffer = (Byte*)ALLOC(uSize);
+			if (unzlocal_InflateCurrentFile(s,pfile_in_zip_read_info->inflate_buffer)!=UNZ_OK)
+			{
+				TRYFREE(pfile_in_zip_read_info->inflate_buffer);
+				pfile_in_zip_read_info->inflate_buffer = NULL;
+			}
+		}
+	}
+
+	if (pfile_in_zip_read_info->inflate_buffer!=NULL)
+	{
+		if (len>pfile_in_zip_read_info->rest_read_uncompressed)
+			len = (uInt)pfile_in_zip_read_info->rest_read_uncompressed;
+		Com_Memcpy(buf,pfile_in_zip_read_info->inflate_buffer+pfile_in_zip_read_info->stream.total_out,len);
+		pfile_in_zip_read_info->rest_read_uncompressed -= len;
+		pfile_in_zip_read_info->stream.total_out += len;
+		return (int)len;
+	}
+
+	if ((pfile_in_zip_read_info->compression_method!=0) &&
+		(!pfile_in_zip_read_info->stream_initialised))
+	{
+		err=inflateInit2(&pfile_in_zip_read_info->stream, -MAX_WBITS);
+		if (err!=Z_OK)
+			return err;
+		pfile_in_zip_read_info->stream_initialised=1;
+	}
+
 	pfile_in_zip_read_info->stream.next_out = (Byte*)buf;
 
 	pfile_in_zip_read_info->stream.avail_out = (uInt)len;
@@ -2073,9 +2244,9 @@ extern int unzReadCurrentFile  (unzFile file, void *buf, unsigned len)
 				*(pfile_in_zip_read_info->stream.next_out+i) =
                         *(pfile_in_zip_read_info->stream.next_in+i);
 					
-//			pfile_in_zip_read_info->crc32 = crc32(pfile_in_zip_read_info->crc32,
-//								pfile_in_zip_read_info->stream.next_out,
-//								uDoCopy);
+			pfile_in_zip_read_info->crc32 = unzlocal_crc32(pfile_in_zip_read_info->crc32,
+								pfile_in_zip_read_info->stream.next_out,
+								uDoCopy);
 			pfile_in_zip_read_info->rest_read_uncompressed-=uDoCopy;
 			pfile_in_zip_read_info->stream.avail_in -= uDoCopy;
 			pfile_in_zip_read_info->stream.avail_out -= uDoCopy;
@@ -2087,12 +2258,12 @@ extern int unzReadCurrentFile  (unzFile file, void *buf, unsigned len)
 		else
 		{
 			uLong uTotalOutBefore,uTotalOutAfter;
-			//const Byte *bufBefore;
+			const Byte *bufBefore;
 			uLong uOutThis;
 			int flush=Z_SYNC_FLUSH;
 
 			uTotalOutBefore = pfile_in_zip_read_info->stream.total_out;
-			//bufBefore = pfile_in_zip_read_info->stream.next_out;
+			bufBefore = pfile_in_zip_read_info->stream.next_out;
 
 			/*
 			if ((pfile_in_zip_read_info->rest_read_uncompressed ==
@@ -2105,9 +2276,9 @@ extern int unzReadCurrentFile  (unzFile file, void *buf, unsigned len)
 			uTotalOutAfter = pfile_in_zip_read_info->stream.total_out;
 			uOutThis = uTotalOutAfter-uTotalOutBefore;
 			
-//			pfile_in_zip_read_info->crc32 = 
-//                crc32(pfile_in_zip_read_info->crc32,bufBefore,
-//                        (uInt)(uOutThis));
+			pfile_in_zip_read_info->crc32 = 
+                unzlocal_crc32(pfile_in_zip_read_info->crc32,bufBefore,
+                        (uInt)(uOutThis));
 
 			pfile_in_zip_read_info->rest_read_uncompressed -=
                 uOutThis;
@@ -2239,16 +2410,17 @@ extern int unzCloseCurrentFile (unzFile file)
 	if (pfile_in_zip_read_info==NULL)
 		return UNZ_PARAMERROR;
 
-/*
 	if (pfile_in_zip_read_info->rest_read_uncompressed == 0)
 	{
-		if (pfile_in_zip_read_info->crc32 != pfile_in_zip_read_info->crc32_wait)
+		/* crc in file info may be sign-extended */
+		if ((uint32_t)pfile_in_zip_read_info->crc32 != (uint32_t)pfile_in_zip_read_info->crc32_wait)
 			err=UNZ_CRCERROR;
 	}
-*/
 
 	TRYFREE(pfile_in_zip_read_info->read_buffer);
 	pfile_in_zip_read_info->read_buffer = NULL;
+	TRYFREE(pfile_in_zip_read_info->inflate_buffer);
+	pfile_in_zip_read_info->inflate_buffer = NULL;
 	if (pfile_in_zip_read_info->stream_initialised)
 		inflateEnd(&pfile_in_zip_read_info->stream);
 
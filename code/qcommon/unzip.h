@@ -111,6 +111,7 @@ typedef z_stream *z_streamp;
 typedef struct
 {
 	char  *read_buffer;         /* internal buffer for compressed data */
+	unsigned char *inflate_buffer;  /* whole file inflated for partial reads */
 	z_stream stream;            /* zLib stream structure for inflate */
 
 	unsigned long pos_in_zipfile;       /* position in unsigned char on the zipfile, for fseek*/
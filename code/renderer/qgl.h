@@ -133,6 +133,37 @@ typedef ptrdiff_t GLintptrARB;
 #define GL_PROGRAM_ERROR_STRING_ARB         0x8874
 #endif
 
+#ifndef GL_MAX_PROGRAM_LOCAL_PARAMETERS_ARB
+#define GL_MAX_PROGRAM_LOCAL_PARAMETERS_ARB 0x88B4
+#endif
+
+#ifndef GL_PIXEL_PACK_BUFFER_ARB
+#define GL_PIXEL_PACK_BUFFER_ARB            0x88EB
+#endif
+
+#ifndef GL_STREAM_READ_ARB
+#define GL_STREAM_READ_ARB                  0x88E1
+#define GL_READ_ONLY_ARB                    0x88B8
+#endif
+
+#ifndef GL_ARB_sync
+#define GL_ARB_sync 1
+typedef struct __GLsync *GLsync;
+typedef unsigned long long GLuint64;
+#define GL_SYNC_GPU_COMMANDS_COMPLETE       0x9117
+#define GL_ALREADY_SIGNALED                 0x911A
+#define GL_TIMEOUT_EXPIRED                  0x911B
+#define GL_CONDITION_SATISFIED              0x911C
+#define GL_WAIT_FAILED                      0x911D
+#endif
+
+#ifndef GL_ARB_occlusion_query
+#define GL_ARB_occlusion_query 1
+#define GL_SAMPLES_PASSED_ARB               0x8914
+#define GL_QUERY_RESULT_ARB                 0x8866
+#define GL_QUERY_RESULT_AVAILABLE_ARB       0x8867
+#endif
+
 #ifndef GL_VERSION_2_0
 #define GL_VERSION_2_0 1
 typedef char GLchar;
@@ -221,7 +252,8 @@ typedef char GLchar;
 	GLE( void, glActiveTextureARB, GLenum texture ) \
 	GLE( void, glClientActiveTextureARB, GLenum texture ) \
 	GLE( void, glLockArraysEXT, GLint, GLint) \
-	GLE( void, glUnlockArraysEXT, void )
+	GLE( void, glUnlockArraysEXT, void ) \
+	GLE( void, glCompressedTexImage2DARB, GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data )
 
 #define QGL_ARB_PROGRAM_PROCS \
 	GLE( void, glGenProgramsARB, GLsizei n, GLuint *programs ) \
@@ -229,13 +261,31 @@ typedef char GLchar;
 	GLE( void, glProgramStringARB, GLenum target, GLenum format, GLsizei len, const GLvoid *string ) \
 	GLE( void, glBindProgramARB, GLenum target, GLuint program ) \
 	GLE( void, glProgramLocalParameter4fARB, GLenum target, GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w ) \
-	GLE( void, glProgramLocalParameter4fvARB, GLenum target, GLuint index, const GLfloat *params )
+	GLE( void, glProgramLocalParameter4fvARB, GLenum target, GLuint index, const GLfloat *params ) \
+	GLE( void, glGetProgramivARB, GLenum target, GLenum pname, GLint *params )
 
 #define QGL_VBO_PROCS \
 	GLE( void, glGenBuffersARB, GLsizei n, GLuint *buffers ) \
 	GLE( void, glDeleteBuffersARB, GLsizei n, const GLuint *buffers ) \
 	GLE( void, glBindBufferARB, GLenum target, GLuint buffer ) \
-	GLE( void, glBufferDataARB, GLenum target, GLsizeiptrARB size, const GLvoid *data, GLenum usage )
+	GLE( void, glBufferDataARB, GLenum target, GLsizeiptrARB size, const GLvoid *data, GLenum usage ) \
+	GLE( void, glBufferSubDataARB, GLenum target, GLintptrARB offset, GLsizeiptrARB size, const GLvoid *data )
+
+#define QGL_PBO_PROCS \
+	GLE( GLvoid*, glMapBufferARB, GLenum target, GLenum access ) \
+	GLE( GLboolean, glUnmapBufferARB, GLenum target )
+
+#define QGL_SYNC_PROCS \
+	GLE( GLsync, glFenceSync, GLenum condition, GLbitfield flags ) \
+	GLE( GLenum, glClientWaitSync, GLsync sync, GLbitfield flags, GLuint64 timeout ) \
+	GLE( void, glDeleteSync, GLsync sync )
+
+#define QGL_OCCLUSION_PROCS \
+	GLE( void, glGenQueriesARB, GLsizei n, GLuint *ids ) \
+	GLE( void, glDeleteQueriesARB, GLsizei n, const GLuint *ids ) \
+	GLE( void, glBeginQueryARB, GLenum target, GLuint id ) \
+	GLE( void, glEndQueryARB, GLenum target ) \
+	GLE( void, glGetQueryObjectuivARB, GLuint id, GLenum pname, GLuint *params )
 
 #define QGL_FBO_PROCS \
 	GLE( void, glBindRenderbuffer, GLenum target, GLuint renderbuffer ) \
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_local.h"
 
 backEndData_t	*backEndData;
+backEndData_t	*backEndFrames[SMP_FRAMES];
 backEndState_t	backEnd;
 
 const float *GL_Ortho( const float left, const float right, const float bottom, const float top, const float znear, const float zfar )
@@ -1029,6 +1030,8 @@ void RE_UploadCinematic( int w, int h, int cols, int rows, byte *data, int clien
 
 	image_t *image;
 
+	R_SyncRenderThread();
+
 	if ( !tr.scratchImage[ client ] ) {
 		tr.scratchImage[ client ] = R_CreateImage( va( "*scratch%i", client ), NULL, data, cols, rows, IMGFLAG_CLAMPTOEDGE | IMGFLAG_RGB | IMGFLAG_NOSCALE );
 	}
@@ -1302,6 +1305,12 @@ static const void *RB_DrawBuffer( const void *data ) {
 
 	cmd = (const drawBufferCommand_t *)data;
 
+	glState.finishCalled = qfalse;
+
+	backEnd.doneBloom = qfalse;
+
+	backEnd.color2D.u32 = ~0U;
+
 #ifdef USE_FBO
 	if ( fboEnabled ) {
 		FBO_BindMain();
@@ -1591,6 +1600,12 @@ void RB_ExecuteRenderCommands( const void *data ) {
 
 	backEnd.pc.msec = ri.Milliseconds();
 
+	if ( backEndFrames[1] && data == backEndFrames[1]->commands.cmds ) {
+		backEnd.smpFrame = 1;
+	} else {
+		backEnd.smpFrame = 0;
+	}
+
 	while ( 1 ) {
 		data = PADP(data, sizeof(void *));
 
@@ -96,7 +96,16 @@ static void R_IssueRenderCommands( void ) {
 	// actually start the commands going
 	if ( !r_skipBackEnd->integer ) {
 		// let it start on the new batch
-		RB_ExecuteRenderCommands( cmdList->cmds );
+		if ( R_RenderThreadActive() ) {
+			const int screenshotMask = backEnd.screenshotMask;
+			R_RenderThreadExecute( cmdList->cmds );
+			if ( screenshotMask ) {
+				// captures call back into the engine, keep the main thread out of the way
+				R_FinishRenderThread();
+			}
+		} else {
+			RB_ExecuteRenderCommands( cmdList->cmds );
+		}
 	}
 }
 
@@ -113,6 +122,7 @@ void R_IssuePendingRenderCommands( void ) {
 		return;
 	}
 	R_IssueRenderCommands();
+	R_FinishRenderThread();
 }
 
 
@@ -224,6 +234,7 @@ void RE_StretchPic( float x, float y, float w, float h,
 	}
 	cmd->commandId = RC_STRETCH_PIC;
 	cmd->shader = R_GetShaderByHandle( hShader );
+	tr.videoMaps |= cmd->shader->videoMaps;
 	cmd->x = x;
 	cmd->y = y;
 	cmd->w = w;
@@ -295,17 +306,13 @@ void RE_BeginFrame( stereoFrame_t stereoFrame ) {
 		return;
 	}
 
-	glState.finishCalled = qfalse;
-
 	tr.frameCount++;
 	tr.frameSceneNum = 0;
 
-	backEnd.doneBloom = qfalse;
-
-	backEnd.color2D.u32 = ~0U;
-
-	// check for errors
-	GL_CheckErrors();
+	// check for errors, the context belongs to the render thread with r_smp
+	if ( !R_RenderThreadActive() ) {
+		GL_CheckErrors();
+	}
 
 	if ( ( cmd = R_GetCommandBuffer( sizeof( *cmd ) ) ) == NULL )
 		return;
@@ -408,6 +415,28 @@ void RE_BeginFrame( stereoFrame_t stereoFrame ) {
 }
 
 
+/*
+=============
+R_UpdateVideoMaps
+
+Decodes and uploads cinematics used by this frame on the main thread,
+the backend only binds their images
+=============
+*/
+static void R_UpdateVideoMaps( void ) {
+	int i;
+
+	for ( i = 0; i < MAX_VIDEO_HANDLES; i++ ) {
+		if ( tr.videoMaps & ( 1 << i ) ) {
+			ri.CIN_RunCinematic( i );
+			ri.CIN_UploadCinematic( i );
+		}
+	}
+
+	tr.videoMaps = 0;
+}
+
+
 /*
 =============
 RE_EndFrame
@@ -429,8 +458,17 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 	}
 	cmd->commandId = RC_SWAP_BUFFERS;
 
+	if ( tr.videoMaps ) {
+		R_UpdateVideoMaps();
+	}
+
 	R_IssueRenderCommands();
 
+	if ( r_speeds->integer || backEndMsec ) {
+		// backend counters are only valid once the frame is done
+		R_FinishRenderThread();
+	}
+
 	R_PerformanceCounters();
 
 	R_InitNextFrame();
@@ -448,6 +486,8 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 	// recompile GPU shaders if needed
 	if ( ri.Cvar_CheckGroup( CVG_RENDERER ) )
 	{
+		R_SyncRenderThread();
+
 		ARB_UpdatePrograms();
 
 #ifdef USE_FBO
@@ -471,8 +511,7 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 RE_TakeVideoFrame
 =============
 */
-void RE_TakeVideoFrame( int width, int height,
-		byte *captureBuffer, byte *encodeBuffer, qboolean motionJpeg )
+void RE_TakeVideoFrame( int width, int height, byte *captureBuffer )
 {
 	videoFrameCommand_t	*cmd;
 
@@ -480,6 +519,9 @@ void RE_TakeVideoFrame( int width, int height,
 		return;
 	}
 
+	// the previous frame may still be using vcmd
+	R_FinishRenderThread();
+
 	backEnd.screenshotMask |= SCREENSHOT_AVI;
 
 	cmd = &backEnd.vcmd;
@@ -489,8 +531,6 @@ void RE_TakeVideoFrame( int width, int height,
 	cmd->width = width;
 	cmd->height = height;
 	cmd->captureBuffer = captureBuffer;
-	cmd->encodeBuffer = encodeBuffer;
-	cmd->motionJpeg = motionJpeg;
 }
 
 
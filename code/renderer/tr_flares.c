@@ -40,6 +40,11 @@ After all opaque surfaces have been rendered, the depth buffer is read back for
 each flare in view.  If the point has not been obscured by a closer surface, the
 flare should be drawn.
 
+When occlusion queries are available (r_flareQueries) the depth test is done by
+drawing a single point at the flare depth instead, and the sample count is read
+back a frame or more later, so the pipeline never has to drain.  The visibility
+used for fading lags by that much, which the fade hides.
+
 Surfaces that have a repeated texture should never be flagged as flaring, because
 there will only be a single flare added at the midpoint of the polygon.
 
@@ -76,6 +81,9 @@ typedef struct flare_s {
 	float		eyeZ;
 	float		drawZ;
 
+	int			firstQuery;			// oldest pending occlusion query
+	int			numQueries;
+
 	vec3_t		origin;
 	vec3_t		color;
 } flare_t;
@@ -85,6 +93,13 @@ typedef struct flare_s {
 flare_t		r_flareStructs[MAX_FLARES];
 flare_t		*r_activeFlares, *r_inactiveFlares;
 
+// each flare owns a small ring of queries so a new one can be issued
+// every frame while the previous results are still in flight
+#define		FLARE_QUERIES	4
+
+static GLuint	flareQueries[MAX_FLARES][FLARE_QUERIES];
+static qboolean	flareQueriesCreated;
+
 /*
 ==================
 R_ClearFlares
@@ -173,6 +188,8 @@ void RB_AddFlare( void *surface, int fogNum, vec3_t point, vec3_t color, vec3_t
 		f->frameSceneNum = backEnd.viewParms.frameSceneNum;
 		f->portalView = backEnd.viewParms.portalView;
 		f->addedFrame = -1;
+		f->firstQuery = 0;
+		f->numQueries = 0;
 	}
 
 	if ( f->addedFrame != backEnd.viewParms.frameCount - 1 ) {
@@ -257,25 +274,167 @@ FLARE BACK END
 ===============================================================================
 */
 
+/*
+==================
+RB_DeleteFlareQueries
+==================
+*/
+void RB_DeleteFlareQueries( void ) {
+	int		i;
+
+	if ( flareQueriesCreated ) {
+		if ( qglDeleteQueriesARB ) {
+			qglDeleteQueriesARB( MAX_FLARES * FLARE_QUERIES, &flareQueries[0][0] );
+		}
+		Com_Memset( flareQueries, 0, sizeof( flareQueries ) );
+		flareQueriesCreated = qfalse;
+	}
+
+	// pending queries are gone with the context
+	for ( i = 0 ; i < MAX_FLARES ; i++ ) {
+		r_flareStructs[i].firstQuery = 0;
+		r_flareStructs[i].numQueries = 0;
+	}
+}
+
+
+/*
+==================
+RB_BeginFlareQueries
+
+Sets up state to draw flare depth points in window coordinates
+without touching the color buffer
+==================
+*/
+static qboolean RB_BeginFlareQueries( GLboolean *colorMask ) {
+
+	if ( !r_flareQueries->integer || !qglGenQueriesARB ) {
+		return qfalse;
+	}
+
+	if ( !flareQueriesCreated ) {
+		qglGenQueriesARB( MAX_FLARES * FLARE_QUERIES, &flareQueries[0][0] );
+		flareQueriesCreated = qtrue;
+	}
+
+	GL_ProgramDisable();
+#ifdef USE_VBO
+	VBO_UnBind();
+#endif
+	GL_SelectTexture( 0 );
+	qglDisable( GL_TEXTURE_2D );
+	GL_ClientState( 0, CLS_NONE );
+
+	// depth test only, against the untouched scene depth
+	GL_State( 0 );
+	qglGetBooleanv( GL_COLOR_WRITEMASK, colorMask );
+	qglColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+
+	if ( backEnd.viewParms.portalView != PV_NONE ) {
+		qglDisable( GL_CLIP_PLANE0 );
+	}
+
+	// eye z of -drawZ ends up at window depth drawZ
+	qglPushMatrix();
+	qglLoadIdentity();
+	qglMatrixMode( GL_PROJECTION );
+	qglPushMatrix();
+	qglLoadMatrixf( GL_Ortho( backEnd.viewParms.viewportX, backEnd.viewParms.viewportX + backEnd.viewParms.viewportWidth,
+		backEnd.viewParms.viewportY, backEnd.viewParms.viewportY + backEnd.viewParms.viewportHeight, 0, 1 ) );
+
+	return qtrue;
+}
+
+
+/*
+==================
+RB_EndFlareQueries
+==================
+*/
+static void RB_EndFlareQueries( const GLboolean *colorMask ) {
+
+	qglPopMatrix();
+	qglMatrixMode( GL_MODELVIEW );
+	qglPopMatrix();
+
+	qglColorMask( colorMask[0], colorMask[1], colorMask[2], colorMask[3] );
+	qglEnable( GL_TEXTURE_2D );
+}
+
+
+/*
+==================
+RB_TestFlareQuery
+
+Collects any finished query results and issues a new one,
+returns the most recent known visibility
+==================
+*/
+static qboolean RB_TestFlareQuery( flare_t *f ) {
+	GLuint		*queries;
+	GLuint		available, samples;
+	qboolean	visible;
+	vec3_t		point;
+
+	queries = flareQueries[ f - r_flareStructs ];
+	visible = f->visible;
+
+	// results come back in order, so stop at the first one still in flight
+	while ( f->numQueries > 0 ) {
+		available = 0;
+		qglGetQueryObjectuivARB( queries[ f->firstQuery ], GL_QUERY_RESULT_AVAILABLE_ARB, &available );
+		if ( !available ) {
+			break;
+		}
+		samples = 0;
+		qglGetQueryObjectuivARB( queries[ f->firstQuery ], GL_QUERY_RESULT_ARB, &samples );
+		visible = ( samples != 0 );
+		f->firstQuery = ( f->firstQuery + 1 ) % FLARE_QUERIES;
+		f->numQueries--;
+	}
+
+	// the ring is full if the driver is several frames behind,
+	// keep the last result until a slot frees up
+	if ( f->numQueries < FLARE_QUERIES ) {
+		point[0] = f->windowX + 0.5f;
+		point[1] = f->windowY + 0.5f;
+		point[2] = -f->drawZ;
+
+		qglVertexPointer( 3, GL_FLOAT, 0, point );
+		qglBeginQueryARB( GL_SAMPLES_PASSED_ARB, queries[ ( f->firstQuery + f->numQueries ) % FLARE_QUERIES ] );
+		qglDrawArrays( GL_POINTS, 0, 1 );
+		qglEndQueryARB( GL_SAMPLES_PASSED_ARB );
+		f->numQueries++;
+	}
+
+	return visible;
+}
+
+
 /*
 ==================
 RB_TestFlare
 ==================
 */
-static void RB_TestFlare( flare_t *f ) {
+static void RB_TestFlare( flare_t *f, qboolean useQueries ) {
 	float			depth;
 	qboolean		visible;
 	float			fade;
 
 	backEnd.pc.c_flareTests++;
 
-	// doing a readpixels is as good as doing a glFinish(), so
-	// don't bother with another sync
-	glState.finishCalled = qfalse;
+	if ( useQueries ) {
+		visible = RB_TestFlareQuery( f );
+	} else {
+		// doing a readpixels is as good as doing a glFinish(), so
+		// don't bother with another sync
+		glState.finishCalled = qfalse;
+
+		// read back the z buffer contents
+		qglReadPixels( f->windowX, f->windowY, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth );
+		visible = (depth > f->drawZ);
+	}
 
-	// read back the z buffer contents
-	qglReadPixels( f->windowX, f->windowY, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth );
-	visible = (depth > f->drawZ);
 	if ( visible ) {
 		if ( !f->visible ) {
 			f->visible = qtrue;
@@ -398,6 +557,8 @@ void RB_RenderFlares (void) {
 	flare_t		*f;
 	flare_t		**prev;
 	qboolean	draw;
+	qboolean	useQueries;
+	GLboolean	colorMask[4];
 
 	if ( !r_flares->integer ) {
 		return;
@@ -412,16 +573,18 @@ void RB_RenderFlares (void) {
 	backEnd.currentEntity = &tr.worldEntity;
 	backEnd.or = backEnd.viewParms.world;
 
+	useQueries = RB_BeginFlareQueries( colorMask );
+
 #ifdef USE_FBO
 	// we can't read from multisampled renderbuffer storage
-	if ( blitMSfbo ) {
+	if ( blitMSfbo && !useQueries ) {
 		FBO_BlitMS( qtrue );
 	}
 #endif
 
 	// RB_AddDlightFlares();
 
-	// perform z buffer readback on each flare in this view
+	// perform z buffer test on each flare in this view
 	draw = qfalse;
 	prev = &r_activeFlares;
 	while ( ( f = *prev ) != NULL ) {
@@ -436,7 +599,7 @@ void RB_RenderFlares (void) {
 		// don't draw any here that aren't from this scene / portal
 		f->drawIntensity = 0;
 		if ( f->frameSceneNum == backEnd.viewParms.frameSceneNum && f->portalView == backEnd.viewParms.portalView ) {
-			RB_TestFlare( f );
+			RB_TestFlare( f, useQueries );
 			if ( f->drawIntensity ) {
 				draw = qtrue;
 			} else {
@@ -451,9 +614,13 @@ void RB_RenderFlares (void) {
 		prev = &f->next;
 	}
 
+	if ( useQueries ) {
+		RB_EndFlareQueries( colorMask );
+	}
+
 #ifdef USE_FBO
 	// bind primary framebuffer again
-	if ( blitMSfbo ) {
+	if ( blitMSfbo && !useQueries ) {
 		FBO_BindMain();
 	}
 #endif
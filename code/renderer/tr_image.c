@@ -33,6 +33,13 @@ GLint	gl_filter_max = GL_LINEAR;
 #define FILE_HASH_SIZE		1024
 static	image_t*		hashTable[FILE_HASH_SIZE];
 
+// compressed texture cache state for the image being created
+static struct {
+	const cachedImage_t	*cached;	// upload these levels instead of pixels
+	uint64_t			key;		// store the upload under this key
+	qboolean			compress;	// LoadTexture compresses every level
+} imageCache;
+
 /*
 ================
 return a hash value for the filename
@@ -59,6 +66,24 @@ void R_GammaCorrect( byte *buffer, int bufSize ) {
 	}
 }
 
+
+/*
+** R_GammaTable
+**
+** Returns the table R_GammaCorrect would apply, or NULL
+*/
+const byte *R_GammaTable( void ) {
+#ifdef USE_FBO
+	if ( fboEnabled ) {
+		return NULL;
+	}
+#endif
+	if ( !gls.deviceSupportsGamma ) {
+		return NULL;
+	}
+	return s_gammatable;
+}
+
 typedef struct {
 	const char *name;
 	GLint minimize, maximize;
@@ -169,6 +194,10 @@ void R_ImageList_f( void ) {
 				// 64 bits per 16 pixels, so 4 bits per pixel
 				estSize /= 2;
 				break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				format = "DXT5 ";
+				// 128 bits per 16 pixels, so 8 bits per pixel
+				break;
 			case GL_RGB4_S3TC:
 				format = "S3TC ";
 				// same as DXT1?
@@ -249,43 +278,10 @@ before or after.
 */
 static void ResampleTexture( unsigned *in, int inwidth, int inheight, unsigned *out,  
 							int outwidth, int outheight ) {
-	int		i, j;
-	unsigned	*inrow, *inrow2;
-	unsigned	frac, fracstep;
-	unsigned	p1[MAX_TEXTURE_SIZE];
-	unsigned	p2[MAX_TEXTURE_SIZE];
-	byte		*pix1, *pix2, *pix3, *pix4;
-
-	if ( outwidth > ARRAY_LEN( p1 ) )
+	if ( outwidth > MAX_TEXTURE_SIZE )
 		ri.Error( ERR_DROP, "ResampleTexture: max width" );
-								
-	fracstep = inwidth * 0x10000 / outwidth;
-
-	frac = fracstep>>2;
-	for ( i=0 ; i<outwidth ; i++ ) {
-		p1[i] = 4*(frac>>16);
-		frac += fracstep;
-	}
-	frac = 3*(fracstep>>2);
-	for ( i=0 ; i<outwidth ; i++ ) {
-		p2[i] = 4*(frac>>16);
-		frac += fracstep;
-	}
-
-	for (i=0 ; i<outheight ; i++, out += outwidth) {
-		inrow = in + inwidth*(int)((i+0.25)*inheight/outheight);
-		inrow2 = in + inwidth*(int)((i+0.75)*inheight/outheight);
-		for (j=0 ; j<outwidth ; j++) {
-			pix1 = (byte *)inrow + p1[j];
-			pix2 = (byte *)inrow + p2[j];
-			pix3 = (byte *)inrow2 + p1[j];
-			pix4 = (byte *)inrow2 + p2[j];
-			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
-			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
-			((byte *)(out+j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
-			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
-		}
-	}
+
+	R_ResampleImage( (byte *)in, inwidth, inheight, (byte *)out, outwidth, outheight );
 }
 
 
@@ -299,6 +295,9 @@ lighting range
 */
 static void R_LightScaleTexture( byte *in, int inwidth, int inheight, qboolean only_gamma )
 {
+	byte	table[256];
+	int		i;
+
 	if ( in == NULL )
 		return;
 
@@ -310,115 +309,27 @@ static void R_LightScaleTexture( byte *in, int inwidth, int inheight, qboolean o
 		if ( !glConfig.deviceSupportsGamma )
 #endif
 		{
-			int		i, c;
-			byte	*p;
-
-			p = (byte *)in;
-
-			c = inwidth*inheight;
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[p[0]];
-				p[1] = s_gammatable[p[1]];
-				p[2] = s_gammatable[p[2]];
-			}
+			R_RemapImageRGB( in, inwidth*inheight, s_gammatable );
 		}
 	}
 	else
 	{
-		int		i, c;
-		byte	*p;
-
-		p = (byte *)in;
-
-		c = inwidth*inheight;
-
 #ifdef USE_FBO
 		if ( glConfig.deviceSupportsGamma || fboEnabled )
 #else
 		if ( glConfig.deviceSupportsGamma )
 #endif
 		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_intensitytable[p[0]];
-				p[1] = s_intensitytable[p[1]];
-				p[2] = s_intensitytable[p[2]];
-			}
+			R_RemapImageRGB( in, inwidth*inheight, s_intensitytable );
 		}
 		else
 		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[s_intensitytable[p[0]]];
-				p[1] = s_gammatable[s_intensitytable[p[1]]];
-				p[2] = s_gammatable[s_intensitytable[p[2]]];
-			}
-		}
-	}
-}
-
-
-/*
-================
-R_MipMap2
-
-Operates in place, quartering the size of the texture
-Proper linear filter
-================
-*/
-static void R_MipMap2( unsigned * const out, unsigned * const in, int inWidth, int inHeight ) {
-	int			i, j, k;
-	byte		*outpix;
-	int			inWidthMask, inHeightMask;
-	int			total;
-	int			outWidth, outHeight;
-	unsigned	*temp;
-
-	outWidth = inWidth >> 1;
-	outHeight = inHeight >> 1;
-
-	if ( out == in )
-		temp = ri.Hunk_AllocateTempMemory( outWidth * outHeight * 4 );
-	else
-		temp = out;
-
-	inWidthMask = inWidth - 1;
-	inHeightMask = inHeight - 1;
-
-	for ( i = 0 ; i < outHeight ; i++ ) {
-		for ( j = 0 ; j < outWidth ; j++ ) {
-			outpix = (byte *) ( temp + i * outWidth + j );
-			for ( k = 0 ; k < 4 ; k++ ) {
-				total = 
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k];
-				outpix[k] = total / 36;
-			}
+			// apply both tables in one pass
+			for ( i = 0; i < 256; i++ )
+				table[i] = s_gammatable[s_intensitytable[i]];
+			R_RemapImageRGB( in, inwidth*inheight, table );
 		}
 	}
-
-	if ( out == in ) {
-		Com_Memcpy( out, temp, outWidth * outHeight * 4 );
-		ri.Hunk_FreeTempMemory( temp );
-	}
 }
 
 
@@ -430,44 +341,16 @@ Operates in place, quartering the size of the texture
 ================
 */
 static void R_MipMap( byte *out, byte *in, int width, int height ) {
-	int		i, j;
-	int		row;
 
 	if ( in == NULL )
 		return;
 
 	if ( !r_simpleMipMaps->integer ) {
-		R_MipMap2( (unsigned *)out, (unsigned *)in, width, height );
-		return;
-	}
-
-	if ( width == 1 && height == 1 ) {
-		return;
-	}
-
-	row = width * 4;
-	width >>= 1;
-	height >>= 1;
-
-	if ( width == 0 || height == 0 ) {
-		width += height;	// get largest
-		for (i=0 ; i<width ; i++, out+=4, in+=8 ) {
-			out[0] = ( in[0] + in[4] )>>1;
-			out[1] = ( in[1] + in[5] )>>1;
-			out[2] = ( in[2] + in[6] )>>1;
-			out[3] = ( in[3] + in[7] )>>1;
-		}
+		R_MipMapFilter( out, in, width, height );
 		return;
 	}
 
-	for (i=0 ; i<height ; i++, in+=row) {
-		for (j=0 ; j<width ; j++, out+=4, in+=8) {
-			out[0] = (in[0] + in[4] + in[row+0] + in[row+4])>>2;
-			out[1] = (in[1] + in[5] + in[row+1] + in[row+5])>>2;
-			out[2] = (in[2] + in[6] + in[row+2] + in[row+6])>>2;
-			out[3] = (in[3] + in[7] + in[row+3] + in[row+7])>>2;
-		}
-	}
+	R_MipMapBox( out, in, width, height );
 }
 
 
@@ -489,29 +372,13 @@ static void R_BlendOverTexture( byte *data, int pixelCount, int mipLevel ) {
 		{255,0,255,128}
 	};
 
-	const byte *blend;
-	int		i;
-	int		inverseAlpha;
-	int		premult[3];
-
 	if ( data == NULL )
 		return;
 
 	if ( mipLevel <= 0 )
 		return;
 
-	blend = blendColors[ ( mipLevel - 1 ) % ARRAY_LEN( blendColors ) ];
-
-	inverseAlpha = 255 - blend[3];
-	premult[0] = blend[0] * blend[3];
-	premult[1] = blend[1] * blend[3];
-	premult[2] = blend[2] * blend[3];
-
-	for ( i = 0 ; i < pixelCount ; i++, data+=4 ) {
-		data[0] = ( data[0] * inverseAlpha + premult[0] ) >> 9;
-		data[1] = ( data[1] * inverseAlpha + premult[1] ) >> 9;
-		data[2] = ( data[2] * inverseAlpha + premult[2] ) >> 9;
-	}
+	R_BlendImageRGB( data, pixelCount, blendColors[ ( mipLevel - 1 ) % ARRAY_LEN( blendColors ) ] );
 }
 
 
@@ -588,11 +455,48 @@ static void LoadTexture( int miplevel, int x, int y, int width, int height, cons
 {
 	if ( subImage )
 		qglTexSubImage2D( GL_TEXTURE_2D, miplevel, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data );
+	else if ( imageCache.compress )
+	{
+		int size;
+		const byte *blocks = R_AddImageCacheLevel( data, width, height, &size );
+		qglCompressedTexImage2DARB( GL_TEXTURE_2D, miplevel, image->internalFormat, width, height, 0, size, blocks );
+	}
 	else
 		qglTexImage2D( GL_TEXTURE_2D, miplevel, image->internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data );
 }
 
 
+/*
+===============
+UploadCompressed
+
+Uploads all mip levels of a texture cache entry
+===============
+*/
+static void UploadCompressed( const cachedImage_t *cached, image_t *image )
+{
+	const byte *data = cached->data;
+	int width = cached->uploadWidth;
+	int height = cached->uploadHeight;
+	int miplevel, size;
+
+	image->internalFormat = ( cached->format == IMAGECACHE_BC3 ) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	image->uploadWidth = width;
+	image->uploadHeight = height;
+
+	for ( miplevel = 0; miplevel < cached->numLevels; miplevel++ )
+	{
+		size = R_CompressedLevelSize( width, height, cached->format );
+		qglCompressedTexImage2DARB( GL_TEXTURE_2D, miplevel, image->internalFormat, width, height, 0, size, data );
+		data += size;
+		width = MAX( 1, width >> 1 );
+		height = MAX( 1, height >> 1 );
+	}
+
+	GL_CheckErrors();
+}
+
+
 /*
 ===============
 Upload32
@@ -685,8 +589,15 @@ static void Upload32( byte *data, int x, int y, int width, int height, image_t *
 	}
 
 	if ( !subImage ) {
+		if ( imageCache.key && data && R_ImageCacheSalt( image->flags ) ) {
+			// compress on upload and keep the result in the texture cache
+			int format = RawImage_HasAlpha( data, width*height ) ? IMAGECACHE_BC3 : IMAGECACHE_BC1;
+			image->internalFormat = ( format == IMAGECACHE_BC3 ) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			R_BeginImageCache( imageCache.key, image->width, image->height, scaled_width, scaled_height, format );
+			imageCache.compress = qtrue;
+		}
 		// verify if the alpha channel is being used or not
-		if ( image->internalFormat == 0 ) {
+		else if ( image->internalFormat == 0 ) {
 			image->internalFormat = RawImage_GetInternalFormat( data, width*height, lightMap, allowCompression );
 		}
 		image->uploadWidth = scaled_width;
@@ -737,6 +648,11 @@ static void Upload32( byte *data, int x, int y, int width, int height, image_t *
 		}
 	}
 done:
+	if ( imageCache.compress ) {
+		R_EndImageCache();
+		imageCache.compress = qfalse;
+	}
+
 	if ( resampledBuffer != NULL )
 		ri.Hunk_FreeTempMemory( resampledBuffer );
 
@@ -781,6 +697,9 @@ image_t *R_CreateImage( const char *name, const char *name2, byte *pic, int widt
 		ri.Error( ERR_DROP, "R_CreateImage: \"%s\" is too long", name );
 	}
 
+	// uploads need the context and must not overlap the render thread
+	R_SyncRenderThread();
+
 	if ( name2 && Q_stricmp( name, name2 ) != 0 ) {
 		// leave only file name
 		name2 = ( slash = strrchr( name2, '/' ) ) != NULL ? slash + 1 : name2;
@@ -849,7 +768,10 @@ image_t *R_CreateImage( const char *name, const char *name2, byte *pic, int widt
 	}
 
 	GL_Bind( image );
-	Upload32( pic, 0, 0, image->width, image->height, image, qfalse ); // subImage = qfalse
+	if ( imageCache.cached )
+		UploadCompressed( imageCache.cached, image );
+	else
+		Upload32( pic, 0, 0, image->width, image->height, image, qfalse ); // subImage = qfalse
 
 	if ( image->flags & IMGFLAG_MIPMAP )
 	{
@@ -922,6 +844,11 @@ static const char *R_LoadImage( const char *name, byte **pic, int *width, int *h
 	*width = 0;
 	*height = 0;
 
+	if ( R_TakePrefetchedImage( name, pic, width, height, localName, sizeof( localName ) ) )
+	{
+		return localName;
+	}
+
 	Q_strncpyz( localName, name, sizeof( localName ) );
 
 	ext = COM_GetExtension( localName );
@@ -987,6 +914,88 @@ static const char *R_LoadImage( const char *name, byte **pic, int *width, int *h
 }
 
 
+/*
+===============
+R_ImageCacheSalt
+
+Hashes everything besides the source file that changes the uploaded
+texels, returns 0 if images with these flags don't use the texture cache
+===============
+*/
+uint64_t R_ImageCacheSalt( imgFlags_t flags )
+{
+	int settings[8];
+	uint64_t salt;
+
+	if ( !r_textureCache->integer || !qglCompressedTexImage2DARB )
+		return 0;
+
+	// only mipmapped surface textures, not lightmaps or 2D graphics
+	if ( ( flags & ( IMGFLAG_MIPMAP | IMGFLAG_LIGHTMAP | IMGFLAG_NO_COMPRESSION | IMGFLAG_NOSCALE | IMGFLAG_COLORSHIFT | IMGFLAG_RGB ) ) != IMGFLAG_MIPMAP )
+		return 0;
+
+	settings[0] = flags;
+	if ( r_drawFlat->integer && ( flags & IMGFLAG_PICMIP ) && tr.mapLoading )
+		settings[1] = 16;
+	else if ( ( flags & IMGFLAG_PICMIP ) && ( tr.mapLoading || r_nomip->integer == 0 ) )
+		settings[1] = r_picmip->integer;
+	else
+		settings[1] = 0;
+	settings[2] = r_roundImagesDown->integer;
+	settings[3] = glConfig.maxTextureSize;
+	settings[4] = r_simpleMipMaps->integer;
+	settings[5] = r_colorMipLevels->integer;
+	settings[6] = tr.mapLoading ? (int)( r_mapGreyScale->value * 1000.0f ) : 0;
+#ifdef USE_FBO
+	settings[7] = glConfig.deviceSupportsGamma || fboEnabled;
+#else
+	settings[7] = glConfig.deviceSupportsGamma;
+#endif
+
+	salt = R_ImageCacheHash( IMAGECACHE_HASH_INIT, settings, sizeof( settings ) );
+	salt = R_ImageCacheHash( salt, s_intensitytable, sizeof( s_intensitytable ) );
+	salt = R_ImageCacheHash( salt, s_gammatable, sizeof( s_gammatable ) );
+
+	return salt;
+}
+
+
+/*
+===============
+R_FindCachedImage
+
+Creates the image from the texture cache, on a miss the key is kept
+so that Upload32 stores the compressed texture
+===============
+*/
+static image_t *R_FindCachedImage( const char *name, imgFlags_t flags, uint64_t salt )
+{
+	char	localName[ MAX_QPATH ];
+	cachedImage_t cached;
+	uint64_t hash, key;
+	image_t	*image;
+
+	if ( !R_HashImageSource( name, &hash, localName, sizeof( localName ) ) ) {
+		return NULL;
+	}
+
+	key = R_ImageCacheKey( hash, salt );
+
+	if ( !R_LoadCachedImage( key, &cached ) ) {
+		imageCache.key = key;
+		return NULL;
+	}
+
+	imageCache.cached = &cached;
+	image = R_CreateImage( name, localName, NULL, cached.width, cached.height, flags );
+	imageCache.cached = NULL;
+
+	R_FreeCachedImage( &cached );
+
+	return image;
+}
+
+
 /*
 ===============
 R_FindImageFile
@@ -1003,6 +1012,7 @@ image_t	*R_FindImageFile( const char *name, imgFlags_t flags )
 	int		width, height;
 	byte	*pic;
 	int		hash;
+	uint64_t salt;
 
 	if ( !name ) {
 		return NULL;
@@ -1040,11 +1050,23 @@ image_t	*R_FindImageFile( const char *name, imgFlags_t flags )
 		}
 	}
 
+	//
+	// try the compressed texture cache before decoding anything
+	//
+	salt = R_ImageCacheSalt( flags );
+	if ( salt ) {
+		image = R_FindCachedImage( name, flags, salt );
+		if ( image ) {
+			return image;
+		}
+	}
+
 	//
 	// load the pic from disk
 	//
 	localName = R_LoadImage( name, &pic, &width, &height );
 	if ( pic == NULL ) {
+		imageCache.key = 0;
 		return NULL;
 	}
 
@@ -1067,11 +1089,44 @@ image_t	*R_FindImageFile( const char *name, imgFlags_t flags )
 	}
 
 	image = R_CreateImage( name, localName, pic, width, height, flags );
+	imageCache.key = 0;
 	ri.Free( pic );
 	return image;
 }
 
 
+/*
+===============
+R_PrefetchImageFile
+
+Queues an image that is about to be requested from R_FindImageFile
+for decoding on worker threads, see R_StartImagePrefetch
+===============
+*/
+void R_PrefetchImageFile( const char *name, imgFlags_t flags )
+{
+	char	strippedName[ MAX_QPATH ];
+	image_t	*image;
+	int		hash;
+
+	if ( !r_imagePrefetch->integer || name[0] == '*' ) {
+		return;
+	}
+
+	COM_StripExtension( name, strippedName, sizeof( strippedName ) );
+
+	// already loaded
+	hash = generateHashValue( name );
+	for ( image = hashTable[ hash ]; image; image = image->next ) {
+		if ( !Q_stricmp( name, image->imgName ) || !Q_stricmp( strippedName, image->imgName ) ) {
+			return;
+		}
+	}
+
+	R_AddImagePrefetch( name, R_ImageCacheSalt( flags ) );
+}
+
+
 /*
 ================
 R_CreateDlightImage
@@ -1475,6 +1530,7 @@ void R_InitImages( void ) {
 		s_gammatable_linear[i] = (unsigned char)i;
 
 	Com_Memset( hashTable, 0, sizeof( hashTable ) );
+	Com_Memset( &imageCache, 0, sizeof( imageCache ) );
 
 	// build brightness translation tables
 	R_SetColorMappings();
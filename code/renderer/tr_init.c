@@ -41,6 +41,7 @@ static void GL_SetDefaultState( void );
 cvar_t	*r_flareSize;
 cvar_t	*r_flareFade;
 cvar_t	*r_flareCoeff;
+cvar_t	*r_flareQueries;
 
 cvar_t	*r_railWidth;
 cvar_t	*r_railCoreWidth;
@@ -81,6 +82,7 @@ cvar_t	*r_dlightSaturation;
 
 #ifdef USE_VBO
 cvar_t	*r_vbo;
+cvar_t	*r_vboModels;
 #endif
 
 #ifdef USE_FBO
@@ -171,6 +173,13 @@ cvar_t	*r_mapGreyScale;
 
 cvar_t	*r_debugSurface;
 cvar_t	*r_simpleMipMaps;
+cvar_t	*r_imagePrefetch;
+cvar_t	*r_imageSIMD;
+cvar_t	*r_tessSIMD;
+cvar_t	*r_textureCache;
+cvar_t	*r_shaderCache;
+cvar_t	*r_frontEndThreads;
+cvar_t	*r_smp;
 
 cvar_t	*r_showImages;
 cvar_t	*r_defaultImage;
@@ -185,6 +194,7 @@ cvar_t	*r_saveFontData;
 cvar_t	*r_marksOnTriangleMeshes;
 
 cvar_t	*r_aviMotionJpegQuality;
+cvar_t	*r_aviAsyncReadback;
 cvar_t	*r_screenshotJpegQuality;
 
 static cvar_t *r_maxpolys;
@@ -199,6 +209,9 @@ static char gl_extensions[ 32768 ];
 	QGL_Ext_PROCS;
 	QGL_ARB_PROGRAM_PROCS;
 	QGL_VBO_PROCS;
+	QGL_PBO_PROCS;
+	QGL_SYNC_PROCS;
+	QGL_OCCLUSION_PROCS;
 	QGL_FBO_PROCS;
 	QGL_FBO_OPT_PROCS;
 #undef GLE
@@ -213,6 +226,9 @@ static sym_t core_procs[] = { QGL_Core_PROCS };
 static sym_t ext_procs[] = { QGL_Ext_PROCS };
 static sym_t arb_procs[] = { QGL_ARB_PROGRAM_PROCS };
 static sym_t vbo_procs[] = { QGL_VBO_PROCS };
+static sym_t pbo_procs[] = { QGL_PBO_PROCS };
+static sym_t sync_procs[] = { QGL_SYNC_PROCS };
+static sym_t occlusion_procs[] = { QGL_OCCLUSION_PROCS };
 static sym_t fbo_procs[] = { QGL_FBO_PROCS };
 static sym_t fbo_opt_procs[] = { QGL_FBO_OPT_PROCS };
 #undef GLE
@@ -256,6 +272,9 @@ static void R_ClearSymTables( void )
 	R_ClearSymbols( ext_procs, ARRAY_LEN( ext_procs ) );
 	R_ClearSymbols( arb_procs, ARRAY_LEN( arb_procs ) );
 	R_ClearSymbols( vbo_procs, ARRAY_LEN( vbo_procs ) );
+	R_ClearSymbols( pbo_procs, ARRAY_LEN( pbo_procs ) );
+	R_ClearSymbols( sync_procs, ARRAY_LEN( sync_procs ) );
+	R_ClearSymbols( occlusion_procs, ARRAY_LEN( occlusion_procs ) );
 	R_ClearSymbols( fbo_procs, ARRAY_LEN( fbo_procs ) );
 	R_ClearSymbols( fbo_opt_procs, ARRAY_LEN( fbo_opt_procs ) );
 }
@@ -340,6 +359,8 @@ static void R_InitExtensions( void )
 	qglLockArraysEXT = NULL;
 	qglUnlockArraysEXT = NULL;
 
+	qglCompressedTexImage2DARB = NULL;
+
 	glConfig.numTextureUnits = 1;
 	qglMultiTexCoord2fARB = NULL;
 	qglActiveTextureARB = NULL;
@@ -377,6 +398,13 @@ static void R_InitExtensions( void )
 	if ( R_HaveExtension( "GL_ARB_texture_compression" ) &&
 		 R_HaveExtension( "GL_EXT_texture_compression_s3tc" ) )
 	{
+		// pre-compressed uploads from the texture cache
+		if ( r_textureCache->integer ) {
+			qglCompressedTexImage2DARB = ri.GL_GetProcAddress( "glCompressedTexImage2DARB" );
+			if ( qglCompressedTexImage2DARB ) {
+				ri.Printf( PRINT_ALL, "...using GL_EXT_texture_compression_s3tc for the texture cache\n" );
+			}
+		}
 		if ( r_ext_compressed_textures->integer ){
 			glConfig.textureCompression = TC_S3TC_ARB;
 			ri.Printf( PRINT_ALL, "...using GL_EXT_texture_compression_s3tc\n" );
@@ -540,8 +568,57 @@ static void R_InitExtensions( void )
 			ri.Printf( PRINT_ALL, "...using ARB vertex buffer objects\n" );
 		}
 	}
+
+	// GL_ARB_pixel_buffer_object
+	if ( qglBindBufferARB && R_HaveExtension( "GL_ARB_pixel_buffer_object" ) )
+	{
+		err = R_ResolveSymbols( pbo_procs, ARRAY_LEN( pbo_procs ) );
+		if ( err )
+		{
+			ri.Printf( PRINT_WARNING, "Error resolving PBO function '%s'\n", err );
+			qglMapBufferARB = NULL; // indicates presence of PBO functionality
+		}
+		else
+		{
+			ri.Printf( PRINT_ALL, "...using GL_ARB_pixel_buffer_object\n" );
+		}
+	}
 #endif // USE_VBO
 
+	// GL_ARB_sync
+	if ( R_HaveExtension( "GL_ARB_sync" ) )
+	{
+		err = R_ResolveSymbols( sync_procs, ARRAY_LEN( sync_procs ) );
+		if ( err )
+		{
+			ri.Printf( PRINT_WARNING, "Error resolving sync function '%s'\n", err );
+			qglFenceSync = NULL; // indicates presence of fences
+		}
+		else
+		{
+			ri.Printf( PRINT_ALL, "...using GL_ARB_sync\n" );
+		}
+	}
+
+	// GL_ARB_occlusion_query
+	if ( R_HaveExtension( "GL_ARB_occlusion_query" ) )
+	{
+		err = R_ResolveSymbols( occlusion_procs, ARRAY_LEN( occlusion_procs ) );
+		if ( err )
+		{
+			ri.Printf( PRINT_WARNING, "Error resolving occlusion query function '%s'\n", err );
+			qglGenQueriesARB = NULL; // indicates presence of occlusion queries
+		}
+		else
+		{
+			ri.Printf( PRINT_ALL, "...using GL_ARB_occlusion_query\n" );
+		}
+	}
+	else
+	{
+		ri.Printf( PRINT_ALL, "...GL_ARB_occlusion_query not found\n" );
+	}
+
 #ifdef USE_FBO
 	if ( R_HaveExtension( "GL_EXT_framebuffer_object" ) && R_HaveExtension( "GL_EXT_framebuffer_blit" ) )
 	{
@@ -1110,6 +1187,9 @@ static void R_ScreenShot_f( void ) {
 		return;
 	}
 
+	// the capture must not race the previous frame
+	R_SyncRenderThread();
+
 	if ( !strcmp( ri.Cmd_Argv(1), "levelshot" ) ) {
 		R_LevelShot();
 		return;
@@ -1169,6 +1249,185 @@ static void R_ScreenShot_f( void ) {
 
 //============================================================================
 
+/*
+Video frames are read into a ring of pixel pack buffers and handed to the
+client a few frames later, when the transfer has finished, so capturing
+doesn't wait for the GPU to drain every frame.
+*/
+
+#define VIDEO_READBACK_FRAMES 3
+
+typedef struct {
+	GLuint		buffer;
+	GLsync		fence;
+} videoReadback_t;
+
+static struct {
+	videoReadback_t	frames[ VIDEO_READBACK_FRAMES ];
+	int			width, height;
+	int			padlen;
+	int			size;
+	int			head;			// next frame to read into
+	int			numPending;
+	qboolean	created;
+} videoReadback;
+
+
+/*
+==================
+RB_DeliverVideoFrame
+
+Hands the oldest pending frame to the client, waiting for it if needed
+==================
+*/
+static void RB_DeliverVideoFrame( void )
+{
+	videoReadback_t *vr;
+	const byte *data;
+
+	vr = &videoReadback.frames[ ( videoReadback.head + VIDEO_READBACK_FRAMES - videoReadback.numPending ) % VIDEO_READBACK_FRAMES ];
+	videoReadback.numPending--;
+
+	if ( vr->fence ) {
+		qglDeleteSync( vr->fence );
+		vr->fence = NULL;
+	}
+
+	qglBindBufferARB( GL_PIXEL_PACK_BUFFER_ARB, vr->buffer );
+	data = qglMapBufferARB( GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB );
+	if ( data ) {
+		ri.CL_QueueAVIVideoFrame( data, videoReadback.width, videoReadback.height, videoReadback.padlen,
+			R_GammaTable(), r_aviMotionJpegQuality->integer );
+		qglUnmapBufferARB( GL_PIXEL_PACK_BUFFER_ARB );
+	}
+	qglBindBufferARB( GL_PIXEL_PACK_BUFFER_ARB, 0 );
+}
+
+
+/*
+==================
+RB_VideoFrameReady
+==================
+*/
+static qboolean RB_VideoFrameReady( void )
+{
+	const videoReadback_t *vr;
+
+	if ( videoReadback.numPending == 0 ) {
+		return qfalse;
+	}
+
+	vr = &videoReadback.frames[ ( videoReadback.head + VIDEO_READBACK_FRAMES - videoReadback.numPending ) % VIDEO_READBACK_FRAMES ];
+
+	// without fences just wait for the ring to fill up
+	if ( !vr->fence ) {
+		return qfalse;
+	}
+
+	return ( qglClientWaitSync( vr->fence, 0, 0 ) != GL_TIMEOUT_EXPIRED );
+}
+
+
+/*
+==================
+RE_FlushVideoFrames
+==================
+*/
+void RE_FlushVideoFrames( void )
+{
+	R_SyncRenderThread();
+
+	while ( videoReadback.numPending > 0 ) {
+		RB_DeliverVideoFrame();
+	}
+}
+
+
+/*
+==================
+RB_DestroyVideoReadback
+==================
+*/
+void RB_DestroyVideoReadback( void )
+{
+	int i;
+
+	if ( !videoReadback.created ) {
+		return;
+	}
+
+	RE_FlushVideoFrames();
+
+	for ( i = 0; i < VIDEO_READBACK_FRAMES; i++ ) {
+		qglDeleteBuffersARB( 1, &videoReadback.frames[ i ].buffer );
+	}
+
+	Com_Memset( &videoReadback, 0, sizeof( videoReadback ) );
+}
+
+
+/*
+==================
+RB_ReadVideoFrameAsync
+==================
+*/
+static qboolean RB_ReadVideoFrameAsync( int width, int height, int padlen )
+{
+	videoReadback_t *vr;
+	int size, i;
+
+	if ( !r_aviAsyncReadback->integer || !qglBindBufferARB || !qglMapBufferARB ) {
+		RB_DestroyVideoReadback();
+		return qfalse;
+	}
+
+	size = ( width * 3 + padlen ) * height;
+
+	if ( videoReadback.created && ( videoReadback.width != width || videoReadback.height != height || videoReadback.size != size ) ) {
+		RB_DestroyVideoReadback();
+	}
+
+	if ( !videoReadback.created ) {
+		for ( i = 0; i < VIDEO_READBACK_FRAMES; i++ ) {
+			vr = &videoReadback.frames[ i ];
+			qglGenBuffersARB( 1, &vr->buffer );
+			qglBindBufferARB( GL_PIXEL_PACK_BUFFER_ARB, vr->buffer );
+			qglBufferDataARB( GL_PIXEL_PACK_BUFFER_ARB, size, NULL, GL_STREAM_READ_ARB );
+		}
+		qglBindBufferARB( GL_PIXEL_PACK_BUFFER_ARB, 0 );
+		videoReadback.width = width;
+		videoReadback.height = height;
+		videoReadback.padlen = padlen;
+		videoReadback.size = size;
+		videoReadback.created = qtrue;
+	}
+
+	if ( videoReadback.numPending == VIDEO_READBACK_FRAMES ) {
+		RB_DeliverVideoFrame();
+	}
+
+	vr = &videoReadback.frames[ videoReadback.head ];
+
+	qglBindBufferARB( GL_PIXEL_PACK_BUFFER_ARB, vr->buffer );
+	qglReadPixels( 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, NULL );
+	qglBindBufferARB( GL_PIXEL_PACK_BUFFER_ARB, 0 );
+
+	if ( qglFenceSync ) {
+		vr->fence = qglFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	}
+
+	videoReadback.head = ( videoReadback.head + 1 ) % VIDEO_READBACK_FRAMES;
+	videoReadback.numPending++;
+
+	// pass on whatever has already arrived
+	while ( RB_VideoFrameReady() ) {
+		RB_DeliverVideoFrame();
+	}
+
+	return qtrue;
+}
+
+
 /*
 ==================
 RB_TakeVideoFrameCmd
@@ -1178,8 +1437,8 @@ const void *RB_TakeVideoFrameCmd( const void *data )
 {
 	const videoFrameCommand_t *cmd;
 	byte		*cBuf;
-	size_t		memcount, linelen;
-	int			padwidth, avipadwidth, padlen, avipadlen;
+	size_t		linelen;
+	int			padwidth, padlen;
 	int			packAlign;
 
 	cmd = (const videoFrameCommand_t *)data;
@@ -1191,56 +1450,19 @@ const void *RB_TakeVideoFrameCmd( const void *data )
 	// Alignment stuff for glReadPixels
 	padwidth = PAD(linelen, packAlign);
 	padlen = padwidth - linelen;
-	// AVI line padding
-	avipadwidth = PAD(linelen, AVI_LINE_PADDING);
-	avipadlen = avipadwidth - linelen;
+
+	if ( RB_ReadVideoFrameAsync( cmd->width, cmd->height, padlen ) ) {
+		return (const void *)(cmd + 1);
+	}
 
 	cBuf = PADP(cmd->captureBuffer, packAlign);
 
 	qglReadPixels(0, 0, cmd->width, cmd->height, GL_RGB,
 		GL_UNSIGNED_BYTE, cBuf);
 
-	memcount = padwidth * cmd->height;
-
-	// gamma correction
-	R_GammaCorrect( cBuf, memcount );
-
-	if ( cmd->motionJpeg )
-	{
-		memcount = ri.CL_SaveJPGToBuffer( cmd->encodeBuffer, linelen * cmd->height,
-			r_aviMotionJpegQuality->integer,
-			cmd->width, cmd->height, cBuf, padlen );
-		ri.CL_WriteAVIVideoFrame(cmd->encodeBuffer, memcount);
-	}
-	else
-	{
-		byte *lineend, *memend;
-		byte *srcptr, *destptr;
-
-		srcptr = cBuf;
-		destptr = cmd->encodeBuffer;
-		memend = srcptr + memcount;
-
-		// swap R and B and remove line paddings
-		while(srcptr < memend)
-		{
-			lineend = srcptr + linelen;
-			while(srcptr < lineend)
-			{
-				*destptr++ = srcptr[2];
-				*destptr++ = srcptr[1];
-				*destptr++ = srcptr[0];
-				srcptr += 3;
-			}
-
-			Com_Memset(destptr, '\0', avipadlen);
-			destptr += avipadlen;
-
-			srcptr += padlen;
-		}
-
-		ri.CL_WriteAVIVideoFrame(cmd->encodeBuffer, avipadwidth * cmd->height);
-	}
+	// encoding and gamma correction are done by the client
+	ri.CL_QueueAVIVideoFrame( cBuf, cmd->width, cmd->height, padlen,
+		R_GammaTable(), r_aviMotionJpegQuality->integer );
 
 	return (const void *)(cmd + 1);
 }
@@ -1319,6 +1541,8 @@ RE_SyncRender
 */
 static void RE_SyncRender( void )
 {
+	R_SyncRenderThread();
+
 	if ( qglFinish && backEnd.doneSurfaces )
 	{
 		qglFinish();
@@ -1467,6 +1691,7 @@ static void R_Register( void )
 {
 	// make sure all the commands added here are also removed in R_Shutdown
 	ri.Cmd_AddCommand( "imagelist", R_ImageList_f );
+	ri.Cmd_AddCommand( "r_imageBenchmark", R_ImageBenchmark_f );
 	ri.Cmd_AddCommand( "shaderlist", R_ShaderList_f );
 	ri.Cmd_AddCommand( "skinlist", R_SkinList_f );
 	ri.Cmd_AddCommand( "modellist", R_Modellist_f );
@@ -1494,6 +1719,27 @@ static void R_Register( void )
 
 	r_simpleMipMaps = ri.Cvar_Get( "r_simpleMipMaps", "1", CVAR_ARCHIVE_ND | CVAR_LATCH );
 	ri.Cvar_SetDescription( r_simpleMipMaps, "Whether or not to use a simple mipmapping algorithm or a more correct one:\n 0: off (proper linear filter)\n 1: on (for slower machines)" );
+	r_imagePrefetch = ri.Cvar_Get( "r_imagePrefetch", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_imagePrefetch, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_imagePrefetch, "Decode map textures on worker threads while the map is loading." );
+	r_imageSIMD = ri.Cvar_Get( "r_imageSIMD", "1", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_imageSIMD, "0", "2", CV_INTEGER );
+	ri.Cvar_SetDescription( r_imageSIMD, "Use SIMD instructions for texture resampling, mipmapping and format conversion, all modes produce identical images:\n 0: scalar code\n 1: best instruction set available\n 2: SSE2/NEON only" );
+	r_tessSIMD = ri.Cvar_Get( "r_tessSIMD", "1", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_tessSIMD, "0", "3", CV_INTEGER );
+	ri.Cvar_SetDescription( r_tessSIMD, "Use SIMD instructions for model vertex interpolation, vertex lighting, fog and generated texture coordinates:\n 0: scalar code\n 1: best instruction set available\n 2: SSE2/NEON only\n 3: best instruction set, compared against the scalar code" );
+	r_textureCache = ri.Cvar_Get( "r_textureCache", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_textureCache, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_textureCache, "Compress mipmapped textures to BC1/BC3 and keep them in texcache/ so that later loads skip image decoding, needs S3TC support." );
+	r_shaderCache = ri.Cvar_Get( "r_shaderCache", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_shaderCache, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_shaderCache, "Keep the combined shader scripts and their name index in shadercache.dat, which is reused while the set of shader files stays the same." );
+	r_frontEndThreads = ri.Cvar_Get( "r_frontEndThreads", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_frontEndThreads, "0", "15", CV_INTEGER );
+	ri.Cvar_SetDescription( r_frontEndThreads, "Number of worker threads for world culling, draw surface sorting and texture cache encoding, limited by the number of CPU cores. Idle workers keep polling for a few milliseconds, which shows up as CPU load." );
+	r_smp = ri.Cvar_Get( "r_smp", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_smp, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_smp, "Run the renderer back end on its own thread, the next frame is prepared while the current one is drawn. Adds up to one frame of latency, needs at least two CPU cores." );
 	r_vertexLight = ri.Cvar_Get( "r_vertexLight", "0", CVAR_ARCHIVE | CVAR_LATCH );
 	ri.Cvar_SetDescription( r_vertexLight, "Set to 1 to use vertex light instead of lightmaps, collapse all multi-stage shaders into single-stage ones, might cause rendering artifacts." );
 
@@ -1522,6 +1768,8 @@ static void R_Register( void )
 #ifdef USE_VBO
 	r_vbo = ri.Cvar_Get( "r_vbo", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
 	ri.Cvar_SetDescription( r_vbo, "Use Vertex Buffer Objects to cache static map geometry, may improve FPS on modern GPUs, increases hunk memory usage by 15-30MB (map-dependent)." );
+	r_vboModels = ri.Cvar_Get( "r_vboModels", "0", CVAR_ARCHIVE_ND );
+	ri.Cvar_SetDescription( r_vboModels, "Keep MD3 frames and IQM meshes in Vertex Buffer Objects and animate them in vertex programs instead of on the CPU. Surfaces with shader features the programs can't handle fall back to the regular path. OpenGL renderer only." );
 #endif
 
 	r_mapGreyScale = ri.Cvar_Get( "r_mapGreyScale", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
@@ -1696,6 +1944,9 @@ static void R_Register( void )
 	r_flareCoeff = ri.Cvar_Get( "r_flareCoeff", "150", CVAR_CHEAT );
 	ri.Cvar_CheckRange( r_flareCoeff, "0.1", NULL, CV_FLOAT );
 	ri.Cvar_SetDescription( r_flareCoeff, "Coefficient for the light flare intensity falloff function. Requires \\r_flares 1." );
+	r_flareQueries = ri.Cvar_Get( "r_flareQueries", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_flareQueries, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_flareQueries, "Test light flare visibility with occlusion queries that are read a few frames later instead of reading back the depth buffer, which stalls rendering. Requires \\r_flares 1." );
 
 	r_skipBackEnd = ri.Cvar_Get ("r_skipBackEnd", "0", CVAR_CHEAT);
 	ri.Cvar_SetDescription( r_skipBackEnd, "Skips loading rendering backend." );
@@ -1743,6 +1994,9 @@ static void R_Register( void )
 
 	r_aviMotionJpegQuality = ri.Cvar_Get( "r_aviMotionJpegQuality", "90", CVAR_ARCHIVE_ND );
 	ri.Cvar_SetDescription( r_aviMotionJpegQuality, "Controls quality of Jpeg video capture when \\cl_aviMotionJpeg 1." );
+	r_aviAsyncReadback = ri.Cvar_Get( "r_aviAsyncReadback", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_aviAsyncReadback, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_aviAsyncReadback, "Read back captured video frames through pixel buffer objects a few frames late instead of stalling on every frame." );
 	r_screenshotJpegQuality = ri.Cvar_Get( "r_screenshotJpegQuality", "90", CVAR_ARCHIVE_ND );
 	ri.Cvar_SetDescription( r_screenshotJpegQuality, "Controls quality of Jpeg screenshots when using screenshotJpeg." );
 
@@ -1875,15 +2129,25 @@ void R_Init( void ) {
 	max_polys = r_maxpolys->integer;
 	max_polyverts = r_maxpolyverts->integer;
 
-	ptr = ri.Hunk_Alloc( sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
-	backEndData = (backEndData_t *) ptr;
-	backEndData->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData ));
-	backEndData->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys);
+	// the render thread executes one frame while the front-end fills the other
+	Com_Memset( backEndFrames, 0, sizeof( backEndFrames ) );
+	for ( i = 0; i < ( r_smp->integer ? SMP_FRAMES : 1 ); i++ ) {
+		ptr = ri.Hunk_Alloc( sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
+		backEndFrames[i] = (backEndData_t *) ptr;
+		backEndFrames[i]->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData ));
+		backEndFrames[i]->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys);
+	}
+	backEndData = backEndFrames[0];
 
 	R_InitNextFrame();
 
 	InitOpenGL();
 
+	R_InitImageKernels( r_imageSIMD->integer );
+	R_InitTessKernels( r_tessSIMD->integer );
+
+	R_InitJobs( r_frontEndThreads->integer );
+
 	R_InitImages();
 
 	VarInfo();
@@ -1900,6 +2164,12 @@ void R_Init( void ) {
 	if ( err != GL_NO_ERROR )
 		ri.Printf( PRINT_WARNING, "glGetError() = 0x%x\n", err );
 
+	if ( r_smp->integer ) {
+		glConfig.smpActive = R_StartRenderThread( RB_ExecuteRenderCommands, ri.GLimp_MakeCurrent );
+	} else {
+		glConfig.smpActive = qfalse;
+	}
+
 	ri.Printf( PRINT_ALL, "----- finished R_Init -----\n" );
 }
 
@@ -1918,13 +2188,26 @@ static void RE_Shutdown( refShutdownCode_t code ) {
 	ri.Cmd_RemoveCommand( "screenshotJPEG" );
 	ri.Cmd_RemoveCommand( "screenshot" );
 	ri.Cmd_RemoveCommand( "imagelist" );
+	ri.Cmd_RemoveCommand( "r_imageBenchmark" );
 	ri.Cmd_RemoveCommand( "shaderlist" );
 	ri.Cmd_RemoveCommand( "skinlist" );
 	ri.Cmd_RemoveCommand( "gfxinfo" );
 	ri.Cmd_RemoveCommand( "shaderstate" );
 
+	R_StopRenderThread();
+
+	R_FinishImagePrefetch();
+
+	R_ShutdownJobs();
+	R_FreeWorldJobs();
+
+	RB_DestroyVideoReadback();
+
 	if ( tr.registered ) {
 		//R_IssuePendingRenderCommands();
+#ifdef USE_VBO
+		VBO_ReleaseModels();
+#endif
 		R_DeleteTextures();
 	}
 
@@ -1933,6 +2216,8 @@ static void RE_Shutdown( refShutdownCode_t code ) {
 	// shut down platform specific OpenGL stuff
 	if ( code != REF_KEEP_CONTEXT ) {
 
+		RB_DeleteFlareQueries();
+
 		QGL_DoneARB();
 
 #ifdef USE_VBO
@@ -2036,6 +2321,7 @@ refexport_t *GetRefAPI ( int apiVersion, refimport_t *rimp ) {
 	re.inPVS = R_inPVS;
 
 	re.TakeVideoFrame = RE_TakeVideoFrame;
+	re.FlushVideoFrames = RE_FlushVideoFrames;
 	re.SetColorMappings = R_SetColorMappings;
 
 	re.ThrottleBackend = RE_ThrottleBackend;
@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define USE_PMLIGHT			// promode dynamic lights via \r_dlightMode 1|2
 #define MAX_REAL_DLIGHTS	(MAX_DLIGHTS*2)
 #define MAX_LITSURFS		(MAX_DRAWSURFS)
+#define SMP_FRAMES			2	// front-end frames in flight with r_smp
 
 #define MAX_TEXTURE_SIZE	2048 // must be less or equal to 32768
 
@@ -95,6 +96,7 @@ typedef struct {
 	vec3_t		directedLight;
 #ifdef USE_PMLIGHT
 	vec3_t		shadowLightDir;	// normalized direction towards light
+	qboolean	litSurfs;		// has per-pixel dlight surfaces, keep vertexes on CPU
 #endif
 	qboolean	intShaderTime;
 } trRefEntity_t;
@@ -393,6 +395,8 @@ typedef struct shader_s {
 
 	qboolean	entityMergable;			// merge across entites optimizable (smoke, blood)
 
+	int			videoMaps;				// bit mask of cinematic handles played by stages
+
 	qboolean	isSky;
 	skyParms_t	sky;
 	fogParms_t	fogParms;
@@ -648,7 +652,7 @@ typedef struct srfGridMesh_s {
 	surfaceType_t	surfaceType;
 
 	// dynamic lighting information
-	int				dlightBits;
+	int				dlightBits[SMP_FRAMES];
 
 	// culling information
 	vec3_t			meshBounds[2];
@@ -682,7 +686,7 @@ typedef struct {
 
 	// dynamic lighting information
 #ifdef USE_LEGACY_DLIGHTS
-	int			dlightBits;
+	int			dlightBits[SMP_FRAMES];
 #endif
 	int			vboItemIndex;
 	float		*normals;
@@ -702,7 +706,7 @@ typedef struct {
 
 	// dynamic lighting information
 #ifdef USE_LEGACY_DLIGHTS
-	int				dlightBits;
+	int				dlightBits[SMP_FRAMES];
 #endif
 	int				vboItemIndex;
 
@@ -1029,8 +1033,6 @@ typedef struct videoFrameCommand_s {
 	int					width;
 	int					height;
 	byte				*captureBuffer;
-	byte				*encodeBuffer;
-	qboolean			motionJpeg;
 } videoFrameCommand_t;
 
 enum {
@@ -1071,6 +1073,8 @@ typedef struct {
 	qboolean drawConsole;
 	qboolean doneShadows;
 
+	int		smpFrame;			// backEndFrames index of the commands being executed
+
 } backEndState_t;
 
 /*
@@ -1095,6 +1099,7 @@ typedef struct {
 #endif
 
 	int						frameSceneNum;	// zeroed at RE_BeginFrame
+	int						smpFrame;		// backEndFrames index the front-end fills
 
 	qboolean				worldMapLoaded;
 	world_t					*world;
@@ -1103,6 +1108,7 @@ typedef struct {
 
 	image_t					*defaultImage;
 	image_t					*scratchImage[ MAX_VIDEO_HANDLES ];
+	int						videoMaps;		// cinematics referenced in current frame
 	image_t					*fogImage;
 	image_t					*dlightImage;	// inverse-quare highlight for projective adding
 	image_t					*flareImage;
@@ -1206,6 +1212,7 @@ extern	qboolean			superSampled;
 extern cvar_t	*r_flareSize;
 extern cvar_t	*r_flareFade;
 extern cvar_t	*r_flareCoeff;			// coefficient for the flare intensity falloff function. 
+extern cvar_t	*r_flareQueries;
 
 extern cvar_t	*r_railWidth;
 extern cvar_t	*r_railCoreWidth;
@@ -1237,6 +1244,7 @@ extern cvar_t	*r_dlightIntensity;		// 0.1 - 1.0
 extern cvar_t	*r_dlightSaturation;	// 0.0 - 1.0
 #ifdef USE_VBO
 extern cvar_t	*r_vbo;
+extern cvar_t	*r_vboModels;
 #endif
 #ifdef USE_FBO
 extern cvar_t	*r_fbo;
@@ -1317,6 +1325,13 @@ extern	cvar_t	*r_mapGreyScale;
 
 extern	cvar_t	*r_debugSurface;
 extern	cvar_t	*r_simpleMipMaps;
+extern	cvar_t	*r_imagePrefetch;
+extern	cvar_t	*r_imageSIMD;
+extern	cvar_t	*r_tessSIMD;
+extern	cvar_t	*r_textureCache;
+extern	cvar_t	*r_shaderCache;
+extern	cvar_t	*r_frontEndThreads;
+extern	cvar_t	*r_smp;
 
 extern	cvar_t	*r_showImages;
 extern	cvar_t	*r_defaultImage;
@@ -1439,6 +1454,7 @@ void		R_Init( void );
 
 void		R_SetColorMappings( void );
 void		R_GammaCorrect( byte *buffer, int bufSize );
+const byte	*R_GammaTable( void );
 void		R_ColorShiftLightingBytes( const byte in[4], byte out[4], qboolean hasAlpha );
 
 void	R_ImageList_f( void );
@@ -1463,6 +1479,7 @@ shader_t	*R_FindShader( const char *name, int lightmapIndex, qboolean mipRawImag
 shader_t	*R_GetShaderByHandle( qhandle_t hShader );
 shader_t	*R_GetShaderByState( int index, long *cycleTime );
 shader_t	*R_FindShaderByName( const char *name );
+void		R_PrefetchShaderImages( const char *name );
 void		R_InitShaders( void );
 void		R_ShaderList_f( void );
 void		RE_RemapShader(const char *oldShader, const char *newShader, const char *timeOffset);
@@ -1565,6 +1582,7 @@ WORLD MAP
 
 void R_AddBrushModelSurfaces( trRefEntity_t *e );
 void R_AddWorldSurfaces( void );
+void R_FreeWorldJobs( void );
 qboolean R_inPVS( const vec3_t p1, const vec3_t p2 );
 
 
@@ -1577,6 +1595,7 @@ FLARES
 */
 
 void R_ClearFlares( void );
+void RB_DeleteFlareQueries( void );
 
 void RB_AddFlare( void *surface, int fogNum, vec3_t point, vec3_t color, vec3_t normal );
 void RB_AddDlightFlares( void );
@@ -1732,6 +1751,7 @@ void RB_MDRSurfaceAnim( mdrSurface_t *surface );
 qboolean R_LoadIQM (model_t *mod, void *buffer, int filesize, const char *name );
 void R_AddIQMSurfaces( trRefEntity_t *ent );
 void RB_IQMSurfaceAnim( const surfaceType_t *surface );
+void RB_IQMPoseMats( iqmData_t *data, float *poseMats );
 int R_IQMLerpTag( orientation_t *tag, iqmData_t *data,
                   int startFrame, int endFrame,
                   float frac, const char *tagName );
@@ -1768,6 +1788,17 @@ void	RB_CalcColorFromOneMinusEntity( unsigned char *dstColors );
 void	RB_CalcSpecularAlpha( unsigned char *alphas );
 void	RB_CalcDiffuseColor( unsigned char *colors );
 
+// tr_shade_simd.c
+void	R_InitTessKernels( int mode );
+void	RB_TessLerpMesh( vec4_t *xyz, vec4_t *normal, const short *newXyz, const short *oldXyz, float backlerp, int numVerts );
+void	RB_TessDiffuseColor( byte *colors, const vec4_t *normal, const trRefEntity_t *ent, int numVerts );
+void	RB_TessAddScaledNormals( vec4_t *xyz, const vec4_t *normal, float scale, int numVerts );
+void	RB_TessFogTexCoords( float *st, const vec4_t *xyz, const vec4_t distance, const vec4_t depth, float eyeT, qboolean eyeOutside, int numVerts );
+void	RB_TessFogModulate( byte *colors, const float *st, int channels, int numVerts );
+void	RB_TessEnvironmentTexCoords( float *st, const vec4_t *xyz, const vec4_t *normal, const vec3_t viewOrigin, int numVerts );
+void	RB_TessScaleTexCoords( float *dst, const float *src, const float scale[2], const float offset[2], int numVerts );
+void	RB_TessTransformTexCoords( float *dst, const float *src, const float matrix[2][2], const float translate[2], int numVerts );
+
 /*
 =============================================================
 
@@ -1899,6 +1930,7 @@ extern	int		max_polys;
 extern	int		max_polyverts;
 
 extern	backEndData_t	*backEndData;
+extern	backEndData_t	*backEndFrames[SMP_FRAMES];
 
 void RB_ExecuteRenderCommands( const void *data );
 void RB_TakeScreenshot( int x, int y, int width, int height, const char *fileName );
@@ -1914,8 +1946,9 @@ void RE_StretchPic ( float x, float y, float w, float h,
 					  float s1, float t1, float s2, float t2, qhandle_t hShader );
 void RE_BeginFrame( stereoFrame_t stereoFrame );
 void RE_EndFrame( int *frontEndMsec, int *backEndMsec );
-void RE_TakeVideoFrame( int width, int height,
-		byte *captureBuffer, byte *encodeBuffer, qboolean motionJpeg );
+void RE_TakeVideoFrame( int width, int height, byte *captureBuffer );
+void RE_FlushVideoFrames( void );
+void RB_DestroyVideoReadback( void );
 
 void RE_FinishBloom( void );
 void RE_ThrottleBackend( void );
@@ -1937,6 +1970,9 @@ void R_BloomScreen( void );
 	QGL_Ext_PROCS;
 	QGL_ARB_PROGRAM_PROCS;
 	QGL_VBO_PROCS;
+	QGL_PBO_PROCS;
+	QGL_SYNC_PROCS;
+	QGL_OCCLUSION_PROCS;
 	QGL_FBO_PROCS;
 	QGL_FBO_OPT_PROCS;
 #undef GLE
@@ -1954,6 +1990,10 @@ extern void VBO_Cleanup( void );
 extern void VBO_QueueItem( int itemIndex );
 extern void VBO_ClearQueue( void );
 extern void VBO_Flush( void );
+
+extern qboolean VBO_DrawMD3( const md3Surface_t *surface );
+extern qboolean VBO_DrawIQM( const srfIQModel_t *surface );
+extern void VBO_ReleaseModels( void );
 #endif
 
 // ARB shaders definitions
@@ -354,6 +354,9 @@ void R_AddMD3Surfaces( trRefEntity_t *ent ) {
 			if ( !R_LightCullBounds( dl, bounds[0], bounds[1] ) ) 
 				dlights[ numDlights++ ] = dl;
 		}
+		if ( numDlights ) {
+			ent->litSurfs = qtrue;
+		}
 	}
 #endif
 
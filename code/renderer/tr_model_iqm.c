@@ -1245,6 +1245,24 @@ static void ComputeJointMats( iqmData_t *data, int frame, int oldframe,
 }
 
 
+/*
+=================
+RB_IQMPoseMats
+
+Interpolated pose matrices for the current entity, used when
+the surface is skinned by a vertex program
+=================
+*/
+void RB_IQMPoseMats( iqmData_t *data, float *poseMats ) {
+	int	frame = data->num_frames ? backEnd.currentEntity->e.frame % data->num_frames : 0;
+	int	oldframe = data->num_frames ? backEnd.currentEntity->e.oldframe % data->num_frames : 0;
+
+	if ( data->num_poses > 0 ) {
+		ComputePoseMats( data, frame, oldframe, backEnd.currentEntity->e.backlerp, poseMats );
+	}
+}
+
+
 /*
 =================
 RB_AddIQMSurfaces
@@ -1277,6 +1295,12 @@ void RB_IQMSurfaceAnim( const surfaceType_t *surface ) {
 	glIndex_t	*ptr;
 	glIndex_t	base;
 
+#ifdef USE_VBO
+	if ( r_vboModels->integer && VBO_DrawIQM( surf ) ) {
+		return;
+	}
+#endif
+
 	RB_CHECKOVERFLOW( surf->num_vertexes, surf->num_triangles * 3 );
 
 	xyz = &data->positions[surf->first_vertex * 3];
@@ -47,6 +47,12 @@ R_InitNextFrame
 */
 void R_InitNextFrame( void ) {
 
+	if ( R_RenderThreadActive() ) {
+		// the render thread owns the frame that was just issued
+		tr.smpFrame = ( tr.smpFrame + 1 ) % SMP_FRAMES;
+		backEndData = backEndFrames[ tr.smpFrame ];
+	}
+
 	backEndData->commands.used = 0;
 
 	r_firstSceneDrawSurf = 0;
@@ -232,6 +238,9 @@ void RE_AddRefEntityToScene( const refEntity_t *ent, qboolean intShaderTime ) {
 
 	backEndData->entities[r_numentities].e = *ent;
 	backEndData->entities[r_numentities].lightingCalculated = qfalse;
+#ifdef USE_PMLIGHT
+	backEndData->entities[r_numentities].litSurfs = qfalse;
+#endif
 	backEndData->entities[r_numentities].intShaderTime = intShaderTime;
 
 	r_numentities++;
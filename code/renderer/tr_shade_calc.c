@@ -130,14 +130,7 @@ static void RB_CalcDeformVertexes( deformStage_t *ds )
 	{
 		scale = EvalWaveForm( &ds->deformationWave );
 
-		for ( i = 0; i < tess.numVertexes; i++, xyz += 4, normal += 4 )
-		{
-			VectorScale( normal, scale, offset );
-			
-			xyz[0] += offset[0];
-			xyz[1] += offset[1];
-			xyz[2] += offset[2];
-		}
+		RB_TessAddScaledNormals( tess.xyz, tess.normal, scale, tess.numVertexes );
 	}
 	else
 	{
@@ -732,7 +725,6 @@ void RB_CalcWaveAlpha( const waveForm_t *wf, unsigned char *dstColors )
 ** RB_CalcModulateColorsByFog
 */
 void RB_CalcModulateColorsByFog( unsigned char *colors ) {
-	int		i;
 	float	texCoords[SHADER_MAX_VERTEXES][2];
 
 	// calculate texcoords so we can derive density
@@ -740,12 +732,7 @@ void RB_CalcModulateColorsByFog( unsigned char *colors ) {
 	// been previously called if the surface was opaque
 	RB_CalcFogTexCoords( texCoords[0] );
 
-	for ( i = 0; i < tess.numVertexes; i++, colors += 4 ) {
-		float f = 1.0 - R_FogFactor( texCoords[i][0], texCoords[i][1] );
-		colors[0] *= f;
-		colors[1] *= f;
-		colors[2] *= f;
-	}
+	RB_TessFogModulate( colors, texCoords[0], 7, tess.numVertexes );
 }
 
 
@@ -753,7 +740,6 @@ void RB_CalcModulateColorsByFog( unsigned char *colors ) {
 ** RB_CalcModulateAlphasByFog
 */
 void RB_CalcModulateAlphasByFog( unsigned char *colors ) {
-	int		i;
 	float	texCoords[SHADER_MAX_VERTEXES][2];
 
 	// calculate texcoords so we can derive density
@@ -761,10 +747,7 @@ void RB_CalcModulateAlphasByFog( unsigned char *colors ) {
 	// been previously called if the surface was opaque
 	RB_CalcFogTexCoords( texCoords[0] );
 
-	for ( i = 0; i < tess.numVertexes; i++, colors += 4 ) {
-		float f = 1.0 - R_FogFactor( texCoords[i][0], texCoords[i][1] );
-		colors[3] *= f;
-	}
+	RB_TessFogModulate( colors, texCoords[0], 8, tess.numVertexes );
 }
 
 
@@ -772,7 +755,6 @@ void RB_CalcModulateAlphasByFog( unsigned char *colors ) {
 ** RB_CalcModulateRGBAsByFog
 */
 void RB_CalcModulateRGBAsByFog( unsigned char *colors ) {
-	int		i;
 	float	texCoords[SHADER_MAX_VERTEXES][2];
 
 	// calculate texcoords so we can derive density
@@ -780,13 +762,7 @@ void RB_CalcModulateRGBAsByFog( unsigned char *colors ) {
 	// been previously called if the surface was opaque
 	RB_CalcFogTexCoords( texCoords[0] );
 
-	for ( i = 0; i < tess.numVertexes; i++, colors += 4 ) {
-		float f = 1.0 - R_FogFactor( texCoords[i][0], texCoords[i][1] );
-		colors[0] *= f;
-		colors[1] *= f;
-		colors[2] *= f;
-		colors[3] *= f;
-	}
+	RB_TessFogModulate( colors, texCoords[0], 15, tess.numVertexes );
 }
 
 
@@ -808,9 +784,6 @@ doesn't fit our shader data.
 ========================
 */
 void RB_CalcFogTexCoords( float *st ) {
-	int			i;
-	float		*v;
-	float		s, t;
 	float		eyeT;
 	qboolean	eyeOutside;
 	const fog_t		*fog;
@@ -859,30 +832,7 @@ void RB_CalcFogTexCoords( float *st ) {
 	fogDistanceVector[3] += 1.0/512;
 
 	// calculate density for each point
-	for (i = 0, v = tess.xyz[0] ; i < tess.numVertexes ; i++, v += 4) {
-		// calculate the length in fog
-		s = DotProduct( v, fogDistanceVector ) + fogDistanceVector[3];
-		t = DotProduct( v, fogDepthVector ) + fogDepthVector[3];
-
-		// partially clipped fogs use the T axis		
-		if ( eyeOutside ) {
-			if ( t < 1.0 ) {
-				t = 1.0/32;	// point is outside, so no fogging
-			} else {
-				t = 1.0/32 + 30.0/32 * t / ( t - eyeT );	// cut the distance at the fog plane
-			}
-		} else {
-			if ( t < 0 ) {
-				t = 1.0/32;	// point is outside, so no fogging
-			} else {
-				t = 31.0/32;
-			}
-		}
-
-		st[0] = s;
-		st[1] = t;
-		st += 2;
-	}
+	RB_TessFogTexCoords( st, tess.xyz, fogDistanceVector, fogDepthVector, eyeT, eyeOutside, tess.numVertexes );
 }
 
 
@@ -1033,28 +983,7 @@ void RB_CalcEnvironmentTexCoordsFP( float *st, qboolean screenMap ) {
 */
 void RB_CalcEnvironmentTexCoords( float *st )
 {
-	int			i;
-	const float *v, *normal;
-	vec3_t		viewer, reflected;
-	float		d;
-
-	v = tess.xyz[0];
-	normal = tess.normal[0];
-
-	for (i = 0 ; i < tess.numVertexes ; i++, v += 4, normal += 4, st += 2 ) 
-	{
-		VectorSubtract (backEnd.or.viewOrigin, v, viewer);
-		VectorNormalizeFast (viewer);
-
-		d = DotProduct (normal, viewer);
-
-		//reflected[0] = normal[0]*2*d - viewer[0];
-		reflected[1] = normal[1]*2*d - viewer[1];
-		reflected[2] = normal[2]*2*d - viewer[2];
-
-		st[0] = 0.5 + reflected[1] * 0.5;
-		st[1] = 0.5 - reflected[2] * 0.5;
-	}
+	RB_TessEnvironmentTexCoords( st, tess.xyz, tess.normal, backEnd.or.viewOrigin, tess.numVertexes );
 }
 
 
@@ -1081,13 +1010,9 @@ void RB_CalcTurbulentTexCoords( const waveForm_t *wf, float *src, float *dst )
 */
 void RB_CalcScaleTexCoords( const float scale[2], float *src, float *dst )
 {
-	int i;
+	static const float offset[2] = { 0.0f, 0.0f };
 
-	for ( i = 0; i < tess.numVertexes; i++, dst += 2, src += 2 )
-	{
-		dst[0] = src[0] * scale[0];
-		dst[1] = src[1] * scale[1];
-	}
+	RB_TessScaleTexCoords( dst, src, scale, offset, tess.numVertexes );
 }
 
 
@@ -1096,7 +1021,8 @@ void RB_CalcScaleTexCoords( const float scale[2], float *src, float *dst )
 */
 void RB_CalcScrollTexCoords( const float scrollSpeed[2], float *src, float *dst )
 {
-	int i;
+	static const float scale[2] = { 1.0f, 1.0f };
+	float	offset[2];
 	double	timeScale; // -EC-: set to double
 	double	adjustedScrollS, adjustedScrollT; // -EC-: set to double
 
@@ -1110,11 +1036,10 @@ void RB_CalcScrollTexCoords( const float scrollSpeed[2], float *src, float *dst
 	adjustedScrollS = adjustedScrollS - floor( adjustedScrollS );
 	adjustedScrollT = adjustedScrollT - floor( adjustedScrollT );
 
-	for ( i = 0; i < tess.numVertexes; i++, dst += 2, src += 2 )
-	{
-		dst[0] = src[0] + adjustedScrollS;
-		dst[1] = src[1] + adjustedScrollT;
-	}
+	offset[0] = adjustedScrollS;
+	offset[1] = adjustedScrollT;
+
+	RB_TessScaleTexCoords( dst, src, scale, offset, tess.numVertexes );
 }
 
 
@@ -1123,16 +1048,7 @@ void RB_CalcScrollTexCoords( const float scrollSpeed[2], float *src, float *dst
 */
 void RB_CalcTransformTexCoords( const texModInfo_t *tmi, float *src, float *dst )
 {
-	int i;
-
-	for ( i = 0; i < tess.numVertexes; i++, dst += 2, src += 2 )
-	{
-		const float s = src[0];
-		const float t = src[1];
-
-		dst[0] = s * tmi->matrix[0][0] + t * tmi->matrix[1][0] + tmi->translate[0];
-		dst[1] = s * tmi->matrix[0][1] + t * tmi->matrix[1][1] + tmi->translate[1];
-	}
+	RB_TessTransformTexCoords( dst, src, tmi->matrix, tmi->translate, tess.numVertexes );
 }
 
 
@@ -1230,57 +1146,7 @@ void RB_CalcSpecularAlpha( unsigned char *alphas ) {
 **
 ** The basic vertex lighting calc
 */
-static void RB_CalcDiffuseColor_scalar( unsigned char *colors )
-{
-	int				i, j;
-	float			*v, *normal;
-	float			incoming;
-	const trRefEntity_t *ent;
-	int				ambientLightInt;
-	vec3_t			ambientLight;
-	vec3_t			lightDir;
-	vec3_t			directedLight;
-	int				numVertexes;
-	ent = backEnd.currentEntity;
-	ambientLightInt = ent->ambientLightInt;
-	VectorCopy( ent->ambientLight, ambientLight );
-	VectorCopy( ent->directedLight, directedLight );
-	VectorCopy( ent->lightDir, lightDir );
-
-	v = tess.xyz[0];
-	normal = tess.normal[0];
-
-	numVertexes = tess.numVertexes;
-	for (i = 0 ; i < numVertexes ; i++, v += 4, normal += 4) {
-		incoming = DotProduct (normal, lightDir);
-		if ( incoming <= 0 ) {
-			*(int *)&colors[i*4] = ambientLightInt;
-			continue;
-		} 
-		j = myftol( ambientLight[0] + incoming * directedLight[0] );
-		if ( j > 255 ) {
-			j = 255;
-		}
-		colors[i*4+0] = j;
-
-		j = myftol( ambientLight[1] + incoming * directedLight[1] );
-		if ( j > 255 ) {
-			j = 255;
-		}
-		colors[i*4+1] = j;
-
-		j = myftol( ambientLight[2] + incoming * directedLight[2] );
-		if ( j > 255 ) {
-			j = 255;
-		}
-		colors[i*4+2] = j;
-
-		colors[i*4+3] = 255;
-	}
-}
-
-
 void RB_CalcDiffuseColor( unsigned char *colors )
 {
-	RB_CalcDiffuseColor_scalar( colors );
+	RB_TessDiffuseColor( colors, tess.normal, backEnd.currentEntity, tess.numVertexes );
 }
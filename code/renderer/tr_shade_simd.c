@@ -0,0 +1,1231 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+#include "tr_local.h"
+
+#if idx64 || defined(__SSE2__)
+#define TESS_SIMD_SSE2
+#include <emmintrin.h>
+#if idx64 && ( defined(__clang__) || ( defined(__GNUC__) && __GNUC__ >= 5 ) || ( defined(_MSC_VER) && _MSC_VER >= 1800 ) )
+#define TESS_SIMD_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+#endif
+#elif arm64 || defined(__ARM_NEON)
+#define TESS_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+========================================================================
+
+Tessellation kernels
+
+Per-vertex loops of the backend: md3 frame interpolation, entity vertex
+lighting, deforms, fog and generated texture coordinates. The vector
+variants keep the order of operations of the scalar code, results only
+differ where the platform's reciprocal square root does.
+
+With r_tessSIMD 3 every call is repeated with the scalar code and the
+first differences are printed.
+
+========================================================================
+*/
+
+typedef struct {
+	const char *name;
+	void (*LerpMesh)( vec4_t *xyz, vec4_t *normal, const short *newXyz, const short *oldXyz, const float *scale, int numVerts ); // oldXyz is NULL for a single frame
+	void (*DiffuseColor)( byte *colors, const vec4_t *normal, const trRefEntity_t *ent, int numVerts );
+	void (*AddScaledNormals)( vec4_t *xyz, const vec4_t *normal, float scale, int numVerts );
+	void (*FogTexCoords)( float *st, const vec4_t *xyz, const float *distance, const float *depth, float eyeT, qboolean eyeOutside, int numVerts );
+	void (*FogModulate)( byte *colors, const float *st, int channels, int numVerts );
+	void (*EnvironmentTexCoords)( float *st, const vec4_t *xyz, const vec4_t *normal, const float *viewOrigin, int numVerts );
+	void (*ScaleTexCoords)( float *dst, const float *src, const float *scale, const float *offset, int numVerts );
+	void (*TransformTexCoords)( float *dst, const float *src, const float matrix[2][2], const float *translate, int numVerts );
+} tessKernels_t;
+
+#define TESS_VERIFY_EPSILON		0.001f	// relative, covers approximate reciprocal square roots
+#define TESS_VERIFY_REPORTS		16
+
+
+/*
+========================================================================
+
+Scalar kernels
+
+========================================================================
+*/
+
+static void DecodeNormal( short packed, float *out ) {
+	unsigned lat, lng;
+
+	lat = ( packed >> 8 ) & 0xff;
+	lng = ( packed & 0xff );
+	lat *= (FUNCTABLE_SIZE/256);
+	lng *= (FUNCTABLE_SIZE/256);
+
+	// decode X as cos( lat ) * sin( long )
+	// decode Y as sin( lat ) * sin( long )
+	// decode Z as cos( long )
+
+	out[0] = tr.sinTable[(lat+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK] * tr.sinTable[lng];
+	out[1] = tr.sinTable[lat] * tr.sinTable[lng];
+	out[2] = tr.sinTable[(lng+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK];
+}
+
+
+static void LerpMesh_Scalar( vec4_t *xyz, vec4_t *normal, const short *newXyz, const short *oldXyz, const float *scale, int numVerts ) {
+	vec3_t oldNormal, newNormal;
+	int i;
+
+	if ( !oldXyz ) {
+		// just copy the vertexes
+		for ( i = 0; i < numVerts; i++, newXyz += 4 ) {
+			xyz[i][0] = newXyz[0] * scale[0];
+			xyz[i][1] = newXyz[1] * scale[0];
+			xyz[i][2] = newXyz[2] * scale[0];
+			DecodeNormal( newXyz[3], normal[i] );
+		}
+		return;
+	}
+
+	// interpolate and copy the vertex and normal
+	for ( i = 0; i < numVerts; i++, oldXyz += 4, newXyz += 4 ) {
+		xyz[i][0] = oldXyz[0] * scale[1] + newXyz[0] * scale[0];
+		xyz[i][1] = oldXyz[1] * scale[1] + newXyz[1] * scale[0];
+		xyz[i][2] = oldXyz[2] * scale[1] + newXyz[2] * scale[0];
+
+		// FIXME: interpolate lat/long instead?
+		DecodeNormal( newXyz[3], newNormal );
+		DecodeNormal( oldXyz[3], oldNormal );
+
+		normal[i][0] = oldNormal[0] * scale[3] + newNormal[0] * scale[2];
+		normal[i][1] = oldNormal[1] * scale[3] + newNormal[1] * scale[2];
+		normal[i][2] = oldNormal[2] * scale[3] + newNormal[2] * scale[2];
+
+		VectorNormalizeFast( normal[i] );
+	}
+}
+
+
+static void DiffuseColor_Scalar( byte *colors, const vec4_t *normal, const trRefEntity_t *ent, int numVerts ) {
+	float incoming;
+	int i, j;
+
+	for ( i = 0; i < numVerts; i++, colors += 4 ) {
+		incoming = DotProduct( normal[i], ent->lightDir );
+		if ( incoming <= 0 ) {
+			*(int *)colors = ent->ambientLightInt;
+			continue;
+		}
+		j = myftol( ent->ambientLight[0] + incoming * ent->directedLight[0] );
+		if ( j > 255 ) {
+			j = 255;
+		}
+		colors[0] = j;
+
+		j = myftol( ent->ambientLight[1] + incoming * ent->directedLight[1] );
+		if ( j > 255 ) {
+			j = 255;
+		}
+		colors[1] = j;
+
+		j = myftol( ent->ambientLight[2] + incoming * ent->directedLight[2] );
+		if ( j > 255 ) {
+			j = 255;
+		}
+		colors[2] = j;
+
+		colors[3] = 255;
+	}
+}
+
+
+static void AddScaledNormals_Scalar( vec4_t *xyz, const vec4_t *normal, float scale, int numVerts ) {
+	int i;
+
+	for ( i = 0; i < numVerts; i++ ) {
+		xyz[i][0] += normal[i][0] * scale;
+		xyz[i][1] += normal[i][1] * scale;
+		xyz[i][2] += normal[i][2] * scale;
+	}
+}
+
+
+static void FogTexCoords_Scalar( float *st, const vec4_t *xyz, const float *distance, const float *depth, float eyeT, qboolean eyeOutside, int numVerts ) {
+	float s, t;
+	int i;
+
+	for ( i = 0; i < numVerts; i++, st += 2 ) {
+		// calculate the length in fog
+		s = DotProduct( xyz[i], distance ) + distance[3];
+		t = DotProduct( xyz[i], depth ) + depth[3];
+
+		// partially clipped fogs use the T axis
+		if ( eyeOutside ) {
+			if ( t < 1.0 ) {
+				t = 1.0/32;	// point is outside, so no fogging
+			} else {
+				t = 1.0/32 + 30.0/32 * t / ( t - eyeT );	// cut the distance at the fog plane
+			}
+		} else {
+			if ( t < 0 ) {
+				t = 1.0/32;	// point is outside, so no fogging
+			} else {
+				t = 31.0/32;
+			}
+		}
+
+		st[0] = s;
+		st[1] = t;
+	}
+}
+
+
+static void FogModulate_Scalar( byte *colors, const float *st, int channels, int numVerts ) {
+	float f;
+	int i, j;
+
+	for ( i = 0; i < numVerts; i++, colors += 4, st += 2 ) {
+		f = 1.0 - R_FogFactor( st[0], st[1] );
+		for ( j = 0; j < 4; j++ ) {
+			if ( channels & ( 1 << j ) ) {
+				colors[j] *= f;
+			}
+		}
+	}
+}
+
+
+static void EnvironmentTexCoords_Scalar( float *st, const vec4_t *xyz, const vec4_t *normal, const float *viewOrigin, int numVerts ) {
+	vec3_t viewer, reflected;
+	float d;
+	int i;
+
+	for ( i = 0; i < numVerts; i++, st += 2 ) {
+		VectorSubtract( viewOrigin, xyz[i], viewer );
+		VectorNormalizeFast( viewer );
+
+		d = DotProduct( normal[i], viewer );
+
+		reflected[1] = normal[i][1]*2*d - viewer[1];
+		reflected[2] = normal[i][2]*2*d - viewer[2];
+
+		st[0] = 0.5 + reflected[1] * 0.5;
+		st[1] = 0.5 - reflected[2] * 0.5;
+	}
+}
+
+
+static void ScaleTexCoords_Scalar( float *dst, const float *src, const float *scale, const float *offset, int numVerts ) {
+	int i;
+
+	for ( i = 0; i < numVerts; i++, dst += 2, src += 2 ) {
+		dst[0] = src[0] * scale[0] + offset[0];
+		dst[1] = src[1] * scale[1] + offset[1];
+	}
+}
+
+
+static void TransformTexCoords_Scalar( float *dst, const float *src, const float matrix[2][2], const float *translate, int numVerts ) {
+	int i;
+
+	for ( i = 0; i < numVerts; i++, dst += 2, src += 2 ) {
+		const float s = src[0];
+		const float t = src[1];
+
+		dst[0] = s * matrix[0][0] + t * matrix[1][0] + translate[0];
+		dst[1] = s * matrix[0][1] + t * matrix[1][1] + translate[1];
+	}
+}
+
+
+static const tessKernels_t scalarKernels = {
+	"scalar",
+	LerpMesh_Scalar,
+	DiffuseColor_Scalar,
+	AddScaledNormals_Scalar,
+	FogTexCoords_Scalar,
+	FogModulate_Scalar,
+	EnvironmentTexCoords_Scalar,
+	ScaleTexCoords_Scalar,
+	TransformTexCoords_Scalar
+};
+
+
+#ifdef TESS_SIMD_SSE2
+/*
+========================================================================
+
+SSE2 kernels
+
+========================================================================
+*/
+
+static ID_INLINE __m128 LoadShorts_SSE2( const short *v ) {
+	const __m128i s = _mm_loadl_epi64( (const __m128i *)v );
+	return _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( s, s ), 16 ) );
+}
+
+
+static ID_INLINE __m128 DecodeNormal_SSE2( short packed ) {
+	const unsigned lat = ( ( packed >> 8 ) & 0xff ) * (FUNCTABLE_SIZE/256);
+	const unsigned lng = ( packed & 0xff ) * (FUNCTABLE_SIZE/256);
+	const float sinLng = tr.sinTable[lng];
+
+	return _mm_mul_ps( _mm_setr_ps( tr.sinTable[(lat+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK], tr.sinTable[lat], tr.sinTable[(lng+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK], 0.0f ),
+		_mm_setr_ps( sinLng, sinLng, 1.0f, 0.0f ) );
+}
+
+
+// same as Q_rsqrt on this platform
+static ID_INLINE __m128 RSqrt_SSE2( __m128 x ) {
+#ifdef _MSC_SSE2
+	return _mm_rsqrt_ps( x );
+#else
+	return _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( x ) );
+#endif
+}
+
+
+// xyz in the first three lanes, the fourth must be 0
+static ID_INLINE __m128 Normalize3_SSE2( __m128 v ) {
+	const __m128 sq = _mm_mul_ps( v, v );
+	__m128 d;
+
+	d = _mm_add_ss( sq, _mm_shuffle_ps( sq, sq, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+	d = _mm_add_ss( d, _mm_shuffle_ps( sq, sq, _MM_SHUFFLE( 2, 2, 2, 2 ) ) );
+	d = RSqrt_SSE2( d );
+
+	return _mm_mul_ps( v, _mm_shuffle_ps( d, d, _MM_SHUFFLE( 0, 0, 0, 0 ) ) );
+}
+
+
+static void LerpMesh_SSE2( vec4_t *xyz, vec4_t *normal, const short *newXyz, const short *oldXyz, const float *scale, int numVerts ) {
+	const __m128 xyzMask = _mm_castsi128_ps( _mm_setr_epi32( -1, -1, -1, 0 ) );
+	const __m128 newXyzScale = _mm_set1_ps( scale[0] );
+	const __m128 oldXyzScale = _mm_set1_ps( scale[1] );
+	const __m128 newNormalScale = _mm_set1_ps( scale[2] );
+	const __m128 oldNormalScale = _mm_set1_ps( scale[3] );
+	__m128 v, n;
+	int i;
+
+	if ( !oldXyz ) {
+		for ( i = 0; i < numVerts; i++, newXyz += 4 ) {
+			v = _mm_mul_ps( LoadShorts_SSE2( newXyz ), newXyzScale );
+			_mm_storeu_ps( xyz[i], _mm_and_ps( v, xyzMask ) );
+			_mm_storeu_ps( normal[i], DecodeNormal_SSE2( newXyz[3] ) );
+		}
+		return;
+	}
+
+	for ( i = 0; i < numVerts; i++, oldXyz += 4, newXyz += 4 ) {
+		v = _mm_add_ps( _mm_mul_ps( LoadShorts_SSE2( oldXyz ), oldXyzScale ), _mm_mul_ps( LoadShorts_SSE2( newXyz ), newXyzScale ) );
+		_mm_storeu_ps( xyz[i], _mm_and_ps( v, xyzMask ) );
+
+		n = _mm_add_ps( _mm_mul_ps( DecodeNormal_SSE2( oldXyz[3] ), oldNormalScale ), _mm_mul_ps( DecodeNormal_SSE2( newXyz[3] ), newNormalScale ) );
+		_mm_storeu_ps( normal[i], Normalize3_SSE2( n ) );
+	}
+}
+
+
+// four RGBA colors from channel vectors, each 0..255 after saturation
+static ID_INLINE __m128i PackColors_SSE2( __m128i r, __m128i g, __m128i b, __m128i a ) {
+	__m128i x, rg, ba;
+
+	// r0 r1 r2 r3 g0 g1 g2 g3 b0 b1 b2 b3 a0 a1 a2 a3
+	x = _mm_packus_epi16( _mm_packs_epi32( r, g ), _mm_packs_epi32( b, a ) );
+
+	rg = _mm_unpacklo_epi8( x, _mm_srli_si128( x, 4 ) );
+	ba = _mm_srli_si128( x, 8 );
+	ba = _mm_unpacklo_epi8( ba, _mm_srli_si128( ba, 4 ) );
+
+	return _mm_unpacklo_epi16( rg, ba );
+}
+
+
+static void DiffuseColor_SSE2( byte *colors, const vec4_t *normal, const trRefEntity_t *ent, int numVerts ) {
+	const __m128 lightX = _mm_set1_ps( ent->lightDir[0] );
+	const __m128 lightY = _mm_set1_ps( ent->lightDir[1] );
+	const __m128 lightZ = _mm_set1_ps( ent->lightDir[2] );
+	const __m128 ambientR = _mm_set1_ps( ent->ambientLight[0] );
+	const __m128 ambientG = _mm_set1_ps( ent->ambientLight[1] );
+	const __m128 ambientB = _mm_set1_ps( ent->ambientLight[2] );
+	const __m128 directedR = _mm_set1_ps( ent->directedLight[0] );
+	const __m128 directedG = _mm_set1_ps( ent->directedLight[1] );
+	const __m128 directedB = _mm_set1_ps( ent->directedLight[2] );
+	const __m128i alpha = _mm_set1_epi32( 255 );
+	__m128 x, y, z, w, incoming;
+	__m128i r, g, b;
+	int i;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4 ) {
+		x = _mm_loadu_ps( normal[i+0] );
+		y = _mm_loadu_ps( normal[i+1] );
+		z = _mm_loadu_ps( normal[i+2] );
+		w = _mm_loadu_ps( normal[i+3] );
+		_MM_TRANSPOSE4_PS( x, y, z, w );
+
+		// back facing vertexes get ambient + 0 * directed, which is ambientLightInt
+		incoming = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, lightX ), _mm_mul_ps( y, lightY ) ), _mm_mul_ps( z, lightZ ) );
+		incoming = _mm_max_ps( incoming, _mm_setzero_ps() );
+
+		r = _mm_cvttps_epi32( _mm_add_ps( ambientR, _mm_mul_ps( incoming, directedR ) ) );
+		g = _mm_cvttps_epi32( _mm_add_ps( ambientG, _mm_mul_ps( incoming, directedG ) ) );
+		b = _mm_cvttps_epi32( _mm_add_ps( ambientB, _mm_mul_ps( incoming, directedB ) ) );
+
+		_mm_storeu_si128( (__m128i *)( colors + i * 4 ), PackColors_SSE2( r, g, b, alpha ) );
+	}
+
+	DiffuseColor_Scalar( colors + i * 4, normal + i, ent, numVerts - i );
+}
+
+
+static void AddScaledNormals_SSE2( vec4_t *xyz, const vec4_t *normal, float scale, int numVerts ) {
+	const __m128 xyzMask = _mm_castsi128_ps( _mm_setr_epi32( -1, -1, -1, 0 ) );
+	const __m128 s = _mm_set1_ps( scale );
+	int i;
+
+	for ( i = 0; i < numVerts; i++ ) {
+		const __m128 offset = _mm_and_ps( _mm_mul_ps( _mm_loadu_ps( normal[i] ), s ), xyzMask );
+		_mm_storeu_ps( xyz[i], _mm_add_ps( _mm_loadu_ps( xyz[i] ), offset ) );
+	}
+}
+
+
+static void FogTexCoords_SSE2( float *st, const vec4_t *xyz, const float *distance, const float *depth, float eyeT, qboolean eyeOutside, int numVerts ) {
+	const __m128 distX = _mm_set1_ps( distance[0] );
+	const __m128 distY = _mm_set1_ps( distance[1] );
+	const __m128 distZ = _mm_set1_ps( distance[2] );
+	const __m128 distW = _mm_set1_ps( distance[3] );
+	const __m128 depthX = _mm_set1_ps( depth[0] );
+	const __m128 depthY = _mm_set1_ps( depth[1] );
+	const __m128 depthZ = _mm_set1_ps( depth[2] );
+	const __m128 depthW = _mm_set1_ps( depth[3] );
+	const __m128 outside = _mm_set1_ps( 1.0f/32 );
+	const __m128 inside = _mm_set1_ps( 31.0f/32 );
+	__m128 x, y, z, w, s, t, clip;
+	int i;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4, st += 8 ) {
+		x = _mm_loadu_ps( xyz[i+0] );
+		y = _mm_loadu_ps( xyz[i+1] );
+		z = _mm_loadu_ps( xyz[i+2] );
+		w = _mm_loadu_ps( xyz[i+3] );
+		_MM_TRANSPOSE4_PS( x, y, z, w );
+
+		s = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, distX ), _mm_mul_ps( y, distY ) ), _mm_mul_ps( z, distZ ) ), distW );
+		t = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, depthX ), _mm_mul_ps( y, depthY ) ), _mm_mul_ps( z, depthZ ) ), depthW );
+
+		if ( eyeOutside ) {
+			// cut the distance at the fog plane, in double precision like the scalar code
+			const __m128 e = _mm_sub_ps( t, _mm_set1_ps( eyeT ) );
+			const __m128d scale = _mm_set1_pd( 30.0/32 );
+			const __m128d bias = _mm_set1_pd( 1.0/32 );
+			__m128d lo, hi;
+
+			lo = _mm_add_pd( _mm_div_pd( _mm_mul_pd( scale, _mm_cvtps_pd( t ) ), _mm_cvtps_pd( e ) ), bias );
+			hi = _mm_add_pd( _mm_div_pd( _mm_mul_pd( scale, _mm_cvtps_pd( _mm_movehl_ps( t, t ) ) ), _mm_cvtps_pd( _mm_movehl_ps( e, e ) ) ), bias );
+
+			clip = _mm_cmplt_ps( t, _mm_set1_ps( 1.0f ) );
+			t = _mm_movelh_ps( _mm_cvtpd_ps( lo ), _mm_cvtpd_ps( hi ) );
+			t = _mm_or_ps( _mm_and_ps( clip, outside ), _mm_andnot_ps( clip, t ) );
+		} else {
+			clip = _mm_cmplt_ps( t, _mm_setzero_ps() );
+			t = _mm_or_ps( _mm_and_ps( clip, outside ), _mm_andnot_ps( clip, inside ) );
+		}
+
+		_mm_storeu_ps( st + 0, _mm_unpacklo_ps( s, t ) );
+		_mm_storeu_ps( st + 4, _mm_unpackhi_ps( s, t ) );
+	}
+
+	FogTexCoords_Scalar( st, xyz + i, distance, depth, eyeT, eyeOutside, numVerts - i );
+}
+
+
+static void FogModulate_SSE2( byte *colors, const float *st, int channels, int numVerts ) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 channelMask = _mm_castsi128_ps( _mm_setr_epi32( ( channels & 1 ) ? -1 : 0, ( channels & 2 ) ? -1 : 0, ( channels & 4 ) ? -1 : 0, ( channels & 8 ) ? -1 : 0 ) );
+	int index[4];
+	float factor[4];
+	__m128 a, b, s, t, clip, partial, f;
+	__m128i c, lo, hi;
+	int i, j;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4, st += 8, colors += 16 ) {
+		a = _mm_loadu_ps( st + 0 );
+		b = _mm_loadu_ps( st + 4 );
+		s = _mm_shuffle_ps( a, b, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+		t = _mm_shuffle_ps( a, b, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+
+		// R_FogFactor
+		s = _mm_sub_ps( s, _mm_set1_ps( 1.0f/512 ) );
+		clip = _mm_or_ps( _mm_cmplt_ps( s, _mm_setzero_ps() ), _mm_cmplt_ps( t, _mm_set1_ps( 1.0f/32 ) ) );
+		partial = _mm_cmplt_ps( t, _mm_set1_ps( 31.0f/32 ) );
+		f = _mm_mul_ps( s, _mm_div_ps( _mm_sub_ps( t, _mm_set1_ps( 1.0f/32 ) ), _mm_set1_ps( 30.0f/32 ) ) );
+		s = _mm_or_ps( _mm_and_ps( partial, f ), _mm_andnot_ps( partial, s ) );
+		s = _mm_min_ps( _mm_mul_ps( s, _mm_set1_ps( 8.0f ) ), one );
+		s = _mm_andnot_ps( clip, s );
+		_mm_storeu_si128( (__m128i *)index, _mm_cvttps_epi32( _mm_mul_ps( s, _mm_set1_ps( FOG_TABLE_SIZE-1 ) ) ) );
+		for ( j = 0; j < 4; j++ ) {
+			factor[j] = tr.fogTable[ index[j] ];
+		}
+		f = _mm_sub_ps( one, _mm_andnot_ps( clip, _mm_loadu_ps( factor ) ) );
+
+		c = _mm_loadu_si128( (const __m128i *)colors );
+		lo = _mm_unpacklo_epi8( c, zero );
+		hi = _mm_unpackhi_epi8( c, zero );
+
+#define FOG_SCALE( v, k ) _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( v ), \
+	_mm_or_ps( _mm_and_ps( channelMask, _mm_shuffle_ps( f, f, _MM_SHUFFLE( k, k, k, k ) ) ), _mm_andnot_ps( channelMask, one ) ) ) )
+
+		lo = _mm_packs_epi32( FOG_SCALE( _mm_unpacklo_epi16( lo, zero ), 0 ), FOG_SCALE( _mm_unpackhi_epi16( lo, zero ), 1 ) );
+		hi = _mm_packs_epi32( FOG_SCALE( _mm_unpacklo_epi16( hi, zero ), 2 ), FOG_SCALE( _mm_unpackhi_epi16( hi, zero ), 3 ) );
+
+#undef FOG_SCALE
+
+		_mm_storeu_si128( (__m128i *)colors, _mm_packus_epi16( lo, hi ) );
+	}
+
+	FogModulate_Scalar( colors, st, channels, numVerts - i );
+}
+
+
+static void EnvironmentTexCoords_SSE2( float *st, const vec4_t *xyz, const vec4_t *normal, const float *viewOrigin, int numVerts ) {
+	const __m128 originX = _mm_set1_ps( viewOrigin[0] );
+	const __m128 originY = _mm_set1_ps( viewOrigin[1] );
+	const __m128 originZ = _mm_set1_ps( viewOrigin[2] );
+	const __m128 two = _mm_set1_ps( 2.0f );
+	const __m128 half = _mm_set1_ps( 0.5f );
+	__m128 x, y, z, w, nx, ny, nz, nw, il, d, s, t;
+	int i;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4, st += 8 ) {
+		x = _mm_loadu_ps( xyz[i+0] );
+		y = _mm_loadu_ps( xyz[i+1] );
+		z = _mm_loadu_ps( xyz[i+2] );
+		w = _mm_loadu_ps( xyz[i+3] );
+		_MM_TRANSPOSE4_PS( x, y, z, w );
+
+		nx = _mm_loadu_ps( normal[i+0] );
+		ny = _mm_loadu_ps( normal[i+1] );
+		nz = _mm_loadu_ps( normal[i+2] );
+		nw = _mm_loadu_ps( normal[i+3] );
+		_MM_TRANSPOSE4_PS( nx, ny, nz, nw );
+
+		// viewer
+		x = _mm_sub_ps( originX, x );
+		y = _mm_sub_ps( originY, y );
+		z = _mm_sub_ps( originZ, z );
+
+		il = RSqrt_SSE2( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) );
+		x = _mm_mul_ps( x, il );
+		y = _mm_mul_ps( y, il );
+		z = _mm_mul_ps( z, il );
+
+		d = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, x ), _mm_mul_ps( ny, y ) ), _mm_mul_ps( nz, z ) );
+
+		// reflected
+		y = _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( ny, two ), d ), y );
+		z = _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( nz, two ), d ), z );
+
+		s = _mm_add_ps( half, _mm_mul_ps( y, half ) );
+		t = _mm_sub_ps( half, _mm_mul_ps( z, half ) );
+
+		_mm_storeu_ps( st + 0, _mm_unpacklo_ps( s, t ) );
+		_mm_storeu_ps( st + 4, _mm_unpackhi_ps( s, t ) );
+	}
+
+	EnvironmentTexCoords_Scalar( st, xyz + i, normal + i, viewOrigin, numVerts - i );
+}
+
+
+static void ScaleTexCoords_SSE2( float *dst, const float *src, const float *scale, const float *offset, int numVerts ) {
+	const __m128 s = _mm_setr_ps( scale[0], scale[1], scale[0], scale[1] );
+	const __m128 o = _mm_setr_ps( offset[0], offset[1], offset[0], offset[1] );
+	int i;
+
+	for ( i = 0; i + 2 <= numVerts; i += 2, dst += 4, src += 4 ) {
+		_mm_storeu_ps( dst, _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( src ), s ), o ) );
+	}
+
+	ScaleTexCoords_Scalar( dst, src, scale, offset, numVerts - i );
+}
+
+
+static void TransformTexCoords_SSE2( float *dst, const float *src, const float matrix[2][2], const float *translate, int numVerts ) {
+	const __m128 m0 = _mm_setr_ps( matrix[0][0], matrix[0][1], matrix[0][0], matrix[0][1] );
+	const __m128 m1 = _mm_setr_ps( matrix[1][0], matrix[1][1], matrix[1][0], matrix[1][1] );
+	const __m128 tr = _mm_setr_ps( translate[0], translate[1], translate[0], translate[1] );
+	__m128 v, s, t;
+	int i;
+
+	for ( i = 0; i + 2 <= numVerts; i += 2, dst += 4, src += 4 ) {
+		v = _mm_loadu_ps( src );
+		s = _mm_shuffle_ps( v, v, _MM_SHUFFLE( 2, 2, 0, 0 ) );
+		t = _mm_shuffle_ps( v, v, _MM_SHUFFLE( 3, 3, 1, 1 ) );
+		_mm_storeu_ps( dst, _mm_add_ps( _mm_add_ps( _mm_mul_ps( s, m0 ), _mm_mul_ps( t, m1 ) ), tr ) );
+	}
+
+	TransformTexCoords_Scalar( dst, src, matrix, translate, numVerts - i );
+}
+
+
+static const tessKernels_t sse2Kernels = {
+	"SSE2",
+	LerpMesh_SSE2,
+	DiffuseColor_SSE2,
+	AddScaledNormals_SSE2,
+	FogTexCoords_SSE2,
+	FogModulate_SSE2,
+	EnvironmentTexCoords_SSE2,
+	ScaleTexCoords_SSE2,
+	TransformTexCoords_SSE2
+};
+#endif // TESS_SIMD_SSE2
+
+
+#ifdef TESS_SIMD_AVX2
+/*
+========================================================================
+
+AVX2 kernels
+
+The ones that benefit from gathers or eight lanes, SSE2 for the rest
+
+========================================================================
+*/
+
+static AVX2_FUNC void DecodeNormals_AVX2( const short *xyzNormals, __m256 *x, __m256 *y, __m256 *z ) {
+	const __m256i vertexes = _mm256_setr_epi32( 0, 2, 4, 6, 8, 10, 12, 14 );
+	const __m256i byteMask = _mm256_set1_epi32( 0xff );
+	const __m256i funcMask = _mm256_set1_epi32( FUNCTABLE_MASK );
+	const __m256i quarter = _mm256_set1_epi32( FUNCTABLE_SIZE/4 );
+	__m256i packed, lat, lng;
+	__m256 sinLng;
+
+	// z and the packed normal of each vertex as one int
+	packed = _mm256_i32gather_epi32( (const int *)( xyzNormals + 2 ), vertexes, 4 );
+
+	lat = _mm256_slli_epi32( _mm256_and_si256( _mm256_srli_epi32( packed, 24 ), byteMask ), 2 );
+	lng = _mm256_slli_epi32( _mm256_and_si256( _mm256_srli_epi32( packed, 16 ), byteMask ), 2 );
+
+	sinLng = _mm256_i32gather_ps( tr.sinTable, lng, 4 );
+
+	*x = _mm256_mul_ps( _mm256_i32gather_ps( tr.sinTable, _mm256_and_si256( _mm256_add_epi32( lat, quarter ), funcMask ), 4 ), sinLng );
+	*y = _mm256_mul_ps( _mm256_i32gather_ps( tr.sinTable, lat, 4 ), sinLng );
+	*z = _mm256_i32gather_ps( tr.sinTable, _mm256_and_si256( _mm256_add_epi32( lng, quarter ), funcMask ), 4 );
+}
+
+
+static AVX2_FUNC void LerpMesh_AVX2( vec4_t *xyz, vec4_t *normal, const short *newXyz, const short *oldXyz, const float *scale, int numVerts ) {
+	const __m256 xyzMask = _mm256_castsi256_ps( _mm256_setr_epi32( -1, -1, -1, 0, -1, -1, -1, 0 ) );
+	const __m256 newXyzScale = _mm256_set1_ps( scale[0] );
+	const __m256 oldXyzScale = _mm256_set1_ps( scale[1] );
+	const __m256 newNormalScale = _mm256_set1_ps( scale[2] );
+	const __m256 oldNormalScale = _mm256_set1_ps( scale[3] );
+	const __m256 zero = _mm256_setzero_ps();
+	__m256 v, x, y, z, ox, oy, oz, il, t0, t1, t2, t3;
+	int i, j;
+
+	for ( i = 0; i + 8 <= numVerts; i += 8 ) {
+		// positions, two vertexes per register
+		for ( j = 0; j < 8; j += 2 ) {
+			v = _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i *)( newXyz + ( i + j ) * 4 ) ) ) ), newXyzScale );
+			if ( oldXyz ) {
+				const __m256 o = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i *)( oldXyz + ( i + j ) * 4 ) ) ) );
+				v = _mm256_add_ps( _mm256_mul_ps( o, oldXyzScale ), v );
+			}
+			_mm256_storeu_ps( xyz[i + j], _mm256_and_ps( v, xyzMask ) );
+		}
+
+		// normals, eight at a time
+		DecodeNormals_AVX2( newXyz + i * 4, &x, &y, &z );
+		if ( oldXyz ) {
+			DecodeNormals_AVX2( oldXyz + i * 4, &ox, &oy, &oz );
+			x = _mm256_add_ps( _mm256_mul_ps( ox, oldNormalScale ), _mm256_mul_ps( x, newNormalScale ) );
+			y = _mm256_add_ps( _mm256_mul_ps( oy, oldNormalScale ), _mm256_mul_ps( y, newNormalScale ) );
+			z = _mm256_add_ps( _mm256_mul_ps( oz, oldNormalScale ), _mm256_mul_ps( z, newNormalScale ) );
+
+			il = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, x ), _mm256_mul_ps( y, y ) ), _mm256_mul_ps( z, z ) );
+#ifdef _MSC_SSE2
+			il = _mm256_rsqrt_ps( il );
+#else
+			il = _mm256_div_ps( _mm256_set1_ps( 1.0f ), _mm256_sqrt_ps( il ) );
+#endif
+			x = _mm256_mul_ps( x, il );
+			y = _mm256_mul_ps( y, il );
+			z = _mm256_mul_ps( z, il );
+		}
+
+		// back to one vec4 per vertex, lanes hold vertexes 0-3 and 4-7
+		t0 = _mm256_unpacklo_ps( x, y );
+		t1 = _mm256_unpackhi_ps( x, y );
+		t2 = _mm256_unpacklo_ps( z, zero );
+		t3 = _mm256_unpackhi_ps( z, zero );
+		x = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+		y = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+		z = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+		v = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+
+		_mm256_storeu_ps( normal[i+0], _mm256_permute2f128_ps( x, y, 0x20 ) );
+		_mm256_storeu_ps( normal[i+2], _mm256_permute2f128_ps( z, v, 0x20 ) );
+		_mm256_storeu_ps( normal[i+4], _mm256_permute2f128_ps( x, y, 0x31 ) );
+		_mm256_storeu_ps( normal[i+6], _mm256_permute2f128_ps( z, v, 0x31 ) );
+	}
+
+	LerpMesh_SSE2( xyz + i, normal + i, newXyz + i * 4, oldXyz ? oldXyz + i * 4 : NULL, scale, numVerts - i );
+}
+
+
+static AVX2_FUNC void DiffuseColor_AVX2( byte *colors, const vec4_t *normal, const trRefEntity_t *ent, int numVerts ) {
+	const __m256 lightX = _mm256_set1_ps( ent->lightDir[0] );
+	const __m256 lightY = _mm256_set1_ps( ent->lightDir[1] );
+	const __m256 lightZ = _mm256_set1_ps( ent->lightDir[2] );
+	const __m256 ambientR = _mm256_set1_ps( ent->ambientLight[0] );
+	const __m256 ambientG = _mm256_set1_ps( ent->ambientLight[1] );
+	const __m256 ambientB = _mm256_set1_ps( ent->ambientLight[2] );
+	const __m256 directedR = _mm256_set1_ps( ent->directedLight[0] );
+	const __m256 directedG = _mm256_set1_ps( ent->directedLight[1] );
+	const __m256 directedB = _mm256_set1_ps( ent->directedLight[2] );
+	const __m256i alpha = _mm256_set1_epi32( 255 );
+	// planar r0-3 g0-3 b0-3 a0-3 to interleaved, within each lane
+	const __m256i interleave = _mm256_setr_epi8( 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+		0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 );
+	__m256 x, y, z, w, t0, t1, t2, t3, incoming;
+	__m256i r, g, b, c;
+	int i;
+
+	for ( i = 0; i + 8 <= numVerts; i += 8 ) {
+		x = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( normal[i+0] ) ), _mm_loadu_ps( normal[i+4] ), 1 );
+		y = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( normal[i+1] ) ), _mm_loadu_ps( normal[i+5] ), 1 );
+		z = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( normal[i+2] ) ), _mm_loadu_ps( normal[i+6] ), 1 );
+		w = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( normal[i+3] ) ), _mm_loadu_ps( normal[i+7] ), 1 );
+
+		t0 = _mm256_unpacklo_ps( x, y );
+		t1 = _mm256_unpacklo_ps( z, w );
+		t2 = _mm256_unpackhi_ps( x, y );
+		t3 = _mm256_unpackhi_ps( z, w );
+		x = _mm256_shuffle_ps( t0, t1, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+		y = _mm256_shuffle_ps( t0, t1, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+		z = _mm256_shuffle_ps( t2, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+
+		incoming = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, lightX ), _mm256_mul_ps( y, lightY ) ), _mm256_mul_ps( z, lightZ ) );
+		incoming = _mm256_max_ps( incoming, _mm256_setzero_ps() );
+
+		r = _mm256_cvttps_epi32( _mm256_add_ps( ambientR, _mm256_mul_ps( incoming, directedR ) ) );
+		g = _mm256_cvttps_epi32( _mm256_add_ps( ambientG, _mm256_mul_ps( incoming, directedG ) ) );
+		b = _mm256_cvttps_epi32( _mm256_add_ps( ambientB, _mm256_mul_ps( incoming, directedB ) ) );
+
+		c = _mm256_packus_epi16( _mm256_packs_epi32( r, g ), _mm256_packs_epi32( b, alpha ) );
+		_mm256_storeu_si256( (__m256i *)( colors + i * 4 ), _mm256_shuffle_epi8( c, interleave ) );
+	}
+
+	DiffuseColor_SSE2( colors + i * 4, normal + i, ent, numVerts - i );
+}
+
+
+static AVX2_FUNC void ScaleTexCoords_AVX2( float *dst, const float *src, const float *scale, const float *offset, int numVerts ) {
+	const __m256 s = _mm256_setr_ps( scale[0], scale[1], scale[0], scale[1], scale[0], scale[1], scale[0], scale[1] );
+	const __m256 o = _mm256_setr_ps( offset[0], offset[1], offset[0], offset[1], offset[0], offset[1], offset[0], offset[1] );
+	int i;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4, dst += 8, src += 8 ) {
+		_mm256_storeu_ps( dst, _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( src ), s ), o ) );
+	}
+
+	ScaleTexCoords_SSE2( dst, src, scale, offset, numVerts - i );
+}
+
+
+static AVX2_FUNC void TransformTexCoords_AVX2( float *dst, const float *src, const float matrix[2][2], const float *translate, int numVerts ) {
+	const __m256 m0 = _mm256_setr_ps( matrix[0][0], matrix[0][1], matrix[0][0], matrix[0][1], matrix[0][0], matrix[0][1], matrix[0][0], matrix[0][1] );
+	const __m256 m1 = _mm256_setr_ps( matrix[1][0], matrix[1][1], matrix[1][0], matrix[1][1], matrix[1][0], matrix[1][1], matrix[1][0], matrix[1][1] );
+	const __m256 tr = _mm256_setr_ps( translate[0], translate[1], translate[0], translate[1], translate[0], translate[1], translate[0], translate[1] );
+	__m256 v, s, t;
+	int i;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4, dst += 8, src += 8 ) {
+		v = _mm256_loadu_ps( src );
+		s = _mm256_shuffle_ps( v, v, _MM_SHUFFLE( 2, 2, 0, 0 ) );
+		t = _mm256_shuffle_ps( v, v, _MM_SHUFFLE( 3, 3, 1, 1 ) );
+		_mm256_storeu_ps( dst, _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( s, m0 ), _mm256_mul_ps( t, m1 ) ), tr ) );
+	}
+
+	TransformTexCoords_SSE2( dst, src, matrix, translate, numVerts - i );
+}
+
+
+static const tessKernels_t avx2Kernels = {
+	"AVX2",
+	LerpMesh_AVX2,
+	DiffuseColor_AVX2,
+	AddScaledNormals_SSE2,
+	FogTexCoords_SSE2,
+	FogModulate_SSE2,
+	EnvironmentTexCoords_SSE2,
+	ScaleTexCoords_AVX2,
+	TransformTexCoords_AVX2
+};
+#endif // TESS_SIMD_AVX2
+
+
+#ifdef TESS_SIMD_NEON
+/*
+========================================================================
+
+NEON kernels
+
+Fog stays scalar, it's table lookups with little arithmetic around them
+
+========================================================================
+*/
+
+static ID_INLINE float32x4_t RSqrt_NEON( float32x4_t x ) {
+#if arm64
+	return vdivq_f32( vdupq_n_f32( 1.0f ), vsqrtq_f32( x ) );
+#else
+	float32x4_t e = vrsqrteq_f32( x );
+	e = vmulq_f32( e, vrsqrtsq_f32( vmulq_f32( x, e ), e ) );
+	e = vmulq_f32( e, vrsqrtsq_f32( vmulq_f32( x, e ), e ) );
+	return e;
+#endif
+}
+
+
+static ID_INLINE float32x4_t DecodeNormal_NEON( short packed ) {
+	const unsigned lat = ( ( packed >> 8 ) & 0xff ) * (FUNCTABLE_SIZE/256);
+	const unsigned lng = ( packed & 0xff ) * (FUNCTABLE_SIZE/256);
+	const float sinLng = tr.sinTable[lng];
+	const float a[4] = { tr.sinTable[(lat+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK], tr.sinTable[lat], tr.sinTable[(lng+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK], 0.0f };
+	const float b[4] = { sinLng, sinLng, 1.0f, 0.0f };
+
+	return vmulq_f32( vld1q_f32( a ), vld1q_f32( b ) );
+}
+
+
+static void LerpMesh_NEON( vec4_t *xyz, vec4_t *normal, const short *newXyz, const short *oldXyz, const float *scale, int numVerts ) {
+	static const uint32_t mask[4] = { 0xffffffff, 0xffffffff, 0xffffffff, 0 };
+	const uint32x4_t xyzMask = vld1q_u32( mask );
+	float32x4_t v, n, d;
+	float sq[4];
+	int i;
+
+	for ( i = 0; i < numVerts; i++, newXyz += 4 ) {
+		v = vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vld1_s16( newXyz ) ) ), scale[0] );
+		n = DecodeNormal_NEON( newXyz[3] );
+		if ( oldXyz ) {
+			v = vaddq_f32( vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vld1_s16( oldXyz ) ) ), scale[1] ), v );
+			n = vaddq_f32( vmulq_n_f32( DecodeNormal_NEON( oldXyz[3] ), scale[3] ), vmulq_n_f32( n, scale[2] ) );
+			vst1q_f32( sq, vmulq_f32( n, n ) );
+			d = RSqrt_NEON( vdupq_n_f32( sq[0] + sq[1] + sq[2] ) );
+			n = vmulq_f32( n, d );
+			oldXyz += 4;
+		}
+		vst1q_f32( xyz[i], vreinterpretq_f32_u32( vandq_u32( vreinterpretq_u32_f32( v ), xyzMask ) ) );
+		vst1q_f32( normal[i], n );
+	}
+}
+
+
+static void DiffuseColor_NEON( byte *colors, const vec4_t *normal, const trRefEntity_t *ent, int numVerts ) {
+	const uint32x4_t max = vdupq_n_u32( 255 );
+	float32x4x4_t n;
+	float32x4_t incoming;
+	uint32x4_t r, g, b;
+	int i;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4 ) {
+		n = vld4q_f32( normal[i] );
+
+		incoming = vaddq_f32( vaddq_f32( vmulq_n_f32( n.val[0], ent->lightDir[0] ), vmulq_n_f32( n.val[1], ent->lightDir[1] ) ), vmulq_n_f32( n.val[2], ent->lightDir[2] ) );
+		incoming = vmaxq_f32( incoming, vdupq_n_f32( 0.0f ) );
+
+		r = vminq_u32( vcvtq_u32_f32( vaddq_f32( vdupq_n_f32( ent->ambientLight[0] ), vmulq_n_f32( incoming, ent->directedLight[0] ) ) ), max );
+		g = vminq_u32( vcvtq_u32_f32( vaddq_f32( vdupq_n_f32( ent->ambientLight[1] ), vmulq_n_f32( incoming, ent->directedLight[1] ) ) ), max );
+		b = vminq_u32( vcvtq_u32_f32( vaddq_f32( vdupq_n_f32( ent->ambientLight[2] ), vmulq_n_f32( incoming, ent->directedLight[2] ) ) ), max );
+
+		r = vorrq_u32( vorrq_u32( r, vshlq_n_u32( g, 8 ) ), vorrq_u32( vshlq_n_u32( b, 16 ), vdupq_n_u32( 0xff000000 ) ) );
+		vst1q_u8( colors + i * 4, vreinterpretq_u8_u32( r ) );
+	}
+
+	DiffuseColor_Scalar( colors + i * 4, normal + i, ent, numVerts - i );
+}
+
+
+static void AddScaledNormals_NEON( vec4_t *xyz, const vec4_t *normal, float scale, int numVerts ) {
+	static const uint32_t mask[4] = { 0xffffffff, 0xffffffff, 0xffffffff, 0 };
+	const uint32x4_t xyzMask = vld1q_u32( mask );
+	float32x4_t offset;
+	int i;
+
+	for ( i = 0; i < numVerts; i++ ) {
+		offset = vmulq_n_f32( vld1q_f32( normal[i] ), scale );
+		offset = vreinterpretq_f32_u32( vandq_u32( vreinterpretq_u32_f32( offset ), xyzMask ) );
+		vst1q_f32( xyz[i], vaddq_f32( vld1q_f32( xyz[i] ), offset ) );
+	}
+}
+
+
+static void EnvironmentTexCoords_NEON( float *st, const vec4_t *xyz, const vec4_t *normal, const float *viewOrigin, int numVerts ) {
+	const float32x4_t half = vdupq_n_f32( 0.5f );
+	float32x4x4_t v, n;
+	float32x4x2_t out;
+	float32x4_t x, y, z, il, d;
+	int i;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4, st += 8 ) {
+		v = vld4q_f32( xyz[i] );
+		n = vld4q_f32( normal[i] );
+
+		x = vsubq_f32( vdupq_n_f32( viewOrigin[0] ), v.val[0] );
+		y = vsubq_f32( vdupq_n_f32( viewOrigin[1] ), v.val[1] );
+		z = vsubq_f32( vdupq_n_f32( viewOrigin[2] ), v.val[2] );
+
+		il = RSqrt_NEON( vaddq_f32( vaddq_f32( vmulq_f32( x, x ), vmulq_f32( y, y ) ), vmulq_f32( z, z ) ) );
+		x = vmulq_f32( x, il );
+		y = vmulq_f32( y, il );
+		z = vmulq_f32( z, il );
+
+		d = vaddq_f32( vaddq_f32( vmulq_f32( n.val[0], x ), vmulq_f32( n.val[1], y ) ), vmulq_f32( n.val[2], z ) );
+
+		y = vsubq_f32( vmulq_f32( vmulq_n_f32( n.val[1], 2.0f ), d ), y );
+		z = vsubq_f32( vmulq_f32( vmulq_n_f32( n.val[2], 2.0f ), d ), z );
+
+		out.val[0] = vaddq_f32( half, vmulq_f32( y, half ) );
+		out.val[1] = vsubq_f32( half, vmulq_f32( z, half ) );
+		vst2q_f32( st, out );
+	}
+
+	EnvironmentTexCoords_Scalar( st, xyz + i, normal + i, viewOrigin, numVerts - i );
+}
+
+
+static void ScaleTexCoords_NEON( float *dst, const float *src, const float *scale, const float *offset, int numVerts ) {
+	const float s4[4] = { scale[0], scale[1], scale[0], scale[1] };
+	const float o4[4] = { offset[0], offset[1], offset[0], offset[1] };
+	const float32x4_t s = vld1q_f32( s4 );
+	const float32x4_t o = vld1q_f32( o4 );
+	int i;
+
+	for ( i = 0; i + 2 <= numVerts; i += 2, dst += 4, src += 4 ) {
+		vst1q_f32( dst, vaddq_f32( vmulq_f32( vld1q_f32( src ), s ), o ) );
+	}
+
+	ScaleTexCoords_Scalar( dst, src, scale, offset, numVerts - i );
+}
+
+
+static void TransformTexCoords_NEON( float *dst, const float *src, const float matrix[2][2], const float *translate, int numVerts ) {
+	float32x4x2_t v, out;
+	int i;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4, dst += 8, src += 8 ) {
+		v = vld2q_f32( src );
+		out.val[0] = vaddq_f32( vaddq_f32( vmulq_n_f32( v.val[0], matrix[0][0] ), vmulq_n_f32( v.val[1], matrix[1][0] ) ), vdupq_n_f32( translate[0] ) );
+		out.val[1] = vaddq_f32( vaddq_f32( vmulq_n_f32( v.val[0], matrix[0][1] ), vmulq_n_f32( v.val[1], matrix[1][1] ) ), vdupq_n_f32( translate[1] ) );
+		vst2q_f32( dst, out );
+	}
+
+	TransformTexCoords_Scalar( dst, src, matrix, translate, numVerts - i );
+}
+
+
+static const tessKernels_t neonKernels = {
+	"NEON",
+	LerpMesh_NEON,
+	DiffuseColor_NEON,
+	AddScaledNormals_NEON,
+	FogTexCoords_Scalar,
+	FogModulate_Scalar,
+	EnvironmentTexCoords_NEON,
+	ScaleTexCoords_NEON,
+	TransformTexCoords_NEON
+};
+#endif // TESS_SIMD_NEON
+
+
+static const tessKernels_t *kernels = &scalarKernels;
+static qboolean verifyKernels;
+
+
+/*
+================
+R_InitTessKernels
+
+0 - scalar code, 1 - best available, 2 - no AVX2, 3 - best available, verified
+================
+*/
+void R_InitTessKernels( int mode ) {
+	const int cpuFlags = ri.Com_CPUFlags();
+
+	kernels = &scalarKernels;
+	verifyKernels = qfalse;
+
+	if ( mode <= 0 ) {
+		return;
+	}
+
+#ifdef TESS_SIMD_SSE2
+	if ( cpuFlags & CPU_SSE2 ) {
+		kernels = &sse2Kernels;
+	}
+#endif
+#ifdef TESS_SIMD_AVX2
+	if ( mode != 2 && ( cpuFlags & CPU_AVX2 ) ) {
+		kernels = &avx2Kernels;
+	}
+#endif
+#ifdef TESS_SIMD_NEON
+	kernels = &neonKernels;
+#endif
+
+	if ( mode == 3 ) {
+		ri.Printf( PRINT_ALL, "...verifying %s tessellation kernels against scalar code\n", kernels->name );
+		verifyKernels = qtrue;
+	}
+
+	(void)cpuFlags;
+}
+
+
+/*
+========================================================================
+
+Verification
+
+Outputs are compared after the call, in-place inputs are saved before.
+
+========================================================================
+*/
+
+static vec4_t	verifyXyz[SHADER_MAX_VERTEXES];
+static vec4_t	verifyNormal[SHADER_MAX_VERTEXES];
+static float	verifySt[SHADER_MAX_VERTEXES*2];
+static byte		verifyColors[SHADER_MAX_VERTEXES*4];
+static int		verifyReports;
+
+
+static void RB_VerifyFloats( const char *kernel, const float *out, const float *ref, int stride, int components, int numVerts ) {
+	float diff;
+	int i, j;
+
+	for ( i = 0; i < numVerts; i++, out += stride, ref += stride ) {
+		for ( j = 0; j < components; j++ ) {
+			diff = fabs( out[j] - ref[j] );
+			if ( diff > TESS_VERIFY_EPSILON * ( 1.0f + fabs( ref[j] ) ) || out[j] != out[j] ) {
+				if ( verifyReports < TESS_VERIFY_REPORTS ) {
+					verifyReports++;
+					ri.Printf( PRINT_WARNING, "%s %s: vertex %i[%i] is %f, scalar %f\n", kernels->name, kernel, i, j, out[j], ref[j] );
+				}
+				return;
+			}
+		}
+	}
+}
+
+
+static void RB_VerifyBytes( const char *kernel, const byte *out, const byte *ref, int numVerts ) {
+	int i;
+
+	for ( i = 0; i < numVerts * 4; i++ ) {
+		if ( abs( out[i] - ref[i] ) > 1 ) {
+			if ( verifyReports < TESS_VERIFY_REPORTS ) {
+				verifyReports++;
+				ri.Printf( PRINT_WARNING, "%s %s: vertex %i[%i] is %i, scalar %i\n", kernels->name, kernel, i / 4, i & 3, out[i], ref[i] );
+			}
+			return;
+		}
+	}
+}
+
+
+/*
+========================================================================
+
+Entry points for the backend
+
+========================================================================
+*/
+
+/*
+================
+RB_TessLerpMesh
+
+Interpolates md3 vertexes and normals, oldXyz is NULL when backlerp is 0
+================
+*/
+void RB_TessLerpMesh( vec4_t *xyz, vec4_t *normal, const short *newXyz, const short *oldXyz, float backlerp, int numVerts ) {
+	float scale[4];
+
+	scale[0] = MD3_XYZ_SCALE * (1.0 - backlerp);
+	scale[1] = MD3_XYZ_SCALE * backlerp;
+	scale[2] = 1.0 - backlerp;
+	scale[3] = backlerp;
+
+	kernels->LerpMesh( xyz, normal, newXyz, oldXyz, scale, numVerts );
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		scalarKernels.LerpMesh( verifyXyz, verifyNormal, newXyz, oldXyz, scale, numVerts );
+		RB_VerifyFloats( "LerpMesh xyz", xyz[0], verifyXyz[0], 4, 3, numVerts );
+		RB_VerifyFloats( "LerpMesh normal", normal[0], verifyNormal[0], 4, 3, numVerts );
+	}
+}
+
+
+/*
+================
+RB_TessDiffuseColor
+================
+*/
+void RB_TessDiffuseColor( byte *colors, const vec4_t *normal, const trRefEntity_t *ent, int numVerts ) {
+
+	kernels->DiffuseColor( colors, normal, ent, numVerts );
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		scalarKernels.DiffuseColor( verifyColors, normal, ent, numVerts );
+		RB_VerifyBytes( "DiffuseColor", colors, verifyColors, numVerts );
+	}
+}
+
+
+/*
+================
+RB_TessAddScaledNormals
+================
+*/
+void RB_TessAddScaledNormals( vec4_t *xyz, const vec4_t *normal, float scale, int numVerts ) {
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		Com_Memcpy( verifyXyz, xyz, numVerts * sizeof( vec4_t ) );
+		scalarKernels.AddScaledNormals( verifyXyz, normal, scale, numVerts );
+	}
+
+	kernels->AddScaledNormals( xyz, normal, scale, numVerts );
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		RB_VerifyFloats( "AddScaledNormals", xyz[0], verifyXyz[0], 4, 3, numVerts );
+	}
+}
+
+
+/*
+================
+RB_TessFogTexCoords
+================
+*/
+void RB_TessFogTexCoords( float *st, const vec4_t *xyz, const vec4_t distance, const vec4_t depth, float eyeT, qboolean eyeOutside, int numVerts ) {
+
+	kernels->FogTexCoords( st, xyz, distance, depth, eyeT, eyeOutside, numVerts );
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		scalarKernels.FogTexCoords( verifySt, xyz, distance, depth, eyeT, eyeOutside, numVerts );
+		RB_VerifyFloats( "FogTexCoords", st, verifySt, 2, 2, numVerts );
+	}
+}
+
+
+/*
+================
+RB_TessFogModulate
+
+Scales the color bytes selected by channels (1 = red .. 8 = alpha) with
+the fog factor of the matching fog texture coordinate
+================
+*/
+void RB_TessFogModulate( byte *colors, const float *st, int channels, int numVerts ) {
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		Com_Memcpy( verifyColors, colors, numVerts * 4 );
+		scalarKernels.FogModulate( verifyColors, st, channels, numVerts );
+	}
+
+	kernels->FogModulate( colors, st, channels, numVerts );
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		RB_VerifyBytes( "FogModulate", colors, verifyColors, numVerts );
+	}
+}
+
+
+/*
+================
+RB_TessEnvironmentTexCoords
+================
+*/
+void RB_TessEnvironmentTexCoords( float *st, const vec4_t *xyz, const vec4_t *normal, const vec3_t viewOrigin, int numVerts ) {
+
+	kernels->EnvironmentTexCoords( st, xyz, normal, viewOrigin, numVerts );
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		scalarKernels.EnvironmentTexCoords( verifySt, xyz, normal, viewOrigin, numVerts );
+		RB_VerifyFloats( "EnvironmentTexCoords", st, verifySt, 2, 2, numVerts );
+	}
+}
+
+
+/*
+================
+RB_TessScaleTexCoords
+
+dst = src * scale + offset, src and dst may be the same
+================
+*/
+void RB_TessScaleTexCoords( float *dst, const float *src, const float scale[2], const float offset[2], int numVerts ) {
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		Com_Memcpy( verifySt, src, numVerts * 2 * sizeof( float ) );
+		scalarKernels.ScaleTexCoords( verifySt, verifySt, scale, offset, numVerts );
+	}
+
+	kernels->ScaleTexCoords( dst, src, scale, offset, numVerts );
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		RB_VerifyFloats( "ScaleTexCoords", dst, verifySt, 2, 2, numVerts );
+	}
+}
+
+
+/*
+================
+RB_TessTransformTexCoords
+
+src and dst may be the same
+================
+*/
+void RB_TessTransformTexCoords( float *dst, const float *src, const float matrix[2][2], const float translate[2], int numVerts ) {
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		Com_Memcpy( verifySt, src, numVerts * 2 * sizeof( float ) );
+		scalarKernels.TransformTexCoords( verifySt, verifySt, matrix, translate, numVerts );
+	}
+
+	kernels->TransformTexCoords( dst, src, matrix, translate, numVerts );
+
+	if ( verifyKernels && numVerts <= SHADER_MAX_VERTEXES ) {
+		RB_VerifyFloats( "TransformTexCoords", dst, verifySt, 2, 2, numVerts );
+	}
+}
@@ -78,6 +78,9 @@ void RE_RemapShader(const char *shaderName, const char *newShaderName, const cha
 		return;
 	}
 
+	// the backend reads remappedShader and timeOffset
+	R_FinishRenderThread();
+
 	// remap all the shaders with the given name
 	// even tho they might have different lightmaps
 	COM_StripExtension(shaderName, strippedName, sizeof(strippedName));
@@ -769,6 +772,7 @@ static qboolean ParseStage( shaderStage_t *stage, const char **text )
 				}
 				stage->bundle[0].isVideoMap = qtrue;
 				stage->bundle[0].videoMapHandle = handle;
+				shader.videoMaps |= 1 << handle;
 				stage->bundle[0].image[0] = tr.scratchImage[ handle ];
 			} else {
 				ri.Printf( PRINT_WARNING, "WARNING: could not load '%s' for 'videoMap' keyword in shader '%s'\n", token, shader.name );
@@ -2461,6 +2465,11 @@ static void SortNewShader( void ) {
 	newShader = tr.shaders[ tr.numShaders - 1 ];
 	sort = newShader->sort;
 
+	// shifted indexes would change how the render thread decodes sort keys
+	if ( tr.numShaders > 1 && tr.sortedShaders[ tr.numShaders - 2 ]->sort > sort ) {
+		R_FinishRenderThread();
+	}
+
 	for ( i = tr.numShaders - 2 ; i >= 0 ; i-- ) {
 		if ( tr.sortedShaders[ i ]->sort <= sort ) {
 			break;
@@ -2993,6 +3002,104 @@ static const char *FindShaderInShaderText( const char *shadername ) {
 }
 
 
+/*
+====================
+R_PrefetchSkyImages
+====================
+*/
+static void R_PrefetchSkyImages( const char *box, imgFlags_t flags ) {
+	static const char *suf[6] = {"rt", "bk", "lf", "ft", "up", "dn"};
+	char pathname[MAX_QPATH];
+	int i;
+
+	if ( box[0] && strcmp( box, "-" ) ) {
+		for ( i = 0; i < 6; i++ ) {
+			Com_sprintf( pathname, sizeof( pathname ), "%s_%s.tga", box, suf[i] );
+			R_PrefetchImageFile( pathname, flags );
+		}
+	}
+}
+
+
+/*
+====================
+R_PrefetchShaderImages
+
+Queues the images referenced by a shader script, or the image of
+the same name for implicit shaders, for decoding in the background.
+Conditional blocks are not evaluated so this may queue a few extra.
+Image flags follow ParseShader for the texture cache lookup.
+====================
+*/
+void R_PrefetchShaderImages( const char *name ) {
+	char		strippedName[MAX_QPATH];
+	const char	*text, *token;
+	imgFlags_t	flags, skyFlags;
+	int			depth;
+
+	if ( !r_imagePrefetch->integer || name[0] == '\0' ) {
+		return;
+	}
+
+	COM_StripExtension( name, strippedName, sizeof( strippedName ) );
+
+	// map surfaces are created with mipRawImage
+	flags = IMGFLAG_MIPMAP | IMGFLAG_PICMIP;
+
+	text = FindShaderInShaderText( strippedName );
+	if ( !text ) {
+		R_PrefetchImageFile( name, flags );
+		return;
+	}
+
+	depth = 0;
+	while ( 1 ) {
+		token = COM_ParseExt( &text, qtrue );
+		if ( !token[0] ) {
+			break;
+		}
+		if ( token[0] == '{' ) {
+			depth++;
+		} else if ( token[0] == '}' ) {
+			if ( --depth <= 0 ) {
+				break;
+			}
+		} else if ( !Q_stricmp( token, "nomipmaps" ) ) {
+			flags = IMGFLAG_NONE;
+		} else if ( !Q_stricmp( token, "nopicmip" ) ) {
+			flags &= ~IMGFLAG_PICMIP;
+		} else if ( !Q_stricmp( token, "map" ) ) {
+			token = COM_ParseExt( &text, qfalse );
+			if ( token[0] && token[0] != '$' ) {
+				R_PrefetchImageFile( token, flags );
+			}
+		} else if ( !Q_stricmp( token, "clampmap" ) ) {
+			token = COM_ParseExt( &text, qfalse );
+			if ( token[0] && token[0] != '$' ) {
+				R_PrefetchImageFile( token, flags | IMGFLAG_CLAMPTOEDGE );
+			}
+		} else if ( !Q_stricmp( token, "animMap" ) ) {
+			COM_ParseExt( &text, qfalse ); // frequency
+			while ( 1 ) {
+				token = COM_ParseExt( &text, qfalse );
+				if ( !token[0] ) {
+					break;
+				}
+				R_PrefetchImageFile( token, flags );
+			}
+		} else if ( !Q_stricmp( token, "skyParms" ) ) {
+			skyFlags = r_neatsky->integer ? IMGFLAG_NONE : ( IMGFLAG_MIPMAP | IMGFLAG_PICMIP );
+			R_PrefetchSkyImages( COM_ParseExt( &text, qfalse ), skyFlags | IMGFLAG_CLAMPTOEDGE );
+			COM_ParseExt( &text, qfalse ); // cloudheight
+			R_PrefetchSkyImages( COM_ParseExt( &text, qfalse ), skyFlags );
+			if ( r_neatsky->integer ) {
+				flags = IMGFLAG_NONE;
+			}
+		}
+	}
+}
+
+
 /*
 ==================
 R_FindShaderByName
@@ -3576,6 +3683,8 @@ static void ScanAndLoadShaderFiles( void )
 	char *textEnd;
 	const char *p, *oldp;
 	int shaderTextHashTableSizes[MAX_SHADERTEXT_HASH], hash, size;
+	int extensionOffset;
+	uint64_t cacheKey;
 
 	long sum = 0;
 
@@ -3602,6 +3711,19 @@ static void ScanAndLoadShaderFiles( void )
 		numShaderxFiles = MAX_SHADER_FILES;
 	}
 
+	cacheKey = 0;
+	if ( r_shaderCache->integer ) {
+		cacheKey = R_ShaderCacheKey( shaderFiles, numShaderFiles, shaderxFiles, numShaderxFiles );
+		if ( cacheKey && R_LoadShaderCache( cacheKey, &s_shaderText, &extensionOffset, shaderTextHashTable, MAX_SHADERTEXT_HASH ) ) {
+			s_extensionOffset = s_shaderText + extensionOffset;
+			if ( shaderxFiles )
+				ri.FS_FreeFileList( shaderxFiles );
+			if ( shaderFiles )
+				ri.FS_FreeFileList( shaderFiles );
+			return;
+		}
+	}
+
 	sum = 0;
 	sum += loadShaderBuffers( shaderxFiles, numShaderxFiles, xbuffers );
 	sum += loadShaderBuffers( shaderFiles, numShaderFiles, buffers );
@@ -3681,6 +3803,11 @@ static void ScanAndLoadShaderFiles( void )
 
 		SkipBracedSection(&p, 0);
 	}
+
+	if ( cacheKey ) {
+		R_SaveShaderCache( cacheKey, s_shaderText, textEnd - s_shaderText, s_extensionOffset - s_shaderText,
+			shaderTextHashTable, MAX_SHADERTEXT_HASH );
+	}
 }
 
 
@@ -303,7 +303,7 @@ static void RB_SurfaceTriangles( const srfTriangles_t *srf ) {
 
 #ifdef USE_VBO
 #ifdef USE_LEGACY_DLIGHTS
-	if ( tess.allowVBO && srf->vboItemIndex && !srf->dlightBits ) {
+	if ( tess.allowVBO && srf->vboItemIndex && !srf->dlightBits[ backEnd.smpFrame ] ) {
 #else
 	if ( tess.allowVBO && srf->vboItemIndex ) {
 #endif
@@ -328,7 +328,7 @@ static void RB_SurfaceTriangles( const srfTriangles_t *srf ) {
 	RB_CHECKOVERFLOW( srf->numVerts, srf->numIndexes );
 
 #ifdef USE_LEGACY_DLIGHTS
-	dlightBits = srf->dlightBits;
+	dlightBits = srf->dlightBits[ backEnd.smpFrame ];
 	tess.dlightBits |= dlightBits;
 #endif
 
@@ -661,128 +661,24 @@ static void RB_SurfaceLightningBolt( void ) {
 }
 
 
-/*
-** VectorArrayNormalize
-*
-* The inputs to this routing seem to always be close to length = 1.0 (about 0.6 to 2.0)
-* This means that we don't have to worry about zero length or enormously long vectors.
-*/
-static void VectorArrayNormalize(vec4_t *normals, unsigned int count)
-{
-//    assert(count);
-	// given the input, it's safe to call VectorNormalizeFast
-    while ( count-- ) {
-        VectorNormalizeFast(normals[0]);
-        normals++;
-    }
-}
-
-
 /*
 ** LerpMeshVertexes
 */
-static void LerpMeshVertexes_scalar(md3Surface_t *surf, float backlerp)
+static void LerpMeshVertexes( const md3Surface_t *surf, float backlerp )
 {
-	short	*oldXyz, *newXyz, *oldNormals, *newNormals;
-	float	*outXyz, *outNormal;
-	float	oldXyzScale, newXyzScale;
-	float	oldNormalScale, newNormalScale;
-	int		vertNum;
-	unsigned lat, lng;
-	int		numVerts;
-
-	outXyz = tess.xyz[tess.numVertexes];
-	outNormal = tess.normal[tess.numVertexes];
-
-	newXyz = (short *)((byte *)surf + surf->ofsXyzNormals)
-		+ (backEnd.currentEntity->e.frame * surf->numVerts * 4);
-	newNormals = newXyz + 3;
+	const short *oldXyz, *newXyz;
 
-	newXyzScale = MD3_XYZ_SCALE * (1.0 - backlerp);
-	newNormalScale = 1.0 - backlerp;
-
-	numVerts = surf->numVerts;
+	newXyz = (const short *)((const byte *)surf + surf->ofsXyzNormals)
+		+ (backEnd.currentEntity->e.frame * surf->numVerts * 4);
 
 	if ( backlerp == 0 ) {
-		//
-		// just copy the vertexes
-		//
-		for (vertNum=0 ; vertNum < numVerts ; vertNum++,
-			newXyz += 4, newNormals += 4,
-			outXyz += 4, outNormal += 4) 
-		{
-
-			outXyz[0] = newXyz[0] * newXyzScale;
-			outXyz[1] = newXyz[1] * newXyzScale;
-			outXyz[2] = newXyz[2] * newXyzScale;
-
-			lat = ( newNormals[0] >> 8 ) & 0xff;
-			lng = ( newNormals[0] & 0xff );
-			lat *= (FUNCTABLE_SIZE/256);
-			lng *= (FUNCTABLE_SIZE/256);
-
-			// decode X as cos( lat ) * sin( long )
-			// decode Y as sin( lat ) * sin( long )
-			// decode Z as cos( long )
-
-			outNormal[0] = tr.sinTable[(lat+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK] * tr.sinTable[lng];
-			outNormal[1] = tr.sinTable[lat] * tr.sinTable[lng];
-			outNormal[2] = tr.sinTable[(lng+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK];
-		}
+		oldXyz = NULL;
 	} else {
-		//
-		// interpolate and copy the vertex and normal
-		//
-		oldXyz = (short *)((byte *)surf + surf->ofsXyzNormals)
+		oldXyz = (const short *)((const byte *)surf + surf->ofsXyzNormals)
 			+ (backEnd.currentEntity->e.oldframe * surf->numVerts * 4);
-		oldNormals = oldXyz + 3;
-
-		oldXyzScale = MD3_XYZ_SCALE * backlerp;
-		oldNormalScale = backlerp;
-
-		for (vertNum=0 ; vertNum < numVerts ; vertNum++,
-			oldXyz += 4, newXyz += 4, oldNormals += 4, newNormals += 4,
-			outXyz += 4, outNormal += 4) 
-		{
-			vec3_t uncompressedOldNormal, uncompressedNewNormal;
-
-			// interpolate the xyz
-			outXyz[0] = oldXyz[0] * oldXyzScale + newXyz[0] * newXyzScale;
-			outXyz[1] = oldXyz[1] * oldXyzScale + newXyz[1] * newXyzScale;
-			outXyz[2] = oldXyz[2] * oldXyzScale + newXyz[2] * newXyzScale;
-
-			// FIXME: interpolate lat/long instead?
-			lat = ( newNormals[0] >> 8 ) & 0xff;
-			lng = ( newNormals[0] & 0xff );
-			lat *= 4;
-			lng *= 4;
-			uncompressedNewNormal[0] = tr.sinTable[(lat+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK] * tr.sinTable[lng];
-			uncompressedNewNormal[1] = tr.sinTable[lat] * tr.sinTable[lng];
-			uncompressedNewNormal[2] = tr.sinTable[(lng+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK];
-
-			lat = ( oldNormals[0] >> 8 ) & 0xff;
-			lng = ( oldNormals[0] & 0xff );
-			lat *= 4;
-			lng *= 4;
-
-			uncompressedOldNormal[0] = tr.sinTable[(lat+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK] * tr.sinTable[lng];
-			uncompressedOldNormal[1] = tr.sinTable[lat] * tr.sinTable[lng];
-			uncompressedOldNormal[2] = tr.sinTable[(lng+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK];
-
-			outNormal[0] = uncompressedOldNormal[0] * oldNormalScale + uncompressedNewNormal[0] * newNormalScale;
-			outNormal[1] = uncompressedOldNormal[1] * oldNormalScale + uncompressedNewNormal[1] * newNormalScale;
-			outNormal[2] = uncompressedOldNormal[2] * oldNormalScale + uncompressedNewNormal[2] * newNormalScale;
-
-//			VectorNormalize (outNormal);
-		}
-    	VectorArrayNormalize((vec4_t *)tess.normal[tess.numVertexes], numVerts);
-   	}
-}
-
+	}
 
-static void LerpMeshVertexes(md3Surface_t *surf, float backlerp)
-{
-	LerpMeshVertexes_scalar( surf, backlerp );
+	RB_TessLerpMesh( tess.xyz + tess.numVertexes, tess.normal + tess.numVertexes, newXyz, oldXyz, backlerp, surf->numVerts );
 }
 
 
@@ -802,6 +698,10 @@ static void RB_SurfaceMesh(md3Surface_t *surface) {
 
 #ifdef USE_VBO
 	VBO_Flush();
+
+	if ( r_vboModels->integer && VBO_DrawMD3( surface ) ) {
+		return;
+	}
 #endif
 
 	RB_CHECKOVERFLOW( surface->numVerts, surface->numTriangles * 3 );
@@ -859,7 +759,7 @@ static void RB_SurfaceFace( const srfSurfaceFace_t *surf ) {
 
 #ifdef USE_VBO
 #ifdef USE_LEGACY_DLIGHTS
-	if ( tess.allowVBO && surf->vboItemIndex && !surf->dlightBits ) {
+	if ( tess.allowVBO && surf->vboItemIndex && !surf->dlightBits[ backEnd.smpFrame ] ) {
 #else
 	if ( tess.allowVBO && surf->vboItemIndex ) {
 #endif
@@ -886,7 +786,7 @@ static void RB_SurfaceFace( const srfSurfaceFace_t *surf ) {
 	tess.surfType = SF_FACE;
 
 #ifdef USE_LEGACY_DLIGHTS
-	dlightBits = surf->dlightBits;
+	dlightBits = surf->dlightBits[ backEnd.smpFrame ];
 	tess.dlightBits |= dlightBits;
 #endif
 
@@ -1063,7 +963,7 @@ static void RB_SurfaceGrid( srfGridMesh_t *cv ) {
 
 #ifdef USE_VBO
 #ifdef USE_LEGACY_DLIGHTS
-	if ( tess.allowVBO && cv->vboItemIndex && !cv->dlightBits ) {
+	if ( tess.allowVBO && cv->vboItemIndex && !cv->dlightBits[ backEnd.smpFrame ] ) {
 #else
 	if ( tess.allowVBO && cv->vboItemIndex ) {
 #endif
@@ -1086,7 +986,7 @@ static void RB_SurfaceGrid( srfGridMesh_t *cv ) {
 #endif // USE_VBO
 
 #ifdef USE_LEGACY_DLIGHTS
-	dlightBits = cv->dlightBits;
+	dlightBits = cv->dlightBits[ backEnd.smpFrame ];
 	tess.dlightBits |= dlightBits;
 #endif
 
@@ -1548,4 +1548,920 @@ void RB_StageIteratorVBO( void )
 	VBO_ClearQueue();
 }
 
+
+/*
+=============================================================
+
+MODEL VBO
+
+MD3 frames and IQM bind-pose vertexes are uploaded once, on the first
+draw of each surface. The vertex program then interpolates between the
+two md3 frames or blends up to four IQM joint matrices passed as program
+locals, so animated models no longer need tesselation on the CPU.
+
+Only shaders whose colors and texture coordinates are uniform over the
+surface (or lighting diffuse / environment mapped) are handled here,
+per-stage rgbGen/alphaGen/tcMod values are evaluated once per draw on
+the CPU and everything else falls back to regular tesselation.
+
+=============================================================
+*/
+
+#define MAX_MODEL_VBOS			2048	// must be a power of two
+#define MAX_MODEL_JOINT_SLOTS	16384
+
+// vertex program locals
+#define MVP_VIEW_ORIGIN		0
+#define MVP_LERP			1	// new/old xyz and normal scales
+// 2..4 - fog parameters
+#define MVP_COLOR			5	// constant color or ambient light
+#define MVP_DIRECTED		6
+#define MVP_LIGHT_DIR		7
+#define MVP_TEX_MATRIX		8	// s and t rows
+#define MVP_JOINTS			12	// three rows per joint slot
+
+#define MD3_VBO_VERTEX_SIZE	16	// short xyz[3], pad, short normal[3], pad
+
+typedef struct modelVBO_s {
+	const void	*surface;
+	GLuint		vbo;
+	GLuint		ibo;
+	qboolean	failed;			// can't be drawn with vertex programs
+	int			numVertexes;
+	int			numIndexes;
+	int			frameSize;		// md3: bytes per frame
+	int			normalOffset;	// iqm
+	int			stOffset;
+	int			indexOffset;	// iqm: blend slots, premultiplied by 3
+	int			weightOffset;	// iqm
+	int			numSlots;		// iqm: joint slots including identity
+	const short	*slotJoints;	// iqm: joint per slot, -1 for identity
+} modelVBO_t;
+
+static modelVBO_t model_vbos[ MAX_MODEL_VBOS ];
+static int model_vbo_count;
+
+static short model_slots[ MAX_MODEL_JOINT_SLOTS ];
+static int model_slot_count;
+
+// skinned, lighting diffuse, environment mapping
+static GLuint model_vp[2][2][2];
+// skinned, eye-in/eye-out
+static GLuint model_fog_vp[2][2];
+static qboolean model_vp_failed;
+
+static int model_max_slots;
+
+// upload staging, large enough for one md3 frame or any iqm vertex stream
+static vec4_t model_staging[ SHADER_MAX_VERTEXES ];
+static glIndex_t model_staging_indexes[ SHADER_MAX_INDEXES ];
+
+
+static void AppendModelFogVP( char *buf, const char *code )
+{
+	char *out;
+
+	// shared fog code reads vertex.position, we have animated position in a temporary
+	out = buf + strlen( buf );
+	while ( *code ) {
+		if ( !strncmp( code, "vertex.position", 15 ) ) {
+			strcpy( out, "pos" );
+			out += 3;
+			code += 15;
+		} else {
+			*out++ = *code++;
+		}
+	}
+	*out = '\0';
+}
+
+
+static const char *BuildModelVP( int skinned, int lighting, int texgen, int fogMode )
+{
+	static char buf[4096];
+
+	strcpy( buf,
+	"!!ARBvp1.0 \n"
+	"PARAM mvpMatrix[4] = { state.matrix.mvp }; \n"
+	"TEMP pos, nrm; \n" );
+
+	if ( skinned ) {
+		// blend joint matrices, normal matrix is the transpose of the adjoint
+		sprintf( buf + strlen( buf ),
+		"PARAM joints[%i] = { program.local[%i..%i] }; \n",
+		model_max_slots * 3, MVP_JOINTS, MVP_JOINTS + model_max_slots * 3 - 1 );
+		strcat( buf,
+		"ATTRIB blendSlot = vertex.texcoord[1]; \n"
+		"ATTRIB blendWeight = vertex.texcoord[2]; \n"
+		"ADDRESS a; \n"
+		"TEMP m0, m1, m2, c; \n"
+		"ARL a.x, blendSlot.x; \n"
+		"MUL m0, joints[a.x], blendWeight.x; \n"
+		"MUL m1, joints[a.x+1], blendWeight.x; \n"
+		"MUL m2, joints[a.x+2], blendWeight.x; \n"
+		"ARL a.x, blendSlot.y; \n"
+		"MAD m0, joints[a.x], blendWeight.y, m0; \n"
+		"MAD m1, joints[a.x+1], blendWeight.y, m1; \n"
+		"MAD m2, joints[a.x+2], blendWeight.y, m2; \n"
+		"ARL a.x, blendSlot.z; \n"
+		"MAD m0, joints[a.x], blendWeight.z, m0; \n"
+		"MAD m1, joints[a.x+1], blendWeight.z, m1; \n"
+		"MAD m2, joints[a.x+2], blendWeight.z, m2; \n"
+		"ARL a.x, blendSlot.w; \n"
+		"MAD m0, joints[a.x], blendWeight.w, m0; \n"
+		"MAD m1, joints[a.x+1], blendWeight.w, m1; \n"
+		"MAD m2, joints[a.x+2], blendWeight.w, m2; \n"
+		"DPH pos.x, vertex.position, m0; \n"
+		"DPH pos.y, vertex.position, m1; \n"
+		"DPH pos.z, vertex.position, m2; \n"
+		"MOV pos.w, 1.0; \n"
+		"XPD c, m1, m2; \n"
+		"DP3 nrm.x, c, vertex.normal; \n"
+		"XPD c, m2, m0; \n"
+		"DP3 nrm.y, c, vertex.normal; \n"
+		"XPD c, m0, m1; \n"
+		"DP3 nrm.z, c, vertex.normal; \n" );
+	} else {
+		// interpolate md3 frames, old frame is bound to texcoord[1] and texcoord[2]
+		strcat( buf,
+		"PARAM lerp = program.local[1]; \n"
+		"MUL pos.xyz, vertex.position, lerp.x; \n"
+		"MAD pos.xyz, vertex.texcoord[1], lerp.y, pos; \n"
+		"MOV pos.w, 1.0; \n"
+		"MUL nrm.xyz, vertex.normal, lerp.z; \n"
+		"MAD nrm.xyz, vertex.texcoord[2], lerp.w, nrm; \n"
+		"DP3 nrm.w, nrm, nrm; \n"
+		"RSQ nrm.w, nrm.w; \n"
+		"MUL nrm.xyz, nrm, nrm.w; \n" );
+	}
+
+	strcat( buf,
+	"DP4 result.position.x, mvpMatrix[0], pos; \n"
+	"DP4 result.position.y, mvpMatrix[1], pos; \n"
+	"DP4 result.position.z, mvpMatrix[2], pos; \n"
+	"DP4 result.position.w, mvpMatrix[3], pos; \n" );
+
+	if ( fogMode != VP_FOG_NONE ) {
+		// fog-only pass
+		if ( fogMode == VP_FOG_EYE_IN )
+			AppendModelFogVP( buf, fogInVPCode );
+		else
+			AppendModelFogVP( buf, fogOutVPCode );
+		strcat( buf, "END \n" );
+		return buf;
+	}
+
+	if ( lighting ) {
+		// RB_CalcDiffuseColor
+		strcat( buf,
+		"TEMP d; \n"
+		"DP3 d.x, nrm, program.local[7]; \n"
+		"MAX d.x, d.x, 0.0; \n"
+		"MAD result.color, d.x, program.local[6], program.local[5]; \n" );
+	} else {
+		strcat( buf, "MOV result.color, program.local[5]; \n" );
+	}
+
+	strcat( buf, "TEMP tc; \n" );
+
+	if ( texgen ) {
+		// RB_CalcEnvironmentTexCoords
+		strcat( buf,
+		"TEMP viewer, e; \n"
+		"SUB viewer, program.local[0], pos; \n"
+		"DP3 viewer.w, viewer, viewer; \n"
+		"RSQ viewer.w, viewer.w; \n"
+		"MUL viewer.xyz, viewer.w, viewer; \n"
+		"DP3 e, nrm, viewer; \n"
+		"MUL e, e, 2.0; \n"
+		"MAD e, nrm, e, -viewer; \n"
+		"PARAM m = { 0.0, 0.5, -0.5, 0.0 }; \n"
+		"MAD e, e, m, 0.5; \n"
+		"MOV tc.xy, e.yzww; \n" );
+	} else {
+		strcat( buf, "MOV tc.xy, vertex.texcoord[0]; \n" );
+	}
+
+	// affine tcMods
+	strcat( buf,
+	"MOV tc.z, 1.0; \n"
+	"DP3 result.texcoord[0].x, tc, program.local[8]; \n"
+	"DP3 result.texcoord[0].y, tc, program.local[9]; \n"
+	"MOV result.texcoord[0].zw, {0.0, 0.0, 0.0, 1.0}; \n"
+	"END \n" );
+
+	return buf;
+}
+
+
+static GLuint CompileModelVP( GLuint *prog, int skinned, int lighting, int texgen, int fogMode )
+{
+	if ( *prog == 0 && !model_vp_failed )
+	{
+		qglGenProgramsARB( 1, prog );
+		if ( !ARB_CompileProgram( Vertex, BuildModelVP( skinned, lighting, texgen, fogMode ), *prog ) )
+		{
+			model_vp_failed = qtrue;
+		}
+	}
+
+	return model_vp_failed ? 0 : *prog;
+}
+
+
+static qboolean isModelStage( const shaderStage_t *stage )
+{
+	const textureBundle_t *bundle = &stage->bundle[0];
+	int i;
+
+	if ( stage->mtEnv || stage->depthFragment )
+		return qfalse;
+
+	if ( bundle->tcGen != TCGEN_TEXTURE && bundle->tcGen != TCGEN_ENVIRONMENT_MAPPED )
+		return qfalse;
+
+	// everything else is affine in (s,t)
+	for ( i = 0; i < bundle->numTexMods; i++ ) {
+		if ( bundle->texMods[i].type == TMOD_TURBULENT )
+			return qfalse;
+	}
+
+	switch ( stage->rgbGen ) {
+		case CGEN_EXACT_VERTEX:
+		case CGEN_VERTEX:
+		case CGEN_ONE_MINUS_VERTEX:
+		case CGEN_FOG:
+			return qfalse;
+		default:
+			break;
+	}
+
+	switch ( stage->alphaGen ) {
+		case AGEN_VERTEX:
+		case AGEN_ONE_MINUS_VERTEX:
+		case AGEN_LIGHTING_SPECULAR:
+		case AGEN_PORTAL:
+			return qfalse;
+		default:
+			break;
+	}
+
+	if ( tess.fogNum && stage->adjustColorsForFog != ACFF_NONE )
+		return qfalse;
+
+	return qtrue;
+}
+
+
+static qboolean isModelSurface( void )
+{
+	const shader_t *shader = tess.shader;
+	int i;
+
+	if ( model_vp_failed || !GL_ProgramAvailable() || !qglBindBufferARB || glConfig.numTextureUnits < 3 )
+		return qfalse;
+
+#ifdef USE_PMLIGHT
+	if ( tess.dlightPass || backEnd.currentEntity->litSurfs )
+		return qfalse;
+#endif
+
+	if ( r_showtris->integer || r_shownormals->integer )
+		return qfalse;
+
+	// user clip planes are undefined without position-invariant programs
+	if ( backEnd.viewParms.portalView != PV_NONE )
+		return qfalse;
+
+	if ( shader == tr.shadowShader || shader->isSky || shader->numDeforms )
+		return qfalse;
+
+	if ( shader->optimalStageIteratorFunc != RB_StageIteratorGeneric )
+		return qfalse;
+
+	for ( i = 0; i < MAX_SHADER_STAGES; i++ ) {
+		if ( !tess.xstages[i] )
+			break;
+		if ( !isModelStage( tess.xstages[i] ) )
+			return qfalse;
+	}
+
+	return qtrue;
+}
+
+
+static modelVBO_t *VBO_FindModel( const void *surface )
+{
+	modelVBO_t *mv;
+	unsigned int hash;
+
+	hash = (unsigned int)( (uintptr_t)surface >> 4 ) * 2654435761U;
+	hash &= MAX_MODEL_VBOS - 1;
+
+	for ( ;; ) {
+		mv = &model_vbos[ hash ];
+		if ( mv->surface == surface )
+			return mv;
+		if ( mv->surface == NULL )
+			break;
+		hash = ( hash + 1 ) & ( MAX_MODEL_VBOS - 1 );
+	}
+
+	// keep the table sparse for short probes
+	if ( model_vbo_count >= MAX_MODEL_VBOS * 3 / 4 )
+		return NULL;
+
+	Com_Memset( mv, 0, sizeof( *mv ) );
+	mv->surface = surface;
+	model_vbo_count++;
+
+	return mv;
+}
+
+
+static void VBO_CreateModelBuffers( modelVBO_t *mv, int vertexBytes, const glIndex_t *indexes )
+{
+	qglGenBuffersARB( 1, &mv->vbo );
+	qglGenBuffersARB( 1, &mv->ibo );
+
+	qglBindBufferARB( GL_ARRAY_BUFFER_ARB, mv->vbo );
+	qglBufferDataARB( GL_ARRAY_BUFFER_ARB, vertexBytes, NULL, GL_STATIC_DRAW_ARB );
+
+	qglBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, mv->ibo );
+	qglBufferDataARB( GL_ELEMENT_ARRAY_BUFFER_ARB, mv->numIndexes * sizeof( glIndex_t ), indexes, GL_STATIC_DRAW_ARB );
+
+	curr_vertex_bind = mv->vbo;
+	curr_index_bind = mv->ibo;
+}
+
+
+static void VBO_UploadMD3( modelVBO_t *mv, const md3Surface_t *surf )
+{
+	const short *xyz;
+	short *out;
+	unsigned lat, lng;
+	int f, i;
+
+	mv->numVertexes = surf->numVerts;
+	mv->numIndexes = surf->numTriangles * 3;
+
+	if ( mv->numVertexes > SHADER_MAX_VERTEXES || mv->numIndexes > SHADER_MAX_INDEXES || surf->numFrames <= 0 ) {
+		mv->failed = qtrue;
+		return;
+	}
+
+	mv->frameSize = mv->numVertexes * MD3_VBO_VERTEX_SIZE;
+	mv->stOffset = surf->numFrames * mv->frameSize;
+
+	// md3 triangles are already zero-based int indexes
+	VBO_CreateModelBuffers( mv, mv->stOffset + mv->numVertexes * sizeof( vec2_t ),
+		(const glIndex_t *)((const byte *)surf + surf->ofsTriangles) );
+
+	xyz = (const short *)((const byte *)surf + surf->ofsXyzNormals);
+	for ( f = 0; f < surf->numFrames; f++ ) {
+		out = (short *)model_staging;
+		for ( i = 0; i < mv->numVertexes; i++, xyz += 4, out += 8 ) {
+			out[0] = xyz[0];
+			out[1] = xyz[1];
+			out[2] = xyz[2];
+			out[3] = 0;
+
+			// same decoding as LerpMeshVertexes, stored as normalized shorts
+			lat = ( ( xyz[3] >> 8 ) & 0xff ) * ( FUNCTABLE_SIZE / 256 );
+			lng = ( xyz[3] & 0xff ) * ( FUNCTABLE_SIZE / 256 );
+			out[4] = (short)( tr.sinTable[(lat+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK] * tr.sinTable[lng] * 32767.0f );
+			out[5] = (short)( tr.sinTable[lat] * tr.sinTable[lng] * 32767.0f );
+			out[6] = (short)( tr.sinTable[(lng+(FUNCTABLE_SIZE/4))&FUNCTABLE_MASK] * 32767.0f );
+			out[7] = 0;
+		}
+		qglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, f * mv->frameSize, mv->frameSize, model_staging );
+	}
+
+	qglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, mv->stOffset, mv->numVertexes * sizeof( vec2_t ),
+		(const byte *)surf + surf->ofsSt );
+}
+
+
+static void VBO_UploadIQM( modelVBO_t *mv, const srfIQModel_t *surf )
+{
+	const iqmData_t *data = surf->data;
+	short slotOf[ IQM_MAX_JOINTS ];
+	short *slots, *outSlot;
+	float *outWeight;
+	float weights[4];
+	int numJoints, identity;
+	int i, j, influence;
+	const byte *blendIndexes;
+	const int *tri;
+
+	mv->numVertexes = surf->num_vertexes;
+	mv->numIndexes = surf->num_triangles * 3;
+
+	if ( mv->numVertexes > SHADER_MAX_VERTEXES || mv->numIndexes > SHADER_MAX_INDEXES || model_max_slots <= 0 || model_slot_count >= MAX_MODEL_JOINT_SLOTS ) {
+		mv->failed = qtrue;
+		return;
+	}
+
+	// remap referenced joints to consecutive slots, identity goes last
+	slots = model_slots + model_slot_count;
+	numJoints = 0;
+	Com_Memset( slotOf, -1, sizeof( slotOf ) );
+
+	if ( data->num_poses > 0 ) {
+		for ( i = 0; i < surf->num_influences; i++ ) {
+			influence = surf->first_influence + i;
+			for ( j = 0; j < 4; j++ ) {
+				if ( data->blendWeightsType == IQM_FLOAT ) {
+					if ( data->influenceBlendWeights.f[4*influence + j] <= 0.0f )
+						break;
+				} else {
+					if ( data->influenceBlendWeights.b[4*influence + j] == 0 )
+						break;
+				}
+				if ( slotOf[ data->influenceBlendIndexes[4*influence + j] ] < 0 ) {
+					if ( model_slot_count + numJoints >= MAX_MODEL_JOINT_SLOTS - 1 ) {
+						mv->failed = qtrue;
+						return;
+					}
+					slotOf[ data->influenceBlendIndexes[4*influence + j] ] = numJoints;
+					slots[ numJoints++ ] = data->influenceBlendIndexes[4*influence + j];
+				}
+			}
+		}
+	}
+
+	identity = numJoints;
+	slots[ identity ] = -1;
+	mv->numSlots = numJoints + 1;
+
+	if ( mv->numSlots > model_max_slots ) {
+		mv->failed = qtrue;
+		return;
+	}
+
+	mv->slotJoints = slots;
+	model_slot_count += mv->numSlots;
+
+	mv->normalOffset = mv->numVertexes * 3 * sizeof( float );
+	mv->stOffset = mv->normalOffset * 2;
+	mv->indexOffset = mv->stOffset + mv->numVertexes * sizeof( vec2_t );
+	mv->weightOffset = mv->indexOffset + mv->numVertexes * 4 * sizeof( short );
+
+	tri = data->triangles + 3 * surf->first_triangle;
+	for ( i = 0; i < mv->numIndexes; i++ ) {
+		model_staging_indexes[i] = tri[i] - surf->first_vertex;
+	}
+
+	VBO_CreateModelBuffers( mv, mv->weightOffset + mv->numVertexes * sizeof( vec4_t ), model_staging_indexes );
+
+	qglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, 0, mv->normalOffset, &data->positions[surf->first_vertex * 3] );
+	qglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, mv->normalOffset, mv->normalOffset, &data->normals[surf->first_vertex * 3] );
+	qglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, mv->stOffset, mv->numVertexes * sizeof( vec2_t ), &data->texcoords[surf->first_vertex * 2] );
+
+	// blend slots and weights, same rules as RB_IQMSurfaceAnim
+	outSlot = (short *)model_staging;
+	for ( i = 0; i < mv->numVertexes; i++, outSlot += 4 ) {
+		if ( data->num_poses > 0 ) {
+			influence = data->influences[surf->first_vertex + i];
+			blendIndexes = &data->influenceBlendIndexes[4*influence];
+			for ( j = 0; j < 4; j++ ) {
+				if ( data->blendWeightsType == IQM_FLOAT )
+					weights[j] = data->influenceBlendWeights.f[4*influence + j];
+				else
+					weights[j] = (float)data->influenceBlendWeights.b[4*influence + j] / 255.0f;
+			}
+		} else {
+			blendIndexes = NULL;
+			weights[0] = 0.0f;
+		}
+		if ( weights[0] <= 0.0f ) {
+			outSlot[0] = outSlot[1] = outSlot[2] = outSlot[3] = identity * 3;
+			continue;
+		}
+		outSlot[0] = slotOf[ blendIndexes[0] ] * 3;
+		for ( j = 1; j < 4; j++ ) {
+			if ( weights[j] <= 0.0f )
+				break;
+			outSlot[j] = slotOf[ blendIndexes[j] ] * 3;
+		}
+		for ( ; j < 4; j++ ) {
+			outSlot[j] = outSlot[0];
+		}
+	}
+	qglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, mv->indexOffset, mv->numVertexes * 4 * sizeof( short ), model_staging );
+
+	outWeight = (float *)model_staging;
+	for ( i = 0; i < mv->numVertexes; i++, outWeight += 4 ) {
+		if ( data->num_poses > 0 ) {
+			influence = data->influences[surf->first_vertex + i];
+			for ( j = 0; j < 4; j++ ) {
+				if ( data->blendWeightsType == IQM_FLOAT )
+					outWeight[j] = data->influenceBlendWeights.f[4*influence + j];
+				else
+					outWeight[j] = (float)data->influenceBlendWeights.b[4*influence + j] / 255.0f;
+			}
+		} else {
+			outWeight[0] = 0.0f;
+		}
+		if ( outWeight[0] <= 0.0f ) {
+			outWeight[0] = 1.0f;
+			outWeight[1] = outWeight[2] = outWeight[3] = 0.0f;
+			continue;
+		}
+		for ( j = 1; j < 4; j++ ) {
+			if ( outWeight[j] <= 0.0f )
+				break;
+		}
+		for ( ; j < 4; j++ ) {
+			outWeight[j] = 0.0f;
+		}
+	}
+	qglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, mv->weightOffset, mv->numVertexes * sizeof( vec4_t ), model_staging );
+}
+
+
+static void VBO_ModelStageColor( const shaderStage_t *pStage, vec4_t color, vec4_t directed )
+{
+	// evaluate uniform rgbGen/alphaGen on a single vertex
+	tess.numVertexes = 1;
+	VectorClear( tess.normal[0] );
+	R_ComputeColors( pStage );
+	tess.numVertexes = 0;
+
+	if ( pStage->rgbGen == CGEN_LIGHTING_DIFFUSE ) {
+		VectorScale( backEnd.currentEntity->ambientLight, 1.0f / 255.0f, color );
+		VectorScale( backEnd.currentEntity->directedLight, 1.0f / 255.0f, directed );
+	} else {
+		color[0] = tess.svars.colors[0].rgba[0] * ( 1.0f / 255.0f );
+		color[1] = tess.svars.colors[0].rgba[1] * ( 1.0f / 255.0f );
+		color[2] = tess.svars.colors[0].rgba[2] * ( 1.0f / 255.0f );
+		VectorClear( directed );
+	}
+	color[3] = tess.svars.colors[0].rgba[3] * ( 1.0f / 255.0f );
+	directed[3] = 0.0f;
+}
+
+
+static void VBO_ModelStageTexMatrix( const textureBundle_t *bundle, vec4_t s, vec4_t t )
+{
+	textureBundle_t b;
+	const vec2_t *st;
+
+	// tcMods are affine, so three points are enough to recover them
+	b = *bundle;
+	b.tcGen = TCGEN_TEXTURE;
+
+	tess.texCoords[0][0][0] = 0.0f; tess.texCoords[0][0][1] = 0.0f;
+	tess.texCoords[0][1][0] = 1.0f; tess.texCoords[0][1][1] = 0.0f;
+	tess.texCoords[0][2][0] = 0.0f; tess.texCoords[0][2][1] = 1.0f;
+
+	tess.numVertexes = 3;
+	R_ComputeTexCoords( 0, &b );
+	tess.numVertexes = 0;
+
+	st = (const vec2_t *)tess.svars.texcoordPtr[0];
+
+	s[0] = st[1][0] - st[0][0];
+	s[1] = st[2][0] - st[0][0];
+	s[2] = st[0][0];
+	s[3] = 0.0f;
+
+	t[0] = st[1][1] - st[0][1];
+	t[1] = st[2][1] - st[0][1];
+	t[2] = st[0][1];
+	t[3] = 0.0f;
+}
+
+
+static void VBO_SetModelVertexLocals( const modelVBO_t *mv, const float *lerp, const float *poseMats )
+{
+	static const float identity[12] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0 };
+	const float *m;
+	int i;
+
+	if ( lerp ) {
+		qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, MVP_LERP, lerp );
+		return;
+	}
+
+	for ( i = 0; i < mv->numSlots; i++ ) {
+		if ( mv->slotJoints[i] < 0 )
+			m = identity;
+		else
+			m = poseMats + mv->slotJoints[i] * 12;
+		qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, MVP_JOINTS + i*3 + 0, m + 0 );
+		qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, MVP_JOINTS + i*3 + 1, m + 4 );
+		qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, MVP_JOINTS + i*3 + 2, m + 8 );
+	}
+}
+
+
+/*
+** VBO_DrawModel
+*/
+static qboolean VBO_DrawModel( modelVBO_t *mv, int skinned, const float *lerp, const float *poseMats )
+{
+	const shaderStage_t *pStage;
+	const fogProgramParms_t *fparm;
+	GLuint vp, fp, lastVP;
+	vec4_t color, directed, s, t;
+	qboolean fogPass;
+	int i, lighting, texgen, atest, passes;
+
+	fogPass = ( tess.fogNum && tess.shader->fogPass );
+
+	// compile everything first so we can still fall back to CPU path,
+	// ARB_CompileProgram() binds directly so keep tracked program state in sync
+	ARB_ProgramEnableExt( 0, 0 );
+
+	for ( i = 0; i < MAX_SHADER_STAGES; i++ ) {
+		pStage = tess.xstages[i];
+		if ( !pStage )
+			break;
+		lighting = ( pStage->rgbGen == CGEN_LIGHTING_DIFFUSE );
+		texgen = ( pStage->bundle[0].tcGen == TCGEN_ENVIRONMENT_MAPPED );
+		atest = pStage->stateBits & GLS_ATEST_BITS;
+		CompileModelVP( &model_vp[skinned][lighting][texgen], skinned, lighting, texgen, VP_FOG_NONE );
+		CompileFragmentProgram( getFPindex( 0, atest, FP_FOG_NONE ), 0, atest, FP_FOG_NONE );
+	}
+	if ( fogPass ) {
+		CompileModelVP( &model_fog_vp[skinned][0], skinned, 0, 0, VP_FOG_EYE_IN );
+		CompileModelVP( &model_fog_vp[skinned][1], skinned, 0, 0, VP_FOG_EYE_OUT );
+		CompileFragmentProgram( getFPindex( 0, 0, FP_FOG_ONLY ), 0, 0, FP_FOG_ONLY );
+	}
+	if ( model_vp_failed || !GL_ProgramAvailable() ) {
+		VBO_UnBind();
+		return qfalse;
+	}
+
+	qglBindBufferARB( GL_ARRAY_BUFFER_ARB, mv->vbo );
+	qglBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, mv->ibo );
+	curr_vertex_bind = mv->vbo;
+	curr_index_bind = mv->ibo;
+
+	GL_ClientState( 0, CLS_TEXCOORD_ARRAY | CLS_NORMAL_ARRAY );
+	qglTexCoordPointer( 2, GL_FLOAT, 0, (const GLvoid *)(intptr_t)mv->stOffset );
+
+	if ( skinned ) {
+		qglVertexPointer( 3, GL_FLOAT, 0, (const GLvoid *)0 );
+		qglNormalPointer( GL_FLOAT, 0, (const GLvoid *)(intptr_t)mv->normalOffset );
+		GL_ClientState( 1, CLS_TEXCOORD_ARRAY );
+		qglTexCoordPointer( 4, GL_SHORT, 0, (const GLvoid *)(intptr_t)mv->indexOffset );
+		GL_ClientState( 2, CLS_TEXCOORD_ARRAY );
+		qglTexCoordPointer( 4, GL_FLOAT, 0, (const GLvoid *)(intptr_t)mv->weightOffset );
+	} else {
+		intptr_t newOffset = backEnd.currentEntity->e.frame * mv->frameSize;
+		intptr_t oldOffset = backEnd.currentEntity->e.oldframe * mv->frameSize;
+		qglVertexPointer( 3, GL_SHORT, MD3_VBO_VERTEX_SIZE, (const GLvoid *)newOffset );
+		qglNormalPointer( GL_SHORT, MD3_VBO_VERTEX_SIZE, (const GLvoid *)(newOffset + 8) );
+		GL_ClientState( 1, CLS_TEXCOORD_ARRAY );
+		qglTexCoordPointer( 3, GL_SHORT, MD3_VBO_VERTEX_SIZE, (const GLvoid *)oldOffset );
+		GL_ClientState( 2, CLS_TEXCOORD_ARRAY );
+		qglTexCoordPointer( 3, GL_SHORT, MD3_VBO_VERTEX_SIZE, (const GLvoid *)(oldOffset + 8) );
+	}
+
+	GL_Cull( tess.shader->cullType );
+
+	if ( tess.shader->polygonOffset ) {
+		qglEnable( GL_POLYGON_OFFSET_FILL );
+		qglPolygonOffset( r_offsetFactor->value, r_offsetUnits->value );
+	}
+
+	lastVP = 0;
+	passes = 0;
+
+	for ( i = 0; i < MAX_SHADER_STAGES; i++ ) {
+		pStage = tess.xstages[i];
+		if ( !pStage )
+			break;
+
+		lighting = ( pStage->rgbGen == CGEN_LIGHTING_DIFFUSE );
+		texgen = ( pStage->bundle[0].tcGen == TCGEN_ENVIRONMENT_MAPPED );
+		atest = pStage->stateBits & GLS_ATEST_BITS;
+
+		vp = model_vp[skinned][lighting][texgen];
+		fp = vbo_fp[ getFPindex( 0, atest, FP_FOG_NONE ) ];
+		ARB_ProgramEnableExt( vp, fp );
+
+		// program locals are per-program
+		if ( vp != lastVP ) {
+			VBO_SetModelVertexLocals( mv, lerp, poseMats );
+			lastVP = vp;
+		}
+
+		VBO_ModelStageColor( pStage, color, directed );
+		qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, MVP_COLOR, color );
+		if ( lighting ) {
+			qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, MVP_DIRECTED, directed );
+			qglProgramLocalParameter4fARB( GL_VERTEX_PROGRAM_ARB, MVP_LIGHT_DIR,
+				backEnd.currentEntity->lightDir[0],
+				backEnd.currentEntity->lightDir[1],
+				backEnd.currentEntity->lightDir[2],
+				0.0f );
+		}
+
+		if ( texgen ) {
+			qglProgramLocalParameter4fARB( GL_VERTEX_PROGRAM_ARB, MVP_VIEW_ORIGIN,
+				backEnd.or.viewOrigin[0],
+				backEnd.or.viewOrigin[1],
+				backEnd.or.viewOrigin[2],
+				0.0f );
+		}
+
+		VBO_ModelStageTexMatrix( &pStage->bundle[0], s, t );
+		qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, MVP_TEX_MATRIX + 0, s );
+		qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, MVP_TEX_MATRIX + 1, t );
+
+		GL_SelectTexture( 0 );
+		R_BindAnimatedImage( &pStage->bundle[0] );
+
+		GL_State( pStage->stateBits & ~GLS_ATEST_BITS ); // done in fragment program
+
+		qglDrawElements( GL_TRIANGLES, mv->numIndexes, GL_INDEX_TYPE, (const GLvoid *)0 );
+		passes++;
+	}
+
+	// fog-only pass
+	if ( fogPass ) {
+		GL_BindTexture( 2, tr.fogImage->texnum );
+		GL_SelectTexture( 0 );
+
+		fparm = RB_CalcFogProgramParms();
+		vp = model_fog_vp[skinned][fparm->eyeOutside ? 1 : 0];
+		fp = vbo_fp[ getFPindex( 0, 0, FP_FOG_ONLY ) ];
+		ARB_ProgramEnableExt( vp, fp );
+
+		VBO_SetModelVertexLocals( mv, lerp, poseMats );
+		qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, 2, fparm->fogDistanceVector );
+		qglProgramLocalParameter4fvARB( GL_VERTEX_PROGRAM_ARB, 3, fparm->fogDepthVector );
+		qglProgramLocalParameter4fARB( GL_VERTEX_PROGRAM_ARB, 4, fparm->eyeT, 0.0f, 0.0f, 0.0f );
+		qglProgramLocalParameter4fvARB( GL_FRAGMENT_PROGRAM_ARB, 0, fparm->fogColor );
+
+		if ( tess.shader->fogPass == FP_EQUAL ) {
+			GL_State( GLS_SRCBLEND_SRC_ALPHA | GLS_DSTBLEND_ONE_MINUS_SRC_ALPHA | GLS_DEPTHFUNC_EQUAL );
+		} else {
+			GL_State( GLS_SRCBLEND_SRC_ALPHA | GLS_DSTBLEND_ONE_MINUS_SRC_ALPHA );
+		}
+
+		qglDrawElements( GL_TRIANGLES, mv->numIndexes, GL_INDEX_TYPE, (const GLvoid *)0 );
+	}
+
+	ARB_ProgramEnableExt( 0, 0 );
+
+	if ( tess.shader->polygonOffset ) {
+		qglDisable( GL_POLYGON_OFFSET_FILL );
+	}
+
+	GL_ClientState( 2, CLS_NONE );
+	GL_ClientState( 1, CLS_NONE );
+	GL_ClientState( 0, CLS_NONE );
+
+	VBO_UnBind();
+
+	backEnd.pc.c_shaders++;
+	backEnd.pc.c_vertexes += mv->numVertexes;
+	backEnd.pc.c_indexes += mv->numIndexes;
+	backEnd.pc.c_totalIndexes += mv->numIndexes * passes;
+
+	return qtrue;
+}
+
+
+static modelVBO_t *VBO_PrepareModel( const void *surface )
+{
+	modelVBO_t *mv;
+
+	if ( !isModelSurface() )
+		return NULL;
+
+	mv = VBO_FindModel( surface );
+	if ( mv == NULL || mv->failed )
+		return NULL;
+
+	// keep drawing order with surfaces already tesselated
+	if ( tess.numIndexes ) {
+		RB_EndSurface();
+		RB_BeginSurface( tess.shader, tess.fogNum );
+	}
+
+	return mv;
+}
+
+
+/*
+=============
+VBO_DrawMD3
+
+Returns qfalse if surface should be tesselated on CPU
+=============
+*/
+qboolean VBO_DrawMD3( const md3Surface_t *surface )
+{
+	modelVBO_t *mv;
+	vec4_t lerp;
+	float backlerp;
+
+	mv = VBO_PrepareModel( surface );
+	if ( mv == NULL )
+		return qfalse;
+
+	if ( mv->vbo == 0 ) {
+		VBO_UploadMD3( mv, surface );
+		if ( mv->failed ) {
+			VBO_UnBind();
+			return qfalse;
+		}
+	}
+
+	if ( backEnd.currentEntity->e.oldframe == backEnd.currentEntity->e.frame ) {
+		backlerp = 0;
+	} else {
+		backlerp = backEnd.currentEntity->e.backlerp;
+	}
+
+	lerp[0] = MD3_XYZ_SCALE * ( 1.0f - backlerp );
+	lerp[1] = MD3_XYZ_SCALE * backlerp;
+	lerp[2] = 1.0f - backlerp;
+	lerp[3] = backlerp / 32767.0f; // texcoords are not normalized
+
+	return VBO_DrawModel( mv, 0, lerp, NULL );
+}
+
+
+/*
+=============
+VBO_DrawIQM
+
+Returns qfalse if surface should be tesselated on CPU
+=============
+*/
+qboolean VBO_DrawIQM( const srfIQModel_t *surface )
+{
+	float poseMats[ IQM_MAX_JOINTS * 12 ];
+	modelVBO_t *mv;
+
+	if ( model_max_slots == 0 && qglGetProgramivARB ) {
+		GLint n = 0;
+		qglGetProgramivARB( GL_VERTEX_PROGRAM_ARB, GL_MAX_PROGRAM_LOCAL_PARAMETERS_ARB, &n );
+		model_max_slots = ( n - MVP_JOINTS ) / 3;
+		if ( model_max_slots > IQM_MAX_JOINTS + 1 )
+			model_max_slots = IQM_MAX_JOINTS + 1;
+		else if ( model_max_slots <= 0 )
+			model_max_slots = -1;
+	}
+
+	mv = VBO_PrepareModel( surface );
+	if ( mv == NULL )
+		return qfalse;
+
+	if ( mv->vbo == 0 ) {
+		VBO_UploadIQM( mv, surface );
+		if ( mv->failed ) {
+			VBO_UnBind();
+			return qfalse;
+		}
+	}
+
+	RB_IQMPoseMats( surface->data, poseMats );
+
+	return VBO_DrawModel( mv, 1, NULL, poseMats );
+}
+
+
+/*
+=============
+VBO_ReleaseModels
+
+Model surfaces live on the hunk, so buffers must go with them
+=============
+*/
+void VBO_ReleaseModels( void )
+{
+	int i;
+
+	if ( model_vbo_count && qglDeleteBuffersARB ) {
+		VBO_UnBind();
+		for ( i = 0; i < MAX_MODEL_VBOS; i++ ) {
+			if ( model_vbos[i].vbo )
+				qglDeleteBuffersARB( 1, &model_vbos[i].vbo );
+			if ( model_vbos[i].ibo )
+				qglDeleteBuffersARB( 1, &model_vbos[i].ibo );
+		}
+	}
+
+	if ( qglDeleteProgramsARB ) {
+		ARB_ProgramEnableExt( 0, 0 );
+		qglDeleteProgramsARB( sizeof( model_vp ) / sizeof( GLuint ), &model_vp[0][0][0] );
+		qglDeleteProgramsARB( sizeof( model_fog_vp ) / sizeof( GLuint ), &model_fog_vp[0][0] );
+	}
+
+	Com_Memset( model_vbos, 0, sizeof( model_vbos ) );
+	Com_Memset( model_vp, 0, sizeof( model_vp ) );
+	Com_Memset( model_fog_vp, 0, sizeof( model_fog_vp ) );
+	model_vbo_count = 0;
+	model_slot_count = 0;
+	model_vp_failed = qfalse;
+	model_max_slots = 0;
+}
+
 #endif // USE_VBO
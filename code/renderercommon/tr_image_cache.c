@@ -0,0 +1,695 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+
+#include "../qcommon/q_shared.h"
+#include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_image_cache.h"
+#include "../renderercommon/tr_jobs.h"
+
+/*
+========================================================================
+
+Compressed texture cache
+
+Mipmapped textures can be stored as BC1 (opaque) or BC3 (with alpha)
+blocks in texcache/ under the home path. The file name is a hash of the
+source image file and of every setting that changes the uploaded texels,
+so a second load of the same texture skips both decoding and encoding
+and any change of settings simply misses the cache.
+
+The encoder runs on the front-end job threads, it is only needed the
+first time a texture is seen.
+
+========================================================================
+*/
+
+#define IMAGECACHE_IDENT		(('C'<<24)+('T'<<16)+('3'<<8)+'Q')
+#define IMAGECACHE_VERSION		1
+#define IMAGECACHE_MIN_BLOCKS	1024	// smaller images are not worth the job dispatch
+#define IMAGECACHE_MAX_SIZE		2048	// MAX_TEXTURE_SIZE of both renderers
+
+typedef struct {
+	int		ident;
+	int		version;
+	int		format;
+	int		width, height;
+	int		uploadWidth, uploadHeight;
+	int		numLevels;
+	int		dataSize;
+} imageCacheHeader_t;
+
+static struct {
+	uint64_t			key;
+	imageCacheHeader_t	header;
+	byte				*buffer;	// header followed by the levels
+	int					used;
+	int					numLevels;
+} cacheWriter;
+
+
+/*
+========================================================================
+
+BC1/BC3 block encoder
+
+========================================================================
+*/
+
+typedef struct {
+	const byte		*in;
+	byte			*out;
+	int				width;
+	int				height;
+	int				format;
+	int				blocksX;
+	int				blocksY;
+} compressJob_t;
+
+
+/*
+================
+R_FetchBlock
+
+Edge pixels are repeated for levels smaller than 4x4
+================
+*/
+static void R_FetchBlock( byte block[16][4], const byte *in, int width, int height, int bx, int by ) {
+	int x, y, sx, sy;
+
+	for ( y = 0; y < 4; y++ ) {
+		sy = MIN( by * 4 + y, height - 1 );
+		for ( x = 0; x < 4; x++ ) {
+			sx = MIN( bx * 4 + x, width - 1 );
+			Com_Memcpy( block[ y * 4 + x ], in + ( sy * width + sx ) * 4, 4 );
+		}
+	}
+}
+
+
+/*
+================
+R_Pack565
+================
+*/
+static int R_Pack565( const float *c ) {
+	int r, g, b;
+
+	r = (int)( c[0] * ( 31.0f / 255.0f ) + 0.5f );
+	g = (int)( c[1] * ( 63.0f / 255.0f ) + 0.5f );
+	b = (int)( c[2] * ( 31.0f / 255.0f ) + 0.5f );
+
+	r = r < 0 ? 0 : r > 31 ? 31 : r;
+	g = g < 0 ? 0 : g > 63 ? 63 : g;
+	b = b < 0 ? 0 : b > 31 ? 31 : b;
+
+	return ( r << 11 ) | ( g << 5 ) | b;
+}
+
+
+/*
+================
+R_Unpack565
+================
+*/
+static void R_Unpack565( int c, int *out ) {
+	int r, g, b;
+
+	r = ( c >> 11 ) & 31;
+	g = ( c >> 5 ) & 63;
+	b = c & 31;
+
+	out[0] = ( r << 3 ) | ( r >> 2 );
+	out[1] = ( g << 2 ) | ( g >> 4 );
+	out[2] = ( b << 3 ) | ( b >> 2 );
+}
+
+
+/*
+================
+R_ColorIndices
+
+Picks the closest of the four palette entries for every pixel,
+returns the indices and the total squared error
+================
+*/
+static unsigned R_ColorIndices( const byte block[16][4], int c0, int c1, int *error ) {
+	int palette[4][3];
+	unsigned indices;
+	int i, j, k, d, dist, best, bestDist, total;
+
+	R_Unpack565( c0, palette[0] );
+	R_Unpack565( c1, palette[1] );
+
+	for ( k = 0; k < 3; k++ ) {
+		palette[2][k] = ( 2 * palette[0][k] + palette[1][k] ) / 3;
+		palette[3][k] = ( palette[0][k] + 2 * palette[1][k] ) / 3;
+	}
+
+	indices = 0;
+	total = 0;
+
+	for ( i = 0; i < 16; i++ ) {
+		best = 0;
+		bestDist = INT_MAX;
+		for ( j = 0; j < 4; j++ ) {
+			d = block[i][0] - palette[j][0]; dist = d * d;
+			d = block[i][1] - palette[j][1]; dist += d * d;
+			d = block[i][2] - palette[j][2]; dist += d * d;
+			if ( dist < bestDist ) {
+				bestDist = dist;
+				best = j;
+			}
+		}
+		indices |= (unsigned)best << ( i * 2 );
+		total += bestDist;
+	}
+
+	*error = total;
+	return indices;
+}
+
+
+/*
+================
+R_EncodeColorBlock
+
+Endpoints are taken from the principal axis of the block colors and
+refined once by least squares against the chosen indices
+================
+*/
+static void R_EncodeColorBlock( byte *out, const byte block[16][4] ) {
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	float mean[3], cov[6], axis[3], v[3], lo[3], hi[3];
+	float t, minT, maxT, len;
+	float aa, ab, bb, det, ax[3], bx[3];
+	unsigned indices, refined;
+	int c0, c1, r0, r1, error, refinedError;
+	int i, k, n, tmp;
+
+	mean[0] = mean[1] = mean[2] = 0.0f;
+	for ( i = 0; i < 16; i++ ) {
+		mean[0] += block[i][0];
+		mean[1] += block[i][1];
+		mean[2] += block[i][2];
+	}
+	VectorScale( mean, 1.0f / 16.0f, mean );
+
+	Com_Memset( cov, 0, sizeof( cov ) );
+	for ( i = 0; i < 16; i++ ) {
+		v[0] = block[i][0] - mean[0];
+		v[1] = block[i][1] - mean[1];
+		v[2] = block[i][2] - mean[2];
+		cov[0] += v[0] * v[0];
+		cov[1] += v[0] * v[1];
+		cov[2] += v[0] * v[2];
+		cov[3] += v[1] * v[1];
+		cov[4] += v[1] * v[2];
+		cov[5] += v[2] * v[2];
+	}
+
+	// power iteration for the principal axis
+	VectorSet( axis, 1.0f, 1.0f, 1.0f );
+	for ( n = 0; n < 8; n++ ) {
+		v[0] = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		v[1] = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		v[2] = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		len = MAX( fabs( v[0] ), MAX( fabs( v[1] ), fabs( v[2] ) ) );
+		if ( len < 1e-6f ) {
+			break;
+		}
+		VectorScale( v, 1.0f / len, axis );
+	}
+
+	len = DotProduct( axis, axis );
+	if ( n == 0 || len < 1e-6f ) {
+		// solid color
+		VectorCopy( mean, lo );
+		VectorCopy( mean, hi );
+	} else {
+		minT = maxT = 0.0f;
+		for ( i = 0; i < 16; i++ ) {
+			v[0] = block[i][0] - mean[0];
+			v[1] = block[i][1] - mean[1];
+			v[2] = block[i][2] - mean[2];
+			t = DotProduct( v, axis );
+			if ( t < minT ) minT = t;
+			if ( t > maxT ) maxT = t;
+		}
+		minT /= len;
+		maxT /= len;
+		VectorMA( mean, minT, axis, lo );
+		VectorMA( mean, maxT, axis, hi );
+	}
+
+	c0 = R_Pack565( hi );
+	c1 = R_Pack565( lo );
+	indices = R_ColorIndices( block, c0, c1, &error );
+
+	// solve for the endpoints that best fit the chosen indices
+	if ( error > 0 && c0 != c1 ) {
+		aa = ab = bb = 0.0f;
+		VectorClear( ax );
+		VectorClear( bx );
+		for ( i = 0; i < 16; i++ ) {
+			float a = weights[ ( indices >> ( i * 2 ) ) & 3 ];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for ( k = 0; k < 3; k++ ) {
+				ax[k] += a * block[i][k];
+				bx[k] += b * block[i][k];
+			}
+		}
+		det = aa * bb - ab * ab;
+		if ( fabs( det ) > 1e-4f ) {
+			for ( k = 0; k < 3; k++ ) {
+				hi[k] = ( ax[k] * bb - bx[k] * ab ) / det;
+				lo[k] = ( bx[k] * aa - ax[k] * ab ) / det;
+			}
+			r0 = R_Pack565( hi );
+			r1 = R_Pack565( lo );
+			refined = R_ColorIndices( block, r0, r1, &refinedError );
+			if ( refinedError < error ) {
+				c0 = r0;
+				c1 = r1;
+				indices = refined;
+			}
+		}
+	}
+
+	// c0 > c1 selects the four color mode, swapping the endpoints
+	// swaps palette entries 0/1 and 2/3
+	if ( c0 < c1 ) {
+		tmp = c0; c0 = c1; c1 = tmp;
+		indices ^= 0x55555555;
+	} else if ( c0 == c1 ) {
+		indices = 0;
+	}
+
+	out[0] = c0 & 255;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 255;
+	out[3] = c1 >> 8;
+	out[4] = indices & 255;
+	out[5] = ( indices >> 8 ) & 255;
+	out[6] = ( indices >> 16 ) & 255;
+	out[7] = indices >> 24;
+}
+
+
+/*
+================
+R_EncodeAlphaBlock
+
+Always uses the eight value mode between the block extremes
+================
+*/
+static void R_EncodeAlphaBlock( byte *out, const byte block[16][4] ) {
+	int a0, a1, a, i, pos, index, range;
+	uint64_t bits;
+
+	a0 = a1 = block[0][3];
+	for ( i = 1; i < 16; i++ ) {
+		a = block[i][3];
+		if ( a > a0 ) a0 = a;
+		if ( a < a1 ) a1 = a;
+	}
+
+	out[0] = a0;
+	out[1] = a1;
+
+	bits = 0;
+	range = a0 - a1;
+	if ( range > 0 ) {
+		for ( i = 0; i < 16; i++ ) {
+			// position between a0 (0) and a1 (7)
+			pos = ( ( a0 - block[i][3] ) * 14 + range ) / ( range * 2 );
+			if ( pos == 0 ) {
+				index = 0;
+			} else if ( pos == 7 ) {
+				index = 1;
+			} else {
+				index = pos + 1;
+			}
+			bits |= (uint64_t)index << ( i * 3 );
+		}
+	}
+
+	for ( i = 0; i < 6; i++ ) {
+		out[ 2 + i ] = ( bits >> ( i * 8 ) ) & 255;
+	}
+}
+
+
+/*
+================
+R_CompressRow
+
+Job function, index is the row of blocks
+================
+*/
+static void R_CompressRow( void *arg, int by, int thread ) {
+	const compressJob_t *job = (const compressJob_t *)arg;
+	byte block[16][4];
+	byte *out;
+	int bx, blockSize;
+
+	blockSize = ( job->format == IMAGECACHE_BC3 ) ? 16 : 8;
+
+	out = job->out + by * job->blocksX * blockSize;
+	for ( bx = 0; bx < job->blocksX; bx++, out += blockSize ) {
+		R_FetchBlock( block, job->in, job->width, job->height, bx, by );
+		if ( job->format == IMAGECACHE_BC3 ) {
+			R_EncodeAlphaBlock( out, block );
+			R_EncodeColorBlock( out + 8, block );
+		} else {
+			R_EncodeColorBlock( out, block );
+		}
+	}
+}
+
+
+/*
+================
+R_CompressedLevelSize
+================
+*/
+int R_CompressedLevelSize( int width, int height, int format ) {
+	return ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * ( format == IMAGECACHE_BC3 ? 16 : 8 );
+}
+
+
+/*
+================
+R_CompressImage
+
+Encodes RGBA pixels into BC1 or BC3 blocks, rows of blocks of large
+images are spread over the job threads
+================
+*/
+void R_CompressImage( byte *out, const byte *in, int width, int height, int format ) {
+	compressJob_t job;
+	int by;
+
+	job.in = in;
+	job.out = out;
+	job.width = width;
+	job.height = height;
+	job.format = format;
+	job.blocksX = ( width + 3 ) / 4;
+	job.blocksY = ( height + 3 ) / 4;
+
+	if ( job.blocksX * job.blocksY >= IMAGECACHE_MIN_BLOCKS ) {
+		R_RunJobs( R_CompressRow, &job, job.blocksY );
+		return;
+	}
+
+	for ( by = 0; by < job.blocksY; by++ ) {
+		R_CompressRow( &job, by, 0 );
+	}
+}
+
+
+/*
+========================================================================
+
+Cache files
+
+========================================================================
+*/
+
+/*
+================
+R_ImageCacheHash
+
+64-bit FNV-1a over whole words, bytes for the tail
+================
+*/
+uint64_t R_ImageCacheHash( uint64_t hash, const void *data, int length ) {
+	const uint64_t prime = ( (uint64_t)0x100 << 32 ) | 0x1b3;
+	const byte *p = (const byte *)data;
+	uint64_t word;
+
+	while ( length >= 8 ) {
+		Com_Memcpy( &word, p, 8 );
+		hash = ( hash ^ word ) * prime;
+		p += 8;
+		length -= 8;
+	}
+
+	while ( length > 0 ) {
+		hash = ( hash ^ *p ) * prime;
+		p++;
+		length--;
+	}
+
+	return hash;
+}
+
+
+/*
+================
+R_ImageCacheKey
+================
+*/
+uint64_t R_ImageCacheKey( uint64_t sourceHash, uint64_t salt ) {
+	byte buf[8];
+	int i;
+
+	for ( i = 0; i < 8; i++ ) {
+		buf[i] = ( sourceHash >> ( i * 8 ) ) & 255;
+	}
+
+	return R_ImageCacheHash( salt, buf, sizeof( buf ) );
+}
+
+
+/*
+================
+R_ImageCacheName
+================
+*/
+const char *R_ImageCacheName( uint64_t key ) {
+	static char name[MAX_QPATH];
+
+	Com_sprintf( name, sizeof( name ), "texcache/%08x%08x.tc", (unsigned)( key >> 32 ), (unsigned)key );
+
+	return name;
+}
+
+
+/*
+================
+R_ImageCacheLevels
+
+Returns the number of levels down to 1x1 and their total size
+================
+*/
+static int R_ImageCacheLevels( int width, int height, int format, int *dataSize ) {
+	int numLevels = 0;
+
+	*dataSize = 0;
+
+	while ( 1 ) {
+		*dataSize += R_CompressedLevelSize( width, height, format );
+		numLevels++;
+		if ( width == 1 && height == 1 ) {
+			break;
+		}
+		width = MAX( 1, width >> 1 );
+		height = MAX( 1, height >> 1 );
+	}
+
+	return numLevels;
+}
+
+
+/*
+================
+R_LoadCachedImage
+
+Returns qfalse if there is no valid cache entry for the key
+================
+*/
+qboolean R_LoadCachedImage( uint64_t key, cachedImage_t *image ) {
+	imageCacheHeader_t header;
+	void *buffer;
+	int length, numLevels, dataSize;
+
+	Com_Memset( image, 0, sizeof( *image ) );
+
+	length = ri.FS_ReadFile( R_ImageCacheName( key ), &buffer );
+	if ( buffer == NULL ) {
+		return qfalse;
+	}
+
+	if ( length < (int)sizeof( header ) ) {
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+
+	Com_Memcpy( &header, buffer, sizeof( header ) );
+	header.ident = LittleLong( header.ident );
+	header.version = LittleLong( header.version );
+	header.format = LittleLong( header.format );
+	header.width = LittleLong( header.width );
+	header.height = LittleLong( header.height );
+	header.uploadWidth = LittleLong( header.uploadWidth );
+	header.uploadHeight = LittleLong( header.uploadHeight );
+	header.numLevels = LittleLong( header.numLevels );
+	header.dataSize = LittleLong( header.dataSize );
+
+	if ( header.ident != IMAGECACHE_IDENT || header.version != IMAGECACHE_VERSION
+		|| ( header.format != IMAGECACHE_BC1 && header.format != IMAGECACHE_BC3 )
+		|| header.width <= 0 || header.height <= 0
+		|| header.uploadWidth <= 0 || header.uploadWidth > IMAGECACHE_MAX_SIZE
+		|| header.uploadHeight <= 0 || header.uploadHeight > IMAGECACHE_MAX_SIZE ) {
+		ri.Printf( PRINT_DEVELOPER, "...ignoring bad cache file %s\n", R_ImageCacheName( key ) );
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+
+	numLevels = R_ImageCacheLevels( header.uploadWidth, header.uploadHeight, header.format, &dataSize );
+	if ( header.numLevels != numLevels || header.dataSize != dataSize || length != (int)sizeof( header ) + dataSize ) {
+		ri.Printf( PRINT_DEVELOPER, "...ignoring truncated cache file %s\n", R_ImageCacheName( key ) );
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+
+	image->format = header.format;
+	image->width = header.width;
+	image->height = header.height;
+	image->uploadWidth = header.uploadWidth;
+	image->uploadHeight = header.uploadHeight;
+	image->numLevels = header.numLevels;
+	image->dataSize = header.dataSize;
+	image->data = (const byte *)buffer + sizeof( header );
+	image->buffer = buffer;
+
+	return qtrue;
+}
+
+
+/*
+================
+R_FreeCachedImage
+================
+*/
+void R_FreeCachedImage( cachedImage_t *image ) {
+	if ( image->buffer ) {
+		ri.FS_FreeFile( image->buffer );
+	}
+	Com_Memset( image, 0, sizeof( *image ) );
+}
+
+
+/*
+================
+R_BeginImageCache
+
+Prepares a cache entry for the full mip chain of an upload
+================
+*/
+void R_BeginImageCache( uint64_t key, int width, int height, int uploadWidth, int uploadHeight, int format ) {
+	int dataSize;
+
+	if ( cacheWriter.buffer ) {
+		// left over from an aborted upload
+		ri.Free( cacheWriter.buffer );
+	}
+
+	Com_Memset( &cacheWriter, 0, sizeof( cacheWriter ) );
+
+	cacheWriter.key = key;
+	cacheWriter.header.ident = IMAGECACHE_IDENT;
+	cacheWriter.header.version = IMAGECACHE_VERSION;
+	cacheWriter.header.format = format;
+	cacheWriter.header.width = width;
+	cacheWriter.header.height = height;
+	cacheWriter.header.uploadWidth = uploadWidth;
+	cacheWriter.header.uploadHeight = uploadHeight;
+	cacheWriter.header.numLevels = R_ImageCacheLevels( uploadWidth, uploadHeight, format, &dataSize );
+	cacheWriter.header.dataSize = dataSize;
+
+	cacheWriter.buffer = ri.Malloc( sizeof( imageCacheHeader_t ) + dataSize );
+	cacheWriter.used = sizeof( imageCacheHeader_t );
+}
+
+
+/*
+================
+R_AddImageCacheLevel
+
+Compresses the next mip level, returns the blocks to upload
+================
+*/
+const byte *R_AddImageCacheLevel( const byte *pic, int width, int height, int *size ) {
+	byte *out;
+
+	if ( cacheWriter.buffer == NULL || cacheWriter.numLevels >= cacheWriter.header.numLevels ) {
+		ri.Error( ERR_DROP, "R_AddImageCacheLevel: unexpected level %ix%i", width, height );
+	}
+
+	*size = R_CompressedLevelSize( width, height, cacheWriter.header.format );
+
+	out = cacheWriter.buffer + cacheWriter.used;
+	R_CompressImage( out, pic, width, height, cacheWriter.header.format );
+
+	cacheWriter.used += *size;
+	cacheWriter.numLevels++;
+
+	return out;
+}
+
+
+/*
+================
+R_EndImageCache
+
+Writes the entry if every level has been added
+================
+*/
+void R_EndImageCache( void ) {
+	imageCacheHeader_t *header;
+
+	if ( cacheWriter.buffer == NULL ) {
+		return;
+	}
+
+	if ( cacheWriter.numLevels == cacheWriter.header.numLevels ) {
+		header = (imageCacheHeader_t *)cacheWriter.buffer;
+		header->ident = LittleLong( cacheWriter.header.ident );
+		header->version = LittleLong( cacheWriter.header.version );
+		header->format = LittleLong( cacheWriter.header.format );
+		header->width = LittleLong( cacheWriter.header.width );
+		header->height = LittleLong( cacheWriter.header.height );
+		header->uploadWidth = LittleLong( cacheWriter.header.uploadWidth );
+		header->uploadHeight = LittleLong( cacheWriter.header.uploadHeight );
+		header->numLevels = LittleLong( cacheWriter.header.numLevels );
+		header->dataSize = LittleLong( cacheWriter.header.dataSize );
+		ri.FS_WriteFile( R_ImageCacheName( cacheWriter.key ), cacheWriter.buffer, cacheWriter.used );
+	}
+
+	ri.Free( cacheWriter.buffer );
+	Com_Memset( &cacheWriter, 0, sizeof( cacheWriter ) );
+}
@@ -0,0 +1,59 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+#ifndef TR_IMAGE_CACHE_H
+#define TR_IMAGE_CACHE_H
+
+// compressed texture cache, see tr_image_cache.c
+
+#define IMAGECACHE_BC1		1	// opaque, 8 bytes per 4x4 block
+#define IMAGECACHE_BC3		2	// with alpha, 16 bytes per 4x4 block
+
+#define IMAGECACHE_HASH_INIT	( ( (uint64_t)0xcbf29ce4 << 32 ) | 0x84222325 )
+
+typedef struct {
+	int			format;
+	int			width, height;				// source image
+	int			uploadWidth, uploadHeight;	// first mip level
+	int			numLevels;					// down to 1x1
+	int			dataSize;
+	const byte	*data;						// all levels, tightly packed
+	void		*buffer;
+} cachedImage_t;
+
+int R_CompressedLevelSize( int width, int height, int format );
+void R_CompressImage( byte *out, const byte *in, int width, int height, int format );
+
+uint64_t R_ImageCacheHash( uint64_t hash, const void *data, int length );
+uint64_t R_ImageCacheKey( uint64_t sourceHash, uint64_t salt );
+const char *R_ImageCacheName( uint64_t key );
+
+qboolean R_LoadCachedImage( uint64_t key, cachedImage_t *image );
+void R_FreeCachedImage( cachedImage_t *image );
+
+void R_BeginImageCache( uint64_t key, int width, int height, int uploadWidth, int uploadHeight, int format );
+const byte *R_AddImageCacheLevel( const byte *pic, int width, int height, int *size );
+void R_EndImageCache( void );
+
+// implemented in tr_image_prefetch.c, finds the file R_LoadImage would use
+qboolean R_HashImageSource( const char *name, uint64_t *hash, char *localName, int localNameSize );
+
+#endif // TR_IMAGE_CACHE_H
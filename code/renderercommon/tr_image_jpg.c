@@ -27,3 +27,8 @@ void R_LoadJPG( const char *filename, unsigned char **pic, int *width, int *heig
 {
 	ri.CL_LoadJPG( filename, pic, width, height );
 }
+
+void R_DecodeJPG( const char *filename, const byte *data, int length, unsigned char **pic, int *width, int *height )
+{
+	ri.CL_DecodeJPG( filename, data, length, pic, width, height );
+}
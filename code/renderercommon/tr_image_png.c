@@ -21,7 +21,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "../qcommon/q_shared.h"
 #include "../renderercommon/tr_public.h"
-#include "../qcommon/puff.h"
+#include "../qcommon/inflate.h"
+
+#if idx64 || defined(__SSE2__)
+#define PNG_SIMD_SSE2
+#include <emmintrin.h>
+#elif arm64 || defined(__ARM_NEON)
+#define PNG_SIMD_NEON
+#include <arm_neon.h>
+#endif
 
 // we could limit the png size to a lower value here
 #ifndef INT_MAX
@@ -206,6 +214,7 @@ struct BufferedFile
 	int   Length;
 	byte *Ptr;
 	int   BytesLeft;
+	qboolean OwnsBuffer;
 };
 
 /*
@@ -270,8 +279,37 @@ static struct BufferedFile *ReadBufferedFile(const char *name)
 	 *  Set the pointers and counters.
 	 */
 
-	BF->Ptr       = BF->Buffer;
-	BF->BytesLeft = BF->Length;
+	BF->Ptr        = BF->Buffer;
+	BF->BytesLeft  = BF->Length;
+	BF->OwnsBuffer = qtrue;
+
+	return(BF);
+}
+
+/*
+ *  Wrap a file that is already in memory, the buffer stays with the caller.
+ */
+
+static struct BufferedFile *OpenBufferedMemory(const byte *data, int length)
+{
+	struct BufferedFile *BF;
+
+	if(!(data && (length > 0)))
+	{
+		return(NULL);
+	}
+
+	BF = ri.Malloc(sizeof(struct BufferedFile));
+	if(!BF)
+	{
+		return(NULL);
+	}
+
+	BF->Buffer     = (byte *) data;
+	BF->Length     = length;
+	BF->Ptr        = BF->Buffer;
+	BF->BytesLeft  = BF->Length;
+	BF->OwnsBuffer = qfalse;
 
 	return(BF);
 }
@@ -284,7 +322,7 @@ static void CloseBufferedFile(struct BufferedFile *BF)
 {
 	if(BF)
 	{
-		if(BF->Buffer)
+		if(BF->Buffer && BF->OwnsBuffer)
 		{
 			ri.FS_FreeFile(BF->Buffer);
 		}
@@ -500,11 +538,115 @@ static qboolean FindChunk(struct BufferedFile *BF, uint32_t ChunkType)
 	return(qtrue);
 }
 
+/*
+ *  Size of the filtered image data as described by the image header,
+ *  one FilterType byte plus the packed pixels per scanline and pass.
+ */
+
+static uint32_t FilteredImageSize(struct PNG_Chunk_IHDR *IHDR)
+{
+	/*
+	 *  Adam7 pass layout : WOffset, WSkip, HOffset, HSkip
+	 */
+
+	static const uint8_t Adam7[PNG_Adam7_NumPasses][4] =
+	{
+		{0, 8, 0, 8},
+		{4, 8, 0, 8},
+		{0, 4, 4, 8},
+		{2, 4, 0, 4},
+		{0, 2, 2, 4},
+		{1, 2, 0, 2},
+		{0, 1, 1, 2}
+	};
+
+	uint32_t IHDR_Width;
+	uint32_t IHDR_Height;
+	uint32_t BitsPerPixel;
+	uint64_t PassWidth, PassHeight, BytesPerScanline, Size;
+	uint32_t a;
+
+	IHDR_Width  = BigLong(IHDR->Width);
+	IHDR_Height = BigLong(IHDR->Height);
+
+	switch(IHDR->ColourType)
+	{
+		case PNG_ColourType_Grey :
+		{
+			BitsPerPixel = IHDR->BitDepth * PNG_NumColourComponents_Grey;
+			break;
+		}
+
+		case PNG_ColourType_True :
+		{
+			BitsPerPixel = IHDR->BitDepth * PNG_NumColourComponents_True;
+			break;
+		}
+
+		case PNG_ColourType_Indexed :
+		{
+			BitsPerPixel = IHDR->BitDepth * PNG_NumColourComponents_Indexed;
+			break;
+		}
+
+		case PNG_ColourType_GreyAlpha :
+		{
+			BitsPerPixel = IHDR->BitDepth * PNG_NumColourComponents_GreyAlpha;
+			break;
+		}
+
+		case PNG_ColourType_TrueAlpha :
+		{
+			BitsPerPixel = IHDR->BitDepth * PNG_NumColourComponents_TrueAlpha;
+			break;
+		}
+
+		default :
+		{
+			return(0);
+		}
+	}
+
+	if(IHDR->InterlaceMethod == PNG_InterlaceMethod_NonInterlaced)
+	{
+		BytesPerScanline = ((uint64_t) IHDR_Width * BitsPerPixel + 7) / 8;
+
+		Size = (BytesPerScanline + 1) * IHDR_Height;
+	}
+	else
+	{
+		Size = 0;
+
+		for(a = 0; a < PNG_Adam7_NumPasses; a++)
+		{
+			PassWidth  = ((uint64_t) IHDR_Width  + Adam7[a][1] - 1 - Adam7[a][0]) / Adam7[a][1];
+			PassHeight = ((uint64_t) IHDR_Height + Adam7[a][3] - 1 - Adam7[a][2]) / Adam7[a][3];
+
+			BytesPerScanline = (PassWidth * BitsPerPixel + 7) / 8;
+
+			if(BytesPerScanline)
+			{
+				Size += (BytesPerScanline + 1) * PassHeight;
+			}
+		}
+	}
+
+	if(Size > INT_MAX)
+	{
+		return(0);
+	}
+
+	return((uint32_t) Size);
+}
+
 /*
  *  Decompress all IDATs
+ *
+ *  The size of the uncompressed data is known from the image header,
+ *  so the IDATs are inflated in a single pass.
  */
 
-static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
+static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer, uint32_t ExpectedLength)
 {
 	uint8_t  *DecompressedData;
 	uint32_t  DecompressedDataLength;
@@ -520,17 +662,15 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 
 	int BytesToRewind;
 
-	int32_t   puffResult;
-	uint8_t  *puffDest;
-	uint32_t  puffDestLen;
-	uint8_t  *puffSrc;
-	uint32_t  puffSrcLen;
+	int       InflateResult;
+	uint32_t  InflateDestLen;
+	uint32_t  InflateSrcLen;
 
 	/*
 	 *  input verification
 	 */
 
-	if(!(BF && Buffer))
+	if(!(BF && Buffer && ExpectedLength))
 	{
 		return((unsigned)-1);
 	}
@@ -696,26 +836,11 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 		} 
 	}
 
-	/*
-	 *  Let puff() calculate the decompressed data length.
-	 */
-
-	puffDest    = NULL;
-	puffDestLen = 0;
-
 	/*
 	 *  The zlib header and checkvalue don't belong to the compressed data.
 	 */
 
-	puffSrc    = CompressedData + PNG_ZlibHeader_Size;
-	puffSrcLen = CompressedDataLength - PNG_ZlibHeader_Size - PNG_ZlibCheckValue_Size;
-
-	/*
-	 *  first puff() to calculate the size of the uncompressed data
-	 */
-
-	puffResult = puff(puffDest, &puffDestLen, puffSrc, &puffSrcLen);
-	if(!((puffResult == 0) && (puffDestLen > 0)))
+	if(CompressedDataLength <= PNG_ZlibHeader_Size + PNG_ZlibCheckValue_Size)
 	{
 		ri.Free(CompressedData);
 
@@ -726,7 +851,7 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 	 *  Allocate the buffer for the uncompressed data.
 	 */
 
-	DecompressedData = ri.Malloc(puffDestLen);
+	DecompressedData = ri.Malloc(ExpectedLength);
 	if(!DecompressedData)
 	{
 		ri.Free(CompressedData);
@@ -735,18 +860,13 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 	}
 
 	/*
-	 *  Set the input again in case something was changed by the last puff() .
+	 *  decompression
 	 */
 
-	puffDest   = DecompressedData;
-	puffSrc    = CompressedData + PNG_ZlibHeader_Size;
-	puffSrcLen = CompressedDataLength - PNG_ZlibHeader_Size - PNG_ZlibCheckValue_Size;
+	InflateDestLen = ExpectedLength;
+	InflateSrcLen  = CompressedDataLength - PNG_ZlibHeader_Size - PNG_ZlibCheckValue_Size;
 
-	/*
-	 *  decompression puff()
-	 */
-
-	puffResult = puff(puffDest, &puffDestLen, puffSrc, &puffSrcLen);
+	InflateResult = Inflate_Raw(DecompressedData, &InflateDestLen, CompressedData + PNG_ZlibHeader_Size, &InflateSrcLen);
 
 	/*
 	 *  The compressed data is not needed anymore.
@@ -755,10 +875,10 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 	ri.Free(CompressedData);
 
 	/*
-	 *  Check if the last puff() was successful.
+	 *  Check if the decompression was successful.
 	 */
 
-	if(!((puffResult == 0) && (puffDestLen > 0)))
+	if(!((InflateResult == INFLATE_OK) && (InflateDestLen == ExpectedLength)))
 	{
 		ri.Free(DecompressedData);
 
@@ -769,7 +889,7 @@ static uint32_t DecompressIDATs(struct BufferedFile *BF, uint8_t **Buffer)
 	 *  Set the output of this function.
 	 */
 
-	DecompressedDataLength = puffDestLen;
+	DecompressedDataLength = InflateDestLen;
 	*Buffer = DecompressedData;
 
 	return(DecompressedDataLength);
@@ -814,177 +934,469 @@ static uint8_t PredictPaeth(uint8_t a, uint8_t b, uint8_t c)
 }
 
 /*
- *  Reverse the filters.
+ *  Reverse the filters of one scanline.
+ *
+ *  PrevLine is NULL on the first scanline of an image or pass,
+ *  its implicit predecessor is all zeros.
  */
 
-static qboolean UnfilterImage(uint8_t  *DecompressedData, 
-		uint32_t  ImageHeight,
-		uint32_t  BytesPerScanline, 
-		uint32_t  BytesPerPixel)
+static void UnfilterSub(uint8_t *Line, uint32_t Length, uint32_t BytesPerPixel)
 {
-	uint8_t   *DecompPtr;
-	uint8_t   FilterType;
-	uint8_t  *PixelLeft, *PixelUp, *PixelUpLeft;
-	uint32_t  w, h, p;
+	uint32_t i;
 
-	/*
-	 *  some zeros for the filters
-	 */
+	for(i = BytesPerPixel; i < Length; i++)
+	{
+		Line[i] += Line[i - BytesPerPixel];
+	}
+}
 
-	uint8_t Zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+static void UnfilterUp(uint8_t *Line, const uint8_t *PrevLine, uint32_t Length)
+{
+	uint32_t i;
 
-	/*
-	 *  input verification
-	 */
+	i = 0;
 
-	if(!(DecompressedData && BytesPerPixel))
+#if defined(PNG_SIMD_SSE2)
+	for(; i + 16 <= Length; i += 16)
 	{
-		return(qfalse);
+		__m128i d = _mm_loadu_si128((const __m128i *) (Line + i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (PrevLine + i));
+
+		_mm_storeu_si128((__m128i *) (Line + i), _mm_add_epi8(d, b));
+	}
+#elif defined(PNG_SIMD_NEON)
+	for(; i + 16 <= Length; i += 16)
+	{
+		vst1q_u8(Line + i, vaddq_u8(vld1q_u8(Line + i), vld1q_u8(PrevLine + i)));
 	}
+#endif
 
-	/*
-	 *  ImageHeight and BytesPerScanline can be zero in small interlaced images.
-	 */
+	for(; i < Length; i++)
+	{
+		Line[i] += PrevLine[i];
+	}
+}
 
-	if((!ImageHeight) || (!BytesPerScanline))
+static void UnfilterAverage(uint8_t *Line, const uint8_t *PrevLine, uint32_t Length, uint32_t BytesPerPixel)
+{
+	uint32_t i;
+
+	if(!PrevLine)
 	{
-		return(qtrue);
+		for(i = BytesPerPixel; i < Length; i++)
+		{
+			Line[i] += Line[i - BytesPerPixel] >> 1;
+		}
+
+		return;
 	}
 
-	/*
-	 *  Set the pointer to the start of the decompressed Data.
-	 */
+	for(i = 0; i < BytesPerPixel && i < Length; i++)
+	{
+		Line[i] += PrevLine[i] >> 1;
+	}
 
-	DecompPtr = DecompressedData;
+	for(; i < Length; i++)
+	{
+		Line[i] += (uint8_t) ((((uint16_t) Line[i - BytesPerPixel]) + ((uint16_t) PrevLine[i])) / 2);
+	}
+}
 
-	/*
-	 *  Un-filtering is done in place.
-	 */
+static void UnfilterPaeth(uint8_t *Line, const uint8_t *PrevLine, uint32_t Length, uint32_t BytesPerPixel)
+{
+	uint32_t i;
 
-	/*
-	 *  Go trough all scanlines.
-	 */
+	for(i = 0; i < BytesPerPixel && i < Length; i++)
+	{
+		Line[i] += PrevLine[i];
+	}
 
-	for(h = 0; h < ImageHeight; h++)
+	for(; i < Length; i++)
 	{
-		/*
-		 *  Every scanline starts with a FilterType byte.
-		 */
+		Line[i] += PredictPaeth(Line[i - BytesPerPixel], PrevLine[i], PrevLine[i - BytesPerPixel]);
+	}
+}
 
-		FilterType = *DecompPtr;
-		DecompPtr++;
+#if defined(PNG_SIMD_SSE2) || defined(PNG_SIMD_NEON)
 
-		/*
-		 *  Left pixel of the first byte in a scanline is zero.
-		 */
+/*
+ *  Sub, Average and Paeth depend on the previous pixel of the same scanline,
+ *  so they are vectorized across the bytes of one pixel and walk the scanline
+ *  pixel by pixel. BytesPerPixel is a constant in every inlined copy.
+ */
 
-		PixelLeft = Zeros;
+#if defined(PNG_SIMD_SSE2)
 
-		/*
-		 *  Set PixelUp to previous line only if we are on the second line or above.
-		 *
-		 *  Plus one byte for the FilterType
-		 */
+static ID_INLINE __m128i LoadPixel(const uint8_t *Ptr, const uint32_t BytesPerPixel)
+{
+	uint64_t v = 0;
+
+	memcpy(&v, Ptr, BytesPerPixel);
+
+	return _mm_loadl_epi64((const __m128i *) &v);
+}
+
+static ID_INLINE void StorePixel(uint8_t *Ptr, __m128i Pixel, const uint32_t BytesPerPixel)
+{
+	uint64_t v;
+
+	_mm_storel_epi64((__m128i *) &v, Pixel);
+
+	memcpy(Ptr, &v, BytesPerPixel);
+}
 
-		if(h > 0)
+static ID_INLINE qboolean UnfilterPixels(uint8_t FilterType, uint8_t *Line, const uint8_t *PrevLine, uint32_t Length, const uint32_t BytesPerPixel)
+{
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i One  = _mm_set1_epi8(1);
+	__m128i a, b, c, d;
+	__m128i pa, pb, pc, m, Pr;
+	uint32_t i;
+
+	a = Zero;
+	c = Zero;
+
+	switch(FilterType)
+	{
+		case PNG_FilterType_Sub :
 		{
-			PixelUp = DecompPtr - (BytesPerScanline + 1);
+			for(i = 0; i < Length; i += BytesPerPixel)
+			{
+				a = _mm_add_epi8(a, LoadPixel(Line + i, BytesPerPixel));
+				StorePixel(Line + i, a, BytesPerPixel);
+			}
+
+			return(qtrue);
 		}
-		else
+
+		case PNG_FilterType_Average :
 		{
-			PixelUp = Zeros;
-		}
+			/*
+			 *  _mm_avg_epu8 rounds up, PNG rounds down
+			 */
 
-		/*
-		 * The pixel left to the first pixel of the previous scanline is zero too.
-		 */
+			for(i = 0; i < Length; i += BytesPerPixel)
+			{
+				b = LoadPixel(PrevLine + i, BytesPerPixel);
+				d = LoadPixel(Line + i, BytesPerPixel);
 
-		PixelUpLeft = Zeros;
+				m = _mm_and_si128(_mm_xor_si128(a, b), One);
+				a = _mm_add_epi8(d, _mm_sub_epi8(_mm_avg_epu8(a, b), m));
 
-		/*
-		 *  Cycle trough all pixels of the scanline.
-		 */
+				StorePixel(Line + i, a, BytesPerPixel);
+			}
 
-		for(w = 0; w < (BytesPerScanline / BytesPerPixel); w++)
+			return(qtrue);
+		}
+
+		case PNG_FilterType_Paeth :
 		{
 			/*
-			 *  Cycle trough the bytes of the pixel.
+			 *  a, b and c are kept as 16 bit lanes
 			 */
 
-			for(p = 0; p < BytesPerPixel; p++)
+			for(i = 0; i < Length; i += BytesPerPixel)
 			{
-				switch(FilterType)
-				{ 
-					case PNG_FilterType_None :
-					{
-						/*
-						 *  The byte is unfiltered.
-						 */
+				b = _mm_unpacklo_epi8(LoadPixel(PrevLine + i, BytesPerPixel), Zero);
+				d = _mm_unpacklo_epi8(LoadPixel(Line + i, BytesPerPixel), Zero);
 
-						break;
-					}
+				pa = _mm_sub_epi16(b, c);
+				pb = _mm_sub_epi16(a, c);
+				pc = _mm_add_epi16(pa, pb);
 
-					case PNG_FilterType_Sub :
-					{
-						DecompPtr[p] += PixelLeft[p];
+				pa = _mm_max_epi16(pa, _mm_sub_epi16(Zero, pa));
+				pb = _mm_max_epi16(pb, _mm_sub_epi16(Zero, pb));
+				pc = _mm_max_epi16(pc, _mm_sub_epi16(Zero, pc));
 
-						break;
-					}
+				/*
+				 *  pb <= pc ? b : c
+				 */
 
-					case PNG_FilterType_Up :
-					{
-						DecompPtr[p] += PixelUp[p];
+				m  = _mm_cmpgt_epi16(pb, pc);
+				Pr = _mm_or_si128(_mm_and_si128(m, c), _mm_andnot_si128(m, b));
 
-						break;
-					}
+				/*
+				 *  pa <= pb && pa <= pc ? a : Pr
+				 */
 
-					case PNG_FilterType_Average :
-					{
-						DecompPtr[p] += ((uint8_t) ((((uint16_t) PixelLeft[p]) + ((uint16_t) PixelUp[p])) / 2));
+				m  = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+				Pr = _mm_or_si128(_mm_and_si128(m, Pr), _mm_andnot_si128(m, a));
 
-						break;
-					}
+				a = _mm_unpacklo_epi8(_mm_add_epi8(_mm_packus_epi16(d, d), _mm_packus_epi16(Pr, Pr)), Zero);
+				c = b;
 
-					case PNG_FilterType_Paeth :
-					{
-						DecompPtr[p] += PredictPaeth(PixelLeft[p], PixelUp[p], PixelUpLeft[p]);
+				StorePixel(Line + i, _mm_packus_epi16(a, a), BytesPerPixel);
+			}
 
-						break;
-					}
+			return(qtrue);
+		}
+	}
 
-					default :
-					{
-						return(qfalse);
-					}
-				}
+	return(qfalse);
+}
+
+#else
+
+static ID_INLINE uint8x8_t LoadPixel(const uint8_t *Ptr, const uint32_t BytesPerPixel)
+{
+	uint64_t v = 0;
+
+	memcpy(&v, Ptr, BytesPerPixel);
+
+	return vcreate_u8(v);
+}
+
+static ID_INLINE void StorePixel(uint8_t *Ptr, uint8x8_t Pixel, const uint32_t BytesPerPixel)
+{
+	uint64_t v;
+
+	v = vget_lane_u64(vreinterpret_u64_u8(Pixel), 0);
+
+	memcpy(Ptr, &v, BytesPerPixel);
+}
+
+static ID_INLINE qboolean UnfilterPixels(uint8_t FilterType, uint8_t *Line, const uint8_t *PrevLine, uint32_t Length, const uint32_t BytesPerPixel)
+{
+	uint8x8_t a, b, c, d;
+	int16x8_t a16, b16, c16;
+	int16x8_t pa, pb, pc, Pr;
+	uint16x8_t m;
+	uint32_t i;
+
+	a = vdup_n_u8(0);
+	c = vdup_n_u8(0);
+
+	switch(FilterType)
+	{
+		case PNG_FilterType_Sub :
+		{
+			for(i = 0; i < Length; i += BytesPerPixel)
+			{
+				a = vadd_u8(a, LoadPixel(Line + i, BytesPerPixel));
+				StorePixel(Line + i, a, BytesPerPixel);
 			}
 
-			PixelLeft = DecompPtr;
+			return(qtrue);
+		}
 
+		case PNG_FilterType_Average :
+		{
 			/*
-			 *  We only have an upleft pixel if we are on the second line or above.
+			 *  vhadd_u8 rounds down, just like PNG
 			 */
 
-			if(h > 0)
+			for(i = 0; i < Length; i += BytesPerPixel)
 			{
-				PixelUpLeft = DecompPtr - (BytesPerScanline + 1);
+				b = LoadPixel(PrevLine + i, BytesPerPixel);
+				d = LoadPixel(Line + i, BytesPerPixel);
+
+				a = vadd_u8(d, vhadd_u8(a, b));
+
+				StorePixel(Line + i, a, BytesPerPixel);
 			}
 
-			/*
-			 *  Skip to the next pixel.
-			 */
+			return(qtrue);
+		}
 
-			DecompPtr += BytesPerPixel;
+		case PNG_FilterType_Paeth :
+		{
+			for(i = 0; i < Length; i += BytesPerPixel)
+			{
+				b = LoadPixel(PrevLine + i, BytesPerPixel);
+				d = LoadPixel(Line + i, BytesPerPixel);
+
+				a16 = vreinterpretq_s16_u16(vmovl_u8(a));
+				b16 = vreinterpretq_s16_u16(vmovl_u8(b));
+				c16 = vreinterpretq_s16_u16(vmovl_u8(c));
+
+				pa = vabdq_s16(b16, c16);
+				pb = vabdq_s16(a16, c16);
+				pc = vabdq_s16(vaddq_s16(a16, b16), vaddq_s16(c16, c16));
+
+				/*
+				 *  pb <= pc ? b : c
+				 */
+
+				m  = vcleq_s16(pb, pc);
+				Pr = vbslq_s16(m, b16, c16);
+
+				/*
+				 *  pa <= pb && pa <= pc ? a : Pr
+				 */
+
+				m  = vandq_u16(vcleq_s16(pa, pb), vcleq_s16(pa, pc));
+				Pr = vbslq_s16(m, a16, Pr);
+
+				a = vadd_u8(d, vmovn_u16(vreinterpretq_u16_s16(Pr)));
+				c = b;
+
+				StorePixel(Line + i, a, BytesPerPixel);
+			}
+
+			return(qtrue);
+		}
+	}
+
+	return(qfalse);
+}
+
+#endif
+
+static qboolean UnfilterScanlineSIMD(uint8_t FilterType, uint8_t *Line, const uint8_t *PrevLine, uint32_t Length, uint32_t BytesPerPixel)
+{
+	switch(BytesPerPixel)
+	{
+		case 3 :
+		{
+			return(UnfilterPixels(FilterType, Line, PrevLine, Length, 3));
+		}
+
+		case 4 :
+		{
+			return(UnfilterPixels(FilterType, Line, PrevLine, Length, 4));
+		}
+
+		case 8 :
+		{
+			return(UnfilterPixels(FilterType, Line, PrevLine, Length, 8));
+		}
+	}
+
+	return(qfalse);
+}
+
+#endif
+
+static qboolean UnfilterScanline(uint8_t FilterType, uint8_t *Line, const uint8_t *PrevLine, uint32_t Length, uint32_t BytesPerPixel)
+{
+	/*
+	 *  With an all-zero predecessor Up does nothing and Paeth predicts the left pixel.
+	 */
+
+	if(!PrevLine)
+	{
+		if(FilterType == PNG_FilterType_Up)
+		{
+			FilterType = PNG_FilterType_None;
+		}
+		else if(FilterType == PNG_FilterType_Paeth)
+		{
+			FilterType = PNG_FilterType_Sub;
+		}
+	}
 
+#if defined(PNG_SIMD_SSE2) || defined(PNG_SIMD_NEON)
+	if((FilterType == PNG_FilterType_Sub) || PrevLine)
+	{
+		if(UnfilterScanlineSIMD(FilterType, Line, PrevLine, Length, BytesPerPixel))
+		{
+			return(qtrue);
+		}
+	}
+#endif
+
+	switch(FilterType)
+	{ 
+		case PNG_FilterType_None :
+		{
 			/*
-			 *  We only have a previous line if we are on the second line and above.
+			 *  The scanline is unfiltered.
 			 */
 
-			if(h > 0)
-			{
-				PixelUp = DecompPtr - (BytesPerScanline + 1);
-			}
+			return(qtrue);
+		}
+
+		case PNG_FilterType_Sub :
+		{
+			UnfilterSub(Line, Length, BytesPerPixel);
+
+			return(qtrue);
+		}
+
+		case PNG_FilterType_Up :
+		{
+			UnfilterUp(Line, PrevLine, Length);
+
+			return(qtrue);
+		}
+
+		case PNG_FilterType_Average :
+		{
+			UnfilterAverage(Line, PrevLine, Length, BytesPerPixel);
+
+			return(qtrue);
+		}
+
+		case PNG_FilterType_Paeth :
+		{
+			UnfilterPaeth(Line, PrevLine, Length, BytesPerPixel);
+
+			return(qtrue);
+		}
+	}
+
+	return(qfalse);
+}
+
+/*
+ *  Reverse the filters.
+ */
+
+static qboolean UnfilterImage(uint8_t  *DecompressedData, 
+		uint32_t  ImageHeight,
+		uint32_t  BytesPerScanline, 
+		uint32_t  BytesPerPixel)
+{
+	uint8_t   *DecompPtr;
+	uint8_t   *PrevLine;
+	uint8_t   FilterType;
+	uint32_t  h;
+
+	/*
+	 *  input verification
+	 */
+
+	if(!(DecompressedData && BytesPerPixel))
+	{
+		return(qfalse);
+	}
+
+	/*
+	 *  ImageHeight and BytesPerScanline can be zero in small interlaced images.
+	 */
+
+	if((!ImageHeight) || (!BytesPerScanline))
+	{
+		return(qtrue);
+	}
+
+	/*
+	 *  Set the pointer to the start of the decompressed Data.
+	 */
+
+	DecompPtr = DecompressedData;
+	PrevLine  = NULL;
+
+	/*
+	 *  Un-filtering is done in place, scanline by scanline.
+	 */
+
+	for(h = 0; h < ImageHeight; h++)
+	{
+		/*
+		 *  Every scanline starts with a FilterType byte.
+		 */
+
+		FilterType = *DecompPtr;
+		DecompPtr++;
+
+		if(!UnfilterScanline(FilterType, DecompPtr, PrevLine, BytesPerScanline, BytesPerPixel))
+		{
+			return(qfalse);
 		}
+
+		PrevLine   = DecompPtr;
+		DecompPtr += BytesPerScanline;
 	}
 
 	return(qtrue);
@@ -1898,12 +2310,11 @@ static qboolean DecodeImageInterlaced(struct PNG_Chunk_IHDR *IHDR,
 }
 
 /*
- *  The PNG loader
+ *  The PNG decoder, closes ThePNG when done
  */
 
-void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
+static void DecodePNG(struct BufferedFile *ThePNG, const char *name, byte **pic, int *width, int *height, qboolean quiet)
 {
-	struct BufferedFile *ThePNG;
 	byte *OutBuffer;
 	uint8_t *Signature;
 	struct PNG_ChunkHeader *CH;
@@ -1931,41 +2342,6 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	qboolean HasTransparentColour = qfalse;
 	uint8_t TransparentColour[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
-	/*
-	 *  input verification
-	 */
-
-	if(!(name && pic))
-	{
-		return;
-	}
-
-	/*
-	 *  Zero out return values.
-	 */
-
-	*pic = NULL;
-
-	if(width)
-	{
-		*width = 0;
-	}
-
-	if(height)
-	{
-		*height = 0;
-	}
-
-	/*
-	 *  Read the file.
-	 */
-
-	ThePNG = ReadBufferedFile(name);
-	if(!ThePNG)
-	{
-		return;
-	}           
-
 	/*
 	 *  Read the signature of the file.
 	 */
@@ -2063,7 +2439,10 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	{
 		CloseBufferedFile(ThePNG);
 
-		ri.Printf( PRINT_WARNING, "%s: invalid image size\n", name );
+		if(!quiet)
+		{
+			ri.Printf( PRINT_WARNING, "%s: invalid image size\n", name );
+		}
 
 		return; 
 	}
@@ -2387,7 +2766,7 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 	 *  Decompress all IDAT chunks
 	 */
 
-	DecompressedDataLength = DecompressIDATs(ThePNG, &DecompressedData);
+	DecompressedDataLength = DecompressIDATs(ThePNG, &DecompressedData, FilteredImageSize(IHDR));
 	if ( DecompressedDataLength == (unsigned)-1 )
 		DecompressedDataLength = 0;
 
@@ -2486,3 +2865,71 @@ void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
 
 	CloseBufferedFile(ThePNG);
 }
+
+/*
+ *  The PNG loader
+ */
+
+void R_LoadPNG(const char *name, byte **pic, int *width, int *height)
+{
+	struct BufferedFile *ThePNG;
+
+	/*
+	 *  input verification
+	 */
+
+	if(!(name && pic))
+	{
+		return;
+	}
+
+	/*
+	 *  Zero out return values.
+	 */
+
+	*pic = NULL;
+
+	if(width)
+	{
+		*width = 0;
+	}
+
+	if(height)
+	{
+		*height = 0;
+	}
+
+	/*
+	 *  Read the file.
+	 */
+
+	ThePNG = ReadBufferedFile(name);
+	if(!ThePNG)
+	{
+		return;
+	}
+
+	DecodePNG(ThePNG, name, pic, width, height, qfalse);
+}
+
+/*
+ *  Decode a PNG file that has already been read into memory,
+ *  does not print anything so it may be called from worker threads
+ */
+
+void R_DecodePNG(const char *name, const byte *data, int length, byte **pic, int *width, int *height)
+{
+	struct BufferedFile *ThePNG;
+
+	*pic = NULL;
+	*width = 0;
+	*height = 0;
+
+	ThePNG = OpenBufferedMemory(data, length);
+	if(!ThePNG)
+	{
+		return;
+	}
+
+	DecodePNG(ThePNG, name, pic, width, height, qtrue);
+}
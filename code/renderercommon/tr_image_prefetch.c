@@ -0,0 +1,664 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+
+#include "../qcommon/q_shared.h"
+#include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_image_cache.h"
+
+/*
+========================================================================
+
+Image prefetch
+
+While a map is loading, the images referenced by its shaders are located
+on the main thread (the file system is not thread-safe) then read and
+decoded by worker threads. R_LoadImage then picks up the decoded pixels,
+an image that no worker has started on yet is handled on the spot by the
+caller.
+
+The decoders used here never print or raise errors, any failure leaves
+the image to the regular loaders so the usual diagnostics are shown.
+
+When the compressed texture cache is enabled the source files are also
+hashed here, images that already have a cache entry are not decoded.
+
+========================================================================
+*/
+
+#define MAX_PREFETCH_IMAGES		2048
+#define MAX_PREFETCH_THREADS	8
+#define PREFETCH_HASH_SIZE		512
+#define PREFETCH_MAX_PENDING	(256*1024*1024) // file and decoded bytes not taken by R_LoadImage yet
+
+void R_DecodeJPG( const char *name, const byte *data, int length, byte **pic, int *width, int *height );
+void R_DecodePNG( const char *name, const byte *data, int length, byte **pic, int *width, int *height );
+void R_DecodeTGA( const char *name, const byte *data, int length, byte **pic, int *width, int *height );
+
+typedef void (*imageDecoder_t)( const char *name, const byte *data, int length, byte **pic, int *width, int *height );
+
+typedef struct {
+	const char		*ext;
+	imageDecoder_t	Decode;		// NULL if the format is always left to the main thread
+} prefetchLoader_t;
+
+// must follow the order of preference of imageLoaders in tr_image.c
+static const prefetchLoader_t prefetchLoaders[] =
+{
+	{ "png",  R_DecodePNG },
+	{ "tga",  R_DecodeTGA },
+	{ "jpg",  R_DecodeJPG },
+	{ "jpeg", R_DecodeJPG },
+	{ "pcx",  NULL },
+	{ "bmp",  NULL }
+};
+
+static const int numPrefetchLoaders = ARRAY_LEN( prefetchLoaders );
+
+typedef struct prefetchImage_s {
+	char			name[MAX_QPATH];		// as requested from R_FindImageFile
+	char			localName[MAX_QPATH];	// file that will be read
+	imageDecoder_t	Decode;
+	void			*location;				// from FS_LocateFile, NULL if there is no file
+	int				length;
+	byte			*pic;
+	int				width;
+	int				height;
+	int				pendingBytes;			// accounted in prefetch.pendingBytes
+	uint64_t		cacheSalt;				// texture cache salt of the image flags or 0
+	uint64_t		hash;					// source file hash for the texture cache
+	qboolean		hashed;
+	volatile int	claimed;
+	volatile int	done;
+	struct prefetchImage_s *next;
+} prefetchImage_t;
+
+static struct {
+	prefetchImage_t	*images;
+	int				numImages;
+	int				numUsed;
+	qboolean		started;
+	prefetchImage_t	*hashTable[PREFETCH_HASH_SIZE];
+	uint64_t		*cacheKeys;				// sorted keys of the existing cache files
+	int				numCacheKeys;
+	void			*threads[MAX_PREFETCH_THREADS];
+	int				numThreads;
+	void			*space;					// posted when pendingBytes drops
+	void			*finished;				// posted when an image is done
+	volatile int	spaceWaiting;
+	volatile int	mainWaiting;
+	volatile int	nextImage;
+	volatile int	pendingBytes;
+	volatile int	shutdown;
+} prefetch;
+
+
+/*
+================
+R_PrefetchHash
+================
+*/
+static int R_PrefetchHash( const char *name ) {
+	unsigned hash = 0;
+
+	while ( *name ) {
+		hash = hash * 31 + locase[ (byte)*name++ ];
+	}
+
+	return hash & ( PREFETCH_HASH_SIZE - 1 );
+}
+
+
+/*
+================
+R_FindPrefetchImage
+================
+*/
+static prefetchImage_t *R_FindPrefetchImage( const char *name, int hash ) {
+	prefetchImage_t *img;
+
+	for ( img = prefetch.hashTable[ hash ]; img; img = img->next ) {
+		if ( !Q_stricmp( img->name, name ) ) {
+			return img;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+================
+R_AddImagePrefetch
+
+Queues an image to be decoded by R_StartImagePrefetch, cacheSalt is
+the texture cache salt for the flags the image will be loaded with
+================
+*/
+void R_AddImagePrefetch( const char *name, uint64_t cacheSalt ) {
+	prefetchImage_t *img;
+	int hash;
+
+	if ( prefetch.started || !name[0] || strlen( name ) >= MAX_QPATH ) {
+		return;
+	}
+
+	hash = R_PrefetchHash( name );
+	if ( R_FindPrefetchImage( name, hash ) ) {
+		return;
+	}
+
+	if ( prefetch.images == NULL ) {
+		prefetch.images = ri.Malloc( MAX_PREFETCH_IMAGES * sizeof( prefetchImage_t ) );
+		prefetch.numImages = 0;
+	}
+
+	if ( prefetch.numImages >= MAX_PREFETCH_IMAGES ) {
+		return;
+	}
+
+	img = &prefetch.images[ prefetch.numImages++ ];
+	Com_Memset( img, 0, sizeof( *img ) );
+	Q_strncpyz( img->name, name, sizeof( img->name ) );
+	img->cacheSalt = cacheSalt;
+	img->next = prefetch.hashTable[ hash ];
+	prefetch.hashTable[ hash ] = img;
+}
+
+
+/*
+================
+R_LocateImageSource
+
+Finds the file that R_LoadImage would pick for this name, returns
+the index of its loader or -1 if there is no such file
+================
+*/
+static int R_LocateImageSource( const char *name, void **location, int *length, char *localName, int localNameSize ) {
+	char baseName[MAX_QPATH];
+	char altName[MAX_QPATH];
+	const char *ext;
+	int orgLoader = -1;
+	int i;
+
+	Q_strncpyz( baseName, name, sizeof( baseName ) );
+
+	ext = COM_GetExtension( name );
+	if ( *ext ) {
+		for ( i = 0; i < numPrefetchLoaders; i++ ) {
+			if ( !Q_stricmp( ext, prefetchLoaders[ i ].ext ) ) {
+				*location = ri.FS_LocateFile( name, length );
+				if ( *location ) {
+					Q_strncpyz( localName, name, localNameSize );
+					return i;
+				}
+				orgLoader = i;
+				COM_StripExtension( name, baseName, sizeof( baseName ) );
+				break;
+			}
+		}
+	}
+
+	for ( i = 0; i < numPrefetchLoaders; i++ ) {
+		if ( i == orgLoader ) {
+			continue;
+		}
+		Com_sprintf( altName, sizeof( altName ), "%s.%s", baseName, prefetchLoaders[ i ].ext );
+		*location = ri.FS_LocateFile( altName, length );
+		if ( *location ) {
+			Q_strncpyz( localName, altName, localNameSize );
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+/*
+================
+R_CompareCacheKeys
+================
+*/
+static int R_CompareCacheKeys( const void *a, const void *b ) {
+	const uint64_t ka = *(const uint64_t *)a;
+	const uint64_t kb = *(const uint64_t *)b;
+
+	return ( ka > kb ) - ( ka < kb );
+}
+
+
+/*
+================
+R_ListImageCache
+
+Collects the keys of the existing cache files so that workers
+can tell a cache hit without the file system
+================
+*/
+static void R_ListImageCache( void ) {
+	char **files;
+	const char *s;
+	uint64_t key;
+	int numFiles, i, n, c;
+
+	files = ri.FS_ListFiles( "texcache", ".tc", &numFiles );
+	if ( !files ) {
+		return;
+	}
+
+	prefetch.cacheKeys = ri.Malloc( ( numFiles + 1 ) * sizeof( uint64_t ) );
+
+	for ( i = 0; i < numFiles; i++ ) {
+		key = 0;
+		for ( s = files[ i ], n = 0; n < 16; s++, n++ ) {
+			c = locase[ (byte)*s ];
+			if ( c >= '0' && c <= '9' ) {
+				c -= '0';
+			} else if ( c >= 'a' && c <= 'f' ) {
+				c -= 'a' - 10;
+			} else {
+				break;
+			}
+			key = ( key << 4 ) | c;
+		}
+		if ( n == 16 && !Q_stricmp( s, ".tc" ) ) {
+			prefetch.cacheKeys[ prefetch.numCacheKeys++ ] = key;
+		}
+	}
+
+	ri.FS_FreeFileList( files );
+
+	qsort( prefetch.cacheKeys, prefetch.numCacheKeys, sizeof( uint64_t ), R_CompareCacheKeys );
+}
+
+
+/*
+================
+R_ProcessPrefetchImage
+
+Reads, hashes and decodes the image on whichever thread claimed it,
+the texture cache is checked against the list of R_ListImageCache
+================
+*/
+static void R_ProcessPrefetchImage( prefetchImage_t *img ) {
+	uint64_t key;
+	byte *data;
+
+	if ( !img->location || ( !img->Decode && !img->cacheSalt ) ) {
+		return;
+	}
+
+	data = ri.Malloc( img->length + 1 );
+	if ( !ri.FS_ReadLocatedFile( img->location, data ) ) {
+		ri.Free( data );
+		return;
+	}
+
+	if ( img->cacheSalt ) {
+		img->hash = R_ImageCacheHash( IMAGECACHE_HASH_INIT, data, img->length );
+		img->hashed = qtrue;
+		key = R_ImageCacheKey( img->hash, img->cacheSalt );
+		if ( bsearch( &key, prefetch.cacheKeys, prefetch.numCacheKeys, sizeof( uint64_t ), R_CompareCacheKeys ) ) {
+			ri.Free( data );
+			return;
+		}
+	}
+
+	if ( img->Decode && img->length > 0 ) {
+		img->Decode( img->localName, data, img->length, &img->pic, &img->width, &img->height );
+	}
+
+	ri.Free( data );
+}
+
+
+/*
+================
+R_ReleasePrefetchBytes
+================
+*/
+static void R_ReleasePrefetchBytes( int bytes ) {
+
+	Q_AtomicAdd( &prefetch.pendingBytes, -bytes );
+
+	if ( Q_AtomicLoad( &prefetch.spaceWaiting ) ) {
+		ri.Sys_PostSemaphore( prefetch.space, Q_AtomicExchange( &prefetch.spaceWaiting, 0 ) );
+	}
+}
+
+
+/*
+================
+R_ReservePrefetchBytes
+
+Keeps the workers from running too far ahead of the main thread,
+sleeps until enough of the earlier images have been taken.
+Returns qfalse on shutdown.
+================
+*/
+static qboolean R_ReservePrefetchBytes( int bytes ) {
+	int pending;
+
+	while ( !Q_AtomicLoad( &prefetch.shutdown ) ) {
+
+		// workers may overshoot the limit by one file each
+		pending = Q_AtomicLoad( &prefetch.pendingBytes );
+		if ( pending == 0 || pending + bytes <= PREFETCH_MAX_PENDING ) {
+			Q_AtomicAdd( &prefetch.pendingBytes, bytes );
+			return qtrue;
+		}
+
+		Q_AtomicAdd( &prefetch.spaceWaiting, 1 );
+		pending = Q_AtomicLoad( &prefetch.pendingBytes );
+		if ( pending == 0 || pending + bytes <= PREFETCH_MAX_PENDING || Q_AtomicLoad( &prefetch.shutdown ) ) {
+			continue; // the extra post only causes one more check
+		}
+		ri.Sys_WaitSemaphore( prefetch.space );
+	}
+
+	return qfalse;
+}
+
+
+/*
+================
+R_PrefetchThread
+================
+*/
+static void R_PrefetchThread( void *arg ) {
+	prefetchImage_t *img;
+	int index, pending;
+
+	while ( !Q_AtomicLoad( &prefetch.shutdown ) ) {
+
+		index = Q_AtomicAdd( &prefetch.nextImage, 1 ) - 1;
+		if ( index >= prefetch.numImages ) {
+			break;
+		}
+
+		img = &prefetch.images[ index ];
+		if ( Q_AtomicLoad( &img->claimed ) || !img->location ) {
+			continue;
+		}
+
+		// the file stays accounted until its pixels are taken
+		if ( !R_ReservePrefetchBytes( img->length ) ) {
+			break;
+		}
+
+		if ( Q_AtomicTestAndSet( &img->claimed ) ) {
+			R_ReleasePrefetchBytes( img->length );
+			continue; // taken by R_ClaimPrefetchImage meanwhile
+		}
+
+		R_ProcessPrefetchImage( img );
+
+		pending = img->pic ? img->width * img->height * 4 : 0;
+		img->pendingBytes = pending;
+		if ( pending > img->length ) {
+			Q_AtomicAdd( &prefetch.pendingBytes, pending - img->length );
+		} else {
+			R_ReleasePrefetchBytes( img->length - pending );
+		}
+
+		Q_AtomicOr( &img->done, 1 );
+
+		if ( Q_AtomicExchange( &prefetch.mainWaiting, 0 ) ) {
+			ri.Sys_PostSemaphore( prefetch.finished, 1 );
+		}
+	}
+}
+
+
+/*
+================
+R_StartImagePrefetch
+
+Locates all queued images and starts reading and decoding them in the
+background
+================
+*/
+void R_StartImagePrefetch( void ) {
+	prefetchImage_t *img;
+	qboolean cached;
+	int i, loader, numThreads;
+
+	if ( prefetch.started || prefetch.numImages == 0 ) {
+		return;
+	}
+
+	prefetch.started = qtrue;
+
+	cached = qfalse;
+	for ( i = 0; i < prefetch.numImages; i++ ) {
+		img = &prefetch.images[ i ];
+		loader = R_LocateImageSource( img->name, &img->location, &img->length, img->localName, sizeof( img->localName ) );
+		if ( loader >= 0 ) {
+			img->Decode = prefetchLoaders[ loader ].Decode;
+		}
+		if ( img->cacheSalt ) {
+			cached = qtrue;
+		}
+	}
+
+	if ( cached ) {
+		R_ListImageCache();
+	}
+
+	if ( !ri.Sys_CreateThread ) {
+		return; // handled on demand by the main thread
+	}
+
+	prefetch.space = ri.Sys_CreateSemaphore();
+	prefetch.finished = ri.Sys_CreateSemaphore();
+	if ( !prefetch.space || !prefetch.finished ) {
+		return;
+	}
+
+	// leave one core to the main thread which also decodes on demand
+	numThreads = ri.Sys_NumCPUs() - 1;
+	if ( numThreads > MAX_PREFETCH_THREADS ) {
+		numThreads = MAX_PREFETCH_THREADS;
+	} else if ( numThreads < 1 ) {
+		numThreads = 1;
+	}
+
+	for ( i = 0; i < numThreads; i++ ) {
+		prefetch.threads[ i ] = ri.Sys_CreateThread( R_PrefetchThread, NULL );
+		if ( prefetch.threads[ i ] == NULL ) {
+			break;
+		}
+		prefetch.numThreads++;
+	}
+}
+
+
+/*
+================
+R_ClaimPrefetchImage
+
+Handles the image on the main thread if no worker got to it yet,
+otherwise sleeps until the worker is done with it
+================
+*/
+static void R_ClaimPrefetchImage( prefetchImage_t *img ) {
+
+	if ( !Q_AtomicTestAndSet( &img->claimed ) ) {
+		R_ProcessPrefetchImage( img );
+		Q_AtomicOr( &img->done, 1 );
+		return;
+	}
+
+	while ( !Q_AtomicLoad( &img->done ) ) {
+		Q_AtomicExchange( &prefetch.mainWaiting, 1 );
+		if ( Q_AtomicLoad( &img->done ) ) {
+			break;
+		}
+		ri.Sys_WaitSemaphore( prefetch.finished );
+	}
+}
+
+
+/*
+================
+R_TakePrefetchedImage
+
+Returns qtrue and hands over the decoded pixels if the image has been
+prefetched successfully, localName receives the name of the file used
+================
+*/
+qboolean R_TakePrefetchedImage( const char *name, byte **pic, int *width, int *height, char *localName, int localNameSize ) {
+	prefetchImage_t *img;
+
+	if ( !prefetch.started ) {
+		return qfalse;
+	}
+
+	img = R_FindPrefetchImage( name, R_PrefetchHash( name ) );
+	if ( img == NULL ) {
+		return qfalse;
+	}
+
+	R_ClaimPrefetchImage( img );
+
+	if ( img->pendingBytes ) {
+		R_ReleasePrefetchBytes( img->pendingBytes );
+		img->pendingBytes = 0;
+	}
+
+	if ( img->pic == NULL ) {
+		return qfalse;
+	}
+
+	*pic = img->pic;
+	*width = img->width;
+	*height = img->height;
+	Q_strncpyz( localName, img->localName, localNameSize );
+
+	img->pic = NULL;
+	prefetch.numUsed++;
+
+	return qtrue;
+}
+
+
+/*
+================
+R_HashImageSource
+
+Returns the hash of the file R_LoadImage would use for this name,
+prefetched images are hashed by the thread that read them
+================
+*/
+qboolean R_HashImageSource( const char *name, uint64_t *hash, char *localName, int localNameSize ) {
+	prefetchImage_t *img;
+	void *location;
+	byte *data;
+	int length;
+
+	if ( prefetch.started ) {
+		img = R_FindPrefetchImage( name, R_PrefetchHash( name ) );
+		if ( img ) {
+			R_ClaimPrefetchImage( img );
+			if ( img->hashed ) {
+				*hash = img->hash;
+				Q_strncpyz( localName, img->localName, localNameSize );
+				return qtrue;
+			}
+		}
+	}
+
+	if ( R_LocateImageSource( name, &location, &length, localName, localNameSize ) < 0 ) {
+		return qfalse;
+	}
+
+	data = ri.Malloc( length + 1 );
+	if ( !ri.FS_ReadLocatedFile( location, data ) ) {
+		ri.Free( data );
+		ri.FS_FreeLocation( location );
+		return qfalse;
+	}
+
+	*hash = R_ImageCacheHash( IMAGECACHE_HASH_INIT, data, length );
+
+	ri.Free( data );
+	ri.FS_FreeLocation( location );
+
+	return qtrue;
+}
+
+
+/*
+================
+R_FinishImagePrefetch
+
+Stops the workers and releases images that were never asked for
+================
+*/
+void R_FinishImagePrefetch( void ) {
+	prefetchImage_t *img;
+	int i;
+
+	if ( prefetch.images == NULL ) {
+		return;
+	}
+
+	Q_AtomicOr( &prefetch.shutdown, 1 );
+
+	if ( prefetch.numThreads ) {
+		ri.Sys_PostSemaphore( prefetch.space, prefetch.numThreads );
+	}
+
+	for ( i = 0; i < prefetch.numThreads; i++ ) {
+		ri.Sys_JoinThread( prefetch.threads[ i ] );
+	}
+
+	if ( prefetch.started ) {
+		ri.Printf( PRINT_DEVELOPER, "...%i of %i prefetched images used, %i decoder threads\n",
+			prefetch.numUsed, prefetch.numImages, prefetch.numThreads );
+	}
+
+	if ( prefetch.space ) {
+		ri.Sys_DestroySemaphore( prefetch.space );
+	}
+	if ( prefetch.finished ) {
+		ri.Sys_DestroySemaphore( prefetch.finished );
+	}
+
+	for ( i = 0; i < prefetch.numImages; i++ ) {
+		img = &prefetch.images[ i ];
+		if ( img->location ) {
+			ri.FS_FreeLocation( img->location );
+		}
+		if ( img->pic ) {
+			ri.Free( img->pic );
+		}
+	}
+
+	if ( prefetch.cacheKeys ) {
+		ri.Free( prefetch.cacheKeys );
+	}
+
+	ri.Free( prefetch.images );
+
+	Com_Memset( &prefetch, 0, sizeof( prefetch ) );
+}
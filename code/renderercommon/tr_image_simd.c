@@ -0,0 +1,1306 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+
+#include "../qcommon/q_shared.h"
+#include "../renderercommon/tr_public.h"
+
+#if idx64 || defined(__SSE2__)
+#define IMAGE_SIMD_SSE2
+#include <emmintrin.h>
+#if idx64 && ( defined(__clang__) || ( defined(__GNUC__) && __GNUC__ >= 5 ) || ( defined(_MSC_VER) && _MSC_VER >= 1800 ) )
+#define IMAGE_SIMD_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+#endif
+#elif arm64 || defined(__ARM_NEON)
+#define IMAGE_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+========================================================================
+
+Image kernels
+
+Pixel loops used while uploading textures. Every SIMD variant does the
+same integer arithmetic as the scalar code, so all of them produce the
+same bytes and r_imageSIMD only changes the speed.
+
+========================================================================
+*/
+
+typedef struct {
+	const char *name;
+	void (*ResampleRow)( byte *out, const byte *inrow, const byte *inrow2, const unsigned *p1, const unsigned *p2, int outWidth );
+	void (*BoxRow)( byte *out, const byte *row0, const byte *row1, int outWidth );
+	void (*FilterRows)( uint16_t *out, const byte *r0, const byte *r1, const byte *r2, const byte *r3, int width ); // NULL for the reference filter
+	void (*FilterColumns)( byte *out, const uint16_t *in, int outWidth );
+	void (*BlendRGB)( byte *data, int pixelCount, int inverseAlpha, const int *premult );
+	void (*SwizzleBGRA)( byte *out, const byte *in, int pixelCount );
+	void (*PackRGB)( byte *out, const byte *in, int pixelCount );
+	void (*PackRGBA4)( uint16_t *out, const byte *in, int pixelCount );
+	void (*PackRGB5A1)( uint16_t *out, const byte *in, int pixelCount );
+} imageKernels_t;
+
+// x * 58255 >> 21 == x / 36 for every sum of the 1-2-2-1 filter (x <= 36 * 255)
+#define DIV36_MUL	58255
+#define DIV36_SHIFT	5	// after taking the high 16 bits
+
+// (x + 1 + (x >> 8)) >> 8 == x / 255 for x < 65535
+#define DIV255(x)	( ( (x) + 1 + ( (x) >> 8 ) ) >> 8 )
+
+
+/*
+========================================================================
+
+Scalar kernels
+
+========================================================================
+*/
+
+static void ResampleRow_Scalar( byte *out, const byte *inrow, const byte *inrow2, const unsigned *p1, const unsigned *p2, int outWidth ) {
+	const byte *pix1, *pix2, *pix3, *pix4;
+	int j;
+
+	for ( j = 0; j < outWidth; j++, out += 4 ) {
+		pix1 = inrow + p1[j];
+		pix2 = inrow + p2[j];
+		pix3 = inrow2 + p1[j];
+		pix4 = inrow2 + p2[j];
+		out[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
+		out[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
+		out[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
+		out[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
+	}
+}
+
+
+static void BoxRow_Scalar( byte *out, const byte *in, const byte *in2, int outWidth ) {
+	int j;
+
+	for ( j = 0; j < outWidth; j++, out += 4, in += 8, in2 += 8 ) {
+		out[0] = (in[0] + in[4] + in2[0] + in2[4])>>2;
+		out[1] = (in[1] + in[5] + in2[1] + in2[5])>>2;
+		out[2] = (in[2] + in[6] + in2[2] + in2[6])>>2;
+		out[3] = (in[3] + in[7] + in2[3] + in2[7])>>2;
+	}
+}
+
+
+static void FilterRows_Scalar( uint16_t *out, const byte *r0, const byte *r1, const byte *r2, const byte *r3, int width ) {
+	int i;
+
+	for ( i = 0; i < width * 4; i++ ) {
+		out[i] = r0[i] + 2 * ( r1[i] + r2[i] ) + r3[i];
+	}
+}
+
+
+static void FilterColumns_Scalar( byte *out, const uint16_t *in, int outWidth ) {
+	int j, k;
+
+	for ( j = 0; j < outWidth; j++, out += 4, in += 8 ) {
+		for ( k = 0; k < 4; k++ ) {
+			out[k] = ( in[k] + 2 * ( in[k+4] + in[k+8] ) + in[k+12] ) / 36;
+		}
+	}
+}
+
+
+static void BlendRGB_Scalar( byte *data, int pixelCount, int inverseAlpha, const int *premult ) {
+	int i;
+
+	for ( i = 0 ; i < pixelCount ; i++, data+=4 ) {
+		data[0] = ( data[0] * inverseAlpha + premult[0] ) >> 9;
+		data[1] = ( data[1] * inverseAlpha + premult[1] ) >> 9;
+		data[2] = ( data[2] * inverseAlpha + premult[2] ) >> 9;
+	}
+}
+
+
+static void SwizzleBGRA_Scalar( byte *out, const byte *in, int pixelCount ) {
+	int i;
+
+	for ( i = 0; i < pixelCount; i++, in += 4, out += 4 ) {
+		const byte r = in[0];
+		out[0] = in[2];
+		out[1] = in[1];
+		out[2] = r;
+		out[3] = in[3];
+	}
+}
+
+
+static void PackRGB_Scalar( byte *out, const byte *in, int pixelCount ) {
+	int i;
+
+	for ( i = 0; i < pixelCount; i++, in += 4, out += 3 ) {
+		out[0] = in[0];
+		out[1] = in[1];
+		out[2] = in[2];
+	}
+}
+
+
+// same result as (int)( c / 255.0 * 15.0 + 0.5 ), there are no exact halves
+static void PackRGBA4_Scalar( uint16_t *out, const byte *in, int pixelCount ) {
+	int i;
+
+	for ( i = 0; i < pixelCount; i++, in += 4 ) {
+		const unsigned r = DIV255( in[0] * 15 + 127 );
+		const unsigned g = DIV255( in[1] * 15 + 127 );
+		const unsigned b = DIV255( in[2] * 15 + 127 );
+		const unsigned a = DIV255( in[3] * 15 + 127 );
+		out[i] = a | ( r << 4 ) | ( g << 8 ) | ( b << 12 );
+	}
+}
+
+
+static void PackRGB5A1_Scalar( uint16_t *out, const byte *in, int pixelCount ) {
+	int i;
+
+	for ( i = 0; i < pixelCount; i++, in += 4 ) {
+		const unsigned r = DIV255( in[0] * 31 + 127 );
+		const unsigned g = DIV255( in[1] * 31 + 127 );
+		const unsigned b = DIV255( in[2] * 31 + 127 );
+		out[i] = b | ( g << 5 ) | ( r << 10 ) | ( 1 << 15 );
+	}
+}
+
+
+static const imageKernels_t scalarKernels = {
+	"scalar",
+	ResampleRow_Scalar,
+	BoxRow_Scalar,
+	NULL,
+	FilterColumns_Scalar,
+	BlendRGB_Scalar,
+	SwizzleBGRA_Scalar,
+	PackRGB_Scalar,
+	PackRGBA4_Scalar,
+	PackRGB5A1_Scalar
+};
+
+
+#ifdef IMAGE_SIMD_SSE2
+/*
+========================================================================
+
+SSE2 kernels
+
+========================================================================
+*/
+
+static ID_INLINE int LoadPixel32( const byte *p ) {
+	int v;
+	memcpy( &v, p, sizeof( v ) );
+	return v;
+}
+
+
+static void ResampleRow_SSE2( byte *out, const byte *inrow, const byte *inrow2, const unsigned *p1, const unsigned *p2, int outWidth ) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a, b, lo, hi, s;
+	int j;
+
+	for ( j = 0; j + 2 <= outWidth; j += 2 ) {
+		a = _mm_setr_epi32( LoadPixel32( inrow + p1[j] ), LoadPixel32( inrow + p2[j] ),
+			LoadPixel32( inrow + p1[j+1] ), LoadPixel32( inrow + p2[j+1] ) );
+		b = _mm_setr_epi32( LoadPixel32( inrow2 + p1[j] ), LoadPixel32( inrow2 + p2[j] ),
+			LoadPixel32( inrow2 + p1[j+1] ), LoadPixel32( inrow2 + p2[j+1] ) );
+		lo = _mm_add_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ) );
+		hi = _mm_add_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ) );
+		s = _mm_add_epi16( _mm_unpacklo_epi64( lo, hi ), _mm_unpackhi_epi64( lo, hi ) );
+		s = _mm_srli_epi16( s, 2 );
+		_mm_storel_epi64( (__m128i *)( out + j * 4 ), _mm_packus_epi16( s, s ) );
+	}
+
+	ResampleRow_Scalar( out + j * 4, inrow, inrow2, p1 + j, p2 + j, outWidth - j );
+}
+
+
+// out may point to in, it never passes the input that is still to be read
+static void BoxRow_SSE2( byte *out, const byte *in, const byte *in2, int outWidth ) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a0, a1, b0, b1, s0, s1, s2, s3, h0, h1;
+	int j;
+
+	for ( j = 0; j + 4 <= outWidth; j += 4 ) {
+		a0 = _mm_loadu_si128( (const __m128i *)( in + j * 8 ) );
+		a1 = _mm_loadu_si128( (const __m128i *)( in + j * 8 + 16 ) );
+		b0 = _mm_loadu_si128( (const __m128i *)( in2 + j * 8 ) );
+		b1 = _mm_loadu_si128( (const __m128i *)( in2 + j * 8 + 16 ) );
+		s0 = _mm_add_epi16( _mm_unpacklo_epi8( a0, zero ), _mm_unpacklo_epi8( b0, zero ) );
+		s1 = _mm_add_epi16( _mm_unpackhi_epi8( a0, zero ), _mm_unpackhi_epi8( b0, zero ) );
+		s2 = _mm_add_epi16( _mm_unpacklo_epi8( a1, zero ), _mm_unpacklo_epi8( b1, zero ) );
+		s3 = _mm_add_epi16( _mm_unpackhi_epi8( a1, zero ), _mm_unpackhi_epi8( b1, zero ) );
+		h0 = _mm_add_epi16( _mm_unpacklo_epi64( s0, s1 ), _mm_unpackhi_epi64( s0, s1 ) );
+		h1 = _mm_add_epi16( _mm_unpacklo_epi64( s2, s3 ), _mm_unpackhi_epi64( s2, s3 ) );
+		h0 = _mm_srli_epi16( h0, 2 );
+		h1 = _mm_srli_epi16( h1, 2 );
+		_mm_storeu_si128( (__m128i *)( out + j * 4 ), _mm_packus_epi16( h0, h1 ) );
+	}
+
+	BoxRow_Scalar( out + j * 4, in + j * 8, in2 + j * 8, outWidth - j );
+}
+
+
+static void FilterRows_SSE2( uint16_t *out, const byte *r0, const byte *r1, const byte *r2, const byte *r3, int width ) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a, b, c, d, lo, hi;
+	int i;
+
+	for ( i = 0; i + 4 <= width; i += 4 ) {
+		a = _mm_loadu_si128( (const __m128i *)( r0 + i * 4 ) );
+		b = _mm_loadu_si128( (const __m128i *)( r1 + i * 4 ) );
+		c = _mm_loadu_si128( (const __m128i *)( r2 + i * 4 ) );
+		d = _mm_loadu_si128( (const __m128i *)( r3 + i * 4 ) );
+		lo = _mm_add_epi16( _mm_unpacklo_epi8( b, zero ), _mm_unpacklo_epi8( c, zero ) );
+		hi = _mm_add_epi16( _mm_unpackhi_epi8( b, zero ), _mm_unpackhi_epi8( c, zero ) );
+		lo = _mm_add_epi16( _mm_slli_epi16( lo, 1 ), _mm_add_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( d, zero ) ) );
+		hi = _mm_add_epi16( _mm_slli_epi16( hi, 1 ), _mm_add_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( d, zero ) ) );
+		_mm_storeu_si128( (__m128i *)( out + i * 4 ), lo );
+		_mm_storeu_si128( (__m128i *)( out + i * 4 + 8 ), hi );
+	}
+
+	FilterRows_Scalar( out + i * 4, r0 + i * 4, r1 + i * 4, r2 + i * 4, r3 + i * 4, width - i );
+}
+
+
+// sums two neighbouring output pixels from three pairs of column sums
+static ID_INLINE __m128i FilterPair_SSE2( __m128i a, __m128i b, __m128i c ) {
+	const __m128i t0 = _mm_add_epi16( a, _mm_shuffle_epi32( b, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	const __m128i t1 = _mm_add_epi16( b, _mm_shuffle_epi32( c, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	const __m128i s = _mm_add_epi16( _mm_unpacklo_epi64( t0, t1 ), _mm_slli_epi16( _mm_unpackhi_epi64( t0, t1 ), 1 ) );
+	return _mm_srli_epi16( _mm_mulhi_epu16( s, _mm_set1_epi16( (short)DIV36_MUL ) ), DIV36_SHIFT );
+}
+
+
+static void FilterColumns_SSE2( byte *out, const uint16_t *in, int outWidth ) {
+	__m128i a, b, c, d, e;
+	int j;
+
+	for ( j = 0; j + 4 <= outWidth; j += 4 ) {
+		a = _mm_loadu_si128( (const __m128i *)( in + j * 8 ) );
+		b = _mm_loadu_si128( (const __m128i *)( in + j * 8 + 8 ) );
+		c = _mm_loadu_si128( (const __m128i *)( in + j * 8 + 16 ) );
+		d = _mm_loadu_si128( (const __m128i *)( in + j * 8 + 24 ) );
+		e = _mm_loadu_si128( (const __m128i *)( in + j * 8 + 32 ) );
+		_mm_storeu_si128( (__m128i *)( out + j * 4 ), _mm_packus_epi16( FilterPair_SSE2( a, b, c ), FilterPair_SSE2( c, d, e ) ) );
+	}
+
+	FilterColumns_Scalar( out + j * 4, in + j * 8, outWidth - j );
+}
+
+
+static void BlendRGB_SSE2( byte *data, int pixelCount, int inverseAlpha, const int *premult ) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi32( (int)0xFF000000 );
+	const __m128i inv = _mm_set1_epi16( (short)inverseAlpha );
+	const __m128i add = _mm_setr_epi16( premult[0], premult[1], premult[2], 0, premult[0], premult[1], premult[2], 0 );
+	__m128i x, lo, hi;
+	int i;
+
+	// products fit in 16 bits: d * inverseAlpha + c * alpha <= 255 * 255
+	for ( i = 0; i + 4 <= pixelCount; i += 4 ) {
+		x = _mm_loadu_si128( (const __m128i *)( data + i * 4 ) );
+		lo = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( x, zero ), inv ), add ), 9 );
+		hi = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( x, zero ), inv ), add ), 9 );
+		lo = _mm_packus_epi16( lo, hi );
+		_mm_storeu_si128( (__m128i *)( data + i * 4 ), _mm_or_si128( _mm_andnot_si128( alpha, lo ), _mm_and_si128( alpha, x ) ) );
+	}
+
+	BlendRGB_Scalar( data + i * 4, pixelCount - i, inverseAlpha, premult );
+}
+
+
+static void SwizzleBGRA_SSE2( byte *out, const byte *in, int pixelCount ) {
+	const __m128i ga = _mm_set1_epi32( (int)0xFF00FF00 );
+	const __m128i lo = _mm_set1_epi32( 0xFF );
+	__m128i x;
+	int i;
+
+	for ( i = 0; i + 4 <= pixelCount; i += 4 ) {
+		x = _mm_loadu_si128( (const __m128i *)( in + i * 4 ) );
+		x = _mm_or_si128( _mm_and_si128( x, ga ),
+			_mm_or_si128( _mm_and_si128( _mm_srli_epi32( x, 16 ), lo ), _mm_slli_epi32( _mm_and_si128( x, lo ), 16 ) ) );
+		_mm_storeu_si128( (__m128i *)( out + i * 4 ), x );
+	}
+
+	SwizzleBGRA_Scalar( out + i * 4, in + i * 4, pixelCount - i );
+}
+
+
+// converts 4 pixels to 4-bit (or 5-bit) channels, one byte per channel
+static ID_INLINE __m128i Quantize_SSE2( __m128i x, __m128i scale ) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16( 127 );
+	const __m128i one = _mm_set1_epi16( 1 );
+	__m128i lo, hi;
+
+	lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( x, zero ), scale ), bias );
+	hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( x, zero ), scale ), bias );
+	lo = _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( lo, one ), _mm_srli_epi16( lo, 8 ) ), 8 );
+	hi = _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( hi, one ), _mm_srli_epi16( hi, 8 ) ), 8 );
+
+	return _mm_packus_epi16( lo, hi );
+}
+
+
+// packs 32-bit lanes holding values below 0x10000 into 16-bit lanes
+static ID_INLINE __m128i PackU32_SSE2( __m128i a, __m128i b ) {
+	a = _mm_srai_epi32( _mm_slli_epi32( a, 16 ), 16 );
+	b = _mm_srai_epi32( _mm_slli_epi32( b, 16 ), 16 );
+	return _mm_packs_epi32( a, b );
+}
+
+
+static ID_INLINE __m128i RGBA4_SSE2( __m128i q ) {
+	const __m128i m0 = _mm_set1_epi32( 0xFF );
+	const __m128i m1 = _mm_set1_epi32( 0xFF00 );
+	const __m128i m2 = _mm_set1_epi32( 0xFF0000 );
+
+	return _mm_or_si128( _mm_or_si128( _mm_slli_epi32( _mm_and_si128( q, m0 ), 4 ), _mm_and_si128( q, m1 ) ),
+		_mm_or_si128( _mm_srli_epi32( _mm_and_si128( q, m2 ), 4 ), _mm_srli_epi32( q, 24 ) ) );
+}
+
+
+static void PackRGBA4_SSE2( uint16_t *out, const byte *in, int pixelCount ) {
+	const __m128i scale = _mm_set1_epi16( 15 );
+	__m128i a, b;
+	int i;
+
+	for ( i = 0; i + 8 <= pixelCount; i += 8 ) {
+		a = Quantize_SSE2( _mm_loadu_si128( (const __m128i *)( in + i * 4 ) ), scale );
+		b = Quantize_SSE2( _mm_loadu_si128( (const __m128i *)( in + i * 4 + 16 ) ), scale );
+		_mm_storeu_si128( (__m128i *)( out + i ), PackU32_SSE2( RGBA4_SSE2( a ), RGBA4_SSE2( b ) ) );
+	}
+
+	PackRGBA4_Scalar( out + i, in + i * 4, pixelCount - i );
+}
+
+
+static ID_INLINE __m128i RGB5A1_SSE2( __m128i q ) {
+	const __m128i m0 = _mm_set1_epi32( 0xFF );
+	const __m128i m1 = _mm_set1_epi32( 0xFF00 );
+	const __m128i m2 = _mm_set1_epi32( 0xFF0000 );
+
+	return _mm_or_si128( _mm_or_si128( _mm_slli_epi32( _mm_and_si128( q, m0 ), 10 ), _mm_srli_epi32( _mm_and_si128( q, m1 ), 3 ) ),
+		_mm_or_si128( _mm_srli_epi32( _mm_and_si128( q, m2 ), 16 ), _mm_set1_epi32( 0x8000 ) ) );
+}
+
+
+static void PackRGB5A1_SSE2( uint16_t *out, const byte *in, int pixelCount ) {
+	const __m128i scale = _mm_set1_epi16( 31 );
+	__m128i a, b;
+	int i;
+
+	for ( i = 0; i + 8 <= pixelCount; i += 8 ) {
+		a = Quantize_SSE2( _mm_loadu_si128( (const __m128i *)( in + i * 4 ) ), scale );
+		b = Quantize_SSE2( _mm_loadu_si128( (const __m128i *)( in + i * 4 + 16 ) ), scale );
+		_mm_storeu_si128( (__m128i *)( out + i ), PackU32_SSE2( RGB5A1_SSE2( a ), RGB5A1_SSE2( b ) ) );
+	}
+
+	PackRGB5A1_Scalar( out + i, in + i * 4, pixelCount - i );
+}
+
+
+static const imageKernels_t sse2Kernels = {
+	"sse2",
+	ResampleRow_SSE2,
+	BoxRow_SSE2,
+	FilterRows_SSE2,
+	FilterColumns_SSE2,
+	BlendRGB_SSE2,
+	SwizzleBGRA_SSE2,
+	PackRGB_Scalar,
+	PackRGBA4_SSE2,
+	PackRGB5A1_SSE2
+};
+#endif // IMAGE_SIMD_SSE2
+
+
+#ifdef IMAGE_SIMD_AVX2
+/*
+========================================================================
+
+AVX2 kernels, selected at runtime
+
+========================================================================
+*/
+
+AVX2_FUNC static void BoxRow_AVX2( byte *out, const byte *in, const byte *in2, int outWidth ) {
+	const __m256i order = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+	__m256i s0, s1, h;
+	int j;
+
+	for ( j = 0; j + 4 <= outWidth; j += 4 ) {
+		// lanes hold input pixels 0,1 | 2,3 and 4,5 | 6,7
+		s0 = _mm256_add_epi16( _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)( in + j * 8 ) ) ),
+			_mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)( in2 + j * 8 ) ) ) );
+		s1 = _mm256_add_epi16( _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)( in + j * 8 + 16 ) ) ),
+			_mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)( in2 + j * 8 + 16 ) ) ) );
+		h = _mm256_add_epi16( _mm256_unpacklo_epi64( s0, s1 ), _mm256_unpackhi_epi64( s0, s1 ) );
+		h = _mm256_packus_epi16( _mm256_srli_epi16( h, 2 ), _mm256_setzero_si256() );
+		// output pixels end up as 0,2,x,x | 1,3,x,x
+		h = _mm256_permutevar8x32_epi32( h, order );
+		_mm_storeu_si128( (__m128i *)( out + j * 4 ), _mm256_castsi256_si128( h ) );
+	}
+
+	BoxRow_Scalar( out + j * 4, in + j * 8, in2 + j * 8, outWidth - j );
+}
+
+
+AVX2_FUNC static void FilterRows_AVX2( uint16_t *out, const byte *r0, const byte *r1, const byte *r2, const byte *r3, int width ) {
+	__m256i a, b, c, d;
+	int i;
+
+	for ( i = 0; i + 4 <= width; i += 4 ) {
+		a = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)( r0 + i * 4 ) ) );
+		b = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)( r1 + i * 4 ) ) );
+		c = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)( r2 + i * 4 ) ) );
+		d = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)( r3 + i * 4 ) ) );
+		a = _mm256_add_epi16( _mm256_add_epi16( a, d ), _mm256_slli_epi16( _mm256_add_epi16( b, c ), 1 ) );
+		_mm256_storeu_si256( (__m256i *)( out + i * 4 ), a );
+	}
+
+	FilterRows_Scalar( out + i * 4, r0 + i * 4, r1 + i * 4, r2 + i * 4, r3 + i * 4, width - i );
+}
+
+
+AVX2_FUNC static void BlendRGB_AVX2( byte *data, int pixelCount, int inverseAlpha, const int *premult ) {
+	const __m128i alpha = _mm_set1_epi32( (int)0xFF000000 );
+	const __m256i inv = _mm256_set1_epi16( (short)inverseAlpha );
+	const __m256i add = _mm256_setr_epi16( premult[0], premult[1], premult[2], 0, premult[0], premult[1], premult[2], 0,
+		premult[0], premult[1], premult[2], 0, premult[0], premult[1], premult[2], 0 );
+	__m128i x, r;
+	__m256i v;
+	int i;
+
+	for ( i = 0; i + 4 <= pixelCount; i += 4 ) {
+		x = _mm_loadu_si128( (const __m128i *)( data + i * 4 ) );
+		v = _mm256_srli_epi16( _mm256_add_epi16( _mm256_mullo_epi16( _mm256_cvtepu8_epi16( x ), inv ), add ), 9 );
+		v = _mm256_permute4x64_epi64( _mm256_packus_epi16( v, v ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+		r = _mm256_castsi256_si128( v );
+		_mm_storeu_si128( (__m128i *)( data + i * 4 ), _mm_or_si128( _mm_andnot_si128( alpha, r ), _mm_and_si128( alpha, x ) ) );
+	}
+
+	BlendRGB_Scalar( data + i * 4, pixelCount - i, inverseAlpha, premult );
+}
+
+
+AVX2_FUNC static void SwizzleBGRA_AVX2( byte *out, const byte *in, int pixelCount ) {
+	const __m256i order = _mm256_setr_epi8(
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 );
+	__m256i x;
+	int i;
+
+	for ( i = 0; i + 8 <= pixelCount; i += 8 ) {
+		x = _mm256_loadu_si256( (const __m256i *)( in + i * 4 ) );
+		_mm256_storeu_si256( (__m256i *)( out + i * 4 ), _mm256_shuffle_epi8( x, order ) );
+	}
+
+	SwizzleBGRA_Scalar( out + i * 4, in + i * 4, pixelCount - i );
+}
+
+
+AVX2_FUNC static void PackRGB_AVX2( byte *out, const byte *in, int pixelCount ) {
+	const __m128i order = _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+	__m128i x;
+	int i;
+
+	// each store writes 16 bytes of which 12 are used, stay clear of the end
+	for ( i = 0; i + 6 <= pixelCount; i += 4 ) {
+		x = _mm_loadu_si128( (const __m128i *)( in + i * 4 ) );
+		_mm_storeu_si128( (__m128i *)( out + i * 3 ), _mm_shuffle_epi8( x, order ) );
+	}
+
+	PackRGB_Scalar( out + i * 3, in + i * 4, pixelCount - i );
+}
+
+
+static const imageKernels_t avx2Kernels = {
+	"avx2",
+	ResampleRow_SSE2,
+	BoxRow_AVX2,
+	FilterRows_AVX2,
+	FilterColumns_SSE2,
+	BlendRGB_AVX2,
+	SwizzleBGRA_AVX2,
+	PackRGB_AVX2,
+	PackRGBA4_SSE2,
+	PackRGB5A1_SSE2
+};
+#endif // IMAGE_SIMD_AVX2
+
+
+#ifdef IMAGE_SIMD_NEON
+/*
+========================================================================
+
+NEON kernels
+
+========================================================================
+*/
+
+static void ResampleRow_NEON( byte *out, const byte *inrow, const byte *inrow2, const unsigned *p1, const unsigned *p2, int outWidth ) {
+	uint32x2_t a, b;
+	uint16x8_t s;
+	uint16x4_t t;
+	int j;
+
+	a = b = vdup_n_u32( 0 );
+	for ( j = 0; j < outWidth; j++, out += 4 ) {
+		a = vld1_lane_u32( (const uint32_t *)( inrow + p1[j] ), a, 0 );
+		a = vld1_lane_u32( (const uint32_t *)( inrow + p2[j] ), a, 1 );
+		b = vld1_lane_u32( (const uint32_t *)( inrow2 + p1[j] ), b, 0 );
+		b = vld1_lane_u32( (const uint32_t *)( inrow2 + p2[j] ), b, 1 );
+		s = vaddl_u8( vreinterpret_u8_u32( a ), vreinterpret_u8_u32( b ) );
+		t = vshr_n_u16( vadd_u16( vget_low_u16( s ), vget_high_u16( s ) ), 2 );
+		vst1_lane_u32( (uint32_t *)out, vreinterpret_u32_u8( vmovn_u16( vcombine_u16( t, t ) ) ), 0 );
+	}
+}
+
+
+static void BoxRow_NEON( byte *out, const byte *in, const byte *in2, int outWidth ) {
+	uint8x16x4_t a, b;
+	uint8x8x4_t r;
+	int j, k;
+
+	for ( j = 0; j + 8 <= outWidth; j += 8 ) {
+		a = vld4q_u8( in + j * 8 );
+		b = vld4q_u8( in2 + j * 8 );
+		for ( k = 0; k < 4; k++ ) {
+			r.val[k] = vshrn_n_u16( vpadalq_u8( vpaddlq_u8( a.val[k] ), b.val[k] ), 2 );
+		}
+		vst4_u8( out + j * 4, r );
+	}
+
+	BoxRow_Scalar( out + j * 4, in + j * 8, in2 + j * 8, outWidth - j );
+}
+
+
+static void FilterRows_NEON( uint16_t *out, const byte *r0, const byte *r1, const byte *r2, const byte *r3, int width ) {
+	uint8x16_t a, b, c, d;
+	uint16x8_t lo, hi;
+	int i;
+
+	for ( i = 0; i + 4 <= width; i += 4 ) {
+		a = vld1q_u8( r0 + i * 4 );
+		b = vld1q_u8( r1 + i * 4 );
+		c = vld1q_u8( r2 + i * 4 );
+		d = vld1q_u8( r3 + i * 4 );
+		lo = vaddq_u16( vaddl_u8( vget_low_u8( a ), vget_low_u8( d ) ), vshlq_n_u16( vaddl_u8( vget_low_u8( b ), vget_low_u8( c ) ), 1 ) );
+		hi = vaddq_u16( vaddl_u8( vget_high_u8( a ), vget_high_u8( d ) ), vshlq_n_u16( vaddl_u8( vget_high_u8( b ), vget_high_u8( c ) ), 1 ) );
+		vst1q_u16( out + i * 4, lo );
+		vst1q_u16( out + i * 4 + 8, hi );
+	}
+
+	FilterRows_Scalar( out + i * 4, r0 + i * 4, r1 + i * 4, r2 + i * 4, r3 + i * 4, width - i );
+}
+
+
+static void FilterColumns_NEON( byte *out, const uint16_t *in, int outWidth ) {
+	const uint16x4_t div = vdup_n_u16( DIV36_MUL );
+	uint16x8_t a, b, c, t0, t1, s;
+	uint16x4_t lo, hi;
+	int j;
+
+	for ( j = 0; j + 2 <= outWidth; j += 2 ) {
+		a = vld1q_u16( in + j * 8 );
+		b = vld1q_u16( in + j * 8 + 8 );
+		c = vld1q_u16( in + j * 8 + 16 );
+		t0 = vaddq_u16( a, vextq_u16( b, b, 4 ) );
+		t1 = vaddq_u16( b, vextq_u16( c, c, 4 ) );
+		s = vaddq_u16( vcombine_u16( vget_low_u16( t0 ), vget_low_u16( t1 ) ),
+			vshlq_n_u16( vcombine_u16( vget_high_u16( t0 ), vget_high_u16( t1 ) ), 1 ) );
+		lo = vshr_n_u16( vshrn_n_u32( vmull_u16( vget_low_u16( s ), div ), 16 ), DIV36_SHIFT );
+		hi = vshr_n_u16( vshrn_n_u32( vmull_u16( vget_high_u16( s ), div ), 16 ), DIV36_SHIFT );
+		vst1_u8( out + j * 4, vmovn_u16( vcombine_u16( lo, hi ) ) );
+	}
+
+	FilterColumns_Scalar( out + j * 4, in + j * 8, outWidth - j );
+}
+
+
+static void BlendRGB_NEON( byte *data, int pixelCount, int inverseAlpha, const int *premult ) {
+	const uint8x8_t inv = vdup_n_u8( (uint8_t)inverseAlpha );
+	uint8x16x4_t x;
+	uint16x8_t add;
+	int i, k;
+
+	for ( i = 0; i + 16 <= pixelCount; i += 16 ) {
+		x = vld4q_u8( data + i * 4 );
+		for ( k = 0; k < 3; k++ ) {
+			add = vdupq_n_u16( (uint16_t)premult[k] );
+			x.val[k] = vcombine_u8(
+				vmovn_u16( vshrq_n_u16( vmlal_u8( add, vget_low_u8( x.val[k] ), inv ), 9 ) ),
+				vmovn_u16( vshrq_n_u16( vmlal_u8( add, vget_high_u8( x.val[k] ), inv ), 9 ) ) );
+		}
+		vst4q_u8( data + i * 4, x );
+	}
+
+	BlendRGB_Scalar( data + i * 4, pixelCount - i, inverseAlpha, premult );
+}
+
+
+static void SwizzleBGRA_NEON( byte *out, const byte *in, int pixelCount ) {
+	uint8x16x4_t x;
+	uint8x16_t t;
+	int i;
+
+	for ( i = 0; i + 16 <= pixelCount; i += 16 ) {
+		x = vld4q_u8( in + i * 4 );
+		t = x.val[0];
+		x.val[0] = x.val[2];
+		x.val[2] = t;
+		vst4q_u8( out + i * 4, x );
+	}
+
+	SwizzleBGRA_Scalar( out + i * 4, in + i * 4, pixelCount - i );
+}
+
+
+static void PackRGB_NEON( byte *out, const byte *in, int pixelCount ) {
+	uint8x16x4_t x;
+	uint8x16x3_t y;
+	int i;
+
+	for ( i = 0; i + 16 <= pixelCount; i += 16 ) {
+		x = vld4q_u8( in + i * 4 );
+		y.val[0] = x.val[0];
+		y.val[1] = x.val[1];
+		y.val[2] = x.val[2];
+		vst3q_u8( out + i * 3, y );
+	}
+
+	PackRGB_Scalar( out + i * 3, in + i * 4, pixelCount - i );
+}
+
+
+static ID_INLINE uint16x8_t Quantize_NEON( uint8x8_t c, uint8x8_t scale ) {
+	const uint16x8_t v = vmlal_u8( vdupq_n_u16( 127 ), c, scale );
+	return vshrq_n_u16( vaddq_u16( vaddq_u16( v, vdupq_n_u16( 1 ) ), vshrq_n_u16( v, 8 ) ), 8 );
+}
+
+
+static void PackRGBA4_NEON( uint16_t *out, const byte *in, int pixelCount ) {
+	const uint8x8_t scale = vdup_n_u8( 15 );
+	uint8x8x4_t x;
+	uint16x8_t v;
+	int i;
+
+	for ( i = 0; i + 8 <= pixelCount; i += 8 ) {
+		x = vld4_u8( in + i * 4 );
+		v = Quantize_NEON( x.val[3], scale );
+		v = vorrq_u16( v, vshlq_n_u16( Quantize_NEON( x.val[0], scale ), 4 ) );
+		v = vorrq_u16( v, vshlq_n_u16( Quantize_NEON( x.val[1], scale ), 8 ) );
+		v = vorrq_u16( v, vshlq_n_u16( Quantize_NEON( x.val[2], scale ), 12 ) );
+		vst1q_u16( out + i, v );
+	}
+
+	PackRGBA4_Scalar( out + i, in + i * 4, pixelCount - i );
+}
+
+
+static void PackRGB5A1_NEON( uint16_t *out, const byte *in, int pixelCount ) {
+	const uint8x8_t scale = vdup_n_u8( 31 );
+	uint8x8x4_t x;
+	uint16x8_t v;
+	int i;
+
+	for ( i = 0; i + 8 <= pixelCount; i += 8 ) {
+		x = vld4_u8( in + i * 4 );
+		v = vorrq_u16( Quantize_NEON( x.val[2], scale ), vdupq_n_u16( 0x8000 ) );
+		v = vorrq_u16( v, vshlq_n_u16( Quantize_NEON( x.val[1], scale ), 5 ) );
+		v = vorrq_u16( v, vshlq_n_u16( Quantize_NEON( x.val[0], scale ), 10 ) );
+		vst1q_u16( out + i, v );
+	}
+
+	PackRGB5A1_Scalar( out + i, in + i * 4, pixelCount - i );
+}
+
+
+static const imageKernels_t neonKernels = {
+	"neon",
+	ResampleRow_NEON,
+	BoxRow_NEON,
+	FilterRows_NEON,
+	FilterColumns_NEON,
+	BlendRGB_NEON,
+	SwizzleBGRA_NEON,
+	PackRGB_NEON,
+	PackRGBA4_NEON,
+	PackRGB5A1_NEON
+};
+#endif // IMAGE_SIMD_NEON
+
+
+static const imageKernels_t *kernels = &scalarKernels;
+
+
+/*
+================
+R_InitImageKernels
+
+0 - scalar code, 1 - best available, 2 - no AVX2
+================
+*/
+void R_InitImageKernels( int mode ) {
+	const int cpuFlags = ri.Com_CPUFlags();
+
+	kernels = &scalarKernels;
+
+	if ( mode <= 0 ) {
+		return;
+	}
+
+#ifdef IMAGE_SIMD_SSE2
+	if ( cpuFlags & CPU_SSE2 ) {
+		kernels = &sse2Kernels;
+	}
+#endif
+#ifdef IMAGE_SIMD_AVX2
+	if ( mode == 1 && ( cpuFlags & CPU_AVX2 ) ) {
+		kernels = &avx2Kernels;
+	}
+#endif
+#ifdef IMAGE_SIMD_NEON
+	kernels = &neonKernels;
+#endif
+
+	(void)cpuFlags;
+}
+
+
+/*
+================
+ResampleImage
+================
+*/
+static void ResampleImage( const imageKernels_t *k, const byte *in, int inwidth, int inheight, byte *out, int outwidth, int outheight ) {
+	int		i;
+	const byte *inrow, *inrow2;
+	unsigned	frac, fracstep;
+	unsigned	*p1, *p2;
+
+	p1 = ri.Hunk_AllocateTempMemory( outwidth * 2 * sizeof( *p1 ) );
+	p2 = p1 + outwidth;
+
+	fracstep = inwidth * 0x10000 / outwidth;
+
+	frac = fracstep>>2;
+	for ( i=0 ; i<outwidth ; i++ ) {
+		p1[i] = 4*(frac>>16);
+		frac += fracstep;
+	}
+	frac = 3*(fracstep>>2);
+	for ( i=0 ; i<outwidth ; i++ ) {
+		p2[i] = 4*(frac>>16);
+		frac += fracstep;
+	}
+
+	for (i=0 ; i<outheight ; i++, out += outwidth*4) {
+		inrow = in + 4*inwidth*(int)((i+0.25)*inheight/outheight);
+		inrow2 = in + 4*inwidth*(int)((i+0.75)*inheight/outheight);
+		k->ResampleRow( out, inrow, inrow2, p1, p2, outwidth );
+	}
+
+	ri.Hunk_FreeTempMemory( p1 );
+}
+
+
+/*
+================
+R_ResampleImage
+
+Used to resample images in a more general than quartering fashion.
+
+This will only be filtered properly if the resampled size
+is greater than half the original size.
+
+If a larger shrinking is needed, use the mipmap function
+before or after.
+================
+*/
+void R_ResampleImage( const byte *in, int inwidth, int inheight, byte *out, int outwidth, int outheight ) {
+	ResampleImage( kernels, in, inwidth, inheight, out, outwidth, outheight );
+}
+
+
+/*
+================
+MipMapBox
+================
+*/
+static void MipMapBox( const imageKernels_t *k, byte *out, const byte *in, int width, int height ) {
+	int		i;
+	int		row;
+
+	if ( width == 1 && height == 1 ) {
+		return;
+	}
+
+	row = width * 4;
+	width >>= 1;
+	height >>= 1;
+
+	if ( width == 0 || height == 0 ) {
+		width += height;	// get largest
+		for (i=0 ; i<width ; i++, out+=4, in+=8 ) {
+			out[0] = ( in[0] + in[4] )>>1;
+			out[1] = ( in[1] + in[5] )>>1;
+			out[2] = ( in[2] + in[6] )>>1;
+			out[3] = ( in[3] + in[7] )>>1;
+		}
+		return;
+	}
+
+	// step through the source like the old loop did, it matters for odd widths
+	for (i=0 ; i<height ; i++, in+=width*8+row, out+=width*4) {
+		k->BoxRow( out, in, in + row, width );
+	}
+}
+
+
+/*
+================
+R_MipMapBox
+
+Operates in place, quartering the size of the texture
+================
+*/
+void R_MipMapBox( byte *out, const byte *in, int width, int height ) {
+	MipMapBox( kernels, out, in, width, height );
+}
+
+
+/*
+================
+MipMapFilterReference
+
+The original per-pixel filter, also the only one handling
+non-power-of-two sizes the way older versions did
+================
+*/
+static void MipMapFilterReference( unsigned * const out, const unsigned * const in, int inWidth, int inHeight ) {
+	int			i, j, k;
+	byte		*outpix;
+	int			inWidthMask, inHeightMask;
+	int			total;
+	int			outWidth, outHeight;
+	unsigned	*temp;
+
+	outWidth = inWidth >> 1;
+	outHeight = inHeight >> 1;
+
+	if ( out == in )
+		temp = ri.Hunk_AllocateTempMemory( outWidth * outHeight * 4 );
+	else
+		temp = out;
+
+	inWidthMask = inWidth - 1;
+	inHeightMask = inHeight - 1;
+
+	for ( i = 0 ; i < outHeight ; i++ ) {
+		for ( j = 0 ; j < outWidth ; j++ ) {
+			outpix = (byte *) ( temp + i * outWidth + j );
+			for ( k = 0 ; k < 4 ; k++ ) {
+				total =
+					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
+
+					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
+
+					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
+
+					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k];
+				outpix[k] = total / 36;
+			}
+		}
+	}
+
+	if ( out == in ) {
+		Com_Memcpy( out, temp, outWidth * outHeight * 4 );
+		ri.Hunk_FreeTempMemory( temp );
+	}
+}
+
+
+/*
+================
+MipMapFilter
+
+Separable version of the 1-2-2-1 filter: four input rows are summed
+into a padded row of 16-bit columns, which is then filtered horizontally
+================
+*/
+static void MipMapFilter( const imageKernels_t *k, byte *out, const byte *in, int inWidth, int inHeight ) {
+	const byte	*rows[4];
+	const byte	*firstRow;
+	uint16_t	*columns;
+	int			outWidth, outHeight;
+	int			rowSize;
+	int			i, n, y;
+
+	outWidth = inWidth >> 1;
+	outHeight = inHeight >> 1;
+
+	if ( k->FilterRows == NULL || outWidth == 0 || outHeight == 0 || ( inWidth & ( inWidth - 1 ) ) || ( inHeight & ( inHeight - 1 ) ) ) {
+		MipMapFilterReference( (unsigned *)out, (const unsigned *)in, inWidth, inHeight );
+		return;
+	}
+
+	rowSize = inWidth * 4;
+	columns = ri.Hunk_AllocateTempMemory( ( inWidth + 2 ) * 4 * sizeof( uint16_t ) + rowSize );
+
+	// output rows trail the input rows they are made of, except for the
+	// wrap-around to the first row which has to be kept when filtering in place
+	firstRow = in;
+	if ( out == in ) {
+		firstRow = (const byte *)( columns + ( inWidth + 2 ) * 4 );
+		Com_Memcpy( (byte *)firstRow, in, rowSize );
+	}
+
+	for ( i = 0 ; i < outHeight ; i++ ) {
+		for ( n = 0; n < 4; n++ ) {
+			y = ( i * 2 - 1 + n ) & ( inHeight - 1 );
+			rows[n] = y ? in + y * rowSize : firstRow;
+		}
+		k->FilterRows( columns + 4, rows[0], rows[1], rows[2], rows[3], inWidth );
+		// wrap around horizontally
+		Com_Memcpy( columns, columns + inWidth * 4, 4 * sizeof( uint16_t ) );
+		Com_Memcpy( columns + ( inWidth + 1 ) * 4, columns + 4, 4 * sizeof( uint16_t ) );
+		k->FilterColumns( out + i * outWidth * 4, columns, outWidth );
+	}
+
+	ri.Hunk_FreeTempMemory( columns );
+}
+
+
+/*
+================
+R_MipMapFilter
+
+Operates in place, quartering the size of the texture
+Proper linear filter
+================
+*/
+void R_MipMapFilter( byte *out, const byte *in, int width, int height ) {
+	MipMapFilter( kernels, out, in, width, height );
+}
+
+
+/*
+================
+R_RemapImageRGB
+
+Table lookups don't vectorize without a byte gather,
+alpha is left untouched
+================
+*/
+void R_RemapImageRGB( byte *data, int pixelCount, const byte *table ) {
+	int i;
+
+	for ( i = 0; i < pixelCount; i++, data += 4 ) {
+		data[0] = table[ data[0] ];
+		data[1] = table[ data[1] ];
+		data[2] = table[ data[2] ];
+	}
+}
+
+
+/*
+================
+BlendImageRGB
+================
+*/
+static void BlendImageRGB( const imageKernels_t *k, byte *data, int pixelCount, const byte *color ) {
+	int inverseAlpha;
+	int premult[3];
+
+	inverseAlpha = 255 - color[3];
+	premult[0] = color[0] * color[3];
+	premult[1] = color[1] * color[3];
+	premult[2] = color[2] * color[3];
+
+	k->BlendRGB( data, pixelCount, inverseAlpha, premult );
+}
+
+
+/*
+================
+R_BlendImageRGB
+
+Blends an RGBA color over the pixels, keeping their alpha
+================
+*/
+void R_BlendImageRGB( byte *data, int pixelCount, const byte *color ) {
+	BlendImageRGB( kernels, data, pixelCount, color );
+}
+
+
+/*
+================
+R_SwizzleImageBGRA
+================
+*/
+void R_SwizzleImageBGRA( byte *out, const byte *in, int pixelCount ) {
+	kernels->SwizzleBGRA( out, in, pixelCount );
+}
+
+
+/*
+================
+R_PackImageRGB
+================
+*/
+void R_PackImageRGB( byte *out, const byte *in, int pixelCount ) {
+	kernels->PackRGB( out, in, pixelCount );
+}
+
+
+/*
+================
+R_PackImageRGBA4
+
+Packs into B4G4R4A4 words
+================
+*/
+void R_PackImageRGBA4( uint16_t *out, const byte *in, int pixelCount ) {
+	kernels->PackRGBA4( out, in, pixelCount );
+}
+
+
+/*
+================
+R_PackImageRGB5A1
+
+Packs into A1R5G5B5 words
+================
+*/
+void R_PackImageRGB5A1( uint16_t *out, const byte *in, int pixelCount ) {
+	kernels->PackRGB5A1( out, in, pixelCount );
+}
+
+
+/*
+========================================================================
+
+Benchmark
+
+========================================================================
+*/
+
+typedef enum {
+	BENCH_RESAMPLE,
+	BENCH_MIPMAP,
+	BENCH_MIPMAP2,
+	BENCH_LIGHTSCALE,
+	BENCH_BLEND,
+	BENCH_BGRA,
+	BENCH_RGB,
+	BENCH_RGBA4,
+	BENCH_RGB5A1,
+	BENCH_COUNT
+} imageBenchmark_t;
+
+static const char *benchmarkNames[ BENCH_COUNT ] = {
+	"resample",
+	"mipmap",
+	"mipmap2",
+	"lightscale",
+	"blend",
+	"bgra",
+	"rgb",
+	"rgba4",
+	"rgb5a1"
+};
+
+
+/*
+================
+R_RunImageKernel
+
+Returns size of the output in bytes
+================
+*/
+static int R_RunImageKernel( imageBenchmark_t bench, const imageKernels_t *k, byte *work, const byte *src, int size ) {
+	static const byte blendColor[4] = { 0, 255, 255, 128 };
+	byte table[256];
+	int i, outSize;
+
+	switch ( bench ) {
+	case BENCH_RESAMPLE:
+		outSize = size * 3 / 4;
+		ResampleImage( k, src, size, size, work, outSize, outSize );
+		return outSize * outSize * 4;
+	case BENCH_MIPMAP:
+		Com_Memcpy( work, src, size * size * 4 );
+		MipMapBox( k, work, work, size, size );
+		return size * size;
+	case BENCH_MIPMAP2:
+		Com_Memcpy( work, src, size * size * 4 );
+		MipMapFilter( k, work, work, size, size );
+		return size * size;
+	case BENCH_LIGHTSCALE:
+		for ( i = 0; i < 256; i++ ) {
+			table[i] = 255 - i;
+		}
+		Com_Memcpy( work, src, size * size * 4 );
+		R_RemapImageRGB( work, size * size, table );
+		return size * size * 4;
+	case BENCH_BLEND:
+		Com_Memcpy( work, src, size * size * 4 );
+		BlendImageRGB( k, work, size * size, blendColor );
+		return size * size * 4;
+	case BENCH_BGRA:
+		k->SwizzleBGRA( work, src, size * size );
+		return size * size * 4;
+	case BENCH_RGB:
+		k->PackRGB( work, src, size * size );
+		return size * size * 3;
+	case BENCH_RGBA4:
+		k->PackRGBA4( (uint16_t *)work, src, size * size );
+		return size * size * 2;
+	case BENCH_RGB5A1:
+		k->PackRGB5A1( (uint16_t *)work, src, size * size );
+		return size * size * 2;
+	default:
+		return 0;
+	}
+}
+
+
+/*
+================
+R_ImageBenchmark_f
+
+Times every kernel on a random image and checks that the SIMD
+results match the scalar ones, speed is in source MPixel/s
+(in place kernels include copying the source)
+================
+*/
+void R_ImageBenchmark_f( void ) {
+	const imageKernels_t *levels[4];
+	int numLevels;
+	int64_t start, elapsed;
+	imageBenchmark_t bench;
+	char line[MAX_STRING_CHARS];
+	byte *src, *ref, *work;
+	unsigned seed;
+	int size, outSize, iterations;
+	int i, n;
+
+	size = 1024;
+	if ( ri.Cmd_Argc() > 1 ) {
+		size = atoi( ri.Cmd_Argv( 1 ) );
+		if ( size < 16 || size > 4096 || ( size & ( size - 1 ) ) ) {
+			ri.Printf( PRINT_ALL, "usage: r_imageBenchmark [size], power of two between 16 and 4096\n" );
+			return;
+		}
+	}
+
+	numLevels = 0;
+	levels[ numLevels++ ] = &scalarKernels;
+#ifdef IMAGE_SIMD_SSE2
+	if ( ri.Com_CPUFlags() & CPU_SSE2 ) {
+		levels[ numLevels++ ] = &sse2Kernels;
+	}
+#endif
+#ifdef IMAGE_SIMD_AVX2
+	if ( ri.Com_CPUFlags() & CPU_AVX2 ) {
+		levels[ numLevels++ ] = &avx2Kernels;
+	}
+#endif
+#ifdef IMAGE_SIMD_NEON
+	levels[ numLevels++ ] = &neonKernels;
+#endif
+
+	src = ri.Malloc( size * size * 4 );
+	ref = ri.Malloc( size * size * 4 );
+	work = ri.Malloc( size * size * 4 );
+
+	seed = 0x12345678;
+	for ( i = 0; i < size * size * 4; i++ ) {
+		seed = seed * 1103515245 + 12345;
+		src[i] = seed >> 23;
+	}
+
+	Com_sprintf( line, sizeof( line ), "%-12s", "kernel" );
+	for ( n = 0; n < numLevels; n++ ) {
+		Q_strcat( line, sizeof( line ), va( "%10s", levels[n]->name ) );
+	}
+	ri.Printf( PRINT_ALL, "%s  (%ix%i, MPixel/s)\n", line, size, size );
+
+	for ( bench = 0; bench < BENCH_COUNT; bench++ ) {
+		Com_sprintf( line, sizeof( line ), "%-12s", benchmarkNames[ bench ] );
+		for ( n = 0; n < numLevels; n++ ) {
+			if ( bench == BENCH_LIGHTSCALE && n > 0 ) {
+				Q_strcat( line, sizeof( line ), va( "%10s", "-" ) );
+				continue;
+			}
+			// run for at least 100 msec
+			iterations = 0;
+			start = ri.Microseconds();
+			do {
+				outSize = R_RunImageKernel( bench, levels[n], work, src, size );
+				iterations++;
+				elapsed = ri.Microseconds() - start;
+			} while ( elapsed < 100000 && iterations < 1000 );
+			if ( elapsed < 1 ) {
+				elapsed = 1;
+			}
+			if ( n == 0 ) {
+				Com_Memcpy( ref, work, outSize );
+				Q_strcat( line, sizeof( line ), va( "%10.1f", (double)size * size * iterations / elapsed ) );
+			} else if ( memcmp( ref, work, outSize ) != 0 ) {
+				Q_strcat( line, sizeof( line ), va( "%10s", "MISMATCH" ) );
+			} else {
+				Q_strcat( line, sizeof( line ), va( "%10.1f", (double)size * size * iterations / elapsed ) );
+			}
+		}
+		ri.Printf( PRINT_ALL, "%s\n", line );
+	}
+
+	ri.Printf( PRINT_ALL, "using %s kernels\n", kernels->name );
+
+	ri.Free( work );
+	ri.Free( ref );
+	ri.Free( src );
+}
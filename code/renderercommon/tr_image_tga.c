@@ -39,43 +39,36 @@ typedef struct _TargaHeader {
 	unsigned char	pixel_size, attributes;
 } TargaHeader;
 
-void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
+/*
+=============
+DecodeTGA
+
+Returns qfalse and fills error on malformed files, in quiet mode
+warnings are treated as failures so that nothing is ever printed
+=============
+*/
+static qboolean DecodeTGA( const byte *data, int length, const char *name, byte **pic, int *width, int *height, char *error, int errorSize, qboolean quiet )
 {
 	unsigned	columns, rows, numPixels;
 	byte	*pixbuf;
 	int		row, column;
-	byte	*buf_p;
-	byte	*end;
-	union {
-		byte *b;
-		void *v;
-	} buffer;
+	const byte	*buf_p;
+	const byte	*end;
 	TargaHeader	targa_header;
 	byte		*targa_rgba;
-	int length;
 
 	*pic = NULL;
-
-	if(width)
-		*width = 0;
-	if(height)
-		*height = 0;
-
-	//
-	// load the file
-	//
-	length = ri.FS_ReadFile ( ( char * ) name, &buffer.v);
-	if (!buffer.b || length < 0) {
-		return;
-	}
+	targa_rgba = NULL;
+	error[0] = '\0';
 
 	if(length < 18)
 	{
-		ri.Error( ERR_DROP, "LoadTGA: header too short (%s)", name );
+		Com_sprintf( error, errorSize, "LoadTGA: header too short (%s)", name );
+		goto fail;
 	}
 
-	buf_p = buffer.b;
-	end = buffer.b + length;
+	buf_p = data;
+	end = data + length;
 
 	targa_header.id_length = buf_p[0];
 	targa_header.colormap_type = buf_p[1];
@@ -104,17 +97,20 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 		&& targa_header.image_type!=10
 		&& targa_header.image_type != 3 )
 	{
-		ri.Error (ERR_DROP, "LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported");
+		Com_sprintf( error, errorSize, "LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported" );
+		goto fail;
 	}
 
 	if ( targa_header.colormap_type != 0 )
 	{
-		ri.Error( ERR_DROP, "LoadTGA: colormaps not supported" );
+		Com_sprintf( error, errorSize, "LoadTGA: colormaps not supported" );
+		goto fail;
 	}
 
 	if ( ( targa_header.pixel_size != 32 && targa_header.pixel_size != 24 ) && targa_header.image_type != 3 )
 	{
-		ri.Error (ERR_DROP, "LoadTGA: Only 32 or 24 bit images supported (no colormaps)");
+		Com_sprintf( error, errorSize, "LoadTGA: Only 32 or 24 bit images supported (no colormaps)" );
+		goto fail;
 	}
 
 	columns = targa_header.width;
@@ -123,7 +119,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 
 	if(!columns || !rows || numPixels > 0x7FFFFFFF || numPixels / columns / 4 != rows)
 	{
-		ri.Error (ERR_DROP, "LoadTGA: %s has an invalid image size", name);
+		Com_sprintf( error, errorSize, "LoadTGA: %s has an invalid image size", name );
+		goto fail;
 	}
 
 
@@ -132,7 +129,10 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 	if (targa_header.id_length != 0)
 	{
 		if (buf_p + targa_header.id_length > end)
-			ri.Error( ERR_DROP, "LoadTGA: header too short (%s)", name );
+		{
+			Com_sprintf( error, errorSize, "LoadTGA: header too short (%s)", name );
+			goto fail;
+		}
 
 		buf_p += targa_header.id_length;  // skip TARGA image comment
 	}
@@ -141,7 +141,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 	{
 		if ( buf_p + columns * rows * targa_header.pixel_size / 8 > end )
 		{
-			ri.Error( ERR_DROP, "LoadTGA: file truncated (%s)", name );
+			Com_sprintf( error, errorSize, "LoadTGA: file truncated (%s)", name );
+			goto fail;
 		}
 		// Uncompressed RGB or gray scale image
 		switch ( targa_header.pixel_size ) {
@@ -190,8 +191,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 				}
 				break;
 			default:
-				ri.Error( ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
-				break;
+				Com_sprintf( error, errorSize, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+				goto fail;
 		}
 	}
 	else if (targa_header.image_type==10) {   // Runlength encoded RGB images
@@ -201,12 +202,18 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 			pixbuf = targa_rgba + row*columns*4;
 			for(column=0; column<columns; ) {
 				if(buf_p + 1 > end)
-					ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+				{
+					Com_sprintf( error, errorSize, "LoadTGA: file truncated (%s)", name );
+					goto fail;
+				}
 				packetHeader= *buf_p++;
 				packetSize = 1 + (packetHeader & 0x7f);
 				if (packetHeader & 0x80) {        // run-length packet
 					if(buf_p + targa_header.pixel_size/8 > end)
-						ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+					{
+						Com_sprintf( error, errorSize, "LoadTGA: file truncated (%s)", name );
+						goto fail;
+					}
 					switch (targa_header.pixel_size) {
 						case 24:
 								blue = *buf_p++;
@@ -221,9 +228,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 								alphabyte = *buf_p++;
 								break;
 						default:
-							ri.Error( ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
-							red = green = blue = alphabyte = 0; // silence compiler warning
-							break;
+							Com_sprintf( error, errorSize, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+							goto fail;
 					}
 
 					for(j=0;j<packetSize;j++) {
@@ -245,7 +251,10 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 				else {                            // non run-length packet
 
 					if(buf_p + targa_header.pixel_size/8*packetSize > end)
-						ri.Error (ERR_DROP, "LoadTGA: file truncated (%s)", name);
+					{
+						Com_sprintf( error, errorSize, "LoadTGA: file truncated (%s)", name );
+						goto fail;
+					}
 					for(j=0;j<packetSize;j++) {
 						switch (targa_header.pixel_size) {
 							case 24:
@@ -268,8 +277,8 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 									*pixbuf++ = alphabyte;
 									break;
 							default:
-								ri.Error( ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
-								break;
+								Com_sprintf( error, errorSize, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+								goto fail;
 						}
 						column++;
 						if ((unsigned int)column==columns) { // pixel packet run spans across rows
@@ -307,6 +316,10 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 #endif
   // instead we just print a warning
   if (targa_header.attributes & 0x20) {
+    if (quiet) {
+      Com_sprintf( error, errorSize, "top-down image" );
+      goto fail;
+    }
     ri.Printf( PRINT_WARNING, "WARNING: '%s' TGA file header declares top-down image, ignoring\n", name);
   }
 
@@ -317,5 +330,63 @@ void R_LoadTGA ( const char *name, byte **pic, int *width, int *height)
 
   *pic = targa_rgba;
 
-  ri.FS_FreeFile (buffer.v);
+  return qtrue;
+
+fail:
+  if (targa_rgba)
+	  ri.Free (targa_rgba);
+
+  return qfalse;
+}
+
+
+void R_LoadTGA ( const char *name, byte **pic, int *width, int *height )
+{
+	union {
+		byte *b;
+		void *v;
+	} buffer;
+	char	error[MAX_STRING_CHARS];
+	int		length;
+
+	*pic = NULL;
+
+	if(width)
+		*width = 0;
+	if(height)
+		*height = 0;
+
+	//
+	// load the file
+	//
+	length = ri.FS_ReadFile ( ( char * ) name, &buffer.v);
+	if (!buffer.b || length < 0) {
+		return;
+	}
+
+	if ( !DecodeTGA( buffer.b, length, name, pic, width, height, error, sizeof( error ), qfalse ) ) {
+		ri.FS_FreeFile (buffer.v);
+		ri.Error( ERR_DROP, "%s", error );
+	}
+
+	ri.FS_FreeFile (buffer.v);
+}
+
+
+/*
+=============
+R_DecodeTGA
+
+Decodes a TGA file that has already been read into memory,
+does not print anything so it may be called from worker threads
+=============
+*/
+void R_DecodeTGA( const char *name, const byte *data, int length, byte **pic, int *width, int *height )
+{
+	char	error[MAX_STRING_CHARS];
+
+	*width = 0;
+	*height = 0;
+
+	DecodeTGA( data, length, name, pic, width, height, error, sizeof( error ), qtrue );
 }
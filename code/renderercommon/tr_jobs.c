@@ -0,0 +1,542 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+
+#include "../qcommon/q_shared.h"
+#include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_jobs.h"
+
+/*
+========================================================================
+
+Front-end jobs
+
+A small pool of worker threads that stays alive for the lifetime of the
+renderer. R_RunJobs hands out the indices of a batch one at a time and
+returns once all of them have been processed, the calling thread takes
+indices as well so a batch finishes even when no worker is awake.
+
+Batches are short and issued several times per frame, so idle workers
+keep polling for a few microseconds before they go to sleep on a
+semaphore that R_RunJobs posts for every sleeping worker.
+
+Jobs must not call back into the engine or issue R_RunJobs themselves.
+
+========================================================================
+*/
+
+#define JOB_SPIN_POLLS		4096	// empty polls before an idle thread goes to sleep
+
+static struct {
+	void			*threads[MAX_JOB_THREADS];
+	int				numThreads;		// including the calling thread
+	volatile int	lock;
+	jobFunc_t		func;
+	void			*arg;
+	volatile int	count;
+	volatile int	next;
+	volatile int	done;
+	volatile int	shutdown;
+	void			*wake;			// semaphore sleeping workers wait on
+	volatile int	sleeping;		// workers that need a post to wake up
+} jobs;
+
+
+/*
+================
+R_ClaimJob
+================
+*/
+static qboolean R_ClaimJob( jobFunc_t *func, void **arg, int *index ) {
+	qboolean claimed = qfalse;
+
+	Com_SpinLock( &jobs.lock );
+	if ( jobs.next < jobs.count ) {
+		*func = jobs.func;
+		*arg = jobs.arg;
+		*index = jobs.next++;
+		claimed = qtrue;
+	}
+	Com_SpinUnlock( &jobs.lock );
+
+	return claimed;
+}
+
+
+/*
+================
+R_JobThread
+================
+*/
+static void R_JobThread( void *threadArg ) {
+	const int thread = (int)(intptr_t)threadArg;
+	jobFunc_t func;
+	void *arg;
+	int index;
+	int idle;
+
+	idle = 0;
+
+	while ( !jobs.shutdown ) {
+		if ( jobs.next >= jobs.count ) {
+			if ( idle < JOB_SPIN_POLLS ) {
+				idle++;
+				Q_SpinPause();
+				continue;
+			}
+			// register before the final check so a new batch can't be missed
+			Q_AtomicAdd( &jobs.sleeping, 1 );
+			if ( Q_AtomicLoad( &jobs.next ) >= jobs.count && !jobs.shutdown ) {
+				ri.Sys_WaitSemaphore( jobs.wake );
+			}
+			idle = 0;
+			continue;
+		}
+
+		while ( R_ClaimJob( &func, &arg, &index ) ) {
+			func( arg, index, thread );
+			Q_AtomicAdd( &jobs.done, 1 );
+		}
+
+		idle = 0;
+	}
+}
+
+
+/*
+================
+R_InitJobs
+
+Starts up to numWorkers threads, never more than there are other cores
+================
+*/
+void R_InitJobs( int numWorkers ) {
+	int i, numCPUs;
+
+	R_ShutdownJobs();
+
+	jobs.numThreads = 1;
+
+	if ( numWorkers <= 0 || !ri.Sys_CreateThread ) {
+		return;
+	}
+
+	jobs.wake = ri.Sys_CreateSemaphore();
+	if ( jobs.wake == NULL ) {
+		return;
+	}
+
+	numCPUs = ri.Sys_NumCPUs();
+	if ( numWorkers > numCPUs - 1 ) {
+		numWorkers = numCPUs - 1;
+	}
+	if ( numWorkers > MAX_JOB_THREADS - 1 ) {
+		numWorkers = MAX_JOB_THREADS - 1;
+	}
+
+	for ( i = 1; i <= numWorkers; i++ ) {
+		jobs.threads[ i ] = ri.Sys_CreateThread( R_JobThread, (void *)(intptr_t)i );
+		if ( jobs.threads[ i ] == NULL ) {
+			break;
+		}
+		jobs.numThreads++;
+	}
+
+	if ( jobs.numThreads > 1 ) {
+		ri.Printf( PRINT_ALL, "...using %i front-end worker threads\n", jobs.numThreads - 1 );
+	}
+}
+
+
+/*
+================
+R_ShutdownJobs
+================
+*/
+void R_ShutdownJobs( void ) {
+	int i;
+
+	Q_AtomicOr( &jobs.shutdown, 1 );
+
+	if ( jobs.numThreads > 1 ) {
+		ri.Sys_PostSemaphore( jobs.wake, jobs.numThreads - 1 );
+	}
+
+	for ( i = 1; i < jobs.numThreads; i++ ) {
+		ri.Sys_JoinThread( jobs.threads[ i ] );
+	}
+
+	if ( jobs.wake ) {
+		ri.Sys_DestroySemaphore( jobs.wake );
+	}
+
+	Com_Memset( &jobs, 0, sizeof( jobs ) );
+	jobs.numThreads = 1;
+}
+
+
+/*
+================
+R_JobThreads
+
+Returns the number of threads that can work on a batch, 1 if there are no workers
+================
+*/
+int R_JobThreads( void ) {
+	return jobs.numThreads > 1 ? jobs.numThreads : 1;
+}
+
+
+/*
+================
+R_RunJobs
+
+Calls func for every index in 0..count-1 and waits for all of them,
+must only be called from the main thread
+================
+*/
+void R_RunJobs( jobFunc_t func, void *arg, int count ) {
+	jobFunc_t jobFunc;
+	void *jobArg;
+	int index;
+
+	if ( count <= 0 ) {
+		return;
+	}
+
+	if ( jobs.numThreads <= 1 || count == 1 ) {
+		for ( index = 0; index < count; index++ ) {
+			func( arg, index, 0 );
+		}
+		return;
+	}
+
+	Com_SpinLock( &jobs.lock );
+	jobs.func = func;
+	jobs.arg = arg;
+	jobs.done = 0;
+	jobs.next = 0;
+	jobs.count = count;
+	Com_SpinUnlock( &jobs.lock );
+
+	ri.Sys_PostSemaphore( jobs.wake, Q_AtomicExchange( &jobs.sleeping, 0 ) );
+
+	while ( R_ClaimJob( &jobFunc, &jobArg, &index ) ) {
+		jobFunc( jobArg, index, 0 );
+		Q_AtomicAdd( &jobs.done, 1 );
+	}
+
+	// remaining jobs are already running on workers
+	while ( Q_AtomicLoad( &jobs.done ) < count ) {
+		Q_SpinPause();
+	}
+}
+
+
+/*
+========================================================================
+
+Render thread
+
+With r_smp the backend runs on a thread of its own. R_RenderThreadExecute
+waits for the previous command list and hands over the next one, so the
+front-end builds frame N+1 while frame N is being drawn.
+
+An OpenGL context can only be current on one thread at a time, it moves
+to the render thread with the first command list and R_SyncRenderThread
+takes it back when the main thread has to call the API directly (image
+uploads, mode changes, shutdown). Vulkan doesn't need that, the commands
+are only recorded on the thread that executes the backend.
+
+========================================================================
+*/
+
+typedef enum {
+	RT_IDLE,
+	RT_EXECUTE,		// run the handed over command list
+	RT_RELEASE,		// give up the context
+	RT_QUIT
+} renderThreadState_t;
+
+static struct {
+	void			*thread;
+	void			(*execute)( const void *data );
+	void			(*makeCurrent)( qboolean current );
+	const void		*data;
+	volatile int	state;
+	void			*wake;			// posted when the render thread has to leave RT_IDLE
+	void			*idle;			// posted when the main thread waits for RT_IDLE
+	volatile int	threadWaiting;
+	volatile int	mainWaiting;
+	qboolean		threadContext;	// only used by the render thread
+	qboolean		mainContext;	// only used by the main thread
+} render;
+
+static Q_THREADLOCAL qboolean onRenderThread;
+
+
+/*
+================
+R_SetRenderState
+
+Hands a new state over to the render thread
+================
+*/
+static void R_SetRenderState( int state ) {
+	Q_AtomicExchange( &render.state, state );
+
+	if ( Q_AtomicExchange( &render.threadWaiting, 0 ) ) {
+		ri.Sys_PostSemaphore( render.wake, 1 );
+	}
+}
+
+
+/*
+================
+R_RenderThread
+================
+*/
+static void R_RenderThread( void *threadArg ) {
+	int state;
+	int idle;
+
+	onRenderThread = qtrue;
+
+	idle = 0;
+
+	while ( 1 ) {
+		state = Q_AtomicLoad( &render.state );
+
+		if ( state == RT_IDLE ) {
+			if ( idle < JOB_SPIN_POLLS ) {
+				idle++;
+				Q_SpinPause();
+				continue;
+			}
+			// register before the final check so a new state can't be missed
+			Q_AtomicExchange( &render.threadWaiting, 1 );
+			if ( Q_AtomicLoad( &render.state ) == RT_IDLE ) {
+				ri.Sys_WaitSemaphore( render.wake );
+			}
+			idle = 0;
+			continue;
+		}
+
+		if ( state == RT_EXECUTE ) {
+			if ( !render.threadContext && render.makeCurrent ) {
+				render.makeCurrent( qtrue );
+				render.threadContext = qtrue;
+			}
+			render.execute( render.data );
+		} else if ( render.threadContext ) {
+			render.makeCurrent( qfalse );
+			render.threadContext = qfalse;
+		}
+
+		idle = 0;
+
+		Q_AtomicExchange( &render.state, RT_IDLE );
+
+		if ( Q_AtomicExchange( &render.mainWaiting, 0 ) ) {
+			ri.Sys_PostSemaphore( render.idle, 1 );
+		}
+
+		if ( state == RT_QUIT ) {
+			break;
+		}
+	}
+}
+
+
+/*
+================
+R_WaitRenderThread
+================
+*/
+static void R_WaitRenderThread( void ) {
+	int polls;
+
+	polls = 0;
+
+	while ( Q_AtomicLoad( &render.state ) != RT_IDLE ) {
+		if ( polls < JOB_SPIN_POLLS ) {
+			polls++;
+			Q_SpinPause();
+			continue;
+		}
+		Q_AtomicExchange( &render.mainWaiting, 1 );
+		if ( Q_AtomicLoad( &render.state ) != RT_IDLE ) {
+			ri.Sys_WaitSemaphore( render.idle );
+		}
+	}
+}
+
+
+/*
+================
+R_StartRenderThread
+
+Called with the context current on the main thread, makeCurrent is NULL
+for APIs that don't bind a context to a thread
+================
+*/
+qboolean R_StartRenderThread( void (*execute)( const void *data ), void (*makeCurrent)( qboolean current ) ) {
+
+	R_StopRenderThread();
+
+	if ( !ri.Sys_CreateThread || ri.Sys_NumCPUs() < 2 ) {
+		return qfalse;
+	}
+
+	render.execute = execute;
+	render.makeCurrent = makeCurrent;
+	render.mainContext = qtrue;
+	render.state = RT_IDLE;
+
+	render.wake = ri.Sys_CreateSemaphore();
+	render.idle = ri.Sys_CreateSemaphore();
+
+	if ( render.wake && render.idle ) {
+		render.thread = ri.Sys_CreateThread( R_RenderThread, NULL );
+	}
+
+	if ( render.thread == NULL ) {
+		if ( render.wake ) {
+			ri.Sys_DestroySemaphore( render.wake );
+		}
+		if ( render.idle ) {
+			ri.Sys_DestroySemaphore( render.idle );
+		}
+		Com_Memset( &render, 0, sizeof( render ) );
+		return qfalse;
+	}
+
+	ri.Printf( PRINT_ALL, "...using render thread\n" );
+
+	return qtrue;
+}
+
+
+/*
+================
+R_StopRenderThread
+
+Finishes the last command list and leaves the context on the main thread
+================
+*/
+void R_StopRenderThread( void ) {
+
+	if ( render.thread == NULL ) {
+		return;
+	}
+
+	R_WaitRenderThread();
+
+	R_SetRenderState( RT_QUIT );
+	ri.Sys_JoinThread( render.thread );
+
+	if ( !render.mainContext && render.makeCurrent ) {
+		render.makeCurrent( qtrue );
+	}
+
+	ri.Sys_DestroySemaphore( render.wake );
+	ri.Sys_DestroySemaphore( render.idle );
+
+	Com_Memset( &render, 0, sizeof( render ) );
+}
+
+
+/*
+================
+R_RenderThreadActive
+================
+*/
+qboolean R_RenderThreadActive( void ) {
+	return render.thread != NULL;
+}
+
+
+/*
+================
+R_RenderThreadExecute
+
+Returns as soon as the render thread has picked up the command list
+================
+*/
+void R_RenderThreadExecute( const void *data ) {
+
+	R_WaitRenderThread();
+
+	if ( render.mainContext && render.makeCurrent ) {
+		render.makeCurrent( qfalse );
+	}
+	render.mainContext = qfalse;
+
+	render.data = data;
+	R_SetRenderState( RT_EXECUTE );
+}
+
+
+/*
+================
+R_FinishRenderThread
+
+Waits until the last command list has been executed, backend state
+and the previous frame's data can be read afterwards
+================
+*/
+void R_FinishRenderThread( void ) {
+
+	// the backend itself has nothing to wait for
+	if ( render.thread == NULL || onRenderThread ) {
+		return;
+	}
+
+	R_WaitRenderThread();
+}
+
+
+/*
+================
+R_SyncRenderThread
+
+Like R_FinishRenderThread, also makes the context current on the
+main thread so it can call the graphics API directly, does nothing
+when called by the backend as the context is already current there
+================
+*/
+void R_SyncRenderThread( void ) {
+
+	if ( render.thread == NULL || onRenderThread ) {
+		return;
+	}
+
+	R_WaitRenderThread();
+
+	if ( !render.mainContext ) {
+		if ( render.makeCurrent ) {
+			R_SetRenderState( RT_RELEASE );
+			R_WaitRenderThread();
+			render.makeCurrent( qtrue );
+		}
+		render.mainContext = qtrue;
+	}
+}
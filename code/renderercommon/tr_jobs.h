@@ -0,0 +1,44 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+#ifndef TR_JOBS_H
+#define TR_JOBS_H
+
+// front-end worker threads and the render thread, see tr_jobs.c
+
+#define MAX_JOB_THREADS		16	// including the calling thread
+
+// thread is 0 for the calling thread and 1..R_JobThreads()-1 for workers
+typedef void (*jobFunc_t)( void *arg, int index, int thread );
+
+void R_InitJobs( int numWorkers );
+void R_ShutdownJobs( void );
+int R_JobThreads( void );
+void R_RunJobs( jobFunc_t func, void *arg, int count );
+
+qboolean R_StartRenderThread( void (*execute)( const void *data ), void (*makeCurrent)( qboolean current ) );
+void R_StopRenderThread( void );
+qboolean R_RenderThreadActive( void );
+void R_RenderThreadExecute( const void *data );
+void R_FinishRenderThread( void );
+void R_SyncRenderThread( void );
+
+#endif // TR_JOBS_H
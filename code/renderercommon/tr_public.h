@@ -25,7 +25,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_types.h"
 #include "vulkan/vulkan.h"
 
-#define	REF_API_VERSION		8
+#define	REF_API_VERSION		15
 
 //
 // these are the functions exported by the refresh module
@@ -107,7 +107,8 @@ typedef struct {
 	qboolean (*GetEntityToken)( char *buffer, int size );
 	qboolean (*inPVS)( const vec3_t p1, const vec3_t p2 );
 
-	void	(*TakeVideoFrame)( int h, int w, byte* captureBuffer, byte *encodeBuffer, qboolean motionJpeg );
+	void	(*TakeVideoFrame)( int h, int w, byte* captureBuffer );
+	void	(*FlushVideoFrames)( void );	// hand over frames still being read back
 
 	void	(*ThrottleBackend)( void );
 	void	(*FinishBloom)( void );
@@ -191,17 +192,23 @@ typedef struct {
 	void	(*FS_FreeFileList)( char **filelist );
 	void	(*FS_WriteFile)( const char *qpath, const void *buffer, int size );
 	qboolean (*FS_FileExists)( const char *file );
+	qboolean (*FS_FileStamp)( const char *file, char *stamp, int stampSize );
+	void	*(*FS_LocateFile)( const char *name, int *size );
+	qboolean (*FS_ReadLocatedFile)( const void *location, void *buffer );	// any thread
+	void	(*FS_FreeLocation)( void *location );
 
 	// cinematic stuff
 	void	(*CIN_UploadCinematic)( int handle );
 	int		(*CIN_PlayCinematic)( const char *arg0, int xpos, int ypos, int width, int height, int bits );
 	e_status (*CIN_RunCinematic)( int handle );
 
-	void	(*CL_WriteAVIVideoFrame)( const byte *buffer, int size );
+	// bottom-up RGB rows followed by padding bytes, gammaTable may be NULL
+	void	(*CL_QueueAVIVideoFrame)( const byte *pixels, int width, int height, int padding, const byte *gammaTable, int jpegQuality );
 
 	size_t	(*CL_SaveJPGToBuffer)( byte *buffer, size_t bufSize, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 	void	(*CL_SaveJPG)( const char *filename, int quality, int image_width, int image_height, byte *image_buffer, int padding );
 	void	(*CL_LoadJPG)( const char *filename, unsigned char **pic, int *width, int *height );
+	void	(*CL_DecodeJPG)( const char *filename, const byte *data, int len, unsigned char **pic, int *width, int *height );
 
 	qboolean (*CL_IsMinimized)( void );
 	void	(*CL_SetScaling)( float factor, int captureWidth, int captureHeight );
@@ -211,6 +218,18 @@ typedef struct {
 
 	int		(*Com_RealTime)( qtime_t *qtime );
 
+	// worker threads, only Malloc/Free may be called from them
+	void	*(*Sys_CreateThread)( void (*func)( void *arg ), void *arg );
+	void	(*Sys_JoinThread)( void *thread );
+	int		(*Sys_NumCPUs)( void );
+	void	(*Sys_Sleep)( int msec );
+	void	*(*Sys_CreateSemaphore)( void );
+	void	(*Sys_DestroySemaphore)( void *sem );
+	void	(*Sys_PostSemaphore)( void *sem, int count );
+	void	(*Sys_WaitSemaphore)( void *sem );
+
+	int		(*Com_CPUFlags)( void );	// CPU_* flags
+
 	// platform-dependent functions
 	void(*GLimp_InitGamma)(glconfig_t *config);
 	void(*GLimp_SetGamma)(unsigned char red[256], unsigned char green[256], unsigned char blue[256]);
@@ -219,6 +238,7 @@ typedef struct {
 	void	(*GLimp_Init)( glconfig_t *config );
 	void	(*GLimp_Shutdown)( qboolean unloadDLL );
 	void	(*GLimp_EndFrame)( void );
+	void	(*GLimp_MakeCurrent)( qboolean current );	// binds or releases the context on the calling thread
 	void*	(*GL_GetProcAddress)( const char *name );
 
 	// Vulkan
@@ -0,0 +1,265 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+
+#include "../qcommon/q_shared.h"
+#include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_image_cache.h"
+#include "../renderercommon/tr_shader_cache.h"
+
+/*
+========================================================================
+
+Shader script cache
+
+ScanAndLoadShaderFiles reads every .shader file, joins them into a single
+text and indexes the shader names in it. The result is stored in
+shadercache.dat under the home path together with the name index as
+offsets into the text, so the next start only has to read one file.
+
+The key is a hash of the names of all listed script files and of where
+each one would be read from (pk3 or directory file, with its size and
+modification time), which the filesystem can tell without opening the
+pk3 files.
+
+========================================================================
+*/
+
+#define SHADERCACHE_IDENT		(('C'<<24)+('S'<<16)+('3'<<8)+'Q')
+#define SHADERCACHE_VERSION		1
+#define SHADERCACHE_NAME		"shadercache.dat"
+
+typedef struct {
+	int		ident;
+	int		version;
+	int		keyLow, keyHigh;
+	int		textLength;
+	int		extensionOffset;	// start of the extended shaders
+	int		hashSize;
+	int		numEntries;
+	// int bucketSizes[hashSize]
+	// int offsets[numEntries], in bucket order
+	// char text[textLength]
+} shaderCacheHeader_t;
+
+
+/*
+================
+R_ShaderCacheHashList
+================
+*/
+static uint64_t R_ShaderCacheHashList( uint64_t hash, char **files, int numFiles ) {
+	char filename[MAX_QPATH+8];
+	char stamp[MAX_OSPATH+64];
+	int i;
+
+	hash = R_ImageCacheHash( hash, &numFiles, sizeof( numFiles ) );
+
+	for ( i = 0; i < numFiles; i++ ) {
+		Com_sprintf( filename, sizeof( filename ), "scripts/%s", files[i] );
+		if ( !ri.FS_FileStamp( filename, stamp, sizeof( stamp ) ) ) {
+			return 0;
+		}
+		hash = R_ImageCacheHash( hash, filename, strlen( filename ) + 1 );
+		hash = R_ImageCacheHash( hash, stamp, strlen( stamp ) + 1 );
+	}
+
+	return hash;
+}
+
+
+/*
+================
+R_ShaderCacheKey
+
+Returns 0 if the files can't be identified without reading them
+================
+*/
+uint64_t R_ShaderCacheKey( char **shaderFiles, int numShaderFiles, char **shaderxFiles, int numShaderxFiles ) {
+	uint64_t hash;
+	int version = SHADERCACHE_VERSION;
+
+	hash = R_ImageCacheHash( IMAGECACHE_HASH_INIT, &version, sizeof( version ) );
+
+	hash = R_ShaderCacheHashList( hash, shaderFiles, numShaderFiles );
+	if ( hash == 0 ) {
+		return 0;
+	}
+
+	hash = R_ShaderCacheHashList( hash, shaderxFiles, numShaderxFiles );
+	if ( hash == 0 ) {
+		return 0;
+	}
+
+	return hash;
+}
+
+
+/*
+================
+R_LoadShaderCache
+
+Fills the shader text and name hash table the way ScanAndLoadShaderFiles
+does, returns qfalse if there is no valid cache for the key
+================
+*/
+qboolean R_LoadShaderCache( uint64_t key, char **text, int *extensionOffset, const char ***hashTable, int hashSize ) {
+	shaderCacheHeader_t header;
+	const int *bucketSizes, *offsets;
+	const char *cachedText;
+	const char **hashMem;
+	void *buffer;
+	int length, i, j, n, total;
+
+	length = ri.FS_ReadFile( SHADERCACHE_NAME, &buffer );
+	if ( buffer == NULL ) {
+		return qfalse;
+	}
+
+	if ( length < (int)sizeof( header ) ) {
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+
+	Com_Memcpy( &header, buffer, sizeof( header ) );
+	header.ident = LittleLong( header.ident );
+	header.version = LittleLong( header.version );
+	header.keyLow = LittleLong( header.keyLow );
+	header.keyHigh = LittleLong( header.keyHigh );
+	header.textLength = LittleLong( header.textLength );
+	header.extensionOffset = LittleLong( header.extensionOffset );
+	header.hashSize = LittleLong( header.hashSize );
+	header.numEntries = LittleLong( header.numEntries );
+
+	if ( header.ident != SHADERCACHE_IDENT || header.version != SHADERCACHE_VERSION
+		|| (unsigned)header.keyLow != (unsigned)key || (unsigned)header.keyHigh != (unsigned)( key >> 32 ) ) {
+		// different set of shader files, will be rewritten
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+
+	if ( header.hashSize != hashSize || header.numEntries < 0 || header.textLength < 0
+		|| header.extensionOffset < 0 || header.extensionOffset > header.textLength
+		|| length != (int)sizeof( header ) + ( hashSize + header.numEntries ) * (int)sizeof( int ) + header.textLength ) {
+		ri.Printf( PRINT_DEVELOPER, "...ignoring bad cache file %s\n", SHADERCACHE_NAME );
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+
+	bucketSizes = (const int *)( (const byte *)buffer + sizeof( header ) );
+	offsets = bucketSizes + hashSize;
+	cachedText = (const char *)( offsets + header.numEntries );
+
+	total = 0;
+	for ( i = 0; i < hashSize; i++ ) {
+		n = LittleLong( bucketSizes[i] );
+		if ( n < 0 || n > header.numEntries - total ) {
+			break;
+		}
+		total += n;
+	}
+	if ( i != hashSize || total != header.numEntries ) {
+		ri.Printf( PRINT_DEVELOPER, "...ignoring bad cache file %s\n", SHADERCACHE_NAME );
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+	for ( i = 0; i < header.numEntries; i++ ) {
+		n = LittleLong( offsets[i] );
+		if ( n < 0 || n >= header.textLength ) {
+			ri.Printf( PRINT_DEVELOPER, "...ignoring bad cache file %s\n", SHADERCACHE_NAME );
+			ri.FS_FreeFile( buffer );
+			return qfalse;
+		}
+	}
+
+	*text = ri.Hunk_Alloc( header.textLength + 1, h_low );
+	Com_Memcpy( *text, cachedText, header.textLength );
+	(*text)[ header.textLength ] = '\0';
+	*extensionOffset = header.extensionOffset;
+
+	// every bucket is terminated by a NULL pointer
+	hashMem = ri.Hunk_Alloc( ( header.numEntries + hashSize ) * sizeof( char * ), h_low );
+
+	for ( i = 0; i < hashSize; i++ ) {
+		n = LittleLong( bucketSizes[i] );
+		hashTable[i] = hashMem;
+		for ( j = 0; j < n; j++ ) {
+			hashMem[j] = *text + LittleLong( *offsets++ );
+		}
+		hashMem[n] = NULL;
+		hashMem += n + 1;
+	}
+
+	ri.FS_FreeFile( buffer );
+
+	ri.Printf( PRINT_DEVELOPER, "...loaded %i shader names from %s\n", header.numEntries, SHADERCACHE_NAME );
+
+	return qtrue;
+}
+
+
+/*
+================
+R_SaveShaderCache
+================
+*/
+void R_SaveShaderCache( uint64_t key, const char *text, int textLength, int extensionOffset, const char ***hashTable, int hashSize ) {
+	shaderCacheHeader_t *header;
+	int *bucketSizes, *offsets;
+	byte *buffer;
+	int numEntries, size, i, j;
+
+	numEntries = 0;
+	for ( i = 0; i < hashSize; i++ ) {
+		for ( j = 0; hashTable[i] && hashTable[i][j]; j++ ) {
+			numEntries++;
+		}
+	}
+
+	size = sizeof( *header ) + ( hashSize + numEntries ) * sizeof( int ) + textLength;
+	buffer = ri.Malloc( size );
+
+	header = (shaderCacheHeader_t *)buffer;
+	header->ident = LittleLong( SHADERCACHE_IDENT );
+	header->version = LittleLong( SHADERCACHE_VERSION );
+	header->keyLow = LittleLong( (int)key );
+	header->keyHigh = LittleLong( (int)( key >> 32 ) );
+	header->textLength = LittleLong( textLength );
+	header->extensionOffset = LittleLong( extensionOffset );
+	header->hashSize = LittleLong( hashSize );
+	header->numEntries = LittleLong( numEntries );
+
+	bucketSizes = (int *)( buffer + sizeof( *header ) );
+	offsets = bucketSizes + hashSize;
+
+	for ( i = 0; i < hashSize; i++ ) {
+		for ( j = 0; hashTable[i] && hashTable[i][j]; j++ ) {
+			*offsets++ = LittleLong( (int)( hashTable[i][j] - text ) );
+		}
+		bucketSizes[i] = LittleLong( j );
+	}
+
+	Com_Memcpy( offsets, text, textLength );
+
+	ri.FS_WriteFile( SHADERCACHE_NAME, buffer, size );
+
+	ri.Free( buffer );
+}
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_local.h"
 
 backEndData_t	*backEndData;
+backEndData_t	*backEndFrames[SMP_FRAMES];
 backEndState_t	backEnd;
 
 #ifndef USE_VULKAN
@@ -1107,6 +1108,8 @@ void RE_UploadCinematic( int w, int h, int cols, int rows, byte *data, int clien
 
 	image_t *image;
 
+	R_SyncRenderThread();
+
 	if ( !tr.scratchImage[ client ] ) {
 		tr.scratchImage[ client ] = R_CreateImage( va( "*scratch%i", client ), NULL, data, cols, rows, IMGFLAG_CLAMPTOEDGE | IMGFLAG_RGB | IMGFLAG_NOSCALE );
 	}
@@ -1432,6 +1435,16 @@ static const void *RB_DrawBuffer( const void *data ) {
 
 	cmd = (const drawBufferCommand_t *)data;
 
+#ifndef USE_VULKAN
+	glState.finishCalled = qfalse;
+#endif
+
+#ifdef USE_VULKAN
+	backEnd.doneBloom = qfalse;
+#endif
+
+	backEnd.color2D.u32 = ~0U;
+
 #ifdef USE_VULKAN
 	vk_begin_frame();
 
@@ -1762,6 +1775,12 @@ void RB_ExecuteRenderCommands( const void *data ) {
 
 	backEnd.pc.msec = ri.Milliseconds();
 
+	if ( backEndFrames[1] && data == backEndFrames[1]->commands.cmds ) {
+		backEnd.smpFrame = 1;
+	} else {
+		backEnd.smpFrame = 0;
+	}
+
 	while ( 1 ) {
 		data = PADP(data, sizeof(void *));
 
@@ -1871,7 +1871,11 @@ static void R_LoadShaders( const lump_t *l ) {
 	for ( i=0 ; i<count ; i++ ) {
 		out[i].surfaceFlags = LittleLong( out[i].surfaceFlags );
 		out[i].contentFlags = LittleLong( out[i].contentFlags );
+		R_PrefetchShaderImages( out[i].shader );
 	}
+
+	// decode the textures in the background while surfaces are loading
+	R_StartImagePrefetch();
 }
 
 
@@ -2260,6 +2264,8 @@ void RE_LoadWorldMap( const char *name ) {
 		ri.Error( ERR_DROP, "ERROR: attempted to redundantly load world map" );
 	}
 
+	R_SyncRenderThread();
+
 	// set default sun direction to be used if it isn't
 	// overridden by a shader
 	tr.sunDirection[0] = 0.45f;
@@ -2332,6 +2338,8 @@ void RE_LoadWorldMap( const char *name ) {
 	R_BuildWorldVBO( s_worldData.surfaces, s_worldData.numsurfaces );
 #endif
 
+	R_FinishImagePrefetch();
+
 	tr.mapLoading = qfalse;
 
 	s_worldData.dataSize = (byte *)ri.Hunk_Alloc(0, h_low) - startMarker;
@@ -102,7 +102,16 @@ static void R_IssueRenderCommands( void ) {
 	// actually start the commands going
 	if ( !r_skipBackEnd->integer ) {
 		// let it start on the new batch
-		RB_ExecuteRenderCommands( cmdList->cmds );
+		if ( R_RenderThreadActive() ) {
+			const int screenshotMask = backEnd.screenshotMask;
+			R_RenderThreadExecute( cmdList->cmds );
+			if ( screenshotMask ) {
+				// captures call back into the engine, keep the main thread out of the way
+				R_FinishRenderThread();
+			}
+		} else {
+			RB_ExecuteRenderCommands( cmdList->cmds );
+		}
 	}
 }
 
@@ -225,6 +234,7 @@ void RE_StretchPic( float x, float y, float w, float h,
 	}
 	cmd->commandId = RC_STRETCH_PIC;
 	cmd->shader = R_GetShaderByHandle( hShader );
+	tr.videoMaps |= cmd->shader->videoMaps;
 	cmd->x = x;
 	cmd->y = y;
 	cmd->w = w;
@@ -296,16 +306,6 @@ void RE_BeginFrame( stereoFrame_t stereoFrame ) {
 		return;
 	}
 
-#ifndef USE_VULKAN
-	glState.finishCalled = qfalse;
-#endif
-
-#ifdef USE_VULKAN
-	backEnd.doneBloom = qfalse;
-#endif
-
-	backEnd.color2D.u32 = ~0U;
-
 	tr.frameCount++;
 	tr.frameSceneNum = 0;
 
@@ -358,6 +358,28 @@ void RE_BeginFrame( stereoFrame_t stereoFrame ) {
 }
 
 
+/*
+=============
+R_UpdateVideoMaps
+
+Decodes and uploads cinematics used by this frame on the main thread,
+the backend only binds their images
+=============
+*/
+static void R_UpdateVideoMaps( void ) {
+	int i;
+
+	for ( i = 0; i < MAX_VIDEO_HANDLES; i++ ) {
+		if ( tr.videoMaps & ( 1 << i ) ) {
+			ri.CIN_RunCinematic( i );
+			ri.CIN_UploadCinematic( i );
+		}
+	}
+
+	tr.videoMaps = 0;
+}
+
+
 /*
 =============
 RE_EndFrame
@@ -379,8 +401,17 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 	}
 	cmd->commandId = RC_SWAP_BUFFERS;
 
+	if ( tr.videoMaps ) {
+		R_UpdateVideoMaps();
+	}
+
 	R_IssueRenderCommands();
 
+	if ( r_speeds->integer || backEndMsec ) {
+		// backend counters are only valid once the frame is done
+		R_FinishRenderThread();
+	}
+
 	R_PerformanceCounters();
 
 	R_InitNextFrame();
@@ -400,6 +431,8 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 	// recompile GPU shaders if needed
 	if ( ri.Cvar_CheckGroup( CVG_RENDERER ) ) {
 
+		R_SyncRenderThread();
+
 		// texturemode stuff
 		if ( r_textureMode->modified ) {
 			GL_TextureMode( r_textureMode->string );
@@ -424,8 +457,7 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 RE_TakeVideoFrame
 =============
 */
-void RE_TakeVideoFrame( int width, int height,
-		byte *captureBuffer, byte *encodeBuffer, qboolean motionJpeg )
+void RE_TakeVideoFrame( int width, int height, byte *captureBuffer )
 {
 	videoFrameCommand_t	*cmd;
 
@@ -433,6 +465,9 @@ void RE_TakeVideoFrame( int width, int height,
 		return;
 	}
 
+	// the previous frame may still be using vcmd
+	R_FinishRenderThread();
+
 	backEnd.screenshotMask |= SCREENSHOT_AVI;
 
 	cmd = &backEnd.vcmd;
@@ -442,8 +477,6 @@ void RE_TakeVideoFrame( int width, int height,
 	cmd->width = width;
 	cmd->height = height;
 	cmd->captureBuffer = captureBuffer;
-	cmd->encodeBuffer = encodeBuffer;
-	cmd->motionJpeg = motionJpeg;
 }
 
 
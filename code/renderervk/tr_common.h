@@ -26,6 +26,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../qcommon/q_shared.h"
 #include "../renderercommon/tr_public.h"
+#include "../renderercommon/tr_image_cache.h"
+#include "../renderercommon/tr_shader_cache.h"
+#include "../renderercommon/tr_jobs.h"
 
 #define MAX_TEXTURE_UNITS 8
 
@@ -93,6 +96,8 @@ float R_NoiseGet4f( float x, float y, float z, double t );
 void  R_NoiseInit( void );
 
 image_t *R_FindImageFile( const char *name, imgFlags_t flags );
+void R_PrefetchImageFile( const char *name, imgFlags_t flags );
+uint64_t R_ImageCacheSalt( imgFlags_t flags );
 image_t *R_CreateImage( const char *name, const char *name2, byte *pic, int width, int height, imgFlags_t flags );
 void R_UploadSubImage( byte *data, int x, int y, int width, int height, image_t *image );
 
@@ -120,6 +125,39 @@ void R_LoadPCX( const char *name, byte **pic, int *width, int *height );
 void R_LoadPNG( const char *name, byte **pic, int *width, int *height );
 void R_LoadTGA( const char *name, byte **pic, int *width, int *height );
 
+/*
+=============================================================
+
+IMAGE PREFETCH
+
+=============================================================
+*/
+
+void R_AddImagePrefetch( const char *name, uint64_t cacheSalt );
+void R_StartImagePrefetch( void );
+qboolean R_TakePrefetchedImage( const char *name, byte **pic, int *width, int *height, char *localName, int localNameSize );
+void R_FinishImagePrefetch( void );
+
+/*
+=============================================================
+
+IMAGE KERNELS
+
+=============================================================
+*/
+
+void R_InitImageKernels( int mode );
+void R_ImageBenchmark_f( void );
+void R_ResampleImage( const byte *in, int inwidth, int inheight, byte *out, int outwidth, int outheight );
+void R_MipMapBox( byte *out, const byte *in, int width, int height );
+void R_MipMapFilter( byte *out, const byte *in, int width, int height );
+void R_RemapImageRGB( byte *data, int pixelCount, const byte *table );
+void R_BlendImageRGB( byte *data, int pixelCount, const byte *color );
+void R_SwizzleImageBGRA( byte *out, const byte *in, int pixelCount );
+void R_PackImageRGB( byte *out, const byte *in, int pixelCount );
+void R_PackImageRGBA4( uint16_t *out, const byte *in, int pixelCount );
+void R_PackImageRGB5A1( uint16_t *out, const byte *in, int pixelCount );
+
 /*
 ====================================================================
 
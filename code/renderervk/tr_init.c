@@ -165,6 +165,12 @@ cvar_t	*r_mapGreyScale;
 
 cvar_t	*r_debugSurface;
 cvar_t	*r_simpleMipMaps;
+cvar_t	*r_imagePrefetch;
+cvar_t	*r_imageSIMD;
+cvar_t	*r_textureCache;
+cvar_t	*r_shaderCache;
+cvar_t	*r_frontEndThreads;
+cvar_t	*r_smp;
 
 cvar_t	*r_showImages;
 cvar_t	*r_defaultImage;
@@ -179,6 +185,9 @@ cvar_t	*r_saveFontData;
 cvar_t	*r_marksOnTriangleMeshes;
 
 cvar_t	*r_aviMotionJpegQuality;
+#ifdef USE_VULKAN
+static cvar_t *r_aviAsyncReadback;
+#endif
 cvar_t	*r_screenshotJpegQuality;
 
 static cvar_t *r_maxpolys;
@@ -1074,6 +1083,9 @@ static void R_ScreenShot_f( void ) {
 		return;
 	}
 
+	// the capture must not race the previous frame
+	R_SyncRenderThread();
+
 	if ( !strcmp( ri.Cmd_Argv(1), "levelshot" ) ) {
 		R_LevelShot();
 		return;
@@ -1133,6 +1145,86 @@ static void R_ScreenShot_f( void ) {
 
 //============================================================================
 
+#ifdef USE_VULKAN
+/*
+==================
+RB_DeliverVideoFrame
+
+Hands the oldest pending frame to the client, waiting for it if needed
+==================
+*/
+static void RB_DeliverVideoFrame( void )
+{
+	const byte *data;
+	uint32_t width, height;
+
+	data = vk_readback_fetch( &width, &height );
+
+	ri.CL_QueueAVIVideoFrame( data, width, height, 0,
+		R_GammaTable(), r_aviMotionJpegQuality->integer );
+}
+
+
+/*
+==================
+RE_FlushVideoFrames
+==================
+*/
+static void RE_FlushVideoFrames( void )
+{
+	R_SyncRenderThread();
+
+	while ( vk_readback_pending() > 0 ) {
+		RB_DeliverVideoFrame();
+	}
+}
+
+
+/*
+==================
+RB_DestroyVideoReadback
+==================
+*/
+static void RB_DestroyVideoReadback( void )
+{
+	RE_FlushVideoFrames();
+
+	vk_destroy_readback();
+}
+
+
+/*
+==================
+RB_ReadVideoFrameAsync
+==================
+*/
+static qboolean RB_ReadVideoFrameAsync( int width, int height )
+{
+	if ( !r_aviAsyncReadback->integer ) {
+		RB_DestroyVideoReadback();
+		return qfalse;
+	}
+
+	if ( !vk_readback_fits( width, height ) ) {
+		RB_DestroyVideoReadback();
+	}
+
+	if ( vk_readback_pending() == VK_READBACK_FRAMES ) {
+		RB_DeliverVideoFrame();
+	}
+
+	vk_readback_submit( width, height );
+
+	// pass on whatever has already arrived
+	while ( vk_readback_ready() ) {
+		RB_DeliverVideoFrame();
+	}
+
+	return qtrue;
+}
+#endif
+
+
 /*
 ==================
 RB_TakeVideoFrameCmd
@@ -1142,8 +1234,8 @@ const void *RB_TakeVideoFrameCmd( const void *data )
 {
 	const videoFrameCommand_t *cmd;
 	byte		*cBuf;
-	size_t		memcount, linelen;
-	int			padwidth, avipadwidth, padlen, avipadlen;
+	size_t		linelen;
+	int			padwidth, padlen;
 	int			packAlign;
 
 	cmd = (const videoFrameCommand_t *)data;
@@ -1159,9 +1251,12 @@ const void *RB_TakeVideoFrameCmd( const void *data )
 	// Alignment stuff for glReadPixels
 	padwidth = PAD(linelen, packAlign);
 	padlen = padwidth - linelen;
-	// AVI line padding
-	avipadwidth = PAD(linelen, AVI_LINE_PADDING);
-	avipadlen = avipadwidth - linelen;
+
+#ifdef USE_VULKAN
+	if ( RB_ReadVideoFrameAsync( cmd->width, cmd->height ) ) {
+		return (const void *)(cmd + 1);
+	}
+#endif
 
 	cBuf = PADP(cmd->captureBuffer, packAlign);
 
@@ -1171,47 +1266,9 @@ const void *RB_TakeVideoFrameCmd( const void *data )
 	qglReadPixels(0, 0, cmd->width, cmd->height, GL_RGB, GL_UNSIGNED_BYTE, cBuf);
 #endif
 
-	memcount = padwidth * cmd->height;
-
-	// gamma correction
-	R_GammaCorrect( cBuf, memcount );
-
-	if ( cmd->motionJpeg )
-	{
-		memcount = ri.CL_SaveJPGToBuffer( cmd->encodeBuffer, linelen * cmd->height,
-			r_aviMotionJpegQuality->integer,
-			cmd->width, cmd->height, cBuf, padlen );
-		ri.CL_WriteAVIVideoFrame(cmd->encodeBuffer, memcount);
-	}
-	else
-	{
-		byte *lineend, *memend;
-		byte *srcptr, *destptr;
-
-		srcptr = cBuf;
-		destptr = cmd->encodeBuffer;
-		memend = srcptr + memcount;
-
-		// swap R and B and remove line paddings
-		while(srcptr < memend)
-		{
-			lineend = srcptr + linelen;
-			while(srcptr < lineend)
-			{
-				*destptr++ = srcptr[2];
-				*destptr++ = srcptr[1];
-				*destptr++ = srcptr[0];
-				srcptr += 3;
-			}
-
-			Com_Memset(destptr, '\0', avipadlen);
-			destptr += avipadlen;
-
-			srcptr += padlen;
-		}
-
-		ri.CL_WriteAVIVideoFrame(cmd->encodeBuffer, avipadwidth * cmd->height);
-	}
+	// encoding and gamma correction are done by the client
+	ri.CL_QueueAVIVideoFrame( cBuf, cmd->width, cmd->height, padlen,
+		R_GammaTable(), r_aviMotionJpegQuality->integer );
 
 	return (const void *)(cmd + 1);
 }
@@ -1471,6 +1528,8 @@ RE_SyncRender
 */
 static void RE_SyncRender( void )
 {
+	R_SyncRenderThread();
+
 #ifdef USE_VULKAN
 	if ( vk.device )
 		vk_wait_idle();
@@ -1490,6 +1549,7 @@ static void R_Register( void )
 {
 	// make sure all the commands added here are also removed in R_Shutdown
 	ri.Cmd_AddCommand( "imagelist", R_ImageList_f );
+	ri.Cmd_AddCommand( "r_imageBenchmark", R_ImageBenchmark_f );
 	ri.Cmd_AddCommand( "shaderlist", R_ShaderList_f );
 	ri.Cmd_AddCommand( "skinlist", R_SkinList_f );
 	ri.Cmd_AddCommand( "modellist", R_Modellist_f );
@@ -1520,6 +1580,24 @@ static void R_Register( void )
 
 	r_simpleMipMaps = ri.Cvar_Get( "r_simpleMipMaps", "1", CVAR_ARCHIVE_ND | CVAR_LATCH );
 	ri.Cvar_SetDescription( r_simpleMipMaps, "Whether or not to use a simple mipmapping algorithm or a more correct one:\n 0: off (proper linear filter)\n 1: on (for slower machines)" );
+	r_imagePrefetch = ri.Cvar_Get( "r_imagePrefetch", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_imagePrefetch, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_imagePrefetch, "Decode map textures on worker threads while the map is loading." );
+	r_imageSIMD = ri.Cvar_Get( "r_imageSIMD", "1", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_imageSIMD, "0", "2", CV_INTEGER );
+	ri.Cvar_SetDescription( r_imageSIMD, "Use SIMD instructions for texture resampling, mipmapping and format conversion, all modes produce identical images:\n 0: scalar code\n 1: best instruction set available\n 2: SSE2/NEON only" );
+	r_textureCache = ri.Cvar_Get( "r_textureCache", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_textureCache, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_textureCache, "Compress mipmapped textures to BC1/BC3 and keep them in texcache/ so that later loads skip image decoding, needs BC texture support." );
+	r_shaderCache = ri.Cvar_Get( "r_shaderCache", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_shaderCache, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_shaderCache, "Keep the combined shader scripts and their name index in shadercache.dat, which is reused while the set of shader files stays the same." );
+	r_frontEndThreads = ri.Cvar_Get( "r_frontEndThreads", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_frontEndThreads, "0", "15", CV_INTEGER );
+	ri.Cvar_SetDescription( r_frontEndThreads, "Number of worker threads for world culling, draw surface sorting and texture cache encoding, limited by the number of CPU cores. Idle workers keep polling for a few milliseconds, which shows up as CPU load." );
+	r_smp = ri.Cvar_Get( "r_smp", "0", CVAR_ARCHIVE_ND | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_smp, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_smp, "Run the renderer back end on its own thread, the next frame is prepared while the current one is drawn. Adds up to one frame of latency, needs at least two CPU cores." );
 	r_vertexLight = ri.Cvar_Get( "r_vertexLight", "0", CVAR_ARCHIVE | CVAR_LATCH );
 	ri.Cvar_SetDescription( r_vertexLight, "Set to 1 to use vertex light instead of lightmaps, collapse all multi-stage shaders into single-stage ones, might cause rendering artifacts." );
 
@@ -1730,6 +1808,11 @@ static void R_Register( void )
 
 	r_aviMotionJpegQuality = ri.Cvar_Get( "r_aviMotionJpegQuality", "90", CVAR_ARCHIVE_ND );
 	ri.Cvar_SetDescription( r_aviMotionJpegQuality, "Controls quality of Jpeg video capture when \\cl_aviMotionJpeg 1." );
+#ifdef USE_VULKAN
+	r_aviAsyncReadback = ri.Cvar_Get( "r_aviAsyncReadback", "1", CVAR_ARCHIVE_ND );
+	ri.Cvar_CheckRange( r_aviAsyncReadback, "0", "1", CV_INTEGER );
+	ri.Cvar_SetDescription( r_aviAsyncReadback, "Copy captured video frames into host visible images and read them a few frames late instead of stalling on every frame." );
+#endif
 	r_screenshotJpegQuality = ri.Cvar_Get( "r_screenshotJpegQuality", "90", CVAR_ARCHIVE_ND );
 	ri.Cvar_SetDescription( r_screenshotJpegQuality, "Controls quality of Jpeg screenshots when using screenshotJpeg." );
 
@@ -1901,15 +1984,24 @@ void R_Init( void ) {
 	max_polys = r_maxpolys->integer;
 	max_polyverts = r_maxpolyverts->integer;
 
-	ptr = ri.Hunk_Alloc( sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
-	backEndData = (backEndData_t *) ptr;
-	backEndData->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData ));
-	backEndData->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys);
+	// the render thread executes one frame while the front-end fills the other
+	Com_Memset( backEndFrames, 0, sizeof( backEndFrames ) );
+	for ( i = 0; i < ( r_smp->integer ? SMP_FRAMES : 1 ); i++ ) {
+		ptr = ri.Hunk_Alloc( sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
+		backEndFrames[i] = (backEndData_t *) ptr;
+		backEndFrames[i]->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData ));
+		backEndFrames[i]->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys);
+	}
+	backEndData = backEndFrames[0];
 
 	R_InitNextFrame();
 
 	InitOpenGL();
 
+	R_InitImageKernels( r_imageSIMD->integer );
+
+	R_InitJobs( r_frontEndThreads->integer );
+
 	R_InitImages();
 
 	VarInfo();
@@ -1932,6 +2024,16 @@ void R_Init( void ) {
 		ri.Printf( PRINT_WARNING, "glGetError() = 0x%x\n", err );
 #endif
 
+	if ( r_smp->integer ) {
+#ifdef USE_VULKAN
+		glConfig.smpActive = R_StartRenderThread( RB_ExecuteRenderCommands, NULL );
+#else
+		glConfig.smpActive = R_StartRenderThread( RB_ExecuteRenderCommands, ri.GLimp_MakeCurrent );
+#endif
+	} else {
+		glConfig.smpActive = qfalse;
+	}
+
 	ri.Printf( PRINT_ALL, "----- finished R_Init -----\n" );
 }
 
@@ -1956,6 +2058,7 @@ static void RE_Shutdown( refShutdownCode_t code ) {
 	ri.Cmd_RemoveCommand( "screenshotJPEG" );
 	ri.Cmd_RemoveCommand( "screenshot" );
 	ri.Cmd_RemoveCommand( "imagelist" );
+	ri.Cmd_RemoveCommand( "r_imageBenchmark" );
 	ri.Cmd_RemoveCommand( "shaderlist" );
 	ri.Cmd_RemoveCommand( "skinlist" );
 	ri.Cmd_RemoveCommand( "gfxinfo" );
@@ -1964,6 +2067,17 @@ static void RE_Shutdown( refShutdownCode_t code ) {
 	ri.Cmd_RemoveCommand( "vkinfo" );
 #endif
 
+	R_StopRenderThread();
+
+	R_FinishImagePrefetch();
+
+	R_ShutdownJobs();
+	R_FreeWorldJobs();
+
+#ifdef USE_VULKAN
+	RB_DestroyVideoReadback();
+#endif
+
 	if ( tr.registered ) {
 		//R_IssuePendingRenderCommands();
 		R_DeleteTextures();
@@ -2017,6 +2131,7 @@ Touch all images to make sure they are resident
 =============
 */
 static void RE_EndRegistration( void ) {
+	R_SyncRenderThread();
 #ifdef USE_VULKAN
 	vk_wait_idle();
 	// command buffer is not in recording state at this stage
@@ -2102,6 +2217,9 @@ refexport_t *GetRefAPI ( int apiVersion, refimport_t *rimp ) {
 	re.GetConfig = RE_GetConfig;
 	re.VertexLighting = RE_VertexLighting;
 	re.SyncRender = RE_SyncRender;
+#ifdef USE_VULKAN
+	re.FlushVideoFrames = RE_FlushVideoFrames;
+#endif
 
 	return &re;
 }
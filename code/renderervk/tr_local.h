@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define USE_PMLIGHT			// promode dynamic lights via \r_dlightMode 1|2
 #define MAX_REAL_DLIGHTS	(MAX_DLIGHTS*2)
 #define MAX_LITSURFS		(MAX_DRAWSURFS)
+#define SMP_FRAMES			2	// front-end frames in flight with r_smp
 #define	MAX_FLARES			256
 
 #define MAX_TEXTURE_SIZE	2048 // must be less or equal to 32768
@@ -440,6 +441,8 @@ typedef struct shader_s {
 
 	qboolean	entityMergable;			// merge across entites optimizable (smoke, blood)
 
+	int			videoMaps;				// bit mask of cinematic handles played by stages
+
 	qboolean	isSky;
 	skyParms_t	sky;
 	fogParms_t	fogParms;
@@ -715,7 +718,7 @@ typedef struct srfGridMesh_s {
 	surfaceType_t	surfaceType;
 
 	// dynamic lighting information
-	int				dlightBits;
+	int				dlightBits[SMP_FRAMES];
 
 	// culling information
 	vec3_t			meshBounds[2];
@@ -749,7 +752,7 @@ typedef struct {
 
 	// dynamic lighting information
 #ifdef USE_LEGACY_DLIGHTS
-	int			dlightBits;
+	int			dlightBits[SMP_FRAMES];
 #endif
 #ifdef USE_VBO
 	int			vboItemIndex;
@@ -771,7 +774,7 @@ typedef struct {
 
 	// dynamic lighting information
 #ifdef USE_LEGACY_DLIGHTS
-	int				dlightBits;
+	int				dlightBits[SMP_FRAMES];
 #endif
 #ifdef USE_VBO
 	int				vboItemIndex;
@@ -1100,8 +1103,6 @@ typedef struct videoFrameCommand_s {
 	int					width;
 	int					height;
 	byte				*captureBuffer;
-	byte				*encodeBuffer;
-	qboolean			motionJpeg;
 } videoFrameCommand_t;
 
 enum {
@@ -1141,6 +1142,8 @@ typedef struct {
 	qboolean drawConsole;
 	qboolean doneShadows;
 
+	int		smpFrame;			// backEndFrames index of the commands being executed
+
 	qboolean screenMapDone;
 	qboolean doneBloom;
 
@@ -1170,6 +1173,7 @@ typedef struct {
 #endif
 
 	int						frameSceneNum;	// zeroed at RE_BeginFrame
+	int						smpFrame;		// backEndFrames index the front-end fills
 
 	qboolean				worldMapLoaded;
 	world_t					*world;
@@ -1178,6 +1182,7 @@ typedef struct {
 
 	image_t					*defaultImage;
 	image_t					*scratchImage[ MAX_VIDEO_HANDLES ];
+	int						videoMaps;		// cinematics referenced in current frame
 	image_t					*fogImage;
 	image_t					*dlightImage;	// inverse-quare highlight for projective adding
 	image_t					*flareImage;
@@ -1401,6 +1406,12 @@ extern	cvar_t	*r_mapGreyScale;
 
 extern	cvar_t	*r_debugSurface;
 extern	cvar_t	*r_simpleMipMaps;
+extern	cvar_t	*r_imagePrefetch;
+extern	cvar_t	*r_imageSIMD;
+extern	cvar_t	*r_textureCache;
+extern	cvar_t	*r_shaderCache;
+extern	cvar_t	*r_frontEndThreads;
+extern	cvar_t	*r_smp;
 
 extern	cvar_t	*r_showImages;
 extern	cvar_t	*r_defaultImage;
@@ -1523,6 +1534,7 @@ void		R_Init( void );
 
 void		R_SetColorMappings( void );
 void		R_GammaCorrect( byte *buffer, int bufSize );
+const byte	*R_GammaTable( void );
 void		R_ColorShiftLightingBytes( const byte in[4], byte out[4], qboolean hasAlpha );
 
 void	R_ImageList_f( void );
@@ -1547,6 +1559,7 @@ shader_t	*R_FindShader( const char *name, int lightmapIndex, qboolean mipRawImag
 shader_t	*R_GetShaderByHandle( qhandle_t hShader );
 shader_t	*R_GetShaderByState( int index, long *cycleTime );
 shader_t	*R_FindShaderByName( const char *name );
+void		R_PrefetchShaderImages( const char *name );
 void		R_InitShaders( void );
 void		R_ShaderList_f( void );
 void		RE_RemapShader(const char *oldShader, const char *newShader, const char *timeOffset);
@@ -1655,6 +1668,7 @@ WORLD MAP
 
 void R_AddBrushModelSurfaces( trRefEntity_t *e );
 void R_AddWorldSurfaces( void );
+void R_FreeWorldJobs( void );
 qboolean R_inPVS( const vec3_t p1, const vec3_t p2 );
 
 
@@ -1958,6 +1972,7 @@ extern	int		max_polys;
 extern	int		max_polyverts;
 
 extern	backEndData_t	*backEndData;
+extern	backEndData_t	*backEndFrames[SMP_FRAMES];
 
 void RB_ExecuteRenderCommands( const void *data );
 void RB_TakeScreenshot( int x, int y, int width, int height, const char *fileName );
@@ -1971,8 +1986,7 @@ void RE_StretchPic ( float x, float y, float w, float h,
 					  float s1, float t1, float s2, float t2, qhandle_t hShader );
 void RE_BeginFrame( stereoFrame_t stereoFrame );
 void RE_EndFrame( int *frontEndMsec, int *backEndMsec );
-void RE_TakeVideoFrame( int width, int height,
-		byte *captureBuffer, byte *encodeBuffer, qboolean motionJpeg );
+void RE_TakeVideoFrame( int width, int height, byte *captureBuffer );
 
 void RE_FinishBloom( void );
 void RE_ThrottleBackend( void );
@@ -1297,6 +1297,112 @@ static ID_INLINE void R_Radix( int byte, int size, const drawSurf_t *source, dra
 }
 
 
+#define RADIX_JOB_MIN_SURFS		4096	// shorter lists are sorted by the calling thread
+
+typedef struct {
+	const drawSurf_t	*source;
+	drawSurf_t			*dest;
+	int					size;
+	int					byte;
+	int					numChunks;
+	int					index[ MAX_JOB_THREADS ][ 256 ];	// per chunk
+} radixJob_t;
+
+static radixJob_t radixJob;
+
+
+/*
+===============
+R_RadixChunk
+===============
+*/
+static void R_RadixChunk( const radixJob_t *job, int chunk, int *first, int *last )
+{
+	int chunkSize = job->size / job->numChunks;
+
+	*first = chunk * chunkSize;
+	*last = ( chunk == job->numChunks - 1 ) ? job->size : *first + chunkSize;
+}
+
+
+/*
+===============
+R_RadixCountJob
+===============
+*/
+static void R_RadixCountJob( void *arg, int chunk, int thread )
+{
+	radixJob_t *job = (radixJob_t *)arg;
+	int *count = job->index[ chunk ];
+	const unsigned char *sortKey;
+	int first, last, i;
+
+	R_RadixChunk( job, chunk, &first, &last );
+
+	Com_Memset( count, 0, 256 * sizeof( int ) );
+
+	sortKey = ( (const unsigned char *)&job->source[ first ].sort ) + job->byte;
+	for ( i = first; i < last; i++, sortKey += sizeof( drawSurf_t ) ) {
+		count[ *sortKey ]++;
+	}
+}
+
+
+/*
+===============
+R_RadixScatterJob
+===============
+*/
+static void R_RadixScatterJob( void *arg, int chunk, int thread )
+{
+	radixJob_t *job = (radixJob_t *)arg;
+	int *index = job->index[ chunk ];
+	const unsigned char *sortKey;
+	int first, last, i;
+
+	R_RadixChunk( job, chunk, &first, &last );
+
+	sortKey = ( (const unsigned char *)&job->source[ first ].sort ) + job->byte;
+	for ( i = first; i < last; i++, sortKey += sizeof( drawSurf_t ) ) {
+		job->dest[ index[ *sortKey ]++ ] = job->source[ i ];
+	}
+}
+
+
+/*
+===============
+R_RadixJobs
+
+R_Radix split into chunks on the front-end workers, each chunk places
+its surfaces after those of the previous chunks with the same key so
+the pass stays stable
+===============
+*/
+static void R_RadixJobs( int byte, int size, const drawSurf_t *source, drawSurf_t *dest )
+{
+	int i, chunk, total, n;
+
+	radixJob.source = source;
+	radixJob.dest = dest;
+	radixJob.size = size;
+	radixJob.byte = byte;
+	radixJob.numChunks = R_JobThreads();
+
+	R_RunJobs( R_RadixCountJob, &radixJob, radixJob.numChunks );
+
+	total = 0;
+	for ( i = 0; i < 256; i++ ) {
+		for ( chunk = 0; chunk < radixJob.numChunks; chunk++ ) {
+			n = radixJob.index[ chunk ][ i ];
+			radixJob.index[ chunk ][ i ] = total;
+			total += n;
+		}
+	}
+
+	R_RunJobs( R_RadixScatterJob, &radixJob, radixJob.numChunks );
+}
+
+
 /*
 ===============
 R_RadixSort
@@ -1307,16 +1413,21 @@ Radix sort with 4 byte size buckets
 static void R_RadixSort( drawSurf_t *source, int size )
 {
   static drawSurf_t scratch[ MAX_DRAWSURFS ];
+  void (*radix)( int byte, int size, const drawSurf_t *source, drawSurf_t *dest ) = R_Radix;
+
+  if ( size >= RADIX_JOB_MIN_SURFS && R_JobThreads() > 1 )
+    radix = R_RadixJobs;
+
 #ifdef Q3_LITTLE_ENDIAN
-  R_Radix( 0, size, source, scratch );
-  R_Radix( 1, size, scratch, source );
-  R_Radix( 2, size, source, scratch );
-  R_Radix( 3, size, scratch, source );
+  radix( 0, size, source, scratch );
+  radix( 1, size, scratch, source );
+  radix( 2, size, source, scratch );
+  radix( 3, size, scratch, source );
 #else
-  R_Radix( 3, size, source, scratch );
-  R_Radix( 2, size, scratch, source );
-  R_Radix( 1, size, source, scratch );
-  R_Radix( 0, size, scratch, source );
+  radix( 3, size, source, scratch );
+  radix( 2, size, scratch, source );
+  radix( 1, size, source, scratch );
+  radix( 0, size, scratch, source );
 #endif //Q3_LITTLE_ENDIAN
 }
 
@@ -1486,6 +1597,8 @@ void R_AddDrawSurf( surfaceType_t *surface, shader_t *shader,
 		| tr.shiftedEntityNum | ( fogIndex << QSORT_FOGNUM_SHIFT ) | (int)dlightMap;
 	tr.refdef.drawSurfs[index].surface = surface;
 	tr.refdef.numDrawSurfs++;
+
+	tr.videoMaps |= shader->videoMaps;
 }
 
 
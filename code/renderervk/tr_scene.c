@@ -47,6 +47,12 @@ R_InitNextFrame
 */
 void R_InitNextFrame( void ) {
 
+	if ( R_RenderThreadActive() ) {
+		// the render thread owns the frame that was just issued
+		tr.smpFrame = ( tr.smpFrame + 1 ) % SMP_FRAMES;
+		backEndData = backEndFrames[ tr.smpFrame ];
+	}
+
 	backEndData->commands.used = 0;
 
 	r_firstSceneDrawSurf = 0;
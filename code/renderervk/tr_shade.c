@@ -65,9 +65,9 @@ static void R_BindAnimatedImage( const textureBundle_t *bundle ) {
 	int64_t index;
 	double	v;
 
+	// updated by the front-end, see R_UpdateVideoMaps
 	if ( bundle->isVideoMap ) {
-		ri.CIN_RunCinematic(bundle->videoMapHandle);
-		ri.CIN_UploadCinematic(bundle->videoMapHandle);
+		GL_Bind( tr.scratchImage[ bundle->videoMapHandle ] );
 		return;
 	}
 
@@ -309,7 +309,7 @@ static void RB_SurfaceTriangles( const srfTriangles_t *srf ) {
 
 #ifdef USE_VBO
 #ifdef USE_LEGACY_DLIGHTS
-	if ( tess.allowVBO && srf->vboItemIndex && !srf->dlightBits ) {
+	if ( tess.allowVBO && srf->vboItemIndex && !srf->dlightBits[ backEnd.smpFrame ] ) {
 #else
 	if ( tess.allowVBO && srf->vboItemIndex ) {
 #endif
@@ -334,7 +334,7 @@ static void RB_SurfaceTriangles( const srfTriangles_t *srf ) {
 	RB_CHECKOVERFLOW( srf->numVerts, srf->numIndexes );
 
 #ifdef USE_LEGACY_DLIGHTS
-	dlightBits = srf->dlightBits;
+	dlightBits = srf->dlightBits[ backEnd.smpFrame ];
 	tess.dlightBits |= dlightBits;
 #endif
 
@@ -893,7 +893,7 @@ static void RB_SurfaceFace( const srfSurfaceFace_t *surf ) {
 
 #ifdef USE_VBO
 #ifdef USE_LEGACY_DLIGHTS
-	if ( tess.allowVBO && surf->vboItemIndex && !surf->dlightBits ) {
+	if ( tess.allowVBO && surf->vboItemIndex && !surf->dlightBits[ backEnd.smpFrame ] ) {
 #else
 	if ( tess.allowVBO && surf->vboItemIndex ) {
 #endif
@@ -922,7 +922,7 @@ static void RB_SurfaceFace( const srfSurfaceFace_t *surf ) {
 #endif
 
 #ifdef USE_LEGACY_DLIGHTS
-	dlightBits = surf->dlightBits;
+	dlightBits = surf->dlightBits[ backEnd.smpFrame ];
 	tess.dlightBits |= dlightBits;
 #endif
 
@@ -1099,7 +1099,7 @@ static void RB_SurfaceGrid( srfGridMesh_t *cv ) {
 
 #ifdef USE_VBO
 #ifdef USE_LEGACY_DLIGHTS
-	if ( tess.allowVBO && cv->vboItemIndex && !cv->dlightBits ) {
+	if ( tess.allowVBO && cv->vboItemIndex && !cv->dlightBits[ backEnd.smpFrame ] ) {
 #else
 	if ( tess.allowVBO && cv->vboItemIndex ) {
 #endif
@@ -1122,7 +1122,7 @@ static void RB_SurfaceGrid( srfGridMesh_t *cv ) {
 #endif // USE_VBO
 
 #ifdef USE_LEGACY_DLIGHTS
-	dlightBits = cv->dlightBits;
+	dlightBits = cv->dlightBits[ backEnd.smpFrame ];
 	tess.dlightBits |= dlightBits;
 #endif
 
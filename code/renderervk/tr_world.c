@@ -21,6 +21,45 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "tr_local.h"
 
+// world traversal on the front-end workers, see R_TraverseWorldJobs
+
+#define WORLD_JOB_DEPTH		7	// levels of the tree culled before subtrees are queued
+#define MAX_WORLD_JOBS		( 1 << WORLD_JOB_DEPTH )
+
+typedef struct {
+	msurface_t	*surf;
+	int			dlightBits;			// of the leaf it was found in
+} worldSurf_t;
+
+typedef struct {
+	worldSurf_t	*surfs;				// visible surfaces found by this thread
+	int			numSurfs;
+	int			*marks;				// per world surface, stamp of the last job that found it
+	int			stamp;				// of the current job
+	vec3_t		visBounds[2];
+	frontEndCounters_t pc;
+} worldThread_t;
+
+typedef struct {
+	mnode_t		*node;
+	unsigned int planeBits;
+	unsigned int dlightBits;
+	int			stamp;
+	int			thread;				// that traversed the subtree
+	int			firstSurf;			// in worldThreads[thread].surfs
+	int			numSurfs;
+} worldJob_t;
+
+static worldThread_t worldThreads[MAX_JOB_THREADS];
+static worldJob_t	worldJobs[MAX_WORLD_JOBS];
+static int			numWorldJobs;
+static int			worldStamp;
+
+static worldSurf_t	*worldSurfs;
+static int			worldSurfsPerThread;
+static int			*worldMarks;
+static int			worldMarksPerThread;
+static int			worldSurfThreads;
 
 
 /*
@@ -50,7 +89,7 @@ Returns true if the grid is completely culled away.
 Also sets the clipped hint bit in tess
 =================
 */
-static qboolean	R_CullGrid( srfGridMesh_t *cv ) {
+static qboolean	R_CullGrid( srfGridMesh_t *cv, frontEndCounters_t *pc ) {
 	int 	boxCull;
 	int 	sphereCull;
 
@@ -67,33 +106,33 @@ static qboolean	R_CullGrid( srfGridMesh_t *cv ) {
 	// check for trivial reject
 	if ( sphereCull == CULL_OUT )
 	{
-		tr.pc.c_sphere_cull_patch_out++;
+		pc->c_sphere_cull_patch_out++;
 		return qtrue;
 	}
 	// check bounding box if necessary
 	else if ( sphereCull == CULL_CLIP )
 	{
-		tr.pc.c_sphere_cull_patch_clip++;
+		pc->c_sphere_cull_patch_clip++;
 
 		boxCull = R_CullLocalBox( cv->meshBounds );
 
 		if ( boxCull == CULL_OUT ) 
 		{
-			tr.pc.c_box_cull_patch_out++;
+			pc->c_box_cull_patch_out++;
 			return qtrue;
 		}
 		else if ( boxCull == CULL_IN )
 		{
-			tr.pc.c_box_cull_patch_in++;
+			pc->c_box_cull_patch_in++;
 		}
 		else
 		{
-			tr.pc.c_box_cull_patch_clip++;
+			pc->c_box_cull_patch_clip++;
 		}
 	}
 	else
 	{
-		tr.pc.c_sphere_cull_patch_in++;
+		pc->c_sphere_cull_patch_in++;
 	}
 
 	return qfalse;
@@ -110,7 +149,7 @@ added to the sorting list.
 This will also allow mirrors on both sides of a model without recursion.
 ================
 */
-static qboolean	R_CullSurface( const surfaceType_t *surface, shader_t *shader ) {
+static qboolean	R_CullSurface( const surfaceType_t *surface, shader_t *shader, frontEndCounters_t *pc ) {
 	srfSurfaceFace_t *sface;
 	float			d;
 
@@ -119,7 +158,7 @@ static qboolean	R_CullSurface( const surfaceType_t *surface, shader_t *shader )
 	}
 
 	if ( *surface == SF_GRID ) {
-		return R_CullGrid( (srfGridMesh_t *)surface );
+		return R_CullGrid( (srfGridMesh_t *)surface, pc );
 	}
 
 	if ( *surface == SF_TRIANGLES ) {
@@ -242,7 +281,7 @@ static qboolean R_LightCullSurface( const surfaceType_t* surface, const dlight_t
 
 
 #ifdef USE_LEGACY_DLIGHTS
-static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits ) {
+static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits, frontEndCounters_t *pc ) {
 	float		d;
 	int			i;
 	const dlight_t	*dl;
@@ -260,15 +299,15 @@ static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits ) {
 	}
 
 	if ( !dlightBits ) {
-		tr.pc.c_dlightSurfacesCulled++;
+		pc->c_dlightSurfacesCulled++;
 	}
 
-	face->dlightBits = dlightBits;
+	face->dlightBits[ tr.smpFrame ] = dlightBits;
 	return dlightBits;
 }
 
 
-static int R_DlightGrid( srfGridMesh_t *grid, int dlightBits ) {
+static int R_DlightGrid( srfGridMesh_t *grid, int dlightBits, frontEndCounters_t *pc ) {
 	int			i;
 	const dlight_t	*dl;
 
@@ -289,17 +328,17 @@ static int R_DlightGrid( srfGridMesh_t *grid, int dlightBits ) {
 	}
 
 	if ( !dlightBits ) {
-		tr.pc.c_dlightSurfacesCulled++;
+		pc->c_dlightSurfacesCulled++;
 	}
 
-	grid->dlightBits = dlightBits;
+	grid->dlightBits[ tr.smpFrame ] = dlightBits;
 	return dlightBits;
 }
 
 
 static int R_DlightTrisurf( srfTriangles_t *surf, int dlightBits ) {
 	// FIXME: more dlight culling to trisurfs...
-	surf->dlightBits = dlightBits;
+	surf->dlightBits[ tr.smpFrame ] = dlightBits;
 	return dlightBits;
 #if 0
 	int			i;
@@ -325,7 +364,7 @@ static int R_DlightTrisurf( srfTriangles_t *surf, int dlightBits ) {
 		tr.pc.c_dlightSurfacesCulled++;
 	}
 
-	grid->dlightBits = dlightBits;
+	grid->dlightBits[ tr.smpFrame ] = dlightBits;
 	return dlightBits;
 #endif
 }
@@ -340,11 +379,11 @@ that is touched by one or more dlights, so try to throw out
 more dlights if possible.
 ====================
 */
-static int R_DlightSurface( msurface_t *surf, int dlightBits ) {
+static int R_DlightSurface( msurface_t *surf, int dlightBits, frontEndCounters_t *pc ) {
 	if ( *surf->data == SF_FACE ) {
-		dlightBits = R_DlightFace( (srfSurfaceFace_t *)surf->data, dlightBits );
+		dlightBits = R_DlightFace( (srfSurfaceFace_t *)surf->data, dlightBits, pc );
 	} else if ( *surf->data == SF_GRID ) {
-		dlightBits = R_DlightGrid( (srfGridMesh_t *)surf->data, dlightBits );
+		dlightBits = R_DlightGrid( (srfGridMesh_t *)surf->data, dlightBits, pc );
 	} else if ( *surf->data == SF_TRIANGLES ) {
 		dlightBits = R_DlightTrisurf( (srfTriangles_t *)surf->data, dlightBits );
 	} else {
@@ -352,7 +391,7 @@ static int R_DlightSurface( msurface_t *surf, int dlightBits ) {
 	}
 
 	if ( dlightBits ) {
-		tr.pc.c_dlightSurfaces++;
+		pc->c_dlightSurfaces++;
 	}
 
 	return dlightBits;
@@ -374,7 +413,7 @@ static void R_AddWorldSurface( msurface_t *surf, int dlightBits ) {
 	// FIXME: bmodel fog?
 
 	// try to cull before dlighting or adding
-	if ( R_CullSurface( surf->data, surf->shader ) ) {
+	if ( R_CullSurface( surf->data, surf->shader, &tr.pc ) ) {
 		return;
 	}
 
@@ -392,7 +431,7 @@ static void R_AddWorldSurface( msurface_t *surf, int dlightBits ) {
 #ifdef USE_LEGACY_DLIGHTS
 	// check for dlighting
 	if ( dlightBits ) {
-		dlightBits = R_DlightSurface( surf, dlightBits );
+		dlightBits = R_DlightSurface( surf, dlightBits, &tr.pc );
 		dlightBits = ( dlightBits != 0 );
 	}
 
@@ -401,6 +440,48 @@ static void R_AddWorldSurface( msurface_t *surf, int dlightBits ) {
 }
 
 
+/*
+======================
+R_MarkWorldSurface
+
+R_AddWorldSurface for the front-end workers, the surface is only collected.
+A surface shared by leafs of different subtrees is collected by each of them,
+R_TraverseWorldJobs keeps the first one in traversal order
+======================
+*/
+static void R_MarkWorldSurface( worldThread_t *wt, msurface_t *surf, int dlightBits ) {
+	worldSurf_t *ws;
+	int *mark;
+
+	mark = &wt->marks[ surf - tr.world->surfaces ];
+	if ( *mark == wt->stamp ) {
+		return;		// already in this subtree
+	}
+	*mark = wt->stamp;
+
+	// same value from every thread
+	surf->viewCount = tr.viewCount;
+
+	// try to cull before adding, dlights are checked when merging
+	if ( R_CullSurface( surf->data, surf->shader, &wt->pc ) ) {
+		return;
+	}
+
+	ws = &wt->surfs[ wt->numSurfs++ ];
+	ws->surf = surf;
+	ws->dlightBits = dlightBits;
+
+#ifdef USE_PMLIGHT
+#ifdef USE_LEGACY_DLIGHTS
+	if ( r_dlightMode->integer ) 
+#endif
+	{
+		surf->vcVisible = tr.viewCount;
+	}
+#endif // USE_PMLIGHT
+}
+
+
 /*
 =============================================================
 	PM LIGHTING
@@ -586,65 +667,96 @@ void R_AddBrushModelSurfaces ( trRefEntity_t *ent ) {
 
 /*
 ================
-R_RecursiveWorldNode
+R_CullWorldNode
+
+Returns qtrue if the node is outside the PVS or the frustum, planeBits
+receives the frustum planes its children still have to be tested against
 ================
 */
-static void R_RecursiveWorldNode( mnode_t *node, unsigned int planeBits, unsigned int dlightBits ) {
+static qboolean R_CullWorldNode( mnode_t *node, unsigned int *planeBits ) {
+	int		i, r;
 
-	do {
-		unsigned int newDlights[2];
+	// if the node wasn't marked as potentially visible, exit
+	if ( node->visframe != tr.visCount ) {
+		return qtrue;
+	}
 
-		// if the node wasn't marked as potentially visible, exit
-		if (node->visframe != tr.visCount) {
-			return;
+	// if the bounding volume is outside the frustum, nothing
+	// inside can be visible OPTIMIZE: don't do this all the way to leafs?
+
+	if ( r_nocull->integer ) {
+		return qfalse;
+	}
+
+	for ( i = 0; i < 4; i++ ) {
+		if ( *planeBits & ( 1 << i ) ) {
+			r = BoxOnPlaneSide( node->mins, node->maxs, &tr.viewParms.frustum[i] );
+			if ( r == 2 ) {
+				return qtrue;					// culled
+			}
+			if ( r == 1 ) {
+				*planeBits &= ~( 1 << i );		// all descendants will also be in front
+			}
 		}
+	}
 
-		// if the bounding volume is outside the frustum, nothing
-		// inside can be visible OPTIMIZE: don't do this all the way to leafs?
+	return qfalse;
+}
 
-		if ( !r_nocull->integer ) {
-			int		r;
 
-			if ( planeBits & 1 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[0]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~1;			// all descendants will also be in front
-				}
-			}
+/*
+================
+R_NodeDlights
 
-			if ( planeBits & 2 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[1]);
-				if (r == 2) {
-					return;						// culled
+Determines which dlights are needed on each side of the node
+================
+*/
+static void R_NodeDlights( const mnode_t *node, unsigned int dlightBits, unsigned int newDlights[2] ) {
+	newDlights[0] = 0;
+	newDlights[1] = 0;
+#ifdef USE_LEGACY_DLIGHTS
+#ifdef USE_PMLIGHT
+	if ( !r_dlightMode->integer )
+#endif
+	if ( dlightBits ) {
+		int	i;
+
+		for ( i = 0 ; i < tr.refdef.num_dlights ; i++ ) {
+			const dlight_t	*dl;
+			float		dist;
+
+			if ( dlightBits & ( 1 << i ) ) {
+				dl = &tr.refdef.dlights[i];
+				dist = DotProduct( dl->origin, node->plane->normal ) - node->plane->dist;
+				
+				if ( dist > -dl->radius ) {
+					newDlights[0] |= ( 1 << i );
 				}
-				if ( r == 1 ) {
-					planeBits &= ~2;			// all descendants will also be in front
+				if ( dist < dl->radius ) {
+					newDlights[1] |= ( 1 << i );
 				}
 			}
+		}
+	}
+#endif // USE_LEGACY_DLIGHTS
+}
 
-			if ( planeBits & 4 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[2]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~4;			// all descendants will also be in front
-				}
-			}
 
-			if ( planeBits & 8 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[3]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~8;			// all descendants will also be in front
-				}
-			}
+/*
+================
+R_RecursiveWorldNode
 
+With a worker context the visible surfaces are collected in wt->surfs
+instead of being added to the view
+================
+*/
+static void R_RecursiveWorldNode( worldThread_t *wt, mnode_t *node, unsigned int planeBits, unsigned int dlightBits ) {
+
+	do {
+		unsigned int newDlights[2];
+
+		if ( R_CullWorldNode( node, &planeBits ) ) {
+			return;
 		}
 
 		if ( node->contents != CONTENTS_NODE ) {
@@ -655,36 +767,10 @@ static void R_RecursiveWorldNode( mnode_t *node, unsigned int planeBits, unsigne
 		// since we don't care about sort orders, just go positive to negative
 
 		// determine which dlights are needed
-		newDlights[0] = 0;
-		newDlights[1] = 0;
-#ifdef USE_LEGACY_DLIGHTS
-#ifdef USE_PMLIGHT
-		if ( !r_dlightMode->integer )
-#endif
-		if ( dlightBits ) {
-			int	i;
-
-			for ( i = 0 ; i < tr.refdef.num_dlights ; i++ ) {
-				const dlight_t	*dl;
-				float		dist;
-
-				if ( dlightBits & ( 1 << i ) ) {
-					dl = &tr.refdef.dlights[i];
-					dist = DotProduct( dl->origin, node->plane->normal ) - node->plane->dist;
-					
-					if ( dist > -dl->radius ) {
-						newDlights[0] |= ( 1 << i );
-					}
-					if ( dist < dl->radius ) {
-						newDlights[1] |= ( 1 << i );
-					}
-				}
-			}
-		}
-#endif // USE_LEGACY_DLIGHTS
+		R_NodeDlights( node, dlightBits, newDlights );
 
 		// recurse down the children, front side first
-		R_RecursiveWorldNode( node->children[0], planeBits, newDlights[0] );
+		R_RecursiveWorldNode( wt, node->children[0], planeBits, newDlights[0] );
 
 		// tail recurse
 		node = node->children[1];
@@ -697,33 +783,47 @@ static void R_RecursiveWorldNode( mnode_t *node, unsigned int planeBits, unsigne
 		// leaf node, so add mark surfaces
 		int			c;
 		msurface_t	*surf, **mark;
+		vec3_t		*visBounds;
 
-		tr.pc.c_leafs++;
+		if ( wt ) {
+			wt->pc.c_leafs++;
+			visBounds = wt->visBounds;
+		} else {
+			tr.pc.c_leafs++;
+			visBounds = tr.viewParms.visBounds;
+		}
 
 		// add to z buffer bounds
-		if ( node->mins[0] < tr.viewParms.visBounds[0][0] ) {
-			tr.viewParms.visBounds[0][0] = node->mins[0];
+		if ( node->mins[0] < visBounds[0][0] ) {
+			visBounds[0][0] = node->mins[0];
 		}
-		if ( node->mins[1] < tr.viewParms.visBounds[0][1] ) {
-			tr.viewParms.visBounds[0][1] = node->mins[1];
+		if ( node->mins[1] < visBounds[0][1] ) {
+			visBounds[0][1] = node->mins[1];
 		}
-		if ( node->mins[2] < tr.viewParms.visBounds[0][2] ) {
-			tr.viewParms.visBounds[0][2] = node->mins[2];
+		if ( node->mins[2] < visBounds[0][2] ) {
+			visBounds[0][2] = node->mins[2];
 		}
 
-		if ( node->maxs[0] > tr.viewParms.visBounds[1][0] ) {
-			tr.viewParms.visBounds[1][0] = node->maxs[0];
+		if ( node->maxs[0] > visBounds[1][0] ) {
+			visBounds[1][0] = node->maxs[0];
 		}
-		if ( node->maxs[1] > tr.viewParms.visBounds[1][1] ) {
-			tr.viewParms.visBounds[1][1] = node->maxs[1];
+		if ( node->maxs[1] > visBounds[1][1] ) {
+			visBounds[1][1] = node->maxs[1];
 		}
-		if ( node->maxs[2] > tr.viewParms.visBounds[1][2] ) {
-			tr.viewParms.visBounds[1][2] = node->maxs[2];
+		if ( node->maxs[2] > visBounds[1][2] ) {
+			visBounds[1][2] = node->maxs[2];
 		}
 
 		// add the individual surfaces
 		mark = node->firstmarksurface;
 		c = node->nummarksurfaces;
+		if ( wt ) {
+			while ( c-- ) {
+				R_MarkWorldSurface( wt, *mark, dlightBits );
+				mark++;
+			}
+			return;
+		}
 		while (c--) {
 			// the surface may have already been added if it
 			// spans multiple leafs
@@ -735,6 +835,180 @@ static void R_RecursiveWorldNode( mnode_t *node, unsigned int planeBits, unsigne
 }
 
 
+/*
+================
+R_SplitWorldNode
+
+Culls the top levels of the tree and queues the subtrees below them
+in traversal order
+================
+*/
+static void R_SplitWorldNode( mnode_t *node, unsigned int planeBits, unsigned int dlightBits, int depth ) {
+	unsigned int newDlights[2];
+	worldJob_t *job;
+
+	if ( R_CullWorldNode( node, &planeBits ) ) {
+		return;
+	}
+
+	if ( node->contents == CONTENTS_NODE && depth > 0 ) {
+		R_NodeDlights( node, dlightBits, newDlights );
+		R_SplitWorldNode( node->children[0], planeBits, newDlights[0], depth - 1 );
+		R_SplitWorldNode( node->children[1], planeBits, newDlights[1], depth - 1 );
+		return;
+	}
+
+	job = &worldJobs[ numWorldJobs++ ];
+	job->node = node;
+	job->planeBits = planeBits;
+	job->dlightBits = dlightBits;
+	job->stamp = ++worldStamp;
+}
+
+
+/*
+================
+R_WorldNodeJob
+================
+*/
+static void R_WorldNodeJob( void *arg, int index, int thread ) {
+	worldJob_t *job = &worldJobs[ index ];
+	worldThread_t *wt = &worldThreads[ thread ];
+
+	job->thread = thread;
+	job->firstSurf = wt->numSurfs;
+	wt->stamp = job->stamp;
+
+	R_RecursiveWorldNode( wt, job->node, job->planeBits, job->dlightBits );
+
+	job->numSurfs = wt->numSurfs - job->firstSurf;
+}
+
+
+/*
+================
+R_TraverseWorldJobs
+
+Runs R_RecursiveWorldNode for the subtrees on the front-end workers,
+then merges the surfaces in subtree order, dropping the ones found by an
+earlier subtree, so the draw surfaces come out in exactly the order of a
+single traversal regardless of which thread ran which subtree.
+
+Entity surfaces are still generated on the main thread: MD3/IQM/brush
+model code writes shared state (tr.or, transformed dlights, lit surface
+lists and entity lighting) and costs little next to the world traversal.
+================
+*/
+static void R_TraverseWorldJobs( unsigned int dlightBits ) {
+	const worldSurf_t *ws;
+	worldThread_t *wt;
+	const worldJob_t *job;
+	msurface_t *surf;
+	int numThreads, stamp;
+	int i, j, *mark;
+
+	numThreads = R_JobThreads();
+
+	// a subtree collects each surface at most once, so all of them together
+	// can't collect more surfaces than there are leaf references
+	if ( worldSurfsPerThread < tr.world->nummarksurfaces || worldMarksPerThread < tr.world->numsurfaces || worldSurfThreads < numThreads ) {
+		R_FreeWorldJobs();
+		worldSurfsPerThread = tr.world->nummarksurfaces;
+		worldMarksPerThread = tr.world->numsurfaces;
+		worldSurfThreads = numThreads;
+		worldSurfs = ri.Malloc( worldSurfsPerThread * worldSurfThreads * sizeof( worldSurf_t ) );
+		worldMarks = ri.Malloc( worldMarksPerThread * worldSurfThreads * sizeof( int ) );
+		Com_Memset( worldMarks, 0, worldMarksPerThread * worldSurfThreads * sizeof( int ) );
+	}
+
+	for ( i = 0; i < numThreads; i++ ) {
+		wt = &worldThreads[ i ];
+		Com_Memset( wt, 0, sizeof( *wt ) );
+		wt->surfs = worldSurfs + i * worldSurfsPerThread;
+		wt->marks = worldMarks + i * worldMarksPerThread;
+		ClearBounds( wt->visBounds[0], wt->visBounds[1] );
+	}
+
+	numWorldJobs = 0;
+	R_SplitWorldNode( tr.world->nodes, 15, dlightBits, WORLD_JOB_DEPTH );
+
+	R_RunJobs( R_WorldNodeJob, NULL, numWorldJobs );
+
+	// main thread marks are free again
+	stamp = ++worldStamp;
+
+	for ( i = 0, job = worldJobs; i < numWorldJobs; i++, job++ ) {
+		ws = worldThreads[ job->thread ].surfs + job->firstSurf;
+		for ( j = 0; j < job->numSurfs; j++, ws++ ) {
+			surf = ws->surf;
+			mark = &worldThreads[ 0 ].marks[ surf - tr.world->surfaces ];
+			if ( *mark == stamp ) {
+				continue;	// added by an earlier subtree
+			}
+			*mark = stamp;
+
+#ifdef USE_PMLIGHT
+#ifdef USE_LEGACY_DLIGHTS
+			if ( r_dlightMode->integer )
+#endif
+			{
+				R_AddDrawSurf( surf->data, surf->shader, surf->fogIndex, 0 );
+				continue;
+			}
+#endif // USE_PMLIGHT
+
+#ifdef USE_LEGACY_DLIGHTS
+			R_AddDrawSurf( surf->data, surf->shader, surf->fogIndex,
+				ws->dlightBits ? ( R_DlightSurface( surf, ws->dlightBits, &tr.pc ) != 0 ) : 0 );
+#endif // USE_LEGACY_DLIGHTS
+		}
+	}
+
+	for ( i = 0; i < numThreads; i++ ) {
+		wt = &worldThreads[ i ];
+
+		for ( j = 0; j < 3; j++ ) {
+			if ( wt->visBounds[0][j] < tr.viewParms.visBounds[0][j] ) {
+				tr.viewParms.visBounds[0][j] = wt->visBounds[0][j];
+			}
+			if ( wt->visBounds[1][j] > tr.viewParms.visBounds[1][j] ) {
+				tr.viewParms.visBounds[1][j] = wt->visBounds[1][j];
+			}
+		}
+
+		tr.pc.c_leafs += wt->pc.c_leafs;
+		tr.pc.c_sphere_cull_patch_in += wt->pc.c_sphere_cull_patch_in;
+		tr.pc.c_sphere_cull_patch_clip += wt->pc.c_sphere_cull_patch_clip;
+		tr.pc.c_sphere_cull_patch_out += wt->pc.c_sphere_cull_patch_out;
+		tr.pc.c_box_cull_patch_in += wt->pc.c_box_cull_patch_in;
+		tr.pc.c_box_cull_patch_clip += wt->pc.c_box_cull_patch_clip;
+		tr.pc.c_box_cull_patch_out += wt->pc.c_box_cull_patch_out;
+		tr.pc.c_dlightSurfaces += wt->pc.c_dlightSurfaces;
+		tr.pc.c_dlightSurfacesCulled += wt->pc.c_dlightSurfacesCulled;
+	}
+}
+
+
+/*
+================
+R_FreeWorldJobs
+================
+*/
+void R_FreeWorldJobs( void ) {
+	if ( worldSurfs ) {
+		ri.Free( worldSurfs );
+		worldSurfs = NULL;
+	}
+	if ( worldMarks ) {
+		ri.Free( worldMarks );
+		worldMarks = NULL;
+	}
+	worldSurfsPerThread = 0;
+	worldMarksPerThread = 0;
+	worldSurfThreads = 0;
+}
+
+
 /*
 ===============
 R_PointInLeaf
@@ -912,7 +1186,11 @@ void R_AddWorldSurfaces( void ) {
 		tr.refdef.num_dlights = MAX_DLIGHTS;
 	}
 
-	R_RecursiveWorldNode( tr.world->nodes, 15, ( 1ULL << tr.refdef.num_dlights ) - 1 );
+	if ( R_JobThreads() > 1 ) {
+		R_TraverseWorldJobs( ( 1ULL << tr.refdef.num_dlights ) - 1 );
+	} else {
+		R_RecursiveWorldNode( NULL, tr.world->nodes, 15, ( 1ULL << tr.refdef.num_dlights ) - 1 );
+	}
 
 #ifdef USE_PMLIGHT
 #ifdef USE_LEGACY_DLIGHTS
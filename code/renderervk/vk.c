@@ -107,6 +107,7 @@ static PFN_vkFreeDescriptorSets							qvkFreeDescriptorSets;
 static PFN_vkFreeMemory									qvkFreeMemory;
 static PFN_vkGetBufferMemoryRequirements				qvkGetBufferMemoryRequirements;
 static PFN_vkGetDeviceQueue								qvkGetDeviceQueue;
+static PFN_vkGetFenceStatus								qvkGetFenceStatus;
 static PFN_vkGetImageMemoryRequirements					qvkGetImageMemoryRequirements;
 static PFN_vkGetImageSubresourceLayout					qvkGetImageSubresourceLayout;
 static PFN_vkInvalidateMappedMemoryRanges				qvkInvalidateMappedMemoryRanges;
@@ -1673,6 +1674,12 @@ static qboolean vk_create_device( VkPhysicalDevice physical_device, int device_i
 			vk.samplerAnisotropy = qtrue;
 		}
 
+		// pre-compressed uploads from the texture cache
+		if ( r_textureCache->integer && device_features.textureCompressionBC ) {
+			features.textureCompressionBC = VK_TRUE;
+			vk.textureCompressionBC = qtrue;
+		}
+
 		device_desc.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 		device_desc.pNext = NULL;
 		device_desc.flags = 0;
@@ -1959,6 +1966,7 @@ static void init_vulkan_library( void )
 	INIT_DEVICE_FUNCTION(vkFreeMemory)
 	INIT_DEVICE_FUNCTION(vkGetBufferMemoryRequirements)
 	INIT_DEVICE_FUNCTION(vkGetDeviceQueue)
+	INIT_DEVICE_FUNCTION(vkGetFenceStatus)
 	INIT_DEVICE_FUNCTION(vkGetImageMemoryRequirements)
 	INIT_DEVICE_FUNCTION(vkGetImageSubresourceLayout)
 	INIT_DEVICE_FUNCTION(vkInvalidateMappedMemoryRanges)
@@ -2089,6 +2097,7 @@ static void deinit_device_functions( void )
 	qvkFreeMemory								= NULL;
 	qvkGetBufferMemoryRequirements				= NULL;
 	qvkGetDeviceQueue							= NULL;
+	qvkGetFenceStatus							= NULL;
 	qvkGetImageMemoryRequirements				= NULL;
 	qvkGetImageSubresourceLayout				= NULL;
 	qvkInvalidateMappedMemoryRanges				= NULL;
@@ -4588,63 +4597,38 @@ void vk_create_image( image_t *image, int width, int height, int mip_levels ) {
 static byte *resample_image_data( const int target_format, byte *data, const int data_size, int *bytes_per_pixel )
 {
 	byte* buffer;
-	uint16_t* p;
-	int i, n;
 
 	switch ( target_format ) {
 	case VK_FORMAT_B4G4R4A4_UNORM_PACK16:
 		buffer = (byte*)ri.Hunk_AllocateTempMemory( data_size / 2 );
-		p = (uint16_t*)buffer;
-		for ( i = 0; i < data_size; i += 4, p++ ) {
-			byte r = data[i + 0];
-			byte g = data[i + 1];
-			byte b = data[i + 2];
-			byte a = data[i + 3];
-			*p = (uint32_t)((a / 255.0) * 15.0 + 0.5) |
-				((uint32_t)((r / 255.0) * 15.0 + 0.5) << 4) |
-				((uint32_t)((g / 255.0) * 15.0 + 0.5) << 8) |
-				((uint32_t)((b / 255.0) * 15.0 + 0.5) << 12);
-		}
+		R_PackImageRGBA4( (uint16_t*)buffer, data, data_size / 4 );
 		*bytes_per_pixel = 2;
 		return buffer; // must be freed after upload!
 
 	case VK_FORMAT_A1R5G5B5_UNORM_PACK16:
 		buffer = (byte*)ri.Hunk_AllocateTempMemory( data_size / 2 );
-		p = (uint16_t*)buffer;
-		for ( i = 0; i < data_size; i += 4, p++ ) {
-			byte r = data[i + 0];
-			byte g = data[i + 1];
-			byte b = data[i + 2];
-			*p = (uint32_t)((b / 255.0) * 31.0 + 0.5) |
-				((uint32_t)((g / 255.0) * 31.0 + 0.5) << 5) |
-				((uint32_t)((r / 255.0) * 31.0 + 0.5) << 10) |
-				(1 << 15);
-		}
+		R_PackImageRGB5A1( (uint16_t*)buffer, data, data_size / 4 );
 		*bytes_per_pixel = 2;
 		return buffer; // must be freed after upload!
 
 	case VK_FORMAT_B8G8R8A8_UNORM:
 		buffer = (byte*)ri.Hunk_AllocateTempMemory( data_size );
-		for ( i = 0; i < data_size; i += 4 ) {
-			buffer[i + 0] = data[i + 2];
-			buffer[i + 1] = data[i + 1];
-			buffer[i + 2] = data[i + 0];
-			buffer[i + 3] = data[i + 3];
-		}
+		R_SwizzleImageBGRA( buffer, data, data_size / 4 );
 		*bytes_per_pixel = 4;
 		return buffer;
 
 	case VK_FORMAT_R8G8B8_UNORM: {
 		buffer = (byte*)ri.Hunk_AllocateTempMemory( (data_size * 3) / 4 );
-		for ( i = 0, n = 0; i < data_size; i += 4, n += 3 ) {
-			buffer[n + 0] = data[i + 0];
-			buffer[n + 1] = data[i + 1];
-			buffer[n + 2] = data[i + 2];
-		}
+		R_PackImageRGB( buffer, data, data_size / 4 );
 		*bytes_per_pixel = 3;
 		return buffer;
 	}
 
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+		*bytes_per_pixel = 0; // already compressed
+		return data;
+
 	default:
 		*bytes_per_pixel = 4;
 		return data;
@@ -4685,7 +4669,10 @@ void vk_upload_image_data( image_t *image, int x, int y, int width, int height,
 		regions[num_regions] = region;
 		num_regions++;
 
-		buffer_size += width * height * bpp;
+		if ( bpp == 0 )
+			buffer_size += R_CompressedLevelSize( width, height, image->internalFormat == VK_FORMAT_BC3_UNORM_BLOCK ? IMAGECACHE_BC3 : IMAGECACHE_BC1 );
+		else
+			buffer_size += width * height * bpp;
 
 		if ( num_regions >= mipmaps || (width == 1 && height == 1) || num_regions >= ARRAY_LEN( regions ) )
 			break;
@@ -7137,6 +7124,35 @@ static void vk_resize_geometry_buffer( void )
 }
 
 
+/*
+Video frames are copied into a ring of host visible images right after the
+frame has been submitted and converted a few frames later, once their fence
+has signalled, so capturing doesn't stall on every frame. The copy is
+chained between rendering and presentation with its own semaphore because
+it may read the swapchain image.
+*/
+
+typedef struct {
+	VkImage			image;
+	VkDeviceMemory	memory;
+	VkCommandBuffer	command_buffer;
+	VkFence			fence;
+} vk_readback_frame_t;
+
+static struct {
+	vk_readback_frame_t frames[ VK_READBACK_FRAMES ];
+	VkSemaphore		copied;			// signalled for vk_present_frame()
+	qboolean		presentWait;
+	VkFormat		format;
+	uint32_t		width, height;
+	qboolean		invalidate_ptr;
+	byte			*pixels;
+	int				head;			// next frame to copy into
+	int				numPending;
+	qboolean		created;
+} vk_readback;
+
+
 void vk_end_frame( void )
 {
 	const VkPipelineStageFlags wait_dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -7240,7 +7256,13 @@ void vk_present_frame( void )
 	present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	present_info.pNext = NULL;
 	present_info.waitSemaphoreCount = 1;
-	present_info.pWaitSemaphores = &vk.cmd->rendering_finished;
+	if ( vk_readback.presentWait ) {
+		// video frame copy queued after rendering
+		present_info.pWaitSemaphores = &vk_readback.copied;
+		vk_readback.presentWait = qfalse;
+	} else {
+		present_info.pWaitSemaphores = &vk.cmd->rendering_finished;
+	}
 	present_info.swapchainCount = 1;
 	present_info.pSwapchains = &vk.swapchain;
 	present_info.pImageIndices = &vk.swapchain_image_index;
@@ -7286,41 +7308,13 @@ static qboolean is_bgr( VkFormat format ) {
 }
 
 
-void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
+static void vk_create_readback_image( uint32_t width, uint32_t height, VkImage *image, VkDeviceMemory *memory, qboolean *invalidate_ptr )
 {
-	VkCommandBuffer command_buffer;
-	VkDeviceMemory memory;
 	VkMemoryRequirements memory_requirements;
 	VkMemoryPropertyFlags memory_reqs;
 	VkMemoryPropertyFlags memory_flags;
 	VkMemoryAllocateInfo alloc_info;
-	VkImageSubresource subresource;
-	VkSubresourceLayout layout;
 	VkImageCreateInfo desc;
-	VkImage srcImage;
-	VkImageLayout srcImageLayout;
-	VkImage dstImage;
-	byte *buffer_ptr;
-	byte *data;
-	uint32_t pixel_width;
-	uint32_t i, n;
-	qboolean invalidate_ptr;
-
-	VK_CHECK( qvkWaitForFences( vk.device, 1, &vk.cmd->rendering_finished_fence, VK_FALSE, 1e12 ) );
-
-	if ( vk.fboActive ) {
-		if ( vk.capture.image ) {
-			// dedicated capture buffer
-			srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-			srcImage = vk.capture.image;
-		} else {
-			srcImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			srcImage = vk.color_image;
-		}
-	} else {
-		srcImageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-		srcImage = vk.swapchain_images[ vk.swapchain_image_index ];
-	}
 
 	Com_Memset( &desc, 0, sizeof( desc ) );
 
@@ -7343,9 +7337,9 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 	desc.pQueueFamilyIndices = NULL;
 	desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-	VK_CHECK( qvkCreateImage( vk.device, &desc, NULL, &dstImage ) );
+	VK_CHECK( qvkCreateImage( vk.device, &desc, NULL, image ) );
 
-	qvkGetImageMemoryRequirements( vk.device, dstImage, &memory_requirements );
+	qvkGetImageMemoryRequirements( vk.device, *image, &memory_requirements );
 
 	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 	alloc_info.pNext = NULL;
@@ -7369,16 +7363,44 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 	}
 
 	if ( memory_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ) {
-		invalidate_ptr = qfalse;
+		*invalidate_ptr = qfalse;
 	} else {
 		 // according to specification - must be performed if host_coherent is not set
-		invalidate_ptr = qtrue;
+		*invalidate_ptr = qtrue;
 	}
 
-	VK_CHECK(qvkAllocateMemory(vk.device, &alloc_info, NULL, &memory));
-	VK_CHECK(qvkBindImageMemory(vk.device, dstImage, memory, 0));
+	VK_CHECK( qvkAllocateMemory( vk.device, &alloc_info, NULL, memory ) );
+	VK_CHECK( qvkBindImageMemory( vk.device, *image, *memory, 0 ) );
+}
 
-	command_buffer = begin_command_buffer();
+
+static void vk_record_readback( VkCommandBuffer command_buffer, VkImage dstImage, uint32_t width, uint32_t height )
+{
+	VkMemoryBarrier barrier;
+	VkImage srcImage;
+	VkImageLayout srcImageLayout;
+
+	if ( vk.fboActive ) {
+		if ( vk.capture.image ) {
+			// dedicated capture buffer
+			srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			srcImage = vk.capture.image;
+		} else {
+			srcImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			srcImage = vk.color_image;
+		}
+	} else {
+		srcImageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		srcImage = vk.swapchain_images[ vk.swapchain_image_index ];
+	}
+
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.pNext = NULL;
+
+	// the frame may still be in flight when this is submitted
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	qvkCmdPipelineBarrier( command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL );
 
 	if ( srcImageLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL ) {
 		record_image_layout_transition( command_buffer, srcImage,
@@ -7393,10 +7415,6 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 		VK_IMAGE_LAYOUT_UNDEFINED,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, 0 );
 
-	// end_command_buffer( command_buffer );
-
-	// command_buffer = begin_command_buffer();
-
 	if ( vk.blitEnabled ) {
 		VkImageBlit region;
 
@@ -7435,14 +7453,36 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 		qvkCmdCopyImage( command_buffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
 	}
 
-	end_command_buffer( command_buffer, __func__ );
+	// make the copy visible to the host and keep the next frame from overwriting the source too early
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	qvkCmdPipelineBarrier( command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, NULL, 0, NULL );
+
+	// restore previous layout
+	if ( srcImageLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL ) {
+		record_image_layout_transition( command_buffer, srcImage,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			srcImageLayout, 0, 0 );
+	}
+}
+
+
+static void vk_convert_readback( byte *buffer, VkImage image, VkDeviceMemory memory, qboolean invalidate_ptr, VkFormat format, uint32_t width, uint32_t height )
+{
+	VkImageSubresource subresource;
+	VkSubresourceLayout layout;
+	byte *buffer_ptr;
+	byte *data;
+	uint32_t pixel_width;
+	uint32_t i, n;
 
 	// Copy data from destination image to memory buffer.
 	subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	subresource.mipLevel = 0;
 	subresource.arrayLayer = 0;
 
-	qvkGetImageSubresourceLayout( vk.device, dstImage, &subresource, &layout );
+	qvkGetImageSubresourceLayout( vk.device, image, &subresource, &layout );
 
 	VK_CHECK( qvkMapMemory( vk.device, memory, 0, VK_WHOLE_SIZE, 0, (void**)&data ) );
 
@@ -7459,7 +7499,7 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 
 	data += layout.offset;
 
-	switch ( vk.capture_format ) {
+	switch ( format ) {
 		case VK_FORMAT_B4G4R4A4_UNORM_PACK16: pixel_width = 2; break;
 		case VK_FORMAT_R16G16B16A16_UNORM: pixel_width = 8; break;
 		default: pixel_width = 4; break;
@@ -7499,7 +7539,9 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 		data += layout.rowPitch;
 	}
 
-	if ( is_bgr( vk.capture_format ) ) {
+	qvkUnmapMemory( vk.device, memory );
+
+	if ( is_bgr( format ) ) {
 		buffer_ptr = buffer;
 		for ( i = 0; i < width * height; i++ ) {
 			byte tmp = buffer_ptr[0];
@@ -7508,21 +7550,208 @@ void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
 			buffer_ptr += 3;
 		}
 	}
+}
+
+
+void vk_read_pixels( byte *buffer, uint32_t width, uint32_t height )
+{
+	VkCommandBuffer command_buffer;
+	VkDeviceMemory memory;
+	VkImage dstImage;
+	qboolean invalidate_ptr;
+
+	VK_CHECK( qvkWaitForFences( vk.device, 1, &vk.cmd->rendering_finished_fence, VK_FALSE, 1e12 ) );
+
+	vk_create_readback_image( width, height, &dstImage, &memory, &invalidate_ptr );
+
+	command_buffer = begin_command_buffer();
+
+	vk_record_readback( command_buffer, dstImage, width, height );
+
+	end_command_buffer( command_buffer, __func__ );
+
+	vk_convert_readback( buffer, dstImage, memory, invalidate_ptr, vk.capture_format, width, height );
 
 	qvkDestroyImage( vk.device, dstImage, NULL );
 	qvkFreeMemory( vk.device, memory, NULL );
+}
 
-	// restore previous layout
-	if ( srcImageLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL ) {
-		command_buffer = begin_command_buffer();
 
-		record_image_layout_transition( command_buffer, srcImage,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			srcImageLayout, 0, 0 );
+void vk_destroy_readback( void )
+{
+	vk_readback_frame_t *rf;
+	int i;
+
+	if ( !vk_readback.created ) {
+		return;
+	}
+
+	vk_wait_idle();
+
+	for ( i = 0; i < VK_READBACK_FRAMES; i++ ) {
+		rf = &vk_readback.frames[ i ];
+		qvkFreeCommandBuffers( vk.device, vk.command_pool, 1, &rf->command_buffer );
+		qvkDestroyFence( vk.device, rf->fence, NULL );
+		qvkDestroyImage( vk.device, rf->image, NULL );
+		qvkFreeMemory( vk.device, rf->memory, NULL );
+	}
+
+	qvkDestroySemaphore( vk.device, vk_readback.copied, NULL );
+
+	ri.Free( vk_readback.pixels );
+
+	Com_Memset( &vk_readback, 0, sizeof( vk_readback ) );
+}
+
+
+static void vk_create_readback( uint32_t width, uint32_t height )
+{
+	VkCommandBufferAllocateInfo alloc_info;
+	VkSemaphoreCreateInfo semaphore_desc;
+	VkFenceCreateInfo fence_desc;
+	vk_readback_frame_t *rf;
+	int i;
+
+	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	alloc_info.pNext = NULL;
+	alloc_info.commandPool = vk.command_pool;
+	alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	alloc_info.commandBufferCount = 1;
+
+	fence_desc.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fence_desc.pNext = NULL;
+	fence_desc.flags = 0;
+
+	for ( i = 0; i < VK_READBACK_FRAMES; i++ ) {
+		rf = &vk_readback.frames[ i ];
+		vk_create_readback_image( width, height, &rf->image, &rf->memory, &vk_readback.invalidate_ptr );
+		VK_CHECK( qvkAllocateCommandBuffers( vk.device, &alloc_info, &rf->command_buffer ) );
+		VK_CHECK( qvkCreateFence( vk.device, &fence_desc, NULL, &rf->fence ) );
+		SET_OBJECT_NAME( rf->image, va( "video readback image %i", i ), VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT );
+	}
+
+	semaphore_desc.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_desc.pNext = NULL;
+	semaphore_desc.flags = 0;
+	VK_CHECK( qvkCreateSemaphore( vk.device, &semaphore_desc, NULL, &vk_readback.copied ) );
+
+	vk_readback.pixels = ri.Malloc( width * height * 3 );
+	vk_readback.format = vk.capture_format;
+	vk_readback.width = width;
+	vk_readback.height = height;
+	vk_readback.created = qtrue;
+}
+
+
+/*
+Returns qfalse when the ring can't take a frame of this size without being
+recreated first; pending frames have to be fetched before that.
+*/
+qboolean vk_readback_fits( uint32_t width, uint32_t height )
+{
+	if ( !vk_readback.created ) {
+		return qtrue;
+	}
+
+	return ( vk_readback.width == width && vk_readback.height == height && vk_readback.format == vk.capture_format );
+}
+
+
+int vk_readback_pending( void )
+{
+	return vk_readback.numPending;
+}
+
+
+qboolean vk_readback_ready( void )
+{
+	const vk_readback_frame_t *rf;
+
+	if ( vk_readback.numPending == 0 ) {
+		return qfalse;
+	}
+
+	rf = &vk_readback.frames[ ( vk_readback.head + VK_READBACK_FRAMES - vk_readback.numPending ) % VK_READBACK_FRAMES ];
+
+	return ( qvkGetFenceStatus( vk.device, rf->fence ) == VK_SUCCESS );
+}
+
+
+/*
+Waits for the oldest pending frame and returns it as bottom-up RGB, valid
+until the next call
+*/
+const byte *vk_readback_fetch( uint32_t *width, uint32_t *height )
+{
+	const vk_readback_frame_t *rf;
+
+	rf = &vk_readback.frames[ ( vk_readback.head + VK_READBACK_FRAMES - vk_readback.numPending ) % VK_READBACK_FRAMES ];
+	vk_readback.numPending--;
+
+	VK_CHECK( qvkWaitForFences( vk.device, 1, &rf->fence, VK_TRUE, 1e12 ) );
+	VK_CHECK( qvkResetFences( vk.device, 1, &rf->fence ) );
+
+	vk_convert_readback( vk_readback.pixels, rf->image, rf->memory, vk_readback.invalidate_ptr, vk_readback.format, vk_readback.width, vk_readback.height );
+
+	*width = vk_readback.width;
+	*height = vk_readback.height;
+
+	return vk_readback.pixels;
+}
+
+
+/*
+Queues a copy of the frame just submitted by vk_end_frame(), the ring must
+have a free slot
+*/
+void vk_readback_submit( uint32_t width, uint32_t height )
+{
+	const VkPipelineStageFlags wait_dst_stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	VkCommandBufferBeginInfo begin_info;
+	VkSubmitInfo submit_info;
+	vk_readback_frame_t *rf;
 
-		end_command_buffer( command_buffer, "restore layout" );
+	if ( !vk_readback.created ) {
+		vk_create_readback( width, height );
 	}
+
+	rf = &vk_readback.frames[ vk_readback.head ];
+
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.pNext = NULL;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	begin_info.pInheritanceInfo = NULL;
+
+	VK_CHECK( qvkBeginCommandBuffer( rf->command_buffer, &begin_info ) );
+
+	vk_record_readback( rf->command_buffer, rf->image, width, height );
+
+	VK_CHECK( qvkEndCommandBuffer( rf->command_buffer ) );
+
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext = NULL;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &rf->command_buffer;
+	if ( !ri.CL_IsMinimized() ) {
+		// take over the semaphore presentation would wait on
+		submit_info.waitSemaphoreCount = 1;
+		submit_info.pWaitSemaphores = &vk.cmd->rendering_finished;
+		submit_info.pWaitDstStageMask = &wait_dst_stage_mask;
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &vk_readback.copied;
+		vk_readback.presentWait = qtrue;
+	} else {
+		submit_info.waitSemaphoreCount = 0;
+		submit_info.pWaitSemaphores = NULL;
+		submit_info.pWaitDstStageMask = NULL;
+		submit_info.signalSemaphoreCount = 0;
+		submit_info.pSignalSemaphores = NULL;
+	}
+
+	VK_CHECK( qvkQueueSubmit( vk.queue, 1, &submit_info, rf->fence ) );
+
+	vk_readback.head = ( vk_readback.head + 1 ) % VK_READBACK_FRAMES;
+	vk_readback.numPending++;
 }
 
 
@@ -18,6 +18,8 @@
 
 #define NUM_COMMAND_BUFFERS 2	// number of command buffers / render semaphores / framebuffer sets
 
+#define VK_READBACK_FRAMES 3	// video frames in flight between copy and encoding
+
 #define USE_REVERSED_DEPTH
 //#define USE_BUFFER_CLEAR
 
@@ -278,6 +280,14 @@ void vk_bind_lighting( int stage, int bundle );
 void vk_draw_geometry( Vk_Depth_Range depth_range, qboolean indexed );
 
 void vk_read_pixels( byte* buffer, uint32_t width, uint32_t height ); // screenshots
+
+// asynchronous video frame readback
+qboolean vk_readback_fits( uint32_t width, uint32_t height );
+int vk_readback_pending( void );
+qboolean vk_readback_ready( void );
+const byte *vk_readback_fetch( uint32_t *width, uint32_t *height );
+void vk_readback_submit( uint32_t width, uint32_t height );
+void vk_destroy_readback( void );
 qboolean vk_bloom( void );
 
 qboolean vk_alloc_vbo( const byte *vbo_data, int vbo_size );
@@ -550,6 +560,7 @@ typedef struct {
 	qboolean active;
 	qboolean wideLines;
 	qboolean samplerAnisotropy;
+	qboolean textureCompressionBC;
 	qboolean fragmentStores;
 	qboolean dedicatedAllocation;
 	qboolean debugMarkers;
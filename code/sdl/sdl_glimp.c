@@ -672,6 +672,19 @@ void GLimp_EndFrame( void )
 }
 
 
+/*
+===============
+GLimp_MakeCurrent
+
+Binds the context to the calling thread or releases it
+===============
+*/
+void GLimp_MakeCurrent( qboolean current )
+{
+	SDL_GL_MakeCurrent( SDL_window, current ? SDL_glContext : NULL );
+}
+
+
 /*
 ===============
 GL_GetProcAddress
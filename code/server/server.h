@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "../qcommon/vm_local.h"
 #include "../game/g_public.h"
 #include "../game/bg_public.h"
+#include "sv_telemetry.h"
 
 //=============================================================================
 
@@ -156,6 +157,16 @@ typedef enum {
 	GSA_ACKED		// gamestate acknowledged, no retansmissions needed
 } gameStateAck_t;
 
+// file opened once and shared by all clients downloading it
+typedef struct downloadFile_s {
+	char			name[MAX_QPATH];
+	fileHandle_t	f;
+	int				size;
+	qboolean		stale;				// file got shorter on disk, must be reopened
+	int				refCount;
+	struct downloadFile_s *next;
+} downloadFile_t;
+
 typedef struct client_s {
 	clientState_t	state;
 	char			userinfo[MAX_INFO_STRING];		// name, etc
@@ -180,16 +191,18 @@ typedef struct client_s {
 
 	// downloading
 	char			downloadName[MAX_QPATH]; // if not empty string, we are downloading
-	fileHandle_t	download;			// file being downloaded
+	downloadFile_t	*downloadFile;		// file being downloaded
  	int				downloadSize;		// total bytes (can't use EOF because of paks)
- 	int				downloadCount;		// bytes sent
 	int				downloadClientBlock;	// last block we sent to the client, awaiting ack
-	int				downloadCurrentBlock;	// current block number
 	int				downloadXmitBlock;	// last block we xmited
-	unsigned char	*downloadBlocks[MAX_DOWNLOAD_WINDOW];	// the buffers for the download blocks
-	int				downloadBlockSize[MAX_DOWNLOAD_WINDOW];
-	qboolean		downloadEOF;		// We have sent the EOF block
-	int				downloadSendTime;	// time we last got an ack from the client
+	int				downloadSendTime;	// time we last sent a block or got an ack from the client
+	int				downloadBlockTime[MAX_DOWNLOAD_WINDOW];	// transmit times of blocks in flight
+	int				downloadResendBlock;	// acks of blocks below this may be for retransmits
+	int				downloadWindow;		// number of blocks allowed in flight
+	int				downloadWindowAcks;	// acks counted towards window growth
+	int				downloadThreshold;	// window size where slow start ends
+	int				downloadRTT;		// smoothed block round-trip time
+	int				downloadRTTVar;		// round-trip time variation
 
 	int				deltaMessage;		// frame last client usercmd message
 	int				lastPacketTime;		// svs.time when packet was last received
@@ -311,6 +324,13 @@ extern	cvar_t	*sv_lanForceRate;
 
 extern	cvar_t *sv_levelTimeReset;
 extern	cvar_t *sv_filter;
+extern	cvar_t *sv_preloadNextMap;
+extern	cvar_t *sv_httpPort;
+extern	cvar_t *sv_httpHost;
+extern	cvar_t *sv_httpMaxPerIP;
+extern	cvar_t *sv_telemetry;
+extern	cvar_t *sv_telemetryFile;
+extern	cvar_t *sv_autoRecord;
 
 #ifdef USE_BANS
 extern	cvar_t	*sv_banFile;
@@ -349,6 +369,7 @@ void SV_SetUserinfo( int index, const char *val );
 void SV_GetUserinfo( int index, char *buffer, int bufferSize );
 
 void SV_SpawnServer( const char *mapname, qboolean killBots );
+void SV_PreloadNextMap( void );
 
 
 
@@ -372,6 +393,9 @@ qboolean SV_ExecuteClientCommand( client_t *cl, const char *s );
 void SV_ClientThink( client_t *cl, usercmd_t *cmd );
 
 int SV_SendDownloadMessages( void );
+downloadFile_t *SV_AcquireDownloadFile( const char *name );
+void SV_ReleaseDownloadFile( downloadFile_t *df );
+qboolean SV_ReadDownloadFile( downloadFile_t *df, int offset, void *buffer, int length );
 int SV_SendQueuedMessages( void );
 
 void SV_FreeIP4DB( void );
@@ -491,6 +515,38 @@ int SV_Netchan_TransmitNextFragment( client_t *client );
 qboolean SV_Netchan_Process( client_t *client, msg_t *msg );
 void SV_Netchan_FreeQueue( client_t *client );
 
+//
+// sv_http.c
+//
+void SV_HTTPFrame( void );
+void SV_HTTPShutdown( void );
+
+//
+// sv_telemetry.c
+//
+extern qboolean sv_telemetryActive;		// a reader is attached
+
+void SV_TelemetryFrame( void );
+void SV_TelemetryShutdown( void );
+void SV_Telemetry( telemetryType_t type, int client, int d0, int d1, int d2, int d3, int d4, int d5 );
+int SV_TelemetryAddress( const netadr_t *adr );
+
+//
+// sv_demo.c
+//
+extern qboolean sv_demoRecording;
+
+void SV_DemoClientSnapshot( const client_t *client, const clientSnapshot_t *frame );
+void SV_DemoFrame( void );
+void SV_DemoCommand( const client_t *cl, const char *cmd );
+void SV_DemoConfigstring( int index, const char *val );
+void SV_DemoStop( void );
+void SV_DemoAutoRecord( void );
+void SV_Record_f( void );
+void SV_StopRecord_f( void );
+void SV_ExtractDemo_f( void );
+void SV_CompleteDemoName( const char *args, int argNum );
+
 //
 // sv_filter.c
 //
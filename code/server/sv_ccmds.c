@@ -322,6 +322,10 @@ static void SV_MapRestart_f( void ) {
 	sv.state = SS_GAME;
 	sv.restarting = qfalse;
 
+	if ( sv_demoRecording ) {
+		SV_DemoCommand( NULL, "map_restart\n" );
+	}
+
 	// connect and begin all the clients
 	for ( i = 0; i < sv.maxclients; i++ ) {
 		client = &svs.clients[i];
@@ -1582,6 +1586,11 @@ void SV_AddOperatorCommands( void ) {
 #endif
 	Cmd_AddCommand( "filter", SV_AddFilter_f );
 	Cmd_AddCommand( "filtercmd", SV_AddFilterCmd_f );
+
+	Cmd_AddCommand( "svrecord", SV_Record_f );
+	Cmd_AddCommand( "svstoprecord", SV_StopRecord_f );
+	Cmd_AddCommand( "svextract", SV_ExtractDemo_f );
+	Cmd_SetCommandCompletionFunc( "svextract", SV_CompleteDemoName );
 }
 
 
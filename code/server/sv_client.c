@@ -1183,6 +1183,221 @@ CLIENT COMMAND EXECUTION
 ============================================================
 */
 
+/*
+=================================================================================
+
+Download files are opened once and shared by all clients downloading them,
+every block is read into the sender's buffer right before it goes out. A file
+overwritten on disk can only give a short read that way.
+
+=================================================================================
+*/
+
+#define MIN_DOWNLOAD_WINDOW		2
+#define INIT_DOWNLOAD_WINDOW	16
+#define MIN_DOWNLOAD_TIMEOUT	200
+#define MAX_DOWNLOAD_TIMEOUT	1000
+
+static downloadFile_t *downloadFiles;
+
+
+/*
+==================
+SV_AcquireDownloadFile
+==================
+*/
+downloadFile_t *SV_AcquireDownloadFile( const char *name ) {
+	downloadFile_t *df;
+	fileHandle_t f;
+	int size;
+
+	for ( df = downloadFiles; df; df = df->next ) {
+		if ( !FS_FilenameCompare( df->name, name ) ) {
+			df->refCount++;
+			return df;
+		}
+	}
+
+	size = FS_SV_FOpenFileRead( name, &f );
+	if ( f == FS_INVALID_HANDLE ) {
+		return NULL;
+	}
+
+	df = Z_Malloc( sizeof( *df ) );
+	Q_strncpyz( df->name, name, sizeof( df->name ) );
+	df->f = f;
+	df->size = size;
+	df->refCount = 1;
+
+	df->next = downloadFiles;
+	downloadFiles = df;
+
+	return df;
+}
+
+
+/*
+==================
+SV_ReadDownloadFile
+
+Reads a range of the file, fails if the file got shorter on disk
+==================
+*/
+qboolean SV_ReadDownloadFile( downloadFile_t *df, int offset, void *buffer, int length ) {
+	downloadFile_t **prev;
+
+	if ( df->stale ) {
+		return qfalse;
+	}
+
+	if ( FS_Seek( df->f, offset, FS_SEEK_SET ) == 0 && FS_Read( buffer, length, df->f ) == length ) {
+		return qtrue;
+	}
+
+	Com_Printf( S_COLOR_YELLOW "WARNING: download file %s changed on disk\n", df->name );
+
+	// remove from cache so new requests will open the current file
+	for ( prev = &downloadFiles; *prev; prev = &(*prev)->next ) {
+		if ( *prev == df ) {
+			*prev = df->next;
+			break;
+		}
+	}
+
+	df->stale = qtrue;
+
+	return qfalse;
+}
+
+
+/*
+==================
+SV_ReleaseDownloadFile
+==================
+*/
+void SV_ReleaseDownloadFile( downloadFile_t *df ) {
+	downloadFile_t **prev;
+
+	if ( --df->refCount > 0 ) {
+		return;
+	}
+
+	for ( prev = &downloadFiles; *prev; prev = &(*prev)->next ) {
+		if ( *prev == df ) {
+			*prev = df->next;
+			break;
+		}
+	}
+
+	FS_FCloseFile( df->f );
+
+	Z_Free( df );
+}
+
+
+/*
+==================
+SV_DownloadBlockSize
+
+Zero-length block after the file data indicates EOF
+==================
+*/
+static int SV_DownloadBlockSize( const client_t *cl, int block ) {
+	int offset = block * MAX_DOWNLOAD_BLKSIZE;
+
+	if ( offset >= cl->downloadSize ) {
+		return 0;
+	}
+
+	return MIN( cl->downloadSize - offset, MAX_DOWNLOAD_BLKSIZE );
+}
+
+
+/*
+==================
+SV_DownloadTimeout
+
+Retransmission timeout based on measured block round-trip time
+==================
+*/
+static int SV_DownloadTimeout( const client_t *cl ) {
+	int timeout;
+
+	if ( !cl->downloadRTT ) {
+		return MAX_DOWNLOAD_TIMEOUT;
+	}
+
+	timeout = cl->downloadRTT + 4 * cl->downloadRTTVar;
+
+	if ( timeout < MIN_DOWNLOAD_TIMEOUT ) {
+		return MIN_DOWNLOAD_TIMEOUT;
+	}
+	if ( timeout > MAX_DOWNLOAD_TIMEOUT ) {
+		return MAX_DOWNLOAD_TIMEOUT;
+	}
+
+	return timeout;
+}
+
+
+/*
+==================
+SV_DownloadAck
+
+Updates round-trip time estimation and grows the window,
+slow start up to threshold then by one block per window
+==================
+*/
+static void SV_DownloadAck( client_t *cl, int block, int now ) {
+	int sample, delta;
+
+	// ignore acks which may belong to retransmitted blocks
+	if ( block >= cl->downloadResendBlock ) {
+		sample = now - cl->downloadBlockTime[ block % MAX_DOWNLOAD_WINDOW ];
+		if ( sample < 0 ) {
+			sample = 0;
+		}
+		if ( !cl->downloadRTT ) {
+			cl->downloadRTT = sample;
+			cl->downloadRTTVar = sample / 2;
+		} else {
+			delta = abs( cl->downloadRTT - sample );
+			cl->downloadRTTVar = ( 3 * cl->downloadRTTVar + delta ) / 4;
+			cl->downloadRTT = ( 7 * cl->downloadRTT + sample ) / 8;
+		}
+	}
+
+	if ( cl->downloadWindow < cl->downloadThreshold ) {
+		cl->downloadWindow++;
+	} else if ( ++cl->downloadWindowAcks >= cl->downloadWindow ) {
+		cl->downloadWindowAcks = 0;
+		cl->downloadWindow++;
+	}
+
+	if ( cl->downloadWindow > MAX_DOWNLOAD_WINDOW ) {
+		cl->downloadWindow = MAX_DOWNLOAD_WINDOW;
+	}
+}
+
+
+/*
+==================
+SV_DownloadLoss
+
+Halves the window after retransmission timeout
+==================
+*/
+static void SV_DownloadLoss( client_t *cl ) {
+	cl->downloadThreshold = MAX( cl->downloadWindow / 2, MIN_DOWNLOAD_WINDOW );
+	cl->downloadWindow = cl->downloadThreshold;
+	cl->downloadWindowAcks = 0;
+	cl->downloadResendBlock = cl->downloadXmitBlock;
+
+	Com_DPrintf( "clientDownload: %d : timeout at block %d, window %d, rtt %d\n", (int) (cl - svs.clients),
+		cl->downloadClientBlock, cl->downloadWindow, cl->downloadRTT );
+}
+
+
 /*
 ==================
 SV_CloseDownload
@@ -1191,24 +1406,14 @@ clear/free any download vars
 ==================
 */
 static void SV_CloseDownload( client_t *cl ) {
-	int i;
 
 	// EOF
-	if ( cl->download != FS_INVALID_HANDLE ) {
-		FS_FCloseFile( cl->download );
-		cl->download = FS_INVALID_HANDLE;
+	if ( cl->downloadFile ) {
+		SV_ReleaseDownloadFile( cl->downloadFile );
+		cl->downloadFile = NULL;
 	}
 
 	*cl->downloadName = '\0';
-
-	// Free the temporary buffer space
-	for (i = 0; i < MAX_DOWNLOAD_WINDOW; i++) {
-		if (cl->downloadBlocks[i]) {
-			Z_Free( cl->downloadBlocks[i] );
-			cl->downloadBlocks[i] = NULL;
-		}
-	}
-
 }
 
 
@@ -1261,13 +1466,14 @@ static void SV_NextDownload_f( client_t *cl )
 		Com_DPrintf( "clientDownload: %d : client acknowledge of block %d\n", (int) (cl - svs.clients), block );
 
 		// Find out if we are done.  A zero-length block indicates EOF
-		if (cl->downloadBlockSize[cl->downloadClientBlock % MAX_DOWNLOAD_WINDOW] == 0) {
+		if ( SV_DownloadBlockSize( cl, cl->downloadClientBlock ) == 0 ) {
 			Com_Printf( "clientDownload: %d : file \"%s\" completed\n", (int) (cl - svs.clients), cl->downloadName );
 			SV_CloseDownload( cl );
 			return;
 		}
 
-		cl->downloadSendTime = svs.time;
+		cl->downloadSendTime = Sys_Milliseconds();
+		SV_DownloadAck( cl, block, cl->downloadSendTime );
 		cl->downloadClientBlock++;
 		return;
 	}
@@ -1321,10 +1527,12 @@ static int SV_WriteDownloadToClient( client_t *cl )
 	char errorMessage[1024];
 	char pakbuf[MAX_QPATH], *pakptr;
 	int numRefPaks;
+	int numBlocks, blockSize, now;
 	msg_t msg;
 	byte msgBuffer[MAX_DOWNLOAD_BLKSIZE*2+8];
+	byte block[MAX_DOWNLOAD_BLKSIZE];
 
-	if ( cl->download == FS_INVALID_HANDLE ) {
+	if ( cl->downloadFile == NULL ) {
 		qboolean idPack = qfalse;
 		qboolean missionPack = qfalse;
  		// Chop off filename extension.
@@ -1360,13 +1568,11 @@ static int SV_WriteDownloadToClient( client_t *cl )
 			}
 		}
 
-		cl->download = FS_INVALID_HANDLE;
-
 		// We open the file here
 		if ( !(sv_allowDownload->integer & DLF_ENABLE) ||
 			(sv_allowDownload->integer & DLF_NO_UDP) ||
 			idPack || unreferenced ||
-			( cl->downloadSize = FS_SV_FOpenFileRead( cl->downloadName, &cl->download ) ) < 0 ) {
+			( cl->downloadFile = SV_AcquireDownloadFile( cl->downloadName ) ) == NULL ) {
 
 			// cannot auto-download file
 			if(unreferenced)
@@ -1418,71 +1624,45 @@ static int SV_WriteDownloadToClient( client_t *cl )
 
 			*cl->downloadName = '\0';
 
-			if ( cl->download != FS_INVALID_HANDLE ) {
-				FS_FCloseFile( cl->download );
-				cl->download = FS_INVALID_HANDLE;
-			}
-
 			return 1;
 		}
 
 		Com_Printf( "clientDownload: %d : beginning \"%s\"\n", (int) (cl - svs.clients), cl->downloadName );
 
-		cl->downloadCurrentBlock = cl->downloadClientBlock = cl->downloadXmitBlock = 0;
-		cl->downloadCount = 0;
-		cl->downloadEOF = qfalse;
-	}
-
-	// Perform any reads that we need to
-	while (cl->downloadCurrentBlock - cl->downloadClientBlock < MAX_DOWNLOAD_WINDOW &&
-		cl->downloadSize != cl->downloadCount) {
-
-		curindex = (cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW);
-
-		if (!cl->downloadBlocks[curindex])
-			cl->downloadBlocks[curindex] = Z_Malloc( MAX_DOWNLOAD_BLKSIZE );
-
-		cl->downloadBlockSize[curindex] = FS_Read( cl->downloadBlocks[curindex], MAX_DOWNLOAD_BLKSIZE, cl->download );
-
-		if (cl->downloadBlockSize[curindex] < 0) {
-			// EOF right now
-			cl->downloadCount = cl->downloadSize;
-			break;
-		}
-
-		cl->downloadCount += cl->downloadBlockSize[curindex];
-
-		// Load in next block
-		cl->downloadCurrentBlock++;
+		cl->downloadSize = cl->downloadFile->size;
+		cl->downloadClientBlock = cl->downloadXmitBlock = 0;
+		cl->downloadResendBlock = 0;
+		cl->downloadWindow = INIT_DOWNLOAD_WINDOW;
+		cl->downloadWindowAcks = 0;
+		cl->downloadThreshold = MAX_DOWNLOAD_WINDOW;
+		cl->downloadRTT = cl->downloadRTTVar = 0;
 	}
 
-	// Check to see if we have eof condition and add the EOF block
-	if (cl->downloadCount == cl->downloadSize &&
-		!cl->downloadEOF &&
-		cl->downloadCurrentBlock - cl->downloadClientBlock < MAX_DOWNLOAD_WINDOW) {
+	// file data blocks followed by zero-length EOF block
+	numBlocks = ( cl->downloadSize + MAX_DOWNLOAD_BLKSIZE - 1 ) / MAX_DOWNLOAD_BLKSIZE + 1;
 
-		cl->downloadBlockSize[cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW] = 0;
-		cl->downloadCurrentBlock++;
-
-		cl->downloadEOF = qtrue;  // We have added the EOF block
-	}
-
-	if (cl->downloadClientBlock == cl->downloadCurrentBlock)
-		return 0; // Nothing to transmit
+	now = Sys_Milliseconds();
 
 	// Write out the next section of the file, if we have already reached our window,
 	// automatically start retransmitting
-	if (cl->downloadXmitBlock == cl->downloadCurrentBlock)
+	if ( cl->downloadXmitBlock >= MIN( cl->downloadClientBlock + cl->downloadWindow, numBlocks ) )
 	{
 		// We have transmitted the complete window, should we start resending?
-		if (svs.time - cl->downloadSendTime > 1000)
+		if ( now - cl->downloadSendTime > SV_DownloadTimeout( cl ) ) {
+			SV_DownloadLoss( cl );
 			cl->downloadXmitBlock = cl->downloadClientBlock;
-		else
+		} else {
 			return 0;
+		}
 	}
 
 	// Send current block
-	curindex = (cl->downloadXmitBlock % MAX_DOWNLOAD_WINDOW);
+	blockSize = SV_DownloadBlockSize( cl, cl->downloadXmitBlock );
+
+	if ( blockSize > 0 && !SV_ReadDownloadFile( cl->downloadFile, cl->downloadXmitBlock * MAX_DOWNLOAD_BLKSIZE, block, blockSize ) ) {
+		SV_DropClient( cl, "download file changed on server" );
+		return 0;
+	}
 
 	MSG_Init( &msg, msgBuffer, sizeof( msgBuffer ) - 8 );
 	MSG_WriteLong( &msg, cl->lastClientCommand );
@@ -1494,11 +1674,11 @@ static int SV_WriteDownloadToClient( client_t *cl )
 	if ( cl->downloadXmitBlock == 0 )
 		MSG_WriteLong( &msg, cl->downloadSize );
 
-	MSG_WriteShort( &msg, cl->downloadBlockSize[curindex] );
+	MSG_WriteShort( &msg, blockSize );
 
 	// Write the block
-	if ( cl->downloadBlockSize[curindex] > 0 )
-		MSG_WriteData( &msg, cl->downloadBlocks[curindex], cl->downloadBlockSize[curindex] );
+	if ( blockSize > 0 )
+		MSG_WriteData( &msg, block, blockSize );
 
 	MSG_WriteByte( &msg, svc_EOF );
 	SV_Netchan_Transmit( cl, &msg );
@@ -1507,8 +1687,9 @@ static int SV_WriteDownloadToClient( client_t *cl )
 
 	// Move on to the next block
 	// It will get sent with next snap shot.  The rate will keep us in line.
+	cl->downloadBlockTime[ cl->downloadXmitBlock % MAX_DOWNLOAD_WINDOW ] = now;
 	cl->downloadXmitBlock++;
-	cl->downloadSendTime = svs.time;
+	cl->downloadSendTime = now;
 
 	return 1;
 }
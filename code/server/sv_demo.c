@@ -0,0 +1,1090 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_demo.c -- server side multi-view demo recording and per-client extraction
+
+#include "server.h"
+
+/*
+=============================================================================
+
+A multi-view demo holds everything needed to rebuild the snapshots that
+every active client received.  It is a sequence of little endian length
+prefixed huffman encoded messages, a length of -1 ends the file:
+
+mvd_gamestate		version, checksum feed, maxclients, configstrings, baselines
+mvd_configstring	index, string
+mvd_command			target client or MVD_BROADCAST, string
+mvd_frame			server time, server count bit, delta of all entities that
+					can be sent to clients, then an mvd_client block for each
+					client that got a snapshot during the frame: flags, areabits,
+					playerstate delta and toggles of its visible entity set
+
+Every frame is delta compressed against the previous recorded one, so the
+cost per server frame is bounded by the number of entities and clients.
+
+=============================================================================
+*/
+
+#define MVD_VERSION			1
+#define MVD_EXT				"mvd"
+#define MVD_MSGLEN			0x40000
+#define MVD_MSGLEN_BUF		(MVD_MSGLEN+8)
+#define MVD_BROADCAST		255
+
+// mvd_client flags
+#define MVD_DELTA			1	// playerstate and visible entities are relative to the previous block
+#define MVD_RATE_DELAYED	2
+
+typedef enum {
+	mvd_bad,
+	mvd_gamestate,
+	mvd_configstring,
+	mvd_command,
+	mvd_frame,
+	mvd_client,
+	mvd_EOF
+} mvdOps_t;
+
+typedef struct {
+	const clientSnapshot_t *snap;	// built during the current server frame
+	int				snapFlags;
+	qboolean		valid;			// ps and ents hold the last recorded snapshot
+	playerState_t	ps;
+	int				numEnts;
+	int				ents[ MAX_SNAPSHOT_ENTITIES ];
+} mvdClient_t;
+
+typedef struct {
+	fileHandle_t	file;
+	char			name[ MAX_OSPATH ];
+	int				frames;
+	int				numEnts;
+	entityState_t	ents[ MAX_GENTITIES ];	// entities of the last recorded frame
+	mvdClient_t		clients[ MAX_CLIENTS ];
+	byte			buf[ MVD_MSGLEN_BUF ];
+} svDemo_t;
+
+static svDemo_t *demo;
+
+qboolean sv_demoRecording;
+
+
+/*
+==================
+SV_DemoWriteMessage
+==================
+*/
+static void SV_DemoWriteMessage( msg_t *msg ) {
+	int len;
+
+	if ( msg->overflowed ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: server demo message overflowed, recording stopped\n" );
+		SV_DemoStop();
+		return;
+	}
+
+	len = LittleLong( msg->cursize );
+	FS_Write( &len, 4, demo->file );
+	FS_Write( msg->data, msg->cursize, demo->file );
+}
+
+
+/*
+==================
+SV_DemoInitMessage
+==================
+*/
+static void SV_DemoInitMessage( msg_t *msg, mvdOps_t op ) {
+	MSG_Init( msg, demo->buf, MVD_MSGLEN );
+	MSG_Bitstream( msg );
+	msg->allowoverflow = qtrue;
+	MSG_WriteByte( msg, op );
+}
+
+
+/*
+==================
+SV_DemoWriteGamestate
+==================
+*/
+static void SV_DemoWriteGamestate( void ) {
+	const entityState_t *base;
+	entityState_t nullstate;
+	msg_t	msg;
+	int		i;
+
+	SV_DemoInitMessage( &msg, mvd_gamestate );
+
+	MSG_WriteLong( &msg, MVD_VERSION );
+	MSG_WriteLong( &msg, sv.checksumFeed );
+	MSG_WriteByte( &msg, sv.maxclients );
+
+	// configstrings
+	for ( i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		if ( !sv.configstrings[i][0] ) {
+			continue;
+		}
+		MSG_WriteShort( &msg, i );
+		MSG_WriteBigString( &msg, sv.configstrings[i] );
+	}
+	MSG_WriteShort( &msg, MAX_CONFIGSTRINGS );
+
+	// baselines
+	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+	for ( i = 0; i < MAX_GENTITIES; i++ ) {
+		base = &sv.svEntities[i].baseline;
+		if ( !base->number ) {
+			continue;
+		}
+		MSG_WriteDeltaEntity( &msg, &nullstate, base, qtrue );
+	}
+	MSG_WriteBits( &msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );
+
+	MSG_WriteByte( &msg, mvd_EOF );
+
+	SV_DemoWriteMessage( &msg );
+}
+
+
+/*
+==================
+SV_DemoEmitEntities
+
+Delta of the common snapshot against the previous recorded frame
+==================
+*/
+static void SV_DemoEmitEntities( msg_t *msg, const snapshotFrame_t *sf ) {
+	const entityState_t	*oldent, *newent;
+	int		oldindex, newindex;
+	int		oldnum, newnum;
+	int		i;
+
+	newent = NULL;
+	oldent = NULL;
+	newindex = 0;
+	oldindex = 0;
+	while ( newindex < sf->count || oldindex < demo->numEnts ) {
+		if ( newindex >= sf->count ) {
+			newnum = MAX_GENTITIES+1;
+		} else {
+			newent = sf->ents[ newindex ];
+			newnum = newent->number;
+		}
+
+		if ( oldindex >= demo->numEnts ) {
+			oldnum = MAX_GENTITIES+1;
+		} else {
+			oldent = &demo->ents[ oldindex ];
+			oldnum = oldent->number;
+		}
+
+		if ( newnum == oldnum ) {
+			MSG_WriteDeltaEntity( msg, oldent, newent, qfalse );
+			oldindex++;
+			newindex++;
+		} else if ( newnum < oldnum ) {
+			MSG_WriteDeltaEntity( msg, &sv.svEntities[newnum].baseline, newent, qtrue );
+			newindex++;
+		} else {
+			MSG_WriteDeltaEntity( msg, oldent, NULL, qtrue );
+			oldindex++;
+		}
+	}
+
+	MSG_WriteBits( msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );
+
+	// keep a copy for the next delta, storage of the common snapshot is recycled
+	for ( i = 0; i < sf->count; i++ ) {
+		demo->ents[i] = *sf->ents[i];
+	}
+	demo->numEnts = sf->count;
+}
+
+
+/*
+==================
+SV_DemoEmitClient
+==================
+*/
+static void SV_DemoEmitClient( msg_t *msg, int clientNum, mvdClient_t *mc ) {
+	const clientSnapshot_t *snap = mc->snap;
+	int		oldindex, newindex;
+	int		oldnum, newnum;
+	int		flags;
+	int		i;
+
+	flags = 0;
+	if ( mc->valid ) {
+		flags |= MVD_DELTA;
+	} else {
+		mc->numEnts = 0;
+	}
+	if ( mc->snapFlags & SNAPFLAG_RATE_DELAYED ) {
+		flags |= MVD_RATE_DELAYED;
+	}
+
+	MSG_WriteByte( msg, mvd_client );
+	MSG_WriteByte( msg, clientNum );
+	MSG_WriteByte( msg, flags );
+	MSG_WriteByte( msg, snap->areabytes );
+	MSG_WriteData( msg, snap->areabits, snap->areabytes );
+
+	MSG_WriteDeltaPlayerstate( msg, mc->valid ? &mc->ps : NULL, &snap->ps );
+
+	// entities that entered or left the view, both lists are sorted
+	oldindex = 0;
+	newindex = 0;
+	while ( newindex < snap->num_entities || oldindex < mc->numEnts ) {
+		newnum = ( newindex < snap->num_entities ) ? snap->ents[ newindex ]->number : MAX_GENTITIES+1;
+		oldnum = ( oldindex < mc->numEnts ) ? mc->ents[ oldindex ] : MAX_GENTITIES+1;
+		if ( newnum == oldnum ) {
+			oldindex++;
+			newindex++;
+		} else if ( newnum < oldnum ) {
+			MSG_WriteBits( msg, newnum, GENTITYNUM_BITS );
+			newindex++;
+		} else {
+			MSG_WriteBits( msg, oldnum, GENTITYNUM_BITS );
+			oldindex++;
+		}
+	}
+	MSG_WriteBits( msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );
+
+	mc->ps = snap->ps;
+	for ( i = 0; i < snap->num_entities; i++ ) {
+		mc->ents[i] = snap->ents[i]->number;
+	}
+	mc->numEnts = snap->num_entities;
+	mc->valid = qtrue;
+}
+
+
+/*
+==================
+SV_DemoClientSnapshot
+
+Called for every client snapshot built with entities
+==================
+*/
+void SV_DemoClientSnapshot( const client_t *client, const clientSnapshot_t *frame ) {
+	mvdClient_t *mc;
+
+	if ( client->state != CS_ACTIVE ) {
+		return;
+	}
+
+	mc = &demo->clients[ client - svs.clients ];
+	mc->snap = frame;
+	mc->snapFlags = client->rateDelayed ? SNAPFLAG_RATE_DELAYED : 0;
+}
+
+
+/*
+==================
+SV_DemoFrame
+
+Called after snapshots have been sent to the clients
+==================
+*/
+void SV_DemoFrame( void ) {
+	mvdClient_t *mc;
+	msg_t	msg;
+	int		i;
+
+	// nothing has been sent
+	if ( !svs.currFrame ) {
+		return;
+	}
+
+	SV_DemoInitMessage( &msg, mvd_frame );
+
+	MSG_WriteLong( &msg, sv.time );
+	MSG_WriteByte( &msg, svs.snapFlagServerBit );
+
+	SV_DemoEmitEntities( &msg, svs.currFrame );
+
+	for ( i = 0, mc = demo->clients; i < sv.maxclients; i++, mc++ ) {
+		if ( svs.clients[i].state != CS_ACTIVE ) {
+			// start from scratch on next connection
+			mc->valid = qfalse;
+		} else if ( mc->snap ) {
+			SV_DemoEmitClient( &msg, i, mc );
+		}
+		mc->snap = NULL;
+	}
+
+	MSG_WriteByte( &msg, mvd_EOF );
+
+	SV_DemoWriteMessage( &msg );
+
+	if ( sv_demoRecording ) {
+		demo->frames++;
+	}
+}
+
+
+/*
+==================
+SV_DemoCommand
+
+Records a reliable command, a NULL client is a broadcast
+==================
+*/
+void SV_DemoCommand( const client_t *cl, const char *cmd ) {
+	msg_t	msg;
+
+	SV_DemoInitMessage( &msg, mvd_command );
+	MSG_WriteByte( &msg, cl ? cl - svs.clients : MVD_BROADCAST );
+	MSG_WriteBigString( &msg, cmd );
+	MSG_WriteByte( &msg, mvd_EOF );
+
+	SV_DemoWriteMessage( &msg );
+}
+
+
+/*
+==================
+SV_DemoConfigstring
+==================
+*/
+void SV_DemoConfigstring( int index, const char *val ) {
+	msg_t	msg;
+
+	SV_DemoInitMessage( &msg, mvd_configstring );
+	MSG_WriteShort( &msg, index );
+	MSG_WriteBigString( &msg, val );
+	MSG_WriteByte( &msg, mvd_EOF );
+
+	SV_DemoWriteMessage( &msg );
+}
+
+
+/*
+==================
+SV_DemoStart
+==================
+*/
+static void SV_DemoStart( const char *name, qboolean explicitName ) {
+	char	fileName[ MAX_OSPATH ];
+	int		sequence;
+
+	Com_sprintf( fileName, sizeof( fileName ), "demos/%s.%s", name, MVD_EXT );
+
+	if ( !explicitName ) {
+		// add sequence suffix to avoid overwrite
+		sequence = 0;
+		while ( FS_FileExists( fileName ) && ++sequence < 1000 ) {
+			Com_sprintf( fileName, sizeof( fileName ), "demos/%s-%02d.%s", name, sequence, MVD_EXT );
+		}
+	}
+
+	demo = Z_Malloc( sizeof( *demo ) );
+
+	demo->file = FS_FOpenFileWrite( fileName );
+	if ( demo->file == FS_INVALID_HANDLE ) {
+		Com_Printf( "ERROR: couldn't open %s.\n", fileName );
+		Z_Free( demo );
+		demo = NULL;
+		return;
+	}
+
+	// frames are encoded here and written out by the background writer
+	FS_SetAsync( demo->file );
+
+	Q_strncpyz( demo->name, fileName, sizeof( demo->name ) );
+	sv_demoRecording = qtrue;
+
+	SV_DemoWriteGamestate();
+
+	if ( demo ) {
+		Com_Printf( "Recording server demo to %s.\n", fileName );
+	}
+}
+
+
+/*
+==================
+SV_DemoStop
+==================
+*/
+void SV_DemoStop( void ) {
+	int len;
+
+	if ( !demo ) {
+		return;
+	}
+
+	len = -1;
+	FS_Write( &len, 4, demo->file );
+	FS_FCloseFile( demo->file );
+
+	Com_Printf( "Stopped server demo %s, %i frames.\n", demo->name, demo->frames );
+
+	Z_Free( demo );
+	demo = NULL;
+	sv_demoRecording = qfalse;
+}
+
+
+/*
+==================
+SV_DemoAutoRecord
+
+Called when a new map has been spawned
+==================
+*/
+void SV_DemoAutoRecord( void ) {
+	char	name[ MAX_QPATH ];
+	qtime_t	t;
+
+	if ( !sv_autoRecord->integer || demo ) {
+		return;
+	}
+
+	Com_RealTime( &t );
+	Com_sprintf( name, sizeof( name ), "server/%04d%02d%02d-%02d%02d%02d-%s",
+		1900 + t.tm_year, 1 + t.tm_mon, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, sv_mapname->string );
+
+	SV_DemoStart( name, qfalse );
+}
+
+
+/*
+==================
+SV_Record_f
+
+svrecord [demoname]
+==================
+*/
+void SV_Record_f( void ) {
+	char	name[ MAX_QPATH ];
+	qtime_t	t;
+
+	if ( Cmd_Argc() > 2 ) {
+		Com_Printf( "usage: svrecord [demoname]\n" );
+		return;
+	}
+
+	if ( sv.state != SS_GAME ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	if ( demo ) {
+		Com_Printf( "Already recording %s.\n", demo->name );
+		return;
+	}
+
+	if ( Cmd_Argc() == 2 ) {
+		Q_strncpyz( name, Cmd_Argv( 1 ), sizeof( name ) );
+		if ( !Q_stricmp( COM_GetExtension( name ), MVD_EXT ) ) {
+			COM_StripExtension( name, name, sizeof( name ) );
+		}
+		SV_DemoStart( name, qtrue );
+	} else {
+		Com_RealTime( &t );
+		Com_sprintf( name, sizeof( name ), "server/%04d%02d%02d-%02d%02d%02d-%s",
+			1900 + t.tm_year, 1 + t.tm_mon, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, sv_mapname->string );
+		SV_DemoStart( name, qfalse );
+	}
+}
+
+
+/*
+==================
+SV_StopRecord_f
+==================
+*/
+void SV_StopRecord_f( void ) {
+	if ( !demo ) {
+		Com_Printf( "Not recording a server demo.\n" );
+		return;
+	}
+
+	SV_DemoStop();
+}
+
+
+/*
+=============================================================================
+
+EXTRACTION
+
+Replays a multi-view demo and writes the messages one client received
+as a regular client demo
+
+=============================================================================
+*/
+
+typedef struct {
+	fileHandle_t	in;
+	fileHandle_t	out;
+	char			outName[ MAX_OSPATH ];
+	int				target;
+	int				checksumFeed;
+
+	char			*configstrings[ MAX_CONFIGSTRINGS ];
+	entityState_t	baselines[ MAX_GENTITIES ];
+	entityState_t	ents[ MAX_GENTITIES ];
+	byte			present[ MAX_GENTITIES ];
+
+	int				serverTime;
+	int				serverBit;
+
+	playerState_t	ps[ MAX_CLIENTS ];
+	byte			visible[ MAX_CLIENTS ][ MAX_GENTITIES / 8 ];
+
+	// output state
+	int				messageNum;
+	int				commandSequence;
+	int				numPending;
+	char			pending[ MAX_RELIABLE_COMMANDS ][ MAX_STRING_CHARS ];
+	int				snapshots;
+	qboolean		deltaValid;
+	playerState_t	lastPs;
+	int				lastNumEnts;
+	entityState_t	lastEnts[ MAX_SNAPSHOT_ENTITIES ];
+
+	byte			inBuf[ MVD_MSGLEN_BUF ];
+	byte			outBuf[ MAX_MSGLEN_BUF ];
+} mvdExtract_t;
+
+
+/*
+==================
+SV_ExtractWriteMessage
+==================
+*/
+static qboolean SV_ExtractWriteMessage( mvdExtract_t *ex, msg_t *msg ) {
+	int len;
+
+	if ( msg->overflowed ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: extracted message overflowed\n" );
+		return qfalse;
+	}
+
+	len = LittleLong( ex->messageNum );
+	FS_Write( &len, 4, ex->out );
+	len = LittleLong( msg->cursize );
+	FS_Write( &len, 4, ex->out );
+	FS_Write( msg->data, msg->cursize, ex->out );
+
+	ex->messageNum++;
+
+	return qtrue;
+}
+
+
+/*
+==================
+SV_ExtractQueueCommand
+==================
+*/
+static void SV_ExtractQueueCommand( mvdExtract_t *ex, const char *cmd ) {
+	if ( ex->out == FS_INVALID_HANDLE ) {
+		// will be part of the gamestate
+		return;
+	}
+
+	if ( ex->numPending >= MAX_RELIABLE_COMMANDS ) {
+		Com_DPrintf( "SV_ExtractQueueCommand: dropped %s\n", cmd );
+		return;
+	}
+
+	Q_strncpyz( ex->pending[ ex->numPending++ ], cmd, MAX_STRING_CHARS );
+}
+
+
+/*
+==================
+SV_ExtractConfigstring
+
+Same splitting as SV_SendConfigstring
+==================
+*/
+static void SV_ExtractConfigstring( mvdExtract_t *ex, int index, const char *val ) {
+	int maxChunkSize = MAX_STRING_CHARS - 24;
+	char buf[ MAX_STRING_CHARS ];
+	const char *cmd;
+	int sent, remaining;
+
+	if ( ex->configstrings[ index ] ) {
+		Z_Free( ex->configstrings[ index ] );
+	}
+	ex->configstrings[ index ] = CopyString( val );
+
+	remaining = strlen( val );
+	if ( remaining < maxChunkSize ) {
+		SV_ExtractQueueCommand( ex, va( "cs %i \"%s\"", index, val ) );
+		return;
+	}
+
+	sent = 0;
+	while ( remaining > 0 ) {
+		if ( sent == 0 ) {
+			cmd = "bcs0";
+		} else if ( remaining < maxChunkSize ) {
+			cmd = "bcs2";
+		} else {
+			cmd = "bcs1";
+		}
+		Q_strncpyz( buf, val + sent, maxChunkSize );
+		SV_ExtractQueueCommand( ex, va( "%s %i \"%s\"", cmd, index, buf ) );
+		sent += (maxChunkSize - 1);
+		remaining -= (maxChunkSize - 1);
+	}
+}
+
+
+/*
+==================
+SV_ExtractGamestate
+==================
+*/
+static qboolean SV_ExtractGamestate( mvdExtract_t *ex ) {
+	entityState_t nullstate;
+	msg_t	msg;
+	int		i;
+
+	if ( ex->out == FS_INVALID_HANDLE ) {
+		ex->out = FS_FOpenFileWrite( ex->outName );
+		if ( ex->out == FS_INVALID_HANDLE ) {
+			Com_Printf( "ERROR: couldn't open %s.\n", ex->outName );
+			return qfalse;
+		}
+	}
+
+	MSG_Init( &msg, ex->outBuf, MAX_MSGLEN );
+	MSG_Bitstream( &msg );
+	msg.allowoverflow = qtrue;
+
+	MSG_WriteLong( &msg, 0 );
+
+	MSG_WriteByte( &msg, svc_gamestate );
+	MSG_WriteLong( &msg, ex->commandSequence );
+
+	for ( i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		if ( !ex->configstrings[i] || !ex->configstrings[i][0] ) {
+			continue;
+		}
+		MSG_WriteByte( &msg, svc_configstring );
+		MSG_WriteShort( &msg, i );
+		MSG_WriteBigString( &msg, ex->configstrings[i] );
+	}
+
+	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+	for ( i = 0; i < MAX_GENTITIES; i++ ) {
+		if ( !ex->baselines[i].number ) {
+			continue;
+		}
+		MSG_WriteByte( &msg, svc_baseline );
+		MSG_WriteDeltaEntity( &msg, &nullstate, &ex->baselines[i], qtrue );
+	}
+
+	MSG_WriteByte( &msg, svc_EOF );
+
+	MSG_WriteLong( &msg, ex->target );
+	MSG_WriteLong( &msg, ex->checksumFeed );
+
+	MSG_WriteByte( &msg, svc_EOF );
+
+	// commands before the gamestate are already applied
+	ex->numPending = 0;
+	ex->deltaValid = qfalse;
+
+	return SV_ExtractWriteMessage( ex, &msg );
+}
+
+
+/*
+==================
+SV_ExtractSnapshot
+
+Writes the target snapshot the same way as CL_WriteSnapshot
+==================
+*/
+static qboolean SV_ExtractSnapshot( mvdExtract_t *ex, int snapFlags, int areabytes, const byte *areabits ) {
+	const entityState_t *oldent, *newent;
+	const entityState_t *ents[ MAX_SNAPSHOT_ENTITIES ];
+	const byte *visible;
+	int		oldindex, newindex, oldnum, newnum;
+	int		numEnts;
+	msg_t	msg;
+	int		i;
+
+	visible = ex->visible[ ex->target ];
+	numEnts = 0;
+	for ( i = 0; i < MAX_GENTITIES - 1 && numEnts < MAX_SNAPSHOT_ENTITIES; i++ ) {
+		if ( ex->present[i] && visible[i >> 3] & ( 1 << ( i & 7 ) ) ) {
+			ents[ numEnts++ ] = &ex->ents[i];
+		}
+	}
+
+	MSG_Init( &msg, ex->outBuf, MAX_MSGLEN );
+	MSG_Bitstream( &msg );
+	msg.allowoverflow = qtrue;
+
+	MSG_WriteLong( &msg, 0 );
+
+	for ( i = 0; i < ex->numPending; i++ ) {
+		MSG_WriteByte( &msg, svc_serverCommand );
+		MSG_WriteLong( &msg, ++ex->commandSequence );
+		MSG_WriteString( &msg, ex->pending[i] );
+	}
+	ex->numPending = 0;
+
+	MSG_WriteByte( &msg, svc_snapshot );
+	MSG_WriteLong( &msg, ex->serverTime );
+	MSG_WriteByte( &msg, ex->deltaValid ? 1 : 0 );
+	MSG_WriteByte( &msg, snapFlags );
+	MSG_WriteByte( &msg, areabytes );
+	MSG_WriteData( &msg, areabits, areabytes );
+
+	MSG_WriteDeltaPlayerstate( &msg, ex->deltaValid ? &ex->lastPs : NULL, &ex->ps[ ex->target ] );
+
+	if ( !ex->deltaValid ) {
+		ex->lastNumEnts = 0;
+	}
+
+	newent = NULL;
+	oldent = NULL;
+	newindex = 0;
+	oldindex = 0;
+	while ( newindex < numEnts || oldindex < ex->lastNumEnts ) {
+		if ( newindex >= numEnts ) {
+			newnum = MAX_GENTITIES+1;
+		} else {
+			newent = ents[ newindex ];
+			newnum = newent->number;
+		}
+
+		if ( oldindex >= ex->lastNumEnts ) {
+			oldnum = MAX_GENTITIES+1;
+		} else {
+			oldent = &ex->lastEnts[ oldindex ];
+			oldnum = oldent->number;
+		}
+
+		if ( newnum == oldnum ) {
+			MSG_WriteDeltaEntity( &msg, oldent, newent, qfalse );
+			oldindex++;
+			newindex++;
+		} else if ( newnum < oldnum ) {
+			MSG_WriteDeltaEntity( &msg, &ex->baselines[newnum], newent, qtrue );
+			newindex++;
+		} else {
+			MSG_WriteDeltaEntity( &msg, oldent, NULL, qtrue );
+			oldindex++;
+		}
+	}
+
+	MSG_WriteBits( &msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );
+
+	MSG_WriteByte( &msg, svc_EOF );
+
+	for ( i = 0; i < numEnts; i++ ) {
+		ex->lastEnts[i] = *ents[i];
+	}
+	ex->lastNumEnts = numEnts;
+	ex->lastPs = ex->ps[ ex->target ];
+	ex->deltaValid = qtrue;
+	ex->snapshots++;
+
+	return SV_ExtractWriteMessage( ex, &msg );
+}
+
+
+/*
+==================
+SV_ExtractClient
+==================
+*/
+static qboolean SV_ExtractClient( mvdExtract_t *ex, msg_t *msg ) {
+	byte	areabits[ MAX_MAP_AREA_BYTES ];
+	playerState_t ps;
+	int		clientNum, flags, areabytes;
+	int		snapFlags;
+	int		num;
+
+	clientNum = MSG_ReadByte( msg );
+	flags = MSG_ReadByte( msg );
+	areabytes = MSG_ReadByte( msg );
+	if ( clientNum < 0 || clientNum >= MAX_CLIENTS || areabytes < 0 || areabytes > sizeof( areabits ) ) {
+		return qfalse;
+	}
+	MSG_ReadData( msg, areabits, areabytes );
+
+	MSG_ReadDeltaPlayerstate( msg, ( flags & MVD_DELTA ) ? &ex->ps[ clientNum ] : NULL, &ps );
+	ex->ps[ clientNum ] = ps;
+
+	if ( !( flags & MVD_DELTA ) ) {
+		Com_Memset( ex->visible[ clientNum ], 0, sizeof( ex->visible[0] ) );
+	}
+
+	while ( ( num = MSG_ReadEntitynum( msg ) ) != MAX_GENTITIES-1 ) {
+		if ( num < 0 ) {
+			return qfalse;
+		}
+		ex->visible[ clientNum ][ num >> 3 ] ^= 1 << ( num & 7 );
+	}
+
+	if ( clientNum != ex->target ) {
+		return qtrue;
+	}
+
+	// a full block means a new connection in this slot
+	if ( ex->out == FS_INVALID_HANDLE || !( flags & MVD_DELTA ) ) {
+		if ( !SV_ExtractGamestate( ex ) ) {
+			return qfalse;
+		}
+	}
+
+	snapFlags = ex->serverBit;
+	if ( flags & MVD_RATE_DELAYED ) {
+		snapFlags |= SNAPFLAG_RATE_DELAYED;
+	}
+
+	return SV_ExtractSnapshot( ex, snapFlags, areabytes, areabits );
+}
+
+
+/*
+==================
+SV_ExtractEntities
+==================
+*/
+static qboolean SV_ExtractEntities( mvdExtract_t *ex, msg_t *msg ) {
+	entityState_t *from;
+	entityState_t to;
+	int num;
+
+	while ( ( num = MSG_ReadEntitynum( msg ) ) != MAX_GENTITIES-1 ) {
+		if ( num < 0 ) {
+			return qfalse;
+		}
+		from = ex->present[ num ] ? &ex->ents[ num ] : &ex->baselines[ num ];
+		MSG_ReadDeltaEntity( msg, from, &to, num );
+		if ( to.number == MAX_GENTITIES-1 ) {
+			ex->present[ num ] = 0;
+		} else {
+			ex->ents[ num ] = to;
+			ex->present[ num ] = 1;
+		}
+	}
+
+	return qtrue;
+}
+
+
+/*
+==================
+SV_ExtractMessage
+==================
+*/
+static qboolean SV_ExtractMessage( mvdExtract_t *ex, msg_t *msg ) {
+	entityState_t nullstate;
+	const char *s;
+	int		op, i;
+
+	op = MSG_ReadByte( msg );
+
+	switch ( op ) {
+	case mvd_gamestate:
+		if ( MSG_ReadLong( msg ) != MVD_VERSION ) {
+			Com_Printf( "Unsupported server demo version.\n" );
+			return qfalse;
+		}
+		ex->checksumFeed = MSG_ReadLong( msg );
+		MSG_ReadByte( msg ); // maxclients
+		while ( ( i = MSG_ReadShort( msg ) ) != MAX_CONFIGSTRINGS ) {
+			if ( i < 0 || i >= MAX_CONFIGSTRINGS ) {
+				return qfalse;
+			}
+			if ( ex->configstrings[i] ) {
+				Z_Free( ex->configstrings[i] );
+			}
+			ex->configstrings[i] = CopyString( MSG_ReadBigString( msg ) );
+		}
+		Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+		while ( ( i = MSG_ReadEntitynum( msg ) ) != MAX_GENTITIES-1 ) {
+			if ( i < 0 ) {
+				return qfalse;
+			}
+			MSG_ReadDeltaEntity( msg, &nullstate, &ex->baselines[i], i );
+		}
+		break;
+
+	case mvd_configstring:
+		i = MSG_ReadShort( msg );
+		if ( i < 0 || i >= MAX_CONFIGSTRINGS ) {
+			return qfalse;
+		}
+		SV_ExtractConfigstring( ex, i, MSG_ReadBigString( msg ) );
+		break;
+
+	case mvd_command:
+		i = MSG_ReadByte( msg );
+		s = MSG_ReadBigString( msg );
+		if ( i == MVD_BROADCAST || i == ex->target ) {
+			SV_ExtractQueueCommand( ex, s );
+		}
+		break;
+
+	case mvd_frame:
+		ex->serverTime = MSG_ReadLong( msg );
+		ex->serverBit = MSG_ReadByte( msg );
+		if ( !SV_ExtractEntities( ex, msg ) ) {
+			return qfalse;
+		}
+		while ( ( op = MSG_ReadByte( msg ) ) == mvd_client ) {
+			if ( !SV_ExtractClient( ex, msg ) ) {
+				return qfalse;
+			}
+		}
+		if ( op != mvd_EOF ) {
+			return qfalse;
+		}
+		break;
+
+	default:
+		return qfalse;
+	}
+
+	return ( msg->readcount <= msg->cursize );
+}
+
+
+/*
+==================
+SV_ExtractDemo_f
+
+svextract <demoname> <clientnum> [outname]
+==================
+*/
+void SV_ExtractDemo_f( void ) {
+	char			name[ MAX_OSPATH ];
+	char			outName[ MAX_QPATH ];
+	mvdExtract_t	*ex;
+	msg_t			msg;
+	int				len, i;
+	qboolean		ok;
+
+	if ( Cmd_Argc() < 3 || Cmd_Argc() > 4 ) {
+		Com_Printf( "usage: svextract <demoname> <clientnum> [outname]\n" );
+		return;
+	}
+
+	Q_strncpyz( outName, Cmd_Argv( 1 ), sizeof( outName ) );
+	if ( !Q_stricmp( COM_GetExtension( outName ), MVD_EXT ) ) {
+		COM_StripExtension( outName, outName, sizeof( outName ) );
+	}
+	Com_sprintf( name, sizeof( name ), "demos/%s.%s", outName, MVD_EXT );
+
+	ex = Z_Malloc( sizeof( *ex ) );
+	ex->out = FS_INVALID_HANDLE;
+	ex->target = atoi( Cmd_Argv( 2 ) );
+
+	if ( ex->target < 0 || ex->target >= MAX_CLIENTS ) {
+		Com_Printf( "Bad client number %i.\n", ex->target );
+		Z_Free( ex );
+		return;
+	}
+
+	FS_BypassPure();
+	FS_FOpenFileRead( name, &ex->in, qtrue );
+	FS_RestorePure();
+	if ( ex->in == FS_INVALID_HANDLE ) {
+		Com_Printf( "Couldn't open %s.\n", name );
+		Z_Free( ex );
+		return;
+	}
+
+	if ( Cmd_Argc() == 4 ) {
+		Q_strncpyz( outName, Cmd_Argv( 3 ), sizeof( outName ) );
+	} else {
+		Q_strcat( outName, sizeof( outName ), va( "-%i", ex->target ) );
+	}
+	Com_sprintf( ex->outName, sizeof( ex->outName ), "demos/%s.%s%d", outName, DEMOEXT, com_protocol->integer );
+
+	ok = qtrue;
+	for ( ;; ) {
+		if ( FS_Read( &len, 4, ex->in ) != 4 ) {
+			Com_Printf( "Server demo was truncated.\n" );
+			break;
+		}
+		len = LittleLong( len );
+		if ( len == -1 ) {
+			break;
+		}
+		if ( len <= 0 || len > MVD_MSGLEN ) {
+			ok = qfalse;
+			break;
+		}
+
+		MSG_Init( &msg, ex->inBuf, MVD_MSGLEN );
+		if ( FS_Read( msg.data, len, ex->in ) != len ) {
+			Com_Printf( "Server demo was truncated.\n" );
+			break;
+		}
+		msg.cursize = len;
+
+		if ( !SV_ExtractMessage( ex, &msg ) ) {
+			ok = qfalse;
+			break;
+		}
+	}
+
+	if ( !ok ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: bad message in %s, extraction stopped\n", name );
+	}
+
+	FS_FCloseFile( ex->in );
+
+	if ( ex->out != FS_INVALID_HANDLE ) {
+		len = -1;
+		FS_Write( &len, 4, ex->out );
+		FS_Write( &len, 4, ex->out );
+		FS_FCloseFile( ex->out );
+		Com_Printf( "Wrote %s, %i snapshots.\n", ex->outName, ex->snapshots );
+	} else {
+		Com_Printf( "Client %i has no snapshots in %s.\n", ex->target, name );
+	}
+
+	for ( i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		if ( ex->configstrings[i] ) {
+			Z_Free( ex->configstrings[i] );
+		}
+	}
+	Z_Free( ex );
+}
+
+
+/*
+==================
+SV_CompleteDemoName
+==================
+*/
+void SV_CompleteDemoName( const char *args, int argNum ) {
+	if ( argNum == 2 ) {
+		Field_CompleteFilename( "demos", "." MVD_EXT, qtrue, FS_MATCH_EXTERN | FS_MATCH_STICK | FS_MATCH_SUBDIRS );
+	}
+}
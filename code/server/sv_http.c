@@ -0,0 +1,675 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_http.c -- built-in HTTP/1.1 server for pk3 downloads redirected via sv_dlURL
+
+#include "server.h"
+
+#define MAX_HTTP_CONNECTIONS	32
+#define HTTP_REQUEST_SIZE		2048
+#define HTTP_HEADER_SIZE		512
+#define HTTP_TIMEOUT			15000		// msec without any progress
+#define HTTP_READ_CHUNK			16384
+#define HTTP_SEND_BUDGET		(256*1024)	// per SV_HTTPEvent() call, so game packets are not delayed
+
+typedef struct {
+	int				sock;				// -1 if free
+	netadr_t		addr;
+	int				lastTime;
+
+	char			request[ HTTP_REQUEST_SIZE ];
+	int				requestLen;
+
+	char			header[ HTTP_HEADER_SIZE ];
+	int				headerLen;
+	int				headerSent;
+
+	downloadFile_t	*file;
+	int				offset;				// next byte to send
+	int				end;				// end of requested range
+	qboolean		keepAlive;
+	qboolean		sending;
+
+	byte			chunk[ HTTP_READ_CHUNK ];	// file data read but not sent yet
+	int				chunkPos;
+	int				chunkLen;
+} httpConnection_t;
+
+static httpConnection_t httpConns[ MAX_HTTP_CONNECTIONS ];
+static int httpListener = -1;
+static int httpPort;
+static int httpNextConn;
+static qboolean httpAdvertised;
+
+
+/*
+==================
+SV_HTTPFreeConnection
+==================
+*/
+static void SV_HTTPFreeConnection( httpConnection_t *hc ) {
+	if ( hc->file ) {
+		SV_ReleaseDownloadFile( hc->file );
+		hc->file = NULL;
+	}
+
+	NET_TCPClose( hc->sock );
+	hc->sock = -1;
+}
+
+
+/*
+==================
+SV_HTTPResponse
+
+Prepares response header, file range (if any) will follow it
+==================
+*/
+static void SV_HTTPResponse( httpConnection_t *hc, int status, const char *reason, const char *extra, int contentLength ) {
+	hc->headerLen = Com_sprintf( hc->header, sizeof( hc->header ),
+		"HTTP/1.1 %i %s\r\n"
+		"Server: " Q3_VERSION "\r\n"
+		"Content-Length: %i\r\n"
+		"Connection: %s\r\n"
+		"%s"
+		"\r\n",
+		status, reason, contentLength, hc->keepAlive ? "keep-alive" : "close", extra );
+	hc->headerSent = 0;
+	hc->chunkPos = hc->chunkLen = 0;
+	hc->sending = qtrue;
+
+	NET_TCPWantWrite( hc->sock, qtrue );
+}
+
+
+/*
+==================
+SV_HTTPError
+==================
+*/
+static void SV_HTTPError( httpConnection_t *hc, int status, const char *reason ) {
+	if ( hc->file ) {
+		SV_ReleaseDownloadFile( hc->file );
+		hc->file = NULL;
+	}
+	hc->offset = hc->end = 0;
+	hc->keepAlive = qfalse;
+	SV_HTTPResponse( hc, status, reason, "", 0 );
+}
+
+
+/*
+==================
+SV_HTTPAllowedFile
+
+Only pk3 files referenced by current map can be downloaded,
+same as with UDP downloads
+==================
+*/
+static qboolean SV_HTTPAllowedFile( const char *name ) {
+	char pakbuf[ MAX_QPATH ], *ext;
+	const char *s, *token;
+
+	if ( strlen( name ) >= sizeof( pakbuf ) || strstr( name, ".." ) || strchr( name, '\\' ) || strchr( name, ':' ) ) {
+		return qfalse;
+	}
+
+	Q_strncpyz( pakbuf, name, sizeof( pakbuf ) );
+	ext = strrchr( pakbuf, '.' );
+	if ( !ext || Q_stricmp( ext, ".pk3" ) ) {
+		return qfalse;
+	}
+	*ext = '\0';
+
+	if ( FS_idPak( pakbuf, BASETA, NUM_TA_PAKS ) || FS_idPak( pakbuf, BASEGAME, NUM_ID_PAKS ) ) {
+		return qfalse;
+	}
+
+	s = sv_referencedPakNames->string;
+	while ( 1 ) {
+		token = COM_ParseExt( &s, qfalse );
+		if ( !token[0] ) {
+			break;
+		}
+		if ( !FS_FilenameCompare( token, pakbuf ) ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
+/*
+==================
+SV_HTTPHex
+==================
+*/
+static int SV_HTTPHex( char c ) {
+	if ( c >= '0' && c <= '9' ) {
+		return c - '0';
+	}
+	if ( c >= 'a' && c <= 'f' ) {
+		return c - 'a' + 10;
+	}
+	if ( c >= 'A' && c <= 'F' ) {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+
+/*
+==================
+SV_HTTPDecodePath
+==================
+*/
+static void SV_HTTPDecodePath( char *out, int size, const char *in ) {
+	int hi, lo;
+
+	while ( *in == '/' ) {
+		in++;
+	}
+
+	while ( *in && *in != '?' && size > 1 ) {
+		if ( *in == '%' && ( hi = SV_HTTPHex( in[1] ) ) >= 0 && ( lo = SV_HTTPHex( in[2] ) ) >= 0 ) {
+			*out++ = hi * 16 + lo;
+			in += 3;
+		} else {
+			*out++ = *in++;
+		}
+		size--;
+	}
+
+	*out = '\0';
+}
+
+
+/*
+==================
+SV_HTTPParseRange
+
+Supports single "bytes=first-last", "bytes=first-" and "bytes=-suffix" ranges
+==================
+*/
+static qboolean SV_HTTPParseRange( const char *s, int size, int *first, int *last ) {
+	char *end;
+	long a, b;
+
+	while ( *s == ' ' ) {
+		s++;
+	}
+
+	if ( Q_stricmpn( s, "bytes=", 6 ) ) {
+		return qfalse;
+	}
+	s += 6;
+
+	if ( *s == '-' ) {
+		b = strtol( s + 1, &end, 10 );
+		if ( end == s + 1 || b <= 0 ) {
+			return qfalse;
+		}
+		*first = b >= size ? 0 : size - b;
+		*last = size - 1;
+		return qtrue;
+	}
+
+	a = strtol( s, &end, 10 );
+	if ( end == s || *end != '-' || a < 0 || a >= size ) {
+		return qfalse;
+	}
+	s = end + 1;
+
+	b = strtol( s, &end, 10 );
+	if ( end == s ) {
+		b = size - 1;
+	} else if ( b < a ) {
+		return qfalse;
+	} else if ( b >= size ) {
+		b = size - 1;
+	}
+
+	*first = a;
+	*last = b;
+	return qtrue;
+}
+
+
+/*
+==================
+SV_HTTPHandleRequest
+
+Parses complete request header and prepares response
+==================
+*/
+static void SV_HTTPHandleRequest( httpConnection_t *hc, char *req ) {
+	char path[ MAX_QPATH ], extra[ 256 ];
+	char *line, *next, *method, *uri, *version, *value;
+	const char *range;
+	qboolean head;
+	int first, last;
+
+	range = NULL;
+
+	// request line
+	next = strstr( req, "\r\n" );
+	*next = '\0';
+	next += 2;
+
+	method = req;
+	uri = strchr( method, ' ' );
+	if ( !uri ) {
+		SV_HTTPError( hc, 400, "Bad Request" );
+		return;
+	}
+	*uri++ = '\0';
+	version = strchr( uri, ' ' );
+	if ( !version ) {
+		SV_HTTPError( hc, 400, "Bad Request" );
+		return;
+	}
+	*version++ = '\0';
+
+	hc->keepAlive = !Q_stricmp( version, "HTTP/1.1" );
+
+	// headers
+	for ( line = next; *line; line = next ) {
+		next = strstr( line, "\r\n" );
+		if ( !next ) {
+			break;
+		}
+		*next = '\0';
+		next += 2;
+
+		value = strchr( line, ':' );
+		if ( !value ) {
+			continue;
+		}
+		*value++ = '\0';
+		while ( *value == ' ' ) {
+			value++;
+		}
+
+		if ( !Q_stricmp( line, "Range" ) ) {
+			range = value;
+		} else if ( !Q_stricmp( line, "Connection" ) ) {
+			if ( !Q_stricmp( value, "close" ) ) {
+				hc->keepAlive = qfalse;
+			} else if ( !Q_stricmp( value, "keep-alive" ) ) {
+				hc->keepAlive = qtrue;
+			}
+		}
+	}
+
+	head = !strcmp( method, "HEAD" );
+	if ( !head && strcmp( method, "GET" ) ) {
+		SV_HTTPError( hc, 405, "Method Not Allowed" );
+		return;
+	}
+
+	if ( !( sv_allowDownload->integer & DLF_ENABLE ) || ( sv_allowDownload->integer & DLF_NO_REDIRECT ) ) {
+		SV_HTTPError( hc, 403, "Forbidden" );
+		return;
+	}
+
+	SV_HTTPDecodePath( path, sizeof( path ), uri );
+
+	if ( !SV_HTTPAllowedFile( path ) || ( hc->file = SV_AcquireDownloadFile( path ) ) == NULL ) {
+		Com_DPrintf( "HTTP: %s : \"%s\" not found\n", NET_AdrToString( &hc->addr ), path );
+		SV_HTTPError( hc, 404, "Not Found" );
+		return;
+	}
+
+	if ( range ) {
+		if ( !SV_HTTPParseRange( range, hc->file->size, &first, &last ) ) {
+			Com_sprintf( extra, sizeof( extra ), "Content-Range: bytes */%i\r\n", hc->file->size );
+			SV_ReleaseDownloadFile( hc->file );
+			hc->file = NULL;
+			hc->offset = hc->end = 0;
+			SV_HTTPResponse( hc, 416, "Range Not Satisfiable", extra, 0 );
+			return;
+		}
+		Com_sprintf( extra, sizeof( extra ), "Content-Type: application/octet-stream\r\n"
+			"Accept-Ranges: bytes\r\nContent-Range: bytes %i-%i/%i\r\n", first, last, hc->file->size );
+		hc->offset = first;
+		hc->end = last + 1;
+		SV_HTTPResponse( hc, 206, "Partial Content", extra, hc->end - hc->offset );
+	} else {
+		hc->offset = 0;
+		hc->end = hc->file->size;
+		SV_HTTPResponse( hc, 200, "OK", "Content-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\n", hc->end );
+	}
+
+	Com_DPrintf( "HTTP: %s : %s \"%s\" %i-%i\n", NET_AdrToString( &hc->addr ), method, path, hc->offset, hc->end );
+
+	if ( head ) {
+		hc->offset = hc->end;
+	}
+}
+
+
+/*
+==================
+SV_HTTPRead
+
+Returns qfalse if connection has been closed
+==================
+*/
+static qboolean SV_HTTPRead( httpConnection_t *hc ) {
+	char *end;
+	int len, n;
+
+	while ( hc->requestLen < sizeof( hc->request ) - 1 ) {
+		n = NET_TCPRecv( hc->sock, hc->request + hc->requestLen, sizeof( hc->request ) - 1 - hc->requestLen );
+		if ( n < 0 ) {
+			return qfalse;
+		}
+		if ( n == 0 ) {
+			break;
+		}
+		hc->requestLen += n;
+		hc->lastTime = Sys_Milliseconds();
+	}
+
+	hc->request[ hc->requestLen ] = '\0';
+
+	if ( hc->sending ) {
+		// pipelined request will be handled after current response
+		return qtrue;
+	}
+
+	end = strstr( hc->request, "\r\n\r\n" );
+	if ( !end ) {
+		if ( hc->requestLen >= sizeof( hc->request ) - 1 ) {
+			SV_HTTPError( hc, 431, "Request Header Fields Too Large" );
+		}
+		return qtrue;
+	}
+
+	len = end - hc->request + 4;
+	end[2] = '\0';
+
+	SV_HTTPHandleRequest( hc, hc->request );
+
+	// keep pipelined data
+	hc->requestLen -= len;
+	memmove( hc->request, hc->request + len, hc->requestLen );
+	hc->request[ hc->requestLen ] = '\0';
+
+	return qtrue;
+}
+
+
+/*
+==================
+SV_HTTPWrite
+
+Sends pending response data within given budget,
+returns qfalse if connection should be closed
+==================
+*/
+static qboolean SV_HTTPWrite( httpConnection_t *hc, int *budget ) {
+	int n, len;
+
+	while ( hc->headerSent < hc->headerLen ) {
+		n = NET_TCPSend( hc->sock, hc->header + hc->headerSent, hc->headerLen - hc->headerSent );
+		if ( n < 0 ) {
+			return qfalse;
+		}
+		if ( n == 0 ) {
+			return qtrue;
+		}
+		hc->headerSent += n;
+		hc->lastTime = Sys_Milliseconds();
+	}
+
+	while ( hc->offset < hc->end && *budget > 0 ) {
+		if ( hc->chunkPos == hc->chunkLen ) {
+			len = MIN( hc->end - hc->offset, HTTP_READ_CHUNK );
+			if ( !SV_ReadDownloadFile( hc->file, hc->offset, hc->chunk, len ) ) {
+				return qfalse;
+			}
+			hc->chunkPos = 0;
+			hc->chunkLen = len;
+		}
+		n = NET_TCPSend( hc->sock, hc->chunk + hc->chunkPos, hc->chunkLen - hc->chunkPos );
+		if ( n < 0 ) {
+			return qfalse;
+		}
+		if ( n == 0 ) {
+			return qtrue;
+		}
+		hc->chunkPos += n;
+		hc->offset += n;
+		*budget -= n;
+		hc->lastTime = Sys_Milliseconds();
+	}
+
+	if ( hc->offset < hc->end ) {
+		return qtrue;
+	}
+
+	// response is complete
+	if ( hc->file ) {
+		SV_ReleaseDownloadFile( hc->file );
+		hc->file = NULL;
+	}
+
+	hc->sending = qfalse;
+	NET_TCPWantWrite( hc->sock, qfalse );
+
+	return hc->keepAlive;
+}
+
+
+/*
+==================
+SV_HTTPAccept
+==================
+*/
+static void SV_HTTPAccept( void ) {
+	httpConnection_t *hc, *freeConn;
+	netadr_t from;
+	int sock, i, count;
+
+	while ( ( sock = NET_TCPAccept( httpListener, &from ) ) != -1 ) {
+		freeConn = NULL;
+		count = 0;
+		for ( i = 0; i < MAX_HTTP_CONNECTIONS; i++ ) {
+			hc = &httpConns[ i ];
+			if ( hc->sock == -1 ) {
+				if ( !freeConn ) {
+					freeConn = hc;
+				}
+			} else if ( NET_CompareBaseAdr( &hc->addr, &from ) ) {
+				count++;
+			}
+		}
+
+		if ( !freeConn || count >= sv_httpMaxPerIP->integer ) {
+			Com_DPrintf( "HTTP: %s : too many connections\n", NET_AdrToString( &from ) );
+			NET_TCPClose( sock );
+			continue;
+		}
+
+		Com_Memset( freeConn, 0, sizeof( *freeConn ) );
+		freeConn->sock = sock;
+		freeConn->addr = from;
+		freeConn->lastTime = Sys_Milliseconds();
+	}
+}
+
+
+/*
+==================
+SV_HTTPEvent
+
+Called by NET_Sleep() when any TCP socket is ready,
+never blocks as all sockets are non-blocking
+==================
+*/
+void SV_HTTPEvent( void ) {
+	httpConnection_t *hc;
+	int i, budget;
+
+	if ( httpListener == -1 ) {
+		return;
+	}
+
+	budget = HTTP_SEND_BUDGET;
+
+	// rotate first connection for fair bandwidth sharing
+	for ( i = 0; i < MAX_HTTP_CONNECTIONS; i++ ) {
+		hc = &httpConns[ ( httpNextConn + i ) % MAX_HTTP_CONNECTIONS ];
+		if ( hc->sock == -1 ) {
+			continue;
+		}
+
+		if ( !SV_HTTPRead( hc ) ) {
+			SV_HTTPFreeConnection( hc );
+			continue;
+		}
+
+		if ( hc->sending && !SV_HTTPWrite( hc, &budget ) ) {
+			SV_HTTPFreeConnection( hc );
+			continue;
+		}
+
+		// handle pipelined request
+		if ( !hc->sending && strstr( hc->request, "\r\n\r\n" ) && !SV_HTTPRead( hc ) ) {
+			SV_HTTPFreeConnection( hc );
+			continue;
+		}
+
+		// don't wake up on incoming data that won't be consumed until response is sent
+		NET_TCPWantRead( hc->sock, !hc->sending && hc->requestLen < sizeof( hc->request ) - 1 );
+	}
+
+	httpNextConn = ( httpNextConn + 1 ) % MAX_HTTP_CONNECTIONS;
+
+	// accept after closed connections have been released
+	SV_HTTPAccept();
+}
+
+
+/*
+==================
+SV_HTTPAdvertise
+
+Sets sv_dlURL to built-in server if it was not set by the user
+==================
+*/
+static void SV_HTTPAdvertise( qboolean enable ) {
+	const char *host;
+
+	if ( !enable ) {
+		if ( httpAdvertised ) {
+			Cvar_Set( "sv_dlURL", "" );
+			httpAdvertised = qfalse;
+		}
+		return;
+	}
+
+	if ( !httpAdvertised && Cvar_VariableString( "sv_dlURL" )[0] ) {
+		return;
+	}
+
+	host = sv_httpHost->string;
+	if ( !host[0] ) {
+		host = Cvar_VariableString( "net_ip" );
+		if ( !host[0] || !strcmp( host, "0.0.0.0" ) || !Q_stricmp( host, "localhost" ) ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: set sv_httpHost to advertise HTTP server via sv_dlURL\n" );
+			return;
+		}
+	}
+
+	Cvar_Set( "sv_dlURL", va( "http://%s:%i", host, httpPort ) );
+	httpAdvertised = qtrue;
+}
+
+
+/*
+==================
+SV_HTTPShutdown
+==================
+*/
+void SV_HTTPShutdown( void ) {
+	int i;
+
+	if ( httpListener != -1 ) {
+		for ( i = 0; i < MAX_HTTP_CONNECTIONS; i++ ) {
+			if ( httpConns[ i ].sock != -1 ) {
+				SV_HTTPFreeConnection( &httpConns[ i ] );
+			}
+		}
+		NET_TCPClose( httpListener );
+		httpListener = -1;
+		httpPort = 0;
+	}
+
+	SV_HTTPAdvertise( qfalse );
+}
+
+
+/*
+==================
+SV_HTTPFrame
+
+Starts/stops listening on sv_httpPort changes and closes stale connections
+==================
+*/
+void SV_HTTPFrame( void ) {
+	httpConnection_t *hc;
+	int i, now;
+
+	if ( sv_httpPort->integer != httpPort || sv_httpHost->modified ) {
+		sv_httpHost->modified = qfalse;
+		SV_HTTPShutdown();
+		if ( sv_httpPort->integer <= 0 ) {
+			return;
+		}
+		for ( i = 0; i < MAX_HTTP_CONNECTIONS; i++ ) {
+			httpConns[ i ].sock = -1;
+		}
+		httpListener = NET_TCPListen( sv_httpPort->integer );
+		if ( httpListener == -1 ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: couldn't start HTTP server on port %i\n", sv_httpPort->integer );
+			Cvar_Set( "sv_httpPort", "0" );
+			return;
+		}
+		httpPort = sv_httpPort->integer;
+		SV_HTTPAdvertise( qtrue );
+	}
+
+	if ( httpListener == -1 ) {
+		return;
+	}
+
+	now = Sys_Milliseconds();
+	for ( i = 0; i < MAX_HTTP_CONNECTIONS; i++ ) {
+		hc = &httpConns[ i ];
+		if ( hc->sock != -1 && now - hc->lastTime > HTTP_TIMEOUT ) {
+			Com_DPrintf( "HTTP: %s : timed out\n", NET_AdrToString( &hc->addr ) );
+			SV_HTTPFreeConnection( hc );
+		}
+	}
+}
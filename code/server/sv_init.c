@@ -57,16 +57,16 @@ static void SV_SendConfigstring(client_t *client, int index)
 			Q_strncpyz( buf, &sv.configstrings[index][sent],
 				maxChunkSize );
 
-			SV_SendServerCommand( client, "%s %i \"%s\"", cmd,
-				index, buf );
+			SV_AddServerCommand( client, va( "%s %i \"%s\"", cmd,
+				index, buf ) );
 
 			sent += (maxChunkSize - 1);
 			remaining -= (maxChunkSize - 1);
 		}
 	} else {
 		// standard cs, just send it
-		SV_SendServerCommand( client, "cs %i \"%s\"", index,
-			sv.configstrings[index] );
+		SV_AddServerCommand( client, va( "cs %i \"%s\"", index,
+			sv.configstrings[index] ) );
 	}
 }
 
@@ -128,6 +128,10 @@ void SV_SetConfigstring (int index, const char *val) {
 	// spawning a new server
 	if ( sv.state == SS_GAME || sv.restarting ) {
 
+		if ( sv_demoRecording ) {
+			SV_DemoConfigstring( index, val );
+		}
+
 		// send the data to all relevant clients
 		for (i = 0, client = svs.clients; i < sv.maxclients; i++, client++) {
 			if ( client->state < CS_ACTIVE ) {
@@ -413,6 +417,9 @@ void SV_SpawnServer( const char *mapname, qboolean killBots ) {
 	qboolean	isBot;
 	const char	*p;
 
+	// finish the demo of the previous map
+	SV_DemoStop();
+
 	// shut down the existing game if it is running
 	SV_ShutdownGameProgs();
 
@@ -674,9 +681,14 @@ void SV_SpawnServer( const char *mapname, qboolean killBots ) {
 	// to all clients
 	sv.state = SS_GAME;
 
+	SV_DemoAutoRecord();
+
 	// send a heartbeat now so the master will get up to date info
 	SV_Heartbeat_f();
 
+	// release preloaded files which were not used by this map
+	FS_PreloadCancel();
+
 	Hunk_SetMark();
 
 	Com_Printf ("-----------------------------------\n");
@@ -688,6 +700,95 @@ void SV_SpawnServer( const char *mapname, qboolean killBots ) {
 }
 
 
+/*
+================
+SV_NextMapName
+
+Follows vstr chains in nextmap until first map command
+================
+*/
+static qboolean SV_NextMapName( char *mapname, int size ) {
+	char	text[ MAX_CVAR_VALUE_STRING ];
+	const char *s, *token;
+	char	*sep;
+	int		depth;
+
+	Q_strncpyz( text, Cvar_VariableString( "nextmap" ), sizeof( text ) );
+
+	for ( depth = 0; depth < 8; depth++ ) {
+		// only the first command matters
+		sep = strchr( text, ';' );
+		if ( sep ) {
+			*sep = '\0';
+		}
+		s = text;
+		token = COM_ParseExt( &s, qfalse );
+		if ( !Q_stricmp( token, "vstr" ) ) {
+			token = COM_ParseExt( &s, qfalse );
+			Q_strncpyz( text, Cvar_VariableString( token ), sizeof( text ) );
+			continue;
+		}
+		if ( !Q_stricmp( token, "map" ) || !Q_stricmp( token, "devmap" ) || !Q_stricmp( token, "spmap" ) || !Q_stricmp( token, "spdevmap" ) ) {
+			token = COM_ParseExt( &s, qfalse );
+			if ( *token == '\0' ) {
+				return qfalse;
+			}
+			Q_strncpyz( mapname, token, size );
+			return qtrue;
+		}
+		break;
+	}
+
+	return qfalse;
+}
+
+
+/*
+================
+SV_PreloadNextMap
+
+Starts background reading of the next map in rotation
+so SV_SpawnServer() will get it from memory
+================
+*/
+void SV_PreloadNextMap( void ) {
+	static int modificationCount = -1;
+	char mapname[ MAX_QPATH ];
+	char bsp[ MAX_QPATH ], aas[ MAX_QPATH ];
+	const char *files[2];
+	const cvar_t *nextmap;
+	int count;
+
+	if ( !sv_preloadNextMap->integer ) {
+		modificationCount = -1;
+		return;
+	}
+
+	nextmap = Cvar_Get( "nextmap", "", CVAR_TEMP );
+	if ( nextmap->modificationCount == modificationCount ) {
+		return;
+	}
+	modificationCount = nextmap->modificationCount;
+
+	if ( !SV_NextMapName( mapname, sizeof( mapname ) ) || !Q_stricmp( mapname, sv_mapname->string ) ) {
+		return;
+	}
+
+	Com_sprintf( bsp, sizeof( bsp ), "maps/%s.bsp", mapname );
+	files[0] = bsp;
+	count = 1;
+
+	if ( Cvar_VariableIntegerValue( "bot_enable" ) ) {
+		Com_sprintf( aas, sizeof( aas ), "maps/%s.aas", mapname );
+		files[count++] = aas;
+	}
+
+	Com_DPrintf( "Preloading next map %s\n", mapname );
+
+	FS_PreloadFiles( files, count );
+}
+
+
 /*
 ===============
 SV_Init
@@ -772,6 +873,16 @@ void SV_Init( void )
 	Cvar_SetDescription( sv_allowDownload, "Toggle the ability for clients to download files maps etc. from server." );
 	Cvar_Get ("sv_dlURL", "", CVAR_SERVERINFO | CVAR_ARCHIVE);
 
+	sv_httpPort = Cvar_Get( "sv_httpPort", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_httpPort, "0", "65535", CV_INTEGER );
+	Cvar_SetDescription( sv_httpPort, "TCP port of built-in HTTP server for referenced pk3 downloads, 0 to disable.\n"
+		"If sv_dlURL is empty it will be set to point to this server." );
+	sv_httpHost = Cvar_Get( "sv_httpHost", "", CVAR_ARCHIVE_ND );
+	Cvar_SetDescription( sv_httpHost, "Public host name or address of built-in HTTP server advertised via sv_dlURL, net_ip is used if empty." );
+	sv_httpMaxPerIP = Cvar_Get( "sv_httpMaxPerIP", "4", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_httpMaxPerIP, "1", "32", CV_INTEGER );
+	Cvar_SetDescription( sv_httpMaxPerIP, "Maximum number of simultaneous HTTP connections from single IP address." );
+
 	// moved to Com_Init()
 	//sv_master[0] = Cvar_Get( "sv_master1", MASTER_SERVER_NAME, CVAR_INIT | CVAR_ARCHIVE_ND );
 	//sv_master[1] = Cvar_Get( "sv_master2", "master.ioquake3.org", CVAR_INIT | CVAR_ARCHIVE_ND );
@@ -801,9 +912,22 @@ void SV_Init( void )
 	sv_levelTimeReset = Cvar_Get( "sv_levelTimeReset", "0", CVAR_ARCHIVE_ND );
 	Cvar_SetDescription( sv_levelTimeReset, "Whether or not to reset leveltime after new map loads." );
 
+	sv_preloadNextMap = Cvar_Get( "sv_preloadNextMap", "1", CVAR_ARCHIVE_ND );
+	Cvar_SetDescription( sv_preloadNextMap, "Read next map in rotation (from nextmap cvar) in background to reduce map change time." );
+
 	sv_filter = Cvar_Get( "sv_filter", "filter.txt", CVAR_ARCHIVE );
 	Cvar_SetDescription( sv_filter, "Cvar that point on filter file, if it is "" then filtering will be disabled." );
 
+	sv_telemetry = Cvar_Get( "sv_telemetry", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_telemetry, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( sv_telemetry, "Publish frame, snapshot, packet drop and rate limit records in a shared memory ring, see sv_telemetryFile. Records are written only while a reader is attached." );
+	sv_telemetryFile = Cvar_Get( "sv_telemetryFile", "", CVAR_ARCHIVE_ND | CVAR_PROTECTED );
+	Cvar_SetDescription( sv_telemetryFile, "Full path of the file mapped for \\sv_telemetry, when empty telemetry-<port>.bin in the home game directory is used." );
+
+	sv_autoRecord = Cvar_Get( "sv_autoRecord", "0", CVAR_ARCHIVE_ND );
+	Cvar_CheckRange( sv_autoRecord, "0", "1", CV_INTEGER );
+	Cvar_SetDescription( sv_autoRecord, "Record a multi-view server demo of every map into demos/server, see \\svrecord." );
+
 	// initialize bot cvars so they are listed and can be set before loading the botlib
 	SV_BotInitCvars();
 
@@ -894,6 +1018,14 @@ void SV_Shutdown( const char *finalmsg ) {
 	// free current level
 	SV_ClearServer();
 
+	FS_PreloadCancel();
+
+	SV_HTTPShutdown();
+
+	SV_TelemetryShutdown();
+
+	SV_DemoStop();
+
 	SV_FreeIP4DB();
 
 	// free server static data
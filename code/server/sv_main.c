@@ -56,6 +56,13 @@ cvar_t	*sv_lanForceRate; // dedicated 1 (LAN) server forces local client rates t
 
 cvar_t *sv_levelTimeReset;
 cvar_t *sv_filter;
+cvar_t *sv_preloadNextMap;
+cvar_t *sv_httpPort;
+cvar_t *sv_httpHost;
+cvar_t *sv_httpMaxPerIP;
+cvar_t *sv_telemetry;
+cvar_t *sv_telemetryFile;
+cvar_t *sv_autoRecord;
 
 #ifdef USE_BANS
 cvar_t	*sv_banFile;
@@ -192,6 +199,10 @@ void QDECL SV_SendServerCommand( client_t *cl, const char *fmt, ... ) {
 	len = Q_vsnprintf( message, sizeof( message ), fmt, argptr );
 	va_end( argptr );
 
+	if ( sv_demoRecording ) {
+		SV_DemoCommand( cl, message );
+	}
+
 	if ( cl != NULL ) {
 		// outdated clients can't properly decode 1023-chars-long strings
 		// http://aluigi.altervista.org/adv/q3msgboom-adv.txt
@@ -594,8 +605,15 @@ Rate limit for a particular address
 */
 qboolean SVC_RateLimitAddress( const netadr_t *from, int burst, int period ) {
 	leakyBucket_t *bucket = SVC_BucketForAddress( from, burst, period );
+	qboolean limited;
+
+	limited = bucket ? SVC_RateLimit( &bucket->rate, burst, period ) : qtrue;
+
+	if ( limited && sv_telemetryActive ) {
+		SV_Telemetry( TM_RATELIMIT, -1, from->type, SV_TelemetryAddress( from ), BigShort( from->port ), burst, period, 0 );
+	}
 
-	return bucket ? SVC_RateLimit( &bucket->rate, burst, period ) : qtrue;
+	return limited;
 }
 
 
@@ -1285,6 +1303,8 @@ void SV_Frame( int msec ) {
 	int		frameMsec;
 	int		startTime;
 	int		i;
+	int64_t	frameStart, gameEnd, sendStart;
+	int		gameFrames;
 
 	if ( Cvar_CheckGroup( CVG_SERVER ) )
 		SV_TrackCvarChanges(); // update rate settings, etc.
@@ -1307,6 +1327,12 @@ void SV_Frame( int msec ) {
 		return;
 	}
 
+	// start/stop built-in HTTP server
+	SV_HTTPFrame();
+
+	// map telemetry ring and check for readers
+	SV_TelemetryFrame();
+
 	// allow pause if only the local client is connected
 	if ( SV_CheckPaused() ) {
 		return;
@@ -1375,12 +1401,15 @@ void SV_Frame( int msec ) {
 		startTime = 0;	// quite a compiler warning
 	}
 
+	frameStart = sv_telemetryActive ? Sys_Microseconds() : 0;
+
 	// update ping based on the all received frames
 	SV_CalcPings();
 
 	if (com_dedicated->integer) SV_BotFrame (sv.time);
 
 	// run the game simulation in chunks
+	gameFrames = 0;
 	while ( sv.timeResidual >= frameMsec ) {
 		sv.timeResidual -= frameMsec;
 		svs.time += frameMsec;
@@ -1388,8 +1417,11 @@ void SV_Frame( int msec ) {
 
 		// let everything in the world think and move
 		VM_Call( gvm, 1, GAME_RUN_FRAME, sv.time );
+		gameFrames++;
 	}
 
+	gameEnd = sv_telemetryActive ? Sys_Microseconds() : 0;
+
 	if ( com_speeds->integer ) {
 		time_game = Sys_Milliseconds () - startTime;
 	}
@@ -1401,10 +1433,32 @@ void SV_Frame( int msec ) {
 	SV_IssueNewSnapshot();
 
 	// send messages back to the clients
+	sendStart = sv_telemetryActive ? Sys_Microseconds() : 0;
 	SV_SendClientMessages();
 
+	if ( sv_demoRecording ) {
+		SV_DemoFrame();
+	}
+
 	// send a heartbeat to the master if needed
 	SV_MasterHeartbeat(HEARTBEAT_FOR_MASTER);
+
+	// start reading next map if it is known
+	SV_PreloadNextMap();
+
+	if ( sv_telemetryActive && frameStart ) {
+		int64_t frameEnd = Sys_Microseconds();
+		int activeClients = 0;
+
+		for ( i = 0; i < sv.maxclients; i++ ) {
+			if ( svs.clients[i].state == CS_ACTIVE ) {
+				activeClients++;
+			}
+		}
+
+		SV_Telemetry( TM_FRAME, -1, (int)( frameEnd - frameStart ), (int)( gameEnd - frameStart ),
+			(int)( frameEnd - sendStart ), gameFrames, activeClients, sv.timeResidual );
+	}
 }
 
 
@@ -257,6 +257,10 @@ qboolean SV_Netchan_Process( client_t *client, msg_t *msg ) {
 	if ( !ret )
 		return qfalse;
 
+	if ( client->netchan.dropped > 0 && sv_telemetryActive ) {
+		SV_Telemetry( TM_DROP, client - svs.clients, client->netchan.dropped, client->netchan.incomingSequence, 0, 0, 0, 0 );
+	}
+
 	if ( client->compat )
 		SV_Netchan_Decode( client, msg );
 
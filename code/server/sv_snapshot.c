@@ -676,6 +676,10 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ )	{
 		frame->ents[ i ] = svs.currFrame->ents[ entityNumbers.snapshotEntities[ i ] ];
 	}
+
+	if ( sv_demoRecording ) {
+		SV_DemoClientSnapshot( client, frame );
+	}
 }
 
 
@@ -739,6 +743,11 @@ void SV_SendClientSnapshot( client_t *client ) {
 		MSG_Clear( &msg );
 	}
 
+	if ( sv_telemetryActive ) {
+		SV_Telemetry( TM_SNAPSHOT, client - svs.clients, msg.cursize, client->ping, client->rate,
+			client->rateDelayed, client->snapshotMsec, svs.time - client->lastSnapshotTime );
+	}
+
 	SV_SendMessageToClient( &msg, client );
 }
 
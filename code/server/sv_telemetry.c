@@ -0,0 +1,201 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_telemetry.c -- binary metrics stream in a shared memory ring, see sv_telemetry.h
+
+#include "server.h"
+
+#define TELEMETRY_CHECK_MSEC	1000	// reader heartbeat poll interval
+
+typedef struct {
+	telemetryHeader_t	*header;
+	telemetryRecord_t	*records;
+	int					size;
+	uint32_t			heartbeat;
+	int					nextCheck;
+} telemetry_t;
+
+static telemetry_t telemetry;
+
+qboolean sv_telemetryActive;
+
+
+/*
+==================
+SV_TelemetryClose
+==================
+*/
+static void SV_TelemetryClose( void ) {
+	if ( telemetry.header ) {
+		Sys_UnmapSharedFile( telemetry.header, telemetry.size );
+	}
+	Com_Memset( &telemetry, 0, sizeof( telemetry ) );
+	sv_telemetryActive = qfalse;
+}
+
+
+/*
+==================
+SV_TelemetryOpen
+==================
+*/
+static qboolean SV_TelemetryOpen( void ) {
+	telemetryHeader_t *header;
+	const char *ospath;
+	int port, size;
+
+	port = Cvar_VariableIntegerValue( "net_port" );
+
+	if ( sv_telemetryFile->string[0] ) {
+		ospath = sv_telemetryFile->string;
+	} else {
+		Sys_Mkdir( FS_BuildOSPath( FS_GetHomePath(), NULL, NULL ) );
+		ospath = FS_BuildOSPath( FS_GetHomePath(), NULL, va( "telemetry-%i.bin", port ) );
+	}
+
+	size = sizeof( telemetryHeader_t ) + TELEMETRY_RECORDS * sizeof( telemetryRecord_t );
+
+	header = Sys_MapSharedFile( ospath, size );
+	if ( !header ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't map telemetry file %s\n", ospath );
+		return qfalse;
+	}
+
+	Com_Memset( header, 0, sizeof( *header ) );
+	header->headerSize = sizeof( telemetryHeader_t );
+	header->recordSize = sizeof( telemetryRecord_t );
+	header->numRecords = TELEMETRY_RECORDS;
+	header->serverPort = port;
+	header->version = TELEMETRY_VERSION;
+	header->magic = TELEMETRY_MAGIC;
+
+	telemetry.header = header;
+	telemetry.records = (telemetryRecord_t *)( header + 1 );
+	telemetry.size = size;
+	telemetry.nextCheck = Sys_Milliseconds();
+
+	Com_Printf( "Telemetry ring mapped at %s\n", ospath );
+
+	return qtrue;
+}
+
+
+/*
+==================
+SV_TelemetryFrame
+
+Records are produced only while a reader keeps changing the heartbeat
+==================
+*/
+void SV_TelemetryFrame( void ) {
+	uint32_t heartbeat;
+	int msec;
+
+	if ( !sv_telemetry->integer ) {
+		if ( telemetry.header ) {
+			SV_TelemetryClose();
+		}
+		return;
+	}
+
+	if ( !telemetry.header && !SV_TelemetryOpen() ) {
+		Cvar_Set( "sv_telemetry", "0" );
+		return;
+	}
+
+	msec = Sys_Milliseconds();
+	if ( msec - telemetry.nextCheck < 0 ) {
+		return;
+	}
+
+	heartbeat = telemetry.header->readerHeartbeat;
+	sv_telemetryActive = ( heartbeat != telemetry.heartbeat );
+	telemetry.heartbeat = heartbeat;
+	telemetry.nextCheck = msec + TELEMETRY_CHECK_MSEC;
+}
+
+
+/*
+==================
+SV_Telemetry
+
+Appends a record, callers check sv_telemetryActive first
+==================
+*/
+void SV_Telemetry( telemetryType_t type, int client, int d0, int d1, int d2, int d3, int d4, int d5 ) {
+	telemetryRecord_t *rec;
+	uint32_t index;
+
+	index = telemetry.header->writeIndex;
+	rec = &telemetry.records[ index & ( TELEMETRY_RECORDS - 1 ) ];
+
+	rec->type = type;
+	rec->client = client;
+	rec->time = svs.time;
+	rec->data[0] = d0;
+	rec->data[1] = d1;
+	rec->data[2] = d2;
+	rec->data[3] = d3;
+	rec->data[4] = d4;
+	rec->data[5] = d5;
+
+	// publish after the record is complete
+	Q_AtomicAdd( &telemetry.header->writeIndex, 1 );
+}
+
+
+/*
+==================
+SV_TelemetryAddress
+
+Packs an address into one integer for TM_RATELIMIT records
+==================
+*/
+int SV_TelemetryAddress( const netadr_t *adr ) {
+	int a;
+
+	if ( adr->type == NA_IP ) {
+		Com_Memcpy( &a, adr->ipv._4, sizeof( a ) );
+		return a;
+	}
+
+	a = 0;
+#ifdef USE_IPV6
+	if ( adr->type == NA_IP6 ) {
+		int i;
+		for ( i = 0; i < 16; i += 4 ) {
+			a ^= adr->ipv._6[i] | ( adr->ipv._6[i+1] << 8 ) | ( adr->ipv._6[i+2] << 16 ) | ( adr->ipv._6[i+3] << 24 );
+		}
+	}
+#endif
+
+	return a;
+}
+
+
+/*
+==================
+SV_TelemetryShutdown
+==================
+*/
+void SV_TelemetryShutdown( void ) {
+	SV_TelemetryClose();
+}
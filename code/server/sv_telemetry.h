@@ -0,0 +1,68 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_telemetry.h -- layout of the server telemetry ring, shared with readers
+
+#ifndef SV_TELEMETRY_H
+#define SV_TELEMETRY_H
+
+#include <stdint.h>
+
+// The server maps sv_telemetryFile and appends fixed size records to the
+// ring that follows the header, in host byte order.
+//
+// A reader maps the same file and changes readerHeartbeat at least every
+// 500 msec, records are written only while it does so.  Record n is stored
+// in slot ( n & ( numRecords - 1 ) ), the reader consumes records up to
+// writeIndex and must re-check writeIndex after copying: records older than
+// writeIndex - numRecords have been overwritten in the meantime.
+
+#define TELEMETRY_MAGIC			0x4d543351	// "Q3TM"
+#define TELEMETRY_VERSION		1
+#define TELEMETRY_RECORDS		16384		// must be a power of two
+
+typedef struct {
+	uint32_t			magic;
+	uint32_t			version;
+	uint32_t			headerSize;
+	uint32_t			recordSize;
+	uint32_t			numRecords;
+	uint32_t			serverPort;
+	volatile uint32_t	writeIndex;			// records written since the file was opened
+	volatile uint32_t	readerHeartbeat;	// changed by readers
+	uint32_t			reserved[8];
+} telemetryHeader_t;
+
+typedef enum {
+	TM_FRAME = 1,		// data: frame usec, game usec, send usec, game frames, active clients, time residual
+	TM_SNAPSHOT,		// data: message bytes, ping, rate, rate delayed, snapshot msec, msec since last snapshot
+	TM_DROP,			// data: dropped packets, incoming sequence
+	TM_RATELIMIT		// data: address type, IPv4 address (IPv6 folded to 32 bits), port, burst, period
+} telemetryType_t;
+
+typedef struct {
+	uint16_t			type;
+	int16_t				client;		// -1 if not client related
+	uint32_t			time;		// server time in msec
+	int32_t				data[6];
+} telemetryRecord_t;
+
+#endif // SV_TELEMETRY_H
@@ -1486,6 +1486,9 @@ int GLW_SetMode( int mode, const char *modeFS, qboolean fullscreen, qboolean vul
 
 	if ( dpy == NULL )
 	{
+		// buffers may be swapped from the render thread while input is read
+		XInitThreads();
+
 		dpy = XOpenDisplay( NULL );
 		if ( dpy == NULL )
 		{
@@ -1936,6 +1939,22 @@ void GLimp_EndFrame( void )
 		qglXSwapBuffers( dpy, win );
 	}
 }
+
+
+/*
+** GLimp_MakeCurrent
+**
+** Binds the context to the calling thread or releases it, the renderer
+** uses this to hand the context over to its render thread
+*/
+void GLimp_MakeCurrent( qboolean current )
+{
+	if ( current ) {
+		qglXMakeCurrent( dpy, win, ctx );
+	} else {
+		qglXMakeCurrent( dpy, None, NULL );
+	}
+}
 #endif // USE_OPENGL_API
 
 
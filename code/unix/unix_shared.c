@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <sched.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <stdio.h>
 #include <dirent.h>
@@ -32,6 +33,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <pwd.h>
 #include <dlfcn.h>
 #include <libgen.h>
+#include <pthread.h>
+#if defined (__GLIBC__) || defined (__APPLE__)
+#include <execinfo.h>
+#define HAVE_BACKTRACE
+#endif
 
 #include "../qcommon/q_shared.h"
 #include "../qcommon/qcommon.h"
@@ -605,6 +611,284 @@ qboolean Sys_SetAffinityMask( const uint64_t mask )
 #endif // USE_AFFINITY_MASK
 
 
+/*
+=================
+Sys_BackTrace
+
+Captures up to maxFrames return addresses of the calling thread
+=================
+*/
+int Sys_BackTrace( void **frames, int maxFrames )
+{
+#ifdef HAVE_BACKTRACE
+	return backtrace( frames, maxFrames );
+#else
+	return 0;
+#endif
+}
+
+
+/*
+=================
+Sys_AddressName
+
+Describes code address as module+offset which stays the same between runs
+=================
+*/
+void Sys_AddressName( const void *addr, char *buf, int size )
+{
+	Dl_info info;
+
+	if ( dladdr( addr, &info ) && info.dli_fname ) {
+		if ( info.dli_sname && info.dli_saddr ) {
+			Com_sprintf( buf, size, "%s+0x%x(%s+0x%x)", Sys_Basename( (char *)info.dli_fname ),
+				(unsigned)( (const byte *)addr - (const byte *)info.dli_fbase ),
+				info.dli_sname, (unsigned)( (const byte *)addr - (const byte *)info.dli_saddr ) );
+		} else {
+			Com_sprintf( buf, size, "%s+0x%x", Sys_Basename( (char *)info.dli_fname ),
+				(unsigned)( (const byte *)addr - (const byte *)info.dli_fbase ) );
+		}
+	} else {
+		Com_sprintf( buf, size, "%p", addr );
+	}
+}
+
+
+typedef struct {
+	threadFunc_t	func;
+	void			*arg;
+	pthread_t		thread;
+} sysThread_t;
+
+static void *Sys_ThreadMain( void *data )
+{
+	const sysThread_t *t = (const sysThread_t *)data;
+
+	t->func( t->arg );
+
+	Z_ReleaseThreadCache();
+
+	return NULL;
+}
+
+
+/*
+=================
+Sys_CreateThread
+=================
+*/
+void *Sys_CreateThread( threadFunc_t func, void *arg )
+{
+	sysThread_t *t;
+
+	t = malloc( sizeof( *t ) );
+	if ( t == NULL ) {
+		return NULL;
+	}
+
+	t->func = func;
+	t->arg = arg;
+
+	if ( pthread_create( &t->thread, NULL, Sys_ThreadMain, t ) != 0 ) {
+		free( t );
+		return NULL;
+	}
+
+	return t;
+}
+
+
+/*
+=================
+Sys_JoinThread
+
+Waits for thread completion and releases its handle
+=================
+*/
+void Sys_JoinThread( void *thread )
+{
+	sysThread_t *t = (sysThread_t *)thread;
+
+	if ( t ) {
+		pthread_join( t->thread, NULL );
+		free( t );
+	}
+}
+
+
+typedef struct {
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	int				count;
+} sysSemaphore_t;
+
+
+/*
+=================
+Sys_CreateSemaphore
+
+Counting semaphore for waking up idle worker threads, starts at zero
+=================
+*/
+void *Sys_CreateSemaphore( void )
+{
+	sysSemaphore_t *s;
+
+	s = malloc( sizeof( *s ) );
+	if ( s == NULL ) {
+		return NULL;
+	}
+
+	s->count = 0;
+
+	if ( pthread_mutex_init( &s->mutex, NULL ) != 0 ) {
+		free( s );
+		return NULL;
+	}
+
+	if ( pthread_cond_init( &s->cond, NULL ) != 0 ) {
+		pthread_mutex_destroy( &s->mutex );
+		free( s );
+		return NULL;
+	}
+
+	return s;
+}
+
+
+/*
+=================
+Sys_DestroySemaphore
+=================
+*/
+void Sys_DestroySemaphore( void *sem )
+{
+	sysSemaphore_t *s = (sysSemaphore_t *)sem;
+
+	if ( s ) {
+		pthread_cond_destroy( &s->cond );
+		pthread_mutex_destroy( &s->mutex );
+		free( s );
+	}
+}
+
+
+/*
+=================
+Sys_PostSemaphore
+=================
+*/
+void Sys_PostSemaphore( void *sem, int count )
+{
+	sysSemaphore_t *s = (sysSemaphore_t *)sem;
+
+	if ( count <= 0 ) {
+		return;
+	}
+
+	pthread_mutex_lock( &s->mutex );
+	s->count += count;
+	if ( count == 1 ) {
+		pthread_cond_signal( &s->cond );
+	} else {
+		pthread_cond_broadcast( &s->cond );
+	}
+	pthread_mutex_unlock( &s->mutex );
+}
+
+
+/*
+=================
+Sys_WaitSemaphore
+=================
+*/
+void Sys_WaitSemaphore( void *sem )
+{
+	sysSemaphore_t *s = (sysSemaphore_t *)sem;
+
+	pthread_mutex_lock( &s->mutex );
+	while ( s->count == 0 ) {
+		pthread_cond_wait( &s->cond, &s->mutex );
+	}
+	s->count--;
+	pthread_mutex_unlock( &s->mutex );
+}
+
+
+/*
+=================
+Sys_NumCPUs
+=================
+*/
+int Sys_NumCPUs( void )
+{
+	long n = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return n > 0 ? (int)n : 1;
+}
+
+
+/*
+=================
+Sys_SyncFile
+=================
+*/
+void Sys_SyncFile( FILE *f )
+{
+	fflush( f );
+	fsync( fileno( f ) );
+}
+
+
+/*
+=================
+Sys_MapSharedFile
+
+Read-write mapping of a file which other processes can map too,
+the file is created or resized to size bytes
+=================
+*/
+void *Sys_MapSharedFile( const char *ospath, int size )
+{
+	void *data;
+	int fd;
+
+	fd = open( ospath, O_RDWR | O_CREAT, 0644 );
+	if ( fd == -1 ) {
+		return NULL;
+	}
+
+	if ( ftruncate( fd, size ) == -1 ) {
+		close( fd );
+		return NULL;
+	}
+
+	data = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+	// mapping keeps the file open
+	close( fd );
+
+	if ( data == MAP_FAILED ) {
+		return NULL;
+	}
+
+	return data;
+}
+
+
+/*
+=================
+Sys_UnmapSharedFile
+=================
+*/
+void Sys_UnmapSharedFile( void *data, int size )
+{
+	if ( data ) {
+		munmap( data, size );
+	}
+}
+
+
 /*
 =================
 Sys_StripAppBundle
@@ -1307,6 +1307,22 @@ void GLimp_EndFrame( void )
 }
 
 
+/*
+** GLimp_MakeCurrent
+**
+** Binds the context to the calling thread or releases it, the renderer
+** uses this to hand the context over to its render thread
+*/
+void GLimp_MakeCurrent( qboolean current )
+{
+	if ( current ) {
+		qwglMakeCurrent( glw_state.hDC, glw_state.hGLRC );
+	} else {
+		qwglMakeCurrent( NULL, NULL );
+	}
+}
+
+
 static qboolean GLW_StartOpenGL( void )
 {
 	//
@@ -247,3 +247,227 @@ qboolean Sys_SetAffinityMask( const uint64_t mask )
 	return qfalse;
 }
 #endif // USE_AFFINITY_MASK
+
+
+/*
+================
+Sys_BackTrace
+
+Captures up to maxFrames return addresses of the calling thread
+================
+*/
+int Sys_BackTrace( void **frames, int maxFrames )
+{
+	return RtlCaptureStackBackTrace( 0, maxFrames, frames, NULL );
+}
+
+
+/*
+================
+Sys_AddressName
+
+Describes code address as module+offset which stays the same between runs
+================
+*/
+void Sys_AddressName( const void *addr, char *buf, int size )
+{
+	char name[ MAX_OSPATH ], *base;
+	HMODULE hModule;
+
+	if ( GetModuleHandleExA( GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+			(LPCSTR)addr, &hModule ) && GetModuleFileNameA( hModule, name, sizeof( name ) ) ) {
+		base = strrchr( name, '\\' );
+		Com_sprintf( buf, size, "%s+0x%x", base ? base + 1 : name,
+			(unsigned)( (const byte *)addr - (const byte *)hModule ) );
+	} else {
+		Com_sprintf( buf, size, "%p", addr );
+	}
+}
+
+
+typedef struct {
+	threadFunc_t	func;
+	void			*arg;
+	HANDLE			thread;
+} sysThread_t;
+
+static DWORD WINAPI Sys_ThreadMain( LPVOID data )
+{
+	const sysThread_t *t = (const sysThread_t *)data;
+
+	t->func( t->arg );
+
+	Z_ReleaseThreadCache();
+
+	return 0;
+}
+
+
+/*
+================
+Sys_CreateThread
+================
+*/
+void *Sys_CreateThread( threadFunc_t func, void *arg )
+{
+	sysThread_t *t;
+
+	t = malloc( sizeof( *t ) );
+	if ( t == NULL ) {
+		return NULL;
+	}
+
+	t->func = func;
+	t->arg = arg;
+	t->thread = CreateThread( NULL, 0, Sys_ThreadMain, t, 0, NULL );
+
+	if ( t->thread == NULL ) {
+		free( t );
+		return NULL;
+	}
+
+	return t;
+}
+
+
+/*
+================
+Sys_JoinThread
+
+Waits for thread completion and releases its handle
+================
+*/
+void Sys_JoinThread( void *thread )
+{
+	sysThread_t *t = (sysThread_t *)thread;
+
+	if ( t ) {
+		WaitForSingleObject( t->thread, INFINITE );
+		CloseHandle( t->thread );
+		free( t );
+	}
+}
+
+
+/*
+================
+Sys_CreateSemaphore
+
+Counting semaphore for waking up idle worker threads, starts at zero
+================
+*/
+void *Sys_CreateSemaphore( void )
+{
+	return CreateSemaphoreA( NULL, 0, 0x7FFFFFFF, NULL );
+}
+
+
+/*
+================
+Sys_DestroySemaphore
+================
+*/
+void Sys_DestroySemaphore( void *sem )
+{
+	if ( sem ) {
+		CloseHandle( (HANDLE)sem );
+	}
+}
+
+
+/*
+================
+Sys_PostSemaphore
+================
+*/
+void Sys_PostSemaphore( void *sem, int count )
+{
+	if ( count > 0 ) {
+		ReleaseSemaphore( (HANDLE)sem, count, NULL );
+	}
+}
+
+
+/*
+================
+Sys_WaitSemaphore
+================
+*/
+void Sys_WaitSemaphore( void *sem )
+{
+	WaitForSingleObject( (HANDLE)sem, INFINITE );
+}
+
+
+/*
+================
+Sys_NumCPUs
+================
+*/
+int Sys_NumCPUs( void )
+{
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+
+/*
+================
+Sys_SyncFile
+================
+*/
+void Sys_SyncFile( FILE *f )
+{
+	fflush( f );
+	FlushFileBuffers( (HANDLE)_get_osfhandle( _fileno( f ) ) );
+}
+
+
+/*
+================
+Sys_MapSharedFile
+
+Read-write mapping of a file which other processes can map too,
+the file is created or resized to size bytes
+================
+*/
+void *Sys_MapSharedFile( const char *ospath, int size )
+{
+	HANDLE hFile, hMap;
+	void *data;
+
+	hFile = CreateFileA( ospath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( hFile == INVALID_HANDLE_VALUE ) {
+		return NULL;
+	}
+
+	hMap = CreateFileMappingA( hFile, NULL, PAGE_READWRITE, 0, size, NULL );
+	CloseHandle( hFile );
+	if ( hMap == NULL ) {
+		return NULL;
+	}
+
+	data = MapViewOfFile( hMap, FILE_MAP_WRITE, 0, 0, size );
+
+	// view keeps mapping object alive
+	CloseHandle( hMap );
+
+	return data;
+}
+
+
+/*
+================
+Sys_UnmapSharedFile
+================
+*/
+void Sys_UnmapSharedFile( void *data, int size )
+{
+	if ( data ) {
+		UnmapViewOfFile( data );
+	}
+}